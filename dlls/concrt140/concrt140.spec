@@ -60,14 +60,14 @@
 @ stub -arch=win64 ??0bad_target@Concurrency@@QEAA@PEBD@Z
 @ stub -arch=i386 ??0bad_target@Concurrency@@QAE@XZ
 @ stub -arch=win64 ??0bad_target@Concurrency@@QEAA@XZ
-@ stub -arch=i386 ??0context_self_unblock@Concurrency@@QAE@PBD@Z
-@ stub -arch=win64 ??0context_self_unblock@Concurrency@@QEAA@PEBD@Z
-@ stub -arch=i386 ??0context_self_unblock@Concurrency@@QAE@XZ
-@ stub -arch=win64 ??0context_self_unblock@Concurrency@@QEAA@XZ
-@ stub -arch=i386 ??0context_unblock_unbalanced@Concurrency@@QAE@PBD@Z
-@ stub -arch=win64 ??0context_unblock_unbalanced@Concurrency@@QEAA@PEBD@Z
-@ stub -arch=i386 ??0context_unblock_unbalanced@Concurrency@@QAE@XZ
-@ stub -arch=win64 ??0context_unblock_unbalanced@Concurrency@@QEAA@XZ
+@ thiscall -arch=i386 ??0context_self_unblock@Concurrency@@QAE@PBD@Z(ptr str) msvcr120.??0context_self_unblock@Concurrency@@QAE@PBD@Z
+@ cdecl -arch=win64 ??0context_self_unblock@Concurrency@@QEAA@PEBD@Z(ptr str) msvcr120.??0context_self_unblock@Concurrency@@QEAA@PEBD@Z
+@ thiscall -arch=i386 ??0context_self_unblock@Concurrency@@QAE@XZ(ptr) msvcr120.??0context_self_unblock@Concurrency@@QAE@XZ
+@ cdecl -arch=win64 ??0context_self_unblock@Concurrency@@QEAA@XZ(ptr) msvcr120.??0context_self_unblock@Concurrency@@QEAA@XZ
+@ thiscall -arch=i386 ??0context_unblock_unbalanced@Concurrency@@QAE@PBD@Z(ptr str) msvcr120.??0context_unblock_unbalanced@Concurrency@@QAE@PBD@Z
+@ cdecl -arch=win64 ??0context_unblock_unbalanced@Concurrency@@QEAA@PEBD@Z(ptr str) msvcr120.??0context_unblock_unbalanced@Concurrency@@QEAA@PEBD@Z
+@ thiscall -arch=i386 ??0context_unblock_unbalanced@Concurrency@@QAE@XZ(ptr) msvcr120.??0context_unblock_unbalanced@Concurrency@@QAE@XZ
+@ cdecl -arch=win64 ??0context_unblock_unbalanced@Concurrency@@QEAA@XZ(ptr) msvcr120.??0context_unblock_unbalanced@Concurrency@@QEAA@XZ
 @ thiscall -arch=i386 ??0critical_section@Concurrency@@QAE@XZ(ptr) msvcr120.??0critical_section@Concurrency@@QAE@XZ
 @ cdecl -arch=win64 ??0critical_section@Concurrency@@QEAA@XZ(ptr) msvcr120.??0critical_section@Concurrency@@QEAA@XZ
 @ stub -arch=i386 ??0default_scheduler_exists@Concurrency@@QAE@PBD@Z
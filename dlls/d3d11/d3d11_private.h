@@ -516,14 +516,30 @@ struct d3d_query *unsafe_impl_from_ID3D11Query(ID3D11Query *iface) DECLSPEC_HIDD
 struct d3d_query *unsafe_impl_from_ID3D10Query(ID3D10Query *iface) DECLSPEC_HIDDEN;
 struct d3d_query *unsafe_impl_from_ID3D11Asynchronous(ID3D11Asynchronous *iface) DECLSPEC_HIDDEN;
 
-/* ID3D11DeviceContext - immediate context */
-struct d3d11_immediate_context
+/* ID3D11CommandList */
+struct d3d11_command_list
+{
+    ID3D11CommandList ID3D11CommandList_iface;
+    LONG refcount;
+
+    struct wined3d_private_store private_store;
+    struct wined3d_command_list *wined3d_list;
+    ID3D11Device2 *device;
+};
+
+/* ID3D11DeviceContext - immediate and deferred contexts */
+struct d3d11_device_context
 {
     ID3D11DeviceContext1 ID3D11DeviceContext1_iface;
     ID3D11Multithread ID3D11Multithread_iface;
     LONG refcount;
 
+    D3D11_DEVICE_CONTEXT_TYPE type;
+    struct wined3d_device_context *wined3d_context;
+    struct d3d_device *device;
+
     struct wined3d_private_store private_store;
+    UINT stencil_ref;
 };
 
 /* ID3D11Device, ID3D10Device1 */
@@ -540,7 +556,7 @@ struct d3d_device
     D3D_FEATURE_LEVEL feature_level;
     BOOL d3d11_only;
 
-    struct d3d11_immediate_context immediate_context;
+    struct d3d11_device_context immediate_context;
 
     struct wined3d_device_parent device_parent;
     struct wined3d_device *wined3d_device;
@@ -549,8 +565,6 @@ struct d3d_device
     struct wine_rb_tree depthstencil_states;
     struct wine_rb_tree rasterizer_states;
     struct wine_rb_tree sampler_states;
-
-    UINT stencil_ref;
 };
 
 static inline struct d3d_device *impl_from_ID3D11Device(ID3D11Device *iface)
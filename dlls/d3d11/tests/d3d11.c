@@ -2271,7 +2271,7 @@ static void test_create_deferred_context(void)
 
     expected_refcount = get_refcount(device) + 1;
     hr = ID3D11Device_CreateDeferredContext(device, 0, &context);
-    todo_wine ok(hr == S_OK, "Failed to create deferred context, hr %#x.\n", hr);
+    ok(hr == S_OK, "Failed to create deferred context, hr %#x.\n", hr);
     if (FAILED(hr))
         goto done;
     refcount = get_refcount(device);
@@ -30314,7 +30314,7 @@ static void test_deferred_context_state(void)
     ID3D11DeviceContext_PSSetConstantBuffers(immediate, 0, 1, &green_buffer);
 
     hr = ID3D11Device_CreateDeferredContext(device, 0, &deferred);
-    todo_wine ok(hr == S_OK, "Failed to create deferred context, hr %#x.\n", hr);
+    ok(hr == S_OK, "Failed to create deferred context, hr %#x.\n", hr);
     if (hr != S_OK)
     {
         ID3D11Buffer_Release(blue_buffer);
@@ -30364,6 +30364,329 @@ static void test_deferred_context_state(void)
     release_test_context(&test_context);
 }
 
+static void test_deferred_context_state_refcount(void)
+{
+    ID3D11DeviceContext *immediate, *deferred;
+    ID3D11DepthStencilState *ds_state, *ret_ds_state;
+    struct d3d11_test_context test_context;
+    ID3D11RasterizerState *rs_state, *ret_rs_state;
+    D3D11_DEPTH_STENCIL_DESC ds_desc;
+    D3D11_RASTERIZER_DESC rs_desc;
+    ID3D11CommandList *list;
+    IUnknown *test_object;
+    ID3D11Device *device;
+    unsigned int stencil_ref;
+    ULONG refcount;
+    HRESULT hr;
+
+    static const GUID test_guid =
+            {0x5a2ab8d5, 0x1d2c, 0x4a3a, {0x8e, 0x63, 0x2c, 0x0a, 0x5b, 0x31, 0x7e, 0x14}};
+
+    if (!init_test_context(&test_context, NULL))
+        return;
+
+    device = test_context.device;
+    immediate = test_context.immediate_context;
+    test_object = (IUnknown *)create_device(NULL);
+
+    memset(&rs_desc, 0, sizeof(rs_desc));
+    rs_desc.FillMode = D3D11_FILL_WIREFRAME;
+    rs_desc.CullMode = D3D11_CULL_FRONT;
+    rs_desc.DepthClipEnable = TRUE;
+    hr = ID3D11Device_CreateRasterizerState(device, &rs_desc, &rs_state);
+    ok(hr == S_OK, "Failed to create rasterizer state, hr %#x.\n", hr);
+
+    memset(&ds_desc, 0, sizeof(ds_desc));
+    ds_desc.DepthEnable = TRUE;
+    ds_desc.DepthWriteMask = D3D11_DEPTH_WRITE_MASK_ZERO;
+    ds_desc.DepthFunc = D3D11_COMPARISON_GREATER;
+    ds_desc.StencilEnable = TRUE;
+    ds_desc.StencilReadMask = D3D11_DEFAULT_STENCIL_READ_MASK;
+    ds_desc.StencilWriteMask = D3D11_DEFAULT_STENCIL_WRITE_MASK;
+    ds_desc.FrontFace.StencilFailOp = D3D11_STENCIL_OP_KEEP;
+    ds_desc.FrontFace.StencilDepthFailOp = D3D11_STENCIL_OP_KEEP;
+    ds_desc.FrontFace.StencilPassOp = D3D11_STENCIL_OP_KEEP;
+    ds_desc.FrontFace.StencilFunc = D3D11_COMPARISON_ALWAYS;
+    ds_desc.BackFace = ds_desc.FrontFace;
+    hr = ID3D11Device_CreateDepthStencilState(device, &ds_desc, &ds_state);
+    ok(hr == S_OK, "Failed to create depth/stencil state, hr %#x.\n", hr);
+
+    /* The private data is released when the state objects are destroyed. */
+    hr = ID3D11RasterizerState_SetPrivateDataInterface(rs_state, &test_guid, test_object);
+    ok(hr == S_OK, "Got unexpected hr %#x.\n", hr);
+    hr = ID3D11DepthStencilState_SetPrivateDataInterface(ds_state, &test_guid, test_object);
+    ok(hr == S_OK, "Got unexpected hr %#x.\n", hr);
+    refcount = get_refcount(test_object);
+    ok(refcount == 3, "Got unexpected refcount %u.\n", refcount);
+
+    hr = ID3D11Device_CreateDeferredContext(device, 0, &deferred);
+    ok(hr == S_OK, "Failed to create deferred context, hr %#x.\n", hr);
+    if (hr != S_OK)
+    {
+        ID3D11DepthStencilState_Release(ds_state);
+        ID3D11RasterizerState_Release(rs_state);
+        IUnknown_Release(test_object);
+        release_test_context(&test_context);
+        return;
+    }
+
+    /* States bound to a deferred context are released with the context. */
+    ID3D11DeviceContext_RSSetState(deferred, rs_state);
+    ID3D11DeviceContext_OMSetDepthStencilState(deferred, ds_state, 3);
+    ID3D11DepthStencilState_Release(ds_state);
+    ID3D11RasterizerState_Release(rs_state);
+    refcount = get_refcount(test_object);
+    ok(refcount == 3, "Got unexpected refcount %u.\n", refcount);
+    ID3D11DeviceContext_Release(deferred);
+    refcount = get_refcount(test_object);
+    ok(refcount == 1, "Got unexpected refcount %u.\n", refcount);
+
+    hr = ID3D11Device_CreateRasterizerState(device, &rs_desc, &rs_state);
+    ok(hr == S_OK, "Failed to create rasterizer state, hr %#x.\n", hr);
+    hr = ID3D11Device_CreateDepthStencilState(device, &ds_desc, &ds_state);
+    ok(hr == S_OK, "Failed to create depth/stencil state, hr %#x.\n", hr);
+    hr = ID3D11RasterizerState_SetPrivateDataInterface(rs_state, &test_guid, test_object);
+    ok(hr == S_OK, "Got unexpected hr %#x.\n", hr);
+    hr = ID3D11DepthStencilState_SetPrivateDataInterface(ds_state, &test_guid, test_object);
+    ok(hr == S_OK, "Got unexpected hr %#x.\n", hr);
+
+    hr = ID3D11Device_CreateDeferredContext(device, 0, &deferred);
+    ok(hr == S_OK, "Failed to create deferred context, hr %#x.\n", hr);
+
+    /* Executing a list without restoring the state clears the states bound
+     * to the immediate context, and the stencil reference value. */
+    ID3D11DeviceContext_RSSetState(immediate, rs_state);
+    ID3D11DeviceContext_OMSetDepthStencilState(immediate, ds_state, 5);
+    hr = ID3D11DeviceContext_FinishCommandList(deferred, FALSE, &list);
+    ok(hr == S_OK, "Failed to create command list, hr %#x.\n", hr);
+
+    ID3D11DeviceContext_ExecuteCommandList(immediate, list, TRUE);
+    ID3D11DeviceContext_RSGetState(immediate, &ret_rs_state);
+    ok(ret_rs_state == rs_state, "Got unexpected rasterizer state %p.\n", ret_rs_state);
+    ID3D11RasterizerState_Release(ret_rs_state);
+    ID3D11DeviceContext_OMGetDepthStencilState(immediate, &ret_ds_state, &stencil_ref);
+    ok(ret_ds_state == ds_state, "Got unexpected depth/stencil state %p.\n", ret_ds_state);
+    ok(stencil_ref == 5, "Got unexpected stencil ref %u.\n", stencil_ref);
+    ID3D11DepthStencilState_Release(ret_ds_state);
+
+    ID3D11DeviceContext_ExecuteCommandList(immediate, list, FALSE);
+    ID3D11DeviceContext_RSGetState(immediate, &ret_rs_state);
+    ok(!ret_rs_state, "Got unexpected rasterizer state %p.\n", ret_rs_state);
+    ID3D11DeviceContext_OMGetDepthStencilState(immediate, &ret_ds_state, &stencil_ref);
+    ok(!ret_ds_state, "Got unexpected depth/stencil state %p.\n", ret_ds_state);
+    ok(!stencil_ref, "Got unexpected stencil ref %u.\n", stencil_ref);
+
+    ID3D11DepthStencilState_Release(ds_state);
+    ID3D11RasterizerState_Release(rs_state);
+    refcount = get_refcount(test_object);
+    ok(refcount == 1, "Got unexpected refcount %u.\n", refcount);
+
+    /* The same goes for finishing a list without restoring the state. */
+    hr = ID3D11Device_CreateRasterizerState(device, &rs_desc, &rs_state);
+    ok(hr == S_OK, "Failed to create rasterizer state, hr %#x.\n", hr);
+    hr = ID3D11RasterizerState_SetPrivateDataInterface(rs_state, &test_guid, test_object);
+    ok(hr == S_OK, "Got unexpected hr %#x.\n", hr);
+    ID3D11DeviceContext_RSSetState(deferred, rs_state);
+    ID3D11RasterizerState_Release(rs_state);
+
+    ID3D11CommandList_Release(list);
+    hr = ID3D11DeviceContext_FinishCommandList(deferred, FALSE, &list);
+    ok(hr == S_OK, "Failed to create command list, hr %#x.\n", hr);
+    ID3D11DeviceContext_RSGetState(deferred, &ret_rs_state);
+    ok(!ret_rs_state, "Got unexpected rasterizer state %p.\n", ret_rs_state);
+    ID3D11CommandList_Release(list);
+    refcount = get_refcount(test_object);
+    ok(refcount == 1, "Got unexpected refcount %u.\n", refcount);
+
+    ID3D11DeviceContext_Release(deferred);
+    IUnknown_Release(test_object);
+    release_test_context(&test_context);
+}
+
+static void test_deferred_context_map(void)
+{
+    ID3D11DeviceContext *immediate, *deferred;
+    struct d3d11_test_context test_context;
+    D3D11_MAPPED_SUBRESOURCE map_desc;
+    D3D11_BUFFER_DESC buffer_desc;
+    struct resource_readback rb;
+    ID3D11CommandList *list;
+    ID3D11Buffer *buffer;
+    ID3D11Device *device;
+    unsigned int i;
+    DWORD *data;
+    HRESULT hr;
+
+    if (!init_test_context(&test_context, NULL))
+        return;
+
+    device = test_context.device;
+    immediate = test_context.immediate_context;
+
+    buffer_desc.ByteWidth = 64 * sizeof(*data);
+    buffer_desc.Usage = D3D11_USAGE_DYNAMIC;
+    buffer_desc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+    buffer_desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+    buffer_desc.MiscFlags = 0;
+    buffer_desc.StructureByteStride = 0;
+    hr = ID3D11Device_CreateBuffer(device, &buffer_desc, NULL, &buffer);
+    ok(hr == S_OK, "Failed to create buffer, hr %#x.\n", hr);
+
+    hr = ID3D11DeviceContext_Map(immediate, (ID3D11Resource *)buffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &map_desc);
+    ok(hr == S_OK, "Failed to map buffer, hr %#x.\n", hr);
+    memset(map_desc.pData, 0xcc, buffer_desc.ByteWidth);
+    ID3D11DeviceContext_Unmap(immediate, (ID3D11Resource *)buffer, 0);
+
+    hr = ID3D11Device_CreateDeferredContext(device, 0, &deferred);
+    ok(hr == S_OK, "Failed to create deferred context, hr %#x.\n", hr);
+    if (hr != S_OK)
+    {
+        ID3D11Buffer_Release(buffer);
+        release_test_context(&test_context);
+        return;
+    }
+
+    /* The contents of the buffer aren't known while recording. */
+    hr = ID3D11DeviceContext_Map(deferred, (ID3D11Resource *)buffer, 0, D3D11_MAP_WRITE_NO_OVERWRITE, 0, &map_desc);
+    ok(hr == D3D11_ERROR_DEFERRED_CONTEXT_MAP_WITHOUT_INITIAL_DISCARD, "Got unexpected hr %#x.\n", hr);
+
+    hr = ID3D11DeviceContext_Map(deferred, (ID3D11Resource *)buffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &map_desc);
+    ok(hr == S_OK, "Failed to map buffer, hr %#x.\n", hr);
+    data = map_desc.pData;
+    for (i = 0; i < 32; ++i)
+        data[i] = i;
+    ID3D11DeviceContext_Unmap(deferred, (ID3D11Resource *)buffer, 0);
+
+    /* Mapping without overwriting keeps the data written after the discard. */
+    hr = ID3D11DeviceContext_Map(deferred, (ID3D11Resource *)buffer, 0, D3D11_MAP_WRITE_NO_OVERWRITE, 0, &map_desc);
+    ok(hr == S_OK, "Failed to map buffer, hr %#x.\n", hr);
+    data = map_desc.pData;
+    for (i = 32; i < 64; ++i)
+        data[i] = 0x100 + i;
+    ID3D11DeviceContext_Unmap(deferred, (ID3D11Resource *)buffer, 0);
+
+    hr = ID3D11DeviceContext_FinishCommandList(deferred, FALSE, &list);
+    ok(hr == S_OK, "Failed to create command list, hr %#x.\n", hr);
+
+    /* Each command list has to start with a discard. */
+    hr = ID3D11DeviceContext_Map(deferred, (ID3D11Resource *)buffer, 0, D3D11_MAP_WRITE_NO_OVERWRITE, 0, &map_desc);
+    ok(hr == D3D11_ERROR_DEFERRED_CONTEXT_MAP_WITHOUT_INITIAL_DISCARD, "Got unexpected hr %#x.\n", hr);
+
+    get_buffer_readback(buffer, &rb);
+    for (i = 0; i < 64; ++i)
+    {
+        data = get_readback_data(&rb, i, 0, 0, sizeof(*data));
+        ok(*data == 0xcccccccc, "Got unexpected value %#x at %u.\n", *data, i);
+    }
+    release_resource_readback(&rb);
+
+    ID3D11DeviceContext_ExecuteCommandList(immediate, list, FALSE);
+    get_buffer_readback(buffer, &rb);
+    for (i = 0; i < 64; ++i)
+    {
+        data = get_readback_data(&rb, i, 0, 0, sizeof(*data));
+        ok(*data == (i < 32 ? i : 0x100 + i), "Got unexpected value %#x at %u.\n", *data, i);
+    }
+    release_resource_readback(&rb);
+
+    ID3D11CommandList_Release(list);
+    ID3D11DeviceContext_Release(deferred);
+    ID3D11Buffer_Release(buffer);
+    release_test_context(&test_context);
+}
+
+static void test_deferred_context_queries(void)
+{
+    static const struct vec4 red = {1.0f, 0.0f, 0.0f, 1.0f};
+
+    ID3D11DeviceContext *immediate, *deferred;
+    struct d3d11_test_context test_context;
+    ID3D11Asynchronous *event, *occlusion;
+    unsigned int stride, offset;
+    D3D11_QUERY_DESC query_desc;
+    ID3D11CommandList *list;
+    ID3D11Device *device;
+    D3D11_VIEWPORT vp;
+    UINT64 samples;
+    BOOL signalled;
+    HRESULT hr;
+
+    if (!init_test_context(&test_context, NULL))
+        return;
+
+    device = test_context.device;
+    immediate = test_context.immediate_context;
+
+    /* Create the default input layout, shaders and buffers. */
+    draw_color_quad(&test_context, &red);
+
+    query_desc.Query = D3D11_QUERY_EVENT;
+    query_desc.MiscFlags = 0;
+    hr = ID3D11Device_CreateQuery(device, &query_desc, (ID3D11Query **)&event);
+    ok(hr == S_OK, "Failed to create query, hr %#x.\n", hr);
+    query_desc.Query = D3D11_QUERY_OCCLUSION;
+    hr = ID3D11Device_CreateQuery(device, &query_desc, (ID3D11Query **)&occlusion);
+    ok(hr == S_OK, "Failed to create query, hr %#x.\n", hr);
+
+    hr = ID3D11Device_CreateDeferredContext(device, 0, &deferred);
+    ok(hr == S_OK, "Failed to create deferred context, hr %#x.\n", hr);
+    if (hr != S_OK)
+    {
+        ID3D11Asynchronous_Release(occlusion);
+        ID3D11Asynchronous_Release(event);
+        release_test_context(&test_context);
+        return;
+    }
+
+    vp.TopLeftX = 0.0f;
+    vp.TopLeftY = 0.0f;
+    vp.Width = 640.0f;
+    vp.Height = 480.0f;
+    vp.MinDepth = 0.0f;
+    vp.MaxDepth = 1.0f;
+    stride = sizeof(struct vec3);
+    offset = 0;
+
+    ID3D11DeviceContext_Begin(deferred, occlusion);
+    ID3D11DeviceContext_OMSetRenderTargets(deferred, 1, &test_context.backbuffer_rtv, NULL);
+    ID3D11DeviceContext_RSSetViewports(deferred, 1, &vp);
+    ID3D11DeviceContext_IASetInputLayout(deferred, test_context.input_layout);
+    ID3D11DeviceContext_IASetPrimitiveTopology(deferred, D3D11_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP);
+    ID3D11DeviceContext_IASetVertexBuffers(deferred, 0, 1, &test_context.vb, &stride, &offset);
+    ID3D11DeviceContext_VSSetShader(deferred, test_context.vs, NULL, 0);
+    ID3D11DeviceContext_PSSetShader(deferred, test_context.ps, NULL, 0);
+    ID3D11DeviceContext_PSSetConstantBuffers(deferred, 0, 1, &test_context.ps_cb);
+    ID3D11DeviceContext_Draw(deferred, 4, 0);
+    ID3D11DeviceContext_End(deferred, occlusion);
+    ID3D11DeviceContext_End(deferred, event);
+
+    hr = ID3D11DeviceContext_GetData(deferred, event, NULL, 0, 0);
+    ok(hr == DXGI_ERROR_INVALID_CALL, "Got unexpected hr %#x.\n", hr);
+
+    hr = ID3D11DeviceContext_FinishCommandList(deferred, FALSE, &list);
+    ok(hr == S_OK, "Failed to create command list, hr %#x.\n", hr);
+
+    /* The queries are issued when the list is executed, and can be executed
+     * more than once. */
+    ID3D11DeviceContext_ExecuteCommandList(immediate, list, FALSE);
+    get_query_data(immediate, event, &signalled, sizeof(signalled));
+    ok(signalled == TRUE, "Got unexpected query result %#x.\n", signalled);
+    get_query_data(immediate, occlusion, &samples, sizeof(samples));
+    ok(samples == 640 * 480, "Got unexpected query result 0x%s.\n", wine_dbgstr_longlong(samples));
+
+    ID3D11DeviceContext_ExecuteCommandList(immediate, list, FALSE);
+    get_query_data(immediate, event, &signalled, sizeof(signalled));
+    ok(signalled == TRUE, "Got unexpected query result %#x.\n", signalled);
+    get_query_data(immediate, occlusion, &samples, sizeof(samples));
+    ok(samples == 640 * 480, "Got unexpected query result 0x%s.\n", wine_dbgstr_longlong(samples));
+
+    ID3D11CommandList_Release(list);
+    ID3D11DeviceContext_Release(deferred);
+    ID3D11Asynchronous_Release(occlusion);
+    ID3D11Asynchronous_Release(event);
+    release_test_context(&test_context);
+}
+
 static void test_deferred_context_rendering(void)
 {
     ID3D11DeviceContext *immediate, *deferred;
@@ -30389,7 +30712,7 @@ static void test_deferred_context_rendering(void)
     ID3D11DeviceContext_ClearRenderTargetView(immediate, test_context.backbuffer_rtv, white);
 
     hr = ID3D11Device_CreateDeferredContext(device, 0, &deferred);
-    todo_wine ok(hr == S_OK, "Failed to create deferred context, hr %#x.\n", hr);
+    ok(hr == S_OK, "Failed to create deferred context, hr %#x.\n", hr);
     if (hr != S_OK)
     {
         release_test_context(&test_context);
@@ -30466,6 +30789,238 @@ static void test_deferred_context_rendering(void)
     release_test_context(&test_context);
 }
 
+struct deferred_recording_thread
+{
+    struct d3d11_test_context *test_context;
+    ID3D11DeviceContext *context;
+    ID3D11CommandList *list;
+    unsigned int draw_count;
+};
+
+static DWORD WINAPI deferred_recording_thread_proc(void *arg)
+{
+    struct deferred_recording_thread *thread = arg;
+    struct d3d11_test_context *test_context = thread->test_context;
+    ID3D11DeviceContext *context = thread->context;
+    unsigned int stride, offset, i;
+    D3D11_VIEWPORT vp;
+    HRESULT hr;
+
+    vp.TopLeftX = 0.0f;
+    vp.TopLeftY = 0.0f;
+    vp.Width = 640.0f;
+    vp.Height = 480.0f;
+    vp.MinDepth = 0.0f;
+    vp.MaxDepth = 1.0f;
+
+    stride = sizeof(struct vec3);
+    offset = 0;
+    for (i = 0; i < thread->draw_count; ++i)
+    {
+        ID3D11DeviceContext_OMSetRenderTargets(context, 1, &test_context->backbuffer_rtv, NULL);
+        ID3D11DeviceContext_RSSetViewports(context, 1, &vp);
+        ID3D11DeviceContext_IASetInputLayout(context, test_context->input_layout);
+        ID3D11DeviceContext_IASetPrimitiveTopology(context, D3D11_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP);
+        ID3D11DeviceContext_IASetVertexBuffers(context, 0, 1, &test_context->vb, &stride, &offset);
+        ID3D11DeviceContext_VSSetShader(context, test_context->vs, NULL, 0);
+        ID3D11DeviceContext_Draw(context, 4, 0);
+    }
+
+    hr = ID3D11DeviceContext_FinishCommandList(context, FALSE, &thread->list);
+    ok(hr == S_OK, "Failed to create command list, hr %#x.\n", hr);
+
+    return 0;
+}
+
+static void test_deferred_context_performance(void)
+{
+    static const unsigned int draw_count = 10000;
+    struct deferred_recording_thread threads[4];
+    struct d3d11_test_context test_context;
+    HANDLE handles[ARRAY_SIZE(threads)];
+    DWORD start, recording, execution;
+    unsigned int i, thread_count;
+    HRESULT hr;
+
+    if (!winetest_interactive)
+    {
+        skip("deferred context benchmark only run in interactive mode\n");
+        return;
+    }
+
+    if (!init_test_context(&test_context, NULL))
+        return;
+
+    /* Create the default input layout, vertex shader and vertex buffer. */
+    draw_quad(&test_context);
+
+    for (thread_count = 1; thread_count <= ARRAY_SIZE(threads); thread_count *= 2)
+    {
+        for (i = 0; i < thread_count; ++i)
+        {
+            threads[i].test_context = &test_context;
+            threads[i].draw_count = draw_count / thread_count;
+            threads[i].list = NULL;
+            hr = ID3D11Device_CreateDeferredContext(test_context.device, 0, &threads[i].context);
+            ok(hr == S_OK, "Failed to create deferred context, hr %#x.\n", hr);
+            if (hr != S_OK)
+                break;
+        }
+        if (i < thread_count)
+        {
+            while (i--)
+                ID3D11DeviceContext_Release(threads[i].context);
+            break;
+        }
+
+        start = GetTickCount();
+        for (i = 0; i < thread_count; ++i)
+            handles[i] = CreateThread(NULL, 0, deferred_recording_thread_proc, &threads[i], 0, NULL);
+        WaitForMultipleObjects(thread_count, handles, TRUE, INFINITE);
+        recording = GetTickCount() - start;
+
+        start = GetTickCount();
+        for (i = 0; i < thread_count; ++i)
+            ID3D11DeviceContext_ExecuteCommandList(test_context.immediate_context, threads[i].list, TRUE);
+        get_texture_color(test_context.backbuffer, 320, 240);
+        execution = GetTickCount() - start;
+
+        trace("%u thread(s): recorded %u draws in %u ms, executed in %u ms.\n",
+                thread_count, draw_count, recording, execution);
+
+        for (i = 0; i < thread_count; ++i)
+        {
+            CloseHandle(handles[i]);
+            if (threads[i].list)
+                ID3D11CommandList_Release(threads[i].list);
+            ID3D11DeviceContext_Release(threads[i].context);
+        }
+    }
+
+    release_test_context(&test_context);
+}
+
+static void test_shader_reuse_across_devices(void)
+{
+    static const struct vec4 colors[] =
+    {
+        {1.0f, 0.0f, 0.0f, 1.0f},
+        {0.0f, 1.0f, 0.0f, 1.0f},
+        {0.0f, 0.0f, 1.0f, 1.0f},
+    };
+    static const DWORD expected[] = {0xff0000ff, 0xff00ff00, 0xffff0000};
+
+    struct d3d11_test_context test_context;
+    unsigned int i, j;
+
+    /* The same shaders are used by each device. With a persistent shader
+     * cache, the first device populates the cache and later devices may load
+     * the cached shaders; the results have to be the same either way. */
+    for (i = 0; i < 3; ++i)
+    {
+        if (!init_test_context(&test_context, NULL))
+            return;
+
+        for (j = 0; j < ARRAY_SIZE(colors); ++j)
+        {
+            draw_color_quad(&test_context, &colors[j]);
+            check_texture_color(test_context.backbuffer, expected[j], 0);
+        }
+
+        release_test_context(&test_context);
+    }
+}
+
+static void test_dynamic_buffer_performance(void)
+{
+    static const unsigned int map_count = 100000;
+    static const UINT sizes[] = {0x10000, 0x400000};
+    static const struct vec3 quad[] =
+    {
+        {-1.0f, -1.0f, 0.0f},
+        {-1.0f,  1.0f, 0.0f},
+        { 1.0f, -1.0f, 0.0f},
+        { 1.0f,  1.0f, 0.0f},
+    };
+    struct d3d11_test_context test_context;
+    D3D11_MAPPED_SUBRESOURCE map_desc;
+    D3D11_BUFFER_DESC buffer_desc;
+    unsigned int i, j, stride, offset;
+    ID3D11DeviceContext *context;
+    DWORD start, discard, ring;
+    ID3D11Buffer *buffer;
+    D3D11_MAP map_type;
+    HRESULT hr;
+
+    if (!winetest_interactive)
+    {
+        skip("dynamic buffer benchmark only run in interactive mode\n");
+        return;
+    }
+
+    if (!init_test_context(&test_context, NULL))
+        return;
+    context = test_context.immediate_context;
+
+    /* Create the default input layout and vertex shader. */
+    draw_quad(&test_context);
+
+    for (i = 0; i < ARRAY_SIZE(sizes); ++i)
+    {
+        buffer_desc.ByteWidth = sizes[i];
+        buffer_desc.Usage = D3D11_USAGE_DYNAMIC;
+        buffer_desc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+        buffer_desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+        buffer_desc.MiscFlags = 0;
+        buffer_desc.StructureByteStride = 0;
+        hr = ID3D11Device_CreateBuffer(test_context.device, &buffer_desc, NULL, &buffer);
+        ok(hr == S_OK, "Failed to create buffer, hr %#x.\n", hr);
+
+        stride = sizeof(*quad);
+        offset = 0;
+        ID3D11DeviceContext_IASetVertexBuffers(context, 0, 1, &buffer, &stride, &offset);
+
+        /* Discard the entire buffer for every draw. */
+        start = GetTickCount();
+        for (j = 0; j < map_count; ++j)
+        {
+            hr = ID3D11DeviceContext_Map(context, (ID3D11Resource *)buffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &map_desc);
+            ok(hr == S_OK, "Failed to map buffer, hr %#x.\n", hr);
+            memcpy(map_desc.pData, quad, sizeof(quad));
+            ID3D11DeviceContext_Unmap(context, (ID3D11Resource *)buffer, 0);
+            ID3D11DeviceContext_Draw(context, ARRAY_SIZE(quad), 0);
+        }
+        get_texture_color(test_context.backbuffer, 320, 240);
+        discard = GetTickCount() - start;
+
+        /* Append to the buffer, discarding it when it's full. */
+        start = GetTickCount();
+        for (j = 0, offset = 0; j < map_count; ++j, offset += sizeof(quad))
+        {
+            map_type = D3D11_MAP_WRITE_NO_OVERWRITE;
+            if (offset + sizeof(quad) > buffer_desc.ByteWidth)
+            {
+                map_type = D3D11_MAP_WRITE_DISCARD;
+                offset = 0;
+            }
+            hr = ID3D11DeviceContext_Map(context, (ID3D11Resource *)buffer, 0, map_type, 0, &map_desc);
+            ok(hr == S_OK, "Failed to map buffer, hr %#x.\n", hr);
+            memcpy((BYTE *)map_desc.pData + offset, quad, sizeof(quad));
+            ID3D11DeviceContext_Unmap(context, (ID3D11Resource *)buffer, 0);
+            ID3D11DeviceContext_Draw(context, ARRAY_SIZE(quad), offset / stride);
+        }
+        get_texture_color(test_context.backbuffer, 320, 240);
+        ring = GetTickCount() - start;
+
+        trace("%u KiB buffer: %u WRITE_DISCARD maps in %u ms, %u WRITE_NO_OVERWRITE maps in %u ms.\n",
+                sizes[i] / 1024, map_count, discard, map_count, ring);
+
+        ID3D11Buffer_Release(buffer);
+    }
+
+    release_test_context(&test_context);
+}
+
 START_TEST(d3d11)
 {
     unsigned int argc, i;
@@ -30630,7 +31185,13 @@ START_TEST(d3d11)
     queue_test(test_independent_blend);
     queue_test(test_dual_source_blend);
     queue_test(test_deferred_context_state);
+    queue_test(test_deferred_context_state_refcount);
+    queue_test(test_deferred_context_map);
+    queue_test(test_deferred_context_queries);
     queue_test(test_deferred_context_rendering);
+    queue_test(test_deferred_context_performance);
+    queue_test(test_dynamic_buffer_performance);
+    queue_test(test_shader_reuse_across_devices);
 
     run_queued_tests();
 }
@@ -26459,6 +26459,314 @@ static void test_draw_mapped_buffer(void)
     DestroyWindow(window);
 }
 
+static void test_dynamic_buffer_streaming(void)
+{
+    unsigned int i, j, offset, vertex_size;
+    IDirect3DVertexBuffer9 *vb;
+    IDirect3DDevice9 *device;
+    IDirect3D9 *d3d;
+    D3DCOLOR color;
+    ULONG refcount;
+    HWND window;
+    HRESULT hr;
+    BYTE *data;
+
+    static const UINT sizes[] = {0x1000, 0x200000};
+    static const struct
+    {
+        float left, top;
+        D3DCOLOR color;
+        unsigned int x, y;
+    }
+    quads[] =
+    {
+        {-1.0f, 1.0f, 0xffff0000, 160, 120},
+        { 0.0f, 1.0f, 0xff00ff00, 480, 120},
+        {-1.0f, 0.0f, 0xff0000ff, 160, 360},
+        { 0.0f, 0.0f, 0xffffff00, 480, 360},
+    };
+    struct
+    {
+        struct vec3 position;
+        DWORD diffuse;
+    }
+    quad[4];
+
+    window = create_window();
+    d3d = Direct3DCreate9(D3D_SDK_VERSION);
+    ok(!!d3d, "Failed to create a D3D object.\n");
+    if (!(device = create_device(d3d, window, window, TRUE)))
+    {
+        skip("Failed to create a D3D device, skipping tests.\n");
+        IDirect3D9_Release(d3d);
+        DestroyWindow(window);
+        return;
+    }
+
+    hr = IDirect3DDevice9_SetFVF(device, D3DFVF_XYZ | D3DFVF_DIFFUSE);
+    ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+    hr = IDirect3DDevice9_SetRenderState(device, D3DRS_LIGHTING, FALSE);
+    ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+    hr = IDirect3DDevice9_SetRenderState(device, D3DRS_ZENABLE, D3DZB_FALSE);
+    ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+    hr = IDirect3DDevice9_SetRenderState(device, D3DRS_CULLMODE, D3DCULL_NONE);
+    ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+
+    vertex_size = sizeof(quad[0]);
+    for (i = 0; i < ARRAY_SIZE(sizes); ++i)
+    {
+        hr = IDirect3DDevice9_CreateVertexBuffer(device, sizes[i], D3DUSAGE_DYNAMIC | D3DUSAGE_WRITEONLY,
+                D3DFVF_XYZ | D3DFVF_DIFFUSE, D3DPOOL_DEFAULT, &vb, NULL);
+        ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+        hr = IDirect3DDevice9_SetStreamSource(device, 0, vb, 0, vertex_size);
+        ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+
+        hr = IDirect3DDevice9_Clear(device, 0, NULL, D3DCLEAR_TARGET, 0xff000000, 1.0f, 0);
+        ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+        hr = IDirect3DDevice9_BeginScene(device);
+        ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+
+        /* Each quad is written by a different kind of map, to a different
+         * part of the buffer, and drawn before the next one is written:
+         * DISCARD, NOOVERWRITE with a range, NOOVERWRITE of the entire buffer,
+         * and nested NOOVERWRITE maps. */
+        for (j = 0; j < ARRAY_SIZE(quads); ++j)
+        {
+            quad[0].position.x = quad[1].position.x = quads[j].left;
+            quad[2].position.x = quad[3].position.x = quads[j].left + 1.0f;
+            quad[0].position.y = quad[2].position.y = quads[j].top - 1.0f;
+            quad[1].position.y = quad[3].position.y = quads[j].top;
+            quad[0].position.z = quad[1].position.z = quad[2].position.z = quad[3].position.z = 0.1f;
+            quad[0].diffuse = quad[1].diffuse = quad[2].diffuse = quad[3].diffuse = quads[j].color;
+
+            offset = j * (sizes[i] / ARRAY_SIZE(quads));
+            switch (j)
+            {
+                case 0:
+                    hr = IDirect3DVertexBuffer9_Lock(vb, 0, 0, (void **)&data, D3DLOCK_DISCARD);
+                    ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+                    memcpy(data + offset, quad, sizeof(quad));
+                    break;
+
+                case 1:
+                    hr = IDirect3DVertexBuffer9_Lock(vb, offset, sizeof(quad), (void **)&data, D3DLOCK_NOOVERWRITE);
+                    ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+                    memcpy(data, quad, sizeof(quad));
+                    break;
+
+                case 2:
+                    hr = IDirect3DVertexBuffer9_Lock(vb, 0, 0, (void **)&data, D3DLOCK_NOOVERWRITE);
+                    ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+                    memcpy(data + offset, quad, sizeof(quad));
+                    break;
+
+                case 3:
+                    hr = IDirect3DVertexBuffer9_Lock(vb, offset, vertex_size, (void **)&data, D3DLOCK_NOOVERWRITE);
+                    ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+                    memcpy(data, quad, vertex_size);
+                    hr = IDirect3DVertexBuffer9_Lock(vb, offset + vertex_size, sizeof(quad) - vertex_size,
+                            (void **)&data, D3DLOCK_NOOVERWRITE);
+                    ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+                    memcpy(data, &quad[1], sizeof(quad) - vertex_size);
+                    hr = IDirect3DVertexBuffer9_Unlock(vb);
+                    ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+                    break;
+            }
+            hr = IDirect3DVertexBuffer9_Unlock(vb);
+            ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+
+            hr = IDirect3DDevice9_DrawPrimitive(device, D3DPT_TRIANGLESTRIP, offset / vertex_size, 2);
+            ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+        }
+
+        hr = IDirect3DDevice9_EndScene(device);
+        ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+
+        for (j = 0; j < ARRAY_SIZE(quads); ++j)
+        {
+            color = getPixelColor(device, quads[j].x, quads[j].y);
+            ok(color_match(color, quads[j].color & 0x00ffffff, 1),
+                    "Got unexpected color 0x%08x, size %#x, quad %u.\n", color, sizes[i], j);
+        }
+
+        /* Draw everything again, to check that later maps didn't overwrite
+         * the data of the earlier draws. */
+        hr = IDirect3DDevice9_Clear(device, 0, NULL, D3DCLEAR_TARGET, 0xff000000, 1.0f, 0);
+        ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+        hr = IDirect3DDevice9_BeginScene(device);
+        ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+        for (j = 0; j < ARRAY_SIZE(quads); ++j)
+        {
+            offset = j * (sizes[i] / ARRAY_SIZE(quads));
+            hr = IDirect3DDevice9_DrawPrimitive(device, D3DPT_TRIANGLESTRIP, offset / vertex_size, 2);
+            ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+        }
+        hr = IDirect3DDevice9_EndScene(device);
+        ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+
+        for (j = 0; j < ARRAY_SIZE(quads); ++j)
+        {
+            color = getPixelColor(device, quads[j].x, quads[j].y);
+            ok(color_match(color, quads[j].color & 0x00ffffff, 1),
+                    "Got unexpected color 0x%08x, size %#x, quad %u.\n", color, sizes[i], j);
+        }
+
+        hr = IDirect3DDevice9_SetStreamSource(device, 0, NULL, 0, 0);
+        ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+        IDirect3DVertexBuffer9_Release(vb);
+    }
+
+    refcount = IDirect3DDevice9_Release(device);
+    ok(!refcount, "Device has %u references left.\n", refcount);
+    IDirect3D9_Release(d3d);
+    DestroyWindow(window);
+}
+
+static void write_streaming_quad(IDirect3DVertexBuffer9 *vb, unsigned int offset, DWORD flags,
+        float left, float top, D3DCOLOR color)
+{
+    struct
+    {
+        struct vec3 position;
+        DWORD diffuse;
+    }
+    quad[4];
+    HRESULT hr;
+    BYTE *data;
+
+    quad[0].position.x = quad[1].position.x = left;
+    quad[2].position.x = quad[3].position.x = left + 1.0f;
+    quad[0].position.y = quad[2].position.y = top - 1.0f;
+    quad[1].position.y = quad[3].position.y = top;
+    quad[0].position.z = quad[1].position.z = quad[2].position.z = quad[3].position.z = 0.1f;
+    quad[0].diffuse = quad[1].diffuse = quad[2].diffuse = quad[3].diffuse = color;
+
+    if (flags & D3DLOCK_DISCARD)
+    {
+        hr = IDirect3DVertexBuffer9_Lock(vb, 0, 0, (void **)&data, flags);
+        ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+        data += offset;
+    }
+    else
+    {
+        hr = IDirect3DVertexBuffer9_Lock(vb, offset, sizeof(quad), (void **)&data, flags);
+        ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+    }
+    memcpy(data, quad, sizeof(quad));
+    hr = IDirect3DVertexBuffer9_Unlock(vb);
+    ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+}
+
+/* DISCARD maps of dynamic buffers of various sizes, enough to exceed the
+ * memory Wine sets aside for streaming them, followed by a NOOVERWRITE map
+ * of the first buffer. */
+static void test_dynamic_buffer_pressure(void)
+{
+    IDirect3DVertexBuffer9 *vb, *small_vb;
+    unsigned int i, j, vertex_size;
+    IDirect3DDevice9 *device;
+    IDirect3D9 *d3d;
+    D3DCOLOR color;
+    ULONG refcount;
+    HWND window;
+    HRESULT hr;
+
+    static const UINT sizes[] = {0x100000, 0x200000, 0x1000000, 0x400000, 0x800000, 0x1000000, 0x300000};
+
+    window = create_window();
+    d3d = Direct3DCreate9(D3D_SDK_VERSION);
+    ok(!!d3d, "Failed to create a D3D object.\n");
+    if (!(device = create_device(d3d, window, window, TRUE)))
+    {
+        skip("Failed to create a D3D device, skipping tests.\n");
+        IDirect3D9_Release(d3d);
+        DestroyWindow(window);
+        return;
+    }
+
+    hr = IDirect3DDevice9_SetFVF(device, D3DFVF_XYZ | D3DFVF_DIFFUSE);
+    ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+    hr = IDirect3DDevice9_SetRenderState(device, D3DRS_LIGHTING, FALSE);
+    ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+    hr = IDirect3DDevice9_SetRenderState(device, D3DRS_ZENABLE, D3DZB_FALSE);
+    ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+    hr = IDirect3DDevice9_SetRenderState(device, D3DRS_CULLMODE, D3DCULL_NONE);
+    ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+
+    vertex_size = sizeof(struct vec3) + sizeof(DWORD);
+    hr = IDirect3DDevice9_CreateVertexBuffer(device, 0x1000, D3DUSAGE_DYNAMIC | D3DUSAGE_WRITEONLY,
+            D3DFVF_XYZ | D3DFVF_DIFFUSE, D3DPOOL_DEFAULT, &small_vb, NULL);
+    ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+
+    hr = IDirect3DDevice9_Clear(device, 0, NULL, D3DCLEAR_TARGET, 0xff000000, 1.0f, 0);
+    ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+    hr = IDirect3DDevice9_BeginScene(device);
+    ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+    write_streaming_quad(small_vb, 0, D3DLOCK_DISCARD, -1.0f, 1.0f, 0xffff0000);
+    hr = IDirect3DDevice9_SetStreamSource(device, 0, small_vb, 0, vertex_size);
+    ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+    hr = IDirect3DDevice9_DrawPrimitive(device, D3DPT_TRIANGLESTRIP, 0, 2);
+    ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+    hr = IDirect3DDevice9_EndScene(device);
+    ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+
+    for (i = 0; i < ARRAY_SIZE(sizes); ++i)
+    {
+        hr = IDirect3DDevice9_CreateVertexBuffer(device, sizes[i], D3DUSAGE_DYNAMIC | D3DUSAGE_WRITEONLY,
+                D3DFVF_XYZ | D3DFVF_DIFFUSE, D3DPOOL_DEFAULT, &vb, NULL);
+        ok(hr == D3D_OK, "Got unexpected hr %#x, size %#x.\n", hr, sizes[i]);
+        hr = IDirect3DDevice9_SetStreamSource(device, 0, vb, 0, vertex_size);
+        ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+
+        hr = IDirect3DDevice9_BeginScene(device);
+        ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+        for (j = 0; j < 4; ++j)
+        {
+            write_streaming_quad(vb, sizes[i] - 4 * vertex_size, D3DLOCK_DISCARD, 0.0f, 0.0f, 0xff0000ff);
+            hr = IDirect3DDevice9_DrawPrimitive(device, D3DPT_TRIANGLESTRIP, sizes[i] / vertex_size - 4, 2);
+            ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+        }
+        hr = IDirect3DDevice9_EndScene(device);
+        ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+
+        /* Reading back waits for the uploads, so that their memory can be
+         * reused by the next buffer. */
+        color = getPixelColor(device, 480, 360);
+        ok(color_match(color, 0x000000ff, 1), "Got unexpected color 0x%08x, size %#x.\n", color, sizes[i]);
+
+        hr = IDirect3DDevice9_SetStreamSource(device, 0, NULL, 0, 0);
+        ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+        IDirect3DVertexBuffer9_Release(vb);
+    }
+
+    hr = IDirect3DDevice9_SetStreamSource(device, 0, small_vb, 0, vertex_size);
+    ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+    hr = IDirect3DDevice9_Clear(device, 0, NULL, D3DCLEAR_TARGET, 0xff000000, 1.0f, 0);
+    ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+    hr = IDirect3DDevice9_BeginScene(device);
+    ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+    write_streaming_quad(small_vb, 4 * vertex_size, D3DLOCK_NOOVERWRITE, 0.0f, 1.0f, 0xff00ff00);
+    hr = IDirect3DDevice9_DrawPrimitive(device, D3DPT_TRIANGLESTRIP, 0, 2);
+    ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+    hr = IDirect3DDevice9_DrawPrimitive(device, D3DPT_TRIANGLESTRIP, 4, 2);
+    ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+    hr = IDirect3DDevice9_EndScene(device);
+    ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+
+    color = getPixelColor(device, 160, 120);
+    ok(color_match(color, 0x00ff0000, 1), "Got unexpected color 0x%08x.\n", color);
+    color = getPixelColor(device, 480, 120);
+    ok(color_match(color, 0x0000ff00, 1), "Got unexpected color 0x%08x.\n", color);
+
+    hr = IDirect3DDevice9_SetStreamSource(device, 0, NULL, 0, 0);
+    ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+    IDirect3DVertexBuffer9_Release(small_vb);
+    refcount = IDirect3DDevice9_Release(device);
+    ok(!refcount, "Device has %u references left.\n", refcount);
+    IDirect3D9_Release(d3d);
+    DestroyWindow(window);
+}
+
 static void test_sample_attached_rendertarget(void)
 {
     D3DADAPTER_IDENTIFIER9 identifier;
@@ -27057,6 +27365,8 @@ START_TEST(visual)
     test_desktop_window();
     test_mismatched_sample_types();
     test_draw_mapped_buffer();
+    test_dynamic_buffer_streaming();
+    test_dynamic_buffer_pressure();
     test_sample_attached_rendertarget();
     test_alpha_to_coverage();
     test_sample_mask();
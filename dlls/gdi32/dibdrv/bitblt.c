@@ -581,20 +581,149 @@ static void mask_rect( dib_info *dst, const RECT *dst_rect, const dib_info *src,
     }
 }
 
+/* Large blend, stretch and gradient operations can optionally be split into
+ * bands of rows that are rendered in parallel on the thread pool.  This is
+ * enabled by setting WINE_GDI_THREADS to the number of threads to use. */
+
+#define BAND_MIN_PIXELS  (256 * 1024)  /* smaller operations are not worth splitting */
+#define BAND_MIN_ROWS    16
+#define BAND_MAX_THREADS 64
+
+struct band_job
+{
+    void        (*func)( struct band_job *job, unsigned int band );
+    unsigned int  count;
+    LONG          next;
+};
+
+/* the variable is looked up again for each large operation, which is cheap next to
+ * the operation itself and lets it be changed at run time */
+static unsigned int get_band_threads(void)
+{
+    WCHAR buffer[16];
+    LONG threads = 0;
+
+    if (GetEnvironmentVariableW( L"WINE_GDI_THREADS", buffer, ARRAY_SIZE(buffer) ) - 1 < ARRAY_SIZE(buffer) - 1)
+        threads = max( 0, min( BAND_MAX_THREADS, wcstol( buffer, NULL, 10 )));
+    return threads;
+}
+
+/* number of bands to use for an operation on width x height pixels, 1 if it shouldn't be split */
+static unsigned int get_band_count( int width, int height )
+{
+    unsigned int threads;
+
+    if ((LONGLONG)width * height < BAND_MIN_PIXELS) return 1;
+    if ((threads = get_band_threads()) <= 1) return 1;
+    TRACE( "using %u threads for %dx%d operation\n", threads, width, height );
+    /* use a few bands per thread so that uneven bands still balance out */
+    return max( 1, min( threads * 4, height / BAND_MIN_ROWS ));
+}
+
+static void run_bands( struct band_job *job )
+{
+    unsigned int band;
+
+    while ((band = InterlockedIncrement( &job->next ) - 1) < job->count) job->func( job, band );
+}
+
+static void CALLBACK band_work_proc( TP_CALLBACK_INSTANCE *instance, void *context, TP_WORK *work )
+{
+    run_bands( context );
+}
+
+static void process_bands( struct band_job *job )
+{
+    unsigned int i, threads = min( get_band_threads(), job->count );
+    TP_WORK *work = NULL;
+
+    job->next = 0;
+    if (threads > 1 && (work = CreateThreadpoolWork( band_work_proc, job, NULL )))
+        for (i = 1; i < threads; i++) SubmitThreadpoolWork( work );
+
+    /* the calling thread takes part as well */
+    run_bands( job );
+
+    if (work)
+    {
+        /* callbacks that haven't started yet have nothing left to do */
+        WaitForThreadpoolWorkCallbacks( work, TRUE );
+        CloseThreadpoolWork( work );
+    }
+}
+
+struct rect_band_job
+{
+    struct band_job job;
+    RECT            rect;
+    int             rows;
+    void          (*func)( struct rect_band_job *job, const RECT *rect );
+};
+
+static void rect_band_proc( struct band_job *job, unsigned int band )
+{
+    struct rect_band_job *rect_job = CONTAINING_RECORD( job, struct rect_band_job, job );
+    RECT rc = rect_job->rect;
+
+    rc.top += band * rect_job->rows;
+    rc.bottom = min( rc.bottom, rc.top + rect_job->rows );
+    rect_job->func( rect_job, &rc );
+}
+
+/* call job->func on rect, or on row bands of it in parallel if it's large enough */
+static void process_rect_bands( struct rect_band_job *job, const RECT *rect )
+{
+    int height = rect->bottom - rect->top;
+    unsigned int count = get_band_count( rect->right - rect->left, height );
+
+    if (count <= 1)
+    {
+        job->func( job, rect );
+        return;
+    }
+    job->rect = *rect;
+    job->rows = (height + count - 1) / count;
+    job->job.func = rect_band_proc;
+    job->job.count = (height + job->rows - 1) / job->rows;
+    process_bands( &job->job );
+}
+
+struct blend_job
+{
+    struct rect_band_job band;
+    dib_info            *dst;
+    const RECT          *dst_rect;
+    const dib_info      *src;
+    const RECT          *src_rect;
+    BLENDFUNCTION        blend;
+};
+
+static void blend_band( struct rect_band_job *band, const RECT *rect )
+{
+    struct blend_job *job = CONTAINING_RECORD( band, struct blend_job, band );
+    POINT origin;
+
+    origin.x = job->src_rect->left + rect->left - job->dst_rect->left;
+    origin.y = job->src_rect->top  + rect->top  - job->dst_rect->top;
+    job->dst->funcs->blend_rect( job->dst, rect, job->src, &origin, job->blend );
+}
+
 static DWORD blend_rect( dib_info *dst, const RECT *dst_rect, const dib_info *src, const RECT *src_rect,
                          HRGN clip, BLENDFUNCTION blend )
 {
-    POINT origin;
+    struct blend_job job;
     struct clipped_rects clipped_rects;
     int i;
 
     if (!get_clipped_rects( dst, dst_rect, clip, &clipped_rects )) return ERROR_SUCCESS;
+    job.band.func = blend_band;
+    job.dst       = dst;
+    job.dst_rect  = dst_rect;
+    job.src       = src;
+    job.src_rect  = src_rect;
+    job.blend     = blend;
     for (i = 0; i < clipped_rects.count; i++)
-    {
-        origin.x = src_rect->left + clipped_rects.rects[i].left - dst_rect->left;
-        origin.y = src_rect->top  + clipped_rects.rects[i].top  - dst_rect->top;
-        dst->funcs->blend_rect( dst, &clipped_rects.rects[i], src, &origin, blend );
-    }
+        process_rect_bands( &job.band, &clipped_rects.rects[i] );
     free_clipped_rects( &clipped_rects );
     return ERROR_SUCCESS;
 }
@@ -678,19 +807,38 @@ static void get_gradient_triangle_vertices( const GRADIENT_TRIANGLE *tri, const
     bounds->bottom = v[2].y;
 }
 
+struct gradient_job
+{
+    struct rect_band_job band;
+    dib_info            *dib;
+    const TRIVERTEX     *v;
+    int                  mode;
+    BOOL                 ret;
+};
+
+static void gradient_band( struct rect_band_job *band, const RECT *rect )
+{
+    struct gradient_job *job = CONTAINING_RECORD( band, struct gradient_job, band );
+
+    if (!job->dib->funcs->gradient_rect( job->dib, rect, job->v, job->mode )) job->ret = FALSE;
+}
+
 static BOOL gradient_rect( dib_info *dib, TRIVERTEX *v, int mode, HRGN clip, const RECT *bounds )
 {
     int i;
     struct clipped_rects clipped_rects;
-    BOOL ret = TRUE;
+    struct gradient_job job;
 
     if (!get_clipped_rects( dib, bounds, clip, &clipped_rects )) return TRUE;
-    for (i = 0; i < clipped_rects.count; i++)
-    {
-        if (!(ret = dib->funcs->gradient_rect( dib, &clipped_rects.rects[i], v, mode ))) break;
-    }
+    job.band.func = gradient_band;
+    job.dib       = dib;
+    job.v         = v;
+    job.mode      = mode;
+    job.ret       = TRUE;
+    for (i = 0; i < clipped_rects.count && job.ret; i++)
+        process_rect_bands( &job.band, &clipped_rects.rects[i] );
     free_clipped_rects( &clipped_rects );
-    return ret;
+    return job.ret;
 }
 
 static DWORD copy_src_bits( dib_info *src, RECT *src_rect )
@@ -1196,6 +1344,145 @@ static DWORD calc_1d_stretch_params( INT dst_start, INT dst_length, INT dst_vis_
 }
 
 
+enum stretch_row_op
+{
+    STRETCH_ROW_NEW,    /* render a new destination row */
+    STRETCH_ROW_MERGE,  /* merge a source row into the current destination row */
+    STRETCH_ROW_COPY    /* duplicate the previous destination row */
+};
+
+struct stretch_row
+{
+    int dst_y;
+    int src_y;
+    int op;
+};
+
+struct stretch_job
+{
+    struct band_job              job;
+    dib_info                    *dst_dib;
+    const dib_info              *src_dib;
+    int                          dst_x;
+    int                          src_x;
+    int                          width;
+    const struct stretch_params *h_params;
+    int                          dst_inc;
+    int                          mode;
+    void                       (*row_fn)(const dib_info *dst_dib, const POINT *dst_start,
+                                         const dib_info *src_dib, const POINT *src_start,
+                                         const struct stretch_params *params, int mode, BOOL keep_dst);
+    const struct stretch_row    *rows;
+    unsigned int                *band_start;  /* index of the first row of each band */
+};
+
+static void stretch_band( struct band_job *band, unsigned int index )
+{
+    struct stretch_job *job = CONTAINING_RECORD( band, struct stretch_job, job );
+    POINT dst_start, src_start;
+    RECT last_row, this_row;
+    unsigned int i;
+
+    dst_start.x = job->dst_x;
+    src_start.x = job->src_x;
+    last_row.left = 0;
+    last_row.right = job->width;
+
+    for (i = job->band_start[index]; i < job->band_start[index + 1]; i++)
+    {
+        if (job->rows[i].op == STRETCH_ROW_COPY)
+        {
+            last_row.top = job->rows[i].dst_y - job->dst_inc;
+            last_row.bottom = last_row.top + 1;
+            this_row = last_row;
+            offset_rect( &this_row, 0, job->dst_inc );
+            copy_rect( job->dst_dib, &this_row, job->dst_dib, &last_row, NULL, R2_COPYPEN );
+        }
+        else
+        {
+            dst_start.y = job->rows[i].dst_y;
+            src_start.y = job->rows[i].src_y;
+            job->row_fn( job->dst_dib, &dst_start, job->src_dib, &src_start, job->h_params, job->mode,
+                         job->rows[i].op == STRETCH_ROW_MERGE );
+        }
+    }
+}
+
+/* same as the row loops in stretch_bitmapinfo, but the rows are first collected and then
+ * rendered in parallel bands, each starting on a row that doesn't depend on the previous ones */
+static BOOL stretch_bands( struct stretch_job *job, POINT dst_start, POINT src_start,
+                           struct stretch_params v_params, int err, BOOL vstretch, unsigned int count )
+{
+    struct stretch_row *rows;
+    unsigned int i, n = 0, band, per_band;
+    int merged_rows = 0;
+    BOOL need_row = TRUE;
+
+    if (!(rows = HeapAlloc( GetProcessHeap(), 0, v_params.length * sizeof(*rows) ))) return FALSE;
+    if (!(job->band_start = HeapAlloc( GetProcessHeap(), 0, (count + 1) * sizeof(*job->band_start) )))
+    {
+        HeapFree( GetProcessHeap(), 0, rows );
+        return FALSE;
+    }
+
+    while (v_params.length--)
+    {
+        if (vstretch)
+        {
+            rows[n].op = need_row ? STRETCH_ROW_NEW : STRETCH_ROW_COPY;
+            rows[n].dst_y = dst_start.y;
+            rows[n++].src_y = src_start.y;
+            need_row = FALSE;
+
+            if (err > 0)
+            {
+                src_start.y += v_params.src_inc;
+                need_row = TRUE;
+                err += v_params.err_add_1;
+            }
+            else err += v_params.err_add_2;
+            dst_start.y += v_params.dst_inc;
+        }
+        else
+        {
+            if (job->mode != STRETCH_DELETESCANS || !merged_rows)
+            {
+                rows[n].op = merged_rows ? STRETCH_ROW_MERGE : STRETCH_ROW_NEW;
+                rows[n].dst_y = dst_start.y;
+                rows[n++].src_y = src_start.y;
+            }
+            merged_rows++;
+
+            if (err > 0)
+            {
+                dst_start.y += v_params.dst_inc;
+                merged_rows = 0;
+                err += v_params.err_add_1;
+            }
+            else err += v_params.err_add_2;
+            src_start.y += v_params.src_inc;
+        }
+    }
+
+    per_band = (n + count - 1) / count;
+    job->band_start[0] = 0;
+    for (band = 0; job->band_start[band] < n; band++)
+    {
+        i = min( n, job->band_start[band] + per_band );
+        while (i < n && rows[i].op != STRETCH_ROW_NEW) i++;
+        job->band_start[band + 1] = i;
+    }
+
+    job->job.func = stretch_band;
+    job->job.count = band;
+    job->rows = rows;
+    process_bands( &job->job );
+
+    HeapFree( GetProcessHeap(), 0, job->band_start );
+    HeapFree( GetProcessHeap(), 0, rows );
+    return TRUE;
+}
+
 DWORD stretch_bitmapinfo( const BITMAPINFO *src_info, void *src_bits, struct bitblt_coords *src,
                           const BITMAPINFO *dst_info, void *dst_bits, struct bitblt_coords *dst,
                           INT mode )
@@ -1205,6 +1492,7 @@ DWORD stretch_bitmapinfo( const BITMAPINFO *src_info, void *src_bits, struct bit
     RECT rect;
     BOOL hstretch, vstretch;
     struct stretch_params v_params, h_params;
+    unsigned int count;
     int err;
     DWORD ret;
     void (* row_fn)(const dib_info *dst_dib, const POINT *dst_start,
@@ -1246,12 +1534,29 @@ DWORD stretch_bitmapinfo( const BITMAPINFO *src_info, void *src_bits, struct bit
     err = v_params.err_start;
 
     row_fn = hstretch ? dst_dib.funcs->stretch_row : dst_dib.funcs->shrink_row;
+    if (vstretch && hstretch) mode = STRETCH_DELETESCANS;
+
+    if ((count = get_band_count( dst->visrect.right - dst->visrect.left,
+                                 dst->visrect.bottom - dst->visrect.top )) > 1)
+    {
+        struct stretch_job job;
+
+        job.dst_dib  = &dst_dib;
+        job.src_dib  = &src_dib;
+        job.dst_x    = dst_start.x;
+        job.src_x    = src_start.x;
+        job.width    = dst->visrect.right - dst->visrect.left;
+        job.h_params = &h_params;
+        job.dst_inc  = v_params.dst_inc;
+        job.mode     = mode;
+        job.row_fn   = row_fn;
+        if (stretch_bands( &job, dst_start, src_start, v_params, err, vstretch, count )) goto done;
+    }
 
     if (vstretch)
     {
         BOOL need_row = TRUE;
         RECT last_row, this_row;
-        if (hstretch) mode = STRETCH_DELETESCANS;
         last_row.left = 0;
         last_row.right = dst->visrect.right - dst->visrect.left;
 
@@ -1302,6 +1607,7 @@ DWORD stretch_bitmapinfo( const BITMAPINFO *src_info, void *src_bits, struct bit
         }
     }
 
+done:
     /* update coordinates, the destination rectangle is always stored at 0,0 */
     *src = *dst;
     src->x -= src->visrect.left;
@@ -213,8 +213,8 @@ typedef struct primitive_funcs
                                     const struct stretch_params *params, int mode, BOOL keep_dst);
 } primitive_funcs;
 
-extern const primitive_funcs funcs_8888 DECLSPEC_HIDDEN;
-extern const primitive_funcs funcs_32   DECLSPEC_HIDDEN;
+extern primitive_funcs funcs_8888 DECLSPEC_HIDDEN;
+extern primitive_funcs funcs_32   DECLSPEC_HIDDEN;
 extern const primitive_funcs funcs_24   DECLSPEC_HIDDEN;
 extern const primitive_funcs funcs_555  DECLSPEC_HIDDEN;
 extern const primitive_funcs funcs_16   DECLSPEC_HIDDEN;
@@ -41,6 +41,7 @@ enum glyph_type
 
 #define GLYPH_CACHE_PAGE_SIZE  0x100
 #define GLYPH_CACHE_PAGES      (0x10000 / GLYPH_CACHE_PAGE_SIZE)
+#define GLYPH_CACHE_MAX_SIZE   (16 * 1024 * 1024)  /* selected fonts count too, unused ones are evicted beyond that */
 
 struct cached_font
 {
@@ -50,10 +51,13 @@ struct cached_font
     LOGFONTW              lf;
     XFORM                 xform;
     UINT                  aa_flags;
+    ULONGLONG             glyph_id;  /* key in the shared glyph cache, 0 if not shared */
+    LONG                  size;      /* total size of the cached glyphs */
     struct cached_glyph **glyphs[GLYPH_NBTYPES][GLYPH_CACHE_PAGES];
 };
 
 static struct list font_cache = LIST_INIT( font_cache );
+static LONG font_cache_size;  /* total size of the glyphs of all cached fonts */
 
 static CRITICAL_SECTION font_cache_cs;
 static CRITICAL_SECTION_DEBUG critsect_debug =
@@ -553,10 +557,46 @@ static int font_cache_cmp( const struct cached_font *p1, const struct cached_fon
     return ret;
 }
 
+static void free_cached_glyphs( struct cached_font *font )
+{
+    UINT i, j, k;
+
+    for (i = 0; i < GLYPH_NBTYPES; i++)
+    {
+        for (j = 0; j < GLYPH_CACHE_PAGES; j++)
+        {
+            if (!font->glyphs[i][j]) continue;
+            for (k = 0; k < GLYPH_CACHE_PAGE_SIZE; k++)
+                HeapFree( GetProcessHeap(), 0, font->glyphs[i][j][k] );
+            HeapFree( GetProcessHeap(), 0, font->glyphs[i][j] );
+        }
+    }
+    InterlockedExchangeAdd( &font_cache_size, -font->size );
+}
+
+/* evict the least recently used unused fonts while all the cached glyphs, including
+ * those of selected fonts, take too much memory; called with font_cache_cs held */
+static void evict_cached_fonts(void)
+{
+    struct cached_font *font, *next;
+
+    LIST_FOR_EACH_ENTRY_SAFE_REV( font, next, &font_cache, struct cached_font, entry )
+    {
+        if (font_cache_size <= GLYPH_CACHE_MAX_SIZE) break;
+        if (font->ref) continue;
+        TRACE( "evicting %p, %u bytes\n", font, font->size );
+        free_cached_glyphs( font );
+        list_remove( &font->entry );
+        HeapFree( GetProcessHeap(), 0, font );
+    }
+}
+
+static BOOL use_shared_glyph_cache(void);
+
 static struct cached_font *add_cached_font( DC *dc, HFONT hfont, UINT aa_flags )
 {
     struct cached_font font, *ptr, *last_unused = NULL;
-    UINT i = 0, j, k;
+    UINT i = 0;
 
     GetObjectW( hfont, sizeof(font.lf), &font.lf );
     font.xform = dc->xformWorld2Vport;
@@ -570,6 +610,8 @@ static struct cached_font *add_cached_font( DC *dc, HFONT hfont, UINT aa_flags )
     font.lf.lfWidth = abs( font.lf.lfWidth );
     font.aa_flags = aa_flags;
     font.hash = font_cache_hash( &font );
+    font.glyph_id = use_shared_glyph_cache() ? get_font_glyph_id( dc ) : 0;
+    if (font.glyph_id) font.glyph_id ^= (ULONGLONG)font.hash << 32 | aa_flags;
 
     EnterCriticalSection( &font_cache_cs );
     LIST_FOR_EACH_ENTRY( ptr, &font_cache, struct cached_font, entry )
@@ -590,16 +632,7 @@ static struct cached_font *add_cached_font( DC *dc, HFONT hfont, UINT aa_flags )
     if (i > 5)  /* keep at least 5 of the most-recently used fonts around */
     {
         ptr = last_unused;
-        for (i = 0; i < GLYPH_NBTYPES; i++)
-        {
-            for (j = 0; j < GLYPH_CACHE_PAGES; j++)
-            {
-                if (!ptr->glyphs[i][j]) continue;
-                for (k = 0; k < GLYPH_CACHE_PAGE_SIZE; k++)
-                    HeapFree( GetProcessHeap(), 0, ptr->glyphs[i][j][k] );
-                HeapFree( GetProcessHeap(), 0, ptr->glyphs[i][j] );
-            }
-        }
+        free_cached_glyphs( ptr );
         list_remove( &ptr->entry );
     }
     else if (!(ptr = HeapAlloc( GetProcessHeap(), 0, sizeof(*ptr) )))
@@ -610,9 +643,12 @@ static struct cached_font *add_cached_font( DC *dc, HFONT hfont, UINT aa_flags )
 
     *ptr = font;
     ptr->ref = 1;
+    ptr->size = 0;
     memset( ptr->glyphs, 0, sizeof(ptr->glyphs) );
 done:
     list_add_head( &font_cache, &ptr->entry );
+
+    evict_cached_fonts();
     LeaveCriticalSection( &font_cache_cs );
     TRACE( "%d %s -> %p\n", ptr->lf.lfHeight, debugstr_w(ptr->lf.lfFaceName), ptr );
     return ptr;
@@ -620,11 +656,16 @@ done:
 
 void release_cached_font( struct cached_font *font )
 {
-    if (font) InterlockedDecrement( &font->ref );
+    if (!font || InterlockedDecrement( &font->ref ) || font_cache_size <= GLYPH_CACHE_MAX_SIZE) return;
+
+    /* the font was kept while it was selected even though the cache is full */
+    EnterCriticalSection( &font_cache_cs );
+    evict_cached_fonts();
+    LeaveCriticalSection( &font_cache_cs );
 }
 
 static struct cached_glyph *add_cached_glyph( struct cached_font *font, UINT index, UINT flags,
-                                              struct cached_glyph *glyph )
+                                              struct cached_glyph *glyph, UINT size )
 {
     struct cached_glyph *ret;
     enum glyph_type type = (flags & ETO_GLYPH_INDEX) ? GLYPH_INDEX : GLYPH_WCHAR;
@@ -645,7 +686,18 @@ static struct cached_glyph *add_cached_glyph( struct cached_font *font, UINT ind
             HeapFree( GetProcessHeap(), 0, ptr );
     }
     ret = InterlockedCompareExchangePointer( (void **)&font->glyphs[type][page][entry], glyph, NULL );
-    if (!ret) ret = glyph;
+    if (!ret)
+    {
+        InterlockedExchangeAdd( &font->size, size );
+        /* glyphs of selected fonts make room by evicting the unused ones */
+        if (InterlockedExchangeAdd( &font_cache_size, size ) + size > GLYPH_CACHE_MAX_SIZE)
+        {
+            EnterCriticalSection( &font_cache_cs );
+            evict_cached_fonts();
+            LeaveCriticalSection( &font_cache_cs );
+        }
+        ret = glyph;
+    }
     else HeapFree( GetProcessHeap(), 0, glyph );
     return ret;
 }
@@ -736,6 +788,209 @@ static int get_glyph_depth( UINT aa_flags )
 static const BYTE masks[8] = {0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01};
 static const int padding[4] = {0, 3, 2, 1};
 
+/* Rasterized glyphs can also be shared with other processes through a named
+ * mapping, enabled by setting WINE_SHARED_GLYPH_CACHE to its size in megabytes.
+ * Glyphs are appended to a ring buffer, so the oldest ones get overwritten
+ * first, and are indexed by a set associative table of slots.  Writers are
+ * serialized by a mutex, readers don't lock but check that the slot and the
+ * glyph data didn't change while they were copying it. */
+
+#define SHARED_GLYPH_MAGIC     0x48504c47  /* 'GLPH' */
+#define SHARED_GLYPH_WAYS      4
+#define SHARED_GLYPH_SET_BYTES 512         /* one set of slots per 512 bytes of glyph data */
+
+/* the slots are read without the mutex, so all their fields are volatile */
+struct shared_glyph_slot
+{
+    volatile LONG      seq;       /* odd while the slot is being modified */
+    volatile UINT      key;       /* glyph index or character, with the type in the high bit */
+    volatile UINT      pos;       /* position of the glyph in the data ring, modulo 2^32 */
+    volatile LONG      size;      /* size of the glyph, 0 if the slot is unused */
+    volatile ULONGLONG font_id;
+};
+
+struct shared_glyph_header
+{
+    UINT                     magic;
+    UINT                     set_count;    /* power of 2 */
+    UINT                     data_offset;  /* offset of the data ring from the start of the header */
+    UINT                     data_size;    /* power of 2 */
+    volatile UINT            head;         /* position where the next glyph will be written */
+    volatile LONG            hits;         /* number of glyphs found in the cache, used by the tests */
+    struct shared_glyph_slot slots[1];
+};
+
+static struct shared_glyph_header *shared_glyphs;
+static HANDLE shared_glyphs_mutex;
+static INIT_ONCE shared_glyphs_once = INIT_ONCE_STATIC_INIT;
+
+static BOOL CALLBACK init_shared_glyph_cache( INIT_ONCE *once, void *param, void **context )
+{
+    struct shared_glyph_header *header;
+    MEMORY_BASIC_INFORMATION info;
+    WCHAR buffer[16];
+    HANDLE mapping;
+    UINT data_size, set_count, data_offset;
+    int mb;
+
+    if (GetEnvironmentVariableW( L"WINE_SHARED_GLYPH_CACHE", buffer, ARRAY_SIZE(buffer) ) - 1 >= ARRAY_SIZE(buffer) - 1)
+        return TRUE;
+    if ((mb = wcstol( buffer, NULL, 10 )) <= 0) return TRUE;
+
+    for (data_size = 1 << 20; data_size < (1 << 28) && (data_size >> 20) < mb; data_size <<= 1) ;
+    set_count = data_size / SHARED_GLYPH_SET_BYTES;
+    data_offset = (FIELD_OFFSET( struct shared_glyph_header, slots[set_count * SHARED_GLYPH_WAYS] ) + 63) & ~63;
+
+    if (!(shared_glyphs_mutex = CreateMutexW( NULL, FALSE, L"__wine_shared_glyph_cache_mutex" ))) return TRUE;
+    if (!(mapping = CreateFileMappingW( INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, 0,
+                                        data_offset + data_size, L"__wine_shared_glyph_cache" )))
+        goto failed;
+    header = MapViewOfFile( mapping, FILE_MAP_ALL_ACCESS, 0, 0, 0 );
+    CloseHandle( mapping );
+    if (!header) goto failed;
+
+    /* another process may have created it with a different size */
+    VirtualQuery( header, &info, sizeof(info) );
+    WaitForSingleObject( shared_glyphs_mutex, INFINITE );
+    if (header->magic != SHARED_GLYPH_MAGIC)
+    {
+        header->set_count   = set_count;
+        header->data_offset = data_offset;
+        header->data_size   = data_size;
+        header->head        = 0;
+        header->hits        = 0;
+        header->magic       = SHARED_GLYPH_MAGIC;
+    }
+    ReleaseMutex( shared_glyphs_mutex );
+
+    if ((header->set_count & (header->set_count - 1)) || (header->data_size & (header->data_size - 1)) ||
+        header->data_offset < FIELD_OFFSET( struct shared_glyph_header, slots[header->set_count * SHARED_GLYPH_WAYS] ) ||
+        (SIZE_T)header->data_offset + header->data_size > info.RegionSize)
+    {
+        ERR( "invalid shared glyph cache\n" );
+        UnmapViewOfFile( header );
+        goto failed;
+    }
+    TRACE( "using %u bytes of shared glyph cache\n", header->data_size );
+    shared_glyphs = header;
+    return TRUE;
+
+failed:
+    CloseHandle( shared_glyphs_mutex );
+    shared_glyphs_mutex = 0;
+    return TRUE;
+}
+
+static BOOL use_shared_glyph_cache(void)
+{
+    InitOnceExecuteOnce( &shared_glyphs_once, init_shared_glyph_cache, NULL, NULL );
+    return shared_glyphs != NULL;
+}
+
+static inline UINT shared_glyph_key( UINT index, UINT flags )
+{
+    return (index & 0xffff) | ((flags & ETO_GLYPH_INDEX) ? 0x80000000 : 0);
+}
+
+static inline struct shared_glyph_slot *get_shared_glyph_set( ULONGLONG font_id, UINT key )
+{
+    UINT set = ((UINT)font_id ^ (UINT)(font_id >> 32) ^ key * 0x9e3779b1) & (shared_glyphs->set_count - 1);
+    return shared_glyphs->slots + set * SHARED_GLYPH_WAYS;
+}
+
+/* largest glyph stored in the data ring, so that a single huge glyph doesn't flush the cache */
+static inline UINT shared_glyph_max_size( UINT data_size )
+{
+    return data_size / 16;
+}
+
+/* check that a glyph is contained in the data ring and hasn't been overwritten yet */
+static inline BOOL shared_glyph_valid( UINT pos, UINT size, UINT data_size )
+{
+    return size <= shared_glyph_max_size( data_size ) && pos % data_size + size <= data_size &&
+           shared_glyphs->head - pos <= data_size;
+}
+
+static struct cached_glyph *get_shared_glyph( struct cached_font *font, UINT index, UINT flags, DWORD *ret_size )
+{
+    UINT key = shared_glyph_key( index, flags ), pos, size, expect, data_size = shared_glyphs->data_size;
+    struct shared_glyph_slot *slot;
+    struct cached_glyph *glyph;
+    LONG seq;
+    int i;
+
+    if (!font->glyph_id) return NULL;
+
+    slot = get_shared_glyph_set( font->glyph_id, key );
+    for (i = 0; i < SHARED_GLYPH_WAYS; i++, slot++)
+    {
+        if ((seq = slot->seq) & 1) continue;
+        __atomic_thread_fence( __ATOMIC_ACQUIRE );
+        if (slot->key != key || slot->font_id != font->glyph_id || !(size = slot->size)) continue;
+        pos = slot->pos;
+        /* the slot may be torn, validate the position and size before copying anything */
+        if (size < FIELD_OFFSET( struct cached_glyph, bits ) || !shared_glyph_valid( pos, size, data_size )) continue;
+
+        if (!(glyph = HeapAlloc( GetProcessHeap(), 0, size ))) return NULL;
+        memcpy( glyph, (char *)shared_glyphs + shared_glyphs->data_offset + pos % data_size, size );
+        __atomic_thread_fence( __ATOMIC_ACQUIRE );
+        expect = get_dib_stride( glyph->metrics.gmBlackBoxX, get_glyph_depth( font->aa_flags ) ) *
+                 glyph->metrics.gmBlackBoxY;
+        if (slot->seq != seq || !shared_glyph_valid( pos, size, data_size ) ||
+            FIELD_OFFSET( struct cached_glyph, bits[expect] ) != size)
+        {
+            HeapFree( GetProcessHeap(), 0, glyph );
+            return NULL;
+        }
+        InterlockedIncrement( &shared_glyphs->hits );
+        *ret_size = size;
+        return glyph;
+    }
+    return NULL;
+}
+
+static void put_shared_glyph( struct cached_font *font, UINT index, UINT flags,
+                              const struct cached_glyph *glyph, UINT size )
+{
+    UINT key = shared_glyph_key( index, flags ), pos, len = (size + 7) & ~7, data_size;
+    struct shared_glyph_slot *slot, *victim = NULL;
+    int i;
+
+    if (!font->glyph_id) return;
+
+    data_size = shared_glyphs->data_size;
+    if (len > shared_glyph_max_size( data_size )) return;
+
+    WaitForSingleObject( shared_glyphs_mutex, INFINITE );
+
+    /* reserve space in the ring first, so that readers notice the data being overwritten */
+    pos = shared_glyphs->head;
+    if (pos % data_size + len > data_size) pos += data_size - pos % data_size;
+    shared_glyphs->head = pos + len;
+    __atomic_thread_fence( __ATOMIC_SEQ_CST );
+    memcpy( (char *)shared_glyphs + shared_glyphs->data_offset + pos % data_size, glyph, size );
+
+    /* replace the same glyph, an unused slot or else the oldest one */
+    slot = get_shared_glyph_set( font->glyph_id, key );
+    for (i = 0; i < SHARED_GLYPH_WAYS && !victim; i++)
+        if (slot[i].key == key && slot[i].font_id == font->glyph_id) victim = &slot[i];
+    for (i = 0; i < SHARED_GLYPH_WAYS && !victim; i++)
+        if (!slot[i].size) victim = &slot[i];
+    if (!victim)
+        for (victim = slot, i = 1; i < SHARED_GLYPH_WAYS; i++)
+            if (pos - slot[i].pos > pos - victim->pos) victim = &slot[i];
+
+    InterlockedIncrement( &victim->seq );
+    InterlockedExchange( &victim->size, 0 );
+    victim->key     = key;
+    victim->font_id = font->glyph_id;
+    victim->pos     = pos;
+    InterlockedExchange( &victim->size, size );
+    InterlockedIncrement( &victim->seq );
+
+    ReleaseMutex( shared_glyphs_mutex );
+}
+
 /***********************************************************************
  *         cache_glyph_bitmap
  *
@@ -756,6 +1011,9 @@ static struct cached_glyph *cache_glyph_bitmap( DC *dc, struct cached_font *font
     GLYPHMETRICS metrics;
     struct cached_glyph *glyph;
 
+    if (shared_glyphs && (glyph = get_shared_glyph( font, index, flags, &size )))
+        return add_cached_glyph( font, index, flags, glyph, size );
+
     if (flags & ETO_GLYPH_INDEX) ggo_flags |= GGO_GLYPH_INDEX;
     indices[0] = index;
     for (i = 0; i < ARRAY_SIZE( indices ); i++)
@@ -804,7 +1062,9 @@ static struct cached_glyph *cache_glyph_bitmap( DC *dc, struct cached_font *font
 
 done:
     glyph->metrics = metrics;
-    return add_cached_glyph( font, index, flags, glyph );
+    size = FIELD_OFFSET( struct cached_glyph, bits[size] );
+    if (shared_glyphs) put_shared_glyph( font, indices[0], flags, glyph, size );
+    return add_cached_glyph( font, index, flags, glyph, size );
 }
 
 static void render_string( DC *dc, dib_info *dib, struct cached_font *font, INT x, INT y,
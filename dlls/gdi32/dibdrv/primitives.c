@@ -7367,7 +7367,206 @@ static void shrink_row_null(const dib_info *dst_dib, const POINT *dst_start,
     return;
 }
 
-const primitive_funcs funcs_8888 =
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__) || defined(__aarch64__))
+#define USE_VECTOR_PRIMITIVES
+#endif
+
+#ifdef USE_VECTOR_PRIMITIVES
+
+/* Vectorized versions of the most common 32bpp primitives, instantiated for
+ * each supported vector size with the GCC vector extensions. They produce
+ * exactly the same pixels as the scalar versions above.
+ *
+ * The blending is done on two 16-bit channels per pixel at a time, and the
+ * division by 255 of a value v <= 0xff00 is computed as (v + 1 + (v >> 8)) >> 8.
+ */
+#define DEFINE_VECTOR_PRIMITIVES( suffix, size, attr ) \
+\
+typedef DWORD vec32_##suffix __attribute__((vector_size(size))); \
+typedef WORD  vec16_##suffix __attribute__((vector_size(size))); \
+typedef BYTE  vec8_##suffix  __attribute__((vector_size(size))); \
+typedef ULONGLONG vec64_##suffix __attribute__((vector_size(size))); \
+\
+static inline attr vec16_##suffix div255_##suffix( vec16_##suffix v ) \
+{ \
+    return (v + 1 + (v >> 8)) >> 8; \
+} \
+\
+/* blend premultiplied source channels (b | r << 16 and g | a << 16) over dst */ \
+static inline attr vec32_##suffix blend_argb_##suffix( vec32_##suffix dst, vec32_##suffix src_rb, \
+                                                        vec32_##suffix src_ga ) \
+{ \
+    vec32_##suffix alpha = src_ga >> 16; \
+    vec16_##suffix inv = 255 - (vec16_##suffix)(alpha | (alpha << 16)); \
+    vec32_##suffix rb = src_rb + (vec32_##suffix)div255_##suffix( (vec16_##suffix)(dst & 0x00ff00ff) * inv + 127 ); \
+    vec32_##suffix ga = src_ga + (vec32_##suffix)div255_##suffix( (vec16_##suffix)((dst >> 8) & 0x00ff00ff) * inv + 127 ); \
+    return rb | (ga << 8); \
+} \
+\
+static attr void blend_argb_row_##suffix( DWORD *dst, const DWORD *src, int len ) \
+{ \
+    vec32_##suffix d, s; \
+\
+    for ( ; len >= size / 4; len -= size / 4, dst += size / 4, src += size / 4) \
+    { \
+        memcpy( &d, dst, size ); \
+        memcpy( &s, src, size ); \
+        d = blend_argb_##suffix( d, s & 0x00ff00ff, (s >> 8) & 0x00ff00ff ); \
+        memcpy( dst, &d, size ); \
+    } \
+    for ( ; len > 0; len--, dst++, src++) *dst = blend_argb( *dst, *src ); \
+} \
+\
+static attr void blend_argb_alpha_row_##suffix( DWORD *dst, const DWORD *src, int len, DWORD alpha ) \
+{ \
+    vec32_##suffix d, s, rb, ga; \
+\
+    for ( ; len >= size / 4; len -= size / 4, dst += size / 4, src += size / 4) \
+    { \
+        memcpy( &d, dst, size ); \
+        memcpy( &s, src, size ); \
+        rb = (vec32_##suffix)div255_##suffix( (vec16_##suffix)(s & 0x00ff00ff) * (WORD)alpha + 127 ); \
+        ga = (vec32_##suffix)div255_##suffix( (vec16_##suffix)((s >> 8) & 0x00ff00ff) * (WORD)alpha + 127 ); \
+        d = blend_argb_##suffix( d, rb, ga ); \
+        memcpy( dst, &d, size ); \
+    } \
+    for ( ; len > 0; len--, dst++, src++) *dst = blend_argb_alpha( *dst, *src, alpha ); \
+} \
+\
+/* src_alpha is 0 to use the source alpha channel, or 0xff000000 to ignore it */ \
+static attr void blend_constant_alpha_row_##suffix( DWORD *dst, const DWORD *src, int len, \
+                                                    DWORD alpha, DWORD src_alpha ) \
+{ \
+    vec32_##suffix d, s, rb, ga; \
+\
+    for ( ; len >= size / 4; len -= size / 4, dst += size / 4, src += size / 4) \
+    { \
+        memcpy( &d, dst, size ); \
+        memcpy( &s, src, size ); \
+        s |= src_alpha; \
+        rb = (vec32_##suffix)div255_##suffix( (vec16_##suffix)(s & 0x00ff00ff) * (WORD)alpha + \
+                                              (vec16_##suffix)(d & 0x00ff00ff) * (WORD)(255 - alpha) + 127 ); \
+        ga = (vec32_##suffix)div255_##suffix( (vec16_##suffix)((s >> 8) & 0x00ff00ff) * (WORD)alpha + \
+                                              (vec16_##suffix)((d >> 8) & 0x00ff00ff) * (WORD)(255 - alpha) + 127 ); \
+        d = rb | (ga << 8); \
+        memcpy( dst, &d, size ); \
+    } \
+    for ( ; len > 0; len--, dst++, src++) \
+        *dst = src_alpha ? blend_argb_no_src_alpha( *dst, *src, alpha ) \
+                         : blend_argb_constant_alpha( *dst, *src, alpha ); \
+} \
+\
+static attr void blend_rect_8888_##suffix( const dib_info *dst, const RECT *rc, const dib_info *src, \
+                                           const POINT *origin, BLENDFUNCTION blend ) \
+{ \
+    DWORD *src_ptr = get_pixel_ptr_32( src, origin->x, origin->y ); \
+    DWORD *dst_ptr = get_pixel_ptr_32( dst, rc->left, rc->top ); \
+    int y; \
+\
+    for (y = rc->top; y < rc->bottom; y++, dst_ptr += dst->stride / 4, src_ptr += src->stride / 4) \
+    { \
+        if (!(blend.AlphaFormat & AC_SRC_ALPHA)) \
+            blend_constant_alpha_row_##suffix( dst_ptr, src_ptr, rc->right - rc->left, blend.SourceConstantAlpha, \
+                                               src->compression == BI_RGB ? 0 : 0xff000000 ); \
+        else if (blend.SourceConstantAlpha == 255) \
+            blend_argb_row_##suffix( dst_ptr, src_ptr, rc->right - rc->left ); \
+        else \
+            blend_argb_alpha_row_##suffix( dst_ptr, src_ptr, rc->right - rc->left, blend.SourceConstantAlpha ); \
+    } \
+} \
+\
+static attr void copy_rect_32_##suffix( const dib_info *dst, const RECT *rc, const dib_info *src, \
+                                        const POINT *origin, int rop2, int overlap ) \
+{ \
+    DWORD *dst_ptr, *src_ptr; \
+    vec32_##suffix d, s; \
+    struct rop_codes codes; \
+    int x, y; \
+\
+    if (rop2 == R2_COPYPEN || (overlap & (OVERLAP_BELOW | OVERLAP_RIGHT))) \
+    { \
+        copy_rect_32( dst, rc, src, origin, rop2, overlap ); \
+        return; \
+    } \
+\
+    get_rop_codes( rop2, &codes ); \
+    dst_ptr = get_pixel_ptr_32( dst, rc->left, rc->top ); \
+    src_ptr = get_pixel_ptr_32( src, origin->x, origin->y ); \
+    for (y = rc->top; y < rc->bottom; y++, dst_ptr += dst->stride / 4, src_ptr += src->stride / 4) \
+    { \
+        for (x = 0; x <= rc->right - rc->left - size / 4; x += size / 4) \
+        { \
+            memcpy( &d, dst_ptr + x, size ); \
+            memcpy( &s, src_ptr + x, size ); \
+            d = (d & ((s & codes.a1) ^ codes.a2)) ^ ((s & codes.x1) ^ codes.x2); \
+            memcpy( dst_ptr + x, &d, size ); \
+        } \
+        for ( ; x < rc->right - rc->left; x++) do_rop_codes_32( dst_ptr + x, src_ptr[x], &codes ); \
+    } \
+} \
+\
+static attr void draw_glyph_8888_##suffix( const dib_info *dib, const RECT *rect, const dib_info *glyph, \
+                                           const POINT *origin, DWORD text_pixel, \
+                                           const struct intensity_range *ranges ) \
+{ \
+    DWORD *dst_ptr = get_pixel_ptr_32( dib, rect->left, rect->top ); \
+    const BYTE *glyph_ptr = get_pixel_ptr_8( glyph, origin->x, origin->y ); \
+    vec32_##suffix text = (vec32_##suffix){} + text_pixel; \
+    vec8_##suffix g; \
+    vec64_##suffix visible, opaque; \
+    ULONGLONG any_visible, all_opaque; \
+    int i, x, y, end; \
+\
+    for (y = rect->top; y < rect->bottom; y++) \
+    { \
+        for (x = 0; x < rect->right - rect->left; x += size) \
+        { \
+            end = min( x + size, rect->right - rect->left ); \
+            if (end - x == size) \
+            { \
+                /* skip runs of transparent pixels and fill runs of opaque ones */ \
+                memcpy( &g, glyph_ptr + x, size ); \
+                visible = (vec64_##suffix)(g > 1); \
+                opaque = (vec64_##suffix)(g >= 16); \
+                any_visible = 0; \
+                all_opaque = ~(ULONGLONG)0; \
+                for (i = 0; i < size / 8; i++) \
+                { \
+                    any_visible |= visible[i]; \
+                    all_opaque &= opaque[i]; \
+                } \
+                if (!any_visible) continue; \
+                if (all_opaque == ~(ULONGLONG)0) \
+                { \
+                    for (i = 0; i < 4; i++) memcpy( dst_ptr + x + i * size / 4, &text, size ); \
+                    continue; \
+                } \
+            } \
+            for (i = x; i < end; i++) \
+            { \
+                if (glyph_ptr[i] <= 1) continue; \
+                if (glyph_ptr[i] >= 16) { dst_ptr[i] = text_pixel; continue; } \
+                dst_ptr[i] = aa_rgb( dst_ptr[i] >> 16, dst_ptr[i] >> 8, dst_ptr[i], text_pixel, ranges + glyph_ptr[i] ); \
+            } \
+        } \
+        dst_ptr += dib->stride / 4; \
+        glyph_ptr += glyph->stride; \
+    } \
+}
+
+#if defined(__i386__)
+DEFINE_VECTOR_PRIMITIVES( sse2, 16, __attribute__((target("sse2"))) )
+DEFINE_VECTOR_PRIMITIVES( avx2, 32, __attribute__((target("avx2"))) )
+#elif defined(__x86_64__)
+DEFINE_VECTOR_PRIMITIVES( sse2, 16, )
+DEFINE_VECTOR_PRIMITIVES( avx2, 32, __attribute__((target("avx2"))) )
+#else
+DEFINE_VECTOR_PRIMITIVES( neon, 16, )
+#endif
+
+#endif  /* USE_VECTOR_PRIMITIVES */
+
+primitive_funcs funcs_8888 =
 {
     solid_rects_32,
     solid_line_32,
@@ -7388,7 +7587,7 @@ const primitive_funcs funcs_8888 =
     shrink_row_32
 };
 
-const primitive_funcs funcs_32 =
+primitive_funcs funcs_32 =
 {
     solid_rects_32,
     solid_line_32,
@@ -7555,3 +7754,39 @@ const primitive_funcs funcs_null =
     stretch_row_null,
     shrink_row_null
 };
+
+/***********************************************************************
+ *           init_dib_primitives
+ *
+ * Select the vectorized primitives supported by the CPU.
+ */
+void init_dib_primitives(void)
+{
+#ifdef USE_VECTOR_PRIMITIVES
+#define SET_VECTOR_PRIMITIVES( suffix ) \
+    do { \
+        funcs_8888.copy_rect  = copy_rect_32_##suffix; \
+        funcs_8888.blend_rect = blend_rect_8888_##suffix; \
+        funcs_8888.draw_glyph = draw_glyph_8888_##suffix; \
+        funcs_32.copy_rect    = copy_rect_32_##suffix; \
+    } while (0)
+
+#if defined(__i386__) || defined(__x86_64__)
+    if (IsProcessorFeaturePresent( PF_AVX2_INSTRUCTIONS_AVAILABLE ))
+    {
+        TRACE( "using AVX2 primitives\n" );
+        SET_VECTOR_PRIMITIVES( avx2 );
+        return;
+    }
+#ifdef __i386__
+    if (!IsProcessorFeaturePresent( PF_XMMI64_INSTRUCTIONS_AVAILABLE )) return;
+#endif
+    TRACE( "using SSE2 primitives\n" );
+    SET_VECTOR_PRIMITIVES( sse2 );
+#else
+    TRACE( "using NEON primitives\n" );
+    SET_VECTOR_PRIMITIVES( neon );
+#endif
+#undef SET_VECTOR_PRIMITIVES
+#endif
+}
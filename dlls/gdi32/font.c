@@ -7938,11 +7938,59 @@ static void load_registry_fonts(void)
 
 static const struct font_callback_funcs callback_funcs = { add_gdi_face };
 
+/***********************************************************************
+ *              get_font_glyph_id
+ *
+ * Return an identifier of the font realized in a DC that is the same in all
+ * processes using the same font files, or 0 if its glyphs can't be shared.
+ */
+ULONGLONG get_font_glyph_id( DC *dc )
+{
+    PHYSDEV dev = find_dc_driver( dc, &font_driver );
+    struct gdi_font *font;
+    ULONGLONG hash = 0xcbf29ce484222325;  /* FNV-1a */
+    const BYTE *ptr;
+    unsigned int i;
+    struct
+    {
+        UINT     face_index;
+        ULONG    ttc_item_offset;
+        FILETIME writetime;
+        FMAT2    matrix;
+        INT      scale_y;
+        INT      ppem;
+        LONG     height;
+        LONG     width;
+        LONG     orientation;
+        UINT     flags;
+    } key;
+
+    if (!dev || !(font = get_font_dev( dev )->font)) return 0;
+    if (font->data_ptr || !font->file[0]) return 0;  /* memory fonts are private to the process */
+
+    memset( &key, 0, sizeof(key) );
+    key.face_index      = font->face_index;
+    key.ttc_item_offset = font->ttc_item_offset;
+    key.writetime       = font->writetime;
+    key.matrix          = font->matrix;
+    key.scale_y         = font->scale_y;
+    key.ppem            = font->ppem;
+    key.height          = font->lf.lfHeight;
+    key.width           = font->lf.lfWidth;
+    key.orientation     = font->lf.lfOrientation;
+    key.flags           = font->fake_italic | font->fake_bold << 1 | font->can_use_bitmap << 2;
+
+    for (ptr = (const BYTE *)&key, i = 0; i < sizeof(key); i++) hash = (hash ^ ptr[i]) * 0x100000001b3;
+    for (i = 0; font->file[i]; i++) hash = (hash ^ towlower( font->file[i] )) * 0x100000001b3;
+    return hash ? hash : 1;
+}
+
 /***********************************************************************
  *              font_init
  */
 void font_init(void)
 {
+    WCHAR index_file[MAX_PATH];
     HANDLE mutex;
     DWORD disposition;
 
@@ -7956,7 +8004,9 @@ void font_init(void)
 
     load_system_bitmap_fonts();
     load_file_system_fonts();
-    font_funcs->load_fonts();
+    GetSystemDirectoryW( index_file, MAX_PATH );
+    lstrcatW( index_file, L"\\fntcache.dat" );
+    font_funcs->load_fonts( index_file );
 
     if (!(mutex = CreateMutexW( NULL, FALSE, L"__WINE_FONT_MUTEX__" ))) return;
     WaitForSingleObject( mutex, INFINITE );
@@ -40,6 +40,9 @@
 #ifdef HAVE_DIRENT_H
 # include <dirent.h>
 #endif
+#ifdef HAVE_UNISTD_H
+# include <unistd.h>
+#endif
 #include <stdio.h>
 #include <assert.h>
 
@@ -190,6 +193,7 @@ MAKE_FUNCPTR(FcPatternDestroy);
 MAKE_FUNCPTR(FcPatternGetBool);
 MAKE_FUNCPTR(FcPatternGetInteger);
 MAKE_FUNCPTR(FcPatternGetString);
+MAKE_FUNCPTR(FcConfigGetConfigFiles);
 MAKE_FUNCPTR(FcConfigGetFontDirs);
 MAKE_FUNCPTR(FcConfigGetCurrent);
 MAKE_FUNCPTR(FcCacheCopySet);
@@ -1185,8 +1189,19 @@ struct unix_face
     DWORD font_version;
     FONTSIGNATURE fs;
     struct bitmap_font_size size;
+    ULONGLONG file_size;
+    ULONGLONG file_mtime;
 };
 
+static ULONGLONG get_stat_mtime( const struct stat *st )
+{
+    ULONGLONG ret = (ULONGLONG)st->st_mtime * 1000000000;
+#ifdef HAVE_STRUCT_STAT_ST_MTIM
+    ret += st->st_mtim.tv_nsec;
+#endif
+    return ret;
+}
+
 static struct unix_face *unix_face_create( const char *unix_name, void *data_ptr, DWORD data_size,
                                            UINT face_index, DWORD flags )
 {
@@ -1218,6 +1233,12 @@ static struct unix_face *unix_face_create( const char *unix_name, void *data_ptr
 
     if (!(This = RtlAllocateHeap( GetProcessHeap(), HEAP_ZERO_MEMORY, sizeof(*This) ))) goto done;
 
+    if (unix_name)
+    {
+        This->file_size = st.st_size;
+        This->file_mtime = get_stat_mtime( &st );
+    }
+
     if (opentype_get_ttc_sfnt_v1( data_ptr, data_size, face_index, &face_count, &ttc_sfnt_v1 ) &&
         opentype_get_tt_name_v0( data_ptr, data_size, ttc_sfnt_v1, &tt_name_v0 ) &&
         opentype_get_properties( data_ptr, data_size, ttc_sfnt_v1, &This->font_version,
@@ -1315,6 +1336,167 @@ static void unix_face_destroy( struct unix_face *This )
     RtlFreeHeap( GetProcessHeap(), 0, This );
 }
 
+#ifdef SONAME_LIBFONTCONFIG
+
+/* binary font index
+ *
+ * The faces found through fontconfig are recorded in a file that is mapped by
+ * the next processes, so that they don't have to open and parse every font
+ * file again. The index is invalidated when one of the scanned directories
+ * or font files is modified, or when the fontconfig configuration or the
+ * drive mappings change.
+ */
+
+#define FONT_INDEX_MAGIC    0x58444946  /* FIDX */
+#define FONT_INDEX_VERSION  2
+#define FONT_INDEX_NO_NAME  (~0u)
+
+struct font_index_header
+{
+    DWORD magic;
+    DWORD version;
+    DWORD size;         /* total size of the file */
+    DWORD lcid;         /* system_lcid used for the names */
+    DWORD aa_flags;     /* default_aa_flags */
+    DWORD dir_count;
+    DWORD face_count;
+    DWORD strings;      /* offset of the string pool */
+    DWORD pad;
+    ULONGLONG config_hash;  /* hash of the fontconfig configuration and of the drive mappings */
+};
+
+struct font_index_dir
+{
+    ULONGLONG mtime;    /* ~0 if the directory doesn't exist */
+    DWORD     name;     /* unix name, offset in string pool */
+    DWORD     pad;
+};
+
+struct font_index_face
+{
+    DWORD     family_name;  /* offsets in string pool */
+    DWORD     second_name;
+    DWORD     style_name;
+    DWORD     full_name;
+    DWORD     file;
+    DWORD     unix_name;
+    DWORD     face_index;
+    DWORD     flags;
+    DWORD     ntm_flags;
+    DWORD     version;
+    DWORD     scalable;
+    FONTSIGNATURE fs;
+    struct bitmap_font_size size;
+    DWORD     pad;
+    ULONGLONG file_size;
+    ULONGLONG file_mtime;
+};
+
+struct font_index_builder
+{
+    struct font_index_dir  *dirs;
+    struct font_index_face *faces;
+    char                   *strings;
+    DWORD                   dir_count;
+    DWORD                   dir_size;
+    DWORD                   face_count;
+    DWORD                   face_size;
+    DWORD                   strings_len;
+    DWORD                   strings_size;
+    BOOL                    failed;
+};
+
+static struct font_index_builder *font_index_builder;
+
+static BOOL font_index_grow( void **array, DWORD *size, DWORD count, SIZE_T elem_size )
+{
+    DWORD new_size = max( 64, *size * 2 );
+    void *new_array;
+
+    if (count < *size) return TRUE;
+    if (*array) new_array = RtlReAllocateHeap( GetProcessHeap(), 0, *array, new_size * elem_size );
+    else new_array = RtlAllocateHeap( GetProcessHeap(), 0, new_size * elem_size );
+    if (!new_array) return FALSE;
+    *array = new_array;
+    *size = new_size;
+    return TRUE;
+}
+
+static DWORD font_index_add_string( struct font_index_builder *builder, const void *str, DWORD len )
+{
+    DWORD ret = builder->strings_len, size = (len + 1) & ~1;  /* keep strings WCHAR aligned */
+    DWORD new_size = max( 4096, builder->strings_size );
+    char *strings;
+
+    if (!str) return FONT_INDEX_NO_NAME;
+    if (builder->strings_size - ret < size)
+    {
+        while (new_size - ret < size) new_size *= 2;
+        if (builder->strings) strings = RtlReAllocateHeap( GetProcessHeap(), 0, builder->strings, new_size );
+        else strings = RtlAllocateHeap( GetProcessHeap(), 0, new_size );
+        if (!strings)
+        {
+            builder->failed = TRUE;
+            return FONT_INDEX_NO_NAME;
+        }
+        builder->strings = strings;
+        builder->strings_size = new_size;
+    }
+    memcpy( builder->strings + ret, str, len );
+    if (size > len) builder->strings[ret + len] = 0;
+    builder->strings_len += size;
+    return ret;
+}
+
+static void font_index_add_dir( struct font_index_builder *builder, const char *unix_name )
+{
+    struct font_index_dir *dir;
+    struct stat st;
+
+    if (!font_index_grow( (void **)&builder->dirs, &builder->dir_size, builder->dir_count, sizeof(*dir) ))
+    {
+        builder->failed = TRUE;
+        return;
+    }
+    dir = &builder->dirs[builder->dir_count++];
+    dir->mtime = stat( unix_name, &st ) ? ~(ULONGLONG)0 : get_stat_mtime( &st );
+    dir->name = font_index_add_string( builder, unix_name, strlen( unix_name ) + 1 );
+    dir->pad = 0;
+}
+
+static void font_index_add_face( struct font_index_builder *builder, const struct unix_face *unix_face,
+                                 const char *unix_name, const WCHAR *file, DWORD face_index, DWORD flags )
+{
+    struct font_index_face *face;
+
+    if (!font_index_grow( (void **)&builder->faces, &builder->face_size, builder->face_count, sizeof(*face) ))
+    {
+        builder->failed = TRUE;
+        return;
+    }
+    face = &builder->faces[builder->face_count++];
+    memset( face, 0, sizeof(*face) );
+#define ADD_NAME(name) font_index_add_string( builder, name, name ? (lstrlenW( name ) + 1) * sizeof(WCHAR) : 0 )
+    face->family_name = ADD_NAME( unix_face->family_name );
+    face->second_name = ADD_NAME( unix_face->second_name );
+    face->style_name  = ADD_NAME( unix_face->style_name );
+    face->full_name   = ADD_NAME( unix_face->full_name );
+    face->file        = ADD_NAME( file );
+#undef ADD_NAME
+    face->unix_name   = font_index_add_string( builder, unix_name, strlen( unix_name ) + 1 );
+    face->face_index  = face_index;
+    face->flags       = flags;
+    face->ntm_flags   = unix_face->ntm_flags;
+    face->version     = unix_face->font_version;
+    face->scalable    = unix_face->scalable;
+    face->fs          = unix_face->fs;
+    face->size        = unix_face->size;
+    face->file_size   = unix_face->file_size;
+    face->file_mtime  = unix_face->file_mtime;
+}
+
+#endif /* SONAME_LIBFONTCONFIG */
+
 static int add_unix_face( const char *unix_name, const WCHAR *file, void *data_ptr, SIZE_T data_size,
                           DWORD face_index, DWORD flags, DWORD *num_faces )
 {
@@ -1339,6 +1521,11 @@ static int add_unix_face( const char *unix_name, const WCHAR *file, void *data_p
                                         file, data_ptr, data_size, face_index, unix_face->fs, unix_face->ntm_flags,
                                         unix_face->font_version, flags, unix_face->scalable ? NULL : &unix_face->size );
 
+#ifdef SONAME_LIBFONTCONFIG
+    if (font_index_builder && unix_name)
+        font_index_add_face( font_index_builder, unix_face, unix_name, file, face_index, flags );
+#endif
+
     TRACE("fsCsb = %08x %08x/%08x %08x %08x %08x\n", unix_face->fs.fsCsb[0], unix_face->fs.fsCsb[1],
           unix_face->fs.fsUsb[0], unix_face->fs.fsUsb[1], unix_face->fs.fsUsb[2], unix_face->fs.fsUsb[3]);
 
@@ -1622,6 +1809,7 @@ static void init_fontconfig(void)
     LOAD_FUNCPTR(FcPatternGetBool);
     LOAD_FUNCPTR(FcPatternGetInteger);
     LOAD_FUNCPTR(FcPatternGetString);
+    LOAD_FUNCPTR(FcConfigGetConfigFiles);
     LOAD_FUNCPTR(FcConfigGetFontDirs);
     LOAD_FUNCPTR(FcConfigGetCurrent);
     LOAD_FUNCPTR(FcCacheCopySet);
@@ -1672,6 +1860,7 @@ static void fontconfig_add_fonts_from_dir_list( FcConfig *config, FcStrList *dir
     while ((dir = pFcStrListNext( dir_list )))
     {
         if (pFcStrSetMember( done_set, dir )) continue;
+        if (font_index_builder) font_index_add_dir( font_index_builder, (const char *)dir );
 
         TRACE( "adding fonts from %s\n", dir );
         if (!(cache = pFcDirCacheRead( dir, FcFalse, config ))) continue;
@@ -1723,6 +1912,265 @@ done:
     if (done_set) pFcStrSetDestroy( done_set );
 }
 
+static BOOL font_index_check_string( const struct font_index_header *header, DWORD offset, BOOL optional )
+{
+    if (offset == FONT_INDEX_NO_NAME) return optional;
+    return offset < header->size - header->strings && !(offset & 1);
+}
+
+static const void *font_index_string( const struct font_index_header *header, DWORD offset )
+{
+    if (offset == FONT_INDEX_NO_NAME) return NULL;
+    return (const char *)header + header->strings + offset;
+}
+
+static ULONGLONG font_index_hash( ULONGLONG hash, const void *data, SIZE_T size )
+{
+    const unsigned char *ptr = data;
+
+    /* FNV-1a */
+    while (size--) hash = (hash ^ *ptr++) * 0x100000001b3ull;
+    return hash;
+}
+
+/* hash everything the index depends on besides the font files and directories themselves:
+ * the fontconfig configuration files, and the DOS names of the font directories, which
+ * change with the drive mappings */
+static ULONGLONG font_index_config_hash( FcConfig *config )
+{
+    ULONGLONG hash = 0xcbf29ce484222325ull, mtime;
+    const FcChar8 *name;
+    FcStrList *list;
+    struct stat st;
+    WCHAR *dos_name;
+
+    if ((list = pFcConfigGetConfigFiles( config )))
+    {
+        while ((name = pFcStrListNext( list )))
+        {
+            hash = font_index_hash( hash, name, strlen( (const char *)name ) + 1 );
+            if (stat( (const char *)name, &st )) continue;
+            mtime = get_stat_mtime( &st );
+            hash = font_index_hash( hash, &mtime, sizeof(mtime) );
+            hash = font_index_hash( hash, &st.st_size, sizeof(st.st_size) );
+        }
+        pFcStrListDone( list );
+    }
+
+    if ((list = pFcConfigGetFontDirs( config )))
+    {
+        while ((name = pFcStrListNext( list )))
+        {
+            if (!(dos_name = get_dos_file_name( (const char *)name ))) continue;
+            hash = font_index_hash( hash, dos_name, (lstrlenW( dos_name ) + 1) * sizeof(WCHAR) );
+            RtlFreeHeap( GetProcessHeap(), 0, dos_name );
+        }
+        pFcStrListDone( list );
+    }
+    return hash;
+}
+
+static BOOL font_index_check_dirs( FcConfig *config, const struct font_index_header *header )
+{
+    const struct font_index_dir *dirs = (const struct font_index_dir *)(header + 1);
+    const FcChar8 *name;
+    FcStrList *dir_list;
+    struct stat st;
+    BOOL ret = TRUE;
+    DWORD i;
+
+    for (i = 0; i < header->dir_count; i++)
+    {
+        if (!font_index_check_string( header, dirs[i].name, FALSE )) return FALSE;
+        if (stat( font_index_string( header, dirs[i].name ), &st ))
+        {
+            if (dirs[i].mtime != ~(ULONGLONG)0) return FALSE;
+        }
+        else if (dirs[i].mtime != get_stat_mtime( &st )) return FALSE;
+    }
+
+    /* make sure that no font directory was added to the configuration */
+    if (!(dir_list = pFcConfigGetFontDirs( config ))) return FALSE;
+    while (ret && (name = pFcStrListNext( dir_list )))
+    {
+        for (i = 0; i < header->dir_count; i++)
+            if (!strcmp( (const char *)name, font_index_string( header, dirs[i].name ))) break;
+        ret = i < header->dir_count;
+    }
+    pFcStrListDone( dir_list );
+    return ret;
+}
+
+static BOOL font_index_check_faces( const struct font_index_header *header )
+{
+    const struct font_index_face *faces = (const struct font_index_face *)
+        ((const struct font_index_dir *)(header + 1) + header->dir_count);
+    const char *unix_name, *prev_name = NULL;
+    struct stat st;
+    DWORD i;
+
+    for (i = 0; i < header->face_count; i++)
+    {
+        if (!font_index_check_string( header, faces[i].family_name, FALSE ) ||
+            !font_index_check_string( header, faces[i].second_name, TRUE ) ||
+            !font_index_check_string( header, faces[i].style_name, TRUE ) ||
+            !font_index_check_string( header, faces[i].full_name, TRUE ) ||
+            !font_index_check_string( header, faces[i].file, TRUE ) ||
+            !font_index_check_string( header, faces[i].unix_name, FALSE ))
+            return FALSE;
+
+        /* faces of a collection are stored together, stat each file only once */
+        unix_name = font_index_string( header, faces[i].unix_name );
+        if (prev_name && !strcmp( unix_name, prev_name ) &&
+            faces[i].file_size == faces[i - 1].file_size && faces[i].file_mtime == faces[i - 1].file_mtime)
+            continue;
+        if (stat( unix_name, &st ) || st.st_size != faces[i].file_size ||
+            get_stat_mtime( &st ) != faces[i].file_mtime)
+            return FALSE;
+        prev_name = unix_name;
+    }
+    return TRUE;
+}
+
+/* add the faces from the font index, returns FALSE if the index is missing or out of date */
+static BOOL load_font_index( const char *index_name )
+{
+    const struct font_index_header *header;
+    const struct font_index_face *faces;
+    FcConfig *config;
+    struct stat st;
+    void *ptr;
+    DWORD i;
+    int fd;
+
+    if (!(config = pFcConfigGetCurrent())) return FALSE;
+    if ((fd = open( index_name, O_RDONLY )) == -1) return FALSE;
+    if (fstat( fd, &st ) == -1 || st.st_size < sizeof(*header) + sizeof(WCHAR) || st.st_size > 0x7fffffff)
+    {
+        close( fd );
+        return FALSE;
+    }
+    ptr = mmap( NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+    close( fd );
+    if (ptr == MAP_FAILED) return FALSE;
+
+    header = ptr;
+    if (header->magic != FONT_INDEX_MAGIC || header->version != FONT_INDEX_VERSION ||
+        header->size != st.st_size || header->lcid != system_lcid || header->aa_flags != default_aa_flags ||
+        header->config_hash != font_index_config_hash( config ) ||
+        header->strings != sizeof(*header) + (ULONGLONG)header->dir_count * sizeof(struct font_index_dir) +
+                           (ULONGLONG)header->face_count * sizeof(struct font_index_face) ||
+        header->strings > header->size - sizeof(WCHAR) || (header->size - header->strings) & 1 ||
+        *(const WCHAR *)((const char *)header + header->size - sizeof(WCHAR)) ||
+        !font_index_check_dirs( config, header ) || !font_index_check_faces( header ))
+    {
+        TRACE( "font index %s is out of date\n", debugstr_a(index_name) );
+        munmap( ptr, st.st_size );
+        return FALSE;
+    }
+
+    TRACE( "loading %u faces from %s\n", header->face_count, debugstr_a(index_name) );
+    faces = (const struct font_index_face *)((const struct font_index_dir *)(header + 1) + header->dir_count);
+    for (i = 0; i < header->face_count; i++)
+        callback_funcs->add_gdi_face( font_index_string( header, faces[i].family_name ),
+                                      font_index_string( header, faces[i].second_name ),
+                                      font_index_string( header, faces[i].style_name ),
+                                      font_index_string( header, faces[i].full_name ),
+                                      font_index_string( header, faces[i].file ), NULL, 0,
+                                      faces[i].face_index, faces[i].fs, faces[i].ntm_flags, faces[i].version,
+                                      faces[i].flags, faces[i].scalable ? NULL : &faces[i].size );
+    munmap( ptr, st.st_size );
+    return TRUE;
+}
+
+static BOOL write_all( int fd, const void *data, SIZE_T size )
+{
+    const char *ptr = data;
+    ssize_t ret;
+
+    while (size)
+    {
+        if ((ret = write( fd, ptr, size )) == -1) return FALSE;
+        ptr += ret;
+        size -= ret;
+    }
+    return TRUE;
+}
+
+static void write_font_index( const struct font_index_builder *builder, const char *index_name )
+{
+    struct font_index_header header;
+    FcConfig *config;
+    char *tmp_name;
+    BOOL ret;
+    int fd;
+
+    if (builder->failed) return;
+
+    /* the string pool always ends with a null WCHAR */
+    if (!builder->strings_len || builder->strings[builder->strings_len - 1] ||
+        builder->strings[builder->strings_len - 2])
+        return;
+    if (!(config = pFcConfigGetCurrent())) return;
+
+    header.magic      = FONT_INDEX_MAGIC;
+    header.version    = FONT_INDEX_VERSION;
+    header.lcid       = system_lcid;
+    header.aa_flags   = default_aa_flags;
+    header.dir_count  = builder->dir_count;
+    header.face_count = builder->face_count;
+    header.strings    = sizeof(header) + builder->dir_count * sizeof(*builder->dirs) +
+                        builder->face_count * sizeof(*builder->faces);
+    header.size       = header.strings + builder->strings_len;
+    header.pad        = 0;
+    header.config_hash = font_index_config_hash( config );
+
+    /* write to a temporary file and rename it, so that other processes never see a partial index */
+    if (!(tmp_name = RtlAllocateHeap( GetProcessHeap(), 0, strlen( index_name ) + 16 ))) return;
+    sprintf( tmp_name, "%s.%x", index_name, (int)getpid() );
+    if ((fd = open( tmp_name, O_WRONLY | O_CREAT | O_TRUNC, 0666 )) != -1)
+    {
+        ret = write_all( fd, &header, sizeof(header) ) &&
+              write_all( fd, builder->dirs, builder->dir_count * sizeof(*builder->dirs) ) &&
+              write_all( fd, builder->faces, builder->face_count * sizeof(*builder->faces) ) &&
+              write_all( fd, builder->strings, builder->strings_len );
+        close( fd );
+        if (!ret || rename( tmp_name, index_name ))
+        {
+            WARN( "failed to write font index %s\n", debugstr_a(index_name) );
+            unlink( tmp_name );
+        }
+    }
+    RtlFreeHeap( GetProcessHeap(), 0, tmp_name );
+}
+
+static void load_fontconfig_fonts_indexed( const WCHAR *index_file )
+{
+    struct font_index_builder builder;
+    char *index_name;
+
+    if (!fontconfig_enabled) return;
+    if (!index_file || !(index_name = get_unix_file_name( index_file )))
+    {
+        load_fontconfig_fonts();
+        return;
+    }
+
+    if (!load_font_index( index_name ))
+    {
+        memset( &builder, 0, sizeof(builder) );
+        font_index_builder = &builder;
+        load_fontconfig_fonts();
+        font_index_builder = NULL;
+
+        write_font_index( &builder, index_name );
+        RtlFreeHeap( GetProcessHeap(), 0, builder.dirs );
+        RtlFreeHeap( GetProcessHeap(), 0, builder.faces );
+        RtlFreeHeap( GetProcessHeap(), 0, builder.strings );
+    }
+    RtlFreeHeap( GetProcessHeap(), 0, index_name );
+}
+
 #elif defined(HAVE_CARBON_CARBON_H)
 
 static void load_mac_font_callback(const void *value, void *context)
@@ -1936,10 +2384,10 @@ sym_not_found:
 /*************************************************************
  * freetype_load_fonts
  */
-static void CDECL freetype_load_fonts(void)
+static void CDECL freetype_load_fonts( const WCHAR *index_file )
 {
 #ifdef SONAME_LIBFONTCONFIG
-    load_fontconfig_fonts();
+    load_fontconfig_fonts_indexed( index_file );
 #elif defined(HAVE_CARBON_CARBON_H)
     load_mac_fonts();
 #elif defined(__ANDROID__)
@@ -260,6 +260,7 @@ extern DWORD put_image_into_bitmap( BITMAPOBJ *bmp, HRGN clip, BITMAPINFO *info,
                                     const struct gdi_image_bits *bits, struct bitblt_coords *src,
                                     struct bitblt_coords *dst ) DECLSPEC_HIDDEN;
 extern void dibdrv_set_window_surface( DC *dc, struct window_surface *surface ) DECLSPEC_HIDDEN;
+extern void init_dib_primitives(void) DECLSPEC_HIDDEN;
 
 extern NTSTATUS init_opengl_lib( HMODULE module, DWORD reason, const void *ptr_in, void *ptr_out ) DECLSPEC_HIDDEN;
 
@@ -381,7 +382,7 @@ struct gdi_font
 
 struct font_backend_funcs
 {
-    void  (CDECL *load_fonts)(void);
+    void  (CDECL *load_fonts)( const WCHAR *index_file );
     BOOL  (CDECL *enum_family_fallbacks)( DWORD pitch_and_family, int index, WCHAR buffer[LF_FACESIZE] );
     INT   (CDECL *add_font)( const WCHAR *file, DWORD flags );
     INT   (CDECL *add_mem_font)( void *ptr, SIZE_T size, DWORD flags );
@@ -413,6 +414,7 @@ struct font_callback_funcs
 };
 
 extern void font_init(void) DECLSPEC_HIDDEN;
+extern ULONGLONG get_font_glyph_id( DC *dc ) DECLSPEC_HIDDEN;
 
 /* opentype.c */
 
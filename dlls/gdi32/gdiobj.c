@@ -626,6 +626,7 @@ BOOL WINAPI DllMain( HINSTANCE inst, DWORD reason, LPVOID reserved )
 
     gdi32_module = inst;
     DisableThreadLibraryCalls( inst );
+    init_dib_primitives();
     font_init();
 
     /* create stock objects */
@@ -21,6 +21,8 @@
 
 #include <stdarg.h>
 #include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "ntstatus.h"
@@ -3845,6 +3847,511 @@ static void test_GdiAlphaBlend(void)
     HeapFree(GetProcessHeap(), 0, bmi);
 }
 
+static BYTE blend_ref_channel( BYTE dst, BYTE src, DWORD alpha )
+{
+    return (src * alpha + dst * (255 - alpha) + 127) / 255;
+}
+
+static DWORD blend_ref_pixel( DWORD dst, DWORD src, BLENDFUNCTION blend )
+{
+    DWORD ret = 0, alpha = blend.SourceConstantAlpha;
+    int i;
+
+    if (!(blend.AlphaFormat & AC_SRC_ALPHA))
+    {
+        for (i = 0; i < 32; i += 8)
+            ret |= blend_ref_channel( dst >> i, src >> i, alpha ) << i;
+        return ret;
+    }
+    for (i = 0; i < 32; i += 8)
+    {
+        DWORD src_c = ((BYTE)(src >> i) * alpha + 127) / 255;
+        DWORD src_a = ((BYTE)(src >> 24) * alpha + 127) / 255;
+        ret |= (src_c + ((BYTE)(dst >> i) * (255 - src_a) + 127) / 255) << i;
+    }
+    return ret;
+}
+
+/* Windows may round differently, Wine has to match the reference exactly */
+static BOOL pixel_near( DWORD a, DWORD b )
+{
+    int i;
+
+    for (i = 0; i < 32; i += 8)
+        if (abs( (int)((a >> i) & 0xff) - (int)((b >> i) & 0xff) ) > 1) return FALSE;
+    return TRUE;
+}
+
+static HBITMAP create_dib_32( HDC hdc, int width, int height, DWORD **bits )
+{
+    BITMAPINFO bmi;
+
+    memset( &bmi, 0, sizeof(bmi) );
+    bmi.bmiHeader.biSize = sizeof(bmi.bmiHeader);
+    bmi.bmiHeader.biWidth = width;
+    bmi.bmiHeader.biHeight = -height;
+    bmi.bmiHeader.biBitCount = 32;
+    bmi.bmiHeader.biPlanes = 1;
+    bmi.bmiHeader.biCompression = BI_RGB;
+    return CreateDIBSection( hdc, &bmi, DIB_RGB_COLORS, (void **)bits, NULL, 0 );
+}
+
+static void fill_random_pixels( DWORD *bits, int count, BOOL premultiplied )
+{
+    int i;
+
+    for (i = 0; i < count; i++)
+    {
+        DWORD alpha = rand() & 0xff, pixel = (rand() << 16) ^ rand();
+
+        /* mix in fully transparent and fully opaque pixels */
+        if (i % 7 == 0) alpha = 0;
+        else if (i % 5 == 0) alpha = 0xff;
+        if (premultiplied)
+            pixel = (((pixel & 0xff) * alpha / 255) |
+                     (((pixel >> 8) & 0xff) * alpha / 255) << 8 |
+                     (((pixel >> 16) & 0xff) * alpha / 255) << 16);
+        bits[i] = (pixel & 0xffffff) | alpha << 24;
+    }
+}
+
+static void test_blend_rows(void)
+{
+    static const BYTE const_alpha[] = { 255, 128, 1, 0 };
+    static const DWORD rops[] = { SRCCOPY, SRCINVERT, SRCAND, SRCPAINT, SRCERASE, NOTSRCCOPY };
+    const int width = 72, height = 4;
+    HDC hdc_src, hdc_dst;
+    HBITMAP bmp_src, bmp_dst;
+    DWORD *src_bits, *dst_bits, *expect;
+    BLENDFUNCTION blend;
+    int w, x, i, j, alpha_format, bad, far;
+
+    if (!pGdiAlphaBlend)
+    {
+        win_skip( "GdiAlphaBlend() is not implemented\n" );
+        return;
+    }
+
+    hdc_src = CreateCompatibleDC( 0 );
+    hdc_dst = CreateCompatibleDC( 0 );
+    bmp_src = create_dib_32( hdc_src, width, height, &src_bits );
+    bmp_dst = create_dib_32( hdc_dst, width, height, &dst_bits );
+    SelectObject( hdc_src, bmp_src );
+    SelectObject( hdc_dst, bmp_dst );
+    expect = HeapAlloc( GetProcessHeap(), 0, width * height * sizeof(DWORD) );
+
+    blend.BlendOp = AC_SRC_OVER;
+    blend.BlendFlags = 0;
+
+    /* odd widths and offsets exercise both the vectorized body and the tail of each row */
+    for (alpha_format = 0; alpha_format <= AC_SRC_ALPHA; alpha_format += AC_SRC_ALPHA)
+    for (i = 0; i < ARRAY_SIZE(const_alpha); i++)
+    {
+        blend.AlphaFormat = alpha_format;
+        blend.SourceConstantAlpha = const_alpha[i];
+        for (w = 1; w <= width - 3; w += (w < 20) ? 1 : 7)
+        {
+            x = w % 3;
+            fill_random_pixels( src_bits, width * height, alpha_format != 0 );
+            fill_random_pixels( dst_bits, width * height, FALSE );
+            memcpy( expect, dst_bits, width * height * sizeof(DWORD) );
+            for (j = 0; j < height; j++)
+                for (bad = x; bad < x + w; bad++)
+                    expect[j * width + bad] = blend_ref_pixel( dst_bits[j * width + bad],
+                                                               src_bits[j * width + bad - x + 1], blend );
+
+            pGdiAlphaBlend( hdc_dst, x, 0, w, height, hdc_src, 1, 0, w, height, blend );
+
+            for (j = bad = far = 0; j < width * height; j++)
+            {
+                if (dst_bits[j] != expect[j]) bad++;
+                if (!pixel_near( dst_bits[j], expect[j] )) far++;
+            }
+            ok( !bad || broken(!far), "format %x alpha %u width %u: %u bad pixels\n",
+                alpha_format, const_alpha[i], w, bad );
+        }
+    }
+
+    for (i = 0; i < ARRAY_SIZE(rops); i++)
+    {
+        for (w = 1; w <= width - 3; w += (w < 20) ? 1 : 7)
+        {
+            x = w % 3;
+            fill_random_pixels( src_bits, width * height, FALSE );
+            fill_random_pixels( dst_bits, width * height, FALSE );
+            memcpy( expect, dst_bits, width * height * sizeof(DWORD) );
+            for (j = 0; j < height; j++)
+            {
+                for (bad = x; bad < x + w; bad++)
+                {
+                    DWORD src = src_bits[j * width + bad - x + 2], *dst = &expect[j * width + bad];
+
+                    switch (rops[i])
+                    {
+                    case SRCCOPY:    *dst = src; break;
+                    case SRCINVERT:  *dst ^= src; break;
+                    case SRCAND:     *dst &= src; break;
+                    case SRCPAINT:   *dst |= src; break;
+                    case SRCERASE:   *dst = src & ~*dst; break;
+                    case NOTSRCCOPY: *dst = ~src; break;
+                    }
+                    /* the alpha channel isn't preserved for raster operations */
+                    *dst &= 0xffffff;
+                }
+            }
+
+            BitBlt( hdc_dst, x, 0, w, height, hdc_src, 2, 0, rops[i] );
+
+            for (j = bad = 0; j < width * height; j++)
+            {
+                BOOL inside = (j % width) >= x && (j % width) < x + w;
+                if (inside ? (dst_bits[j] & 0xffffff) != expect[j] : dst_bits[j] != expect[j]) bad++;
+            }
+            ok( !bad, "rop %08x width %u: %u bad pixels\n", rops[i], w, bad );
+        }
+    }
+
+    HeapFree( GetProcessHeap(), 0, expect );
+    DeleteDC( hdc_src );
+    DeleteDC( hdc_dst );
+    DeleteObject( bmp_src );
+    DeleteObject( bmp_dst );
+}
+
+/* raster operations within one bitmap, where the source and destination overlap */
+static void test_overlapping_rop(void)
+{
+    static const POINT offsets[] = { {1, 0}, {-1, 0}, {5, 0}, {-9, 0}, {0, 1}, {0, -1}, {3, 2}, {-3, -2} };
+    static const DWORD rops[] = { SRCINVERT, SRCAND, NOTSRCCOPY };
+    const int width = 72, height = 6;
+    DWORD *bits, *orig, *expect;
+    HBITMAP bmp;
+    HDC hdc;
+    int i, j, x, y, w, bad;
+
+    hdc = CreateCompatibleDC( 0 );
+    bmp = create_dib_32( hdc, width, height, &bits );
+    SelectObject( hdc, bmp );
+    orig = HeapAlloc( GetProcessHeap(), 0, width * height * sizeof(DWORD) );
+    expect = HeapAlloc( GetProcessHeap(), 0, width * height * sizeof(DWORD) );
+
+    for (i = 0; i < ARRAY_SIZE(rops); i++)
+    for (j = 0; j < ARRAY_SIZE(offsets); j++)
+    for (w = 1; w <= width - 20; w += (w < 20) ? 1 : 9)
+    {
+        int src_x = 10, src_y = 2, dst_x = src_x + offsets[j].x, dst_y = src_y + offsets[j].y;
+
+        fill_random_pixels( bits, width * height, FALSE );
+        memcpy( orig, bits, width * height * sizeof(DWORD) );
+        memcpy( expect, bits, width * height * sizeof(DWORD) );
+        for (y = 0; y < 2; y++)
+        {
+            for (x = 0; x < w; x++)
+            {
+                DWORD src = orig[(src_y + y) * width + src_x + x], *dst = &expect[(dst_y + y) * width + dst_x + x];
+
+                switch (rops[i])
+                {
+                case SRCINVERT:  *dst ^= src; break;
+                case SRCAND:     *dst &= src; break;
+                case NOTSRCCOPY: *dst = ~src; break;
+                }
+            }
+        }
+
+        BitBlt( hdc, dst_x, dst_y, w, 2, hdc, src_x, src_y, rops[i] );
+
+        for (y = bad = 0; y < height; y++)
+        {
+            for (x = 0; x < width; x++)
+            {
+                BOOL inside = x >= dst_x && x < dst_x + w && y >= dst_y && y < dst_y + 2;
+                DWORD mask = inside ? 0xffffff : 0xffffffff;
+                if ((bits[y * width + x] & mask) != (expect[y * width + x] & mask)) bad++;
+            }
+        }
+        ok( !bad, "rop %08x offset %d,%d width %u: %u bad pixels\n",
+            rops[i], offsets[j].x, offsets[j].y, w, bad );
+    }
+
+    HeapFree( GetProcessHeap(), 0, orig );
+    HeapFree( GetProcessHeap(), 0, expect );
+    DeleteDC( hdc );
+    DeleteObject( bmp );
+}
+
+/* anti-aliased text on a 32bpp DIB has to match the same text on a 24bpp one */
+static void test_glyph_rows(void)
+{
+    static const char text[] = "Wine WWWW ||||| mmm iii";
+    const int width = 400, height = 48;
+    BITMAPINFO bmi;
+    HDC hdc32, hdc24;
+    HBITMAP bmp32, bmp24;
+    HFONT font, old32, old24;
+    DWORD *bits32;
+    BYTE *bits24;
+    LOGFONTA lf;
+    int i, x, y, bad, stride24 = (width * 3 + 3) & ~3;
+
+    hdc32 = CreateCompatibleDC( 0 );
+    hdc24 = CreateCompatibleDC( 0 );
+    bmp32 = create_dib_32( hdc32, width, height, &bits32 );
+    memset( &bmi, 0, sizeof(bmi) );
+    bmi.bmiHeader.biSize = sizeof(bmi.bmiHeader);
+    bmi.bmiHeader.biWidth = width;
+    bmi.bmiHeader.biHeight = -height;
+    bmi.bmiHeader.biBitCount = 24;
+    bmi.bmiHeader.biPlanes = 1;
+    bmi.bmiHeader.biCompression = BI_RGB;
+    bmp24 = CreateDIBSection( hdc24, &bmi, DIB_RGB_COLORS, (void **)&bits24, NULL, 0 );
+    SelectObject( hdc32, bmp32 );
+    SelectObject( hdc24, bmp24 );
+
+    memset( &lf, 0, sizeof(lf) );
+    lf.lfHeight = -36;
+    lf.lfQuality = ANTIALIASED_QUALITY;
+    strcpy( lf.lfFaceName, "Arial" );
+    font = CreateFontIndirectA( &lf );
+    old32 = SelectObject( hdc32, font );
+    old24 = SelectObject( hdc24, font );
+    SetBkMode( hdc32, TRANSPARENT );
+    SetBkMode( hdc24, TRANSPARENT );
+    SetTextColor( hdc32, RGB(0x20, 0x80, 0xc0) );
+    SetTextColor( hdc24, RGB(0x20, 0x80, 0xc0) );
+
+    /* shift the text so that the glyph runs start at different vector alignments */
+    for (i = 0; i < 4; i++)
+    {
+        fill_random_pixels( bits32, width * height, FALSE );
+        for (y = 0; y < height; y++)
+            for (x = 0; x < width; x++)
+            {
+                DWORD pixel = bits32[y * width + x];
+                bits24[y * stride24 + x * 3]     = pixel;
+                bits24[y * stride24 + x * 3 + 1] = pixel >> 8;
+                bits24[y * stride24 + x * 3 + 2] = pixel >> 16;
+            }
+
+        TextOutA( hdc32, i, 4, text, strlen(text) );
+        TextOutA( hdc24, i, 4, text, strlen(text) );
+        GdiFlush();
+
+        for (y = bad = 0; y < height; y++)
+            for (x = 0; x < width; x++)
+            {
+                const BYTE *p = bits24 + y * stride24 + x * 3;
+                if ((bits32[y * width + x] & 0xffffff) != (p[0] | p[1] << 8 | p[2] << 16)) bad++;
+            }
+        ok( !bad, "offset %d: %u pixels differ\n", i, bad );
+    }
+
+    SelectObject( hdc32, old32 );
+    SelectObject( hdc24, old24 );
+    DeleteObject( font );
+    DeleteDC( hdc32 );
+    DeleteDC( hdc24 );
+    DeleteObject( bmp32 );
+    DeleteObject( bmp24 );
+}
+
+static void test_blend_performance(void)
+{
+    const int width = 1024, height = 768, count = 200;
+    HDC hdc_src, hdc_dst;
+    HBITMAP bmp_src, bmp_dst;
+    DWORD *src_bits, *dst_bits, start;
+    BLENDFUNCTION blend;
+    int i;
+
+    if (!winetest_interactive || !pGdiAlphaBlend)
+    {
+        skip( "blending benchmark only run in interactive mode\n" );
+        return;
+    }
+
+    hdc_src = CreateCompatibleDC( 0 );
+    hdc_dst = CreateCompatibleDC( 0 );
+    bmp_src = create_dib_32( hdc_src, width, height, &src_bits );
+    bmp_dst = create_dib_32( hdc_dst, width, height, &dst_bits );
+    SelectObject( hdc_src, bmp_src );
+    SelectObject( hdc_dst, bmp_dst );
+    fill_random_pixels( src_bits, width * height, TRUE );
+    fill_random_pixels( dst_bits, width * height, FALSE );
+
+    blend.BlendOp = AC_SRC_OVER;
+    blend.BlendFlags = 0;
+    blend.SourceConstantAlpha = 255;
+    blend.AlphaFormat = AC_SRC_ALPHA;
+    start = GetTickCount();
+    for (i = 0; i < count; i++)
+        pGdiAlphaBlend( hdc_dst, 0, 0, width, height, hdc_src, 0, 0, width, height, blend );
+    trace( "per-pixel alpha: %u blends in %u ms\n", count, GetTickCount() - start );
+
+    blend.SourceConstantAlpha = 128;
+    blend.AlphaFormat = 0;
+    start = GetTickCount();
+    for (i = 0; i < count; i++)
+        pGdiAlphaBlend( hdc_dst, 0, 0, width, height, hdc_src, 0, 0, width, height, blend );
+    trace( "constant alpha: %u blends in %u ms\n", count, GetTickCount() - start );
+
+    start = GetTickCount();
+    for (i = 0; i < count; i++)
+        BitBlt( hdc_dst, 0, 0, width, height, hdc_src, 0, 0, SRCINVERT );
+    trace( "SRCINVERT: %u blits in %u ms\n", count, GetTickCount() - start );
+
+    DeleteDC( hdc_src );
+    DeleteDC( hdc_dst );
+    DeleteObject( bmp_src );
+    DeleteObject( bmp_dst );
+}
+
+/* render a few large operations that may get split into bands, and return a copy of the result */
+static DWORD *render_large_operations( int width, int height, DWORD *elapsed )
+{
+    static const int modes[] = { COLORONCOLOR, BLACKONWHITE, WHITEONBLACK };
+    TRIVERTEX vert[3];
+    GRADIENT_TRIANGLE tri = { 0, 1, 2 };
+    GRADIENT_RECT rect = { 0, 1 };
+    BLENDFUNCTION blend = { AC_SRC_OVER, 0, 255, AC_SRC_ALPHA };
+    HDC hdc_src, hdc_dst;
+    HBITMAP bmp_src, bmp_dst;
+    DWORD *src_bits, *dst_bits, *ret = NULL, start;
+    int i;
+
+    hdc_src = CreateCompatibleDC( 0 );
+    hdc_dst = CreateCompatibleDC( 0 );
+    bmp_src = create_dib_32( hdc_src, width, height, &src_bits );
+    bmp_dst = create_dib_32( hdc_dst, width, height, &dst_bits );
+    if (!bmp_src || !bmp_dst)
+    {
+        skip( "failed to create %ux%u bitmaps\n", width, height );
+        goto done;
+    }
+    SelectObject( hdc_src, bmp_src );
+    SelectObject( hdc_dst, bmp_dst );
+    srand( 1 );
+    fill_random_pixels( src_bits, width * height, TRUE );
+    memset( dst_bits, 0, width * height * sizeof(DWORD) );
+
+    start = GetTickCount();
+
+    vert[0].x = 0;
+    vert[0].y = 0;
+    vert[0].Red = 0xff00;
+    vert[0].Green = 0x1200;
+    vert[0].Blue = 0x3400;
+    vert[0].Alpha = 0x8000;
+    vert[1].x = width;
+    vert[1].y = height / 2;
+    vert[1].Red = 0x0000;
+    vert[1].Green = 0xff00;
+    vert[1].Blue = 0x8000;
+    vert[1].Alpha = 0xff00;
+    vert[2].x = width / 3;
+    vert[2].y = height;
+    vert[2].Red = 0x4000;
+    vert[2].Green = 0x2000;
+    vert[2].Blue = 0xff00;
+    vert[2].Alpha = 0x0000;
+    pGdiGradientFill( hdc_dst, vert, 3, &tri, 1, GRADIENT_FILL_TRIANGLE );
+    pGdiGradientFill( hdc_dst, vert, 2, &rect, 1, GRADIENT_FILL_RECT_H );
+
+    /* stretch, shrink and mirror, with and without merging rows */
+    for (i = 0; i < ARRAY_SIZE(modes); i++)
+    {
+        SetStretchBltMode( hdc_dst, modes[i] );
+        StretchBlt( hdc_dst, 0, 0, width, height, hdc_src, 3, 5, width / 3 + i, height / 7, SRCINVERT );
+        StretchBlt( hdc_dst, width - 1, height - 1, -width, -height, hdc_src, 0, 0, width, height - i, SRCCOPY );
+        StretchBlt( hdc_dst, 0, 0, width, height, hdc_src, 0, 0, width * 2, height * 3, SRCPAINT );
+    }
+
+    blend.SourceConstantAlpha = 200;
+    pGdiAlphaBlend( hdc_dst, 0, 0, width, height, hdc_src, 0, 0, width, height, blend );
+    pGdiAlphaBlend( hdc_dst, 1, 2, width - 1, height - 2, hdc_src, 0, 0, width / 2, height / 3, blend );
+
+    if (elapsed) *elapsed = GetTickCount() - start;
+
+    if ((ret = HeapAlloc( GetProcessHeap(), 0, width * height * sizeof(DWORD) )))
+        memcpy( ret, dst_bits, width * height * sizeof(DWORD) );
+
+done:
+    DeleteDC( hdc_src );
+    DeleteDC( hdc_dst );
+    DeleteObject( bmp_src );
+    DeleteObject( bmp_dst );
+    return ret;
+}
+
+static void set_band_threads( int threads )
+{
+    char buffer[16];
+
+    sprintf( buffer, "%d", threads );
+    SetEnvironmentVariableA( "WINE_GDI_THREADS", threads ? buffer : NULL );
+}
+
+static void test_band_rendering(void)
+{
+    static const int threads[] = { 2, 3, 8 };
+    const int width = 1200, height = 900;
+    DWORD *expect, *bits;
+    int i, j, bad;
+
+    if (!pGdiAlphaBlend || !pGdiGradientFill)
+    {
+        win_skip( "GdiAlphaBlend or GdiGradientFill not available\n" );
+        return;
+    }
+
+    /* splitting large operations across threads must not change the output */
+    set_band_threads( 1 );
+    expect = render_large_operations( width, height, NULL );
+    if (!expect) goto done;
+
+    for (i = 0; i < ARRAY_SIZE(threads); i++)
+    {
+        set_band_threads( threads[i] );
+        if (!(bits = render_large_operations( width, height, NULL ))) break;
+        for (j = bad = 0; j < width * height; j++)
+        {
+            if (bits[j] == expect[j]) continue;
+            if (!bad++) ok( 0, "%d threads: pixel %d,%d is %08x, expected %08x\n",
+                            threads[i], j % width, j / width, bits[j], expect[j] );
+        }
+        ok( !bad, "%d threads: %d pixels differ\n", threads[i], bad );
+        HeapFree( GetProcessHeap(), 0, bits );
+    }
+    HeapFree( GetProcessHeap(), 0, expect );
+
+done:
+    set_band_threads( 0 );
+}
+
+static void test_band_performance(void)
+{
+    SYSTEM_INFO info;
+    DWORD elapsed = 0;
+    int threads;
+
+    if (!winetest_interactive || !pGdiAlphaBlend || !pGdiGradientFill)
+    {
+        skip( "band rendering benchmark only run in interactive mode\n" );
+        return;
+    }
+
+    GetSystemInfo( &info );
+    for (threads = 1; threads <= 2 * info.dwNumberOfProcessors; threads *= 2)
+    {
+        if (threads > info.dwNumberOfProcessors) threads = info.dwNumberOfProcessors;
+        set_band_threads( threads );
+        HeapFree( GetProcessHeap(), 0, render_large_operations( 7680, 4320, &elapsed ));
+        trace( "%d threads: %u ms\n", threads, elapsed );
+        if (threads == info.dwNumberOfProcessors) break;
+    }
+    set_band_threads( 0 );
+}
+
 static void test_GdiGradientFill(void)
 {
     HDC hdc;
@@ -5965,6 +6472,12 @@ START_TEST(bitmap)
     test_StretchBlt();
     test_StretchDIBits();
     test_GdiAlphaBlend();
+    test_blend_rows();
+    test_overlapping_rop();
+    test_glyph_rows();
+    test_blend_performance();
+    test_band_rendering();
+    test_band_performance();
     test_GdiGradientFill();
     test_32bit_ddb();
     test_bitmapinfoheadersize();
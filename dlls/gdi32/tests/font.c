@@ -7693,6 +7693,267 @@ done:
     ReleaseDC(0, hdc);
 }
 
+struct font_list_info
+{
+    int count;
+    DWORD hash;
+};
+
+static INT CALLBACK count_fonts_proc(const LOGFONTA *lf, const TEXTMETRICA *tm, DWORD type, LPARAM lParam)
+{
+    struct font_list_info *info = (struct font_list_info *)lParam;
+    DWORD hash = 0;
+    const char *p;
+
+    info->count++;
+    /* the enumeration order isn't guaranteed, combine the name hashes with a sum */
+    for (p = lf->lfFaceName; *p; p++) hash = hash * 31 + (BYTE)*p;
+    info->hash += hash + lf->lfCharSet;
+    return 1;
+}
+
+static void get_font_list_info(struct font_list_info *info)
+{
+    LOGFONTA lf;
+    HDC hdc = GetDC(0);
+
+    memset(info, 0, sizeof(*info));
+    memset(&lf, 0, sizeof(lf));
+    lf.lfCharSet = DEFAULT_CHARSET;
+    EnumFontFamiliesExA(hdc, &lf, count_fonts_proc, (LPARAM)info, 0);
+    ReleaseDC(0, hdc);
+}
+
+static void test_font_startup_child(int expect_count, DWORD expect_hash)
+{
+    struct font_list_info info;
+
+    get_font_list_info(&info);
+    ok(info.count > 0, "no fonts found\n");
+    if (expect_count)
+    {
+        ok(info.count == expect_count, "got %d fonts, expected %d\n", info.count, expect_count);
+        ok(info.hash == expect_hash, "got font list hash %08x, expected %08x\n", info.hash, expect_hash);
+    }
+    trace("%d fonts\n", info.count);
+}
+
+static void run_font_startup_child(const char *argv0, const struct font_list_info *info)
+{
+    char path_name[MAX_PATH + 64];
+    PROCESS_INFORMATION pi;
+    STARTUPINFOA startup;
+
+    memset(&startup, 0, sizeof(startup));
+    startup.cb = sizeof(startup);
+    if (info) sprintf(path_name, "%s font startup %d %u", argv0, info->count, info->hash);
+    else sprintf(path_name, "%s font startup", argv0);
+    ok(CreateProcessA(NULL, path_name, NULL, NULL, FALSE, 0, NULL, NULL, &startup, &pi),
+        "CreateProcess failed.\n");
+    wait_child_process(pi.hProcess);
+    CloseHandle(pi.hProcess);
+    CloseHandle(pi.hThread);
+}
+
+static void test_font_startup(const char *argv0)
+{
+    struct font_list_info info;
+    DWORD start;
+    int i;
+
+    /* the font list of new processes, whether it comes from the font cache or
+     * from a fresh scan, must match the one of this process */
+    get_font_list_info(&info);
+    for (i = 0; i < 2; i++) run_font_startup_child(argv0, &info);
+
+    if (!winetest_interactive)
+    {
+        skip("font startup benchmark only run in interactive mode\n");
+        return;
+    }
+
+    /* the first process may have to rebuild the font cache, the following ones
+     * show the startup time with a warm cache */
+    for (i = 0; i < 5; i++)
+    {
+        start = GetTickCount();
+        run_font_startup_child(argv0, NULL);
+        trace("process %d: %u ms\n", i, GetTickCount() - start);
+    }
+}
+
+/* draw all the characters in a few sizes on a 32-bpp DIB and return a copy of the result */
+static DWORD *draw_text_bits( int repeat, DWORD *first_time, DWORD *repeat_time )
+{
+    static const int sizes[] = { 11, 13, 16, 24 };
+    BITMAPINFO bmi;
+    WCHAR text[96];
+    DWORD *bits, *ret, start;
+    HBITMAP bitmap;
+    HFONT font, old_font;
+    HDC hdc;
+    int i, j, k;
+
+    for (i = 0; i < ARRAY_SIZE(text); i++) text[i] = 0x20 + i;
+
+    memset( &bmi, 0, sizeof(bmi) );
+    bmi.bmiHeader.biSize = sizeof(bmi.bmiHeader);
+    bmi.bmiHeader.biWidth = 1024;
+    bmi.bmiHeader.biHeight = -128;
+    bmi.bmiHeader.biBitCount = 32;
+    bmi.bmiHeader.biPlanes = 1;
+    bmi.bmiHeader.biCompression = BI_RGB;
+    hdc = CreateCompatibleDC( 0 );
+    bitmap = CreateDIBSection( hdc, &bmi, DIB_RGB_COLORS, (void **)&bits, NULL, 0 );
+    SelectObject( hdc, bitmap );
+    SetTextColor( hdc, RGB(0x20, 0x40, 0x80) );
+    SetBkMode( hdc, TRANSPARENT );
+
+    start = GetTickCount();
+    for (k = 0; k <= repeat; k++)
+    {
+        if (k == 1) *first_time = GetTickCount() - start;
+        memset( bits, 0xff, 1024 * 128 * sizeof(DWORD) );
+        for (i = 0; i < ARRAY_SIZE(sizes); i++)
+        {
+            font = CreateFontA( -sizes[i], 0, 0, 0, FW_NORMAL, 0, 0, 0, DEFAULT_CHARSET, OUT_DEFAULT_PRECIS,
+                                CLIP_DEFAULT_PRECIS, ANTIALIASED_QUALITY, DEFAULT_PITCH, "Tahoma" );
+            old_font = SelectObject( hdc, font );
+            for (j = 0; j < ARRAY_SIZE(text); j += 32)
+                ExtTextOutW( hdc, 2, i * 32 + (j / 32) * 10, 0, NULL, text + j, 32, NULL );
+            SelectObject( hdc, old_font );
+            DeleteObject( font );
+        }
+    }
+    if (repeat) *repeat_time = GetTickCount() - start - *first_time;
+
+    if ((ret = HeapAlloc( GetProcessHeap(), 0, 1024 * 128 * sizeof(DWORD) )))
+        memcpy( ret, bits, 1024 * 128 * sizeof(DWORD) );
+
+    DeleteDC( hdc );
+    DeleteObject( bitmap );
+    return ret;
+}
+
+static void run_glyph_cache_child( const char *argv0, const char *args )
+{
+    char path_name[MAX_PATH + 64];
+    PROCESS_INFORMATION info;
+    STARTUPINFOA startup;
+
+    memset( &startup, 0, sizeof(startup) );
+    startup.cb = sizeof(startup);
+    sprintf( path_name, "%s font %s", argv0, args );
+    ok( CreateProcessA( NULL, path_name, NULL, NULL, FALSE, 0, NULL, NULL, &startup, &info ),
+        "CreateProcess failed.\n" );
+    wait_child_process( info.hProcess );
+    CloseHandle( info.hProcess );
+    CloseHandle( info.hThread );
+}
+
+/* number of glyphs found in the shared cache, if there is one */
+static BOOL get_shared_glyph_hits( LONG *hits )
+{
+    HANDLE mapping;
+    const UINT *header;
+
+    if (!(mapping = OpenFileMappingA( FILE_MAP_READ, FALSE, "__wine_shared_glyph_cache" ))) return FALSE;
+    header = MapViewOfFile( mapping, FILE_MAP_READ, 0, 0, 0 );
+    CloseHandle( mapping );
+    if (!header) return FALSE;
+    *hits = header[5];
+    UnmapViewOfFile( header );
+    return TRUE;
+}
+
+static void test_shared_glyph_cache_child( const char *argv0, int depth )
+{
+    HANDLE mapping;
+    DWORD *bits, *expect;
+    LONG hits_before = 0, hits_after = 0;
+    BOOL shared;
+    char args[64];
+    int i, bad;
+
+    mapping = OpenFileMappingA( FILE_MAP_READ, FALSE, "wine_test_glyph_cache_reference" );
+    ok( mapping != NULL, "OpenFileMapping failed, error %u\n", GetLastError() );
+    if (!mapping) return;
+    expect = MapViewOfFile( mapping, FILE_MAP_READ, 0, 0, 0 );
+    ok( expect != NULL, "MapViewOfFile failed, error %u\n", GetLastError() );
+    CloseHandle( mapping );
+    if (!expect) return;
+
+    get_shared_glyph_hits( &hits_before );
+    bits = draw_text_bits( 0, NULL, NULL );
+    shared = get_shared_glyph_hits( &hits_after );
+    ok( bits != NULL, "failed to draw text\n" );
+    if (bits)
+    {
+        for (i = bad = 0; i < 1024 * 128; i++)
+        {
+            if (bits[i] == expect[i]) continue;
+            if (!bad++) ok( 0, "pixel %d,%d is %08x, expected %08x\n", i % 1024, i / 1024, bits[i], expect[i] );
+        }
+        ok( !bad, "%d pixels differ\n", bad );
+        HeapFree( GetProcessHeap(), 0, bits );
+    }
+    UnmapViewOfFile( expect );
+
+    if (!shared) win_skip( "no shared glyph cache\n" );
+    /* the first process has to rasterize everything, the next ones reuse its glyphs */
+    else if (depth < 2) ok( hits_after > hits_before, "glyphs weren't found in the shared cache\n" );
+
+    if (depth <= 0) return;
+    sprintf( args, "glyphcache %d", depth - 1 );
+    run_glyph_cache_child( argv0, args );
+}
+
+static void test_shared_glyph_cache( const char *argv0 )
+{
+    HANDLE mapping;
+    DWORD *bits, *ptr;
+
+    if (!(bits = draw_text_bits( 0, NULL, NULL ))) return;
+    mapping = CreateFileMappingA( INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, 0, 1024 * 128 * sizeof(DWORD),
+                                  "wine_test_glyph_cache_reference" );
+    ok( mapping != NULL, "CreateFileMapping failed, error %u\n", GetLastError() );
+    if (mapping && (ptr = MapViewOfFile( mapping, FILE_MAP_WRITE, 0, 0, 0 )))
+    {
+        memcpy( ptr, bits, 1024 * 128 * sizeof(DWORD) );
+        UnmapViewOfFile( ptr );
+        SetEnvironmentVariableA( "WINE_SHARED_GLYPH_CACHE", "4" );
+        run_glyph_cache_child( argv0, "glyphcache 2" );
+        SetEnvironmentVariableA( "WINE_SHARED_GLYPH_CACHE", NULL );
+    }
+    CloseHandle( mapping );
+    HeapFree( GetProcessHeap(), 0, bits );
+}
+
+static void test_text_performance_child( const char *argv0, int depth )
+{
+    DWORD first_time, repeat_time;
+
+    HeapFree( GetProcessHeap(), 0, draw_text_bits( 100, &first_time, &repeat_time ));
+    trace( "shared cache %s: first draw %u ms, 100 redraws %u ms\n",
+           getenv( "WINE_SHARED_GLYPH_CACHE" ) ? "on" : "off", first_time, repeat_time );
+    if (depth > 0) run_glyph_cache_child( argv0, "glyphcache_perf 0" );
+}
+
+static void test_text_performance( const char *argv0 )
+{
+    if (!winetest_interactive)
+    {
+        skip( "text drawing benchmark only run in interactive mode\n" );
+        return;
+    }
+
+    /* the second process of each pair starts while the first one keeps the shared cache alive */
+    run_glyph_cache_child( argv0, "glyphcache_perf 1" );
+    SetEnvironmentVariableA( "WINE_SHARED_GLYPH_CACHE", "16" );
+    run_glyph_cache_child( argv0, "glyphcache_perf 1" );
+    SetEnvironmentVariableA( "WINE_SHARED_GLYPH_CACHE", NULL );
+}
+
 START_TEST(font)
 {
     static const char *test_names[] =
@@ -7711,9 +7972,17 @@ START_TEST(font)
     {
         if (!strcmp(argv[2], "AddFontMemResource"))
             test_AddFontMemResource();
+        else if (!strcmp(argv[2], "startup"))
+            test_font_startup_child(argc >= 5 ? atoi(argv[3]) : 0, argc >= 5 ? strtoul(argv[4], NULL, 10) : 0);
+        else if (!strcmp(argv[2], "glyphcache") && argc >= 4)
+            test_shared_glyph_cache_child(argv[0], atoi(argv[3]));
+        else if (!strcmp(argv[2], "glyphcache_perf") && argc >= 4)
+            test_text_performance_child(argv[0], atoi(argv[3]));
         return;
     }
 
+    /* run before the tests that add font resources to this process */
+    test_font_startup(argv[0]);
     test_stock_fonts();
     test_logfont();
     test_bitmap_font();
@@ -7787,6 +8056,8 @@ START_TEST(font)
     test_CreateScalableFontResource();
 
     winetest_get_mainargs( &argv );
+    test_shared_glyph_cache(argv[0]);
+    test_text_performance(argv[0]);
     for (i = 0; i < ARRAY_SIZE(test_names); ++i)
     {
         PROCESS_INFORMATION info;
@@ -34,6 +34,7 @@
 #include "winternl.h"
 #include "winnls.h"
 #include "fileapi.h"
+#include "winioctl.h"
 
 #undef DeleteFile  /* needed for FILE_DISPOSITION_INFO */
 
@@ -1169,23 +1170,17 @@ static void test_CopyFileEx(void)
     ok(hfile != INVALID_HANDLE_VALUE, "failed to open destination file, error %d\n", GetLastError());
     SetLastError(0xdeadbeef);
     retok = CopyFileExA(source, dest, copy_progress_cb, hfile, NULL, 0);
-    todo_wine
     ok(!retok, "CopyFileExA unexpectedly succeeded\n");
-    todo_wine
     ok(GetLastError() == ERROR_REQUEST_ABORTED, "expected ERROR_REQUEST_ABORTED, got %d\n", GetLastError());
     ok(GetFileAttributesA(dest) != INVALID_FILE_ATTRIBUTES, "file was deleted\n");
 
     hfile = CreateFileA(dest, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_WRITE | FILE_SHARE_DELETE,
                         NULL, OPEN_EXISTING, 0, 0);
-    todo_wine
     ok(hfile != INVALID_HANDLE_VALUE, "failed to open destination file, error %d\n", GetLastError());
     SetLastError(0xdeadbeef);
     retok = CopyFileExA(source, dest, copy_progress_cb, hfile, NULL, 0);
-    todo_wine
     ok(!retok, "CopyFileExA unexpectedly succeeded\n");
-    todo_wine
     ok(GetLastError() == ERROR_REQUEST_ABORTED, "expected ERROR_REQUEST_ABORTED, got %d\n", GetLastError());
-    todo_wine
     ok(GetFileAttributesA(dest) == INVALID_FILE_ATTRIBUTES, "file was not deleted\n");
 
     retok = CopyFileExA(source, NULL, copy_progress_cb, hfile, NULL, 0);
@@ -1201,6 +1196,162 @@ static void test_CopyFileEx(void)
     ok(!ret, "DeleteFileA unexpectedly succeeded\n");
 }
 
+#define COPY_LARGE_SIZE (24 * 1024 * 1024)
+
+struct copy_progress_data
+{
+    LARGE_INTEGER transferred;
+    DWORD calls;
+    BOOL *cancel;
+};
+
+static DWORD WINAPI copy_large_progress_cb(LARGE_INTEGER total_size, LARGE_INTEGER total_transferred,
+                                           LARGE_INTEGER stream_size, LARGE_INTEGER stream_transferred,
+                                           DWORD stream, DWORD reason, HANDLE source, HANDLE dest, LPVOID userdata)
+{
+    struct copy_progress_data *data = userdata;
+
+    if (!data->calls)
+        ok(reason == CALLBACK_STREAM_SWITCH, "expected CALLBACK_STREAM_SWITCH, got %u\n", reason);
+    else
+        ok(reason == CALLBACK_CHUNK_FINISHED, "expected CALLBACK_CHUNK_FINISHED, got %u\n", reason);
+    ok(stream == 1, "got stream %u\n", stream);
+    ok(total_size.QuadPart == COPY_LARGE_SIZE, "got total size %s\n", wine_dbgstr_longlong(total_size.QuadPart));
+    ok(total_transferred.QuadPart >= data->transferred.QuadPart, "transferred went backwards\n");
+    ok(total_transferred.QuadPart <= total_size.QuadPart, "transferred more than the file size\n");
+    data->transferred = total_transferred;
+    data->calls++;
+    if (data->cancel && reason == CALLBACK_CHUNK_FINISHED) *data->cancel = TRUE;
+    return PROGRESS_CONTINUE;
+}
+
+/* returns TRUE if the file system can share extents between the two files */
+static BOOL can_duplicate_extents(HANDLE source, HANDLE dest)
+{
+    DUPLICATE_EXTENTS_DATA extents;
+    DWORD size;
+    BOOL ret;
+
+    extents.FileHandle = source;
+    extents.SourceFileOffset.QuadPart = 0;
+    extents.TargetFileOffset.QuadPart = 0;
+    extents.ByteCount.QuadPart = 65536;
+    SetLastError(0xdeadbeef);
+    ret = DeviceIoControl(dest, FSCTL_DUPLICATE_EXTENTS_TO_FILE, &extents, sizeof(extents), NULL, 0, &size, NULL);
+    if (!ret)
+        ok(GetLastError() == ERROR_INVALID_FUNCTION || GetLastError() == ERROR_NOT_SUPPORTED ||
+           GetLastError() == ERROR_INVALID_PARAMETER, "got error %u\n", GetLastError());
+    return ret;
+}
+
+static void test_CopyFileEx_large(void)
+{
+    static const char prefix[] = "pfx";
+    char temp_path[MAX_PATH], source[MAX_PATH], dest[MAX_PATH];
+    struct copy_progress_data data;
+    DWORD ret, size, start, i, j, *buffer, *buffer2;
+    HANDLE hfile, hfile2;
+    BOOL retok, cancel;
+
+    GetTempPathA(MAX_PATH, temp_path);
+    ret = GetTempFileNameA(temp_path, prefix, 0, source);
+    ok(ret != 0, "GetTempFileNameA error %d\n", GetLastError());
+    ret = GetTempFileNameA(temp_path, prefix, 0, dest);
+    ok(ret != 0, "GetTempFileNameA error %d\n", GetLastError());
+
+    buffer = HeapAlloc(GetProcessHeap(), 0, 65536);
+    buffer2 = HeapAlloc(GetProcessHeap(), 0, 65536);
+
+    hfile = CreateFileA(source, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, 0, 0);
+    ok(hfile != INVALID_HANDLE_VALUE, "failed to create source file, error %d\n", GetLastError());
+    for (i = 0; i < COPY_LARGE_SIZE / 65536; i++)
+    {
+        for (j = 0; j < 65536 / sizeof(DWORD); j++) buffer[j] = i * 65536 + j;
+        retok = WriteFile(hfile, buffer, 65536, &size, NULL);
+        ok(retok && size == 65536, "WriteFile error %d\n", GetLastError());
+    }
+    CloseHandle(hfile);
+
+    /* without shared extents the copy falls back to copying the data, which
+     * has to produce the same result */
+    hfile = CreateFileA(source, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, 0, 0);
+    ok(hfile != INVALID_HANDLE_VALUE, "failed to open source file, error %d\n", GetLastError());
+    hfile2 = CreateFileA(dest, GENERIC_READ | GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, 0, 0);
+    ok(hfile2 != INVALID_HANDLE_VALUE, "failed to create destination file, error %d\n", GetLastError());
+    if (!can_duplicate_extents(hfile, hfile2))
+    {
+        trace("file system can't share extents, testing the copy fallback\n");
+        ok(!GetFileSize(hfile2, NULL), "got size %u\n", GetFileSize(hfile2, NULL));
+    }
+    CloseHandle(hfile2);
+    CloseHandle(hfile);
+
+    memset(&data, 0, sizeof(data));
+    start = GetTickCount();
+    retok = CopyFileExA(source, dest, copy_large_progress_cb, &data, NULL, 0);
+    ok(retok, "CopyFileExA failed, error %d\n", GetLastError());
+    if (winetest_interactive)
+        trace("CopyFileExA: %u bytes in %u ms, %u progress calls\n", COPY_LARGE_SIZE,
+              GetTickCount() - start, data.calls);
+    ok(data.calls > 2, "got %u progress calls\n", data.calls);
+    ok(data.transferred.QuadPart == COPY_LARGE_SIZE, "got %s bytes transferred\n",
+       wine_dbgstr_longlong(data.transferred.QuadPart));
+
+    hfile = CreateFileA(source, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, 0, 0);
+    ok(hfile != INVALID_HANDLE_VALUE, "failed to open source file, error %d\n", GetLastError());
+    hfile2 = CreateFileA(dest, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, 0, 0);
+    ok(hfile2 != INVALID_HANDLE_VALUE, "failed to open destination file, error %d\n", GetLastError());
+    ok(GetFileSize(hfile2, NULL) == COPY_LARGE_SIZE, "got size %u\n", GetFileSize(hfile2, NULL));
+    for (i = 0; i < COPY_LARGE_SIZE / 65536; i++)
+    {
+        retok = ReadFile(hfile, buffer, 65536, &size, NULL);
+        ok(retok && size == 65536, "ReadFile error %d\n", GetLastError());
+        retok = ReadFile(hfile2, buffer2, 65536, &size, NULL);
+        ok(retok && size == 65536, "ReadFile error %d\n", GetLastError());
+        if (memcmp(buffer, buffer2, 65536))
+        {
+            ok(0, "data mismatch in block %u\n", i);
+            break;
+        }
+    }
+
+    if (winetest_interactive)
+    {
+        /* compare with a plain copy loop through a user space buffer */
+        SetFilePointer(hfile, 0, NULL, FILE_BEGIN);
+        CloseHandle(hfile2);
+        hfile2 = CreateFileA(dest, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, 0, 0);
+        start = GetTickCount();
+        while (ReadFile(hfile, buffer, 65536, &size, NULL) && size)
+            WriteFile(hfile2, buffer, size, &size, NULL);
+        trace("ReadFile/WriteFile: %u bytes in %u ms\n", COPY_LARGE_SIZE, GetTickCount() - start);
+        CloseHandle(hfile2);
+
+        start = GetTickCount();
+        retok = CopyFileExA(source, dest, NULL, NULL, NULL, 0);
+        ok(retok, "CopyFileExA failed, error %d\n", GetLastError());
+        trace("CopyFileExA without progress: %u bytes in %u ms\n", COPY_LARGE_SIZE, GetTickCount() - start);
+    }
+    else CloseHandle(hfile2);
+    CloseHandle(hfile);
+
+    /* cancelling through the flag pointer deletes the destination */
+    memset(&data, 0, sizeof(data));
+    cancel = FALSE;
+    data.cancel = &cancel;
+    SetLastError(0xdeadbeef);
+    retok = CopyFileExA(source, dest, copy_large_progress_cb, &data, &cancel, 0);
+    ok(!retok, "CopyFileExA unexpectedly succeeded\n");
+    ok(GetLastError() == ERROR_REQUEST_ABORTED, "expected ERROR_REQUEST_ABORTED, got %d\n", GetLastError());
+    ok(data.transferred.QuadPart < COPY_LARGE_SIZE, "copy was not cancelled\n");
+    ok(GetFileAttributesA(dest) == INVALID_FILE_ATTRIBUTES, "file was not deleted\n");
+
+    HeapFree(GetProcessHeap(), 0, buffer);
+    HeapFree(GetProcessHeap(), 0, buffer2);
+    DeleteFileA(source);
+    DeleteFileA(dest);
+}
+
 /*
  *   Debugging routine to dump a buffer in a hexdump-like fashion.
  */
@@ -5382,6 +5533,149 @@ static void test_post_completion(void)
     CloseHandle( port );
 }
 
+#define POST_COMPLETION_PACKETS 20000
+#define POST_COMPLETION_MAX_THREADS 8
+
+static LONG post_completion_seen[POST_COMPLETION_PACKETS];
+
+static DWORD WINAPI post_completion_thread( void *port )
+{
+    OVERLAPPED_ENTRY entries[16];
+    ULONG i, count;
+    BOOL ret, done = FALSE;
+
+    while (!done)
+    {
+        ret = pGetQueuedCompletionStatusEx( port, entries, ARRAY_SIZE(entries), &count, INFINITE, FALSE );
+        ok( ret, "GetQueuedCompletionStatusEx failed: %u\n", GetLastError() );
+        if (!ret) return 1;
+        /* the exit packet may be followed by packets for the other threads, keep them */
+        for (i = 0; i < count; i++)
+        {
+            if (!entries[i].lpCompletionKey)
+            {
+                if (done) PostQueuedCompletionStatus( port, 0, 0, NULL );
+                done = TRUE;
+                continue;
+            }
+            ok( entries[i].lpCompletionKey <= POST_COMPLETION_PACKETS, "wrong key %lu\n", entries[i].lpCompletionKey );
+            ok( entries[i].dwNumberOfBytesTransferred == entries[i].lpCompletionKey * 3,
+                "wrong size %u\n", entries[i].dwNumberOfBytesTransferred );
+            InterlockedIncrement( &post_completion_seen[entries[i].lpCompletionKey - 1] );
+        }
+    }
+    return 0;
+}
+
+static void test_post_completion_threads(void)
+{
+    static const unsigned int thread_counts[] = { 1, 2, 4, POST_COMPLETION_MAX_THREADS };
+    HANDLE port, threads[POST_COMPLETION_MAX_THREADS];
+    unsigned int i, j, missing, duplicate;
+    DWORD start, ret;
+
+    if (!pGetQueuedCompletionStatusEx)
+    {
+        win_skip("GetQueuedCompletionStatusEx not available\n");
+        return;
+    }
+
+    for (i = 0; i < ARRAY_SIZE(thread_counts); i++)
+    {
+        port = CreateIoCompletionPort( INVALID_HANDLE_VALUE, NULL, 0, 0 );
+        ok( port != NULL, "CreateIoCompletionPort failed: %u\n", GetLastError() );
+        memset( post_completion_seen, 0, sizeof(post_completion_seen) );
+
+        for (j = 0; j < thread_counts[i]; j++)
+            threads[j] = CreateThread( NULL, 0, post_completion_thread, port, 0, NULL );
+
+        start = GetTickCount();
+        for (j = 0; j < POST_COMPLETION_PACKETS; j++)
+        {
+            ret = PostQueuedCompletionStatus( port, (j + 1) * 3, j + 1, NULL );
+            ok( ret, "PostQueuedCompletionStatus failed: %u\n", GetLastError() );
+        }
+        for (j = 0; j < thread_counts[i]; j++)
+            PostQueuedCompletionStatus( port, 0, 0, NULL );
+
+        ret = WaitForMultipleObjects( thread_counts[i], threads, TRUE, 30000 );
+        ok( ret < WAIT_OBJECT_0 + thread_counts[i], "wait failed: %u\n", ret );
+        if (ret >= WAIT_OBJECT_0 + thread_counts[i])
+        {
+            for (j = 0; j < thread_counts[i]; j++) TerminateThread( threads[j], 1 );
+            WaitForMultipleObjects( thread_counts[i], threads, TRUE, INFINITE );
+        }
+        if (winetest_interactive)
+            trace( "%u threads: %u packets in %u ms\n", thread_counts[i], POST_COMPLETION_PACKETS,
+                   GetTickCount() - start );
+
+        for (j = missing = duplicate = 0; j < POST_COMPLETION_PACKETS; j++)
+        {
+            if (!post_completion_seen[j]) missing++;
+            else if (post_completion_seen[j] > 1) duplicate++;
+        }
+        ok( !missing, "%u threads: %u packets not received\n", thread_counts[i], missing );
+        ok( !duplicate, "%u threads: %u packets received more than once\n", thread_counts[i], duplicate );
+
+        for (j = 0; j < thread_counts[i]; j++) CloseHandle( threads[j] );
+        CloseHandle( port );
+    }
+}
+
+static void test_completion_order(void)
+{
+    static const char pipe_name[] = "\\\\.\\pipe\\test_completion_order";
+    OVERLAPPED ovl, *povl;
+    HANDLE port, server, client;
+    DWORD size, written;
+    char buffer[16];
+    ULONG_PTR key;
+    BOOL ret;
+
+    server = CreateNamedPipeA( pipe_name, PIPE_ACCESS_DUPLEX | FILE_FLAG_OVERLAPPED, 0, 1, 1000, 1000, 1000, NULL );
+    ok( server != INVALID_HANDLE_VALUE, "CreateNamedPipe failed: %u\n", GetLastError() );
+    client = CreateFileA( pipe_name, GENERIC_READ | GENERIC_WRITE, 0, NULL, OPEN_EXISTING, FILE_FLAG_OVERLAPPED, NULL );
+    ok( client != INVALID_HANDLE_VALUE, "CreateFile failed: %u\n", GetLastError() );
+    port = CreateIoCompletionPort( client, NULL, 2, 0 );
+    ok( port != NULL, "CreateIoCompletionPort failed: %u\n", GetLastError() );
+
+    /* interleave posted packets with an I/O completion */
+    ret = PostQueuedCompletionStatus( port, 0, 1, NULL );
+    ok( ret, "PostQueuedCompletionStatus failed: %u\n", GetLastError() );
+
+    memset( &ovl, 0, sizeof(ovl) );
+    ovl.hEvent = CreateEventW( NULL, TRUE, FALSE, NULL );
+    ret = ReadFile( client, buffer, sizeof(buffer), NULL, &ovl );
+    ok( !ret && GetLastError() == ERROR_IO_PENDING, "ReadFile returned %d, error %u\n", ret, GetLastError() );
+    ret = PostQueuedCompletionStatus( port, 0, 3, NULL );
+    ok( ret, "PostQueuedCompletionStatus failed: %u\n", GetLastError() );
+    ret = WriteFile( server, "data", 4, &written, NULL );
+    ok( ret, "WriteFile failed: %u\n", GetLastError() );
+    ok( !WaitForSingleObject( ovl.hEvent, 1000 ), "read didn't complete\n" );
+    ret = PostQueuedCompletionStatus( port, 0, 4, NULL );
+    ok( ret, "PostQueuedCompletionStatus failed: %u\n", GetLastError() );
+
+    ret = GetQueuedCompletionStatus( port, &size, &key, &povl, 1000 );
+    ok( ret, "GetQueuedCompletionStatus failed: %u\n", GetLastError() );
+    ok( key == 1, "got key %lu\n", key );
+    ret = GetQueuedCompletionStatus( port, &size, &key, &povl, 1000 );
+    ok( ret, "GetQueuedCompletionStatus failed: %u\n", GetLastError() );
+    ok( key == 3, "got key %lu\n", key );
+    ret = GetQueuedCompletionStatus( port, &size, &key, &povl, 1000 );
+    ok( ret, "GetQueuedCompletionStatus failed: %u\n", GetLastError() );
+    ok( key == 2, "got key %lu\n", key );
+    ok( povl == &ovl, "got overlapped %p\n", povl );
+    ok( size == 4, "got size %u\n", size );
+    ret = GetQueuedCompletionStatus( port, &size, &key, &povl, 1000 );
+    ok( ret, "GetQueuedCompletionStatus failed: %u\n", GetLastError() );
+    ok( key == 4, "got key %lu\n", key );
+
+    CloseHandle( ovl.hEvent );
+    CloseHandle( client );
+    CloseHandle( server );
+    CloseHandle( port );
+}
+
 #define TEST_OVERLAPPED_READ_SIZE 4096
 
 static void test_overlapped_read(void)
@@ -5446,6 +5740,100 @@ static void test_overlapped_read(void)
     ok(ret, "Unexpected error %u.\n", GetLastError());
 }
 
+#define QUEUE_DEPTH_FILE_SIZE (1024 * 1024)
+#define QUEUE_DEPTH_BLOCK_SIZE 4096
+#define QUEUE_DEPTH_MAX 64
+
+static void queue_depth_read( HANDLE file, OVERLAPPED *ovl, unsigned char *buffers, OVERLAPPED *base,
+                              unsigned int block )
+{
+    BOOL ret;
+
+    memset( ovl, 0, sizeof(*ovl) );
+    ovl->Offset = block * QUEUE_DEPTH_BLOCK_SIZE;
+    ret = ReadFile( file, buffers + (ovl - base) * QUEUE_DEPTH_BLOCK_SIZE, QUEUE_DEPTH_BLOCK_SIZE, NULL, ovl );
+    ok( ret || GetLastError() == ERROR_IO_PENDING, "ReadFile failed err %u\n", GetLastError() );
+}
+
+static void test_overlapped_queue_depth(void)
+{
+    static const unsigned int depths[] = { 1, 4, 16, QUEUE_DEPTH_MAX };
+    char temp_path[MAX_PATH], file_name[MAX_PATH];
+    unsigned int i, j, requests, issued, done, blocks = QUEUE_DEPTH_FILE_SIZE / QUEUE_DEPTH_BLOCK_SIZE;
+    OVERLAPPED ovl[QUEUE_DEPTH_MAX], *povl;
+    unsigned char *data, *buffers;
+    HANDLE hfile, port, dup;
+    DWORD size, start;
+    ULONG_PTR key;
+    BOOL ret;
+
+    GetTempPathA( MAX_PATH, temp_path );
+    GetTempFileNameA( temp_path, "qd", 0, file_name );
+
+    data = HeapAlloc( GetProcessHeap(), 0, QUEUE_DEPTH_FILE_SIZE );
+    buffers = HeapAlloc( GetProcessHeap(), 0, QUEUE_DEPTH_MAX * QUEUE_DEPTH_BLOCK_SIZE );
+    for (i = 0; i < QUEUE_DEPTH_FILE_SIZE; i++) data[i] = i / QUEUE_DEPTH_BLOCK_SIZE + i;
+
+    hfile = CreateFileA( file_name, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, 0, NULL );
+    ok( hfile != INVALID_HANDLE_VALUE, "CreateFile failed err %u\n", GetLastError() );
+    ret = WriteFile( hfile, data, QUEUE_DEPTH_FILE_SIZE, &size, NULL );
+    ok( ret && size == QUEUE_DEPTH_FILE_SIZE, "WriteFile failed err %u\n", GetLastError() );
+    CloseHandle( hfile );
+
+    hfile = CreateFileA( file_name, GENERIC_READ, 0, NULL, OPEN_EXISTING, FILE_FLAG_OVERLAPPED, NULL );
+    ok( hfile != INVALID_HANDLE_VALUE, "CreateFile failed err %u\n", GetLastError() );
+    port = CreateIoCompletionPort( hfile, NULL, 0xdead, 0 );
+    ok( port != NULL, "CreateIoCompletionPort failed err %u\n", GetLastError() );
+
+    requests = winetest_interactive ? 64 * blocks : 4 * blocks;
+
+    for (i = 0; i < ARRAY_SIZE(depths); i++)
+    {
+        issued = done = 0;
+        start = GetTickCount();
+        for (j = 0; j < depths[i]; j++) queue_depth_read( hfile, &ovl[j], buffers, ovl, issued++ % blocks );
+        while (done < requests)
+        {
+            povl = NULL;
+            ret = GetQueuedCompletionStatus( port, &size, &key, &povl, 5000 );
+            ok( ret, "GetQueuedCompletionStatus failed err %u\n", GetLastError() );
+            if (!ret) break;
+            ok( key == 0xdead, "wrong key %#lx\n", key );
+            ok( size == QUEUE_DEPTH_BLOCK_SIZE, "wrong size %u\n", size );
+            j = povl - ovl;
+            ok( j < depths[i], "wrong overlapped %p\n", povl );
+            if (j >= depths[i]) break;
+            ok( !memcmp( buffers + j * QUEUE_DEPTH_BLOCK_SIZE, data + povl->Offset, QUEUE_DEPTH_BLOCK_SIZE ),
+                "data mismatch at offset %#x\n", povl->Offset );
+            done++;
+            if (issued < requests) queue_depth_read( hfile, povl, buffers, ovl, issued++ % blocks );
+        }
+        /* drain remaining requests if something went wrong */
+        while (done < issued && GetQueuedCompletionStatus( port, &size, &key, &povl, 5000 )) done++;
+        if (winetest_interactive)
+            trace( "queue depth %2u: %u reads in %u ms\n", depths[i], done, GetTickCount() - start );
+    }
+
+    /* the association belongs to the file object, duplicated handles share it */
+    ret = DuplicateHandle( GetCurrentProcess(), hfile, GetCurrentProcess(), &dup, 0, FALSE, DUPLICATE_SAME_ACCESS );
+    ok( ret, "DuplicateHandle failed err %u\n", GetLastError() );
+    queue_depth_read( dup, &ovl[0], buffers, ovl, 3 );
+    povl = NULL;
+    ret = GetQueuedCompletionStatus( port, &size, &key, &povl, 5000 );
+    ok( ret, "GetQueuedCompletionStatus failed err %u\n", GetLastError() );
+    ok( key == 0xdead, "wrong key %#lx\n", key );
+    ok( povl == &ovl[0], "wrong overlapped %p\n", povl );
+    ok( size == QUEUE_DEPTH_BLOCK_SIZE, "wrong size %u\n", size );
+    ok( !memcmp( buffers, data + 3 * QUEUE_DEPTH_BLOCK_SIZE, QUEUE_DEPTH_BLOCK_SIZE ), "data mismatch\n" );
+    CloseHandle( dup );
+
+    CloseHandle( port );
+    CloseHandle( hfile );
+    DeleteFileA( file_name );
+    HeapFree( GetProcessHeap(), 0, buffers );
+    HeapFree( GetProcessHeap(), 0, data );
+}
+
 static void test_file_readonly_access(void)
 {
     static const DWORD default_sharing = FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE;
@@ -5772,6 +6160,7 @@ START_TEST(file)
     test_CopyFileW();
     test_CopyFile2();
     test_CopyFileEx();
+    test_CopyFileEx_large();
     test_CreateFile();
     test_CreateFileA();
     test_CreateFileW();
@@ -5814,7 +6203,10 @@ START_TEST(file)
     test_SetFileInformationByHandle();
     test_GetFileAttributesExW();
     test_post_completion();
+    test_post_completion_threads();
+    test_completion_order();
     test_overlapped_read();
+    test_overlapped_queue_depth();
     test_file_readonly_access();
     test_find_file_stream();
     test_SetFileTime();
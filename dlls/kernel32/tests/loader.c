@@ -30,6 +30,7 @@
 #include "winbase.h"
 #include "winternl.h"
 #include "winnls.h"
+#include "psapi.h"
 #include "wine/test.h"
 #include "delayloadhandler.h"
 
@@ -87,6 +88,7 @@ static BOOL (WINAPI *pIsWow64Process)(HANDLE,PBOOL);
 static BOOL (WINAPI *pWow64DisableWow64FsRedirection)(void **);
 static BOOL (WINAPI *pWow64RevertWow64FsRedirection)(void *);
 static HMODULE (WINAPI *pLoadPackagedLibrary)(LPCWSTR lpwLibFileName, DWORD Reserved);
+static BOOL (WINAPI *pQueryWorkingSetEx)(HANDLE, PVOID, DWORD);
 
 static PVOID RVAToAddr(DWORD_PTR rva, HMODULE module)
 {
@@ -3992,6 +3994,255 @@ static void test_LoadPackagedLibrary(void)
             h, GetLastError());
 }
 
+#define RELOC_DATA_PAGES 16
+#define RELOC_STRIDE     64
+
+/* create a dll whose only section is filled with pointers to themselves, followed by their relocations */
+static DWORD create_relocated_test_dll( char dll_name[MAX_PATH] )
+{
+    IMAGE_NT_HEADERS nt_header = nt_header_template;
+    IMAGE_SECTION_HEADER sec = section;
+    IMAGE_BASE_RELOCATION *rel;
+    DWORD i, j, size, reloc_size, count = page_size / RELOC_STRIDE;
+    WORD *entry;
+    char *data;
+
+    size = (RELOC_DATA_PAGES + 1) * page_size;
+    data = HeapAlloc( GetProcessHeap(), HEAP_ZERO_MEMORY, size );
+
+    rel = (IMAGE_BASE_RELOCATION *)(data + RELOC_DATA_PAGES * page_size);
+    for (i = 0; i < RELOC_DATA_PAGES; i++)
+    {
+        rel->VirtualAddress = page_size + i * page_size;
+        rel->SizeOfBlock = sizeof(*rel) + count * sizeof(WORD);
+        entry = (WORD *)(rel + 1);
+        for (j = 0; j < count; j++)
+        {
+            *(ULONG_PTR *)(data + i * page_size + j * RELOC_STRIDE) =
+                nt_header.OptionalHeader.ImageBase + page_size + i * page_size + j * RELOC_STRIDE;
+#ifdef _WIN64
+            entry[j] = (IMAGE_REL_BASED_DIR64 << 12) | (j * RELOC_STRIDE);
+#else
+            entry[j] = (IMAGE_REL_BASED_HIGHLOW << 12) | (j * RELOC_STRIDE);
+#endif
+        }
+        rel = (IMAGE_BASE_RELOCATION *)(entry + count);
+    }
+    reloc_size = (char *)rel - (data + RELOC_DATA_PAGES * page_size);
+
+    nt_header.FileHeader.NumberOfSections = 1;
+    nt_header.FileHeader.SizeOfOptionalHeader = sizeof(IMAGE_OPTIONAL_HEADER);
+    nt_header.OptionalHeader.SectionAlignment = page_size;
+    nt_header.OptionalHeader.FileAlignment = page_size;
+    nt_header.OptionalHeader.DllCharacteristics = IMAGE_DLLCHARACTERISTICS_DYNAMIC_BASE | IMAGE_DLLCHARACTERISTICS_NX_COMPAT;
+    nt_header.OptionalHeader.SizeOfHeaders = page_size;
+    nt_header.OptionalHeader.SizeOfImage = page_size + size;
+    nt_header.OptionalHeader.NumberOfRvaAndSizes = IMAGE_NUMBEROF_DIRECTORY_ENTRIES;
+    nt_header.OptionalHeader.DataDirectory[IMAGE_DIRECTORY_ENTRY_BASERELOC].VirtualAddress = page_size + RELOC_DATA_PAGES * page_size;
+    nt_header.OptionalHeader.DataDirectory[IMAGE_DIRECTORY_ENTRY_BASERELOC].Size = reloc_size;
+
+    sec.VirtualAddress = page_size;
+    sec.PointerToRawData = page_size;
+    sec.SizeOfRawData = size;
+    sec.Misc.VirtualSize = size;
+    sec.Characteristics = IMAGE_SCN_CNT_CODE | IMAGE_SCN_MEM_EXECUTE | IMAGE_SCN_MEM_READ;
+
+    size = create_test_dll_sections( &dos_header, &nt_header, &sec, data, dll_name );
+    HeapFree( GetProcessHeap(), 0, data );
+    return size;
+}
+
+/* load the dll away from its preferred base, check the relocations and return the number of private pages */
+static DWORD load_relocated_image( const char *dll_name )
+{
+    PSAPI_WORKING_SET_EX_INFORMATION info[RELOC_DATA_PAGES];
+    ULONG_PTR image_base = nt_header_template.OptionalHeader.ImageBase;
+    DWORD i, j, bad = 0, private = 0, count = page_size / RELOC_STRIDE;
+    HMODULE module;
+    void *reserved;
+    char *ptr;
+    BOOL ret;
+
+    /* make sure that the preferred base is taken */
+    reserved = VirtualAlloc( (void *)image_base, page_size, MEM_RESERVE, PAGE_NOACCESS );
+
+    module = LoadLibraryA( dll_name );
+    ok( module != NULL, "LoadLibrary failed, error %u\n", GetLastError() );
+    if (!module)
+    {
+        VirtualFree( reserved, 0, MEM_RELEASE );
+        return ~0u;
+    }
+    ok( (ULONG_PTR)module != image_base, "dll was loaded at its preferred base\n" );
+
+    ptr = (char *)module + page_size;
+    for (i = 0; i < RELOC_DATA_PAGES; i++)
+        for (j = 0; j < count; j++)
+            if (*(ULONG_PTR *)(ptr + i * page_size + j * RELOC_STRIDE) != (ULONG_PTR)(ptr + i * page_size + j * RELOC_STRIDE))
+                bad++;
+    ok( !bad, "%u pointers were not relocated\n", bad );
+
+    if (pQueryWorkingSetEx)
+    {
+        for (i = 0; i < RELOC_DATA_PAGES; i++) info[i].VirtualAddress = ptr + i * page_size;
+        ret = pQueryWorkingSetEx( GetCurrentProcess(), info, sizeof(info) );
+        ok( ret, "QueryWorkingSetEx failed, error %u\n", GetLastError() );
+        for (i = 0; i < RELOC_DATA_PAGES; i++)
+            if (S(info[i].VirtualAttributes).Valid && !S(info[i].VirtualAttributes).Shared) private++;
+    }
+
+    FreeLibrary( module );
+    VirtualFree( reserved, 0, MEM_RELEASE );
+    return private;
+}
+
+static void child_relocated_image( const char *dll_name )
+{
+    DWORD private = load_relocated_image( dll_name );
+
+    *child_failures = winetest_get_failures();
+    ExitProcess( private );
+}
+
+/* map the dll at the address where the parent loaded it and check that the pages are shared with it */
+static void child_relocated_image_at( const char *dll_name, const char *base_str )
+{
+    PSAPI_WORKING_SET_EX_INFORMATION info[RELOC_DATA_PAGES];
+    DWORD i, j, bad = 0, unshared = 0, count = page_size / RELOC_STRIDE;
+    HANDLE file, mapping;
+    NTSTATUS status;
+    void *base = NULL;
+    SIZE_T size = 0;
+    char *ptr;
+    BOOL ret;
+
+    sscanf( base_str, "%p", &base );
+
+    file = CreateFileA( dll_name, GENERIC_READ | GENERIC_EXECUTE, FILE_SHARE_READ, NULL, OPEN_EXISTING, 0, 0 );
+    ok( file != INVALID_HANDLE_VALUE, "CreateFile error %u\n", GetLastError() );
+    mapping = CreateFileMappingA( file, NULL, PAGE_READONLY | SEC_IMAGE, 0, 0, NULL );
+    ok( mapping != 0, "CreateFileMapping error %u\n", GetLastError() );
+    status = pNtMapViewOfSection( mapping, GetCurrentProcess(), &base, 0, 0, NULL, &size,
+                                  1 /* ViewShare */, 0, PAGE_READONLY );
+    CloseHandle( mapping );
+    CloseHandle( file );
+    if (status == STATUS_CONFLICTING_ADDRESSES)
+    {
+        skip( "address %s is not available\n", base_str );
+        goto done;
+    }
+    ok( status == STATUS_IMAGE_NOT_AT_BASE, "NtMapViewOfSection returned %#x\n", status );
+    if (status != STATUS_IMAGE_NOT_AT_BASE) goto done;
+
+    ptr = (char *)base + page_size;
+    for (i = 0; i < RELOC_DATA_PAGES; i++)
+        for (j = 0; j < count; j++)
+            if (*(ULONG_PTR *)(ptr + i * page_size + j * RELOC_STRIDE) != (ULONG_PTR)(ptr + i * page_size + j * RELOC_STRIDE))
+                bad++;
+    ok( !bad, "%u pointers were not relocated\n", bad );
+
+    for (i = 0; i < RELOC_DATA_PAGES; i++) info[i].VirtualAddress = ptr + i * page_size;
+    ret = pQueryWorkingSetEx( GetCurrentProcess(), info, sizeof(info) );
+    ok( ret, "QueryWorkingSetEx failed, error %u\n", GetLastError() );
+    for (i = 0; i < RELOC_DATA_PAGES; i++)
+        if (!S(info[i].VirtualAttributes).Valid || S(info[i].VirtualAttributes).ShareCount < 2) unshared++;
+    ok( !unshared, "%u relocated pages are not shared with the parent\n", unshared );
+
+    pNtUnmapViewOfSection( GetCurrentProcess(), base );
+done:
+    *child_failures = winetest_get_failures();
+    ExitProcess( 0 );
+}
+
+static void test_relocated_image_sharing(void)
+{
+    static const unsigned int nb_processes = 8;
+    PROCESS_INFORMATION pi[8];
+    STARTUPINFOA si = { sizeof(si) };
+    char dll_name[MAX_PATH], cmdline[MAX_PATH * 2];
+    DWORD i, ret, code, private;
+    char **argv;
+
+    if (!create_relocated_test_dll( dll_name ))
+    {
+        ok( 0, "could not create %s\n", dll_name );
+        return;
+    }
+
+    /* whether relocated pages are private is up to the implementation,
+     * sharing is checked below by mapping the image at the same address */
+    private = load_relocated_image( dll_name );
+    if (private) trace( "%u relocated pages are private\n", private );
+
+    if (winetest_interactive)
+    {
+        winetest_get_mainargs( &argv );
+        *child_failures = -1;
+        sprintf( cmdline, "\"%s\" loader relocated %s", argv[0], dll_name );
+        for (i = 0; i < nb_processes; i++)
+        {
+            ret = CreateProcessA( argv[0], cmdline, NULL, NULL, FALSE, 0, NULL, NULL, &si, &pi[i] );
+            ok( ret, "CreateProcess(%s) error %d\n", cmdline, GetLastError() );
+        }
+        for (i = private = 0; i < nb_processes; i++)
+        {
+            ret = WaitForSingleObject( pi[i].hProcess, 10000 );
+            ok( ret == WAIT_OBJECT_0, "child process failed to terminate\n" );
+            if (ret != WAIT_OBJECT_0) TerminateProcess( pi[i].hProcess, ~0u );
+            GetExitCodeProcess( pi[i].hProcess, &code );
+            private += code;
+            CloseHandle( pi[i].hThread );
+            CloseHandle( pi[i].hProcess );
+        }
+        trace( "%u processes: %u private pages out of %u relocated pages\n",
+               nb_processes, private, nb_processes * RELOC_DATA_PAGES );
+        if (*child_failures)
+        {
+            trace( "%d failures in child process\n", *child_failures );
+            winetest_add_failures( *child_failures );
+        }
+    }
+
+    /* a second process mapping the image at the same address uses the same pages */
+    if (pQueryWorkingSetEx && pNtMapViewOfSection)
+    {
+        void *reserved = VirtualAlloc( (void *)nt_header_template.OptionalHeader.ImageBase, page_size,
+                                       MEM_RESERVE, PAGE_NOACCESS );
+        HMODULE module = LoadLibraryA( dll_name );
+
+        ok( module != NULL, "LoadLibrary failed, error %u\n", GetLastError() );
+        if (module)
+        {
+            /* make the pages present in this process */
+            for (i = 0; i < RELOC_DATA_PAGES; i++) code = *(volatile DWORD *)((char *)module + (i + 1) * page_size);
+
+            winetest_get_mainargs( &argv );
+            *child_failures = -1;
+            sprintf( cmdline, "\"%s\" loader relocated_at %s %p", argv[0], dll_name, module );
+            ret = CreateProcessA( argv[0], cmdline, NULL, NULL, FALSE, 0, NULL, NULL, &si, &pi[0] );
+            ok( ret, "CreateProcess(%s) error %d\n", cmdline, GetLastError() );
+            if (ret)
+            {
+                ret = WaitForSingleObject( pi[0].hProcess, 10000 );
+                ok( ret == WAIT_OBJECT_0, "child process failed to terminate\n" );
+                if (ret != WAIT_OBJECT_0) TerminateProcess( pi[0].hProcess, ~0u );
+                CloseHandle( pi[0].hThread );
+                CloseHandle( pi[0].hProcess );
+                if (*child_failures)
+                {
+                    trace( "%d failures in child process\n", *child_failures );
+                    winetest_add_failures( *child_failures );
+                }
+            }
+            FreeLibrary( module );
+        }
+        VirtualFree( reserved, 0, MEM_RELEASE );
+    }
+
+    ret = DeleteFileA( dll_name );
+    ok( ret, "DeleteFile error %d\n", GetLastError() );
+}
+
 START_TEST(loader)
 {
     int argc;
@@ -4030,6 +4281,7 @@ START_TEST(loader)
     pWow64RevertWow64FsRedirection = (void *)GetProcAddress(kernel32, "Wow64RevertWow64FsRedirection");
     pResolveDelayLoadedAPI = (void *)GetProcAddress(kernel32, "ResolveDelayLoadedAPI");
     pLoadPackagedLibrary = (void *)GetProcAddress(kernel32, "LoadPackagedLibrary");
+    pQueryWorkingSetEx = (void *)GetProcAddress(kernel32, "K32QueryWorkingSetEx");
 
     if (pIsWow64Process) pIsWow64Process( GetCurrentProcess(), &is_wow64 );
     GetSystemInfo( &si );
@@ -4048,6 +4300,16 @@ START_TEST(loader)
         *child_failures = -1;
 
     argc = winetest_get_mainargs(&argv);
+    if (argc > 4 && !strcmp(argv[2], "relocated_at"))
+    {
+        child_relocated_image_at(argv[3], argv[4]);
+        return;
+    }
+    if (argc > 3 && !strcmp(argv[2], "relocated"))
+    {
+        child_relocated_image(argv[3]);
+        return;
+    }
     if (argc > 4)
     {
         test_dll_phase = atoi(argv[4]);
@@ -4064,6 +4326,7 @@ START_TEST(loader)
     test_InMemoryOrderModuleList();
     test_LoadPackagedLibrary();
     test_wow64_redirection();
+    test_relocated_image_sharing();
     test_dll_file( "ntdll.dll" );
     test_dll_file( "kernel32.dll" );
     test_dll_file( "advapi32.dll" );
@@ -2256,6 +2256,109 @@ static void test_CompareStringEx(void)
 
 }
 
+static void test_CompareStringEx_long(void)
+{
+    static const struct
+    {
+        const WCHAR *first;
+        const WCHAR *second;
+        DWORD flags;
+        INT ret;
+    }
+    tests[] =
+    {
+        { L"abcdefghijklmnopqrstuvwxyz0123456789a", L"abcdefghijklmnopqrstuvwxyz0123456789A", 0, CSTR_LESS_THAN },
+        { L"abcdefghijklmnopqrstuvwxyz0123456789a", L"abcdefghijklmnopqrstuvwxyz0123456789A", NORM_IGNORECASE, CSTR_EQUAL },
+        { L"abcdefghijklmnopqrstuvwxyz0123456789Ab", L"abcdefghijklmnopqrstuvwxyz0123456789aa", 0, CSTR_GREATER_THAN },
+        { L"abcdefghijklmnopqrstuvwxyz0123456789", L"abcdefghijklmnopqrstuvwxyz0123456789a", 0, CSTR_LESS_THAN },
+        { L"abcdefghijklmnopqrstuvwxyz0123456789coop", L"abcdefghijklmnopqrstuvwxyz0123456789co-op", 0, CSTR_LESS_THAN },
+        { L"abcdefghijklmnopqrstuvwxyz0123456789coop", L"abcdefghijklmnopqrstuvwxyz0123456789co-op", SORT_STRINGSORT, CSTR_GREATER_THAN },
+        { L"abcdefghijklmnopqrstuvwxyz0123456789a b", L"abcdefghijklmnopqrstuvwxyz0123456789ab", 0, CSTR_LESS_THAN },
+        { L"abcdefghijklmnopqrstuvwxyz0123456789a b", L"abcdefghijklmnopqrstuvwxyz0123456789ab", NORM_IGNORESYMBOLS, CSTR_EQUAL },
+        { L"ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789a", L"abcdefghijklmnopqrstuvwxyz0123456789b", 0, CSTR_LESS_THAN },
+        { L"ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789a", L"abcdefghijklmnopqrstuvwxyz0123456789a", 0, CSTR_GREATER_THAN },
+    };
+    INT ret, i;
+
+    if (!pCompareStringEx)
+    {
+        win_skip("CompareStringEx not supported\n");
+        return;
+    }
+
+    for (i = 0; i < ARRAY_SIZE(tests); i++)
+    {
+        ret = pCompareStringEx(L"en-US", tests[i].flags, tests[i].first, -1, tests[i].second, -1, NULL, NULL, 0);
+        ok(ret == tests[i].ret, "%d: got %d, expected %d\n", i, ret, tests[i].ret);
+        ret = pCompareStringEx(L"en-US", tests[i].flags, tests[i].second, -1, tests[i].first, -1, NULL, NULL, 0);
+        ok(ret == 4 - tests[i].ret, "%d: got %d, expected %d\n", i, ret, 4 - tests[i].ret);
+    }
+}
+
+#define SORT_BENCH_COUNT 1000000
+#define SORT_BENCH_LEN   24
+
+static int __cdecl compare_string_ex( const void *p1, const void *p2 )
+{
+    return pCompareStringEx( L"en-US", 0, *(const WCHAR **)p1, -1, *(const WCHAR **)p2, -1, NULL, NULL, 0 ) - CSTR_EQUAL;
+}
+
+static int __cdecl compare_string_ordinal( const void *p1, const void *p2 )
+{
+    return pCompareStringOrdinal( *(const WCHAR **)p1, -1, *(const WCHAR **)p2, -1, TRUE ) - CSTR_EQUAL;
+}
+
+static void test_sort_performance(void)
+{
+    static const WCHAR alphabet[] = L"abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789";
+    WCHAR **strings, *buffer;
+    DWORD start, seed = 1;
+    int i, j;
+
+    if (!winetest_interactive)
+    {
+        skip("string sorting benchmark only run in interactive mode\n");
+        return;
+    }
+    if (!pCompareStringEx || !pCompareStringOrdinal)
+    {
+        win_skip("CompareStringEx or CompareStringOrdinal not supported\n");
+        return;
+    }
+
+    strings = HeapAlloc( GetProcessHeap(), 0, SORT_BENCH_COUNT * sizeof(*strings) );
+    buffer = HeapAlloc( GetProcessHeap(), 0, SORT_BENCH_COUNT * (SORT_BENCH_LEN + 1) * sizeof(WCHAR) );
+
+    /* common prefixes are typical for file names and keys */
+    for (i = 0; i < SORT_BENCH_COUNT; i++)
+    {
+        strings[i] = buffer + i * (SORT_BENCH_LEN + 1);
+        for (j = 0; j < SORT_BENCH_LEN; j++)
+        {
+            seed = seed * 1103515245 + 12345;
+            strings[i][j] = j < SORT_BENCH_LEN / 2 ? alphabet[j] : alphabet[(seed >> 16) % (ARRAY_SIZE(alphabet) - 1)];
+        }
+        strings[i][j] = 0;
+    }
+
+    start = GetTickCount();
+    qsort( strings, SORT_BENCH_COUNT, sizeof(*strings), compare_string_ex );
+    trace( "CompareStringEx: sorted %d strings in %u ms\n", SORT_BENCH_COUNT, GetTickCount() - start );
+    for (i = 1; i < SORT_BENCH_COUNT; i++)
+        if (compare_string_ex( &strings[i - 1], &strings[i] ) > 0) break;
+    ok( i == SORT_BENCH_COUNT, "strings not sorted at %d\n", i );
+
+    start = GetTickCount();
+    qsort( strings, SORT_BENCH_COUNT, sizeof(*strings), compare_string_ordinal );
+    trace( "CompareStringOrdinal: sorted %d strings in %u ms\n", SORT_BENCH_COUNT, GetTickCount() - start );
+    for (i = 1; i < SORT_BENCH_COUNT; i++)
+        if (compare_string_ordinal( &strings[i - 1], &strings[i] ) > 0) break;
+    ok( i == SORT_BENCH_COUNT, "strings not sorted at %d\n", i );
+
+    HeapFree( GetProcessHeap(), 0, buffer );
+    HeapFree( GetProcessHeap(), 0, strings );
+}
+
 static const DWORD lcmap_invalid_flags[] = {
     0,
     LCMAP_HIRAGANA | LCMAP_KATAKANA,
@@ -6936,6 +7039,7 @@ START_TEST(locale)
   test_CompareStringA();
   test_CompareStringW();
   test_CompareStringEx();
+  test_CompareStringEx_long();
   test_LCMapStringA();
   test_LCMapStringW();
   test_LCMapStringEx();
@@ -6965,6 +7069,7 @@ START_TEST(locale)
   test_NormalizeString();
   test_SpecialCasing();
   test_NLSVersion();
+  test_sort_performance();
   /* this requires collation table patch to make it MS compatible */
   if (0) test_sorting();
 }
@@ -2122,6 +2122,80 @@ static void test_write_watch(void)
     VirtualFree( base, 0, MEM_RELEASE );
 }
 
+static void test_write_watch_scan(void)
+{
+    SIZE_T size = winetest_interactive ? 1024 * 1024 * 1024 : 16 * 1024 * 1024;
+    ULONG_PTR count, total, expect;
+    ULONG i, pagesize, cycle;
+    DWORD start, dirty_time = 0, scan_time = 0;
+    void **results;
+    char *base, *addr;
+    UINT ret;
+
+    if (!pGetWriteWatch || !pResetWriteWatch)
+    {
+        win_skip( "GetWriteWatch not supported\n" );
+        return;
+    }
+
+    base = VirtualAlloc( 0, size, MEM_RESERVE | MEM_COMMIT | MEM_WRITE_WATCH, PAGE_READWRITE );
+    if (!base)
+    {
+        skip( "failed to allocate %lu bytes, error %u\n", size, GetLastError() );
+        return;
+    }
+    pagesize = 0x1000;
+    results = VirtualAlloc( 0, (size / pagesize) * sizeof(*results), MEM_COMMIT, PAGE_READWRITE );
+    ok( results != NULL, "VirtualAlloc failed %u\n", GetLastError() );
+
+    /* dirty a different subset of the heap on each cycle and collect it
+     * with a resetting scan, as a garbage collector does with its cards */
+    for (cycle = 0; cycle < 4; cycle++)
+    {
+        start = GetTickCount();
+        for (addr = base + cycle * pagesize, expect = 0; addr < base + size; addr += 3 * pagesize, expect++)
+            *(volatile ULONG_PTR *)addr = cycle;
+        dirty_time += GetTickCount() - start;
+
+        start = GetTickCount();
+        count = size / pagesize;
+        ret = pGetWriteWatch( WRITE_WATCH_FLAG_RESET, base, size, results, &count, &pagesize );
+        scan_time += GetTickCount() - start;
+        ok( !ret, "GetWriteWatch failed %u\n", GetLastError() );
+        ok( count == expect, "cycle %u: got %lu pages instead of %lu\n", cycle, count, expect );
+        for (i = 0; i < count; i++)
+        {
+            if (results[i] == base + (cycle + 3 * i) * pagesize) continue;
+            ok( 0, "cycle %u: wrong result %p at %u\n", cycle, results[i], i );
+            break;
+        }
+    }
+
+    count = size / pagesize;
+    ret = pGetWriteWatch( 0, base, size, results, &count, &pagesize );
+    ok( !ret, "GetWriteWatch failed %u\n", GetLastError() );
+    ok( !count, "got %lu pages after reset\n", count );
+
+    /* retrieving in small batches resets only the returned pages */
+    for (addr = base; addr < base + 16 * pagesize; addr += pagesize) *addr = 1;
+    for (total = 0; ; total += count)
+    {
+        count = 5;
+        ret = pGetWriteWatch( WRITE_WATCH_FLAG_RESET, base, size, results, &count, &pagesize );
+        ok( !ret, "GetWriteWatch failed %u\n", GetLastError() );
+        if (!count) break;
+        ok( results[0] == base + total * pagesize, "wrong result %p\n", results[0] );
+    }
+    ok( total == 16, "got %lu pages\n", total );
+
+    if (winetest_interactive)
+        trace( "%lu MB: dirtied in %u ms, scanned in %u ms over %u cycles\n",
+               size / (1024 * 1024), dirty_time, scan_time, cycle );
+
+    VirtualFree( results, 0, MEM_RELEASE );
+    VirtualFree( base, 0, MEM_RELEASE );
+}
+
 #if defined(__i386__) || defined(__x86_64__)
 
 static DWORD WINAPI stack_commit_func( void *arg )
@@ -4274,6 +4348,7 @@ START_TEST(virtual)
     test_IsBadWritePtr();
     test_IsBadCodePtr();
     test_write_watch();
+    test_write_watch_scan();
 #if defined(__i386__) || defined(__x86_64__)
     test_stack_commit();
 #endif
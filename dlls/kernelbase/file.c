@@ -32,6 +32,7 @@
 #include "winbase.h"
 #include "winnls.h"
 #include "winternl.h"
+#define WINE_FSCTL_EXTENSIONS
 #include "winioctl.h"
 #include "wincon.h"
 #include "fileapi.h"
@@ -491,6 +492,49 @@ BOOL WINAPI DECLSPEC_HOTPATCH AreFileApisANSI(void)
 }
 
 
+/* copy one chunk in the kernel; ntdll shares the data blocks if the file system supports
+ * reflinks, and otherwise copies them without bouncing the data through user space */
+static BOOL copy_file_chunk_offload( HANDLE source, HANDLE dest, ULONGLONG offset, ULONGLONG size,
+                                     ULONGLONG *copied )
+{
+    DUPLICATE_EXTENTS_DATA extents;
+    IO_STATUS_BLOCK io;
+    NTSTATUS status;
+
+    extents.FileHandle = source;
+    extents.SourceFileOffset.QuadPart = offset;
+    extents.TargetFileOffset.QuadPart = offset;
+    extents.ByteCount.QuadPart = size;
+    status = NtFsControlFile( dest, NULL, NULL, NULL, &io, FSCTL_WINE_COPY_FILE_RANGE,
+                              &extents, sizeof(extents), NULL, 0 );
+    if (status)
+    {
+        TRACE( "offload failed with status %08x, using buffered copy\n", status );
+        return FALSE;
+    }
+    *copied = io.Information;
+    return TRUE;
+}
+
+static BOOL copy_file_chunk_buffered( HANDLE source, HANDLE dest, char *buffer, DWORD buffer_size,
+                                      ULONGLONG size, ULONGLONG *copied )
+{
+    DWORD count, res;
+    char *p;
+
+    *copied = 0;
+    while (*copied < size)
+    {
+        if (!ReadFile( source, buffer, min( size - *copied, buffer_size ), &count, NULL )) return FALSE;
+        if (!count) break;
+        *copied += count;
+        for (p = buffer; count; p += res, count -= res)
+            if (!WriteFile( dest, p, count, &res, NULL ) || !res) return FALSE;
+    }
+    return TRUE;
+}
+
+
 /***********************************************************************
  *	CopyFileExW   (kernelbase.@)
  */
@@ -498,10 +542,15 @@ BOOL WINAPI CopyFileExW( const WCHAR *source, const WCHAR *dest, LPPROGRESS_ROUT
                          void *param, BOOL *cancel_ptr, DWORD flags )
 {
     static const int buffer_size = 65536;
+    static const ULONGLONG buffered_chunk_size = 1024 * 1024;
+    static const ULONGLONG offload_chunk_size = 16 * 1024 * 1024;
+    static const ULONGLONG offload_max_size = 0x40000000;
     HANDLE h1, h2;
     BY_HANDLE_FILE_INFORMATION info;
-    DWORD count;
-    BOOL ret = FALSE;
+    LARGE_INTEGER total, transferred;
+    ULONGLONG count;
+    DWORD reason = CALLBACK_STREAM_SWITCH, action;
+    BOOL ret = FALSE, offload = TRUE, can_delete = TRUE;
     char *buffer;
 
     if (!source || !dest)
@@ -551,9 +600,19 @@ BOOL WINAPI CopyFileExW( const WCHAR *source, const WCHAR *dest, LPPROGRESS_ROUT
         }
     }
 
-    if ((h2 = CreateFileW( dest, GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL,
+    /* ask for delete access so that a cancelled copy can be removed,
+     * but don't fail if somebody else prevents that */
+    if ((h2 = CreateFileW( dest, GENERIC_WRITE | DELETE, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL,
                            (flags & COPY_FILE_FAIL_IF_EXISTS) ? CREATE_NEW : CREATE_ALWAYS,
-                           info.dwFileAttributes, h1 )) == INVALID_HANDLE_VALUE)
+                           info.dwFileAttributes, h1 )) == INVALID_HANDLE_VALUE &&
+        (GetLastError() == ERROR_SHARING_VIOLATION || GetLastError() == ERROR_ACCESS_DENIED))
+    {
+        can_delete = FALSE;
+        h2 = CreateFileW( dest, GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL,
+                          (flags & COPY_FILE_FAIL_IF_EXISTS) ? CREATE_NEW : CREATE_ALWAYS,
+                          info.dwFileAttributes, h1 );
+    }
+    if (h2 == INVALID_HANDLE_VALUE)
     {
         WARN("Unable to open dest %s\n", debugstr_w(dest));
         HeapFree( GetProcessHeap(), 0, buffer );
@@ -561,18 +620,59 @@ BOOL WINAPI CopyFileExW( const WCHAR *source, const WCHAR *dest, LPPROGRESS_ROUT
         return FALSE;
     }
 
-    while (ReadFile( h1, buffer, buffer_size, &count, NULL ) && count)
+    total.u.LowPart = info.nFileSizeLow;
+    total.u.HighPart = info.nFileSizeHigh;
+    transferred.QuadPart = 0;
+
+    for (;;)
     {
-        char *p = buffer;
-        while (count != 0)
+        if (cancel_ptr && *cancel_ptr)
         {
-            DWORD res;
-            if (!WriteFile( h2, p, count, &res, NULL ) || !res) goto done;
-            p += res;
-            count -= res;
+            action = PROGRESS_CANCEL;
+            goto abort;
         }
+        if (progress)
+        {
+            if (transferred.QuadPart > total.QuadPart) total = transferred;
+            action = progress( total, transferred, total, transferred, 1, reason, h1, h2, param );
+            switch (action)
+            {
+            case PROGRESS_CONTINUE:
+                break;
+            case PROGRESS_QUIET:
+                progress = NULL;
+                break;
+            case PROGRESS_CANCEL:
+            case PROGRESS_STOP:
+                goto abort;
+            default:
+                FIXME("unhandled progress action %u\n", action);
+                break;
+            }
+        }
+        reason = CALLBACK_CHUNK_FINISHED;
+
+        if (offload)
+        {
+            count = (progress || cancel_ptr) ? offload_chunk_size : offload_max_size;
+            if (!copy_file_chunk_offload( h1, h2, transferred.QuadPart, count, &count ))
+            {
+                /* continue with the buffered copy where the offload stopped */
+                offload = FALSE;
+                if (!SetFilePointerEx( h1, transferred, NULL, FILE_BEGIN ) ||
+                    !SetFilePointerEx( h2, transferred, NULL, FILE_BEGIN ))
+                    goto done;
+                continue;
+            }
+        }
+        else if (!copy_file_chunk_buffered( h1, h2, buffer, buffer_size, buffered_chunk_size, &count ))
+            goto done;
+
+        if (!count) break;
+        transferred.QuadPart += count;
     }
-    ret =  TRUE;
+
+    ret = TRUE;
 done:
     /* Maintain the timestamp of source file to destination file */
     SetFileTime( h2, NULL, NULL, &info.ftLastWriteTime );
@@ -580,6 +680,20 @@ done:
     CloseHandle( h1 );
     CloseHandle( h2 );
     return ret;
+
+abort:
+    if (action == PROGRESS_CANCEL && can_delete)
+    {
+        FILE_DISPOSITION_INFORMATION disposition = { TRUE };
+        IO_STATUS_BLOCK io;
+
+        NtSetInformationFile( h2, &io, &disposition, sizeof(disposition), FileDispositionInformation );
+    }
+    HeapFree( GetProcessHeap(), 0, buffer );
+    CloseHandle( h1 );
+    CloseHandle( h2 );
+    SetLastError( ERROR_REQUEST_ABORTED );
+    return FALSE;
 }
 
 
@@ -592,6 +706,87 @@ BOOL WINAPI DECLSPEC_HOTPATCH CopyFileW( const WCHAR *source, const WCHAR *dest,
 }
 
 
+struct copyfile2_context
+{
+    PCOPYFILE2_PROGRESS_ROUTINE progress;
+    void                       *param;
+    ULONGLONG                   chunk;
+};
+
+static DWORD WINAPI copyfile2_progress( LARGE_INTEGER total_size, LARGE_INTEGER total_transferred,
+                                        LARGE_INTEGER stream_size, LARGE_INTEGER stream_transferred,
+                                        DWORD stream, DWORD reason, HANDLE source, HANDLE dest, void *param )
+{
+    struct copyfile2_context *context = param;
+    COPYFILE2_MESSAGE msg;
+    COPYFILE2_MESSAGE_ACTION action;
+
+    memset( &msg, 0, sizeof(msg) );
+    if (reason == CALLBACK_STREAM_SWITCH)
+    {
+        msg.Type = COPYFILE2_CALLBACK_STREAM_STARTED;
+        msg.Info.StreamStarted.dwStreamNumber = stream;
+        msg.Info.StreamStarted.hSourceFile = source;
+        msg.Info.StreamStarted.hDestinationFile = dest;
+        msg.Info.StreamStarted.uliStreamSize.QuadPart = stream_size.QuadPart;
+        msg.Info.StreamStarted.uliTotalFileSize.QuadPart = total_size.QuadPart;
+    }
+    else
+    {
+        msg.Type = COPYFILE2_CALLBACK_CHUNK_FINISHED;
+        msg.Info.ChunkFinished.dwStreamNumber = stream;
+        msg.Info.ChunkFinished.hSourceFile = source;
+        msg.Info.ChunkFinished.hDestinationFile = dest;
+        msg.Info.ChunkFinished.uliChunkNumber.QuadPart = context->chunk++;
+        msg.Info.ChunkFinished.uliStreamSize.QuadPart = stream_size.QuadPart;
+        msg.Info.ChunkFinished.uliStreamBytesTransferred.QuadPart = stream_transferred.QuadPart;
+        msg.Info.ChunkFinished.uliTotalFileSize.QuadPart = total_size.QuadPart;
+        msg.Info.ChunkFinished.uliTotalBytesTransferred.QuadPart = total_transferred.QuadPart;
+    }
+
+    switch ((action = context->progress( &msg, context->param )))
+    {
+    case COPYFILE2_PROGRESS_CONTINUE: return PROGRESS_CONTINUE;
+    case COPYFILE2_PROGRESS_CANCEL:   return PROGRESS_CANCEL;
+    case COPYFILE2_PROGRESS_STOP:     return PROGRESS_STOP;
+    case COPYFILE2_PROGRESS_QUIET:    return PROGRESS_QUIET;
+    default:
+        FIXME( "unhandled action %u\n", action );
+        return PROGRESS_CONTINUE;
+    }
+}
+
+
+/***********************************************************************
+ *	CopyFile2   (kernelbase.@)
+ */
+HRESULT WINAPI CopyFile2( const WCHAR *source, const WCHAR *dest, COPYFILE2_EXTENDED_PARAMETERS *params )
+{
+    struct copyfile2_context context;
+    DWORD flags = 0;
+    BOOL ret;
+
+    TRACE( "%s -> %s, %p\n", debugstr_w(source), debugstr_w(dest), params );
+
+    if (params)
+    {
+        if (params->dwSize < sizeof(*params)) return E_INVALIDARG;
+        flags = params->dwCopyFlags;
+    }
+
+    if (params && params->pProgressRoutine)
+    {
+        context.progress = params->pProgressRoutine;
+        context.param = params->pvCallbackContext;
+        context.chunk = 0;
+        ret = CopyFileExW( source, dest, copyfile2_progress, &context, params->pfCancel, flags );
+    }
+    else ret = CopyFileExW( source, dest, NULL, NULL, params ? params->pfCancel : NULL, flags );
+
+    return ret ? S_OK : HRESULT_FROM_WIN32( GetLastError() );
+}
+
+
 /***********************************************************************
  *	CreateDirectoryA   (kernelbase.@)
  */
@@ -608,6 +608,26 @@ static struct
     struct sortguid *guids;      /* table of sort GUIDs */
 } sort;
 
+/* collation elements of U+0000..U+00FF, to avoid the three-level lookup for the common case */
+static struct
+{
+    unsigned int ce[256];
+    BOOL         simple[256];  /* compares the same way for all weight types, see compare_simple_weights() */
+} latin1_sort;
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__aarch64__))
+#define USE_VECTOR_COLLATION
+typedef WCHAR vec8w __attribute__((vector_size(16), may_alias));
+typedef UINT64 vec2q __attribute__((vector_size(16), may_alias));
+
+static inline vec8w vec8w_load( const WCHAR *p )
+{
+    vec8w v;
+    __builtin_memcpy( &v, p, sizeof(v) );
+    return v;
+}
+#endif
+
 static CRITICAL_SECTION locale_section;
 static CRITICAL_SECTION_DEBUG critsect_debug =
 {
@@ -622,6 +642,7 @@ static void init_sortkeys( DWORD *ptr )
 {
     WORD *ctype;
     DWORD *table;
+    unsigned int ch, ce;
 
     sort.keys = (DWORD *)((char *)ptr + ptr[0]);
     sort.casemap = (USHORT *)((char *)ptr + ptr[1]);
@@ -634,6 +655,15 @@ static void init_sortkeys( DWORD *ptr )
     sort.version = table[0];
     sort.guid_count = table[1];
     sort.guids = (struct sortguid *)(table + 2);
+
+    for (ch = 0; ch < 256; ch++)
+    {
+        ce = collation_table[collation_table[collation_table[0] + (ch >> 4)] + (ch & 0xf)];
+        latin1_sort.ce[ch] = ce;
+        /* ASCII never decomposes; hyphen and apostrophe depend on SORT_STRINGSORT */
+        latin1_sort.simple[ch] = ch < 0x80 && ch != '-' && ch != '\'' && ce != ~0u &&
+                                 (ce >> 16) && ((ce >> 8) & 0xff) && ((ce >> 4) & 0x0f);
+    }
 }
 
 
@@ -2129,6 +2159,13 @@ static int wcstombs_codepage( UINT codepage, DWORD flags, const WCHAR *src, int
 }
 
 
+static inline unsigned int get_collation_element( WCHAR ch )
+{
+    if (ch < 256) return latin1_sort.ce[ch];
+    return collation_table[collation_table[collation_table[ch >> 8] + ((ch >> 4) & 0x0f)] + (ch & 0xf)];
+}
+
+
 static int get_sortkey( DWORD flags, const WCHAR *src, int srclen, char *dst, int dstlen )
 {
     WCHAR dummy[4]; /* no decomposition is larger than 4 chars */
@@ -2155,7 +2192,7 @@ static int get_sortkey( DWORD flags, const WCHAR *src, int srclen, char *dst, in
 
                 if (flags & NORM_IGNORECASE) wch = casemap( nls_info.LowerCaseTable, wch );
 
-                ce = collation_table[collation_table[collation_table[wch >> 8] + ((wch >> 4) & 0x0f)] + (wch & 0xf)];
+                ce = get_collation_element( wch );
                 if (ce != (unsigned int)-1)
                 {
                     if (ce >> 16) key_len[0] += 2;
@@ -2209,7 +2246,7 @@ static int get_sortkey( DWORD flags, const WCHAR *src, int srclen, char *dst, in
 
                 if (flags & NORM_IGNORECASE) wch = casemap( nls_info.LowerCaseTable, wch );
 
-                ce = collation_table[collation_table[collation_table[wch >> 8] + ((wch >> 4) & 0x0f)] + (wch & 0xf)];
+                ce = get_collation_element( wch );
                 if (ce != (unsigned int)-1)
                 {
                     WCHAR key;
@@ -2468,7 +2505,7 @@ static unsigned int get_weight( WCHAR ch, enum weight type )
 {
     unsigned int ret;
 
-    ret = collation_table[collation_table[collation_table[ch >> 8] + ((ch >> 4) & 0x0f)] + (ch & 0xf)];
+    ret = get_collation_element( ch );
     if (ret == ~0u) return ch;
 
     switch (type)
@@ -2577,6 +2614,62 @@ static int compare_weights(int flags, const WCHAR *str1, int len1,
 }
 
 
+/* Length of the common prefix made of identical simple characters. compare_weights() consumes
+ * such characters in lockstep and finds them equal for all weight types, so it can be skipped. */
+static int get_simple_prefix_len( const WCHAR *str1, const WCHAR *str2, int len )
+{
+    int i = 0;
+
+#ifdef USE_VECTOR_COLLATION
+    for (; i + 16 <= len; i += 16)
+    {
+        vec8w a1 = vec8w_load( str1 + i ), a2 = vec8w_load( str1 + i + 8 );
+        vec8w b1 = vec8w_load( str2 + i ), b2 = vec8w_load( str2 + i + 8 );
+        /* printable ASCII except hyphen and apostrophe */
+        vec2q ok = (vec2q)((a1 == b1) & (a1 - 0x20 < 0x5f) & (a1 != '-') & (a1 != '\'') &
+                           (a2 == b2) & (a2 - 0x20 < 0x5f) & (a2 != '-') & (a2 != '\''));
+        if ((ok[0] & ok[1]) != ~(UINT64)0) break;
+    }
+#endif
+    while (i < len && str1[i] == str2[i] && str1[i] < 256 && latin1_sort.simple[str1[i]]) i++;
+    return i;
+}
+
+
+/* Compare strings of simple characters: all three weight types can be compared in a single pass.
+ * Returns FALSE if a character that needs the full compare_weights() processing is found. */
+static BOOL compare_simple_weights( DWORD flags, const WCHAR *str1, int len1,
+                                    const WCHAR *str2, int len2, int *ret )
+{
+    int i, diacritic = 0, case_weight = 0, len = min( len1, len2 );
+    unsigned int ce1, ce2;
+
+    for (i = 0; i < len; i++)
+    {
+        if (str1[i] >= 256 || !latin1_sort.simple[str1[i]]) return FALSE;
+        if (str2[i] >= 256 || !latin1_sort.simple[str2[i]]) return FALSE;
+        ce1 = latin1_sort.ce[str1[i]];
+        ce2 = latin1_sort.ce[str2[i]];
+        if (ce1 == ce2) continue;
+        if ((ce1 >> 16) != (ce2 >> 16))
+        {
+            *ret = (int)(ce1 >> 16) - (int)(ce2 >> 16);
+            return TRUE;
+        }
+        if (!diacritic) diacritic = (int)((ce1 >> 8) & 0xff) - (int)((ce2 >> 8) & 0xff);
+        if (!case_weight) case_weight = (int)((ce1 >> 4) & 0x0f) - (int)((ce2 >> 4) & 0x0f);
+    }
+    /* the remaining characters of the longer string must not be ignorable */
+    for (; i < len1; i++) if (str1[i] >= 256 || !latin1_sort.simple[str1[i]]) return FALSE;
+    for (; i < len2; i++) if (str2[i] >= 256 || !latin1_sort.simple[str2[i]]) return FALSE;
+
+    *ret = len1 - len2;
+    if (!*ret && !(flags & NORM_IGNORENONSPACE)) *ret = diacritic;
+    if (!*ret && !(flags & NORM_IGNORECASE)) *ret = case_weight;
+    return TRUE;
+}
+
+
 static const struct geoinfo *get_geoinfo_ptr( GEOID geoid )
 {
     int min = 0, max = ARRAY_SIZE( geoinfodata )-1;
@@ -3023,7 +3116,7 @@ INT WINAPI CompareStringEx( const WCHAR *locale, DWORD flags, const WCHAR *str1,
                             NORM_IGNOREKANATYPE | NORM_IGNOREWIDTH | LOCALE_USE_CP_ACP;
     DWORD semistub_flags = NORM_LINGUISTIC_CASING | LINGUISTIC_IGNORECASE | 0x10000000;
     /* 0x10000000 is related to diacritics in Arabic, Japanese, and Hebrew */
-    INT ret;
+    INT ret, prefix;
     static int once;
 
     if (version) FIXME( "unexpected version parameter\n" );
@@ -3050,13 +3143,22 @@ INT WINAPI CompareStringEx( const WCHAR *locale, DWORD flags, const WCHAR *str1,
     if (len1 < 0) len1 = lstrlenW(str1);
     if (len2 < 0) len2 = lstrlenW(str2);
 
-    ret = compare_weights( flags, str1, len1, str2, len2, UNICODE_WEIGHT );
-    if (!ret)
+    prefix = get_simple_prefix_len( str1, str2, min( len1, len2 ));
+    str1 += prefix;
+    str2 += prefix;
+    len1 -= prefix;
+    len2 -= prefix;
+
+    if ((flags & NORM_IGNORESYMBOLS) || !compare_simple_weights( flags, str1, len1, str2, len2, &ret ))
     {
-        if (!(flags & NORM_IGNORENONSPACE))
-            ret = compare_weights( flags, str1, len1, str2, len2, DIACRITIC_WEIGHT );
-        if (!ret && !(flags & NORM_IGNORECASE))
-            ret = compare_weights( flags, str1, len1, str2, len2, CASE_WEIGHT );
+        ret = compare_weights( flags, str1, len1, str2, len2, UNICODE_WEIGHT );
+        if (!ret)
+        {
+            if (!(flags & NORM_IGNORENONSPACE))
+                ret = compare_weights( flags, str1, len1, str2, len2, DIACRITIC_WEIGHT );
+            if (!ret && !(flags & NORM_IGNORECASE))
+                ret = compare_weights( flags, str1, len1, str2, len2, CASE_WEIGHT );
+        }
     }
     if (!ret) return CSTR_EQUAL;
     return (ret < 0) ? CSTR_LESS_THAN : CSTR_GREATER_THAN;
@@ -50,14 +50,14 @@
 @ cdecl -arch=win64 ??0bad_typeid@std@@QEAA@AEBV01@@Z(ptr ptr) bad_typeid_copy_ctor
 @ thiscall -arch=i386 ??0bad_typeid@std@@QAE@PBD@Z(ptr str) bad_typeid_ctor
 @ cdecl -arch=win64 ??0bad_typeid@std@@QEAA@PEBD@Z(ptr str) bad_typeid_ctor
-@ stub -arch=win32 ??0context_self_unblock@Concurrency@@QAE@PBD@Z
-@ stub -arch=win64 ??0context_self_unblock@Concurrency@@QEAA@PEBD@Z
-@ stub -arch=win32 ??0context_self_unblock@Concurrency@@QAE@XZ
-@ stub -arch=win64 ??0context_self_unblock@Concurrency@@QEAA@XZ
-@ stub -arch=win32 ??0context_unblock_unbalanced@Concurrency@@QAE@PBD@Z
-@ stub -arch=win64 ??0context_unblock_unbalanced@Concurrency@@QEAA@PEBD@Z
-@ stub -arch=win32 ??0context_unblock_unbalanced@Concurrency@@QAE@XZ
-@ stub -arch=win64 ??0context_unblock_unbalanced@Concurrency@@QEAA@XZ
+@ thiscall -arch=i386 ??0context_self_unblock@Concurrency@@QAE@PBD@Z(ptr str) context_self_unblock_ctor_str
+@ cdecl -arch=win64 ??0context_self_unblock@Concurrency@@QEAA@PEBD@Z(ptr str) context_self_unblock_ctor_str
+@ thiscall -arch=i386 ??0context_self_unblock@Concurrency@@QAE@XZ(ptr) context_self_unblock_ctor
+@ cdecl -arch=win64 ??0context_self_unblock@Concurrency@@QEAA@XZ(ptr) context_self_unblock_ctor
+@ thiscall -arch=i386 ??0context_unblock_unbalanced@Concurrency@@QAE@PBD@Z(ptr str) context_unblock_unbalanced_ctor_str
+@ cdecl -arch=win64 ??0context_unblock_unbalanced@Concurrency@@QEAA@PEBD@Z(ptr str) context_unblock_unbalanced_ctor_str
+@ thiscall -arch=i386 ??0context_unblock_unbalanced@Concurrency@@QAE@XZ(ptr) context_unblock_unbalanced_ctor
+@ cdecl -arch=win64 ??0context_unblock_unbalanced@Concurrency@@QEAA@XZ(ptr) context_unblock_unbalanced_ctor
 @ thiscall -arch=win32 ??0critical_section@Concurrency@@QAE@XZ(ptr) critical_section_ctor
 @ cdecl -arch=win64 ??0critical_section@Concurrency@@QEAA@XZ(ptr) critical_section_ctor
 @ stub -arch=win32 ??0default_scheduler_exists@Concurrency@@QAE@PBD@Z
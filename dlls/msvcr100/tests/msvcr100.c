@@ -148,10 +148,19 @@ typedef struct {
     char pad[64];
 } event;
 
+struct ContextVtbl;
 typedef struct {
-    void *vtable;
+    struct ContextVtbl *vtable;
 } Context;
 
+struct ContextVtbl {
+    unsigned int (__thiscall *GetId)(const Context*);
+    unsigned int (__thiscall *GetVirtualProcessorId)(const Context*);
+    unsigned int (__thiscall *GetScheduleGroupId)(const Context*);
+    void (__thiscall *Unblock)(Context*);
+    MSVCRT_bool (__thiscall *IsSynchronouslyBlocked)(const Context*);
+};
+
 typedef struct {
     void *policy_container;
 } SchedulerPolicy;
@@ -170,8 +179,8 @@ struct SchedulerVtbl {
     unsigned int (__thiscall *Release)(Scheduler*);
     void (__thiscall *RegisterShutdownEvent)(Scheduler*,HANDLE);
     void (__thiscall *Attach)(Scheduler*);
-    /* CreateScheduleGroup */
-    /* ScheduleTask */
+    void* (__thiscall *CreateScheduleGroup)(Scheduler*);
+    void (__thiscall *ScheduleTask)(Scheduler*,void (__cdecl*)(void*),void*);
 };
 
 static int* (__cdecl *p_errno)(void);
@@ -223,6 +232,8 @@ static int (__cdecl *p_event_wait_for_multiple)(event**, size_t, MSVCRT_bool, un
 
 static Context* (__cdecl *p_Context_CurrentContext)(void);
 static unsigned int (__cdecl *p_Context_Id)(void);
+static unsigned int (__cdecl *p_Context_VirtualProcessorId)(void);
+static void (__cdecl *p_Context_Block)(void);
 static SchedulerPolicy* (__thiscall *p_SchedulerPolicy_ctor)(SchedulerPolicy*);
 static void (__thiscall *p_SchedulerPolicy_SetConcurrencyLimits)(SchedulerPolicy*, unsigned int, unsigned int);
 static void (__thiscall *p_SchedulerPolicy_dtor)(SchedulerPolicy*);
@@ -230,6 +241,7 @@ static Scheduler* (__cdecl *p_Scheduler_Create)(SchedulerPolicy*);
 static Scheduler* (__cdecl *p_CurrentScheduler_Get)(void);
 static void (__cdecl *p_CurrentScheduler_Detach)(void);
 static unsigned int (__cdecl *p_CurrentScheduler_Id)(void);
+static void (__cdecl *p_CurrentScheduler_ScheduleTask)(void (__cdecl*)(void*), void*);
 
 static int (__cdecl *p__memicmp)(const char*, const char*, size_t);
 static int (__cdecl *p__memicmp_l)(const char*, const char*, size_t,_locale_t);
@@ -274,6 +286,8 @@ static BOOL init(void)
     SET(p___strncnt, "__strncnt");
 
     SET(p_Context_Id, "?Id@Context@Concurrency@@SAIXZ");
+    SET(p_Context_VirtualProcessorId, "?VirtualProcessorId@Context@Concurrency@@SAIXZ");
+    SET(p_Context_Block, "?Block@Context@Concurrency@@SAXXZ");
     SET(p_CurrentScheduler_Detach, "?Detach@CurrentScheduler@Concurrency@@SAXXZ");
     SET(p_CurrentScheduler_Id, "?Id@CurrentScheduler@Concurrency@@SAIXZ");
 
@@ -318,6 +332,7 @@ static BOOL init(void)
         SET(p_SchedulerPolicy_dtor, "??1SchedulerPolicy@Concurrency@@QEAA@XZ");
         SET(p_Scheduler_Create, "?Create@Scheduler@Concurrency@@SAPEAV12@AEBVSchedulerPolicy@2@@Z");
         SET(p_CurrentScheduler_Get, "?Get@CurrentScheduler@Concurrency@@SAPEAVScheduler@2@XZ");
+        SET(p_CurrentScheduler_ScheduleTask, "?ScheduleTask@CurrentScheduler@Concurrency@@SAXP6AXPEAX@Z0@Z");
     } else {
         SET(pSpinWait_ctor_yield, "??0?$_SpinWait@$00@details@Concurrency@@QAE@P6AXXZ@Z");
         SET(pSpinWait_dtor, "??_F?$_SpinWait@$00@details@Concurrency@@QAEXXZ");
@@ -359,6 +374,7 @@ static BOOL init(void)
         SET(p_SchedulerPolicy_dtor, "??1SchedulerPolicy@Concurrency@@QAE@XZ");
         SET(p_Scheduler_Create, "?Create@Scheduler@Concurrency@@SAPAV12@ABVSchedulerPolicy@2@@Z");
         SET(p_CurrentScheduler_Get, "?Get@CurrentScheduler@Concurrency@@SAPAVScheduler@2@XZ");
+        SET(p_CurrentScheduler_ScheduleTask, "?ScheduleTask@CurrentScheduler@Concurrency@@SAXP6AXPAX@Z0@Z");
     }
 
     init_thiscall_thunk();
@@ -989,6 +1005,236 @@ static void test_Scheduler(void)
     call_func1(p_SchedulerPolicy_dtor, &policy);
 }
 
+#define PARALLEL_FOR_SIZE 4096
+#define PARALLEL_FOR_GRAIN 16
+
+struct parallel_for_data
+{
+    LONG hits[PARALLEL_FOR_SIZE];
+    LONG pending;
+    LONG bad_vproc;
+    unsigned int vprocs;
+    HANDLE done;
+};
+
+struct parallel_for_range
+{
+    struct parallel_for_data *data;
+    unsigned int begin;
+    unsigned int end;
+};
+
+static void __cdecl parallel_for_task(void *arg)
+{
+    struct parallel_for_range *range = arg, *split;
+    struct parallel_for_data *data = range->data;
+    unsigned int i;
+
+    /* keep half of the range and hand the rest to the scheduler */
+    while (range->end - range->begin > PARALLEL_FOR_GRAIN)
+    {
+        split = malloc(sizeof(*split));
+        split->data = data;
+        split->begin = (range->begin + range->end) / 2;
+        split->end = range->end;
+        range->end = split->begin;
+        InterlockedIncrement(&data->pending);
+        p_CurrentScheduler_ScheduleTask(parallel_for_task, split);
+    }
+
+    if (p_Context_VirtualProcessorId() >= data->vprocs)
+        InterlockedIncrement(&data->bad_vproc);
+    for (i = range->begin; i < range->end; i++)
+        InterlockedIncrement(&data->hits[i]);
+
+    free(range);
+    if (!InterlockedDecrement(&data->pending))
+        SetEvent(data->done);
+}
+
+static void __cdecl count_task(void *arg)
+{
+    struct parallel_for_data *data = arg;
+
+    if (!InterlockedDecrement(&data->pending))
+        SetEvent(data->done);
+}
+
+struct block_data
+{
+    Context *context;
+    HANDLE started;
+    HANDLE resumed;
+};
+
+static void __cdecl block_task(void *arg)
+{
+    struct block_data *data = arg;
+
+    data->context = p_Context_CurrentContext();
+    SetEvent(data->started);
+    p_Context_Block();
+    SetEvent(data->resumed);
+}
+
+static void __cdecl set_event_task(void *arg)
+{
+    SetEvent(arg);
+}
+
+struct release_data
+{
+    Scheduler *scheduler;
+    struct block_data *block;
+    HANDLE released;
+};
+
+static void __cdecl release_task(void *arg)
+{
+    struct release_data *data = arg;
+
+    call_func1(data->scheduler->vtable->Release, data->scheduler);
+    SetEvent(data->released);
+    /* the scheduler must stay usable for the workers that are still running */
+    p_CurrentScheduler_ScheduleTask(set_event_task, data->block->started);
+}
+
+/* release the last reference from a worker while another worker is blocked */
+static void test_scheduler_release(void)
+{
+    struct release_data data;
+    struct block_data block;
+    SchedulerPolicy policy;
+    HANDLE shutdown;
+    DWORD ret;
+    int tries;
+
+    call_func1(p_SchedulerPolicy_ctor, &policy);
+    call_func3(p_SchedulerPolicy_SetConcurrencyLimits, &policy, 2, 2);
+    data.scheduler = p_Scheduler_Create(&policy);
+    call_func1(p_SchedulerPolicy_dtor, &policy);
+    ok(data.scheduler != NULL, "Scheduler::Create() = NULL\n");
+
+    shutdown = CreateEventW(NULL, TRUE, FALSE, NULL);
+    call_func2(data.scheduler->vtable->RegisterShutdownEvent, data.scheduler, shutdown);
+
+    block.context = NULL;
+    block.started = CreateEventW(NULL, FALSE, FALSE, NULL);
+    block.resumed = CreateEventW(NULL, FALSE, FALSE, NULL);
+    call_func3(data.scheduler->vtable->ScheduleTask, data.scheduler, block_task, &block);
+    ret = WaitForSingleObject(block.started, 5000);
+    ok(ret == WAIT_OBJECT_0, "WaitForSingleObject returned %d\n", ret);
+    for (tries = 0; tries < 500; tries++)
+    {
+        if (call_func1(block.context->vtable->IsSynchronouslyBlocked, block.context)) break;
+        Sleep(10);
+    }
+    ok(tries < 500, "context is not blocked\n");
+
+    data.block = &block;
+    data.released = CreateEventW(NULL, FALSE, FALSE, NULL);
+    call_func3(data.scheduler->vtable->ScheduleTask, data.scheduler, release_task, &data);
+    ret = WaitForSingleObject(data.released, 5000);
+    ok(ret == WAIT_OBJECT_0, "Release didn't return, WaitForSingleObject returned %d\n", ret);
+    ret = WaitForSingleObject(block.started, 5000);
+    ok(ret == WAIT_OBJECT_0, "task scheduled after Release didn't run, WaitForSingleObject returned %d\n", ret);
+    ret = WaitForSingleObject(shutdown, 0);
+    ok(ret == WAIT_TIMEOUT, "scheduler shut down with a blocked context\n");
+
+    call_func1(block.context->vtable->Unblock, block.context);
+    ret = WaitForSingleObject(block.resumed, 5000);
+    ok(ret == WAIT_OBJECT_0, "WaitForSingleObject returned %d\n", ret);
+    ret = WaitForSingleObject(shutdown, 5000);
+    ok(ret == WAIT_OBJECT_0, "scheduler didn't shut down, WaitForSingleObject returned %d\n", ret);
+
+    CloseHandle(data.released);
+    CloseHandle(block.started);
+    CloseHandle(block.resumed);
+    CloseHandle(shutdown);
+}
+
+static void test_ScheduleTask(void)
+{
+    struct parallel_for_data *data;
+    struct parallel_for_range *range;
+    struct block_data block;
+    LARGE_INTEGER freq, start, end;
+    unsigned int i, id;
+    HANDLE event;
+    SYSTEM_INFO si;
+    DWORD ret;
+    int tries;
+
+    id = p_Context_VirtualProcessorId();
+    ok(id == -1, "Context::VirtualProcessorId() = %d\n", id);
+
+    GetSystemInfo(&si);
+    data = calloc(1, sizeof(*data));
+    data->vprocs = si.dwNumberOfProcessors;
+    data->done = CreateEventW(NULL, FALSE, FALSE, NULL);
+    data->pending = 1;
+    range = malloc(sizeof(*range));
+    range->data = data;
+    range->begin = 0;
+    range->end = PARALLEL_FOR_SIZE;
+    p_CurrentScheduler_ScheduleTask(parallel_for_task, range);
+
+    ret = WaitForSingleObject(data->done, 10000);
+    ok(ret == WAIT_OBJECT_0, "WaitForSingleObject returned %d\n", ret);
+    for (i = 0; i < PARALLEL_FOR_SIZE; i++)
+        if (data->hits[i] != 1) break;
+    ok(i == PARALLEL_FOR_SIZE, "hits[%u] = %d\n", i, i < PARALLEL_FOR_SIZE ? data->hits[i] : 0);
+    ok(!data->bad_vproc, "%d tasks got an invalid virtual processor id\n", data->bad_vproc);
+
+    /* a blocked task doesn't prevent other tasks from running */
+    block.context = NULL;
+    block.started = CreateEventW(NULL, FALSE, FALSE, NULL);
+    block.resumed = CreateEventW(NULL, FALSE, FALSE, NULL);
+    event = CreateEventW(NULL, FALSE, FALSE, NULL);
+    p_CurrentScheduler_ScheduleTask(block_task, &block);
+    ret = WaitForSingleObject(block.started, 5000);
+    ok(ret == WAIT_OBJECT_0, "WaitForSingleObject returned %d\n", ret);
+    ok(block.context != NULL, "context = NULL\n");
+
+    for (tries = 0; tries < 500; tries++)
+    {
+        if (call_func1(block.context->vtable->IsSynchronouslyBlocked, block.context)) break;
+        Sleep(10);
+    }
+    ok(tries < 500, "context is not blocked\n");
+
+    p_CurrentScheduler_ScheduleTask(set_event_task, event);
+    ret = WaitForSingleObject(event, 5000);
+    ok(ret == WAIT_OBJECT_0, "WaitForSingleObject returned %d\n", ret);
+    ret = WaitForSingleObject(block.resumed, 0);
+    ok(ret == WAIT_TIMEOUT, "WaitForSingleObject returned %d\n", ret);
+
+    call_func1(block.context->vtable->Unblock, block.context);
+    ret = WaitForSingleObject(block.resumed, 5000);
+    ok(ret == WAIT_OBJECT_0, "WaitForSingleObject returned %d\n", ret);
+    CloseHandle(block.started);
+    CloseHandle(block.resumed);
+    CloseHandle(event);
+
+    if (winetest_interactive)
+    {
+        static const unsigned int count = 1000000;
+
+        QueryPerformanceFrequency(&freq);
+        data->pending = count;
+        QueryPerformanceCounter(&start);
+        for (i = 0; i < count; i++)
+            p_CurrentScheduler_ScheduleTask(count_task, data);
+        WaitForSingleObject(data->done, INFINITE);
+        QueryPerformanceCounter(&end);
+        trace("%u tasks in %.3f ms\n", count,
+                (end.QuadPart - start.QuadPart) * 1000.0 / freq.QuadPart);
+    }
+
+    CloseHandle(data->done);
+    free(data);
+}
+
 static void test__memicmp(void)
 {
     static const char *s1 = "abc";
@@ -1113,6 +1359,8 @@ START_TEST(msvcr100)
 
     test_ExternalContextBase();
     test_Scheduler();
+    test_ScheduleTask();
+    test_scheduler_release();
     test_wmemcpy_s();
     test_wmemmove_s();
     test_fread_s();
@@ -98,18 +98,18 @@
 @ cdecl -arch=arm ??0bad_typeid@std@@QAA@PBD@Z(ptr str) bad_typeid_ctor
 @ thiscall -arch=i386 ??0bad_typeid@std@@QAE@PBD@Z(ptr str) bad_typeid_ctor
 @ cdecl -arch=win64 ??0bad_typeid@std@@QEAA@PEBD@Z(ptr str) bad_typeid_ctor
-@ stub -arch=arm ??0context_self_unblock@Concurrency@@QAA@PBD@Z
-@ stub -arch=i386 ??0context_self_unblock@Concurrency@@QAE@PBD@Z
-@ stub -arch=win64 ??0context_self_unblock@Concurrency@@QEAA@PEBD@Z
-@ stub -arch=arm ??0context_self_unblock@Concurrency@@QAA@XZ
-@ stub -arch=i386 ??0context_self_unblock@Concurrency@@QAE@XZ
-@ stub -arch=win64 ??0context_self_unblock@Concurrency@@QEAA@XZ
-@ stub -arch=arm ??0context_unblock_unbalanced@Concurrency@@QAA@PBD@Z
-@ stub -arch=i386 ??0context_unblock_unbalanced@Concurrency@@QAE@PBD@Z
-@ stub -arch=win64 ??0context_unblock_unbalanced@Concurrency@@QEAA@PEBD@Z
-@ stub -arch=arm ??0context_unblock_unbalanced@Concurrency@@QAA@XZ
-@ stub -arch=i386 ??0context_unblock_unbalanced@Concurrency@@QAE@XZ
-@ stub -arch=win64 ??0context_unblock_unbalanced@Concurrency@@QEAA@XZ
+@ cdecl -arch=arm ??0context_self_unblock@Concurrency@@QAA@PBD@Z(ptr str) context_self_unblock_ctor_str
+@ thiscall -arch=i386 ??0context_self_unblock@Concurrency@@QAE@PBD@Z(ptr str) context_self_unblock_ctor_str
+@ cdecl -arch=win64 ??0context_self_unblock@Concurrency@@QEAA@PEBD@Z(ptr str) context_self_unblock_ctor_str
+@ cdecl -arch=arm ??0context_self_unblock@Concurrency@@QAA@XZ(ptr) context_self_unblock_ctor
+@ thiscall -arch=i386 ??0context_self_unblock@Concurrency@@QAE@XZ(ptr) context_self_unblock_ctor
+@ cdecl -arch=win64 ??0context_self_unblock@Concurrency@@QEAA@XZ(ptr) context_self_unblock_ctor
+@ cdecl -arch=arm ??0context_unblock_unbalanced@Concurrency@@QAA@PBD@Z(ptr str) context_unblock_unbalanced_ctor_str
+@ thiscall -arch=i386 ??0context_unblock_unbalanced@Concurrency@@QAE@PBD@Z(ptr str) context_unblock_unbalanced_ctor_str
+@ cdecl -arch=win64 ??0context_unblock_unbalanced@Concurrency@@QEAA@PEBD@Z(ptr str) context_unblock_unbalanced_ctor_str
+@ cdecl -arch=arm ??0context_unblock_unbalanced@Concurrency@@QAA@XZ(ptr) context_unblock_unbalanced_ctor
+@ thiscall -arch=i386 ??0context_unblock_unbalanced@Concurrency@@QAE@XZ(ptr) context_unblock_unbalanced_ctor
+@ cdecl -arch=win64 ??0context_unblock_unbalanced@Concurrency@@QEAA@XZ(ptr) context_unblock_unbalanced_ctor
 @ cdecl -arch=arm ??0critical_section@Concurrency@@QAA@XZ(ptr) critical_section_ctor
 @ thiscall -arch=i386 ??0critical_section@Concurrency@@QAE@XZ(ptr) critical_section_ctor
 @ cdecl -arch=win64 ??0critical_section@Concurrency@@QEAA@XZ(ptr) critical_section_ctor
@@ -96,18 +96,18 @@
 @ cdecl -arch=arm ??0bad_typeid@std@@QAA@PBD@Z(ptr str) msvcr120.??0bad_typeid@std@@QAA@PBD@Z
 @ thiscall -arch=i386 ??0bad_typeid@std@@QAE@PBD@Z(ptr str) msvcr120.??0bad_typeid@std@@QAE@PBD@Z
 @ cdecl -arch=win64 ??0bad_typeid@std@@QEAA@PEBD@Z(ptr str) msvcr120.??0bad_typeid@std@@QEAA@PEBD@Z
-@ stub -arch=arm ??0context_self_unblock@Concurrency@@QAA@PBD@Z
-@ stub -arch=i386 ??0context_self_unblock@Concurrency@@QAE@PBD@Z
-@ stub -arch=win64 ??0context_self_unblock@Concurrency@@QEAA@PEBD@Z
-@ stub -arch=arm ??0context_self_unblock@Concurrency@@QAA@XZ
-@ stub -arch=i386 ??0context_self_unblock@Concurrency@@QAE@XZ
-@ stub -arch=win64 ??0context_self_unblock@Concurrency@@QEAA@XZ
-@ stub -arch=arm ??0context_unblock_unbalanced@Concurrency@@QAA@PBD@Z
-@ stub -arch=i386 ??0context_unblock_unbalanced@Concurrency@@QAE@PBD@Z
-@ stub -arch=win64 ??0context_unblock_unbalanced@Concurrency@@QEAA@PEBD@Z
-@ stub -arch=arm ??0context_unblock_unbalanced@Concurrency@@QAA@XZ
-@ stub -arch=i386 ??0context_unblock_unbalanced@Concurrency@@QAE@XZ
-@ stub -arch=win64 ??0context_unblock_unbalanced@Concurrency@@QEAA@XZ
+@ cdecl -arch=arm ??0context_self_unblock@Concurrency@@QAA@PBD@Z(ptr str) msvcr120.??0context_self_unblock@Concurrency@@QAA@PBD@Z
+@ thiscall -arch=i386 ??0context_self_unblock@Concurrency@@QAE@PBD@Z(ptr str) msvcr120.??0context_self_unblock@Concurrency@@QAE@PBD@Z
+@ cdecl -arch=win64 ??0context_self_unblock@Concurrency@@QEAA@PEBD@Z(ptr str) msvcr120.??0context_self_unblock@Concurrency@@QEAA@PEBD@Z
+@ cdecl -arch=arm ??0context_self_unblock@Concurrency@@QAA@XZ(ptr) msvcr120.??0context_self_unblock@Concurrency@@QAA@XZ
+@ thiscall -arch=i386 ??0context_self_unblock@Concurrency@@QAE@XZ(ptr) msvcr120.??0context_self_unblock@Concurrency@@QAE@XZ
+@ cdecl -arch=win64 ??0context_self_unblock@Concurrency@@QEAA@XZ(ptr) msvcr120.??0context_self_unblock@Concurrency@@QEAA@XZ
+@ cdecl -arch=arm ??0context_unblock_unbalanced@Concurrency@@QAA@PBD@Z(ptr str) msvcr120.??0context_unblock_unbalanced@Concurrency@@QAA@PBD@Z
+@ thiscall -arch=i386 ??0context_unblock_unbalanced@Concurrency@@QAE@PBD@Z(ptr str) msvcr120.??0context_unblock_unbalanced@Concurrency@@QAE@PBD@Z
+@ cdecl -arch=win64 ??0context_unblock_unbalanced@Concurrency@@QEAA@PEBD@Z(ptr str) msvcr120.??0context_unblock_unbalanced@Concurrency@@QEAA@PEBD@Z
+@ cdecl -arch=arm ??0context_unblock_unbalanced@Concurrency@@QAA@XZ(ptr) msvcr120.??0context_unblock_unbalanced@Concurrency@@QAA@XZ
+@ thiscall -arch=i386 ??0context_unblock_unbalanced@Concurrency@@QAE@XZ(ptr) msvcr120.??0context_unblock_unbalanced@Concurrency@@QAE@XZ
+@ cdecl -arch=win64 ??0context_unblock_unbalanced@Concurrency@@QEAA@XZ(ptr) msvcr120.??0context_unblock_unbalanced@Concurrency@@QEAA@XZ
 @ cdecl -arch=arm ??0critical_section@Concurrency@@QAA@XZ(ptr) msvcr120.??0critical_section@Concurrency@@QAA@XZ
 @ thiscall -arch=i386 ??0critical_section@Concurrency@@QAE@XZ(ptr) msvcr120.??0critical_section@Concurrency@@QAE@XZ
 @ cdecl -arch=win64 ??0critical_section@Concurrency@@QEAA@XZ(ptr) msvcr120.??0critical_section@Concurrency@@QEAA@XZ
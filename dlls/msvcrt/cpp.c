@@ -987,6 +987,90 @@ void __thiscall improper_scheduler_detach_dtor(
     exception_dtor(_this);
 }
 
+typedef exception context_self_unblock;
+extern const vtable_ptr context_self_unblock_vtable;
+
+/* ??0context_self_unblock@Concurrency@@QAE@PBD@Z */
+/* ??0context_self_unblock@Concurrency@@QEAA@PEBD@Z */
+DEFINE_THISCALL_WRAPPER(context_self_unblock_ctor_str, 8)
+context_self_unblock* __thiscall context_self_unblock_ctor_str(
+        context_self_unblock *this, const char *str)
+{
+    TRACE("(%p %p)\n", this, str);
+    exception_ctor(this, &str);
+    this->vtable = &context_self_unblock_vtable;
+    return this;
+}
+
+/* ??0context_self_unblock@Concurrency@@QAE@XZ */
+/* ??0context_self_unblock@Concurrency@@QEAA@XZ */
+DEFINE_THISCALL_WRAPPER(context_self_unblock_ctor, 4)
+context_self_unblock* __thiscall context_self_unblock_ctor(
+        context_self_unblock *this)
+{
+    return context_self_unblock_ctor_str(this, NULL);
+}
+
+DEFINE_THISCALL_WRAPPER(context_self_unblock_copy_ctor,8)
+context_self_unblock * __thiscall context_self_unblock_copy_ctor(
+        context_self_unblock * _this, const context_self_unblock * rhs)
+{
+    TRACE("(%p %p)\n", _this, rhs);
+    exception_copy_ctor(_this, rhs);
+    _this->vtable = &context_self_unblock_vtable;
+    return _this;
+}
+
+DEFINE_THISCALL_WRAPPER(context_self_unblock_dtor,4)
+void __thiscall context_self_unblock_dtor(
+        context_self_unblock * _this)
+{
+    TRACE("(%p)\n", _this);
+    exception_dtor(_this);
+}
+
+typedef exception context_unblock_unbalanced;
+extern const vtable_ptr context_unblock_unbalanced_vtable;
+
+/* ??0context_unblock_unbalanced@Concurrency@@QAE@PBD@Z */
+/* ??0context_unblock_unbalanced@Concurrency@@QEAA@PEBD@Z */
+DEFINE_THISCALL_WRAPPER(context_unblock_unbalanced_ctor_str, 8)
+context_unblock_unbalanced* __thiscall context_unblock_unbalanced_ctor_str(
+        context_unblock_unbalanced *this, const char *str)
+{
+    TRACE("(%p %p)\n", this, str);
+    exception_ctor(this, &str);
+    this->vtable = &context_unblock_unbalanced_vtable;
+    return this;
+}
+
+/* ??0context_unblock_unbalanced@Concurrency@@QAE@XZ */
+/* ??0context_unblock_unbalanced@Concurrency@@QEAA@XZ */
+DEFINE_THISCALL_WRAPPER(context_unblock_unbalanced_ctor, 4)
+context_unblock_unbalanced* __thiscall context_unblock_unbalanced_ctor(
+        context_unblock_unbalanced *this)
+{
+    return context_unblock_unbalanced_ctor_str(this, NULL);
+}
+
+DEFINE_THISCALL_WRAPPER(context_unblock_unbalanced_copy_ctor,8)
+context_unblock_unbalanced * __thiscall context_unblock_unbalanced_copy_ctor(
+        context_unblock_unbalanced * _this, const context_unblock_unbalanced * rhs)
+{
+    TRACE("(%p %p)\n", _this, rhs);
+    exception_copy_ctor(_this, rhs);
+    _this->vtable = &context_unblock_unbalanced_vtable;
+    return _this;
+}
+
+DEFINE_THISCALL_WRAPPER(context_unblock_unbalanced_dtor,4)
+void __thiscall context_unblock_unbalanced_dtor(
+        context_unblock_unbalanced * _this)
+{
+    TRACE("(%p)\n", _this);
+    exception_dtor(_this);
+}
+
 #endif /* _MSVCR_VER >= 100 */
 
 __ASM_BLOCK_BEGIN(vtables)
@@ -1035,6 +1119,12 @@ __ASM_VTABLE(improper_scheduler_attach,
 __ASM_VTABLE(improper_scheduler_detach,
         VTABLE_ADD_FUNC(exception_vector_dtor)
         VTABLE_ADD_FUNC(what_exception));
+__ASM_VTABLE(context_self_unblock,
+        VTABLE_ADD_FUNC(exception_vector_dtor)
+        VTABLE_ADD_FUNC(what_exception));
+__ASM_VTABLE(context_unblock_unbalanced,
+        VTABLE_ADD_FUNC(exception_vector_dtor)
+        VTABLE_ADD_FUNC(what_exception));
 #endif
 
 __ASM_BLOCK_END
@@ -1067,6 +1157,10 @@ DEFINE_RTTI_DATA1(improper_scheduler_attach, 0, &exception_rtti_base_descriptor,
         ".?AVimproper_scheduler_attach@Concurrency@@" )
 DEFINE_RTTI_DATA1(improper_scheduler_detach, 0, &exception_rtti_base_descriptor,
         ".?AVimproper_scheduler_detach@Concurrency@@" )
+DEFINE_RTTI_DATA1(context_self_unblock, 0, &exception_rtti_base_descriptor,
+        ".?AVcontext_self_unblock@Concurrency@@" )
+DEFINE_RTTI_DATA1(context_unblock_unbalanced, 0, &exception_rtti_base_descriptor,
+        ".?AVcontext_unblock_unbalanced@Concurrency@@" )
 #endif
 
 DEFINE_EXCEPTION_TYPE_INFO( exception, 0, NULL, NULL )
@@ -1084,6 +1178,8 @@ DEFINE_EXCEPTION_TYPE_INFO(invalid_scheduler_policy_value, 1, &exception_cxx_typ
 DEFINE_EXCEPTION_TYPE_INFO(invalid_scheduler_policy_thread_specification, 1, &exception_cxx_type_info, NULL)
 DEFINE_EXCEPTION_TYPE_INFO(improper_scheduler_attach, 1, &exception_cxx_type_info, NULL)
 DEFINE_EXCEPTION_TYPE_INFO(improper_scheduler_detach, 1, &exception_cxx_type_info, NULL)
+DEFINE_EXCEPTION_TYPE_INFO(context_self_unblock, 1, &exception_cxx_type_info, NULL)
+DEFINE_EXCEPTION_TYPE_INFO(context_unblock_unbalanced, 1, &exception_cxx_type_info, NULL)
 #endif
 
 void msvcrt_init_exception(void *base)
@@ -1106,6 +1202,8 @@ void msvcrt_init_exception(void *base)
     init_invalid_scheduler_policy_thread_specification_rtti(base);
     init_improper_scheduler_attach_rtti(base);
     init_improper_scheduler_detach_rtti(base);
+    init_context_self_unblock_rtti(base);
+    init_context_unblock_unbalanced_rtti(base);
 #endif
 
     init_exception_cxx(base);
@@ -1123,6 +1221,8 @@ void msvcrt_init_exception(void *base)
     init_invalid_scheduler_policy_thread_specification_cxx(base);
     init_improper_scheduler_attach_cxx(base);
     init_improper_scheduler_detach_cxx(base);
+    init_context_self_unblock_cxx(base);
+    init_context_unblock_unbalanced_cxx(base);
 #endif
 #endif
 }
@@ -1172,6 +1272,16 @@ void throw_exception(exception_type et, HRESULT hr, const char *str)
         improper_scheduler_detach_ctor_str(&e, str);
         _CxxThrowException(&e, &improper_scheduler_detach_exception_type);
     }
+    case EXCEPTION_CONTEXT_SELF_UNBLOCK: {
+        context_self_unblock e;
+        context_self_unblock_ctor_str(&e, str);
+        _CxxThrowException(&e, &context_self_unblock_exception_type);
+    }
+    case EXCEPTION_CONTEXT_UNBLOCK_UNBALANCED: {
+        context_unblock_unbalanced e;
+        context_unblock_unbalanced_ctor_str(&e, str);
+        _CxxThrowException(&e, &context_unblock_unbalanced_exception_type);
+    }
 #endif
     }
 }
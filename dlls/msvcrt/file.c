@@ -101,6 +101,7 @@ static char utf16_bom[2] = { 0xff, 0xfe };
 #define MSVCRT_FD_BLOCK_SIZE 32
 
 #define MSVCRT_INTERNAL_BUFSIZ 4096
+#define MSVCRT_MAX_BUFSIZ (64 * 1024)
 
 /* ioinfo structure size is different in msvcrXX.dll's */
 typedef struct {
@@ -723,6 +724,25 @@ static BOOL msvcrt_alloc_buffer(FILE* file)
     return TRUE;
 }
 
+/* INTERNAL: Grow stdio file buffer of a stream doing sequential I/O,
+ * the buffer needs to be empty */
+static void msvcrt_grow_buffer(FILE* file)
+{
+    char *buf;
+
+    if((file->_flag & (_IOMYBUF|MSVCRT__IOSETVBUF)) != _IOMYBUF
+            || (file->_flag & _IOWRT && file->_ptr != file->_base)
+            || file->_bufsiz >= MSVCRT_MAX_BUFSIZ
+            || get_ioinfo_nolock(file->_file)->wxflag & (WX_PIPE|WX_TTY))
+        return;
+
+    if(!(buf = realloc(file->_base, file->_bufsiz * 2)))
+        return;
+    TRACE("growing buffer of %p to %d bytes\n", file, file->_bufsiz * 2);
+    file->_base = file->_ptr = buf;
+    file->_bufsiz *= 2;
+}
+
 /* INTERNAL: Allocate temporary buffer for stdout and stderr */
 static BOOL add_std_buffer(FILE *file)
 {
@@ -2811,15 +2831,33 @@ static int read_i(int fd, ioinfo *fdinfo, void *buf, unsigned int count)
         }
         else if (fdinfo->wxflag & WX_TEXT)
         {
-            DWORD i, j;
+            DWORD i, j, end = num_read;
 
             if (bufstart[0]=='\n' && (!utf16 || bufstart[1]==0))
                 fdinfo->wxflag |= WX_READNL;
             else
                 fdinfo->wxflag &= ~WX_READNL;
 
+            if (!utf16)
+            {
+                const char *eof = memchr(bufstart, 0x1a, num_read);
+                if (eof) end = eof - bufstart;
+            }
+
             for (i=0, j=0; i<num_read; i+=1+utf16)
             {
+                /* copy runs without special characters in bulk */
+                if (!utf16 && i<end && bufstart[i]!='\r')
+                {
+                    const char *cr = memchr(bufstart+i, '\r', end-i);
+                    DWORD len = (cr ? cr-bufstart : end) - i;
+
+                    if (i != j) memmove(bufstart+j, bufstart+i, len);
+                    j += len;
+                    i += len-1;
+                    continue;
+                }
+
                 /* in text mode, a ctrl-z signals EOF */
                 if (bufstart[i]==0x1a && (!utf16 || bufstart[i+1]==0))
                 {
@@ -3507,11 +3545,21 @@ int CDECL _write(int fd, const void* buf, unsigned int count)
         }
         else if (!(info->exflag & (EF_UTF8|EF_UTF16)))
         {
-            for (j = 0; i < count && j < sizeof(lfbuf)-1; i++, j++)
+            while (i < count && j < sizeof(lfbuf)-1)
             {
-                if (s[i] == '\n')
+                DWORD len = min(count - i, sizeof(lfbuf)-1 - j);
+                const char *nl = memchr(s + i, '\n', len);
+
+                if (nl) len = nl - (s + i);
+                memcpy(lfbuf + j, s + i, len);
+                i += len;
+                j += len;
+                if (nl)
+                {
                     lfbuf[j++] = '\r';
-                lfbuf[j] = s[i];
+                    lfbuf[j++] = '\n';
+                    i++;
+                }
             }
         }
         else if (info->exflag & EF_UTF16 || console)
@@ -3663,9 +3711,11 @@ int CDECL _filbuf(FILE* file)
     if(file->_flag & _IOSTRG)
         return EOF;
 
-    /* Allocate buffer if needed */
+    /* Allocate buffer if needed, grow it on subsequent refills */
     if(!(file->_flag & (_IONBF | _IOMYBUF | MSVCRT__USERBUF)))
         msvcrt_alloc_buffer(file);
+    else
+        msvcrt_grow_buffer(file);
 
     if(!(file->_flag & _IOREAD)) {
         if(file->_flag & _IORW)
@@ -3750,11 +3800,33 @@ char * CDECL fgets(char *s, int size, FILE* file)
 
   _lock_file(file);
 
-  while ((size >1) && (cc = _fgetc_nolock(file)) != EOF && cc != '\n')
-    {
+  while (size > 1)
+  {
+      if (file->_cnt > 0)
+      {
+          /* copy buffered data up to the end of line in bulk */
+          int len = min(file->_cnt, size - 1);
+          char *nl = memchr(file->_ptr, '\n', len);
+
+          if (nl) len = nl - file->_ptr;
+          memcpy(s, file->_ptr, len);
+          s += len;
+          size -= len;
+          file->_ptr += len;
+          file->_cnt -= len;
+          if (nl || size <= 1)
+          {
+              cc = nl ? _fgetc_nolock(file) : 0;
+              break;
+          }
+          continue;
+      }
+
+      if ((cc = _filbuf(file)) == EOF || cc == '\n')
+          break;
       *s++ = (char)cc;
-      size --;
-    }
+      size--;
+  }
   if ((cc == EOF) && (s == buf_start)) /* If nothing read, return 0*/
   {
     TRACE(":nothing read\n");
@@ -3941,9 +4013,13 @@ int CDECL _flsbuf(int c, FILE* file)
         int res = 0;
 
         if(file->_cnt <= 0) {
+            BOOL full = file->_ptr - file->_base >= file->_bufsiz;
+
             res = msvcrt_flush_buffer(file);
             if(res)
                 return res;
+            if(full)
+                msvcrt_grow_buffer(file);
             file->_flag |= _IOWRT;
             file->_cnt=file->_bufsiz;
         }
@@ -4224,7 +4300,7 @@ int CDECL _fputc_nolock(int c, FILE* file)
   if(file->_cnt>0) {
     *file->_ptr++=c;
     file->_cnt--;
-    if (c == '\n')
+    if (c == '\n' && get_ioinfo_nolock(file->_file)->wxflag & (WX_PIPE | WX_TTY))
     {
       res = msvcrt_flush_buffer(file);
       return res ? res : c;
@@ -4291,6 +4367,8 @@ size_t CDECL _fread_nolock(void *ptr, size_t size, size_t nmemb, FILE* file)
 
   if(rcnt>0 && !(file->_flag & (_IONBF | _IOMYBUF | MSVCRT__USERBUF)))
       msvcrt_alloc_buffer(file);
+  else if(rcnt>0 && !file->_cnt && rcnt<file->_bufsiz)
+      msvcrt_grow_buffer(file);
 
   while(rcnt>0)
   {
@@ -4877,7 +4955,7 @@ int CDECL setvbuf(FILE* file, char *buf, int mode, size_t size)
     _fflush_nolock(file);
     if(file->_flag & _IOMYBUF)
         free(file->_base);
-    file->_flag &= ~(_IONBF | _IOMYBUF | MSVCRT__USERBUF);
+    file->_flag &= ~(_IONBF | _IOMYBUF | MSVCRT__USERBUF | MSVCRT__IOSETVBUF);
     file->_cnt = 0;
 
     if(mode == _IONBF) {
@@ -4896,7 +4974,7 @@ int CDECL setvbuf(FILE* file, char *buf, int mode, size_t size)
             return -1;
         }
 
-        file->_flag |= _IOMYBUF;
+        file->_flag |= _IOMYBUF | MSVCRT__IOSETVBUF;
         file->_bufsiz = size;
     }
     _unlock_file(file);
@@ -53,6 +53,295 @@ static unsigned int MSVCRT_amblksiz = 16;
 /* FIXME - According to documentation it should be 480 bytes, at runtime default is 0 */
 static size_t MSVCRT_sbh_threshold = 0;
 
+static void* msvcrt_heap_alloc(DWORD flags, size_t size);
+
+/* Optional per-thread cache for small blocks, enabled with WINE_CRT_BLOCK_CACHE.
+ * Small blocks are carved out of 64k slabs in a reserved address range and
+ * handed out from per-thread free lists without locking; blocks move in
+ * batches between the thread lists and a global list per size class.
+ * A block freed on another thread simply goes to that thread's list. */
+#define BLOCK_GRANULARITY 16
+#define BLOCK_MAX_SIZE    1024
+#define BLOCK_CLASSES     (BLOCK_MAX_SIZE / BLOCK_GRANULARITY)
+#define BLOCK_CACHE_DEPTH 64  /* blocks kept per thread and size class */
+#define BLOCK_CACHE_BATCH 32  /* blocks moved at once to or from the global lists */
+#define BLOCK_FREE        0xffff
+#define SLAB_SIZE         0x10000
+#ifdef _WIN64
+#define SLAB_REGION_SIZE  ((size_t)1 << 30)
+#else
+#define SLAB_REGION_SIZE  ((size_t)32 << 20)
+#endif
+
+struct free_block
+{
+    struct free_block *next;
+};
+
+struct slab
+{
+    unsigned int block_size;
+    unsigned int count;    /* number of blocks in the slab */
+    unsigned int carved;   /* number of blocks handed out to the free lists so far */
+    WORD         slack[1]; /* unused bytes at the end of each block, or BLOCK_FREE */
+};
+
+struct block_class
+{
+    SRWLOCK            lock;
+    struct free_block *free;
+    struct slab       *slab; /* slab that blocks are being carved from */
+};
+
+struct block_cache
+{
+    struct
+    {
+        struct free_block *head;
+        unsigned int       count;
+    } bins[BLOCK_CLASSES];
+};
+
+static BYTE *slab_region;
+static unsigned int slab_count;
+static SRWLOCK slab_lock = SRWLOCK_INIT;
+static struct block_class block_classes[BLOCK_CLASSES];
+
+static inline BOOL is_slab_block(const void *ptr)
+{
+    return slab_region && (ULONG_PTR)ptr - (ULONG_PTR)slab_region < SLAB_REGION_SIZE;
+}
+
+static inline struct slab *get_slab(const void *ptr)
+{
+    return (struct slab *)(slab_region + (((const BYTE *)ptr - slab_region) & ~(SLAB_SIZE - 1)));
+}
+
+static inline BYTE *slab_data(struct slab *slab)
+{
+    return (BYTE *)slab + ((FIELD_OFFSET(struct slab, slack[slab->count]) + BLOCK_GRANULARITY - 1) &
+                           ~(BLOCK_GRANULARITY - 1));
+}
+
+static inline unsigned int slab_block_index(struct slab *slab, const void *ptr)
+{
+    return ((const BYTE *)ptr - slab_data(slab)) / slab->block_size;
+}
+
+static struct slab *alloc_slab(unsigned int block_size)
+{
+    struct slab *slab = NULL;
+    unsigned int count;
+
+    AcquireSRWLockExclusive(&slab_lock);
+    if (slab_count < SLAB_REGION_SIZE / SLAB_SIZE &&
+        (slab = VirtualAlloc(slab_region + slab_count * SLAB_SIZE, SLAB_SIZE, MEM_COMMIT, PAGE_READWRITE)))
+    {
+        count = (SLAB_SIZE - FIELD_OFFSET(struct slab, slack) - BLOCK_GRANULARITY) / (block_size + sizeof(WORD));
+        slab->block_size = block_size;
+        slab->count = count;
+        slab_count++;
+    }
+    ReleaseSRWLockExclusive(&slab_lock);
+    return slab;
+}
+
+/* moves up to BLOCK_CACHE_BATCH blocks from the global list into the thread cache */
+static BOOL refill_block_cache(struct block_cache *cache, unsigned int class)
+{
+    struct block_class *bc = &block_classes[class];
+    unsigned int block_size = (class + 1) * BLOCK_GRANULARITY;
+    struct free_block *block;
+    unsigned int count = 0;
+
+    AcquireSRWLockExclusive(&bc->lock);
+    while (count < BLOCK_CACHE_BATCH && (block = bc->free))
+    {
+        bc->free = block->next;
+        block->next = cache->bins[class].head;
+        cache->bins[class].head = block;
+        count++;
+    }
+    while (count < BLOCK_CACHE_BATCH)
+    {
+        struct slab *slab = bc->slab;
+
+        if (!slab || slab->carved == slab->count)
+        {
+            if (!(slab = alloc_slab(block_size))) break;
+            bc->slab = slab;
+        }
+        block = (struct free_block *)(slab_data(slab) + slab->carved * block_size);
+        slab->slack[slab->carved++] = BLOCK_FREE;
+        block->next = cache->bins[class].head;
+        cache->bins[class].head = block;
+        count++;
+    }
+    ReleaseSRWLockExclusive(&bc->lock);
+
+    cache->bins[class].count += count;
+    return count != 0;
+}
+
+/* returns up to count blocks from the thread cache to the global list */
+static void flush_block_cache(struct block_cache *cache, unsigned int class, unsigned int count)
+{
+    struct block_class *bc = &block_classes[class];
+    struct free_block *first, *last;
+    unsigned int i;
+
+    if (!(first = cache->bins[class].head)) return;
+    for (i = 1, last = first; i < count && last->next; i++) last = last->next;
+    cache->bins[class].head = last->next;
+    cache->bins[class].count -= i;
+
+    AcquireSRWLockExclusive(&bc->lock);
+    last->next = bc->free;
+    bc->free = first;
+    ReleaseSRWLockExclusive(&bc->lock);
+}
+
+static struct block_cache *get_block_cache(BOOL create_data)
+{
+    thread_data_t *data;
+    DWORD err = GetLastError();
+
+    /* don't recreate the thread data for threads that are shutting down */
+    if (create_data) data = msvcrt_get_thread_data();
+    else data = TlsGetValue(msvcrt_tls_index);
+    if (data && !data->block_cache)
+        data->block_cache = HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, sizeof(*data->block_cache));
+    SetLastError(err);
+    return data ? data->block_cache : NULL;
+}
+
+static void *block_cache_alloc(DWORD flags, size_t size)
+{
+    unsigned int class = size ? (size - 1) / BLOCK_GRANULARITY : 0;
+    struct block_cache *cache;
+    struct free_block *block;
+    struct slab *slab;
+
+    if (!(cache = get_block_cache(TRUE))) return NULL;
+    if (!cache->bins[class].head && !refill_block_cache(cache, class)) return NULL;
+
+    block = cache->bins[class].head;
+    cache->bins[class].head = block->next;
+    cache->bins[class].count--;
+
+    slab = get_slab(block);
+    slab->slack[slab_block_index(slab, block)] = slab->block_size - size;
+    if (flags & HEAP_ZERO_MEMORY) memset(block, 0, size);
+    return block;
+}
+
+static void block_cache_free(void *ptr)
+{
+    struct slab *slab = get_slab(ptr);
+    unsigned int class = slab->block_size / BLOCK_GRANULARITY - 1;
+    struct free_block *block = ptr;
+    struct block_cache *cache;
+    struct block_class *bc;
+
+    slab->slack[slab_block_index(slab, ptr)] = BLOCK_FREE;
+
+    if (!(cache = get_block_cache(FALSE)))
+    {
+        bc = &block_classes[class];
+        AcquireSRWLockExclusive(&bc->lock);
+        block->next = bc->free;
+        bc->free = block;
+        ReleaseSRWLockExclusive(&bc->lock);
+        return;
+    }
+
+    block->next = cache->bins[class].head;
+    cache->bins[class].head = block;
+    if (++cache->bins[class].count > BLOCK_CACHE_DEPTH)
+        flush_block_cache(cache, class, BLOCK_CACHE_BATCH);
+}
+
+static size_t block_cache_size(void *ptr)
+{
+    struct slab *slab = get_slab(ptr);
+    WORD slack = slab->slack[slab_block_index(slab, ptr)];
+
+    if (slack == BLOCK_FREE) return ~(size_t)0;
+    return slab->block_size - slack;
+}
+
+static void *block_cache_realloc(DWORD flags, void *ptr, size_t size)
+{
+    struct slab *slab = get_slab(ptr);
+    unsigned int index = slab_block_index(slab, ptr);
+    size_t old_size = slab->block_size - slab->slack[index];
+    void *ret;
+
+    if (size <= slab->block_size)
+    {
+        slab->slack[index] = slab->block_size - size;
+        return ptr;
+    }
+    if (flags & HEAP_REALLOC_IN_PLACE_ONLY) return NULL;
+
+    if (!(ret = msvcrt_heap_alloc(0, size))) return NULL;
+    memcpy(ret, ptr, old_size);
+    block_cache_free(ptr);
+    return ret;
+}
+
+/* finds the next used block after next->_pentry, or the first one if it's not a slab block */
+static int block_cache_walk(_HEAPINFO *next)
+{
+    unsigned int i = 0, index = 0, count;
+    struct slab *slab;
+
+    AcquireSRWLockShared(&slab_lock);
+    count = slab_count;
+    ReleaseSRWLockShared(&slab_lock);
+
+    if (next->_pentry && is_slab_block(next->_pentry))
+    {
+        slab = get_slab(next->_pentry);
+        i = ((BYTE *)slab - slab_region) / SLAB_SIZE;
+        index = slab_block_index(slab, next->_pentry) + 1;
+    }
+
+    for (; i < count; i++, index = 0)
+    {
+        slab = (struct slab *)(slab_region + i * SLAB_SIZE);
+        for (; index < slab->carved; index++)
+        {
+            if (slab->slack[index] == BLOCK_FREE) continue;
+            next->_pentry = (int *)(slab_data(slab) + index * slab->block_size);
+            next->_size = slab->block_size - slab->slack[index];
+            next->_useflag = _USEDENTRY;
+            return _HEAPOK;
+        }
+    }
+    return _HEAPEND;
+}
+
+/* returns all the blocks cached by the current thread to the global lists */
+static void block_cache_trim(void)
+{
+    struct block_cache *cache;
+    unsigned int i;
+
+    if (!slab_region || !(cache = get_block_cache(FALSE))) return;
+    for (i = 0; i < BLOCK_CLASSES; i++) flush_block_cache(cache, i, ~0u);
+}
+
+void msvcrt_free_block_cache(thread_data_t *data)
+{
+    unsigned int i;
+
+    if (!data->block_cache) return;
+    for (i = 0; i < BLOCK_CLASSES; i++) flush_block_cache(data->block_cache, i, ~0u);
+    HeapFree(GetProcessHeap(), 0, data->block_cache);
+    data->block_cache = NULL;
+}
+
 static void* msvcrt_heap_alloc(DWORD flags, size_t size)
 {
     if(size < MSVCRT_sbh_threshold)
@@ -68,11 +357,20 @@ static void* msvcrt_heap_alloc(DWORD flags, size_t size)
         return memblock;
     }
 
+    if(slab_region && size <= BLOCK_MAX_SIZE)
+    {
+        void *ret = block_cache_alloc(flags, size);
+        if(ret) return ret;
+    }
+
     return HeapAlloc(heap, flags, size);
 }
 
 static void* msvcrt_heap_realloc(DWORD flags, void *ptr, size_t size)
 {
+    if(ptr && is_slab_block(ptr))
+        return block_cache_realloc(flags, ptr, size);
+
     if(sb_heap && ptr && !HeapValidate(heap, 0, ptr))
     {
         /* TODO: move data to normal heap if it exceeds sbh_threshold limit */
@@ -105,6 +403,12 @@ static void* msvcrt_heap_realloc(DWORD flags, void *ptr, size_t size)
 
 static BOOL msvcrt_heap_free(void *ptr)
 {
+    if(ptr && is_slab_block(ptr))
+    {
+        block_cache_free(ptr);
+        return TRUE;
+    }
+
     if(sb_heap && ptr && !HeapValidate(heap, 0, ptr))
     {
         void **saved = SAVED_PTR(ptr);
@@ -116,6 +420,9 @@ static BOOL msvcrt_heap_free(void *ptr)
 
 static size_t msvcrt_heap_size(void *ptr)
 {
+    if(ptr && is_slab_block(ptr))
+        return block_cache_size(ptr);
+
     if(sb_heap && ptr && !HeapValidate(heap, 0, ptr))
     {
         void **saved = SAVED_PTR(ptr);
@@ -257,6 +564,7 @@ int CDECL _heapchk(void)
  */
 int CDECL _heapmin(void)
 {
+  block_cache_trim();
   if (!HeapCompact( heap, 0 ) ||
           (sb_heap && !HeapCompact( sb_heap, 0 )))
   {
@@ -277,6 +585,9 @@ int CDECL _heapwalk(_HEAPINFO *next)
   if (sb_heap)
       FIXME("small blocks heap not supported\n");
 
+  if (next->_pentry && is_slab_block(next->_pentry))
+      return block_cache_walk(next);
+
   LOCK_HEAP;
   phe.lpData = next->_pentry;
   phe.cbData = next->_size;
@@ -296,7 +607,12 @@ int CDECL _heapwalk(_HEAPINFO *next)
     {
       UNLOCK_HEAP;
       if (GetLastError() == ERROR_NO_MORE_ITEMS)
-         return _HEAPEND;
+      {
+         /* small blocks come after the heap entries */
+         if (!slab_region) return _HEAPEND;
+         next->_pentry = NULL;
+         return block_cache_walk(next);
+      }
       msvcrt_set_errno(GetLastError());
       if (!phe.lpData)
         return _HEAPBADBEGIN;
@@ -867,12 +1183,22 @@ int CDECL strncpy_s(char *dest, size_t numberOfElements,
 
 BOOL msvcrt_init_heap(void)
 {
+    WCHAR buffer[8];
+
     heap = HeapCreate(0, 0, 0);
+    if(GetEnvironmentVariableW(L"WINE_CRT_BLOCK_CACHE", buffer, ARRAY_SIZE(buffer)) && wcscmp(buffer, L"0"))
+        slab_region = VirtualAlloc(NULL, SLAB_REGION_SIZE, MEM_RESERVE, PAGE_NOACCESS);
     return heap != NULL;
 }
 
 void msvcrt_destroy_heap(void)
 {
+    if(slab_region)
+    {
+        BYTE *region = slab_region;
+        slab_region = NULL;
+        VirtualFree(region, 0, MEM_RELEASE);
+    }
     HeapDestroy(heap);
     if(sb_heap)
         HeapDestroy(sb_heap);
@@ -80,6 +80,8 @@ static inline void msvcrt_free_tls_mem(void)
         free_locinfo(tls->locinfo);
         free_mbcinfo(tls->mbcinfo);
     }
+    msvcrt_free_block_cache(tls);
+    TlsSetValue(msvcrt_tls_index, NULL);
   }
   HeapFree(GetProcessHeap(), 0, tls);
 }
@@ -112,6 +114,7 @@ BOOL WINAPI DllMain(HINSTANCE hinstDLL, DWORD fdwReason, LPVOID lpvReserved)
         return FALSE;
     }
     msvcrt_init_math(hinstDLL);
+    msvcrt_init_string();
     msvcrt_init_io();
     msvcrt_init_console();
     msvcrt_init_args();
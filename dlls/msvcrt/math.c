@@ -69,9 +69,27 @@ static BOOL sse2_enabled;
 
 static const struct unix_funcs *unix_funcs;
 
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+#define USE_X86_MATH_INSNS
+static BOOL sse41_supported;
+static BOOL fma_supported;
+
+static BOOL cpu_has_fma(void)
+{
+    unsigned int eax, ebx, ecx, edx;
+
+    __asm__( "cpuid" : "=a" (eax), "=b" (ebx), "=c" (ecx), "=d" (edx) : "a" (1), "c" (0) );
+    return (ecx >> 12) & 1;
+}
+#endif
+
 void msvcrt_init_math( void *module )
 {
     sse2_supported = sse2_enabled = IsProcessorFeaturePresent( PF_XMMI64_INSTRUCTIONS_AVAILABLE );
+#ifdef USE_X86_MATH_INSNS
+    sse41_supported = sse2_supported && IsProcessorFeaturePresent( PF_SSE4_1_INSTRUCTIONS_AVAILABLE );
+    fma_supported = IsProcessorFeaturePresent( PF_AVX_INSTRUCTIONS_AVAILABLE ) && cpu_has_fma();
+#endif
     __wine_init_unix_lib( module, DLL_PROCESS_ATTACH, NULL, &unix_funcs );
 }
 
@@ -82,6 +100,57 @@ static inline float fp_barrierf(float x)
     return y;
 }
 
+#ifdef USE_X86_MATH_INSNS
+/* roundsd/roundss immediates: rounding mode | 8 to suppress the inexact exception */
+static inline double __attribute__((target("sse4.1"))) sse41_floor( double x )
+{
+    __asm__( "roundsd $9, %0, %0" : "+x" (x) );
+    return x;
+}
+
+static inline double __attribute__((target("sse4.1"))) sse41_ceil( double x )
+{
+    __asm__( "roundsd $10, %0, %0" : "+x" (x) );
+    return x;
+}
+
+static inline double __attribute__((target("sse4.1"))) sse41_trunc( double x )
+{
+    __asm__( "roundsd $11, %0, %0" : "+x" (x) );
+    return x;
+}
+
+static inline double __attribute__((target("fma"))) fma3_fma( double x, double y, double z )
+{
+    __asm__( "vfmadd213sd %2, %1, %0" : "+x" (x) : "x" (y), "x" (z) );
+    return x;
+}
+
+static inline float __attribute__((target("sse4.1"))) sse41_floorf( float x )
+{
+    __asm__( "roundss $9, %0, %0" : "+x" (x) );
+    return x;
+}
+
+static inline float __attribute__((target("sse4.1"))) sse41_ceilf( float x )
+{
+    __asm__( "roundss $10, %0, %0" : "+x" (x) );
+    return x;
+}
+
+static inline float __attribute__((target("sse4.1"))) sse41_truncf( float x )
+{
+    __asm__( "roundss $11, %0, %0" : "+x" (x) );
+    return x;
+}
+
+static inline float __attribute__((target("fma"))) fma3_fmaf( float x, float y, float z )
+{
+    __asm__( "vfmadd213ss %2, %1, %0" : "+x" (x) : "x" (y), "x" (z) );
+    return x;
+}
+#endif /* USE_X86_MATH_INSNS */
+
 /*********************************************************************
  *      _matherr (CRTDLL.@)
  */
@@ -516,14 +585,59 @@ float CDECL atan2f( float y, float x )
     }
 }
 
+/* sin(x) for |x| <= pi/4, the Taylor series is accurate to double precision */
+static double sinf_kernel( double x )
+{
+    double z = x * x, w = z * z;
+
+    return x + x * z * (-1.0 / 6 + z * (1.0 / 120) + w * (-1.0 / 5040 + z * (1.0 / 362880))
+            + w * w * (-1.0 / 39916800 + z * (1.0 / 6227020800.0)));
+}
+
+/* cos(x) for |x| <= pi/4 */
+static double cosf_kernel( double x )
+{
+    double z = x * x, w = z * z;
+
+    return 1.0 + z * (-1.0 / 2 + z * (1.0 / 24) + w * (-1.0 / 720 + z * (1.0 / 40320))
+            + w * w * (-1.0 / 3628800 + z * (1.0 / 479001600.0) + w * (-1.0 / 87178291200.0)));
+}
+
+/* reduces |x| < 2^20 to [-pi/4, pi/4], returns the quadrant
+ * pi/2 is split so that n * pio2_1 and n * pio2_2 are exact for |n| < 2^25 */
+static int rem_pio2f( float x, double *y )
+{
+    static const double invpio2 = 0x1.45f306dc9c883p-1,
+                        pio2_1 = 0x1.921fb5p+0,
+                        pio2_2 = 0x1.110b46p-26,
+                        pio2_3 = 0x1.1a62633145c07p-54;
+    double fn = x * invpio2;
+    int n = fn < 0 ? fn - 0.5 : fn + 0.5;
+
+    *y = x - n * pio2_1 - n * pio2_2 - n * pio2_3;
+    return n;
+}
+
 /*********************************************************************
  *      cosf (MSVCRT.@)
  */
 float CDECL cosf( float x )
 {
-  float ret = unix_funcs->cosf( x );
-  if (!isfinite(x)) return math_error(_DOMAIN, "cosf", x, 0, ret);
-  return ret;
+  union { float f; UINT32 i; } u = { x };
+  UINT32 ix = u.i & 0x7fffffff;
+  double y;
+
+  if (ix >= 0x7f800000) return math_error(_DOMAIN, "cosf", x, 0, x - x);
+  if (ix <= 0x3f490fdb) return cosf_kernel(x);  /* |x| <= pi/4 */
+  if (ix >= 0x49800000) return unix_funcs->cosf( x );  /* |x| >= 2^20 */
+
+  switch (rem_pio2f(x, &y) & 3)
+  {
+  case 0: return cosf_kernel(y);
+  case 1: return -sinf_kernel(y);
+  case 2: return -cosf_kernel(y);
+  default: return sinf_kernel(y);
+  }
 }
 
 /*********************************************************************
@@ -541,21 +655,102 @@ float CDECL coshf( float x )
  */
 float CDECL expf( float x )
 {
-  float ret = unix_funcs->expf( x );
-  if (isnan(x)) return math_error(_DOMAIN, "expf", x, 0, ret);
-  if (isfinite(x) && !ret) return math_error(_UNDERFLOW, "expf", x, 0, ret);
-  if (isfinite(x) && !isfinite(ret)) return math_error(_OVERFLOW, "expf", x, 0, ret);
+  /* 2^(i/32) */
+  static const double exp2_table[32] =
+  {
+      0x1.0000000000000p+0, 0x1.059b0d3158574p+0, 0x1.0b5586cf9890fp+0, 0x1.11301d0125b51p+0,
+      0x1.172b83c7d517bp+0, 0x1.1d4873168b9aap+0, 0x1.2387a6e756238p+0, 0x1.29e9df51fdee1p+0,
+      0x1.306fe0a31b715p+0, 0x1.371a7373aa9cbp+0, 0x1.3dea64c123422p+0, 0x1.44e086061892dp+0,
+      0x1.4bfdad5362a27p+0, 0x1.5342b569d4f82p+0, 0x1.5ab07dd485429p+0, 0x1.6247eb03a5585p+0,
+      0x1.6a09e667f3bcdp+0, 0x1.71f75e8ec5f74p+0, 0x1.7a11473eb0187p+0, 0x1.82589994cce13p+0,
+      0x1.8ace5422aa0dbp+0, 0x1.93737b0cdc5e5p+0, 0x1.9c49182a3f090p+0, 0x1.a5503b23e255dp+0,
+      0x1.ae89f995ad3adp+0, 0x1.b7f76f2fb5e47p+0, 0x1.c199bdd85529cp+0, 0x1.cb720dcef9069p+0,
+      0x1.d5818dcfba487p+0, 0x1.dfc97337b9b5fp+0, 0x1.ea4afa2a490dap+0, 0x1.f50765b6e4540p+0
+  };
+  static const double inv_ln2_32 = 0x1.71547652b82fep+5,
+                      ln2_32_hi = 0x1.62e42feep-6,
+                      ln2_32_lo = 0x1.a39ef35793c76p-38;
+  union { double f; UINT64 i; } u;
+  double r;
+  float ret;
+  int k;
+
+  if (isnan(x)) return math_error(_DOMAIN, "expf", x, 0, x + x);
+  if (isinf(x)) return x > 0 ? x : 0;
+  if (x > 89.0f) return math_error(_OVERFLOW, "expf", x, 0, fp_barrierf(0x1p97f) * 0x1p97f);
+  if (x < -104.0f) return math_error(_UNDERFLOW, "expf", x, 0, fp_barrierf(0x1p-95f) * 0x1p-95f);
+
+  /* exp(x) = 2^(k/32) * exp(r) with |r| <= ln(2)/64, evaluated in double precision */
+  r = x * inv_ln2_32;
+  k = r < 0 ? r - 0.5 : r + 0.5;
+  r = x - k * ln2_32_hi - k * ln2_32_lo;
+  u.i = (UINT64)(0x3ff + (k >> 5)) << 52;
+  ret = exp2_table[k & 31] * u.f * (1.0 + r * (1.0 + r * (1.0 / 2 + r * (1.0 / 6
+          + r * (1.0 / 24 + r * (1.0 / 120 + r * (1.0 / 720)))))));
+  if (!ret) return math_error(_UNDERFLOW, "expf", x, 0, ret);
+  if (!isfinite(ret)) return math_error(_OVERFLOW, "expf", x, 0, ret);
   return ret;
 }
 
 /*********************************************************************
  *      fmodf (MSVCRT.@)
+ *
+ * Based on musl: src/math/fmodf.c
  */
 float CDECL fmodf( float x, float y )
 {
-  float ret = unix_funcs->fmodf( x, y );
-  if (!isfinite(x) || !isfinite(y)) return math_error(_DOMAIN, "fmodf", x, 0, ret);
-  return ret;
+  union { float f; UINT32 i; } ux = { x }, uy = { y };
+  UINT32 xi = ux.i, yi = uy.i, sx = xi & 0x80000000, i;
+  int ex = xi >> 23 & 0xff, ey = yi >> 23 & 0xff, n;
+
+  if (!isfinite(x) || !isfinite(y))
+    return math_error(_DOMAIN, "fmodf", x, 0, isfinite(x) && isinf(y) ? x : (x * y) / (x * y));
+  if (!y) return (x * y) / (x * y);
+  if (xi << 1 <= yi << 1)
+  {
+    if (xi << 1 == yi << 1) return 0 * x;
+    return x;
+  }
+
+  if (!ex)
+  {
+    for (i = xi << 9; i >> 31 == 0; ex--, i <<= 1);
+    xi <<= -ex + 1;
+  }
+  else
+  {
+    xi &= 0x007fffff;
+    xi |= 0x00800000;
+  }
+  if (!ey)
+  {
+    for (i = yi << 9; i >> 31 == 0; ey--, i <<= 1);
+    yi <<= -ey + 1;
+  }
+  else
+  {
+    yi &= 0x007fffff;
+    yi |= 0x00800000;
+  }
+
+  /* the 24-bit remainder can be shifted by 8 bits at a time without overflowing */
+  for (; ex > ey; ex -= n)
+  {
+    n = min(ex - ey, 8);
+    xi = (xi << n) % yi;
+  }
+  xi %= yi;
+  if (!xi) return 0 * x;
+  for (; xi >> 23 == 0; xi <<= 1, ex--);
+
+  if (ex > 0)
+  {
+    xi -= 0x00800000;
+    xi |= (UINT32)ex << 23;
+  }
+  else xi >>= -ex + 1;
+  ux.i = xi | sx;
+  return ux.f;
 }
 
 /*********************************************************************
@@ -563,10 +758,67 @@ float CDECL fmodf( float x, float y )
  */
 float CDECL logf( float x )
 {
-  float ret = unix_funcs->logf( x );
-  if (x < 0.0) return math_error(_DOMAIN, "logf", x, 0, ret);
-  if (x == 0.0) return math_error(_SING, "logf", x, 0, ret);
-  return ret;
+  /* 1/c and log(c) for 32 subintervals of [0.69921875, 1.3984375), c = 1 around 1 */
+  static const struct { double invc, logc; } log_table[32] =
+  {
+      { 0x1.6a13cd1537290p+0, -0x1.630030b3aac48p-2 },
+      { 0x1.623fa77016240p+0, -0x1.4c9e09e172c3dp-2 },
+      { 0x1.5ac056b015ac0p+0, -0x1.36b6776be1116p-2 },
+      { 0x1.5390948f40febp+0, -0x1.214456d0eb8d5p-2 },
+      { 0x1.4cab88725af6ep+0, -0x1.0c42d676162e2p-2 },
+      { 0x1.460cbc7f5cf9ap+0, -0x1.ef5ade4dcffe5p-3 },
+      { 0x1.3fb013fb013fbp+0, -0x1.c6ffbc6f00f71p-3 },
+      { 0x1.3991c2c187f63p+0, -0x1.9f6c407089663p-3 },
+      { 0x1.33ae45b57bcb2p+0, -0x1.7898d85444c74p-3 },
+      { 0x1.2e025c04b8097p+0, -0x1.527e5e4a1b58dp-3 },
+      { 0x1.288b01288b013p+0, -0x1.2d1610c86813dp-3 },
+      { 0x1.23456789abcdfp+0, -0x1.08598b59e3a07p-3 },
+      { 0x1.1e2ef3b3fb874p+0, -0x1.c885801bc4b20p-4 },
+      { 0x1.19453808ca29cp+0, -0x1.8197e2f40e3f0p-4 },
+      { 0x1.1485f0e0acd3bp+0, -0x1.3bdf5a7d1ee5ep-4 },
+      { 0x1.0fef010fef011p+0, -0x1.eea31c006b87cp-5 },
+      { 0x1.0b7e6ec259dc8p+0, -0x1.67c94f2d4bb65p-5 },
+      { 0x1.073260a47f7c6p+0, -0x1.c63d2ec14aad7p-6 },
+      { 0x1.03091b51f5e1ap+0, -0x1.82448a388a283p-7 },
+      { 0x1.0000000000000p+0, 0.0 },
+      { 0x1.ecc07b301ecc0p-1, 0x1.39e87b9febd68p-5 },
+      { 0x1.de5d6e3f8868ap-1, 0x1.16536eea37ae3p-4 },
+      { 0x1.d0cb58f6ec074p-1, 0x1.8c345d6319b23p-4 },
+      { 0x1.c3f8f01c3f8f0p-1, 0x1.fec9131dbeabcp-4 },
+      { 0x1.b7d6c3dda338bp-1, 0x1.371fc201e8f75p-3 },
+      { 0x1.ac5701ac5701bp-1, 0x1.6d60fe719d21bp-3 },
+      { 0x1.a16d3f97a4b02p-1, 0x1.a23bc1fe2b561p-3 },
+      { 0x1.970e4f80cb872p-1, 0x1.d5c216b4fbb94p-3 },
+      { 0x1.8d3018d3018d3p-1, 0x1.0402594b4d041p-2 },
+      { 0x1.83c977ab2beddp-1, 0x1.1c898c16999fbp-2 },
+      { 0x1.7ad2208e0ecc3p-1, 0x1.347dd9a987d56p-2 },
+      { 0x1.724287f46debcp-1, 0x1.4be5f957778a1p-2 }
+  };
+  static const double ln2 = 0x1.62e42fefa39efp-1;
+  union { float f; UINT32 i; } u = { x };
+  UINT32 ix = u.i, tmp;
+  double z, r, y;
+  int i, k;
+
+  if (x < 0.0) return math_error(_DOMAIN, "logf", x, 0, (x - x) / (x - x));
+  if (x == 0.0) return math_error(_SING, "logf", x, 0, -1 / (x * x));
+  if (!isfinite(x)) return x;
+  if (ix < 0x00800000)
+  {
+    u.f *= 0x1p23f;
+    ix = u.i - (23 << 23);
+  }
+
+  /* x = 2^k * m, log(x) = k * log(2) + log(c) + log1p(m / c - 1), evaluated in double precision */
+  tmp = ix - 0x3f330000;
+  i = (tmp >> 18) & 31;
+  k = (int)tmp >> 23;
+  u.i = ix - (tmp & 0xff800000);
+  z = u.f * log_table[i].invc - 1.0;
+  r = z * z;
+  y = -1.0 / 2 + z * (1.0 / 3) + r * (-1.0 / 4 + z * (1.0 / 5))
+          + r * r * (-1.0 / 6 + z * (1.0 / 7) + r * (-1.0 / 8));
+  return k * ln2 + log_table[i].logc + z + r * y;
 }
 
 /*********************************************************************
@@ -598,9 +850,21 @@ float CDECL powf( float x, float y )
  */
 float CDECL sinf( float x )
 {
-  float ret = unix_funcs->sinf( x );
-  if (!isfinite(x)) return math_error(_DOMAIN, "sinf", x, 0, ret);
-  return ret;
+  union { float f; UINT32 i; } u = { x };
+  UINT32 ix = u.i & 0x7fffffff;
+  double y;
+
+  if (ix >= 0x7f800000) return math_error(_DOMAIN, "sinf", x, 0, x - x);
+  if (ix <= 0x3f490fdb) return sinf_kernel(x);  /* |x| <= pi/4 */
+  if (ix >= 0x49800000) return unix_funcs->sinf( x );  /* |x| >= 2^20 */
+
+  switch (rem_pio2f(x, &y) & 3)
+  {
+  case 0: return sinf_kernel(y);
+  case 1: return cosf_kernel(y);
+  case 2: return -sinf_kernel(y);
+  default: return -cosf_kernel(y);
+  }
 }
 
 /*********************************************************************
@@ -707,10 +971,29 @@ float CDECL tanhf( float x )
 
 /*********************************************************************
  *      ceilf (MSVCRT.@)
+ *
+ * Copied from musl: src/math/ceilf.c
  */
 float CDECL ceilf( float x )
 {
-  return unix_funcs->ceilf(x);
+  union { float f; UINT32 i; } u = { x };
+  int e = (int)(u.i >> 23 & 0xff) - 0x7f;
+  UINT32 m;
+
+#ifdef USE_X86_MATH_INSNS
+  if (sse41_supported) return sse41_ceilf(x);
+#endif
+  if (e >= 23) return x;
+  if (e >= 0)
+  {
+    m = 0x007fffff >> e;
+    if (!(u.i & m)) return x;
+    if (!(u.i >> 31)) u.i += m;
+    u.i &= ~m;
+  }
+  else if (u.i >> 31) u.f = -0.0f;
+  else if (u.i << 1) u.f = 1.0f;
+  return u.f;
 }
 
 /*********************************************************************
@@ -727,10 +1010,29 @@ float CDECL fabsf( float x )
 
 /*********************************************************************
  *      floorf (MSVCRT.@)
+ *
+ * Copied from musl: src/math/floorf.c
  */
 float CDECL floorf( float x )
 {
-  return unix_funcs->floorf(x);
+  union { float f; UINT32 i; } u = { x };
+  int e = (int)(u.i >> 23 & 0xff) - 0x7f;
+  UINT32 m;
+
+#ifdef USE_X86_MATH_INSNS
+  if (sse41_supported) return sse41_floorf(x);
+#endif
+  if (e >= 23) return x;
+  if (e >= 0)
+  {
+    m = 0x007fffff >> e;
+    if (!(u.i & m)) return x;
+    if (u.i >> 31) u.i += m;
+    u.i &= ~m;
+  }
+  else if (!(u.i >> 31)) u.i = 0;
+  else if (u.i << 1) u.f = -1.0f;
+  return u.f;
 }
 
 /*********************************************************************
@@ -1094,12 +1396,63 @@ double CDECL exp( double x )
 
 /*********************************************************************
  *		fmod (MSVCRT.@)
+ *
+ * Based on musl: src/math/fmod.c
  */
 double CDECL fmod( double x, double y )
 {
-  double ret = unix_funcs->fmod( x, y );
-  if (!isfinite(x) || !isfinite(y)) return math_error(_DOMAIN, "fmod", x, y, ret);
-  return ret;
+  union { double f; UINT64 i; } ux = { x }, uy = { y };
+  UINT64 xi = ux.i, yi = uy.i, sx = xi & (1ull << 63), i;
+  int ex = xi >> 52 & 0x7ff, ey = yi >> 52 & 0x7ff, n;
+
+  if (!isfinite(x) || !isfinite(y))
+    return math_error(_DOMAIN, "fmod", x, y, isfinite(x) && isinf(y) ? x : (x * y) / (x * y));
+  if (!y) return (x * y) / (x * y);
+  if (xi << 1 <= yi << 1)
+  {
+    if (xi << 1 == yi << 1) return 0 * x;
+    return x;
+  }
+
+  if (!ex)
+  {
+    for (i = xi << 12; i >> 63 == 0; ex--, i <<= 1);
+    xi <<= -ex + 1;
+  }
+  else
+  {
+    xi &= -1ull >> 12;
+    xi |= 1ull << 52;
+  }
+  if (!ey)
+  {
+    for (i = yi << 12; i >> 63 == 0; ey--, i <<= 1);
+    yi <<= -ey + 1;
+  }
+  else
+  {
+    yi &= -1ull >> 12;
+    yi |= 1ull << 52;
+  }
+
+  /* the 53-bit remainder can be shifted by 11 bits at a time without overflowing */
+  for (; ex > ey; ex -= n)
+  {
+    n = min(ex - ey, 11);
+    xi = (xi << n) % yi;
+  }
+  xi %= yi;
+  if (!xi) return 0 * x;
+  for (; xi >> 52 == 0; xi <<= 1, ex--);
+
+  if (ex > 0)
+  {
+    xi -= 1ull << 52;
+    xi |= (UINT64)ex << 52;
+  }
+  else xi >>= -ex + 1;
+  ux.i = xi | sx;
+  return ux.f;
 }
 
 /*********************************************************************
@@ -1567,7 +1920,24 @@ float CDECL _hypotf(float x, float y)
  */
 double CDECL ceil( double x )
 {
-  return unix_funcs->ceil(x);
+  union { double f; UINT64 i; } u = { x };
+  int e = (int)(u.i >> 52 & 0x7ff) - 0x3ff;
+  UINT64 m;
+
+#ifdef USE_X86_MATH_INSNS
+  if (sse41_supported) return sse41_ceil(x);
+#endif
+  if (e >= 52) return x;
+  if (e >= 0)
+  {
+    m = 0x000fffffffffffffull >> e;
+    if (!(u.i & m)) return x;
+    if (!(u.i >> 63)) u.i += m;
+    u.i &= ~m;
+  }
+  else if (u.i >> 63) u.f = -0.0;
+  else if (u.i << 1) u.f = 1.0;
+  return u.f;
 }
 
 /*********************************************************************
@@ -1575,7 +1945,24 @@ double CDECL ceil( double x )
  */
 double CDECL floor( double x )
 {
-  return unix_funcs->floor(x);
+  union { double f; UINT64 i; } u = { x };
+  int e = (int)(u.i >> 52 & 0x7ff) - 0x3ff;
+  UINT64 m;
+
+#ifdef USE_X86_MATH_INSNS
+  if (sse41_supported) return sse41_floor(x);
+#endif
+  if (e >= 52) return x;
+  if (e >= 0)
+  {
+    m = 0x000fffffffffffffull >> e;
+    if (!(u.i & m)) return x;
+    if (u.i >> 63) u.i += m;
+    u.i &= ~m;
+  }
+  else if (!(u.i >> 63)) u.i = 0;
+  else if (u.i << 1) u.f = -1.0;
+  return u.f;
 }
 
 /*********************************************************************
@@ -1583,7 +1970,12 @@ double CDECL floor( double x )
  */
 double CDECL fma( double x, double y, double z )
 {
-  double w = unix_funcs->fma(x, y, z);
+  double w;
+#ifdef USE_X86_MATH_INSNS
+  if (fma_supported) w = fma3_fma(x, y, z);
+  else
+#endif
+  w = unix_funcs->fma(x, y, z);
   if ((isinf(x) && y == 0) || (x == 0 && isinf(y))) *_errno() = EDOM;
   else if (isinf(x) && isinf(z) && x != z) *_errno() = EDOM;
   else if (isinf(y) && isinf(z) && y != z) *_errno() = EDOM;
@@ -1595,7 +1987,12 @@ double CDECL fma( double x, double y, double z )
  */
 float CDECL fmaf( float x, float y, float z )
 {
-  float w = unix_funcs->fmaf(x, y, z);
+  float w;
+#ifdef USE_X86_MATH_INSNS
+  if (fma_supported) w = fma3_fmaf(x, y, z);
+  else
+#endif
+  w = unix_funcs->fmaf(x, y, z);
   if ((isinf(x) && y == 0) || (x == 0 && isinf(y))) *_errno() = EDOM;
   else if (isinf(x) && isinf(z) && x != z) *_errno() = EDOM;
   else if (isinf(y) && isinf(z) && y != z) *_errno() = EDOM;
@@ -3427,7 +3824,23 @@ __int64 CDECL llrintf(float x)
  */
 double CDECL round(double x)
 {
-    return unix_funcs->round(x);
+    union { double f; UINT64 i; } u = { x };
+    int e = (int)(u.i >> 52 & 0x7ff) - 0x3ff;
+    UINT64 m;
+
+    if (e >= 52) return x;
+    if (e < 0)
+    {
+        u.i &= 1ull << 63;
+        if (e == -1) u.i |= 0x3ff0000000000000ull;
+        return u.f;
+    }
+    m = 0x000fffffffffffffull >> e;
+    if (!(u.i & m)) return x;
+    /* adding half an integer may carry into the exponent, which is still correct */
+    u.i += 0x0008000000000000ull >> e;
+    u.i &= ~m;
+    return u.f;
 }
 
 /*********************************************************************
@@ -3435,7 +3848,22 @@ double CDECL round(double x)
  */
 float CDECL roundf(float x)
 {
-    return unix_funcs->roundf(x);
+    union { float f; UINT32 i; } u = { x };
+    int e = (int)(u.i >> 23 & 0xff) - 0x7f;
+    UINT32 m;
+
+    if (e >= 23) return x;
+    if (e < 0)
+    {
+        u.i &= 0x80000000;
+        if (e == -1) u.i |= 0x3f800000;
+        return u.f;
+    }
+    m = 0x007fffff >> e;
+    if (!(u.i & m)) return x;
+    u.i += 0x00400000 >> e;
+    u.i &= ~m;
+    return u.f;
 }
 
 /*********************************************************************
@@ -3472,18 +3900,40 @@ __int64 CDECL llroundf(float x)
 
 /*********************************************************************
  *      trunc (MSVCR120.@)
+ *
+ * Copied from musl: src/math/trunc.c
  */
 double CDECL trunc(double x)
 {
-    return unix_funcs->trunc(x);
+    union { double f; UINT64 i; } u = { x };
+    int e = (int)(u.i >> 52 & 0x7ff) - 0x3ff;
+
+#ifdef USE_X86_MATH_INSNS
+    if (sse41_supported) return sse41_trunc(x);
+#endif
+    if (e >= 52) return x;
+    if (e < 0) u.i &= 1ull << 63;
+    else u.i &= ~(0x000fffffffffffffull >> e);
+    return u.f;
 }
 
 /*********************************************************************
  *      truncf (MSVCR120.@)
+ *
+ * Copied from musl: src/math/truncf.c
  */
 float CDECL truncf(float x)
 {
-    return unix_funcs->truncf(x);
+    union { float f; UINT32 i; } u = { x };
+    int e = (int)(u.i >> 23 & 0xff) - 0x7f;
+
+#ifdef USE_X86_MATH_INSNS
+    if (sse41_supported) return sse41_truncf(x);
+#endif
+    if (e >= 23) return x;
+    if (e < 0) u.i &= 0x80000000;
+    else u.i &= ~(0x007fffff >> e);
+    return u.f;
 }
 
 /*********************************************************************
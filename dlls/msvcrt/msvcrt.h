@@ -164,6 +164,7 @@ struct __thread_data {
 #if _MSVCR_VER >= 140
     _invalid_parameter_handler      invalid_parameter_handler;
 #endif
+    struct block_cache             *block_cache;        /* small blocks cached by malloc */
 };
 
 typedef struct __thread_data thread_data_t;
@@ -191,6 +192,8 @@ typedef enum {
     EXCEPTION_INVALID_SCHEDULER_POLICY_THREAD_SPECIFICATION,
     EXCEPTION_IMPROPER_SCHEDULER_ATTACH,
     EXCEPTION_IMPROPER_SCHEDULER_DETACH,
+    EXCEPTION_CONTEXT_SELF_UNBLOCK,
+    EXCEPTION_CONTEXT_UNBLOCK_UNBALANCED,
 #endif
 } exception_type;
 void throw_exception(exception_type, HRESULT, const char*) DECLSPEC_HIDDEN;
@@ -226,6 +229,7 @@ extern void msvcrt_free_locks(void) DECLSPEC_HIDDEN;
 extern void msvcrt_init_exception(void*) DECLSPEC_HIDDEN;
 extern BOOL msvcrt_init_locale(void) DECLSPEC_HIDDEN;
 extern void msvcrt_init_math(void*) DECLSPEC_HIDDEN;
+extern void msvcrt_init_string(void) DECLSPEC_HIDDEN;
 extern void msvcrt_init_io(void) DECLSPEC_HIDDEN;
 extern void msvcrt_free_io(void) DECLSPEC_HIDDEN;
 extern void msvcrt_init_console(void) DECLSPEC_HIDDEN;
@@ -237,6 +241,7 @@ extern void msvcrt_free_signals(void) DECLSPEC_HIDDEN;
 extern void msvcrt_free_popen_data(void) DECLSPEC_HIDDEN;
 extern BOOL msvcrt_init_heap(void) DECLSPEC_HIDDEN;
 extern void msvcrt_destroy_heap(void) DECLSPEC_HIDDEN;
+extern void msvcrt_free_block_cache(thread_data_t*) DECLSPEC_HIDDEN;
 extern void msvcrt_init_clock(void) DECLSPEC_HIDDEN;
 
 #if _MSVCR_VER >= 100
@@ -292,6 +297,7 @@ extern FILE MSVCRT__iob[];
 
 /* internal file._flag flags */
 #define MSVCRT__USERBUF  0x0100
+#define MSVCRT__IOSETVBUF 0x0400
 #define MSVCRT__IOCOMMIT 0x4000
 
 #define _MAX__TIME64_T    (((__time64_t)0x00000007 << 32) | 0x93406FFF)
@@ -135,6 +135,70 @@ static inline int mbstowcs_len(wchar_t *wcstr, const char *mbstr,
     }
     return wlen;
 }
+
+/* Returns number of decimal digits in limb, 0 is treated as 1 digit long */
+static inline int pf_limb_len(DWORD l)
+{
+    int i;
+
+    for(i=1; i<LIMB_DIGITS && l>=p10s[i]; i++);
+    return i;
+}
+
+/* Stores m*2^e2 in b, the value can be represented exactly with 64-bit
+ * integer arithmetic if -60 <= e2 <= 11. Returns decimal exponent that
+ * matches the one computed when b is filled with bnum_lshift/bnum_rshift. */
+static inline int pf_fp_to_bnum(struct bnum *b, ULONGLONG m, int e2)
+{
+    ULONGLONG ip = m, fp = 0, mask = 0;
+    int i, k = 0, nf = 0;
+
+    while(e2 <= -8 && !(m & 0xff)) {
+        m >>= 8;
+        e2 += 8;
+    }
+    while(e2 < 0 && !(m & 1)) {
+        m >>= 1;
+        e2++;
+    }
+
+    if(e2 >= 0) {
+        ip = m << e2;
+    } else {
+        k = -e2;
+        mask = ((ULONGLONG)1 << k) - 1;
+        ip = m >> k;
+        fp = m & mask;
+        nf = (k + LIMB_DIGITS - 1) / LIMB_DIGITS;
+    }
+
+    /* binary fraction with k digits has exactly k decimal digits,
+     * fp * LIMB_MAX is computed in 32-bit parts when it doesn't fit in 64 bits */
+    for(i=nf-1; i>=0; i--) {
+        if(k <= 34) {
+            fp *= LIMB_MAX;
+            b->data[i] = fp >> k;
+            fp &= mask;
+        } else {
+            ULONGLONG lo = (fp & 0xffffffff) * LIMB_MAX;
+            ULONGLONG hi = (fp >> 32) * LIMB_MAX + (lo >> 32);
+
+            b->data[i] = hi >> (k - 32);
+            fp = ((hi & (mask >> 32)) << 32) | (lo & 0xffffffff);
+        }
+    }
+    b->data[nf] = ip % LIMB_MAX;
+    ip /= LIMB_MAX;
+    b->data[nf + 1] = ip % LIMB_MAX;
+    b->data[nf + 2] = ip / LIMB_MAX;
+
+    b->b = 0;
+    b->e = nf + 3;
+    b->size = BNUM_PREC64;
+    while(b->e > 1 && !b->data[b->e - 1]) b->e--;
+    while(b->b < b->e - 1 && !b->data[b->b]) b->b++;
+    return LIMB_DIGITS * (b->e - nf - 2);
+}
 #endif
 
 static inline int FUNC_NAME(pf_output_wstr)(FUNC_NAME(puts_clbk) pf_puts, void *puts_ctx,
@@ -586,13 +650,64 @@ static inline void FUNC_NAME(pf_integer_conv)(APICHAR *buf, pf_flags *flags, LON
     }
 }
 
+/* pf_fp_buf: collects the characters of a floating point number, so they
+   are passed to pf_puts in bigger chunks */
+struct FUNC_NAME(pf_fp_buf) {
+    FUNC_NAME(puts_clbk) pf_puts;
+    void *puts_ctx;
+    int ret, len;
+    APICHAR buf[64];
+};
+
+static inline int FUNC_NAME(pf_fp_flush)(struct FUNC_NAME(pf_fp_buf) *out)
+{
+    int r;
+
+    if(!out->len) return 0;
+    r = out->pf_puts(out->puts_ctx, out->len, out->buf);
+    out->len = 0;
+    if(r < 0) return r;
+    out->ret += r;
+    return 0;
+}
+
+static inline int FUNC_NAME(pf_fp_put_char)(struct FUNC_NAME(pf_fp_buf) *out,
+        APICHAR ch, int count)
+{
+    int r;
+
+    for(; count > 0; count--) {
+        if(out->len == ARRAY_SIZE(out->buf) && (r = FUNC_NAME(pf_fp_flush)(out)) < 0)
+            return r;
+        out->buf[out->len++] = ch;
+    }
+    return 0;
+}
+
+/* pf_fp_put_digits: outputs len least significant digits of l */
+static inline int FUNC_NAME(pf_fp_put_digits)(struct FUNC_NAME(pf_fp_buf) *out,
+        DWORD l, int len)
+{
+    int r, i;
+
+    if(out->len + len > ARRAY_SIZE(out->buf) && (r = FUNC_NAME(pf_fp_flush)(out)) < 0)
+        return r;
+    for(i = len - 1; i >= 0; i--) {
+        out->buf[out->len + i] = '0' + l % 10;
+        l /= 10;
+    }
+    out->len += len;
+    return 0;
+}
+
 static inline int FUNC_NAME(pf_output_fp)(FUNC_NAME(puts_clbk) pf_puts, void *puts_ctx,
         double v, pf_flags *flags, _locale_t locale, BOOL three_digit_exp,
         BOOL standard_rounding)
 {
-    int e2, e10 = 0, round_pos, round_limb, radix_pos, first_limb_len, i, len, r, ret;
+    int e2, e10 = 0, round_pos, round_limb, radix_pos, first_limb_len, i, len, cnt, r, ret;
     BYTE bnum_data[FIELD_OFFSET(struct bnum, data[BNUM_PREC64])];
     struct bnum *b = (struct bnum*)bnum_data;
+    struct FUNC_NAME(pf_fp_buf) out;
     APICHAR buf[LIMB_DIGITS + 1];
     BOOL trim_tail = FALSE, round_up = FALSE;
     pf_flags f;
@@ -607,22 +722,27 @@ static inline int FUNC_NAME(pf_output_fp)(FUNC_NAME(puts_clbk) pf_puts, void *pu
     if(v) {
         m = (ULONGLONG)1 << (MANT_BITS - 1);
         m |= (*(ULONGLONG*)&v & (((ULONGLONG)1 << (MANT_BITS - 1)) - 1));
-        b->b = 0;
-        b->e = 2;
-        b->size = BNUM_PREC64;
-        b->data[0] = m % LIMB_MAX;
-        b->data[1] = m / LIMB_MAX;
         e2 -= MANT_BITS;
 
-        while(e2 > 0) {
-            int shift = e2 > 29 ? 29 : e2;
-            if(bnum_lshift(b, shift)) e10 += LIMB_DIGITS;
-            e2 -= shift;
-        }
-        while(e2 < 0) {
-            int shift = -e2 > 9 ? 9 : -e2;
-            if(bnum_rshift(b, shift)) e10 -= LIMB_DIGITS;
-            e2 += shift;
+        if(e2 >= -60 && e2 <= 11) {
+            e10 = pf_fp_to_bnum(b, m, e2);
+        } else {
+            b->b = 0;
+            b->e = 2;
+            b->size = BNUM_PREC64;
+            b->data[0] = m % LIMB_MAX;
+            b->data[1] = m / LIMB_MAX;
+
+            while(e2 > 0) {
+                int shift = e2 > 29 ? 29 : e2;
+                if(bnum_lshift(b, shift)) e10 += LIMB_DIGITS;
+                e2 -= shift;
+            }
+            while(e2 < 0) {
+                int shift = -e2 > 9 ? 9 : -e2;
+                if(bnum_rshift(b, shift)) e10 -= LIMB_DIGITS;
+                e2 += shift;
+            }
         }
     } else {
         b->b = 0;
@@ -632,10 +752,7 @@ static inline int FUNC_NAME(pf_output_fp)(FUNC_NAME(puts_clbk) pf_puts, void *pu
         e10 = -LIMB_DIGITS;
     }
 
-    if(!b->data[bnum_idx(b, b->e-1)])
-        first_limb_len = 1;
-    else
-        first_limb_len = floor(log10(b->data[bnum_idx(b, b->e - 1)])) + 1;
+    first_limb_len = pf_limb_len(b->data[bnum_idx(b, b->e - 1)]);
     radix_pos = first_limb_len + LIMB_DIGITS + e10;
 
     round_pos = flags->Precision;
@@ -697,10 +814,7 @@ static inline int FUNC_NAME(pf_output_fp)(FUNC_NAME(puts_clbk) pf_puts, void *pu
                 else b->data[bnum_idx(b, i+1)] = 1;
             }
             if(i == b->e-1) {
-                if(!b->data[bnum_idx(b, b->e-1)])
-                    i = 1;
-                else
-                    i = floor(log10(b->data[bnum_idx(b, b->e-1)])) + 1;
+                i = pf_limb_len(b->data[bnum_idx(b, b->e-1)]);
                 if(i != first_limb_len) {
                     first_limb_len = i;
                     radix_pos++;
@@ -802,16 +916,15 @@ static inline int FUNC_NAME(pf_output_fp)(FUNC_NAME(puts_clbk) pf_puts, void *pu
 
     r = FUNC_NAME(pf_fill)(pf_puts, puts_ctx, len, flags, TRUE);
     if(r < 0) return r;
-    ret = r;
+    out.pf_puts = pf_puts;
+    out.puts_ctx = puts_ctx;
+    out.ret = r;
+    out.len = 0;
 
-    f.Format = 'd';
-    f.PadZero = TRUE;
     if(flags->Format=='f' || flags->Format=='F') {
         if(radix_pos <= 0) {
-            buf[0] = '0';
-            r = pf_puts(puts_ctx, 1, buf);
+            r = FUNC_NAME(pf_fp_put_char)(&out, '0', 1);
             if(r < 0) return r;
-            ret += r;
         }
 
         limb_len = LIMB_DIGITS;
@@ -819,41 +932,35 @@ static inline int FUNC_NAME(pf_output_fp)(FUNC_NAME(puts_clbk) pf_puts, void *pu
             limb_len = (i == b->e-1 ? first_limb_len : LIMB_DIGITS);
             l = b->data[bnum_idx(b, i)];
             if(limb_len > radix_pos) {
-                f.Precision = radix_pos;
+                prec = radix_pos;
                 l /= p10s[limb_len - radix_pos];
                 limb_len = limb_len - radix_pos;
             } else {
-                f.Precision = limb_len;
+                prec = limb_len;
                 limb_len = LIMB_DIGITS;
             }
-            radix_pos -= f.Precision;
-            FUNC_NAME(pf_integer_conv)(buf, &f, l);
+            radix_pos -= prec;
 
-            r = pf_puts(puts_ctx, f.Precision, buf);
+            r = FUNC_NAME(pf_fp_put_digits)(&out, l, prec);
             if(r < 0) return r;
-            ret += r;
         }
 
-        buf[0] = '0';
-        for(; radix_pos>0; radix_pos--) {
-            r = pf_puts(puts_ctx, 1, buf);
-            if(r < 0) return r;
-            ret += r;
-        }
+        r = FUNC_NAME(pf_fp_put_char)(&out, '0', radix_pos);
+        if(r < 0) return r;
+        if(radix_pos > 0) radix_pos = 0;
 
         if(flags->Precision || flags->Alternate) {
-            buf[0] = *(locale ? locale->locinfo : get_locinfo())->lconv->decimal_point;
-            r = pf_puts(puts_ctx, 1, buf);
+            r = FUNC_NAME(pf_fp_put_char)(&out,
+                    *(locale ? locale->locinfo : get_locinfo())->lconv->decimal_point, 1);
             if(r < 0) return r;
-            ret += r;
         }
 
         prec = flags->Precision;
-        buf[0] = '0';
-        for(; prec>0 && radix_pos+LIMB_DIGITS-first_limb_len<0; radix_pos++, prec--) {
-            r = pf_puts(puts_ctx, 1, buf);
+        if(radix_pos+LIMB_DIGITS-first_limb_len < 0) {
+            r = min(prec, -(radix_pos+LIMB_DIGITS-first_limb_len));
+            prec -= r;
+            r = FUNC_NAME(pf_fp_put_char)(&out, '0', r);
             if(r < 0) return r;
-            ret += r;
         }
 
         for(; prec>0 && i>=b->b; i--) {
@@ -861,40 +968,31 @@ static inline int FUNC_NAME(pf_output_fp)(FUNC_NAME(puts_clbk) pf_puts, void *pu
             if(limb_len != LIMB_DIGITS)
                 l %= p10s[limb_len];
             if(limb_len > prec) {
-                f.Precision = prec;
+                cnt = prec;
                 l /= p10s[limb_len - prec];
             } else {
-                f.Precision = limb_len;
+                cnt = limb_len;
                 limb_len = LIMB_DIGITS;
             }
-            prec -= f.Precision;
-            FUNC_NAME(pf_integer_conv)(buf, &f, l);
+            prec -= cnt;
 
-            r = pf_puts(puts_ctx, f.Precision, buf);
+            r = FUNC_NAME(pf_fp_put_digits)(&out, l, cnt);
             if(r < 0) return r;
-            ret += r;
         }
 
-        buf[0] = '0';
-        for(; prec>0; prec--) {
-            r = pf_puts(puts_ctx, 1, buf);
-            if(r < 0) return r;
-            ret += r;
-        }
+        r = FUNC_NAME(pf_fp_put_char)(&out, '0', prec);
+        if(r < 0) return r;
     } else {
         l = b->data[bnum_idx(b, b->e - 1)];
         l /= p10s[first_limb_len - 1];
 
-        buf[0] = '0' + l;
-        r = pf_puts(puts_ctx, 1, buf);
+        r = FUNC_NAME(pf_fp_put_char)(&out, '0' + l, 1);
         if(r < 0) return r;
-        ret += r;
 
         if(flags->Precision || flags->Alternate) {
-            buf[0] = *(locale ? locale->locinfo : get_locinfo())->lconv->decimal_point;
-            r = pf_puts(puts_ctx, 1, buf);
+            r = FUNC_NAME(pf_fp_put_char)(&out,
+                    *(locale ? locale->locinfo : get_locinfo())->lconv->decimal_point, 1);
             if(r < 0) return r;
-            ret += r;
         }
 
         prec = flags->Precision;
@@ -907,42 +1005,42 @@ static inline int FUNC_NAME(pf_output_fp)(FUNC_NAME(puts_clbk) pf_puts, void *pu
             }
 
             if(limb_len > prec) {
-                f.Precision = prec;
+                cnt = prec;
                 l /= p10s[limb_len - prec];
             } else {
-                f.Precision = limb_len;
+                cnt = limb_len;
                 limb_len = LIMB_DIGITS;
             }
-            prec -= f.Precision;
-            FUNC_NAME(pf_integer_conv)(buf, &f, l);
+            prec -= cnt;
 
-            r = pf_puts(puts_ctx, f.Precision, buf);
+            r = FUNC_NAME(pf_fp_put_digits)(&out, l, cnt);
             if(r < 0) return r;
-            ret += r;
         }
 
-        buf[0] = '0';
-        for(; prec>0; prec--) {
-            r = pf_puts(puts_ctx, 1, buf);
-            if(r < 0) return r;
-            ret += r;
-        }
+        r = FUNC_NAME(pf_fp_put_char)(&out, '0', prec);
+        if(r < 0) return r;
 
         if(!trim_tail || radix_pos) {
-            buf[0] = flags->Format;
-            buf[1] = radix_pos < 0 ? '-' : '+';
-            r = pf_puts(puts_ctx, 2, buf);
+            r = FUNC_NAME(pf_fp_put_char)(&out, flags->Format, 1);
+            if(r < 0) return r;
+            r = FUNC_NAME(pf_fp_put_char)(&out, radix_pos < 0 ? '-' : '+', 1);
             if(r < 0) return r;
-            ret += r;
 
+            f.Format = 'd';
+            f.PadZero = TRUE;
             f.Precision = three_digit_exp ? 3 : 2;
             FUNC_NAME(pf_integer_conv)(buf, &f, radix_pos);
-            r = pf_puts(puts_ctx, f.Precision, buf);
-            if(r < 0) return r;
-            ret += r;
+            for(i=0; i<f.Precision; i++) {
+                r = FUNC_NAME(pf_fp_put_char)(&out, buf[i], 1);
+                if(r < 0) return r;
+            }
         }
     }
 
+    r = FUNC_NAME(pf_fp_flush)(&out);
+    if(r < 0) return r;
+    ret = out.ret;
+
     r = FUNC_NAME(pf_fill)(pf_puts, puts_ctx, len, flags, FALSE);
     if(r < 0) return r;
     ret += r;
@@ -92,6 +92,10 @@ typedef struct {
     struct scheduler_list scheduler;
     unsigned int id;
     union allocator_cache_entry *allocator_cache[8];
+    LONG blocked;
+    HANDLE event;
+    struct virtual_processor *vproc;
+    unsigned int oversubscribed;
 } ExternalContextBase;
 extern const vtable_ptr ExternalContextBase_vtable;
 static void ExternalContextBase_ctor(ExternalContextBase*);
@@ -133,9 +137,56 @@ typedef struct {
     int shutdown_size;
     HANDLE *shutdown_events;
     CRITICAL_SECTION cs;
+    struct scheduler_pool *pool;
 } ThreadScheduler;
 extern const vtable_ptr ThreadScheduler_vtable;
 
+/* idle workers above the concurrency level exit after this many ms */
+#define WORKER_IDLE_TIMEOUT 1000
+
+struct scheduler_task {
+    void (__cdecl *proc)(void*);
+    void *data;
+};
+
+/* Tasks are pushed and popped at the tail by the worker owning the queue,
+ * other workers steal the oldest ones from the head. */
+struct work_queue {
+    SRWLOCK lock;
+    struct scheduler_task *tasks;
+    unsigned int size;
+    unsigned int head;
+    unsigned int tail;
+};
+
+struct virtual_processor {
+    struct scheduler_pool *pool;
+    unsigned int id;
+    struct work_queue queue;
+};
+
+/* Worker threads of a ThreadScheduler. Every worker holds a reference to
+ * the pool so it can outlive the scheduler while exiting. When the last
+ * scheduler reference is released, freeing the scheduler is left to the
+ * pool, so that workers still running or blocked can keep using it. */
+struct scheduler_pool {
+    LONG ref;
+    ThreadScheduler *scheduler;
+    BOOL free_scheduler;
+    unsigned int vproc_count;
+    struct virtual_processor *vprocs;
+    unsigned int stack_size;
+    int priority;
+    LONG next_vproc;
+    LONG workers;
+    LONG idle;
+    LONG blocked;
+    LONG oversubscribed;
+    LONG shutdown;
+    HANDLE work_sem;
+    HANDLE done_event;
+};
+
 typedef struct {
     Scheduler *scheduler;
 } _Scheduler;
@@ -146,6 +197,8 @@ typedef struct {
 
 static int context_tls_index = TLS_OUT_OF_INDEXES;
 
+static BOOL scheduler_detaching;
+
 static CRITICAL_SECTION default_scheduler_cs;
 static CRITICAL_SECTION_DEBUG default_scheduler_cs_debug =
 {
@@ -166,21 +219,26 @@ static Context* try_get_current_context(void)
     return TlsGetValue(context_tls_index);
 }
 
-static Context* get_current_context(void)
+static void init_context_tls_index(void)
 {
-    Context *ret;
-
     if (context_tls_index == TLS_OUT_OF_INDEXES) {
         int tls_index = TlsAlloc();
         if (tls_index == TLS_OUT_OF_INDEXES) {
             throw_exception(EXCEPTION_SCHEDULER_RESOURCE_ALLOCATION_ERROR,
                     HRESULT_FROM_WIN32(GetLastError()), NULL);
-            return NULL;
+            return;
         }
 
         if(InterlockedCompareExchange(&context_tls_index, tls_index, TLS_OUT_OF_INDEXES) != TLS_OUT_OF_INDEXES)
             TlsFree(tls_index);
     }
+}
+
+static Context* get_current_context(void)
+{
+    Context *ret;
+
+    init_context_tls_index();
 
     ret = TlsGetValue(context_tls_index);
     if (!ret) {
@@ -217,6 +275,266 @@ static Scheduler* get_current_scheduler(void)
     return context->scheduler.scheduler;
 }
 
+static void work_queue_push(struct work_queue *queue, void (__cdecl *proc)(void*), void *data)
+{
+    struct scheduler_task *tasks = NULL, *old = NULL;
+    unsigned int i, size = 0;
+
+    for (;;) {
+        AcquireSRWLockExclusive(&queue->lock);
+        if (queue->tail - queue->head < queue->size)
+            break;
+
+        if (size > queue->size) {
+            for (i = 0; i < queue->size; i++)
+                tasks[i] = queue->tasks[(queue->head + i) & (queue->size - 1)];
+            old = queue->tasks;
+            queue->tasks = tasks;
+            queue->head = 0;
+            queue->tail = queue->size;
+            queue->size = size;
+            tasks = NULL;
+            break;
+        }
+
+        /* don't allocate with the lock held, operator_new may throw */
+        size = queue->size ? queue->size * 2 : 64;
+        ReleaseSRWLockExclusive(&queue->lock);
+        operator_delete(tasks);
+        tasks = operator_new(size * sizeof(*tasks));
+    }
+
+    queue->tasks[queue->tail & (queue->size - 1)].proc = proc;
+    queue->tasks[queue->tail & (queue->size - 1)].data = data;
+    queue->tail++;
+    ReleaseSRWLockExclusive(&queue->lock);
+
+    operator_delete(old);
+    operator_delete(tasks);
+}
+
+static BOOL work_queue_pop(struct work_queue *queue, struct scheduler_task *task, BOOL steal)
+{
+    BOOL ret;
+
+    if (queue->head == queue->tail)
+        return FALSE;
+
+    AcquireSRWLockExclusive(&queue->lock);
+    ret = queue->head != queue->tail;
+    if (ret && steal)
+        *task = queue->tasks[queue->head++ & (queue->size - 1)];
+    else if (ret)
+        *task = queue->tasks[--queue->tail & (queue->size - 1)];
+    ReleaseSRWLockExclusive(&queue->lock);
+    return ret;
+}
+
+static struct scheduler_pool* scheduler_pool_create(ThreadScheduler *scheduler)
+{
+    struct scheduler_pool *pool;
+    unsigned int i;
+
+    pool = operator_new(sizeof(*pool));
+    memset(pool, 0, sizeof(*pool));
+    pool->ref = 1;
+    pool->scheduler = scheduler;
+    pool->vproc_count = scheduler->virt_proc_no;
+    pool->stack_size = scheduler->policy.policy_container->policies[ContextStackSize] * 1024;
+    pool->priority = scheduler->policy.policy_container->policies[ContextPriority];
+
+    pool->vprocs = operator_new(pool->vproc_count * sizeof(*pool->vprocs));
+    memset(pool->vprocs, 0, pool->vproc_count * sizeof(*pool->vprocs));
+    for (i = 0; i < pool->vproc_count; i++) {
+        pool->vprocs[i].pool = pool;
+        pool->vprocs[i].id = i;
+        InitializeSRWLock(&pool->vprocs[i].queue.lock);
+    }
+
+    pool->work_sem = CreateSemaphoreW(NULL, 0, MAXLONG, NULL);
+    pool->done_event = CreateEventW(NULL, TRUE, FALSE, NULL);
+    if (!pool->work_sem || !pool->done_event) {
+        DWORD err = GetLastError();
+
+        if (pool->work_sem) CloseHandle(pool->work_sem);
+        if (pool->done_event) CloseHandle(pool->done_event);
+        operator_delete(pool->vprocs);
+        operator_delete(pool);
+        throw_exception(EXCEPTION_SCHEDULER_RESOURCE_ALLOCATION_ERROR,
+                HRESULT_FROM_WIN32(err), NULL);
+        return NULL;
+    }
+    return pool;
+}
+
+static void ThreadScheduler_free(ThreadScheduler*);
+
+static void scheduler_pool_release(struct scheduler_pool *pool)
+{
+    unsigned int i;
+
+    if (InterlockedDecrement(&pool->ref))
+        return;
+
+    if (pool->free_scheduler) {
+        ThreadScheduler_free(pool->scheduler);
+        operator_delete(pool->scheduler);
+    }
+    for (i = 0; i < pool->vproc_count; i++)
+        operator_delete(pool->vprocs[i].queue.tasks);
+    operator_delete(pool->vprocs);
+    CloseHandle(pool->work_sem);
+    CloseHandle(pool->done_event);
+    operator_delete(pool);
+}
+
+static BOOL scheduler_pool_has_tasks(const struct scheduler_pool *pool)
+{
+    unsigned int i;
+
+    for (i = 0; i < pool->vproc_count; i++) {
+        if (pool->vprocs[i].queue.head != pool->vprocs[i].queue.tail)
+            return TRUE;
+    }
+    return FALSE;
+}
+
+static BOOL scheduler_pool_get_task(struct scheduler_pool *pool,
+        struct virtual_processor *vproc, struct scheduler_task *task)
+{
+    unsigned int i;
+
+    if (work_queue_pop(&vproc->queue, task, FALSE))
+        return TRUE;
+    for (i = 1; i < pool->vproc_count; i++) {
+        if (work_queue_pop(&pool->vprocs[(vproc->id + i) % pool->vproc_count].queue, task, TRUE))
+            return TRUE;
+    }
+    return FALSE;
+}
+
+/* blocked workers don't count against the concurrency level */
+static BOOL scheduler_pool_is_full(const struct scheduler_pool *pool, LONG workers)
+{
+    return workers - pool->blocked >= (LONG)pool->vproc_count + pool->oversubscribed;
+}
+
+static void ExternalContextBase_ctor_worker(ExternalContextBase*, struct virtual_processor*);
+static void ExternalContextBase_detach_worker(ExternalContextBase*);
+
+static DWORD WINAPI scheduler_pool_worker(void *arg)
+{
+    struct virtual_processor *vproc = arg;
+    struct scheduler_pool *pool = vproc->pool;
+    ExternalContextBase *context;
+    struct scheduler_task task;
+    DWORD ret;
+
+    context = operator_new(sizeof(*context));
+    ExternalContextBase_ctor_worker(context, vproc);
+    TlsSetValue(context_tls_index, context);
+
+    for (;;) {
+        if (scheduler_pool_get_task(pool, vproc, &task)) {
+            task.proc(task.data);
+            continue;
+        }
+
+        /* Check the queues again after announcing we're idle, a task
+         * scheduled in between either is found or releases the semaphore. */
+        InterlockedIncrement(&pool->idle);
+        if (scheduler_pool_get_task(pool, vproc, &task)) {
+            InterlockedDecrement(&pool->idle);
+            task.proc(task.data);
+            continue;
+        }
+        if (pool->shutdown) {
+            InterlockedDecrement(&pool->idle);
+            break;
+        }
+
+        ret = WaitForSingleObject(pool->work_sem, WORKER_IDLE_TIMEOUT);
+        InterlockedDecrement(&pool->idle);
+        if (ret == WAIT_TIMEOUT && pool->workers - pool->blocked >
+                (LONG)pool->vproc_count + pool->oversubscribed)
+            break;
+    }
+
+    ExternalContextBase_detach_worker(context);
+    if (!InterlockedDecrement(&pool->workers) && pool->shutdown)
+        SetEvent(pool->done_event);
+    scheduler_pool_release(pool);
+    return 0;
+}
+
+static void scheduler_pool_add_worker(struct scheduler_pool *pool)
+{
+    HANDLE thread;
+    LONG workers;
+
+    do {
+        workers = pool->workers;
+        if (pool->shutdown || scheduler_pool_is_full(pool, workers))
+            return;
+    } while (InterlockedCompareExchange(&pool->workers, workers + 1, workers) != workers);
+
+    InterlockedIncrement(&pool->ref);
+    thread = CreateThread(NULL, pool->stack_size, scheduler_pool_worker,
+            &pool->vprocs[workers % pool->vproc_count], 0, NULL);
+    if (!thread) {
+        ERR("failed to create worker thread: %u\n", GetLastError());
+        if (!InterlockedDecrement(&pool->workers) && pool->shutdown)
+            SetEvent(pool->done_event);
+        scheduler_pool_release(pool);
+        return;
+    }
+
+    if (pool->priority != THREAD_PRIORITY_NORMAL && pool->priority != INHERIT_THREAD_PRIORITY)
+        SetThreadPriority(thread, pool->priority);
+    CloseHandle(thread);
+}
+
+static void scheduler_pool_schedule(struct scheduler_pool *pool,
+        void (__cdecl *proc)(void*), void *data)
+{
+    ExternalContextBase *context;
+    struct virtual_processor *vproc;
+
+    /* the worker threads keep their context in TLS */
+    init_context_tls_index();
+
+    context = (ExternalContextBase*)try_get_current_context();
+    if (context && context->context.vtable == &ExternalContextBase_vtable
+            && context->vproc && context->vproc->pool == pool)
+        vproc = context->vproc;
+    else
+        vproc = &pool->vprocs[(ULONG)InterlockedIncrement(&pool->next_vproc) % pool->vproc_count];
+    work_queue_push(&vproc->queue, proc, data);
+
+    if (InterlockedCompareExchange(&pool->idle, 0, 0))
+        ReleaseSemaphore(pool->work_sem, 1, NULL);
+    else
+        scheduler_pool_add_worker(pool);
+}
+
+static HANDLE ExternalContextBase_get_event(ExternalContextBase *this)
+{
+    HANDLE event;
+
+    if (this->event)
+        return this->event;
+
+    event = CreateEventW(NULL, FALSE, FALSE, NULL);
+    if (!event) {
+        throw_exception(EXCEPTION_SCHEDULER_RESOURCE_ALLOCATION_ERROR,
+                HRESULT_FROM_WIN32(GetLastError()), NULL);
+        return NULL;
+    }
+    if (InterlockedCompareExchangePointer(&this->event, event, NULL))
+        CloseHandle(event);
+    return this->event;
+}
+
 /* ?CurrentContext@Context@Concurrency@@SAPAV12@XZ */
 /* ?CurrentContext@Context@Concurrency@@SAPEAV12@XZ */
 Context* __cdecl Context_CurrentContext(void)
@@ -236,20 +554,49 @@ unsigned int __cdecl Context_Id(void)
 /* ?Block@Context@Concurrency@@SAXXZ */
 void __cdecl Context_Block(void)
 {
-    FIXME("()\n");
+    ExternalContextBase *context = (ExternalContextBase*)get_current_context();
+    struct scheduler_pool *pool = NULL;
+    HANDLE event;
+
+    TRACE("()\n");
+
+    if (context->context.vtable != &ExternalContextBase_vtable) {
+        ERR("unknown context set\n");
+        return;
+    }
+
+    /* create the event first so Unblock never fails to wake us up */
+    event = ExternalContextBase_get_event(context);
+    if (InterlockedDecrement(&context->blocked) >= 0)
+        return;
+
+    if (context->vproc) {
+        /* let another worker run the queued tasks while we're blocked */
+        pool = context->vproc->pool;
+        InterlockedIncrement(&pool->blocked);
+        if (scheduler_pool_has_tasks(pool))
+            scheduler_pool_add_worker(pool);
+    }
+
+    WaitForSingleObject(event, INFINITE);
+
+    if (pool)
+        InterlockedDecrement(&pool->blocked);
 }
 
 /* ?Yield@Context@Concurrency@@SAXXZ */
 /* ?_Yield@_Context@details@Concurrency@@SAXXZ */
 void __cdecl Context_Yield(void)
 {
-    FIXME("()\n");
+    TRACE("()\n");
+    SwitchToThread();
 }
 
 /* ?_SpinYield@Context@Concurrency@@SAXXZ */
 void __cdecl Context__SpinYield(void)
 {
-    FIXME("()\n");
+    TRACE("()\n");
+    Sleep(0);
 }
 
 /* ?IsCurrentTaskCollectionCanceling@Context@Concurrency@@SA_NXZ */
@@ -262,7 +609,35 @@ bool __cdecl Context_IsCurrentTaskCollectionCanceling(void)
 /* ?Oversubscribe@Context@Concurrency@@SAX_N@Z */
 void __cdecl Context_Oversubscribe(bool begin)
 {
-    FIXME("(%x)\n", begin);
+    ExternalContextBase *context = (ExternalContextBase*)get_current_context();
+    struct scheduler_pool *pool;
+
+    TRACE("(%x)\n", begin);
+
+    if (context->context.vtable != &ExternalContextBase_vtable) {
+        ERR("unknown context set\n");
+        return;
+    }
+
+    if (!begin && !context->oversubscribed) {
+        WARN("no matching Oversubscribe(true) call\n");
+        return;
+    }
+
+    if (begin ? context->oversubscribed++ : --context->oversubscribed)
+        return;
+    if (!context->vproc)
+        return;
+
+    /* allow one more worker while this one is busy */
+    pool = context->vproc->pool;
+    if (begin) {
+        InterlockedIncrement(&pool->oversubscribed);
+        if (scheduler_pool_has_tasks(pool))
+            scheduler_pool_add_worker(pool);
+    } else {
+        InterlockedDecrement(&pool->oversubscribed);
+    }
 }
 
 /* ?ScheduleGroupId@Context@Concurrency@@SAIXZ */
@@ -301,8 +676,8 @@ unsigned int __thiscall ExternalContextBase_GetId(const ExternalContextBase *thi
 DEFINE_THISCALL_WRAPPER(ExternalContextBase_GetVirtualProcessorId, 4)
 unsigned int __thiscall ExternalContextBase_GetVirtualProcessorId(const ExternalContextBase *this)
 {
-    FIXME("(%p)->() stub\n", this);
-    return -1;
+    TRACE("(%p)->()\n", this);
+    return this->vproc ? this->vproc->id : -1;
 }
 
 DEFINE_THISCALL_WRAPPER(ExternalContextBase_GetScheduleGroupId, 4)
@@ -315,14 +690,27 @@ unsigned int __thiscall ExternalContextBase_GetScheduleGroupId(const ExternalCon
 DEFINE_THISCALL_WRAPPER(ExternalContextBase_Unblock, 4)
 void __thiscall ExternalContextBase_Unblock(ExternalContextBase *this)
 {
-    FIXME("(%p)->() stub\n", this);
+    LONG blocked;
+
+    TRACE("(%p)->()\n", this);
+
+    if (&this->context == try_get_current_context())
+        throw_exception(EXCEPTION_CONTEXT_SELF_UNBLOCK, 0, "Context cannot unblock itself");
+
+    blocked = InterlockedIncrement(&this->blocked);
+    if (!blocked) {
+        SetEvent(ExternalContextBase_get_event(this));
+    } else if (blocked > 1) {
+        InterlockedDecrement(&this->blocked);
+        throw_exception(EXCEPTION_CONTEXT_UNBLOCK_UNBALANCED, 0, "Context unblocked more than once");
+    }
 }
 
 DEFINE_THISCALL_WRAPPER(ExternalContextBase_IsSynchronouslyBlocked, 4)
 bool __thiscall ExternalContextBase_IsSynchronouslyBlocked(const ExternalContextBase *this)
 {
-    FIXME("(%p)->() stub\n", this);
-    return FALSE;
+    TRACE("(%p)->()\n", this);
+    return this->blocked < 0;
 }
 
 static void ExternalContextBase_dtor(ExternalContextBase *this)
@@ -348,6 +736,9 @@ static void ExternalContextBase_dtor(ExternalContextBase *this)
             operator_delete(scheduler_cur);
         }
     }
+
+    if (this->event)
+        CloseHandle(this->event);
 }
 
 DEFINE_THISCALL_WRAPPER(ExternalContextBase_vector_dtor, 8)
@@ -383,6 +774,40 @@ static void ExternalContextBase_ctor(ExternalContextBase *this)
     call_Scheduler_Reference(&default_scheduler->scheduler);
 }
 
+/* The scheduler of a worker context is not referenced, it's kept alive
+ * until the workers exit. */
+static void ExternalContextBase_ctor_worker(ExternalContextBase *this,
+        struct virtual_processor *vproc)
+{
+    TRACE("(%p)->(%p)\n", this, vproc);
+
+    memset(this, 0, sizeof(*this));
+    this->context.vtable = &ExternalContextBase_vtable;
+    this->id = InterlockedIncrement(&context_id);
+    this->scheduler.scheduler = &vproc->pool->scheduler->scheduler;
+    this->vproc = vproc;
+}
+
+static void ExternalContextBase_detach_worker(ExternalContextBase *this)
+{
+    struct scheduler_list **entry = &this->scheduler.next;
+
+    if (this->oversubscribed)
+        InterlockedDecrement(&this->vproc->pool->oversubscribed);
+    this->oversubscribed = 0;
+    this->vproc = NULL;
+
+    /* drop the unreferenced worker scheduler from the bottom of the list */
+    if (!*entry) {
+        this->scheduler.scheduler = NULL;
+        return;
+    }
+    while ((*entry)->next)
+        entry = &(*entry)->next;
+    operator_delete(*entry);
+    *entry = NULL;
+}
+
 /* ?Alloc@Concurrency@@YAPAXI@Z */
 /* ?Alloc@Concurrency@@YAPEAX_K@Z */
 void * CDECL Concurrency_Alloc(size_t size)
@@ -611,11 +1036,11 @@ void __thiscall SchedulerPolicy_dtor(SchedulerPolicy *this)
     operator_delete(this->policy_container);
 }
 
-static void ThreadScheduler_dtor(ThreadScheduler *this)
+/* frees what's left of the scheduler once no worker uses it any more */
+static void ThreadScheduler_free(ThreadScheduler *this)
 {
     int i;
 
-    if(this->ref != 0) WARN("ref = %d\n", this->ref);
     SchedulerPolicy_dtor(&this->policy);
 
     for(i=0; i<this->shutdown_count; i++)
@@ -626,6 +1051,47 @@ static void ThreadScheduler_dtor(ThreadScheduler *this)
     DeleteCriticalSection(&this->cs);
 }
 
+/* Shut the scheduler down once it's not referenced any more. The workers
+ * finish the queued tasks and exit, and the last one frees the scheduler.
+ * Nothing waits for them, since the last reference may be released by one
+ * of the workers, or while a worker is blocked in Context_Block. */
+static void ThreadScheduler_release_pool(ThreadScheduler *this)
+{
+    struct scheduler_pool *pool = this->pool;
+    LONG workers;
+
+    if(this->ref != 0) WARN("ref = %d\n", this->ref);
+
+    pool->free_scheduler = TRUE;
+    InterlockedExchange(&pool->shutdown, TRUE);
+    workers = InterlockedCompareExchange(&pool->workers, 0, 0);
+    if (workers)
+        ReleaseSemaphore(pool->work_sem, workers, NULL);
+    scheduler_pool_release(pool);
+}
+
+/* destructor for a scheduler whose memory is owned by the caller */
+static void ThreadScheduler_dtor(ThreadScheduler *this)
+{
+    ExternalContextBase *context = (ExternalContextBase*)try_get_current_context();
+    struct scheduler_pool *pool = this->pool;
+    LONG workers;
+
+    if(this->ref != 0) WARN("ref = %d\n", this->ref);
+
+    /* let the workers finish the queued tasks and exit */
+    InterlockedExchange(&pool->shutdown, TRUE);
+    workers = InterlockedCompareExchange(&pool->workers, 0, 0);
+    if (workers) {
+        ReleaseSemaphore(pool->work_sem, workers, NULL);
+        if (!scheduler_detaching && (!context || context->context.vtable != &ExternalContextBase_vtable
+                    || !context->vproc || context->vproc->pool != pool))
+            WaitForSingleObject(pool->done_event, INFINITE);
+    }
+    scheduler_pool_release(pool);
+    ThreadScheduler_free(this);
+}
+
 DEFINE_THISCALL_WRAPPER(ThreadScheduler_Id, 4)
 unsigned int __thiscall ThreadScheduler_Id(const ThreadScheduler *this)
 {
@@ -662,10 +1128,8 @@ unsigned int __thiscall ThreadScheduler_Release(ThreadScheduler *this)
 
     TRACE("(%p)\n", this);
 
-    if(!ret) {
-        ThreadScheduler_dtor(this);
-        operator_delete(this);
-    }
+    if(!ret)
+        ThreadScheduler_release_pool(this);
     return ret;
 }
 
@@ -734,14 +1198,20 @@ DEFINE_THISCALL_WRAPPER(ThreadScheduler_ScheduleTask_loc, 16)
 void __thiscall ThreadScheduler_ScheduleTask_loc(ThreadScheduler *this,
         void (__cdecl *proc)(void*), void* data, /*location*/void *placement)
 {
-    FIXME("(%p %p %p %p) stub\n", this, proc, data, placement);
+    static int once;
+
+    if (!once++) FIXME("(%p %p %p %p) placement ignored\n", this, proc, data, placement);
+    else TRACE("(%p %p %p %p)\n", this, proc, data, placement);
+
+    scheduler_pool_schedule(this->pool, proc, data);
 }
 
 DEFINE_THISCALL_WRAPPER(ThreadScheduler_ScheduleTask, 12)
 void __thiscall ThreadScheduler_ScheduleTask(ThreadScheduler *this,
         void (__cdecl *proc)(void*), void* data)
 {
-    FIXME("(%p %p %p) stub\n", this, proc, data);
+    TRACE("(%p %p %p)\n", this, proc, data);
+    scheduler_pool_schedule(this->pool, proc, data);
 }
 
 DEFINE_THISCALL_WRAPPER(ThreadScheduler_IsAvailableLocation, 8)
@@ -763,10 +1233,10 @@ Scheduler* __thiscall ThreadScheduler_vector_dtor(ThreadScheduler *this, unsigne
         for(i=*ptr-1; i>=0; i--)
             ThreadScheduler_dtor(this+i);
         operator_delete(ptr);
+    } else if(flags & 1) {
+        ThreadScheduler_release_pool(this);
     } else {
         ThreadScheduler_dtor(this);
-        if(flags & 1)
-            operator_delete(this);
     }
 
     return &this->scheduler;
@@ -786,11 +1256,15 @@ static ThreadScheduler* ThreadScheduler_ctor(ThreadScheduler *this,
 
     GetSystemInfo(&si);
     this->virt_proc_no = SchedulerPolicy_GetPolicyValue(&this->policy, MaxConcurrency);
-    if(this->virt_proc_no > si.dwNumberOfProcessors)
-        this->virt_proc_no = si.dwNumberOfProcessors;
+    if(this->virt_proc_no > si.dwNumberOfProcessors) {
+        this->virt_proc_no = SchedulerPolicy_GetPolicyValue(&this->policy, MinConcurrency);
+        if(this->virt_proc_no < si.dwNumberOfProcessors)
+            this->virt_proc_no = si.dwNumberOfProcessors;
+    }
 
     this->shutdown_count = this->shutdown_size = 0;
     this->shutdown_events = NULL;
+    this->pool = scheduler_pool_create(this);
 
     InitializeCriticalSection(&this->cs);
     this->cs.DebugInfo->Spare[0] = (DWORD_PTR)(__FILE__ ": ThreadScheduler");
@@ -1152,6 +1626,8 @@ void msvcrt_init_scheduler(void *base)
 
 void msvcrt_free_scheduler(void)
 {
+    /* don't wait for the workers, they can't exit with the loader lock held */
+    scheduler_detaching = TRUE;
     if (context_tls_index != TLS_OUT_OF_INDEXES)
         TlsFree(context_tls_index);
     if(default_scheduler_policy.policy_container)
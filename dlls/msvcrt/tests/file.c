@@ -561,6 +561,103 @@ static void test_readboundary(void)
   ok(strcmp(buf, rbuf) == 0,"CRLF on buffer boundary failure\n");
   }
 
+static void test_text_lines(void)
+{
+    char line[128], rbuf[128];
+    int i, lines = 0, crlf = 0, c, prev = 0;
+    FILE *fp;
+
+    /* long enough for the stream buffers to be refilled and flushed many times */
+    fp = fopen("lines.tst", "wt");
+    ok(fp != NULL, "fopen failed\n");
+    for (i = 0; i < 10000; i++)
+    {
+        sprintf(line, "%d:%.*s\n", i, i % 97, "abcdefghijklmnopqrstuvwxyzabcdefghijklmnopqrstuvwxyz"
+                "abcdefghijklmnopqrstuvwxyzabcdefghijklmnopqrstuvwxyz");
+        ok(fputs(line, fp) >= 0, "fputs failed\n");
+        if (i % 3 == 0) fputc('\n', fp);
+    }
+    fclose(fp);
+
+    fp = fopen("lines.tst", "rb");
+    ok(fp != NULL, "fopen failed\n");
+    while ((c = fgetc(fp)) != EOF)
+    {
+        if (c == '\n')
+        {
+            ok(prev == '\r', "\\n not preceded by \\r\n");
+            crlf++;
+        }
+        prev = c;
+    }
+    fclose(fp);
+    ok(crlf == 10000 + 3334, "got %d line breaks\n", crlf);
+
+    fp = fopen("lines.tst", "rt");
+    ok(fp != NULL, "fopen failed\n");
+    for (i = 0; i < 10000; i++)
+    {
+        sprintf(line, "%d:%.*s\n", i, i % 97, "abcdefghijklmnopqrstuvwxyzabcdefghijklmnopqrstuvwxyz"
+                "abcdefghijklmnopqrstuvwxyzabcdefghijklmnopqrstuvwxyz");
+        if (!fgets(rbuf, sizeof(rbuf), fp)) break;
+        if (strcmp(rbuf, line)) break;
+        lines++;
+        if (i % 3 == 0)
+        {
+            ok(fgets(rbuf, sizeof(rbuf), fp) && !strcmp(rbuf, "\n"), "got %s\n", rbuf);
+            lines++;
+        }
+    }
+    ok(lines == 10000 + 3334, "line %d: got %s, expected %s\n", i, rbuf, line);
+
+    /* lines longer than the destination buffer are split */
+    ok(!fseek(fp, 0, SEEK_SET), "fseek failed\n");
+    for (i = 0; i < 3; i++)
+        ok(fgets(rbuf, sizeof(rbuf), fp) != NULL, "fgets failed\n");
+    ok(fgets(rbuf, 3, fp) && !strcmp(rbuf, "2:"), "got %s\n", rbuf);
+    ok(fgets(rbuf, 2, fp) && !strcmp(rbuf, "a"), "got %s\n", rbuf);
+    ok(fgets(rbuf, sizeof(rbuf), fp) && !strcmp(rbuf, "b\n"), "got %s\n", rbuf);
+    fclose(fp);
+    unlink("lines.tst");
+}
+
+static void test_text_lines_throughput(void)
+{
+    static const char line[] = "The quick brown fox jumps over the lazy dog, 0123456789\n";
+    LARGE_INTEGER freq, start, end;
+    unsigned int i, count = (1024 * 1024 * 1024) / (sizeof(line) - 1);
+    char rbuf[256];
+    FILE *fp;
+
+    if (!winetest_interactive)
+    {
+        skip("stdio benchmarks are only run in interactive mode\n");
+        return;
+    }
+
+    QueryPerformanceFrequency(&freq);
+    fp = fopen("bench.tst", "wt");
+    ok(fp != NULL, "fopen failed\n");
+    QueryPerformanceCounter(&start);
+    for (i = 0; i < count; i++)
+        fputs(line, fp);
+    fclose(fp);
+    QueryPerformanceCounter(&end);
+    trace("fputs: %.1f MB/s\n", (double)count * (sizeof(line) - 1) * freq.QuadPart /
+          (end.QuadPart - start.QuadPart) / (1024 * 1024));
+
+    fp = fopen("bench.tst", "rt");
+    ok(fp != NULL, "fopen failed\n");
+    QueryPerformanceCounter(&start);
+    for (i = 0; fgets(rbuf, sizeof(rbuf), fp); i++);
+    fclose(fp);
+    QueryPerformanceCounter(&end);
+    ok(i == count, "read %u lines, expected %u\n", i, count);
+    trace("fgets: %.1f MB/s\n", (double)count * (sizeof(line) - 1) * freq.QuadPart /
+          (end.QuadPart - start.QuadPart) / (1024 * 1024));
+    unlink("bench.tst");
+}
+
 static void test_fgetc( void )
 {
   char* tempf;
@@ -2713,6 +2810,8 @@ START_TEST(file)
     test_readmode(FALSE); /* binary mode */
     test_readmode(TRUE);  /* ascii mode */
     test_readboundary();
+    test_text_lines();
+    test_text_lines_throughput();
     test_fgetc();
     test_fputc();
     test_flsbuf();
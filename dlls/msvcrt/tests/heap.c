@@ -21,6 +21,8 @@
 #include <stdlib.h>
 #include <malloc.h>
 #include <errno.h>
+#include <stdio.h>
+#include <string.h>
 #include "wine/test.h"
 
 static void (__cdecl *p_aligned_free)(void*) = NULL;
@@ -483,10 +485,217 @@ static void test_calloc(void)
     free(ptr);
 }
 
+#define SMALL_BLOCKS 4096
+
+static void *small_blocks[SMALL_BLOCKS];
+
+static size_t small_block_size(unsigned int i)
+{
+    return (i * 37) % 1100;
+}
+
+static void fill_small_blocks(unsigned int seed)
+{
+    unsigned int i;
+
+    for (i = 0; i < SMALL_BLOCKS; i++)
+    {
+        small_blocks[i] = malloc(small_block_size(i));
+        ok(small_blocks[i] != NULL, "malloc(%Iu) failed\n", small_block_size(i));
+        memset(small_blocks[i], (i + seed) & 0xff, small_block_size(i));
+    }
+}
+
+static void check_small_blocks(unsigned int seed)
+{
+    unsigned int i, j;
+    size_t size;
+
+    for (i = 0; i < SMALL_BLOCKS; i++)
+    {
+        size = small_block_size(i);
+        for (j = 0; j < size; j++)
+            if (((unsigned char *)small_blocks[i])[j] != ((i + seed) & 0xff)) break;
+        ok(j == size, "block %u of size %Iu overwritten at %u\n", i, size, j);
+    }
+}
+
+static DWORD WINAPI free_small_blocks_thread(void *arg)
+{
+    unsigned int i;
+
+    for (i = 0; i < SMALL_BLOCKS; i++) free(small_blocks[i]);
+    return 0;
+}
+
+static void test_small_blocks(void)
+{
+    _HEAPINFO info;
+    HANDLE thread;
+    void *mem, *mem2;
+    size_t size;
+    int ret;
+
+    for (size = 0; size <= 1100; size += 7)
+    {
+        mem = malloc(size);
+        ok(mem != NULL, "malloc(%Iu) failed\n", size);
+        ok(!((UINT_PTR)mem & (2 * sizeof(void *) - 1)), "incorrect alignment (%p)\n", mem);
+        ok(_msize(mem) == size, "_msize returned %Iu, expected %Iu\n", _msize(mem), size);
+        free(mem);
+
+        mem = calloc(1, size);
+        ok(mem != NULL, "calloc(%Iu) failed\n", size);
+        ok(!size || !((unsigned char *)mem)[size - 1], "calloc didn't clear the block\n");
+        free(mem);
+    }
+
+    mem = malloc(100);
+    memset(mem, 0x55, 100);
+    ok(_expand(mem, 90) == mem, "_expand failed\n");
+    ok(_msize(mem) == 90, "_msize returned %Iu\n", _msize(mem));
+    mem = realloc(mem, 2000);
+    ok(mem != NULL, "realloc failed\n");
+    ok(_msize(mem) == 2000, "_msize returned %Iu\n", _msize(mem));
+    ok(((unsigned char *)mem)[89] == 0x55, "realloc didn't copy the data\n");
+    free(mem);
+
+    /* shrinking leaves more unused bytes than a block of the smaller size would */
+    for (size = 256; size <= 1024; size += 16)
+    {
+        mem = malloc(size);
+        memset(mem, 0x55, size);
+        mem = realloc(mem, size - 255);
+        ok(mem != NULL, "realloc(%Iu) failed\n", size - 255);
+        ok(_msize(mem) == size - 255, "_msize returned %Iu, expected %Iu\n", _msize(mem), size - 255);
+        ok(((unsigned char *)mem)[size - 256] == 0x55, "realloc didn't keep the data\n");
+        free(mem);
+    }
+    mem = malloc(1024);
+    ok(_expand(mem, 1) == mem, "_expand failed\n");
+    ok(_msize(mem) == 1, "_msize returned %Iu\n", _msize(mem));
+    free(mem);
+
+    /* a live block is reported by _heapwalk */
+    mem = malloc(40);
+    memset(&info, 0, sizeof(info));
+    while ((ret = _heapwalk(&info)) == _HEAPOK)
+        if (info._pentry == mem) break;
+    ok(ret == _HEAPOK, "block not found, ret %d\n", ret);
+    ok(info._useflag == _USEDENTRY, "got flag %d\n", info._useflag);
+    ok(info._size >= 40, "got size %Iu\n", info._size);
+    free(mem);
+
+    /* blocks allocated on one thread and freed on another one */
+    fill_small_blocks(0);
+    check_small_blocks(0);
+    thread = CreateThread(NULL, 0, free_small_blocks_thread, NULL, 0, NULL);
+    ok(!WaitForSingleObject(thread, 10000), "thread didn't exit\n");
+    CloseHandle(thread);
+    fill_small_blocks(1);
+    mem = malloc(24);
+    mem2 = malloc(24);
+    ok(mem != mem2, "got the same block twice\n");
+    check_small_blocks(1);
+    free_small_blocks_thread(NULL);
+    free(mem);
+    free(mem2);
+}
+
+struct alloc_bench
+{
+    HANDLE start;
+    unsigned int iterations;
+    void **shared;  /* blocks passed to the next thread */
+};
+
+static DWORD WINAPI alloc_bench_thread(void *arg)
+{
+    struct alloc_bench *bench = arg;
+    unsigned int i, seed = GetCurrentThreadId();
+    void *live[64] = {0}, *mem;
+
+    WaitForSingleObject(bench->start, INFINITE);
+    for (i = 0; i < bench->iterations; i++)
+    {
+        seed = seed * 1103515245 + 12345;
+        free(live[i % ARRAY_SIZE(live)]);
+        live[i % ARRAY_SIZE(live)] = malloc((seed >> 16) % 256);
+        /* every now and then, free a block allocated by another thread */
+        if (!(i % 16))
+        {
+            mem = InterlockedExchangePointer(bench->shared, live[(i + 1) % ARRAY_SIZE(live)]);
+            live[(i + 1) % ARRAY_SIZE(live)] = NULL;
+            free(mem);
+        }
+    }
+    for (i = 0; i < ARRAY_SIZE(live); i++) free(live[i]);
+    return 0;
+}
+
+static void test_alloc_throughput(const char *name)
+{
+    static const unsigned int counts[] = { 1, 2, 4, 8 };
+    HANDLE threads[8];
+    struct alloc_bench bench;
+    LARGE_INTEGER freq, start, end;
+    void *shared = NULL;
+    unsigned int i, j;
+
+    if (!winetest_interactive)
+    {
+        skip("allocation benchmarks are only run in interactive mode\n");
+        return;
+    }
+
+    QueryPerformanceFrequency(&freq);
+    bench.iterations = 2000000;
+    bench.shared = &shared;
+    for (i = 0; i < ARRAY_SIZE(counts); i++)
+    {
+        bench.start = CreateEventA(NULL, TRUE, FALSE, NULL);
+        for (j = 0; j < counts[i]; j++)
+            threads[j] = CreateThread(NULL, 0, alloc_bench_thread, &bench, 0, NULL);
+        QueryPerformanceCounter(&start);
+        SetEvent(bench.start);
+        WaitForMultipleObjects(counts[i], threads, TRUE, INFINITE);
+        QueryPerformanceCounter(&end);
+        for (j = 0; j < counts[i]; j++) CloseHandle(threads[j]);
+        CloseHandle(bench.start);
+        trace("%s: %u threads: %.1f million malloc/free pairs per second\n", name, counts[i],
+              (double)bench.iterations * counts[i] * freq.QuadPart / (end.QuadPart - start.QuadPart) / 1e6);
+    }
+    free(shared);
+}
+
+static void test_block_cache(const char *argv0)
+{
+    PROCESS_INFORMATION pi;
+    STARTUPINFOA si = { sizeof(si) };
+    char cmdline[MAX_PATH];
+
+    sprintf(cmdline, "\"%s\" heap block_cache", argv0);
+    SetEnvironmentVariableA("WINE_CRT_BLOCK_CACHE", "1");
+    ok(CreateProcessA(NULL, cmdline, NULL, NULL, FALSE, 0, NULL, NULL, &si, &pi),
+       "CreateProcess failed: %u\n", GetLastError());
+    SetEnvironmentVariableA("WINE_CRT_BLOCK_CACHE", NULL);
+    winetest_wait_child_process(pi.hProcess);
+    CloseHandle(pi.hProcess);
+    CloseHandle(pi.hThread);
+}
+
 START_TEST(heap)
 {
+    char **argv;
     void *mem;
 
+    if (winetest_get_mainargs(&argv) >= 3 && !strcmp(argv[2], "block_cache"))
+    {
+        test_small_blocks();
+        test_alloc_throughput("block cache");
+        return;
+    }
+
     mem = malloc(0);
     ok(mem != NULL, "memory not allocated for size 0\n");
     free(mem);
@@ -508,4 +717,7 @@ START_TEST(heap)
     test_aligned();
     test_sbheap();
     test_calloc();
+    test_small_blocks();
+    test_alloc_throughput("heap");
+    test_block_cache(argv[0]);
 }
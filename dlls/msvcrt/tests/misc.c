@@ -47,6 +47,19 @@ static void (__cdecl *p_qsort_s)(void*, size_t, size_t,
 static double (__cdecl *p_atan)(double);
 static double (__cdecl *p_exp)(double);
 static double (__cdecl *p_tanh)(double);
+static double (__cdecl *p_log)(double);
+static double (__cdecl *p_sin)(double);
+static double (__cdecl *p_cos)(double);
+static double (__cdecl *p_floor)(double);
+static double (__cdecl *p_ceil)(double);
+static double (__cdecl *p_fmod)(double, double);
+static float (__cdecl *p_expf)(float);
+static float (__cdecl *p_logf)(float);
+static float (__cdecl *p_sinf)(float);
+static float (__cdecl *p_cosf)(float);
+static float (__cdecl *p_floorf)(float);
+static float (__cdecl *p_ceilf)(float);
+static float (__cdecl *p_fmodf)(float, float);
 static void *(__cdecl *p_lfind_s)(const void*, const void*, unsigned int*,
         size_t, int (__cdecl *)(void*, const void*, const void*), void*);
 
@@ -66,6 +79,19 @@ static void init(void)
     p_atan = (void *)GetProcAddress(hmod, "atan");
     p_exp = (void *)GetProcAddress(hmod, "exp");
     p_tanh = (void *)GetProcAddress(hmod, "tanh");
+    p_log = (void *)GetProcAddress(hmod, "log");
+    p_sin = (void *)GetProcAddress(hmod, "sin");
+    p_cos = (void *)GetProcAddress(hmod, "cos");
+    p_floor = (void *)GetProcAddress(hmod, "floor");
+    p_ceil = (void *)GetProcAddress(hmod, "ceil");
+    p_fmod = (void *)GetProcAddress(hmod, "fmod");
+    p_expf = (void *)GetProcAddress(hmod, "expf");
+    p_logf = (void *)GetProcAddress(hmod, "logf");
+    p_sinf = (void *)GetProcAddress(hmod, "sinf");
+    p_cosf = (void *)GetProcAddress(hmod, "cosf");
+    p_floorf = (void *)GetProcAddress(hmod, "floorf");
+    p_ceilf = (void *)GetProcAddress(hmod, "ceilf");
+    p_fmodf = (void *)GetProcAddress(hmod, "fmodf");
     p_lfind_s = (void *)GetProcAddress(hmod, "_lfind_s");
 }
 
@@ -527,6 +553,185 @@ static void test_math_functions(void)
     ok(errno == 0xdeadbeef, "errno = %d\n", errno);
 }
 
+static BOOL same_double(double d1, double d2)
+{
+    return !memcmp(&d1, &d2, sizeof(d1)) || (_isnan(d1) && _isnan(d2));
+}
+
+static void test_rounding_functions(void)
+{
+    static const struct
+    {
+        double x, floor, ceil;
+    }
+    tests[] =
+    {
+        { 0.0, 0.0, 0.0 },
+        { -0.0, -0.0, -0.0 },
+        { 0.5, 0.0, 1.0 },
+        { -0.5, -1.0, -0.0 },
+        { 1e-300, 0.0, 1.0 },
+        { -1e-300, -1.0, -0.0 },
+        { 2.5, 2.0, 3.0 },
+        { -2.5, -3.0, -2.0 },
+        { 4503599627370495.5, 4503599627370495.0, 4503599627370496.0 },
+        { -4503599627370495.5, -4503599627370496.0, -4503599627370495.0 },
+        { 9007199254740993.0, 9007199254740993.0, 9007199254740993.0 },
+        { 1e300, 1e300, 1e300 },
+        { INFINITY, INFINITY, INFINITY },
+        { -INFINITY, -INFINITY, -INFINITY },
+        { NAN, NAN, NAN },
+    };
+    static const struct
+    {
+        double x, y, ret;
+    }
+    fmod_tests[] =
+    {
+        { 5.5, 2.0, 1.5 },
+        { -5.5, 2.0, -1.5 },
+        { 5.5, -2.0, 1.5 },
+        { 1.0, 1.0, 0.0 },
+        { -1.0, 1.0, -0.0 },
+        { 0.5, 1.0, 0.5 },
+        { 1e300, 3.0, 0.0 },
+        { -1e300, 7.0, -1.0 },
+        { 1.7976931348623157e308, 1.1, 0x1.d38383151ed58p-2 },
+        { 123456789.0, 0.1, 0x1.999997c2a6546p-4 },
+        { 0x1.cp-1072, 0x1.8p-1073, 0x1p-1074 },
+    };
+    double d;
+    float f;
+    int i;
+
+    for (i = 0; i < ARRAY_SIZE(tests); i++)
+    {
+        d = p_floor(tests[i].x);
+        ok(same_double(d, tests[i].floor), "%d: floor(%.17g) = %.17g\n", i, tests[i].x, d);
+        d = p_ceil(tests[i].x);
+        ok(same_double(d, tests[i].ceil), "%d: ceil(%.17g) = %.17g\n", i, tests[i].x, d);
+
+        if (!p_floorf || (float)tests[i].x != tests[i].x) continue;
+        f = p_floorf(tests[i].x);
+        ok(same_double(f, (float)tests[i].floor), "%d: floorf(%.9g) = %.9g\n", i, tests[i].x, f);
+        f = p_ceilf(tests[i].x);
+        ok(same_double(f, (float)tests[i].ceil), "%d: ceilf(%.9g) = %.9g\n", i, tests[i].x, f);
+    }
+
+    for (i = 0; i < ARRAY_SIZE(fmod_tests); i++)
+    {
+        d = p_fmod(fmod_tests[i].x, fmod_tests[i].y);
+        ok(same_double(d, fmod_tests[i].ret), "%d: fmod(%.17g, %.17g) = %.17g\n",
+                i, fmod_tests[i].x, fmod_tests[i].y, d);
+    }
+
+    if (!p_fmodf)
+    {
+        win_skip("fmodf not available\n");
+        return;
+    }
+    f = p_fmodf(3.4e38f, 1.1f);
+    ok(same_double(f, 0x1.b98cc0p-4f), "fmodf returned %.9g\n", f);
+    f = p_fmodf(-7e-45f, 3e-45f);
+    ok(same_double(f, -0x1p-149f), "fmodf returned %.9g\n", f);
+}
+
+/* error of a float result in units of the last place, against a double precision reference */
+static double float_ulps(float ret, double expect)
+{
+    int exp;
+
+    frexp(expect, &exp);
+    if (exp < -125) exp = -125;
+    return fabs(ret - expect) / ldexp(1.0, exp - 24);
+}
+
+static void test_float_functions(void)
+{
+    double err, max_err[4] = { 0 };
+    unsigned int i, seed = 1;
+    float x;
+
+    if (!p_expf)
+    {
+        win_skip("float math functions not available\n");
+        return;
+    }
+
+    for (i = 0; i < 100000; i++)
+    {
+        seed = seed * 1103515245 + 12345;
+        x = (seed >> 8) / (double)(1 << 24) * 176.0 - 88.0;
+
+        err = float_ulps(p_expf(x), p_exp(x));
+        if (err > max_err[0]) max_err[0] = err;
+        err = float_ulps(p_sinf(x), p_sin(x));
+        if (err > max_err[1]) max_err[1] = err;
+        err = float_ulps(p_cosf(x), p_cos(x));
+        if (err > max_err[2]) max_err[2] = err;
+        x = fabs(x) * 1e3;
+        err = float_ulps(p_logf(x), p_log(x));
+        if (err > max_err[3]) max_err[3] = err;
+    }
+    ok(max_err[0] < 1.0, "expf error %.3f ulp\n", max_err[0]);
+    ok(max_err[1] < 1.0, "sinf error %.3f ulp\n", max_err[1]);
+    ok(max_err[2] < 1.0, "cosf error %.3f ulp\n", max_err[2]);
+    ok(max_err[3] < 1.0, "logf error %.3f ulp\n", max_err[3]);
+
+    ok(p_expf(0.0f) == 1.0f, "expf(0) = %.9g\n", p_expf(0.0f));
+    ok(p_expf(88.7f) == 0x1.f46ff8p+127f, "expf(88.7) = %.9g\n", p_expf(88.7f));
+    errno = 0xdeadbeef;
+    ok(p_expf(89.0f) == INFINITY, "expf(89) = %.9g\n", p_expf(89.0f));
+    ok(errno == ERANGE, "errno = %d\n", errno);
+    ok(p_expf(-103.0f) == 0x1p-149f, "expf(-103) = %.9g\n", p_expf(-103.0f));
+    ok(p_logf(1.0f) == 0.0f, "logf(1) = %.9g\n", p_logf(1.0f));
+    ok(p_logf(0x1p-149f) == -0x1.9d1da0p+6f, "logf(min) = %.9g\n", p_logf(0x1p-149f));
+    errno = 0xdeadbeef;
+    ok(p_logf(0.0f) == -INFINITY, "logf(0) = %.9g\n", p_logf(0.0f));
+    ok(errno == ERANGE, "errno = %d\n", errno);
+    ok(p_sinf(1e-30f) == 1e-30f, "sinf(1e-30) = %.9g\n", p_sinf(1e-30f));
+    ok(p_cosf(0.0f) == 1.0f, "cosf(0) = %.9g\n", p_cosf(0.0f));
+    errno = 0xdeadbeef;
+    p_sinf(INFINITY);
+    ok(errno == EDOM, "errno = %d\n", errno);
+}
+
+static void test_math_throughput(void)
+{
+    LARGE_INTEGER freq, start, end;
+    unsigned int i, count = 10000000;
+    volatile double d = 0;
+    volatile float f = 0;
+
+    if (!winetest_interactive)
+    {
+        skip("math function benchmarks are only run in interactive mode\n");
+        return;
+    }
+
+    QueryPerformanceFrequency(&freq);
+
+#define BENCH(expr, var) \
+    QueryPerformanceCounter(&start); \
+    for (i = 0; i < count; i++) var += expr; \
+    QueryPerformanceCounter(&end); \
+    trace(#expr ": %.1f ns per call\n", (double)(end.QuadPart - start.QuadPart) * 1e9 / freq.QuadPart / count);
+
+    BENCH(p_floor(i * 0.37), d)
+    BENCH(p_ceil(i * 0.37), d)
+    BENCH(p_fmod(i * 0.37, 3.3), d)
+    if (p_expf)
+    {
+        BENCH(p_floorf(i * 0.37f), f)
+        BENCH(p_fmodf(i * 0.37f, 3.3f), f)
+        BENCH(p_expf(i * 1e-5f), f)
+        BENCH(p_logf(i + 1.0f), f)
+        BENCH(p_sinf(i * 1e-5f), f)
+        BENCH(p_cosf(i * 1e-5f), f)
+    }
+#undef BENCH
+}
+
 static void __cdecl test_thread_func(void *end_thread_type)
 {
     if (end_thread_type == (void*)1)
@@ -683,6 +888,9 @@ START_TEST(misc)
     test__invalid_parameter();
     test_qsort_s();
     test_math_functions();
+    test_rounding_functions();
+    test_float_functions();
+    test_math_throughput();
     test_thread_handle_close();
     test__lfind_s();
 }
@@ -58,6 +58,11 @@ static void* (__cdecl *pmemcpy)(void *, const void *, size_t n);
 static int (__cdecl *p_memcpy_s)(void *, size_t, const void *, size_t);
 static int (__cdecl *p_memmove_s)(void *, size_t, const void *, size_t);
 static int* (__cdecl *pmemcmp)(void *, const void *, size_t n);
+static void* (__cdecl *p_memmove)(void *, const void *, size_t);
+static void* (__cdecl *p_memset)(void *, int, size_t);
+static void* (__cdecl *p_memchr)(const void *, int, size_t);
+static size_t (__cdecl *p_strlen)(const char *);
+static size_t (__cdecl *p_wcslen)(const wchar_t *);
 static int (__cdecl *p_strcmp)(const char *, const char *);
 static int (__cdecl *p_strncmp)(const char *, const char *, size_t);
 static int (__cdecl *p_strcpy)(char *dst, const char *src);
@@ -4441,6 +4446,267 @@ static void test__mbbtype(void)
     }
 }
 
+static void test_mem_functions(void)
+{
+    static unsigned char src[512];
+    unsigned char *buf, *ref, *big;
+    unsigned int size, dst_align, src_align, i;
+    const void *ptr;
+    int ret;
+
+    buf = malloc(1024);
+    ref = malloc(1024);
+    for (i = 0; i < sizeof(src); i++) src[i] = i * 7 + 3;
+
+    for (size = 0; size <= 300; size++)
+    {
+        for (dst_align = 0; dst_align < 16; dst_align++)
+        {
+            for (src_align = 0; src_align < 16; src_align++)
+            {
+                memset(buf, 0xcc, 1024);
+                ptr = p_memmove(buf + dst_align, src + src_align, size);
+                ok(ptr == buf + dst_align, "got %p, expected %p\n", ptr, buf + dst_align);
+                for (i = 0; i < 1024; i++)
+                {
+                    unsigned char expect = i >= dst_align && i < dst_align + size ?
+                            src[i - dst_align + src_align] : 0xcc;
+                    if (buf[i] != expect) break;
+                }
+                ok(i == 1024, "size %u, align %u/%u: wrong byte %u\n", size, dst_align, src_align, i);
+
+                /* overlapping in both directions */
+                memcpy(buf, src, sizeof(src));
+                memcpy(ref, src, sizeof(src));
+                p_memmove(buf + 64 + dst_align, buf + 64 + src_align + 16, size);
+                for (i = 0; i < size; i++) ref[64 + dst_align + i] = src[64 + src_align + 16 + i];
+                ok(!memcmp(buf, ref, sizeof(src)), "size %u, align %u/%u: overlapping copy to lower address failed\n",
+                   size, dst_align, src_align);
+                memcpy(buf, src, sizeof(src));
+                memcpy(ref, src, sizeof(src));
+                p_memmove(buf + 64 + dst_align + 16, buf + 64 + src_align, size);
+                for (i = size; i > 0; i--) ref[64 + dst_align + 16 + i - 1] = src[64 + src_align + i - 1];
+                ok(!memcmp(buf, ref, sizeof(src)), "size %u, align %u/%u: overlapping copy to higher address failed\n",
+                   size, dst_align, src_align);
+            }
+
+            memset(buf, 0xcc, 1024);
+            ptr = p_memset(buf + dst_align, 0x5a, size);
+            ok(ptr == buf + dst_align, "got %p, expected %p\n", ptr, buf + dst_align);
+            for (i = 0; i < 1024; i++)
+                if (buf[i] != (i >= dst_align && i < dst_align + size ? 0x5a : 0xcc)) break;
+            ok(i == 1024, "size %u, align %u: memset wrong byte %u\n", size, dst_align, i);
+
+            memcpy(buf + dst_align, src, size);
+            ret = (int)(INT_PTR)pmemcmp(buf + dst_align, src, size);
+            ok(!ret, "size %u, align %u: memcmp returned %d\n", size, dst_align, ret);
+            for (i = 0; i < size; i += 13)
+            {
+                buf[dst_align + i] = src[i] + 1;
+                ret = (int)(INT_PTR)pmemcmp(buf + dst_align, src, size);
+                ok(ret == 1, "size %u, align %u, diff at %u: memcmp returned %d\n", size, dst_align, i, ret);
+                buf[dst_align + i] = src[i] - 1;
+                ret = (int)(INT_PTR)pmemcmp(buf + dst_align, src, size);
+                ok(ret == -1, "size %u, align %u, diff at %u: memcmp returned %d\n", size, dst_align, i, ret);
+                buf[dst_align + i] = src[i];
+            }
+
+            memset(buf, 'a', 1024);
+            buf[dst_align + size] = 'b';
+            ptr = p_memchr(buf + dst_align, 'b', size);
+            ok(!ptr, "size %u, align %u: memchr returned %p\n", size, dst_align, ptr);
+            ptr = p_memchr(buf + dst_align, 'b', size + 1);
+            ok(ptr == buf + dst_align + size, "size %u, align %u: memchr returned %p\n", size, dst_align, ptr);
+            buf[dst_align + size] = 0;
+            ret = p_strlen((char *)buf + dst_align);
+            ok(ret == size, "size %u, align %u: strlen returned %d\n", size, dst_align, ret);
+
+            if (dst_align % sizeof(wchar_t)) continue;
+            for (i = 0; i < 512; i++) ((wchar_t *)buf)[i] = 0x100 + i;
+            ((wchar_t *)buf)[dst_align / sizeof(wchar_t) + size] = 0;
+            ret = p_wcslen((wchar_t *)buf + dst_align / sizeof(wchar_t));
+            ok(ret == size, "size %u, align %u: wcslen returned %d\n", size, dst_align, ret);
+        }
+    }
+
+    /* large copies take a different path */
+    size = 8 * 1024 * 1024 + 5;
+    big = malloc(2 * size + 64);
+    for (i = 0; i < size; i++) big[i + 3] = i % 251;
+    p_memmove(big + size + 40, big + 3, size);
+    for (i = 0; i < size; i++) if (big[size + 40 + i] != i % 251) break;
+    ok(i == size, "large copy: wrong byte %u\n", i);
+    p_memmove(big + 9, big + 3, size);
+    for (i = 0; i < size; i++) if (big[9 + i] != i % 251) break;
+    ok(i == size, "large overlapping copy: wrong byte %u\n", i);
+    p_memset(big + 1, 0x11, size);
+    for (i = 0; i < size; i++) if (big[1 + i] != 0x11) break;
+    ok(i == size, "large memset: wrong byte %u\n", i);
+    free(big);
+
+    free(buf);
+    free(ref);
+}
+
+static void test_mem_functions_throughput(void)
+{
+    static const unsigned int sizes[] = { 8, 31, 64, 100, 256, 1000, 4096, 65536, 1024 * 1024, 16 * 1024 * 1024 };
+    LARGE_INTEGER freq, start, end;
+    unsigned char *dst, *src;
+    unsigned int i, j, align, count;
+    double secs;
+
+    if (!winetest_interactive)
+    {
+        skip("memory function benchmarks are only run in interactive mode\n");
+        return;
+    }
+
+    src = malloc(sizes[ARRAY_SIZE(sizes) - 1] + 64);
+    dst = malloc(sizes[ARRAY_SIZE(sizes) - 1] + 64);
+    memset(src, 'x', sizes[ARRAY_SIZE(sizes) - 1] + 64);
+    QueryPerformanceFrequency(&freq);
+
+    for (i = 0; i < ARRAY_SIZE(sizes); i++)
+    {
+        count = max(1, (256 * 1024 * 1024) / sizes[i]);
+        for (align = 0; align < 16; align += 5)
+        {
+            QueryPerformanceCounter(&start);
+            for (j = 0; j < count; j++) p_memmove(dst + align, src + 1, sizes[i]);
+            QueryPerformanceCounter(&end);
+            secs = (double)(end.QuadPart - start.QuadPart) / freq.QuadPart;
+            trace("memcpy  %8u bytes, dst align %2u: %8.1f MB/s\n", sizes[i], align,
+                  (double)sizes[i] * count / secs / (1024 * 1024));
+
+            QueryPerformanceCounter(&start);
+            for (j = 0; j < count; j++) p_memset(dst + align, j, sizes[i]);
+            QueryPerformanceCounter(&end);
+            secs = (double)(end.QuadPart - start.QuadPart) / freq.QuadPart;
+            trace("memset  %8u bytes, dst align %2u: %8.1f MB/s\n", sizes[i], align,
+                  (double)sizes[i] * count / secs / (1024 * 1024));
+
+            memset(dst + align, 'x', sizes[i]);
+            QueryPerformanceCounter(&start);
+            for (j = 0; j < count; j++) pmemcmp(dst + align, src + 1, sizes[i]);
+            QueryPerformanceCounter(&end);
+            secs = (double)(end.QuadPart - start.QuadPart) / freq.QuadPart;
+            trace("memcmp  %8u bytes, dst align %2u: %8.1f MB/s\n", sizes[i], align,
+                  (double)sizes[i] * count / secs / (1024 * 1024));
+
+            dst[align + sizes[i] - 1] = 0;
+            QueryPerformanceCounter(&start);
+            for (j = 0; j < count; j++) p_strlen((char *)dst + align);
+            QueryPerformanceCounter(&end);
+            secs = (double)(end.QuadPart - start.QuadPart) / freq.QuadPart;
+            trace("strlen  %8u bytes, dst align %2u: %8.1f MB/s\n", sizes[i], align,
+                  (double)sizes[i] * count / secs / (1024 * 1024));
+
+            QueryPerformanceCounter(&start);
+            for (j = 0; j < count; j++) p_memchr(dst + align, 'y', sizes[i]);
+            QueryPerformanceCounter(&end);
+            secs = (double)(end.QuadPart - start.QuadPart) / freq.QuadPart;
+            trace("memchr  %8u bytes, dst align %2u: %8.1f MB/s\n", sizes[i], align,
+                  (double)sizes[i] * count / secs / (1024 * 1024));
+        }
+    }
+
+    free(src);
+    free(dst);
+}
+
+static double fp_random(unsigned int *seed)
+{
+    ULONGLONG bits;
+    double d;
+
+    do
+    {
+        bits = (ULONGLONG)(*seed = *seed * 1103515245 + 12345) << 32;
+        bits |= *seed = *seed * 1103515245 + 12345;
+        memcpy(&d, &bits, sizeof(d));
+    } while (!_finite(d));
+    return d;
+}
+
+static void test_fp_roundtrip(void)
+{
+    static const struct {
+        const char *str;
+        ULONGLONG bits;
+    } tests[] = {
+        { "9007199254740993", 0x4340000000000000 },
+        { "9007199254740995", 0x4340000000000002 },
+        { "0.1", 0x3fb999999999999a },
+        { "123.456", 0x405edd2f1a9fbe77 },
+        { "1.7976931348623157e308", 0x7fefffffffffffff },
+        { "2.2250738585072011e-308", 0x000fffffffffffff },
+        { "2.2250738585072014e-308", 0x0010000000000000 },
+        { "4.9406564584124654e-324", 0x0000000000000001 },
+        { "7.2057594037927933e16", 0x4370000000000000 },
+        { "1.00000000000000011102230246251565404236316680908203125", 0x3ff0000000000000 },
+        { "1.00000000000000011102230246251565404236316680908203126", 0x3ff0000000000001 },
+    };
+    char buf[64];
+    unsigned int i, seed = 1;
+    ULONGLONG bits;
+    double d;
+
+    for (i = 0; i < ARRAY_SIZE(tests); i++)
+    {
+        d = strtod(tests[i].str, NULL);
+        memcpy(&bits, &d, sizeof(bits));
+        ok(bits == tests[i].bits, "%s: got %s\n", tests[i].str, wine_dbgstr_longlong(bits));
+    }
+
+    for (i = 0; i < 100000; i++)
+    {
+        double v = fp_random(&seed);
+
+        sprintf(buf, "%.17g", v);
+        d = strtod(buf, NULL);
+        if (memcmp(&d, &v, sizeof(d))) break;
+        sprintf(buf, "%.16e", v);
+        d = strtod(buf, NULL);
+        if (memcmp(&d, &v, sizeof(d))) break;
+    }
+    ok(i == 100000, "%s didn't round trip\n", buf);
+}
+
+static void test_fp_throughput(void)
+{
+    static const double values[] = { 123.456, 0.5, 3.14159265358979, 1234567.0, -42.125,
+        6.02214076e23, 1e-5, 98765.4321 };
+    LARGE_INTEGER freq, start, end;
+    unsigned int i, count = 2000000;
+    char buf[64];
+    double sum = 0;
+
+    if (!winetest_interactive)
+    {
+        skip("floating point conversion benchmarks are only run in interactive mode\n");
+        return;
+    }
+
+    QueryPerformanceFrequency(&freq);
+
+    QueryPerformanceCounter(&start);
+    for (i = 0; i < count; i++) sprintf(buf, "%f", values[i % ARRAY_SIZE(values)]);
+    QueryPerformanceCounter(&end);
+    trace("sprintf %%f: %.1f ns per call\n", (double)(end.QuadPart - start.QuadPart) * 1e9 / freq.QuadPart / count);
+
+    QueryPerformanceCounter(&start);
+    for (i = 0; i < count; i++) sprintf(buf, "%.17g", values[i % ARRAY_SIZE(values)]);
+    QueryPerformanceCounter(&end);
+    trace("sprintf %%.17g: %.1f ns per call\n", (double)(end.QuadPart - start.QuadPart) * 1e9 / freq.QuadPart / count);
+
+    QueryPerformanceCounter(&start);
+    for (i = 0; i < count; i++) sum += strtod("98765.4321", NULL);
+    QueryPerformanceCounter(&end);
+    trace("strtod: %.1f ns per call\n", (double)(end.QuadPart - start.QuadPart) * 1e9 / freq.QuadPart / count);
+    ok(sum > 0, "sum = %f\n", sum);
+}
+
 START_TEST(string)
 {
     char mem[100];
@@ -4455,6 +4721,11 @@ START_TEST(string)
     p_memcpy_s = (void*)GetProcAddress( hMsvcrt, "memcpy_s" );
     p_memmove_s = (void*)GetProcAddress( hMsvcrt, "memmove_s" );
     SET(pmemcmp,"memcmp");
+    SET(p_memmove, "memmove");
+    SET(p_memset, "memset");
+    SET(p_memchr, "memchr");
+    SET(p_strlen, "strlen");
+    SET(p_wcslen, "wcslen");
     SET(p_mbctype,"_mbctype");
     SET(p__mb_cur_max,"__mb_cur_max");
     SET(p_strcpy, "strcpy");
@@ -4596,4 +4867,8 @@ START_TEST(string)
     test___STRINGTOLD();
     test_SpecialCasing();
     test__mbbtype();
+    test_mem_functions();
+    test_mem_functions_throughput();
+    test_fp_roundtrip();
+    test_fp_throughput();
 }
@@ -2827,16 +2827,6 @@ wchar_t* CDECL wcsrchr(const wchar_t *str, wchar_t ch)
     return ret;
 }
 
-/***********************************************************************
- *              wcslen (MSVCRT.@)
- */
-size_t CDECL wcslen(const wchar_t *str)
-{
-    const wchar_t *s = str;
-    while (*s) s++;
-    return s - str;
-}
-
 /*********************************************************************
  *              wcsstr (MSVCRT.@)
  */
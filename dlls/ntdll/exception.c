@@ -34,6 +34,7 @@
 #include "wine/exception.h"
 #include "wine/server.h"
 #include "wine/list.h"
+#include "wine/rbtree.h"
 #include "wine/debug.h"
 #include "excpt.h"
 #include "ntdll_misc.h"
@@ -248,7 +249,9 @@ LONG WINAPI call_unhandled_exception_filter( PEXCEPTION_POINTERS eptr )
 
 struct dynamic_unwind_entry
 {
-    struct list       entry;
+    struct wine_rb_entry entry_entry;  /* entry in dynamic_unwind_entries, by address */
+    struct wine_rb_entry table_entry;  /* entry in dynamic_unwind_tables, by table */
+    unsigned int      seq;             /* registration order */
     ULONG_PTR         base;
     ULONG_PTR         end;
     RUNTIME_FUNCTION *table;
@@ -256,9 +259,60 @@ struct dynamic_unwind_entry
     DWORD             max_count;
     PGET_RUNTIME_FUNCTION_CALLBACK callback;
     PVOID             context;
+    LONG              refs;            /* number of callbacks in progress */
+    LONG              waiting;         /* set while the entry is being deleted */
 };
 
-static struct list dynamic_unwind_list = LIST_INIT(dynamic_unwind_list);
+/* dynamic function tables, sorted by base address */
+struct dynamic_unwind_index
+{
+    ULONG_PTR                    base;
+    ULONG_PTR                    end;
+    ULONG_PTR                    max_end;  /* highest end address of this and all previous entries */
+    unsigned int                 seq;
+    struct dynamic_unwind_entry *entry;
+};
+
+/* Lookups don't take a lock. The index is kept in two copies, and readers register on the
+ * one selected by dynamic_unwind_generation. Writers update the other copy once its readers
+ * are gone, switch the generation, and then do the same for the copy that was in use. */
+struct dynamic_unwind_copy
+{
+    struct dynamic_unwind_index *index;
+    unsigned int                 count;
+    unsigned int                 size;
+    LONG                         readers;
+    LONG                         waiting;  /* set while a writer waits for the readers */
+};
+
+static struct dynamic_unwind_copy dynamic_unwind_copies[2];
+static LONG dynamic_unwind_generation;
+static unsigned int dynamic_unwind_seq;
+
+static int compare_dynamic_unwind_entry( const void *key, const struct wine_rb_entry *entry )
+{
+    const struct dynamic_unwind_entry *e = WINE_RB_ENTRY_VALUE( entry, struct dynamic_unwind_entry, entry_entry );
+
+    if ((ULONG_PTR)key < (ULONG_PTR)e) return -1;
+    if ((ULONG_PTR)key > (ULONG_PTR)e) return 1;
+    return 0;
+}
+
+static int compare_dynamic_unwind_table( const void *key, const struct wine_rb_entry *entry )
+{
+    const struct dynamic_unwind_entry *k = key;
+    const struct dynamic_unwind_entry *e = WINE_RB_ENTRY_VALUE( entry, struct dynamic_unwind_entry, table_entry );
+
+    if ((ULONG_PTR)k->table < (ULONG_PTR)e->table) return -1;
+    if ((ULONG_PTR)k->table > (ULONG_PTR)e->table) return 1;
+    if (k->seq < e->seq) return -1;
+    if (k->seq > e->seq) return 1;
+    return 0;
+}
+
+/* the trees are only used by writers, with dynamic_unwind_section held */
+static struct wine_rb_tree dynamic_unwind_entries = { compare_dynamic_unwind_entry };
+static struct wine_rb_tree dynamic_unwind_tables = { compare_dynamic_unwind_table };
 
 static RTL_CRITICAL_SECTION dynamic_unwind_section;
 static RTL_CRITICAL_SECTION_DEBUG dynamic_unwind_debug =
@@ -269,6 +323,208 @@ static RTL_CRITICAL_SECTION_DEBUG dynamic_unwind_debug =
 };
 static RTL_CRITICAL_SECTION dynamic_unwind_section = { &dynamic_unwind_debug, -1, 0, 0, 0, 0 };
 
+/* find the first index entry with a base address above addr */
+static unsigned int find_dynamic_unwind_pos( const struct dynamic_unwind_copy *copy, ULONG_PTR addr )
+{
+    unsigned int min = 0, max = copy->count;
+
+    while (min < max)
+    {
+        unsigned int pos = (min + max) / 2;
+        if (addr < copy->index[pos].base) max = pos;
+        else min = pos + 1;
+    }
+    return min;
+}
+
+static void update_dynamic_unwind_max_end( struct dynamic_unwind_copy *copy, unsigned int pos )
+{
+    ULONG_PTR max_end = pos ? copy->index[pos - 1].max_end : 0;
+
+    for ( ; pos < copy->count; pos++)
+    {
+        max_end = max( max_end, copy->index[pos].end );
+        copy->index[pos].max_end = max_end;
+    }
+}
+
+/* wait until a reference count drops to zero; only one thread may wait on a given count */
+static void wait_dynamic_unwind_refs( LONG *refs, LONG *waiting )
+{
+    LONG value;
+
+    InterlockedExchange( waiting, 1 );
+    while ((value = InterlockedCompareExchange( refs, 0, 0 )))
+        RtlWaitOnAddress( refs, &value, sizeof(value), NULL );
+    InterlockedExchange( waiting, 0 );
+}
+
+static void release_dynamic_unwind_ref( LONG *refs, LONG *waiting )
+{
+    if (!InterlockedDecrement( refs ) && *(volatile LONG *)waiting) RtlWakeAddressAll( refs );
+}
+
+static void wait_dynamic_unwind_readers( struct dynamic_unwind_copy *copy )
+{
+    wait_dynamic_unwind_refs( &copy->readers, &copy->waiting );
+}
+
+/* insert an entry in a copy of the index that has no readers */
+static void insert_dynamic_unwind_index( struct dynamic_unwind_copy *copy, struct dynamic_unwind_entry *entry,
+                                         struct dynamic_unwind_index *new_index )
+{
+    unsigned int pos;
+
+    if (new_index)
+    {
+        if (copy->count) memcpy( new_index, copy->index, copy->count * sizeof(*new_index) );
+        RtlFreeHeap( GetProcessHeap(), 0, copy->index );
+        copy->index = new_index;
+        copy->size = max( 64, copy->size * 2 );
+    }
+
+    pos = find_dynamic_unwind_pos( copy, entry->base );
+    memmove( &copy->index[pos + 1], &copy->index[pos], (copy->count - pos) * sizeof(*copy->index) );
+    copy->index[pos].base  = entry->base;
+    copy->index[pos].end   = entry->end;
+    copy->index[pos].seq   = entry->seq;
+    copy->index[pos].entry = entry;
+    copy->count++;
+    update_dynamic_unwind_max_end( copy, pos );
+}
+
+/* remove an entry from a copy of the index that has no readers */
+static void remove_dynamic_unwind_index( struct dynamic_unwind_copy *copy, struct dynamic_unwind_entry *entry )
+{
+    unsigned int pos = find_dynamic_unwind_pos( copy, entry->base );
+
+    while (copy->index[--pos].entry != entry) ;
+    copy->count--;
+    memmove( &copy->index[pos], &copy->index[pos + 1], (copy->count - pos) * sizeof(*copy->index) );
+    update_dynamic_unwind_max_end( copy, pos );
+}
+
+/* add an entry to the index; must be called with dynamic_unwind_section held */
+static BOOL add_dynamic_unwind_entry( struct dynamic_unwind_entry *entry )
+{
+    struct dynamic_unwind_index *new_index[2] = { NULL, NULL };
+    struct dynamic_unwind_copy *copy;
+    LONG generation = dynamic_unwind_generation;
+    unsigned int i;
+
+    /* allocate everything first, so that both copies can be updated */
+    for (i = 0; i < 2; i++)
+    {
+        copy = &dynamic_unwind_copies[i];
+        if (copy->count < copy->size) continue;
+        if (!(new_index[i] = RtlAllocateHeap( GetProcessHeap(), 0,
+                                              max( 64, copy->size * 2 ) * sizeof(*new_index[i]) )))
+        {
+            RtlFreeHeap( GetProcessHeap(), 0, new_index[0] );
+            return FALSE;
+        }
+    }
+
+    entry->seq = dynamic_unwind_seq++;
+    wine_rb_put( &dynamic_unwind_entries, entry, &entry->entry_entry );
+    wine_rb_put( &dynamic_unwind_tables, entry, &entry->table_entry );
+
+    copy = &dynamic_unwind_copies[(generation + 1) & 1];
+    wait_dynamic_unwind_readers( copy );
+    insert_dynamic_unwind_index( copy, entry, new_index[(generation + 1) & 1] );
+    InterlockedIncrement( &dynamic_unwind_generation );
+
+    copy = &dynamic_unwind_copies[generation & 1];
+    wait_dynamic_unwind_readers( copy );
+    insert_dynamic_unwind_index( copy, entry, new_index[generation & 1] );
+    return TRUE;
+}
+
+/* remove an entry from the index; must be called with dynamic_unwind_section held.
+ * Once this returns, no reader can find the entry any more, but callbacks that were
+ * already started may still be running; see wait_dynamic_unwind_callbacks(). */
+static void remove_dynamic_unwind_entry( struct dynamic_unwind_entry *entry )
+{
+    struct dynamic_unwind_copy *copy;
+    LONG generation = dynamic_unwind_generation;
+
+    wine_rb_remove( &dynamic_unwind_entries, &entry->entry_entry );
+    wine_rb_remove( &dynamic_unwind_tables, &entry->table_entry );
+
+    copy = &dynamic_unwind_copies[(generation + 1) & 1];
+    wait_dynamic_unwind_readers( copy );
+    remove_dynamic_unwind_index( copy, entry );
+    InterlockedIncrement( &dynamic_unwind_generation );
+
+    copy = &dynamic_unwind_copies[generation & 1];
+    wait_dynamic_unwind_readers( copy );
+    remove_dynamic_unwind_index( copy, entry );
+}
+
+/* wait for the callbacks of a removed entry to return, so that the entry can be freed and the
+ * module implementing the callback unloaded. This is called without dynamic_unwind_section held,
+ * since callbacks may add or remove other tables; a callback must not delete its own table. */
+static void wait_dynamic_unwind_callbacks( struct dynamic_unwind_entry *entry )
+{
+    wait_dynamic_unwind_refs( &entry->refs, &entry->waiting );
+}
+
+/* find the entry registered first for a table; must be called with dynamic_unwind_section held */
+static struct dynamic_unwind_entry *find_dynamic_unwind_table( RUNTIME_FUNCTION *table )
+{
+    struct wine_rb_entry *ptr = dynamic_unwind_tables.root;
+    struct dynamic_unwind_entry *entry, *found = NULL;
+
+    while (ptr)
+    {
+        entry = WINE_RB_ENTRY_VALUE( ptr, struct dynamic_unwind_entry, table_entry );
+        if ((ULONG_PTR)table < (ULONG_PTR)entry->table) ptr = ptr->left;
+        else if ((ULONG_PTR)table > (ULONG_PTR)entry->table) ptr = ptr->right;
+        else
+        {
+            found = entry;
+            ptr = ptr->left;
+        }
+    }
+    return found;
+}
+
+/* start a lookup, returning the copy of the index that can be used until it's released */
+static struct dynamic_unwind_copy *enter_dynamic_unwind_index(void)
+{
+    struct dynamic_unwind_copy *copy;
+    LONG generation;
+
+    for (;;)
+    {
+        generation = InterlockedCompareExchange( &dynamic_unwind_generation, 0, 0 );
+        copy = &dynamic_unwind_copies[generation & 1];
+        InterlockedIncrement( &copy->readers );
+        if (InterlockedCompareExchange( &dynamic_unwind_generation, 0, 0 ) == generation) return copy;
+        release_dynamic_unwind_ref( &copy->readers, &copy->waiting );
+    }
+}
+
+static void leave_dynamic_unwind_index( struct dynamic_unwind_copy *copy )
+{
+    release_dynamic_unwind_ref( &copy->readers, &copy->waiting );
+}
+
+/* find the entry covering pc */
+static struct dynamic_unwind_entry *lookup_dynamic_unwind_entry( const struct dynamic_unwind_copy *copy,
+                                                                 ULONG_PTR pc )
+{
+    const struct dynamic_unwind_index *found = NULL;
+    unsigned int pos = find_dynamic_unwind_pos( copy, pc );
+
+    /* walk back through the entries starting below pc while some of them may still cover it;
+     * if tables overlap, the one registered first wins */
+    while (pos-- && copy->index[pos].max_end > pc)
+        if (pc < copy->index[pos].end && (!found || copy->index[pos].seq < found->seq))
+            found = &copy->index[pos];
+    return found ? found->entry : NULL;
+}
+
 static ULONG_PTR get_runtime_function_end( RUNTIME_FUNCTION *func, ULONG_PTR addr )
 {
 #ifdef __x86_64__
@@ -313,6 +569,7 @@ static ULONG_PTR get_runtime_function_end( RUNTIME_FUNCTION *func, ULONG_PTR add
 BOOLEAN CDECL RtlAddFunctionTable( RUNTIME_FUNCTION *table, DWORD count, ULONG_PTR addr )
 {
     struct dynamic_unwind_entry *entry;
+    BOOL ret;
 
     TRACE( "%p %u %lx\n", table, count, addr );
 
@@ -329,11 +586,15 @@ BOOLEAN CDECL RtlAddFunctionTable( RUNTIME_FUNCTION *table, DWORD count, ULONG_P
     entry->max_count = 0;
     entry->callback  = NULL;
     entry->context   = NULL;
+    entry->refs      = 0;
+    entry->waiting   = 0;
 
     RtlEnterCriticalSection( &dynamic_unwind_section );
-    list_add_tail( &dynamic_unwind_list, &entry->entry );
+    ret = add_dynamic_unwind_entry( entry );
     RtlLeaveCriticalSection( &dynamic_unwind_section );
-    return TRUE;
+
+    if (!ret) RtlFreeHeap( GetProcessHeap(), 0, entry );
+    return ret;
 }
 
 
@@ -345,6 +606,7 @@ BOOLEAN CDECL RtlInstallFunctionTableCallback( ULONG_PTR table, ULONG_PTR base,
                                                PCWSTR dll )
 {
     struct dynamic_unwind_entry *entry;
+    BOOL ret;
 
     TRACE( "%lx %lx %d %p %p %s\n", table, base, length, callback, context, wine_dbgstr_w(dll) );
 
@@ -365,12 +627,15 @@ BOOLEAN CDECL RtlInstallFunctionTableCallback( ULONG_PTR table, ULONG_PTR base,
     entry->max_count = 0;
     entry->callback  = callback;
     entry->context   = context;
+    entry->refs      = 0;
+    entry->waiting   = 0;
 
     RtlEnterCriticalSection( &dynamic_unwind_section );
-    list_add_tail( &dynamic_unwind_list, &entry->entry );
+    ret = add_dynamic_unwind_entry( entry );
     RtlLeaveCriticalSection( &dynamic_unwind_section );
 
-    return TRUE;
+    if (!ret) RtlFreeHeap( GetProcessHeap(), 0, entry );
+    return ret;
 }
 
 
@@ -381,6 +646,7 @@ DWORD WINAPI RtlAddGrowableFunctionTable( void **table, RUNTIME_FUNCTION *functi
                                           DWORD max_count, ULONG_PTR base, ULONG_PTR end )
 {
     struct dynamic_unwind_entry *entry;
+    BOOL ret;
 
     TRACE( "%p, %p, %u, %u, %lx, %lx\n", table, functions, count, max_count, base, end );
 
@@ -395,11 +661,19 @@ DWORD WINAPI RtlAddGrowableFunctionTable( void **table, RUNTIME_FUNCTION *functi
     entry->max_count = max_count;
     entry->callback  = NULL;
     entry->context   = NULL;
+    entry->refs      = 0;
+    entry->waiting   = 0;
 
     RtlEnterCriticalSection( &dynamic_unwind_section );
-    list_add_tail( &dynamic_unwind_list, &entry->entry );
+    ret = add_dynamic_unwind_entry( entry );
     RtlLeaveCriticalSection( &dynamic_unwind_section );
 
+    if (!ret)
+    {
+        RtlFreeHeap( GetProcessHeap(), 0, entry );
+        return STATUS_NO_MEMORY;
+    }
+
     *table = entry;
 
     return STATUS_SUCCESS;
@@ -411,19 +685,15 @@ DWORD WINAPI RtlAddGrowableFunctionTable( void **table, RUNTIME_FUNCTION *functi
  */
 void WINAPI RtlGrowFunctionTable( void *table, DWORD count )
 {
-    struct dynamic_unwind_entry *entry;
+    struct dynamic_unwind_entry *entry = table;
 
     TRACE( "%p, %u\n", table, count );
 
     RtlEnterCriticalSection( &dynamic_unwind_section );
-    LIST_FOR_EACH_ENTRY( entry, &dynamic_unwind_list, struct dynamic_unwind_entry, entry )
+    if (wine_rb_get( &dynamic_unwind_entries, entry ))
     {
-        if (entry == table)
-        {
-            if (count > entry->count && count <= entry->max_count)
-                entry->count = count;
-            break;
-        }
+        if (count > entry->count && count <= entry->max_count)
+            entry->count = count;
     }
     RtlLeaveCriticalSection( &dynamic_unwind_section );
 }
@@ -434,22 +704,19 @@ void WINAPI RtlGrowFunctionTable( void *table, DWORD count )
  */
 void WINAPI RtlDeleteGrowableFunctionTable( void *table )
 {
-    struct dynamic_unwind_entry *entry, *to_free = NULL;
+    struct dynamic_unwind_entry *to_free = NULL;
 
     TRACE( "%p\n", table );
 
     RtlEnterCriticalSection( &dynamic_unwind_section );
-    LIST_FOR_EACH_ENTRY( entry, &dynamic_unwind_list, struct dynamic_unwind_entry, entry )
+    if (wine_rb_get( &dynamic_unwind_entries, table ))
     {
-        if (entry == table)
-        {
-            to_free = entry;
-            list_remove( &entry->entry );
-            break;
-        }
+        to_free = table;
+        remove_dynamic_unwind_entry( to_free );
     }
     RtlLeaveCriticalSection( &dynamic_unwind_section );
 
+    if (to_free) wait_dynamic_unwind_callbacks( to_free );
     RtlFreeHeap( GetProcessHeap(), 0, to_free );
 }
 
@@ -459,24 +726,17 @@ void WINAPI RtlDeleteGrowableFunctionTable( void *table )
  */
 BOOLEAN CDECL RtlDeleteFunctionTable( RUNTIME_FUNCTION *table )
 {
-    struct dynamic_unwind_entry *entry, *to_free = NULL;
+    struct dynamic_unwind_entry *to_free;
 
     TRACE( "%p\n", table );
 
     RtlEnterCriticalSection( &dynamic_unwind_section );
-    LIST_FOR_EACH_ENTRY( entry, &dynamic_unwind_list, struct dynamic_unwind_entry, entry )
-    {
-        if (entry->table == table)
-        {
-            to_free = entry;
-            list_remove( &entry->entry );
-            break;
-        }
-    }
+    if ((to_free = find_dynamic_unwind_table( table ))) remove_dynamic_unwind_entry( to_free );
     RtlLeaveCriticalSection( &dynamic_unwind_section );
 
     if (!to_free) return FALSE;
 
+    wait_dynamic_unwind_callbacks( to_free );
     RtlFreeHeap( GetProcessHeap(), 0, to_free );
     return TRUE;
 }
@@ -517,15 +777,84 @@ static RUNTIME_FUNCTION *find_function_info( ULONG_PTR pc, ULONG_PTR base,
     return NULL;
 }
 
+/* cache of recent lookups in module function tables, indexed by pc */
+struct unwind_cache_entry
+{
+    LONG                  seq;         /* odd while the entry is being updated */
+    LONG                  generation;  /* value of unwind_cache_generation when filled */
+    ULONG_PTR             pc;
+    RUNTIME_FUNCTION     *func;
+    LDR_DATA_TABLE_ENTRY *module;
+};
+
+#define UNWIND_CACHE_SIZE 1024
+
+static struct unwind_cache_entry unwind_cache[UNWIND_CACHE_SIZE];
+static LONG unwind_cache_generation;
+
+static inline struct unwind_cache_entry *get_unwind_cache_entry( ULONG_PTR pc )
+{
+    return &unwind_cache[(pc ^ (pc >> 10)) % UNWIND_CACHE_SIZE];
+}
+
+static BOOL get_cached_function_info( ULONG_PTR pc, RUNTIME_FUNCTION **func, LDR_DATA_TABLE_ENTRY **module )
+{
+    struct unwind_cache_entry *entry = get_unwind_cache_entry( pc );
+    LONG seq = __atomic_load_n( &entry->seq, __ATOMIC_ACQUIRE );
+    BOOL ret;
+
+    if (seq & 1) return FALSE;
+    ret = entry->pc == pc && entry->generation == unwind_cache_generation;
+    *func = entry->func;
+    *module = entry->module;
+    __atomic_thread_fence( __ATOMIC_ACQUIRE );
+    return ret && entry->seq == seq;
+}
+
+static void set_cached_function_info( ULONG_PTR pc, RUNTIME_FUNCTION *func, LDR_DATA_TABLE_ENTRY *module,
+                                      LONG generation )
+{
+    struct unwind_cache_entry *entry = get_unwind_cache_entry( pc );
+    LONG seq = entry->seq;
+
+    /* leave the entry alone if another thread is updating it */
+    if ((seq & 1) || InterlockedCompareExchange( &entry->seq, seq + 1, seq ) != seq) return;
+    entry->generation = generation;
+    entry->pc = pc;
+    entry->func = func;
+    entry->module = module;
+    __atomic_store_n( &entry->seq, seq + 2, __ATOMIC_RELEASE );
+}
+
+/**********************************************************************
+ *           invalidate_unwind_cache
+ *
+ * Called when a module is unloaded.
+ */
+void invalidate_unwind_cache(void)
+{
+    InterlockedIncrement( &unwind_cache_generation );
+}
+
 /**********************************************************************
  *           lookup_function_info
  */
 RUNTIME_FUNCTION *lookup_function_info( ULONG_PTR pc, ULONG_PTR *base, LDR_DATA_TABLE_ENTRY **module )
 {
     RUNTIME_FUNCTION *func = NULL;
+    struct dynamic_unwind_copy *copy;
     struct dynamic_unwind_entry *entry;
+    PGET_RUNTIME_FUNCTION_CALLBACK callback = NULL;
+    void *context = NULL;
+    LONG generation = unwind_cache_generation;
     ULONG size;
 
+    if (get_cached_function_info( pc, &func, module ))
+    {
+        *base = (ULONG_PTR)(*module)->DllBase;
+        return func;
+    }
+
     /* PE module or wine module */
     if (!LdrFindEntryForAddress( (void *)pc, module ))
     {
@@ -536,26 +865,30 @@ RUNTIME_FUNCTION *lookup_function_info( ULONG_PTR pc, ULONG_PTR *base, LDR_DATA_
             /* lookup in function table */
             func = find_function_info( pc, (ULONG_PTR)(*module)->DllBase, func, size/sizeof(*func) );
         }
+        set_cached_function_info( pc, func, *module, generation );
     }
     else
     {
         *module = NULL;
 
-        RtlEnterCriticalSection( &dynamic_unwind_section );
-        LIST_FOR_EACH_ENTRY( entry, &dynamic_unwind_list, struct dynamic_unwind_entry, entry )
+        copy = enter_dynamic_unwind_index();
+        if ((entry = lookup_dynamic_unwind_entry( copy, pc )))
+        {
+            *base = entry->base;
+            callback = entry->callback;
+            context = entry->context;
+            if (callback) InterlockedIncrement( &entry->refs );
+            else func = find_function_info( pc, entry->base, entry->table, entry->count );
+        }
+        leave_dynamic_unwind_index( copy );
+
+        /* the callback may register or remove other tables, so it's called outside of the index;
+         * the reference keeps the table from being deleted until it returns */
+        if (callback)
         {
-            if (pc >= entry->base && pc < entry->end)
-            {
-                *base = entry->base;
-                /* use callback or lookup in function table */
-                if (entry->callback)
-                    func = entry->callback( pc, entry->context );
-                else
-                    func = find_function_info( pc, entry->base, entry->table, entry->count );
-                break;
-            }
+            func = callback( pc, context );
+            release_dynamic_unwind_ref( &entry->refs, &entry->waiting );
         }
-        RtlLeaveCriticalSection( &dynamic_unwind_section );
     }
 
     return func;
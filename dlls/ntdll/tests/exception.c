@@ -2925,6 +2925,214 @@ static void run_exception_test(void *handler, const void* context,
         VirtualProtect(code_mem, code_size, oldaccess, &oldaccess2);
 }
 
+#define JIT_TABLE_COUNT 10000
+
+struct blocking_callback_data
+{
+    HANDLE entered;
+    HANDLE release;
+    ULONG_PTR table;
+    ULONG_PTR pc;
+};
+
+static RUNTIME_FUNCTION * CALLBACK blocking_unwind_callback( DWORD64 pc, PVOID context )
+{
+    struct blocking_callback_data *data = context;
+    static RUNTIME_FUNCTION runtime_func;
+
+    SetEvent( data->entered );
+    WaitForSingleObject( data->release, 5000 );
+    runtime_func.BeginAddress = 0;
+    runtime_func.EndAddress   = 16;
+    runtime_func.UnwindData   = 0;
+    return &runtime_func;
+}
+
+static DWORD WINAPI blocking_lookup_thread( void *arg )
+{
+    struct blocking_callback_data *data = arg;
+    ULONG_PTR base;
+
+    return pRtlLookupFunctionEntry( data->pc, &base, NULL ) != NULL;
+}
+
+static DWORD WINAPI delete_table_thread( void *arg )
+{
+    struct blocking_callback_data *data = arg;
+
+    return pRtlDeleteFunctionTable( (RUNTIME_FUNCTION *)data->table );
+}
+
+/* a table must not be deleted while its callback is running, since the caller
+ * may unload the code implementing the callback once the table is gone */
+static void test_dynamic_unwind_callback_delete(void)
+{
+    struct blocking_callback_data data;
+    HANDLE lookup, delete;
+    DWORD ret, code;
+
+    data.entered = CreateEventA( NULL, FALSE, FALSE, NULL );
+    data.release = CreateEventA( NULL, TRUE, FALSE, NULL );
+    data.table = (ULONG_PTR)code_mem | 0x3;
+    data.pc = (ULONG_PTR)code_mem + 8;
+    ok( pRtlInstallFunctionTableCallback( data.table, (ULONG_PTR)code_mem, 16, &blocking_unwind_callback,
+                                          &data, NULL ),
+        "RtlInstallFunctionTableCallback failed\n" );
+
+    lookup = CreateThread( NULL, 0, blocking_lookup_thread, &data, 0, NULL );
+    ret = WaitForSingleObject( data.entered, 5000 );
+    ok( ret == WAIT_OBJECT_0, "callback was not called\n" );
+
+    delete = CreateThread( NULL, 0, delete_table_thread, &data, 0, NULL );
+    ret = WaitForSingleObject( delete, 200 );
+    ok( ret == WAIT_TIMEOUT, "RtlDeleteFunctionTable returned while the callback was running\n" );
+
+    SetEvent( data.release );
+    ret = WaitForSingleObject( delete, 5000 );
+    ok( ret == WAIT_OBJECT_0, "RtlDeleteFunctionTable didn't return\n" );
+    GetExitCodeThread( delete, &code );
+    ok( code, "RtlDeleteFunctionTable failed\n" );
+    ret = WaitForSingleObject( lookup, 5000 );
+    ok( ret == WAIT_OBJECT_0, "lookup thread didn't finish\n" );
+    GetExitCodeThread( lookup, &code );
+    ok( code, "RtlLookupFunctionEntry failed\n" );
+
+    CloseHandle( lookup );
+    CloseHandle( delete );
+    CloseHandle( data.entered );
+    CloseHandle( data.release );
+}
+
+static DWORD jit_exception_count;
+
+static DWORD WINAPI jit_exception_handler( EXCEPTION_RECORD *rec, ULONG64 frame,
+                                           CONTEXT *context, DISPATCHER_CONTEXT *dispatcher )
+{
+    jit_exception_count++;
+    context->Rip += 2;  /* skip ud2 */
+    return ExceptionContinueExecution;
+}
+
+static void test_dynamic_unwind_throughput(void)
+{
+    static const BYTE jit_code[] =
+    {
+        0xb9, 0, 0, 0, 0,   /* mov $count,%ecx */
+        0x0f, 0x0b,         /* 1: ud2 */
+        0xff, 0xc9,         /* dec %ecx */
+        0x75, 0xfa,         /* jnz 1b */
+        0xc3,               /* ret */
+    };
+    DWORD i, start, iterations = winetest_interactive ? 100000 : 1000;
+    RUNTIME_FUNCTION *tables, *func;
+    BYTE code[sizeof(jit_code)];
+    ULONG_PTR base;
+    char *jit_mem;
+
+    /* reserve address space for many small jitted functions, each with its own table */
+    jit_mem = VirtualAlloc( NULL, JIT_TABLE_COUNT * 0x1000, MEM_RESERVE, PAGE_NOACCESS );
+    ok( jit_mem != NULL, "VirtualAlloc failed %u\n", GetLastError() );
+    tables = HeapAlloc( GetProcessHeap(), 0, JIT_TABLE_COUNT * sizeof(*tables) );
+
+    start = GetTickCount();
+    for (i = 0; i < JIT_TABLE_COUNT; i++)
+    {
+        tables[i].BeginAddress = 0x10;
+        tables[i].EndAddress   = 0x100;
+        tables[i].UnwindData   = 0x200;
+        /* register in an order unrelated to the addresses */
+        ok( pRtlAddFunctionTable( &tables[i], 1, (ULONG_PTR)jit_mem + ((i * 7919) % JIT_TABLE_COUNT) * 0x1000 ),
+            "RtlAddFunctionTable failed\n" );
+    }
+    if (winetest_interactive)
+        trace( "%u tables registered in %u ms\n", JIT_TABLE_COUNT, GetTickCount() - start );
+
+    for (i = 0; i < JIT_TABLE_COUNT; i += 997)
+    {
+        char *addr = jit_mem + ((i * 7919) % JIT_TABLE_COUNT) * 0x1000;
+
+        base = 0xdeadbeef;
+        func = pRtlLookupFunctionEntry( (ULONG_PTR)addr + 0x20, &base, NULL );
+        ok( func == &tables[i], "%u: got %p instead of %p\n", i, func, &tables[i] );
+        ok( base == (ULONG_PTR)addr, "%u: got base %lx instead of %p\n", i, base, addr );
+        func = pRtlLookupFunctionEntry( (ULONG_PTR)addr + 0x100, &base, NULL );
+        ok( !func, "%u: got %p past the end of the function\n", i, func );
+    }
+
+    /* throw and catch from a dynamic function while all tables are registered */
+    memcpy( code, jit_code, sizeof(code) );
+    *(DWORD *)(code + 1) = iterations;
+    jit_exception_count = 0;
+    start = GetTickCount();
+    run_exception_test( jit_exception_handler, NULL, code, sizeof(code), PAGE_EXECUTE_READ );
+    if (winetest_interactive)
+        trace( "%u exceptions with %u tables in %u ms\n", iterations, JIT_TABLE_COUNT, GetTickCount() - start );
+    ok( jit_exception_count == iterations, "got %u exceptions\n", jit_exception_count );
+
+    for (i = 0; i < JIT_TABLE_COUNT; i++)
+        ok( pRtlDeleteFunctionTable( &tables[i] ), "RtlDeleteFunctionTable failed\n" );
+    HeapFree( GetProcessHeap(), 0, tables );
+    VirtualFree( jit_mem, 0, MEM_RELEASE );
+}
+
+/* walk the stack the way the exception dispatcher does, returning the number of frames */
+static DWORD walk_stack(void)
+{
+    CONTEXT context;
+    RUNTIME_FUNCTION *func;
+    ULONG64 base, frame;
+    void *data;
+    DWORD frames = 0;
+
+    RtlCaptureContext( &context );
+    while (context.Rip && frames < 256)
+    {
+        if (!(func = pRtlLookupFunctionEntry( context.Rip, &base, NULL ))) break;
+        RtlVirtualUnwind( UNW_FLAG_NHANDLER, base, context.Rip, func, &context, &data, &frame, NULL );
+        frames++;
+    }
+    return frames;
+}
+
+static DWORD (*volatile nested_walk_func)( DWORD depth, DWORD iterations );
+
+static DWORD nested_walk( DWORD depth, DWORD iterations )
+{
+    DWORD i, frames, ret = 0;
+
+    if (depth)
+    {
+        volatile DWORD res = nested_walk_func( depth - 1, iterations );  /* avoid a tail call */
+        return res;
+    }
+
+    for (i = 0; i < iterations; i++)
+    {
+        frames = walk_stack();
+        if (!i) ret = frames;
+        else if (frames != ret) break;
+    }
+    ok( i == iterations, "got %u frames instead of %u at iteration %u\n", frames, ret, i );
+    return ret;
+}
+
+static void test_unwind_throughput(void)
+{
+    DWORD start, frames, depth = 32, iterations = winetest_interactive ? 20000 : 100;
+
+    nested_walk_func = nested_walk;
+    start = GetTickCount();
+    frames = nested_walk_func( depth, iterations );
+    if (!frames)
+    {
+        skip( "no unwind information for the test functions\n" );
+        return;
+    }
+    if (winetest_interactive)
+        trace( "%u stack walks in %u ms, %u frames each\n", iterations, GetTickCount() - start, frames );
+    ok( frames > depth, "got only %u frames\n", frames );
+}
+
 static DWORD WINAPI handler( EXCEPTION_RECORD *rec, ULONG64 frame,
                       CONTEXT *context, DISPATCHER_CONTEXT *dispatcher )
 {
@@ -8236,11 +8444,16 @@ START_TEST(exception)
     test_nested_exception();
 
     if (pRtlAddFunctionTable && pRtlDeleteFunctionTable && pRtlInstallFunctionTableCallback && pRtlLookupFunctionEntry)
+    {
       test_dynamic_unwind();
+      test_dynamic_unwind_callback_delete();
+      test_dynamic_unwind_throughput();
+    }
     else
       skip( "Dynamic unwind functions not found\n" );
     test_extended_context();
     test_copy_context();
+    test_unwind_throughput();
 
 #elif defined(__aarch64__)
 
@@ -43,6 +43,9 @@
 #ifdef HAVE_POLL_H
 #include <poll.h>
 #endif
+#ifdef HAVE_SYS_MMAN_H
+# include <sys/mman.h>
+#endif
 #ifdef HAVE_SYS_STAT_H
 # include <sys/stat.h>
 #endif
@@ -58,6 +61,12 @@
 #ifdef HAVE_SYS_TIME_H
 # include <sys/time.h>
 #endif
+#ifdef HAVE_SYS_UIO_H
+#include <sys/uio.h>
+#endif
+#ifdef HAVE_SYS_SENDFILE_H
+#include <sys/sendfile.h>
+#endif
 #ifdef HAVE_SYS_ATTR_H
 #include <sys/attr.h>
 #endif
@@ -93,6 +102,9 @@
 #ifdef HAVE_LINUX_IOCTL_H
 #include <linux/ioctl.h>
 #endif
+#ifdef HAVE_LINUX_IO_URING_H
+#include <linux/io_uring.h>
+#endif
 #ifdef HAVE_LINUX_MAJOR_H
 # include <linux/major.h>
 #endif
@@ -118,6 +130,7 @@
 #define NONAMELESSUNION
 #include "windef.h"
 #include "winnt.h"
+#define WINE_FSCTL_EXTENSIONS
 #include "winioctl.h"
 #include "winternl.h"
 #include "ddk/ntddk.h"
@@ -4948,6 +4961,435 @@ static NTSTATUS set_pending_write( HANDLE device )
 }
 
 
+/***********************************************************************
+ *                  io_uring support for regular files                 *
+ */
+
+#if defined(HAVE_LINUX_IO_URING_H) && defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter)
+
+#define URING_ENTRIES 256
+
+struct uring_io
+{
+    IO_STATUS_BLOCK *io;
+    HANDLE           handle;   /* our own duplicate of the file handle, for completion port notification */
+    int              unix_fd;  /* our own duplicate of the unix fd, for retrying reads */
+    HANDLE           event;
+    ULONG_PTR        cvalue;
+    BOOL             is_read;
+    ULONGLONG        offset;
+    ULONG            length;
+    unsigned int     count;    /* number of iovecs */
+    struct iovec     iov[1];
+};
+
+struct uring
+{
+    int                  fd;
+    unsigned int         sq_entries;
+    unsigned int         cq_entries;
+    unsigned int        *sq_head;
+    unsigned int        *sq_tail;
+    unsigned int        *sq_mask;
+    unsigned int        *sq_array;
+    struct io_uring_sqe *sqes;
+    unsigned int        *cq_head;
+    unsigned int        *cq_tail;
+    unsigned int        *cq_mask;
+    struct io_uring_cqe *cqes;
+};
+
+static pthread_mutex_t uring_mutex = PTHREAD_MUTEX_INITIALIZER;
+static struct uring uring = { -1 };
+static BOOL uring_disabled;       /* setup failed, always use the fallback path */
+static BOOL uring_thread_running; /* completion thread is running */
+static unsigned int uring_pending; /* number of submitted requests not yet reaped */
+
+/* the completion ring is reaped by the completion thread, or by a submitting thread if the
+ * completion thread couldn't be started */
+static pthread_mutex_t uring_cq_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static inline unsigned int uring_load_acquire( unsigned int *ptr )
+{
+    return __atomic_load_n( ptr, __ATOMIC_ACQUIRE );
+}
+
+static inline void uring_store_release( unsigned int *ptr, unsigned int val )
+{
+    __atomic_store_n( ptr, val, __ATOMIC_RELEASE );
+}
+
+/***********************************************************************
+ *           uring_init
+ *
+ * Caller must hold uring_mutex.
+ */
+static BOOL uring_init(void)
+{
+    struct io_uring_params params;
+    size_t sq_size, cq_size;
+    char *sq_ptr, *cq_ptr;
+    void *sqes;
+    int fd;
+
+    if (uring.fd != -1) return TRUE;
+    if (uring_disabled) return FALSE;
+    uring_disabled = TRUE;
+
+    memset( &params, 0, sizeof(params) );
+    if ((fd = syscall( __NR_io_uring_setup, URING_ENTRIES, &params )) == -1)
+    {
+        WARN( "io_uring not available (%s), using synchronous I/O\n", strerror( errno ));
+        return FALSE;
+    }
+
+    sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned int);
+    cq_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) sq_size = cq_size = max( sq_size, cq_size );
+
+    sq_ptr = mmap( NULL, sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING );
+    if (sq_ptr == MAP_FAILED) goto failed;
+    if (params.features & IORING_FEAT_SINGLE_MMAP) cq_ptr = sq_ptr;
+    else
+    {
+        cq_ptr = mmap( NULL, cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING );
+        if (cq_ptr == MAP_FAILED)
+        {
+            munmap( sq_ptr, sq_size );
+            goto failed;
+        }
+    }
+    sqes = mmap( NULL, params.sq_entries * sizeof(struct io_uring_sqe), PROT_READ | PROT_WRITE,
+                 MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES );
+    if (sqes == MAP_FAILED)
+    {
+        if (cq_ptr != sq_ptr) munmap( cq_ptr, cq_size );
+        munmap( sq_ptr, sq_size );
+        goto failed;
+    }
+
+    uring.sq_entries = params.sq_entries;
+    uring.cq_entries = params.cq_entries;
+    uring.sq_head    = (unsigned int *)(sq_ptr + params.sq_off.head);
+    uring.sq_tail    = (unsigned int *)(sq_ptr + params.sq_off.tail);
+    uring.sq_mask    = (unsigned int *)(sq_ptr + params.sq_off.ring_mask);
+    uring.sq_array   = (unsigned int *)(sq_ptr + params.sq_off.array);
+    uring.sqes       = sqes;
+    uring.cq_head    = (unsigned int *)(cq_ptr + params.cq_off.head);
+    uring.cq_tail    = (unsigned int *)(cq_ptr + params.cq_off.tail);
+    uring.cq_mask    = (unsigned int *)(cq_ptr + params.cq_off.ring_mask);
+    uring.cqes       = (struct io_uring_cqe *)(cq_ptr + params.cq_off.cqes);
+    fcntl( fd, F_SETFD, FD_CLOEXEC );
+    uring.fd = fd;
+    uring_disabled = FALSE;
+    TRACE( "using io_uring with %u/%u entries\n", params.sq_entries, params.cq_entries );
+    return TRUE;
+
+failed:
+    WARN( "failed to map io_uring rings (%s), using synchronous I/O\n", strerror( errno ));
+    close( fd );
+    return FALSE;
+}
+
+/***********************************************************************
+ *           uring_has_completion_port
+ *
+ * Ask the server whether the file object behind a handle is associated with a completion port.
+ * The association belongs to the file object and not to the handle, so it is shared by
+ * duplicated and inherited handles, and can't be cached on the handle value.
+ */
+static BOOL uring_has_completion_port( HANDLE handle )
+{
+    BOOL ret = FALSE;
+
+    SERVER_START_REQ( get_fd_completion )
+    {
+        req->handle = wine_server_obj_handle( handle );
+        if (!wine_server_call( req )) ret = reply->associated;
+    }
+    SERVER_END_REQ;
+    return ret;
+}
+
+/***********************************************************************
+ *           uring_complete
+ *
+ * Report the result of a finished request.
+ */
+static void uring_complete( struct uring_io *req, int res )
+{
+    NTSTATUS status;
+    ULONG total = 0;
+    unsigned int i;
+
+    if (res == -EFAULT && req->is_read && req->unix_fd != -1)
+    {
+        /* the buffers may be write-watched, retry synchronously */
+        ULONGLONG offset = req->offset;
+        ssize_t ret;
+
+        for (i = 0, res = 0; i < req->count; i++)
+        {
+            while ((ret = virtual_locked_pread( req->unix_fd, req->iov[i].iov_base, req->iov[i].iov_len,
+                                                offset )) == -1 && errno == EINTR);
+            if (ret == -1)
+            {
+                if (!res) res = -errno;
+                break;
+            }
+            res += ret;
+            offset += ret;
+            if (ret < req->iov[i].iov_len) break;
+        }
+    }
+
+    if (res == -EFAULT && !req->is_read) status = STATUS_INVALID_USER_BUFFER;
+    else if (res < 0) status = errno_to_status( -res );
+    else
+    {
+        total = res;
+        status = (total || !req->length || !req->is_read) ? STATUS_SUCCESS : STATUS_END_OF_FILE;
+    }
+
+    TRACE( "%p: %s %u bytes at 0x%s, status %#x\n", req->io, req->is_read ? "read" : "wrote",
+           total, wine_dbgstr_longlong( req->offset ), status );
+
+    req->io->Information = total;
+    req->io->u.Status = status;
+    if (req->event) NtSetEvent( req->event, NULL );
+    if (req->cvalue) add_completion( req->handle, req->cvalue, status, total, TRUE );
+    if (req->handle) NtClose( req->handle );
+    if (req->unix_fd != -1) close( req->unix_fd );
+    free( req );
+}
+
+/***********************************************************************
+ *           uring_reap
+ *
+ * Complete all the requests that are waiting in the completion ring.
+ */
+static unsigned int uring_reap(void)
+{
+    unsigned int head, tail, count = 0;
+    sigset_t sigset;
+
+    server_enter_uninterrupted_section( &uring_cq_mutex, &sigset );
+    head = *uring.cq_head;
+    tail = uring_load_acquire( uring.cq_tail );
+    while (head != tail)
+    {
+        struct io_uring_cqe *cqe = &uring.cqes[head & *uring.cq_mask];
+        struct uring_io *req = (struct uring_io *)(ULONG_PTR)cqe->user_data;
+        int res = cqe->res;
+
+        uring_store_release( uring.cq_head, ++head );
+        uring_complete( req, res );
+        count++;
+        if (head == tail) tail = uring_load_acquire( uring.cq_tail );
+    }
+    server_leave_uninterrupted_section( &uring_cq_mutex, &sigset );
+
+    if (count)
+    {
+        server_enter_uninterrupted_section( &uring_mutex, &sigset );
+        uring_pending -= count;
+        server_leave_uninterrupted_section( &uring_mutex, &sigset );
+    }
+    return count;
+}
+
+/***********************************************************************
+ *           uring_thread
+ *
+ * Thread reaping io_uring completions; exits once it has been idle for a while.
+ */
+static void CALLBACK uring_thread( void *arg )
+{
+    struct pollfd pfd;
+    sigset_t sigset;
+
+    pfd.fd = uring.fd;
+    pfd.events = POLLIN;
+
+    for (;;)
+    {
+        if (uring_reap() || poll( &pfd, 1, 1000 )) continue;
+
+        server_enter_uninterrupted_section( &uring_mutex, &sigset );
+        if (!uring_pending)
+        {
+            uring_thread_running = FALSE;
+            server_leave_uninterrupted_section( &uring_mutex, &sigset );
+            break;
+        }
+        server_leave_uninterrupted_section( &uring_mutex, &sigset );
+    }
+    NtTerminateThread( GetCurrentThread(), 0 );
+}
+
+/***********************************************************************
+ *           uring_submit
+ *
+ * Queue an asynchronous read or write on a regular file.
+ * Returns STATUS_NOT_SUPPORTED if the caller should fall back to synchronous I/O.
+ */
+static NTSTATUS uring_submit( HANDLE handle, int fd, HANDLE event, PIO_APC_ROUTINE apc, void *apc_user,
+                              IO_STATUS_BLOCK *io, BOOL is_read, const struct iovec *iov, unsigned int count,
+                              ULONG length, ULONGLONG offset )
+{
+    ULONG_PTR cvalue = apc ? 0 : (ULONG_PTR)apc_user;
+    struct io_uring_sqe *sqe;
+    struct uring_io *req;
+    unsigned int tail, idx;
+    BOOL start_thread;
+    sigset_t sigset;
+    HANDLE thread;
+    int ret;
+
+    /* user APCs need to be queued to the calling thread, leave those to the synchronous path */
+    if (apc || uring_disabled) return STATUS_NOT_SUPPORTED;
+
+    /* without an event or a completion port the caller would wait on the file handle,
+     * which is only signaled by server-side asyncs */
+    if (!event && !cvalue) return STATUS_NOT_SUPPORTED;
+
+    /* only files associated with a completion port need to be notified */
+    if (cvalue && !uring_has_completion_port( handle ))
+    {
+        if (!event) return STATUS_NOT_SUPPORTED;
+        cvalue = 0;
+    }
+
+    if (!(req = malloc( offsetof( struct uring_io, iov[count] ) ))) return STATUS_NOT_SUPPORTED;
+    req->io      = io;
+    req->handle  = 0;
+    req->unix_fd = -1;
+    req->event   = event;
+    req->cvalue  = cvalue;
+    req->is_read = is_read;
+    req->offset  = offset;
+    req->length  = length;
+    req->count   = count;
+    memcpy( req->iov, iov, count * sizeof(*iov) );
+
+    /* the handle may be closed or reused before the request completes */
+    if (cvalue)
+    {
+        if (NtDuplicateObject( GetCurrentProcess(), handle, GetCurrentProcess(), &req->handle,
+                               0, 0, DUPLICATE_SAME_ACCESS ))
+        {
+            free( req );
+            return STATUS_NOT_SUPPORTED;
+        }
+    }
+    if (is_read) req->unix_fd = dup( fd );
+
+    if (event) NtResetEvent( event, NULL );
+
+    server_enter_uninterrupted_section( &uring_mutex, &sigset );
+    if (!uring_init() ||
+        uring_pending >= uring.cq_entries)
+        goto fallback;
+
+    tail = *uring.sq_tail;
+    if (tail - uring_load_acquire( uring.sq_head ) >= uring.sq_entries) goto fallback;
+
+    io->u.Status = STATUS_PENDING;
+    io->Information = 0;
+
+    idx = tail & *uring.sq_mask;
+    sqe = &uring.sqes[idx];
+    memset( sqe, 0, sizeof(*sqe) );
+    sqe->opcode    = is_read ? IORING_OP_READV : IORING_OP_WRITEV;
+    sqe->fd        = fd;
+    sqe->off       = offset;
+    sqe->addr      = (ULONG_PTR)req->iov;
+    sqe->len       = count;
+    sqe->user_data = (ULONG_PTR)req;
+    uring.sq_array[idx] = idx;
+    uring_store_release( uring.sq_tail, tail + 1 );
+
+    while ((ret = syscall( __NR_io_uring_enter, uring.fd, 1, 0, 0, NULL, 0 )) == -1)
+    {
+        if (errno == EINTR || errno == EAGAIN) continue;
+        if (uring_load_acquire( uring.sq_head ) != tail) break;  /* consumed anyway */
+
+        WARN( "io_uring_enter failed (%s)\n", strerror( errno ));
+        uring_store_release( uring.sq_tail, tail );
+        goto fallback;
+    }
+
+    uring_pending++;
+    start_thread = !uring_thread_running;
+    uring_thread_running = TRUE;
+    server_leave_uninterrupted_section( &uring_mutex, &sigset );
+
+    TRACE( "%p: queued %s of %u bytes at 0x%s\n", handle, is_read ? "read" : "write",
+           length, wine_dbgstr_longlong( offset ));
+
+    if (start_thread)
+    {
+        if (!NtCreateThreadEx( &thread, THREAD_ALL_ACCESS, NULL, GetCurrentProcess(),
+                               uring_thread, NULL, 0, 0, 0, 0, NULL ))
+            NtClose( thread );
+        else
+        {
+            struct pollfd pfd;
+
+            ERR( "failed to start io_uring completion thread, waiting for completion\n" );
+            server_enter_uninterrupted_section( &uring_mutex, &sigset );
+            uring_thread_running = FALSE;
+            server_leave_uninterrupted_section( &uring_mutex, &sigset );
+
+            pfd.fd = uring.fd;
+            pfd.events = POLLIN;
+            while (io->u.Status == STATUS_PENDING)
+                if (!uring_reap()) poll( &pfd, 1, 100 );
+        }
+    }
+    return STATUS_PENDING;
+
+fallback:
+    server_leave_uninterrupted_section( &uring_mutex, &sigset );
+    if (req->handle) NtClose( req->handle );
+    if (req->unix_fd != -1) close( req->unix_fd );
+    free( req );
+    return STATUS_NOT_SUPPORTED;
+}
+
+#else  /* HAVE_LINUX_IO_URING_H */
+
+static NTSTATUS uring_submit( HANDLE handle, int fd, HANDLE event, PIO_APC_ROUTINE apc, void *apc_user,
+                              IO_STATUS_BLOCK *io, BOOL is_read, const struct iovec *iov, unsigned int count,
+                              ULONG length, ULONGLONG offset )
+{
+    return STATUS_NOT_SUPPORTED;
+}
+
+#endif  /* HAVE_LINUX_IO_URING_H */
+
+/* queue an asynchronous scatter/gather I/O; helper for NtReadFileScatter and NtWriteFileGather */
+static NTSTATUS uring_submit_segments( HANDLE handle, int fd, HANDLE event, PIO_APC_ROUTINE apc,
+                                       void *apc_user, IO_STATUS_BLOCK *io, BOOL is_read,
+                                       FILE_SEGMENT_ELEMENT *segments, ULONG length, ULONGLONG offset )
+{
+    unsigned int i, count = (length + page_size - 1) / page_size;
+    struct iovec *iov;
+    NTSTATUS status;
+
+    if (count > 1024) return STATUS_NOT_SUPPORTED;  /* IOV_MAX */
+    if (!(iov = malloc( count * sizeof(*iov) ))) return STATUS_NOT_SUPPORTED;
+    for (i = 0; i < count; i++)
+    {
+        iov[i].iov_base = segments[i].Buffer;
+        iov[i].iov_len  = min( length - i * page_size, page_size );
+    }
+    status = uring_submit( handle, fd, event, apc, apc_user, io, is_read, iov, count, length, offset );
+    free( iov );
+    return status;
+}
+
+
 /******************************************************************************
  *              NtReadFile   (NTDLL.@)
  */
@@ -4989,7 +5431,22 @@ NTSTATUS WINAPI NtReadFile( HANDLE handle, HANDLE event, PIO_APC_ROUTINE apc, vo
 
         if (offset && offset->QuadPart != FILE_USE_FILE_POINTER_POSITION)
         {
-            /* async I/O doesn't make sense on regular files */
+            if (async_read && length)
+            {
+                struct iovec iov;
+
+                iov.iov_base = buffer;
+                iov.iov_len  = length;
+                status = uring_submit( handle, unix_handle, event, apc, apc_user, io, TRUE,
+                                       &iov, 1, length, offset->QuadPart );
+                if (status != STATUS_NOT_SUPPORTED)
+                {
+                    if (needs_close) close( unix_handle );
+                    return status;
+                }
+            }
+
+            /* otherwise do the I/O synchronously */
             while ((result = virtual_locked_pread( unix_handle, buffer, length, offset->QuadPart )) == -1)
             {
                 if (errno != EINTR)
@@ -5175,6 +5632,18 @@ NTSTATUS WINAPI NtReadFileScatter( HANDLE file, HANDLE event, PIO_APC_ROUTINE ap
         goto error;
     }
 
+    if (length && offset && offset->QuadPart != FILE_USE_FILE_POINTER_POSITION)
+    {
+        status = uring_submit_segments( file, unix_handle, event, apc, apc_user, io, TRUE,
+                                        segments, length, offset->QuadPart );
+        if (status != STATUS_NOT_SUPPORTED)
+        {
+            if (needs_close) close( unix_handle );
+            return status;
+        }
+        status = STATUS_SUCCESS;
+    }
+
     while (length)
     {
         if (offset && offset->QuadPart != FILE_USE_FILE_POINTER_POSITION)
@@ -5299,8 +5768,22 @@ NTSTATUS WINAPI NtWriteFile( HANDLE handle, HANDLE event, PIO_APC_ROUTINE apc, v
                 status = STATUS_INVALID_PARAMETER;
                 goto done;
             }
+            else if (async_write && length)
+            {
+                struct iovec iov;
 
-            /* async I/O doesn't make sense on regular files */
+                iov.iov_base = (void *)buffer;
+                iov.iov_len  = length;
+                status = uring_submit( handle, unix_handle, event, apc, apc_user, io, FALSE,
+                                       &iov, 1, length, off );
+                if (status != STATUS_NOT_SUPPORTED)
+                {
+                    if (needs_close) close( unix_handle );
+                    return status;
+                }
+            }
+
+            /* otherwise do the I/O synchronously */
             while ((result = pwrite( unix_handle, buffer, length, off )) == -1)
             {
                 if (errno != EINTR)
@@ -5478,6 +5961,18 @@ NTSTATUS WINAPI NtWriteFileGather( HANDLE file, HANDLE event, PIO_APC_ROUTINE ap
         goto done;
     }
 
+    if (length && offset && offset->QuadPart != FILE_USE_FILE_POINTER_POSITION)
+    {
+        status = uring_submit_segments( file, unix_handle, event, apc, apc_user, io, FALSE,
+                                        segments, length, offset->QuadPart );
+        if (status != STATUS_NOT_SUPPORTED)
+        {
+            if (needs_close) close( unix_handle );
+            return status;
+        }
+        status = STATUS_SUCCESS;
+    }
+
     while (length)
     {
         if (offset && offset->QuadPart != FILE_USE_FILE_POINTER_POSITION)
@@ -5600,6 +6095,169 @@ static void ignore_server_ioctl_struct_holes( ULONG code, const void *in_buffer,
 }
 
 
+#if defined(__linux__) && !defined(FICLONERANGE)
+struct file_clone_range
+{
+    long long src_fd;
+    unsigned long long src_offset;
+    unsigned long long src_length;
+    unsigned long long dest_offset;
+};
+#define FICLONERANGE _IOW(0x94, 13, struct file_clone_range)
+#endif
+
+/* errors meaning that the file system can't share extents between these files */
+static BOOL is_clone_unsupported_errno( int err )
+{
+    return err == EXDEV || err == EINVAL || err == ENOSYS || err == EOPNOTSUPP ||
+           err == ENOTTY || err == EBADF || err == ETXTBSY;
+}
+
+static int clone_file_range( int src_fd, ULONGLONG src_pos, int dst_fd, ULONGLONG dst_pos, ULONGLONG size )
+{
+#ifdef __linux__
+    struct file_clone_range range;
+
+    range.src_fd      = src_fd;
+    range.src_offset  = src_pos;
+    range.src_length  = size;
+    range.dest_offset = dst_pos;
+    return ioctl( dst_fd, FICLONERANGE, &range );
+#else
+    errno = ENOSYS;
+    return -1;
+#endif
+}
+
+static ssize_t copy_file_range_chunk( int src_fd, ULONGLONG src_pos, int dst_fd, ULONGLONG dst_pos, ULONGLONG size )
+{
+#if defined(__linux__) && defined(__NR_copy_file_range)
+    long long src_off = src_pos, dst_off = dst_pos;
+
+    return syscall( __NR_copy_file_range, src_fd, &src_off, dst_fd, &dst_off,
+                    (size_t)min( size, 0x40000000 ), 0 );
+#else
+    errno = ENOSYS;
+    return -1;
+#endif
+}
+
+static ssize_t sendfile_chunk( int src_fd, ULONGLONG src_pos, int dst_fd, ULONGLONG size )
+{
+#ifdef HAVE_SYS_SENDFILE_H
+    off_t src_off = src_pos;
+
+    return sendfile( dst_fd, src_fd, &src_off, (size_t)min( size, 0x40000000 ) );
+#else
+    errno = ENOSYS;
+    return -1;
+#endif
+}
+
+/* copy the range with copy_file_range(), or with sendfile() if that isn't supported
+ * between these files; the copy is short without error if the source file shrinks */
+static NTSTATUS copy_file_range_kernel( int src_fd, ULONGLONG src_pos, int dst_fd, ULONGLONG dst_pos,
+                                        ULONGLONG size, ULONGLONG *done )
+{
+    ssize_t ret = 0;
+
+    *done = 0;
+    while (*done < size)
+    {
+        if ((ret = copy_file_range_chunk( src_fd, src_pos + *done, dst_fd, dst_pos + *done, size - *done )) > 0)
+            *done += ret;
+        else if (ret || errno != EINTR) break;
+    }
+
+    if (*done < size && ret == -1 && !*done && is_clone_unsupported_errno( errno ))
+    {
+        off_t prev = lseek( dst_fd, 0, SEEK_CUR );
+
+        /* sendfile() writes at the current position, which is shared with the file pointer */
+        if (prev != -1 && lseek( dst_fd, dst_pos, SEEK_SET ) != -1)
+        {
+            while (*done < size)
+            {
+                if ((ret = sendfile_chunk( src_fd, src_pos + *done, dst_fd, size - *done )) > 0)
+                    *done += ret;
+                else if (ret || errno != EINTR) break;
+            }
+            lseek( dst_fd, prev, SEEK_SET );
+        }
+        else ret = -1;
+    }
+
+    if (*done < size && ret == -1)
+    {
+        if (!*done && is_clone_unsupported_errno( errno )) return STATUS_NOT_SUPPORTED;
+        return errno_to_status( errno );
+    }
+    return STATUS_SUCCESS;
+}
+
+/* FSCTL_DUPLICATE_EXTENTS_TO_FILE: share the source extents with the target; this is
+ * only possible if the file system supports reflinks. FSCTL_WINE_COPY_FILE_RANGE takes
+ * the same input, but falls back to copy_file_range() and then sendfile().
+ * On success io->Information receives the number of bytes transferred; it is smaller than
+ * the requested count only if the range extends past the end of the source file. */
+static NTSTATUS duplicate_extents( HANDLE handle, const DUPLICATE_EXTENTS_DATA *data, BOOL allow_copy,
+                                   IO_STATUS_BLOCK *io )
+{
+    int src_fd, dst_fd, src_needs_close, dst_needs_close;
+    ULONGLONG src_pos, dst_pos, size, done = 0;
+    struct stat src_st, dst_st;
+    NTSTATUS status = STATUS_SUCCESS;
+
+    io->Information = 0;
+    if (data->SourceFileOffset.QuadPart < 0 || data->TargetFileOffset.QuadPart < 0 ||
+        data->ByteCount.QuadPart < 0)
+        return STATUS_INVALID_PARAMETER;
+
+    if ((status = server_get_unix_fd( handle, FILE_WRITE_DATA, &dst_fd, &dst_needs_close, NULL, NULL )))
+        return status;
+    if ((status = server_get_unix_fd( data->FileHandle, FILE_READ_DATA, &src_fd, &src_needs_close, NULL, NULL )))
+    {
+        if (dst_needs_close) close( dst_fd );
+        return status;
+    }
+
+    if (fstat( src_fd, &src_st ) == -1 || fstat( dst_fd, &dst_st ) == -1 ||
+        !S_ISREG( src_st.st_mode ) || !S_ISREG( dst_st.st_mode ))
+    {
+        status = STATUS_INVALID_DEVICE_REQUEST;
+        goto done;
+    }
+
+    src_pos = data->SourceFileOffset.QuadPart;
+    dst_pos = data->TargetFileOffset.QuadPart;
+    size = src_pos < src_st.st_size ? min( data->ByteCount.QuadPart, src_st.st_size - src_pos ) : 0;
+    if (!size) goto done;
+
+    if (src_st.st_dev == dst_st.st_dev && src_st.st_ino == dst_st.st_ino &&
+        src_pos < dst_pos + size && dst_pos < src_pos + size)
+    {
+        status = STATUS_INVALID_PARAMETER;
+        goto done;
+    }
+
+    if (!clone_file_range( src_fd, src_pos, dst_fd, dst_pos, size ))
+    {
+        TRACE( "cloned %s bytes\n", wine_dbgstr_longlong( size ));
+        done = size;
+    }
+    else if (allow_copy && is_clone_unsupported_errno( errno ))
+        status = copy_file_range_kernel( src_fd, src_pos, dst_fd, dst_pos, size, &done );
+    else if (is_clone_unsupported_errno( errno )) status = STATUS_NOT_SUPPORTED;
+    else status = errno_to_status( errno );
+
+done:
+    if (!status) io->Information = done;
+    if (src_needs_close) close( src_fd );
+    if (dst_needs_close) close( dst_fd );
+    return status;
+}
+
+
 /******************************************************************************
  *              NtFsControlFile   (NTDLL.@)
  */
@@ -5682,6 +6340,16 @@ NTSTATUS WINAPI NtFsControlFile( HANDLE handle, HANDLE event, PIO_APC_ROUTINE ap
         break;
     }
 
+    case FSCTL_DUPLICATE_EXTENTS_TO_FILE:
+    case FSCTL_WINE_COPY_FILE_RANGE:
+        if (in_size < sizeof(DUPLICATE_EXTENTS_DATA))
+        {
+            status = STATUS_INVALID_PARAMETER;
+            break;
+        }
+        status = duplicate_extents( handle, in_buffer, code == FSCTL_WINE_COPY_FILE_RANGE, io );
+        break;
+
     case FSCTL_SET_SPARSE:
         TRACE("FSCTL_SET_SPARSE: Ignoring request\n");
         io->Information = 0;
@@ -126,6 +126,7 @@ const char *build_dir = NULL;
 const char *config_dir = NULL;
 const char **dll_paths = NULL;
 const char *user_name = NULL;
+LONG builtin_unload_count = 0;
 static HMODULE ntdll_module;
 static const IMAGE_EXPORT_DIRECTORY *ntdll_exports;
 
@@ -1348,6 +1349,8 @@ static NTSTATUS CDECL unload_builtin_dll( void *module )
     {
         if (builtin->module != module) continue;
         list_remove( &builtin->entry );
+        /* invalidate cached unwind information before the library goes away */
+        InterlockedIncrement( &builtin_unload_count );
         if (builtin->handle) dlclose( builtin->handle );
         if (builtin->unix_handle) dlclose( builtin->unix_handle );
         free( builtin );
@@ -1044,6 +1044,37 @@ done:
 }
 
 
+/***********************************************************************
+ *           server_get_completion_shm
+ *
+ * Retrieve a file descriptor for the memory that a completion port shares with the server.
+ */
+NTSTATUS server_get_completion_shm( HANDLE handle, int *fd, data_size_t *size )
+{
+    sigset_t sigset;
+    obj_handle_t fd_handle;
+    NTSTATUS ret;
+
+    *fd = -1;
+    server_enter_uninterrupted_section( &fd_cache_mutex, &sigset );
+    SERVER_START_REQ( get_completion_shm )
+    {
+        req->handle = wine_server_obj_handle( handle );
+        if (!(ret = wine_server_call( req )))
+        {
+            *size = reply->size;
+            if ((*fd = receive_fd( &fd_handle )) != -1)
+                assert( wine_server_ptr_handle(fd_handle) == handle );
+            else
+                ret = STATUS_TOO_MANY_OPENED_FILES;
+        }
+    }
+    SERVER_END_REQ;
+    server_leave_uninterrupted_section( &fd_cache_mutex, &sigset );
+    return ret;
+}
+
+
 /***********************************************************************
  *           wine_server_fd_to_handle
  */
@@ -1627,6 +1658,7 @@ NTSTATUS WINAPI NtDuplicateObject( HANDLE source_process, HANDLE source, HANDLE
             {
                 int fd = remove_fd_from_cache( source );
                 if (fd != -1) close( fd );
+                completion_close_handle( source );
             }
         }
     }
@@ -1644,6 +1676,7 @@ NTSTATUS WINAPI NtClose( HANDLE handle )
     NTSTATUS ret;
     int fd = remove_fd_from_cache( handle );
 
+    completion_close_handle( handle );
     SERVER_START_REQ( close_handle )
     {
         req->handle = wine_server_obj_handle( handle );
@@ -1356,10 +1356,57 @@ static NTSTATUS libunwind_virtual_unwind( ULONG64 ip, ULONG64 *frame, CONTEXT *c
 /***********************************************************************
  *           unwind_builtin_dll
  */
+/* cache of recent FDE lookups, indexed by ip */
+struct fde_cache_entry
+{
+    LONG                    seq;         /* odd while the entry is being updated */
+    LONG                    generation;  /* value of builtin_unload_count when filled */
+    ULONG64                 ip;
+    const struct dwarf_fde *fde;
+    struct dwarf_eh_bases   bases;
+};
+
+#define FDE_CACHE_SIZE 1024
+
+static struct fde_cache_entry fde_cache[FDE_CACHE_SIZE];
+
+/***********************************************************************
+ *           find_fde
+ *
+ * Cached wrapper around _Unwind_Find_FDE, which has to search the loaded libraries.
+ */
+static const struct dwarf_fde *find_fde( ULONG64 ip, struct dwarf_eh_bases *bases )
+{
+    struct fde_cache_entry *entry = &fde_cache[(ip ^ (ip >> 10)) % FDE_CACHE_SIZE];
+    LONG generation = builtin_unload_count;
+    const struct dwarf_fde *fde;
+    LONG seq = __atomic_load_n( &entry->seq, __ATOMIC_ACQUIRE );
+
+    if (!(seq & 1) && entry->ip == ip && entry->generation == generation)
+    {
+        fde = entry->fde;
+        *bases = entry->bases;
+        __atomic_thread_fence( __ATOMIC_ACQUIRE );
+        if (entry->seq == seq) return fde;
+    }
+
+    fde = _Unwind_Find_FDE( (void *)(ip - 1), bases );
+
+    /* leave the entry alone if another thread is updating it */
+    seq = entry->seq;
+    if ((seq & 1) || InterlockedCompareExchange( &entry->seq, seq + 1, seq ) != seq) return fde;
+    entry->generation = generation;
+    entry->ip = ip;
+    entry->fde = fde;
+    entry->bases = *bases;
+    __atomic_store_n( &entry->seq, seq + 2, __ATOMIC_RELEASE );
+    return fde;
+}
+
 NTSTATUS CDECL unwind_builtin_dll( ULONG type, DISPATCHER_CONTEXT *dispatch, CONTEXT *context )
 {
     struct dwarf_eh_bases bases;
-    const struct dwarf_fde *fde = _Unwind_Find_FDE( (void *)(context->Rip - 1), &bases );
+    const struct dwarf_fde *fde = find_fde( context->Rip, &bases );
 
     if (fde)
         return dwarf_virtual_unwind( context->Rip, &dispatch->EstablisherFrame, context, fde,
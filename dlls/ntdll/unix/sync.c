@@ -50,6 +50,9 @@
 #ifdef HAVE_SCHED_H
 # include <sched.h>
 #endif
+#ifdef HAVE_SYS_MMAN_H
+# include <sys/mman.h>
+#endif
 #include <string.h>
 #include <stdarg.h>
 #include <stdio.h>
@@ -70,6 +73,7 @@
 #include "ddk/wdm.h"
 #include "wine/server.h"
 #include "wine/exception.h"
+#include "wine/rbtree.h"
 #include "wine/debug.h"
 #include "unix_private.h"
 
@@ -1567,6 +1571,435 @@ NTSTATUS WINAPI NtReleaseKeyedEvent( HANDLE handle, const void *key,
 }
 
 
+/***********************************************************************
+ * Completion port shared memory
+ *
+ * Packets posted from the client side are queued in a ring in memory shared
+ * with the server, and non-alertable waits are done on a futex in the same
+ * memory, so that posting and dequeuing packets doesn't require a server
+ * round trip. Packets queued in the server, and alertable waits, still go
+ * through the server object. Clients only use the ring while the server queue
+ * is empty, and the server moves the ring to its queue before queuing packets
+ * itself, so that packets are dequeued in the order they were posted.
+ */
+
+struct completion_mapping
+{
+    struct wine_rb_entry   entry;
+    HANDLE                 handle;
+    struct completion_shm *shm;       /* NULL if the port doesn't support shared memory */
+    LONG                   refcount;
+    BOOL                   closed;    /* handle has been closed */
+};
+
+static int compare_completion_mapping( const void *key, const struct wine_rb_entry *entry )
+{
+    const struct completion_mapping *map = WINE_RB_ENTRY_VALUE( entry, const struct completion_mapping, entry );
+    HANDLE handle = *(const HANDLE *)key;
+
+    if (handle < map->handle) return -1;
+    return handle > map->handle;
+}
+
+static pthread_mutex_t completion_mutex = PTHREAD_MUTEX_INITIALIZER;
+static struct wine_rb_tree completion_mappings = { compare_completion_mapping };
+
+/* remove packets from the server queue without waiting */
+static NTSTATUS remove_server_completions( HANDLE handle, FILE_IO_COMPLETION_INFORMATION *info,
+                                           ULONG count, ULONG *written )
+{
+    NTSTATUS status = STATUS_SUCCESS;
+
+    while (*written < count)
+    {
+        SERVER_START_REQ( remove_completion )
+        {
+            req->handle = wine_server_obj_handle( handle );
+            if (!(status = wine_server_call( req )))
+            {
+                info[*written].CompletionKey             = reply->ckey;
+                info[*written].CompletionValue           = reply->cvalue;
+                info[*written].IoStatusBlock.Information = reply->information;
+                info[*written].IoStatusBlock.u.Status    = reply->status;
+            }
+        }
+        SERVER_END_REQ;
+        if (status != STATUS_SUCCESS) break;
+        ++*written;
+    }
+    return status;
+}
+
+#ifdef __linux__
+
+static inline int futex_wait_shared( int *addr, int val, struct timespec *timeout )
+{
+    return syscall( __NR_futex, addr, FUTEX_WAIT, val, timeout, 0, 0 );
+}
+
+static inline int futex_wake_shared( int *addr, int val )
+{
+    return syscall( __NR_futex, addr, FUTEX_WAKE, val, NULL, 0, 0 );
+}
+
+static void release_completion_mapping( struct completion_mapping *map )
+{
+    if (InterlockedDecrement( &map->refcount )) return;
+    if (map->shm) munmap( map->shm, sizeof(*map->shm) );
+    free( map );
+}
+
+/* get the shared memory of a completion port; must be called with signals blocked */
+static struct completion_mapping *get_completion_mapping( HANDLE handle )
+{
+    struct completion_mapping *map = NULL;
+    struct wine_rb_entry *entry;
+    data_size_t size;
+    void *ptr;
+    NTSTATUS status;
+    int fd;
+
+    if (!use_futexes()) return NULL;
+
+    pthread_mutex_lock( &completion_mutex );
+    if ((entry = wine_rb_get( &completion_mappings, &handle )))
+    {
+        map = WINE_RB_ENTRY_VALUE( entry, struct completion_mapping, entry );
+        if (map->shm) InterlockedIncrement( &map->refcount );
+        else map = NULL;
+        pthread_mutex_unlock( &completion_mutex );
+        return map;
+    }
+
+    status = server_get_completion_shm( handle, &fd, &size );
+    if (!status)
+    {
+        ptr = MAP_FAILED;
+        if (size == sizeof(*map->shm))
+            ptr = mmap( NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+        close( fd );
+        if (ptr == MAP_FAILED) status = STATUS_NOT_SUPPORTED;
+    }
+    /* only remember the failure if it's caused by the port itself, not by the handle */
+    if ((!status || status == STATUS_NOT_SUPPORTED) && (map = malloc( sizeof(*map) )))
+    {
+        map->handle   = handle;
+        map->shm      = status ? NULL : ptr;
+        map->refcount = status ? 1 : 2;
+        map->closed   = FALSE;
+        wine_rb_put( &completion_mappings, &handle, &map->entry );
+        if (status) map = NULL;
+    }
+    else if (!status) munmap( ptr, size );
+    pthread_mutex_unlock( &completion_mutex );
+    return map;
+}
+
+/***********************************************************************
+ *           completion_close_handle
+ *
+ * Forget the shared memory of a completion port when its handle is closed.
+ */
+void completion_close_handle( HANDLE handle )
+{
+    struct completion_mapping *map = NULL;
+    struct wine_rb_entry *entry;
+    sigset_t sigset;
+
+    if (!completion_mappings.root) return;
+
+    server_enter_uninterrupted_section( &completion_mutex, &sigset );
+    if ((entry = wine_rb_get( &completion_mappings, &handle )))
+    {
+        map = WINE_RB_ENTRY_VALUE( entry, struct completion_mapping, entry );
+        wine_rb_remove( &completion_mappings, entry );
+    }
+    server_leave_uninterrupted_section( &completion_mutex, &sigset );
+    if (!map) return;
+
+    if (map->shm)
+    {
+        /* wake up our waiters so that they notice the handle is gone */
+        map->closed = TRUE;
+        InterlockedIncrement( (LONG *)&map->shm->seq );
+        futex_wake_shared( &map->shm->seq, INT_MAX );
+    }
+    release_completion_mapping( map );
+}
+
+/* the lock holds the unix pid of its owner, so that the server can release it if the
+ * owner dies while holding it */
+static void completion_shm_lock( struct completion_shm *shm )
+{
+    static int pid;
+    int owner, val;
+
+    if (!pid) pid = getpid();
+    owner = pid;
+    while ((val = InterlockedCompareExchange( (LONG *)&shm->lock, owner, 0 )))
+    {
+        if (!(val & COMPLETION_SHM_LOCK_WAITERS) &&
+            InterlockedCompareExchange( (LONG *)&shm->lock, val | COMPLETION_SHM_LOCK_WAITERS, val ) != val)
+            continue;
+        futex_wait_shared( &shm->lock, val | COMPLETION_SHM_LOCK_WAITERS, NULL );
+        /* there may be other waiters, make sure that they get woken up */
+        owner = pid | COMPLETION_SHM_LOCK_WAITERS;
+    }
+}
+
+static void completion_shm_unlock( struct completion_shm *shm )
+{
+    if (InterlockedExchange( (LONG *)&shm->lock, 0 ) & COMPLETION_SHM_LOCK_WAITERS)
+        futex_wake_shared( &shm->lock, 1 );
+}
+
+/* queue a packet in the shared ring; must be called with signals blocked */
+static BOOL push_completion_shm( struct completion_shm *shm, ULONG_PTR key, ULONG_PTR value,
+                                 NTSTATUS status, SIZE_T count )
+{
+    struct completion_shm_packet *packet;
+    BOOL ret = FALSE;
+
+    completion_shm_lock( shm );
+    /* packets queued in the server must be delivered first; the server moves the
+     * ring to its queue under the lock before queuing anything itself */
+    if (!shm->server_depth && shm->tail - shm->head < COMPLETION_SHM_PACKETS)
+    {
+        packet = &shm->packets[shm->tail % COMPLETION_SHM_PACKETS];
+        packet->ckey        = key;
+        packet->cvalue      = value;
+        packet->information = count;
+        packet->status      = status;
+        shm->tail++;
+        ret = TRUE;
+    }
+    completion_shm_unlock( shm );
+
+    if (ret)
+    {
+        InterlockedIncrement( (LONG *)&shm->seq );
+        if (shm->waiters) futex_wake_shared( &shm->seq, 1 );
+    }
+    return ret;
+}
+
+/* dequeue up to count packets from the shared ring; must be called with signals blocked */
+static ULONG pop_completion_shm( struct completion_shm *shm, FILE_IO_COMPLETION_INFORMATION *info, ULONG count )
+{
+    struct completion_shm_packet *packet;
+    ULONG i = 0;
+
+    if (shm->head == shm->tail) return 0;
+
+    completion_shm_lock( shm );
+    while (i < count && shm->head != shm->tail)
+    {
+        packet = &shm->packets[shm->head++ % COMPLETION_SHM_PACKETS];
+        info[i].CompletionKey             = packet->ckey;
+        info[i].CompletionValue           = packet->cvalue;
+        info[i].IoStatusBlock.Information = packet->information;
+        info[i].IoStatusBlock.u.Status    = packet->status;
+        i++;
+    }
+    completion_shm_unlock( shm );
+    return i;
+}
+
+/* post a packet through the shared ring */
+static BOOL completion_shm_server_waiters( struct completion_shm *shm )
+{
+    return InterlockedCompareExchange( (LONG *)&shm->server_waiters, 0, 0 ) ||
+           InterlockedCompareExchange( (LONG *)&shm->object_waiters, 0, 0 );
+}
+
+static BOOL set_completion_shm( HANDLE handle, ULONG_PTR key, ULONG_PTR value, NTSTATUS status, SIZE_T count )
+{
+    struct completion_mapping *map;
+    sigset_t sigset;
+    BOOL ret = FALSE;
+
+    pthread_sigmask( SIG_BLOCK, &server_block_set, &sigset );
+    if ((map = get_completion_mapping( handle )))
+    {
+        /* threads in alertable waits and waits on the port object itself are woken by the server */
+        if (!completion_shm_server_waiters( map->shm ) &&
+            (ret = push_completion_shm( map->shm, key, value, status, count )))
+        {
+            /* a thread may have started waiting in the server in the meantime, let the
+             * server take over the ring so that it can wake it up */
+            if (completion_shm_server_waiters( map->shm ))
+            {
+                SERVER_START_REQ( flush_completion_shm )
+                {
+                    req->handle = wine_server_obj_handle( handle );
+                    wine_server_call( req );
+                }
+                SERVER_END_REQ;
+            }
+        }
+        release_completion_mapping( map );
+    }
+    pthread_sigmask( SIG_SETMASK, &sigset, NULL );
+    return ret;
+}
+
+/* remove packets, waiting on the shared memory futex; returns STATUS_NOT_SUPPORTED
+ * if the wait has to be done on the server object */
+static NTSTATUS remove_completion_shm( HANDLE handle, FILE_IO_COMPLETION_INFORMATION *info, ULONG count,
+                                       ULONG *written, const LARGE_INTEGER *timeout )
+{
+    struct completion_mapping *map;
+    struct completion_shm *shm;
+    struct timespec timespec;
+    LARGE_INTEGER remaining;
+    ULONGLONG end = 0;
+    NTSTATUS status = STATUS_SUCCESS;
+    sigset_t sigset;
+    int seq, ret;
+
+    *written = 0;
+    pthread_sigmask( SIG_BLOCK, &server_block_set, &sigset );
+    map = get_completion_mapping( handle );
+    pthread_sigmask( SIG_SETMASK, &sigset, NULL );
+    if (!map) return STATUS_NOT_SUPPORTED;
+    shm = map->shm;
+
+    if (timeout && timeout->QuadPart < 0) end = monotonic_counter() - timeout->QuadPart;
+
+    for (;;)
+    {
+        if (map->closed)
+        {
+            status = STATUS_NOT_SUPPORTED;
+            break;
+        }
+        seq = shm->seq;
+        /* the ring only receives packets while the server queue is empty, so the packets
+         * queued in the server are older */
+        if (shm->server_depth)
+        {
+            status = remove_server_completions( handle, info, count, written );
+            if (status == STATUS_PENDING || *written) status = STATUS_SUCCESS;
+            if (status) break;
+        }
+        if (*written < count)
+        {
+            pthread_sigmask( SIG_BLOCK, &server_block_set, &sigset );
+            *written += pop_completion_shm( shm, info + *written, count - *written );
+            pthread_sigmask( SIG_SETMASK, &sigset, NULL );
+        }
+        if (*written) break;
+        if (timeout && !timeout->QuadPart)
+        {
+            status = STATUS_TIMEOUT;
+            break;
+        }
+
+        if (timeout)
+        {
+            if (timeout->QuadPart < 0)
+            {
+                ULONGLONG now = monotonic_counter();
+                remaining.QuadPart = now < end ? now - end : 0;
+                timespec_from_timeout( &timespec, &remaining );
+            }
+            else timespec_from_timeout( &timespec, timeout );
+            if (timespec.tv_sec < 0 || (!timespec.tv_sec && timespec.tv_nsec <= 0))
+            {
+                status = STATUS_TIMEOUT;
+                break;
+            }
+        }
+        InterlockedIncrement( (LONG *)&shm->waiters );
+        ret = futex_wait_shared( &shm->seq, seq, timeout ? &timespec : NULL );
+        InterlockedDecrement( (LONG *)&shm->waiters );
+        if (ret == -1 && errno == ETIMEDOUT && !map->closed)
+        {
+            status = STATUS_TIMEOUT;
+            break;
+        }
+    }
+
+    release_completion_mapping( map );
+    return status;
+}
+
+/* register a thread waiting on the server object, and dequeue the packets that were
+ * queued in the shared ring before it was registered */
+static struct completion_mapping *begin_server_completion_wait( HANDLE handle, FILE_IO_COMPLETION_INFORMATION *info,
+                                                                ULONG count, ULONG *written )
+{
+    struct completion_mapping *map;
+    sigset_t sigset;
+
+    pthread_sigmask( SIG_BLOCK, &server_block_set, &sigset );
+    if ((map = get_completion_mapping( handle )))
+    {
+        InterlockedIncrement( (LONG *)&map->shm->server_waiters );
+        *written = pop_completion_shm( map->shm, info, count );
+    }
+    pthread_sigmask( SIG_SETMASK, &sigset, NULL );
+    return map;
+}
+
+static void end_server_completion_wait( struct completion_mapping *map )
+{
+    if (!map) return;
+    InterlockedDecrement( (LONG *)&map->shm->server_waiters );
+    release_completion_mapping( map );
+}
+
+static ULONG get_completion_shm_depth( HANDLE handle )
+{
+    struct completion_mapping *map;
+    sigset_t sigset;
+    ULONG depth = 0;
+
+    pthread_sigmask( SIG_BLOCK, &server_block_set, &sigset );
+    if ((map = get_completion_mapping( handle )))
+    {
+        depth = map->shm->tail - map->shm->head;
+        release_completion_mapping( map );
+    }
+    pthread_sigmask( SIG_SETMASK, &sigset, NULL );
+    return depth;
+}
+
+#else  /* __linux__ */
+
+void completion_close_handle( HANDLE handle )
+{
+}
+
+static BOOL set_completion_shm( HANDLE handle, ULONG_PTR key, ULONG_PTR value, NTSTATUS status, SIZE_T count )
+{
+    return FALSE;
+}
+
+static NTSTATUS remove_completion_shm( HANDLE handle, FILE_IO_COMPLETION_INFORMATION *info, ULONG count,
+                                       ULONG *written, const LARGE_INTEGER *timeout )
+{
+    return STATUS_NOT_SUPPORTED;
+}
+
+static struct completion_mapping *begin_server_completion_wait( HANDLE handle, FILE_IO_COMPLETION_INFORMATION *info,
+                                                                ULONG count, ULONG *written )
+{
+    return NULL;
+}
+
+static void end_server_completion_wait( struct completion_mapping *map )
+{
+}
+
+static ULONG get_completion_shm_depth( HANDLE handle )
+{
+    return 0;
+}
+
+#endif  /* __linux__ */
+
+
 /***********************************************************************
  *             NtCreateIoCompletion (NTDLL.@)
  */
@@ -1631,6 +2064,8 @@ NTSTATUS WINAPI NtSetIoCompletion( HANDLE handle, ULONG_PTR key, ULONG_PTR value
 
     TRACE( "(%p, %lx, %lx, %x, %lx)\n", handle, key, value, status, count );
 
+    if (set_completion_shm( handle, key, value, status, count )) return STATUS_SUCCESS;
+
     SERVER_START_REQ( add_completion )
     {
         req->handle      = wine_server_obj_handle( handle );
@@ -1651,10 +2086,25 @@ NTSTATUS WINAPI NtSetIoCompletion( HANDLE handle, ULONG_PTR key, ULONG_PTR value
 NTSTATUS WINAPI NtRemoveIoCompletion( HANDLE handle, ULONG_PTR *key, ULONG_PTR *value,
                                       IO_STATUS_BLOCK *io, LARGE_INTEGER *timeout )
 {
+    FILE_IO_COMPLETION_INFORMATION info;
+    ULONG written;
     NTSTATUS status;
 
     TRACE( "(%p, %p, %p, %p, %p)\n", handle, key, value, io, timeout );
 
+    status = remove_completion_shm( handle, &info, 1, &written, timeout );
+    if (status != STATUS_NOT_SUPPORTED)
+    {
+        if (!status)
+        {
+            *key            = info.CompletionKey;
+            *value          = info.CompletionValue;
+            io->Information = info.IoStatusBlock.Information;
+            io->u.Status    = info.IoStatusBlock.u.Status;
+        }
+        return status;
+    }
+
     for (;;)
     {
         SERVER_START_REQ( remove_completion )
@@ -1682,30 +2132,28 @@ NTSTATUS WINAPI NtRemoveIoCompletion( HANDLE handle, ULONG_PTR *key, ULONG_PTR *
 NTSTATUS WINAPI NtRemoveIoCompletionEx( HANDLE handle, FILE_IO_COMPLETION_INFORMATION *info, ULONG count,
                                         ULONG *written, LARGE_INTEGER *timeout, BOOLEAN alertable )
 {
+    struct completion_mapping *map;
     NTSTATUS status;
     ULONG i = 0;
 
     TRACE( "%p %p %u %p %p %u\n", handle, info, count, written, timeout, alertable );
 
-    for (;;)
+    if (!alertable)
     {
-        while (i < count)
+        status = remove_completion_shm( handle, info, count, &i, timeout );
+        if (status != STATUS_NOT_SUPPORTED)
         {
-            SERVER_START_REQ( remove_completion )
-            {
-                req->handle = wine_server_obj_handle( handle );
-                if (!(status = wine_server_call( req )))
-                {
-                    info[i].CompletionKey             = reply->ckey;
-                    info[i].CompletionValue           = reply->cvalue;
-                    info[i].IoStatusBlock.Information = reply->information;
-                    info[i].IoStatusBlock.u.Status    = reply->status;
-                }
-            }
-            SERVER_END_REQ;
-            if (status != STATUS_SUCCESS) break;
-            ++i;
+            *written = i ? i : 1;
+            return status;
         }
+        i = 0;
+        map = NULL;
+    }
+    else map = begin_server_completion_wait( handle, info, count, &i );
+
+    for (;;)
+    {
+        status = remove_server_completions( handle, info, count, &i );
         if (i || status != STATUS_PENDING)
         {
             if (status == STATUS_PENDING) status = STATUS_SUCCESS;
@@ -1714,6 +2162,7 @@ NTSTATUS WINAPI NtRemoveIoCompletionEx( HANDLE handle, FILE_IO_COMPLETION_INFORM
         status = NtWaitForSingleObject( handle, alertable, timeout );
         if (status != WAIT_OBJECT_0) break;
     }
+    end_server_completion_wait( map );
     *written = i ? i : 1;
     return status;
 }
@@ -1745,6 +2194,7 @@ NTSTATUS WINAPI NtQueryIoCompletion( HANDLE handle, IO_COMPLETION_INFORMATION_CL
                 if (!(status = wine_server_call( req ))) *info = reply->depth;
             }
             SERVER_END_REQ;
+            if (!status) *info += get_completion_shm_depth( handle );
         }
         else status = STATUS_INFO_LENGTH_MISMATCH;
         break;
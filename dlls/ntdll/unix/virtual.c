@@ -27,10 +27,14 @@
 
 #include <assert.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <stdarg.h>
 #include <stdio.h>
 #include <signal.h>
 #include <sys/types.h>
+#ifdef HAVE_SYS_IOCTL_H
+# include <sys/ioctl.h>
+#endif
 #ifdef HAVE_SYS_SOCKET_H
 # include <sys/socket.h>
 #endif
@@ -40,6 +44,9 @@
 #ifdef HAVE_SYS_MMAN_H
 # include <sys/mman.h>
 #endif
+#ifdef HAVE_SYS_SYSCALL_H
+# include <sys/syscall.h>
+#endif
 #ifdef HAVE_SYS_SYSINFO_H
 # include <sys/sysinfo.h>
 #endif
@@ -49,6 +56,9 @@
 #ifdef HAVE_VALGRIND_VALGRIND_H
 # include <valgrind/valgrind.h>
 #endif
+#ifdef HAVE_LINUX_USERFAULTFD_H
+# include <linux/userfaultfd.h>
+#endif
 #if defined(__APPLE__)
 # include <mach/mach_init.h>
 # include <mach/mach_vm.h>
@@ -103,6 +113,7 @@ struct file_view
 #define VPROT_WRITEWATCH 0x40
 /* per-mapping protection flags */
 #define VPROT_SYSTEM     0x0200  /* system view (underlying mmap not under our control) */
+#define VPROT_UFFD_WATCH 0x0400  /* write watches tracked by userfaultfd instead of write faults */
 
 /* Conversion from VPROT_* to Win32 flags */
 static const BYTE VIRTUAL_Win32Flags[16] =
@@ -1583,13 +1594,269 @@ static void update_write_watches( void *base, size_t size, size_t accessed_size
 }
 
 
+/***********************************************************************
+ *                  userfaultfd write watch support                    *
+ *
+ * With asynchronous userfaultfd write protection, the kernel resolves the
+ * first write to a protected page by itself and records it in the page
+ * table. The written pages are then collected with the PAGEMAP_SCAN ioctl,
+ * so dirtying a page doesn't cost a signal and two mprotect calls.
+ */
+
+#if defined(HAVE_LINUX_USERFAULTFD_H) && defined(__NR_userfaultfd) && defined(UFFDIO_WRITEPROTECT)
+
+#ifndef UFFD_USER_MODE_ONLY
+#define UFFD_USER_MODE_ONLY 1
+#endif
+#ifndef UFFD_FEATURE_WP_UNPOPULATED
+#define UFFD_FEATURE_WP_UNPOPULATED (1 << 13)
+#endif
+#ifndef UFFD_FEATURE_WP_ASYNC
+#define UFFD_FEATURE_WP_ASYNC (1 << 15)
+#endif
+
+#ifndef PAGEMAP_SCAN
+#define PAGE_IS_WRITTEN       (1 << 1)
+#define PM_SCAN_WP_MATCHING   (1 << 0)
+#define PM_SCAN_CHECK_WPASYNC (1 << 1)
+
+struct page_region
+{
+    __u64 start;
+    __u64 end;
+    __u64 categories;
+};
+
+struct pm_scan_arg
+{
+    __u64 size;
+    __u64 flags;
+    __u64 start;
+    __u64 end;
+    __u64 walk_end;
+    __u64 vec;
+    __u64 vec_len;
+    __u64 max_pages;
+    __u64 category_inverted;
+    __u64 category_mask;
+    __u64 category_anyof_mask;
+    __u64 return_mask;
+};
+
+#define PAGEMAP_SCAN _IOWR('f', 16, struct pm_scan_arg)
+#endif
+
+static int uffd_fd = -1;
+static int pagemap_fd = -1;
+
+/***********************************************************************
+ *           init_uffd_write_watches
+ */
+static void init_uffd_write_watches(void)
+{
+    const __u64 features = UFFD_FEATURE_WP_ASYNC | UFFD_FEATURE_WP_UNPOPULATED;
+    struct uffdio_api api;
+    struct pm_scan_arg arg;
+    int fd;
+
+    if ((fd = syscall( __NR_userfaultfd, O_CLOEXEC | O_NONBLOCK | UFFD_USER_MODE_ONLY )) == -1)
+    {
+        TRACE( "userfaultfd not available (%s), using write faults for write watches\n", strerror( errno ));
+        return;
+    }
+
+    api.api = UFFD_API;
+    api.features = features;
+    api.ioctls = 0;
+    if (ioctl( fd, UFFDIO_API, &api ) == -1 || (api.features & features) != features)
+    {
+        TRACE( "asynchronous write protection not supported\n" );
+        close( fd );
+        return;
+    }
+
+    /* make sure the kernel can report written pages */
+    memset( &arg, 0, sizeof(arg) );
+    arg.size = sizeof(arg);
+    if ((pagemap_fd = open( "/proc/self/pagemap", O_RDONLY | O_CLOEXEC )) == -1 ||
+        ioctl( pagemap_fd, PAGEMAP_SCAN, &arg ) == -1)
+    {
+        TRACE( "PAGEMAP_SCAN not supported\n" );
+        if (pagemap_fd != -1) close( pagemap_fd );
+        pagemap_fd = -1;
+        close( fd );
+        return;
+    }
+
+    TRACE( "using userfaultfd for write watches\n" );
+    uffd_fd = fd;
+}
+
+
+/***********************************************************************
+ *           uffd_protect_range
+ *
+ * Register a range for write protection tracking and protect all its pages.
+ */
+static BOOL uffd_protect_range( void *base, size_t size )
+{
+    struct uffdio_register reg;
+    struct uffdio_writeprotect wp;
+
+    reg.range.start = (UINT_PTR)base;
+    reg.range.len = size;
+    reg.mode = UFFDIO_REGISTER_MODE_WP;
+    if (ioctl( uffd_fd, UFFDIO_REGISTER, &reg ) == -1)
+    {
+        WARN( "failed to register %p-%p: %s\n", base, (char *)base + size, strerror( errno ));
+        return FALSE;
+    }
+    wp.range = reg.range;
+    wp.mode = UFFDIO_WRITEPROTECT_MODE_WP;
+    if (ioctl( uffd_fd, UFFDIO_WRITEPROTECT, &wp ) == -1)
+    {
+        WARN( "failed to protect %p-%p: %s\n", base, (char *)base + size, strerror( errno ));
+        ioctl( uffd_fd, UFFDIO_UNREGISTER, &reg.range );
+        return FALSE;
+    }
+    return TRUE;
+}
+
+
+/***********************************************************************
+ *           uffd_reset_write_watches
+ */
+static void uffd_reset_write_watches( void *base, size_t size )
+{
+    struct uffdio_writeprotect wp;
+
+    wp.range.start = (UINT_PTR)base;
+    wp.range.len = size;
+    wp.mode = UFFDIO_WRITEPROTECT_MODE_WP;
+    if (ioctl( uffd_fd, UFFDIO_WRITEPROTECT, &wp ) == -1)
+        ERR( "failed to protect %p-%p: %s\n", base, (char *)base + size, strerror( errno ));
+}
+
+
+/***********************************************************************
+ *           uffd_get_write_watches
+ *
+ * Retrieve up to count written pages, optionally protecting them again.
+ */
+static ULONG_PTR uffd_get_write_watches( void *base, size_t size, void **addresses,
+                                         ULONG_PTR count, BOOL reset )
+{
+    struct page_region regions[256];
+    struct pm_scan_arg arg;
+    ULONG_PTR pos = 0;
+    UINT_PTR addr;
+    int i, ret;
+
+    memset( &arg, 0, sizeof(arg) );
+    arg.size = sizeof(arg);
+    if (reset) arg.flags = PM_SCAN_CHECK_WPASYNC | PM_SCAN_WP_MATCHING;
+    arg.start = (UINT_PTR)base;
+    arg.end = arg.start + size;
+    arg.vec = (UINT_PTR)regions;
+    arg.vec_len = ARRAY_SIZE(regions);
+    arg.category_mask = PAGE_IS_WRITTEN;
+    arg.return_mask = PAGE_IS_WRITTEN;
+
+    while (pos < count && arg.start < arg.end)
+    {
+        arg.max_pages = count - pos;
+        if ((ret = ioctl( pagemap_fd, PAGEMAP_SCAN, &arg )) == -1)
+        {
+            if (errno == EINTR) continue;
+            ERR( "failed to scan %p-%p: %s\n", base, (char *)base + size, strerror( errno ));
+            break;
+        }
+        for (i = 0; i < ret; i++)
+            for (addr = regions[i].start; addr < regions[i].end && pos < count; addr += page_size)
+                addresses[pos++] = (void *)addr;
+        arg.start = arg.walk_end;
+    }
+    return pos;
+}
+
+#else  /* HAVE_LINUX_USERFAULTFD_H */
+
+static const int uffd_fd = -1;
+
+static void init_uffd_write_watches(void)
+{
+}
+
+static BOOL uffd_protect_range( void *base, size_t size )
+{
+    return FALSE;
+}
+
+static void uffd_reset_write_watches( void *base, size_t size )
+{
+}
+
+static ULONG_PTR uffd_get_write_watches( void *base, size_t size, void **addresses,
+                                         ULONG_PTR count, BOOL reset )
+{
+    return 0;
+}
+
+#endif  /* HAVE_LINUX_USERFAULTFD_H */
+
+
+/***********************************************************************
+ *           enable_uffd_write_watches
+ *
+ * Switch a newly created write watch view to userfaultfd tracking if possible.
+ */
+static void enable_uffd_write_watches( struct file_view *view )
+{
+    if (uffd_fd == -1 || !uffd_protect_range( view->base, view->size )) return;
+    view->protect |= VPROT_UFFD_WATCH;
+    set_page_vprot_bits( view->base, view->size, 0, VPROT_WRITEWATCH );
+    mprotect_range( view->base, view->size, 0, 0 );
+}
+
+
+/***********************************************************************
+ *           disable_uffd_write_watches
+ *
+ * Switch a view back to tracking write watches with write faults.
+ */
+static void disable_uffd_write_watches( struct file_view *view )
+{
+    void *written[256];
+    char *addr = view->base, *end = addr + view->size;
+    ULONG_PTR i, count;
+
+    TRACE( "%p-%p\n", view->base, end );
+
+    set_page_vprot_bits( view->base, view->size, VPROT_WRITEWATCH, 0 );
+    do
+    {
+        count = uffd_get_write_watches( addr, end - addr, written, ARRAY_SIZE(written), FALSE );
+        for (i = 0; i < count; i++) set_page_vprot_bits( written[i], page_size, 0, VPROT_WRITEWATCH );
+        if (count) addr = (char *)written[count - 1] + page_size;
+    } while (count == ARRAY_SIZE(written));
+
+    view->protect &= ~VPROT_UFFD_WATCH;
+    mprotect_range( view->base, view->size, 0, 0 );
+}
+
+
 /***********************************************************************
  *           reset_write_watches
  *
  * Reset write watches in a memory range.
  */
-static void reset_write_watches( void *base, SIZE_T size )
+static void reset_write_watches( struct file_view *view, void *base, SIZE_T size )
 {
+    if (view->protect & VPROT_UFFD_WATCH)
+    {
+        uffd_reset_write_watches( base, size );
+        return;
+    }
     set_page_vprot_bits( base, size, VPROT_WRITEWATCH, 0 );
     mprotect_range( base, size, 0, 0 );
 }
@@ -1896,9 +2163,19 @@ static SIZE_T get_committed_size( struct file_view *view, void *base, BYTE *vpro
  */
 static NTSTATUS decommit_pages( struct file_view *view, size_t start, size_t size )
 {
+    void *written;
+
+    /* the written state of userfaultfd write watches is lost with the pages */
+    if ((view->protect & VPROT_UFFD_WATCH) &&
+        uffd_get_write_watches( (char *)view->base + start, size, &written, 1, FALSE ))
+        disable_uffd_write_watches( view );
+
     if (anon_mmap_fixed( (char *)view->base + start, size, PROT_NONE, 0 ) != MAP_FAILED)
     {
         set_page_vprot_bits( (char *)view->base + start, size, 0, VPROT_COMMITTED );
+        /* the new mapping needs to be registered again */
+        if ((view->protect & VPROT_UFFD_WATCH) && !uffd_protect_range( (char *)view->base + start, size ))
+            disable_uffd_write_watches( view );
         return STATUS_SUCCESS;
     }
     return STATUS_NO_MEMORY;
@@ -1997,10 +2274,11 @@ static NTSTATUS map_pe_header( void *ptr, size_t size, int fd, BOOL *removable )
  *           map_image_into_view
  *
  * Map an executable (PE format) image into an existing view.
+ * If reloc_fd is valid, it contains the image already laid out and relocated for this view.
  * virtual_mutex must be held by caller.
  */
-static NTSTATUS map_image_into_view( struct file_view *view, int fd, void *orig_base,
-                                     SIZE_T header_size, ULONG image_flags, int shared_fd, BOOL removable )
+static NTSTATUS map_image_into_view( struct file_view *view, int fd, void *orig_base, SIZE_T header_size,
+                                     ULONG image_flags, int shared_fd, int reloc_fd, BOOL removable )
 {
     IMAGE_DOS_HEADER *dos;
     IMAGE_NT_HEADERS *nt;
@@ -2014,6 +2292,7 @@ static NTSTATUS map_image_into_view( struct file_view *view, int fd, void *orig_
     char *header_end, *header_start;
     char *ptr = view->base;
     SIZE_T total_size = view->size;
+    BOOL relocated = FALSE;
 
     TRACE_(module)( "mapped PE file at %p-%p\n", ptr, ptr + total_size );
 
@@ -2067,9 +2346,19 @@ static NTSTATUS map_image_into_view( struct file_view *view, int fd, void *orig_
     }
 
 
+    /* map the relocated image shared with other processes, this replaces the header too */
+
+    if (reloc_fd != -1 &&
+        map_file_into_view( view, reloc_fd, 0, total_size, 0, VPROT_COMMITTED | VPROT_READ | VPROT_WRITECOPY,
+                            FALSE ) == STATUS_SUCCESS)
+    {
+        TRACE_(module)( "mapped relocated image at %p\n", ptr );
+        relocated = TRUE;
+    }
+
     /* map all the sections */
 
-    for (i = pos = 0; i < nt->FileHeader.NumberOfSections; i++, sec++)
+    for (i = pos = 0; !relocated && i < nt->FileHeader.NumberOfSections; i++, sec++)
     {
         static const SIZE_T sector_align = 0x1ff;
         SIZE_T map_size, file_start, file_size, end;
@@ -2208,9 +2497,10 @@ static NTSTATUS virtual_map_section( HANDLE handle, PVOID *addr_ptr, unsigned sh
     void *base;
     int unix_handle = -1, needs_close;
     int shared_fd = -1, shared_needs_close = 0;
+    int reloc_fd = -1, reloc_needs_close = 0;
     unsigned int vprot, sec_flags;
     struct file_view *view;
-    HANDLE shared_file;
+    HANDLE shared_file, reloc_file = 0;
     LARGE_INTEGER offset;
     sigset_t sigset;
 
@@ -2281,8 +2571,24 @@ static NTSTATUS virtual_map_section( HANDLE handle, PVOID *addr_ptr, unsigned sh
         if (res) res = map_view( &view, NULL, size, alloc_type & MEM_TOP_DOWN, vprot, zero_bits_64 );
         if (res) goto done;
 
+        /* the server keeps relocated copies of images that can't be loaded at their base,
+         * so that all the processes loading them at the same address share the pages */
+        if (view->base != base && !shared_file)
+        {
+            SERVER_START_REQ( get_relocated_image )
+            {
+                req->mapping = wine_server_obj_handle( handle );
+                req->base    = wine_server_client_ptr( view->base );
+                if (!wine_server_call( req )) reloc_file = wine_server_ptr_handle( reply->file );
+            }
+            SERVER_END_REQ;
+            if (reloc_file && server_get_unix_fd( reloc_file, FILE_READ_DATA, &reloc_fd,
+                                                  &reloc_needs_close, NULL, NULL ))
+                reloc_fd = -1;
+        }
+
         res = map_image_into_view( view, unix_handle, base, image_info->header_size,
-                                   image_info->image_flags, shared_fd, needs_close );
+                                   image_info->image_flags, shared_fd, reloc_fd, needs_close );
     }
     else
     {
@@ -2348,6 +2654,8 @@ done:
     if (needs_close) close( unix_handle );
     if (shared_needs_close) close( shared_fd );
     if (shared_file) NtClose( shared_file );
+    if (reloc_needs_close) close( reloc_fd );
+    if (reloc_file) NtClose( reloc_file );
     return res;
 }
 
@@ -2433,6 +2741,8 @@ void virtual_init(void)
     size = (char *)address_space_start - (char *)0x10000;
     if (size && mmap_is_in_reserved_area( (void*)0x10000, size ) == 1)
         anon_mmap_fixed( (void *)0x10000, size, PROT_READ | PROT_WRITE, 0 );
+
+    init_uffd_write_watches();
 }
 
 
@@ -3422,7 +3732,11 @@ NTSTATUS WINAPI NtAllocateVirtualMemory( HANDLE process, PVOID *ret, ULONG_PTR z
             else if (is_dos_memory) status = allocate_dos_memory( &view, vprot );
             else status = map_view( &view, base, size, type & MEM_TOP_DOWN, vprot, zero_bits_64 );
 
-            if (status == STATUS_SUCCESS) base = view->base;
+            if (status == STATUS_SUCCESS)
+            {
+                if (vprot & VPROT_WRITEWATCH) enable_uffd_write_watches( view );
+                base = view->base;
+            }
         }
     }
     else if (type & MEM_RESET)
@@ -3837,8 +4151,9 @@ static NTSTATUS get_working_set_ex( HANDLE process, LPCVOID addr,
         {
             p->VirtualAttributes.Valid = !(vprot & VPROT_GUARD) && (vprot & 0x0f) && (pagemap >> 63);
             p->VirtualAttributes.Shared = !is_view_valloc( view ) && ((pagemap >> 61) & 1);
+            /* bit 56 is set if the page is only mapped once; FIXME: the exact count isn't available */
             if (p->VirtualAttributes.Shared && p->VirtualAttributes.Valid)
-                p->VirtualAttributes.ShareCount = 1; /* FIXME */
+                p->VirtualAttributes.ShareCount = ((pagemap >> 56) & 1) ? 1 : 2;
             if (p->VirtualAttributes.Valid)
                 p->VirtualAttributes.Win32Protection = get_win32_prot( vprot, view->protect );
         }
@@ -4229,6 +4544,7 @@ NTSTATUS WINAPI NtFlushVirtualMemory( HANDLE process, LPCVOID *addr_ptr,
 NTSTATUS WINAPI NtGetWriteWatch( HANDLE process, ULONG flags, PVOID base, SIZE_T size, PVOID *addresses,
                                  ULONG_PTR *count, ULONG *granularity )
 {
+    struct file_view *view;
     NTSTATUS status = STATUS_SUCCESS;
     sigset_t sigset;
 
@@ -4246,18 +4562,23 @@ NTSTATUS WINAPI NtGetWriteWatch( HANDLE process, ULONG flags, PVOID base, SIZE_T
 
     server_enter_uninterrupted_section( &virtual_mutex, &sigset );
 
-    if (is_write_watch_range( base, size ))
+    if ((view = find_view( base, size )) && (view->protect & VPROT_WRITEWATCH))
     {
         ULONG_PTR pos = 0;
         char *addr = base;
         char *end = addr + size;
 
-        while (pos < *count && addr < end)
+        if (view->protect & VPROT_UFFD_WATCH)
+            pos = uffd_get_write_watches( base, size, addresses, *count, flags & WRITE_WATCH_FLAG_RESET );
+        else
         {
-            if (!(get_page_vprot( addr ) & VPROT_WRITEWATCH)) addresses[pos++] = addr;
-            addr += page_size;
+            while (pos < *count && addr < end)
+            {
+                if (!(get_page_vprot( addr ) & VPROT_WRITEWATCH)) addresses[pos++] = addr;
+                addr += page_size;
+            }
+            if (flags & WRITE_WATCH_FLAG_RESET) reset_write_watches( view, base, addr - (char *)base );
         }
-        if (flags & WRITE_WATCH_FLAG_RESET) reset_write_watches( base, addr - (char *)base );
         *count = pos;
         *granularity = page_size;
     }
@@ -4274,6 +4595,7 @@ NTSTATUS WINAPI NtGetWriteWatch( HANDLE process, ULONG flags, PVOID base, SIZE_T
  */
 NTSTATUS WINAPI NtResetWriteWatch( HANDLE process, PVOID base, SIZE_T size )
 {
+    struct file_view *view;
     NTSTATUS status = STATUS_SUCCESS;
     sigset_t sigset;
 
@@ -4286,8 +4608,8 @@ NTSTATUS WINAPI NtResetWriteWatch( HANDLE process, PVOID base, SIZE_T size )
 
     server_enter_uninterrupted_section( &virtual_mutex, &sigset );
 
-    if (is_write_watch_range( base, size ))
-        reset_write_watches( base, size );
+    if ((view = find_view( base, size )) && (view->protect & VPROT_WRITEWATCH))
+        reset_write_watches( view, base, size );
     else
         status = STATUS_INVALID_PARAMETER;
 
@@ -877,6 +877,57 @@ static void test_QueryWorkingSetEx(void)
     check_QueryWorkingSetEx(addr, "valloc,free", FALSE, 0, 0, FALSE);
 }
 
+static DWORD get_share_count(void *addr)
+{
+    PSAPI_WORKING_SET_EX_INFORMATION info;
+    BOOL ret;
+
+    memset(&info, 0, sizeof(info));
+    info.VirtualAddress = addr;
+    ret = pQueryWorkingSetEx(GetCurrentProcess(), &info, sizeof(info));
+    ok(ret, "QueryWorkingSetEx failed with %d\n", GetLastError());
+    ok(info.VirtualAttributes.Valid, "page %p is not valid\n", addr);
+    ok(info.VirtualAttributes.Shared, "page %p is not shared\n", addr);
+    return info.VirtualAttributes.ShareCount;
+}
+
+static void test_QueryWorkingSetEx_ShareCount(void)
+{
+    HANDLE mapping;
+    char *view1, *view2;
+    DWORD count;
+
+    if (pQueryWorkingSetEx == NULL)
+    {
+        win_skip("QueryWorkingSetEx not found, skipping tests\n");
+        return;
+    }
+
+    mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, 0, 0x1000, NULL);
+    ok(mapping != NULL, "CreateFileMapping failed with %d\n", GetLastError());
+    view1 = MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, 0x1000);
+    ok(view1 != NULL, "MapViewOfFile failed with %d\n", GetLastError());
+
+    *(volatile char *)view1 = 0x42;
+    count = get_share_count(view1);
+    ok(count == 1, "single view: expected ShareCount 1 but got %u\n", count);
+
+    view2 = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0x1000);
+    ok(view2 != NULL, "MapViewOfFile failed with %d\n", GetLastError());
+    ok(*(volatile char *)view2 == 0x42, "got %#x\n", *view2);
+    count = get_share_count(view1);
+    ok(count >= 2, "first of two views: expected ShareCount >= 2 but got %u\n", count);
+    count = get_share_count(view2);
+    ok(count >= 2, "second of two views: expected ShareCount >= 2 but got %u\n", count);
+
+    UnmapViewOfFile(view2);
+    count = get_share_count(view1);
+    ok(count == 1, "view unmapped: expected ShareCount 1 but got %u\n", count);
+
+    UnmapViewOfFile(view1);
+    CloseHandle(mapping);
+}
+
 START_TEST(psapi_main)
 {
     DWORD pid = GetCurrentProcessId();
@@ -905,6 +956,7 @@ START_TEST(psapi_main)
     test_GetModuleFileNameEx();
     test_GetModuleBaseName();
     test_QueryWorkingSetEx();
+    test_QueryWorkingSetEx_ShareCount();
     test_ws_functions();
 
     CloseHandle(hpSR);
@@ -22,6 +22,7 @@
  */
 
 #include <stdarg.h>
+#include <string.h>
 #include <assert.h>
 
 #include "windef.h"
@@ -42,6 +43,19 @@ static HMODULE vcomp_module;
 static int     vcomp_max_threads;
 static int     vcomp_num_threads;
 static BOOL    vcomp_nested_fork = FALSE;
+static unsigned int vcomp_spin_count;
+
+enum vcomp_proc_bind
+{
+    VCOMP_PROC_BIND_FALSE,
+    VCOMP_PROC_BIND_MASTER,
+    VCOMP_PROC_BIND_CLOSE,
+    VCOMP_PROC_BIND_SPREAD,
+};
+
+static enum vcomp_proc_bind vcomp_proc_bind = VCOMP_PROC_BIND_FALSE;
+static DWORD_PTR    vcomp_places[sizeof(DWORD_PTR) * 8];
+static int          vcomp_num_places;
 
 static RTL_CRITICAL_SECTION vcomp_section;
 static RTL_CRITICAL_SECTION_DEBUG critsect_debug =
@@ -57,6 +71,10 @@ static RTL_CRITICAL_SECTION vcomp_section = { &critsect_debug, -1, 0, 0, 0, 0 };
 #define VCOMP_DYNAMIC_FLAGS_GUIDED      0x03
 #define VCOMP_DYNAMIC_FLAGS_INCREMENT   0x40
 
+/* busy-wait iterations before blocking, depending on OMP_WAIT_POLICY */
+#define VCOMP_SPIN_COUNT_DEFAULT        20000
+#define VCOMP_SPIN_COUNT_ACTIVE         2000000
+
 struct vcomp_thread_data
 {
     struct vcomp_team_data  *team;
@@ -68,6 +86,8 @@ struct vcomp_thread_data
     /* only used for concurrent tasks */
     struct list             entry;
     CONDITION_VARIABLE      cond;
+    int                     place;
+    int                     bound_place;
 
     /* single */
     unsigned int            single;
@@ -86,7 +106,8 @@ struct vcomp_team_data
 {
     CONDITION_VARIABLE      cond;
     int                     num_threads;
-    int                     finished_threads;
+    LONG                    finished_threads;
+    BOOL                    waiting;
 
     /* callback arguments */
     int                     nargs;
@@ -94,8 +115,9 @@ struct vcomp_team_data
     __ms_va_list            valist;
 
     /* barrier */
-    unsigned int            barrier;
-    int                     barrier_count;
+    LONG                    barrier;
+    LONG                    barrier_count;
+    LONG                    barrier_waiters;
 };
 
 struct vcomp_task_data
@@ -115,6 +137,7 @@ struct vcomp_task_data
     unsigned int            dynamic_iterations;
     int                     dynamic_step;
     unsigned int            dynamic_chunksize;
+    LONG64                  dynamic_state;  /* loop number in the high dword, iterations handed out in the low one */
 };
 
 #if defined(__i386__)
@@ -366,6 +389,30 @@ static short interlocked_xchg_add16(short *dest, short incr)
 
 #endif  /* __GNUC__ */
 
+static inline void small_pause(void)
+{
+#if defined(__i386__) || defined(__x86_64__)
+    __asm__ __volatile__( "rep;nop" : : : "memory" );
+#elif defined(__aarch64__)
+    __asm__ __volatile__( "yield" : : : "memory" );
+#else
+    __asm__ __volatile__( "" : : : "memory" );
+#endif
+}
+
+/* busy-wait for a while until *ptr == val, returns FALSE if the caller has to block */
+static BOOL vcomp_spin_until(LONG *ptr, LONG val)
+{
+    unsigned int i;
+
+    for (i = 0; i < vcomp_spin_count; i++)
+    {
+        if (*(volatile LONG *)ptr == val) return TRUE;
+        small_pause();
+    }
+    return *(volatile LONG *)ptr == val;
+}
+
 static inline struct vcomp_thread_data *vcomp_get_thread_data(void)
 {
     return (struct vcomp_thread_data *)TlsGetValue(vcomp_context_tls);
@@ -395,6 +442,7 @@ static struct vcomp_thread_data *vcomp_init_thread_data(void)
     data->task.single           = 0;
     data->task.section          = 0;
     data->task.dynamic          = 0;
+    data->task.dynamic_state    = 0;
 
     thread_data = &data->thread;
     thread_data->team           = NULL;
@@ -406,6 +454,8 @@ static struct vcomp_thread_data *vcomp_init_thread_data(void)
     thread_data->section        = 1;
     thread_data->dynamic        = 1;
     thread_data->dynamic_type   = 0;
+    thread_data->place          = -1;
+    thread_data->bound_place    = -1;
 
     vcomp_set_thread_data(thread_data);
     return thread_data;
@@ -1041,25 +1091,36 @@ void CDECL _vcomp_flush(void)
 void CDECL _vcomp_barrier(void)
 {
     struct vcomp_team_data *team_data = vcomp_init_thread_data()->team;
+    LONG barrier;
 
     TRACE("()\n");
 
     if (!team_data)
         return;
 
-    EnterCriticalSection(&vcomp_section);
-    if (++team_data->barrier_count >= team_data->num_threads)
+    /* the barrier can't complete before we arrive */
+    barrier = team_data->barrier;
+    if (InterlockedIncrement(&team_data->barrier_count) >= team_data->num_threads)
     {
-        team_data->barrier++;
         team_data->barrier_count = 0;
-        WakeAllConditionVariable(&team_data->cond);
-    }
-    else
-    {
-        unsigned int barrier = team_data->barrier;
-        while (team_data->barrier == barrier)
-            SleepConditionVariableCS(&team_data->cond, &vcomp_section, INFINITE);
+        InterlockedIncrement(&team_data->barrier);
+        if (team_data->barrier_waiters)
+        {
+            EnterCriticalSection(&vcomp_section);
+            WakeAllConditionVariable(&team_data->cond);
+            LeaveCriticalSection(&vcomp_section);
+        }
+        return;
     }
+
+    if (vcomp_spin_until(&team_data->barrier, barrier + 1))
+        return;
+
+    EnterCriticalSection(&vcomp_section);
+    InterlockedIncrement(&team_data->barrier_waiters);
+    while (team_data->barrier == barrier)
+        SleepConditionVariableCS(&team_data->cond, &vcomp_section, INFINITE);
+    InterlockedDecrement(&team_data->barrier_waiters);
     LeaveCriticalSection(&vcomp_section);
 }
 
@@ -1331,6 +1392,13 @@ void CDECL _vcomp_for_dynamic_init(unsigned int flags, unsigned int first, unsig
         thread_data->dynamic_type = type;
         if ((int)(thread_data->dynamic - task_data->dynamic) > 0)
         {
+            LONG64 state;
+
+            /* update the state first, so that threads still in the previous
+             * loop fail to claim iterations with the new parameters */
+            do state = task_data->dynamic_state;
+            while (InterlockedCompareExchange64(&task_data->dynamic_state,
+                                                (LONG64)thread_data->dynamic << 32, state) != state);
             task_data->dynamic              = thread_data->dynamic;
             task_data->dynamic_first        = first;
             task_data->dynamic_last         = last;
@@ -1361,26 +1429,40 @@ int CDECL _vcomp_for_dynamic_next(unsigned int *begin, unsigned int *end)
     else if (thread_data->dynamic_type == VCOMP_DYNAMIC_FLAGS_CHUNKED ||
              thread_data->dynamic_type == VCOMP_DYNAMIC_FLAGS_GUIDED)
     {
-        unsigned int iterations = 0;
-        EnterCriticalSection(&vcomp_section);
-        if (thread_data->dynamic == task_data->dynamic &&
-            task_data->dynamic_iterations != 0)
+        unsigned int iterations, done, remaining, first, last;
+        int step;
+        LONG64 state;
+
+        for (;;)
         {
-            iterations = min(task_data->dynamic_iterations, task_data->dynamic_chunksize);
+            state = InterlockedCompareExchange64(&task_data->dynamic_state, 0, 0);
+            if ((unsigned int)(state >> 32) != thread_data->dynamic)
+                return 0;
+
+            done      = (unsigned int)state;
+            remaining = task_data->dynamic_iterations - done;
+            if (!remaining)
+                return 0;
+
+            iterations = min(remaining, task_data->dynamic_chunksize);
             if (thread_data->dynamic_type == VCOMP_DYNAMIC_FLAGS_GUIDED &&
-                task_data->dynamic_iterations > num_threads * task_data->dynamic_chunksize)
+                remaining > num_threads * task_data->dynamic_chunksize)
             {
-                iterations = (task_data->dynamic_iterations + num_threads - 1) / num_threads;
+                iterations = (remaining + num_threads - 1) / num_threads;
             }
-            *begin = task_data->dynamic_first;
-            *end   = task_data->dynamic_first + (iterations - 1) * task_data->dynamic_step;
-            task_data->dynamic_iterations -= iterations;
-            task_data->dynamic_first      += iterations * task_data->dynamic_step;
-            if (!task_data->dynamic_iterations)
-                *end = task_data->dynamic_last;
+            first = task_data->dynamic_first;
+            last  = task_data->dynamic_last;
+            step  = task_data->dynamic_step;
+
+            if (InterlockedCompareExchange64(&task_data->dynamic_state, state + iterations, state) == state)
+                break;
         }
-        LeaveCriticalSection(&vcomp_section);
-        return iterations != 0;
+
+        *begin = first + done * step;
+        *end   = *begin + (iterations - 1) * step;
+        if (iterations == remaining)
+            *end = last;
+        return 1;
     }
 
     return 0;
@@ -1392,6 +1474,33 @@ int CDECL omp_in_parallel(void)
     return vcomp_init_thread_data()->parallel;
 }
 
+static void vcomp_bind_thread(struct vcomp_thread_data *thread_data)
+{
+    if (thread_data->place == -1 || thread_data->place == thread_data->bound_place)
+        return;
+
+    SetThreadAffinityMask(GetCurrentThread(), vcomp_places[thread_data->place]);
+    thread_data->bound_place = thread_data->place;
+}
+
+static int vcomp_get_place(int thread_num, int num_threads)
+{
+    if (!vcomp_num_places)
+        return -1;
+
+    switch (vcomp_proc_bind)
+    {
+        case VCOMP_PROC_BIND_MASTER:
+            return 0;
+        case VCOMP_PROC_BIND_CLOSE:
+            return thread_num % vcomp_num_places;
+        case VCOMP_PROC_BIND_SPREAD:
+            return (int)((LONG64)thread_num * vcomp_num_places / num_threads) % vcomp_num_places;
+        default:
+            return -1;
+    }
+}
+
 static DWORD WINAPI _vcomp_fork_worker(void *param)
 {
     struct vcomp_thread_data *thread_data = param;
@@ -1405,15 +1514,29 @@ static DWORD WINAPI _vcomp_fork_worker(void *param)
         struct vcomp_team_data *team = thread_data->team;
         if (team != NULL)
         {
+            unsigned int i;
+
             LeaveCriticalSection(&vcomp_section);
+            vcomp_bind_thread(thread_data);
             _vcomp_fork_call_wrapper(team->wrapper, team->nargs, team->valist);
             EnterCriticalSection(&vcomp_section);
 
             thread_data->team = NULL;
             list_remove(&thread_data->entry);
             list_add_tail(&vcomp_idle_threads, &thread_data->entry);
-            if (++team->finished_threads >= team->num_threads)
+            if (InterlockedIncrement(&team->finished_threads) >= team->num_threads && team->waiting)
                 WakeAllConditionVariable(&team->cond);
+            LeaveCriticalSection(&vcomp_section);
+
+            /* parallel regions are often forked back to back, wait a bit for the next one */
+            for (i = 0; i < vcomp_spin_count; i++)
+            {
+                if (*(struct vcomp_team_data * volatile *)&thread_data->team) break;
+                small_pause();
+            }
+
+            EnterCriticalSection(&vcomp_section);
+            if (thread_data->team) continue;
         }
 
         if (!SleepConditionVariableCS(&thread_data->cond, &vcomp_section, 5000) &&
@@ -1456,15 +1579,18 @@ void WINAPIV _vcomp_fork(BOOL ifval, int nargs, void *wrapper, ...)
     InitializeConditionVariable(&team_data.cond);
     team_data.num_threads       = 1;
     team_data.finished_threads  = 0;
+    team_data.waiting           = FALSE;
     team_data.nargs             = nargs;
     team_data.wrapper           = wrapper;
     __ms_va_start(team_data.valist, wrapper);
     team_data.barrier           = 0;
     team_data.barrier_count     = 0;
+    team_data.barrier_waiters   = 0;
 
     task_data.single            = 0;
     task_data.section           = 0;
     task_data.dynamic           = 0;
+    task_data.dynamic_state     = 0;
 
     thread_data.team            = &team_data;
     thread_data.task            = &task_data;
@@ -1477,6 +1603,8 @@ void WINAPIV _vcomp_fork(BOOL ifval, int nargs, void *wrapper, ...)
     thread_data.dynamic_type    = 0;
     list_init(&thread_data.entry);
     InitializeConditionVariable(&thread_data.cond);
+    thread_data.place           = -1;
+    thread_data.bound_place     = -1;
 
     if (num_threads > 1)
     {
@@ -1496,6 +1624,7 @@ void WINAPIV _vcomp_fork(BOOL ifval, int nargs, void *wrapper, ...)
             data->section       = 1;
             data->dynamic       = 1;
             data->dynamic_type  = 0;
+            data->place         = vcomp_get_place(data->thread_num, num_threads);
             list_remove(&data->entry);
             list_add_tail(&thread_data.entry, &data->entry);
             WakeAllConditionVariable(&data->cond);
@@ -1520,6 +1649,8 @@ void WINAPIV _vcomp_fork(BOOL ifval, int nargs, void *wrapper, ...)
             data->section       = 1;
             data->dynamic       = 1;
             data->dynamic_type  = 0;
+            data->place         = vcomp_get_place(data->thread_num, num_threads);
+            data->bound_place   = -1;
             InitializeConditionVariable(&data->cond);
 
             thread = CreateThread(NULL, 0, _vcomp_fork_worker, data, 0, NULL);
@@ -1546,9 +1677,13 @@ void WINAPIV _vcomp_fork(BOOL ifval, int nargs, void *wrapper, ...)
 
     if (team_data.num_threads > 1)
     {
+        InterlockedIncrement(&team_data.finished_threads);
+        vcomp_spin_until(&team_data.finished_threads, team_data.num_threads);
+
+        /* the last worker may still hold the lock and look at team_data */
         EnterCriticalSection(&vcomp_section);
 
-        team_data.finished_threads++;
+        team_data.waiting = TRUE;
         while (team_data.finished_threads < team_data.num_threads)
             SleepConditionVariableCS(&team_data.cond, &vcomp_section, INFINITE);
 
@@ -1660,6 +1795,150 @@ void CDECL _vcomp_leave_critsect(CRITICAL_SECTION *critsect)
     LeaveCriticalSection(critsect);
 }
 
+static BOOL parse_uint(const char **str, unsigned int *ret)
+{
+    const char *p = *str;
+
+    if (*p < '0' || *p > '9') return FALSE;
+    for (*ret = 0; *p >= '0' && *p <= '9'; p++)
+        *ret = *ret * 10 + *p - '0';
+    *str = p;
+    return TRUE;
+}
+
+static void add_place(DWORD_PTR mask)
+{
+    if (mask && vcomp_num_places < ARRAY_SIZE(vcomp_places))
+        vcomp_places[vcomp_num_places++] = mask;
+}
+
+/* explicit place lists like "{0,1},{2:2},{4:2:2}" */
+static BOOL parse_place_list(const char *str, DWORD_PTR process_mask)
+{
+    while (*str)
+    {
+        DWORD_PTR mask = 0;
+
+        if (*str++ != '{') return FALSE;
+        for (;;)
+        {
+            unsigned int first, len = 1, stride = 1;
+
+            if (!parse_uint(&str, &first)) return FALSE;
+            if (*str == ':')
+            {
+                str++;
+                if (!parse_uint(&str, &len)) return FALSE;
+                if (*str == ':')
+                {
+                    str++;
+                    if (!parse_uint(&str, &stride)) return FALSE;
+                }
+            }
+            for (; len; len--, first += stride)
+                if (first < sizeof(mask) * 8) mask |= (DWORD_PTR)1 << first;
+
+            if (*str == '}') break;
+            if (*str++ != ',') return FALSE;
+        }
+        str++;
+        add_place(mask & process_mask);
+        if (*str == ',') str++;
+    }
+    return TRUE;
+}
+
+static BOOL init_abstract_places(LOGICAL_PROCESSOR_RELATIONSHIP relation, unsigned int count,
+                                 DWORD_PTR process_mask)
+{
+    SYSTEM_LOGICAL_PROCESSOR_INFORMATION *info;
+    DWORD i, size = 0;
+
+    GetLogicalProcessorInformation(NULL, &size);
+    if (!(info = HeapAlloc(GetProcessHeap(), 0, size))) return FALSE;
+    if (!GetLogicalProcessorInformation(info, &size))
+    {
+        HeapFree(GetProcessHeap(), 0, info);
+        return FALSE;
+    }
+
+    for (i = 0; i < size / sizeof(*info) && vcomp_num_places < count; i++)
+        if (info[i].Relationship == relation) add_place(info[i].ProcessorMask & process_mask);
+
+    HeapFree(GetProcessHeap(), 0, info);
+    return vcomp_num_places != 0;
+}
+
+static void init_places(const char *places)
+{
+    DWORD_PTR process_mask, system_mask;
+    unsigned int count = ~0u;
+    const char *p;
+    int i;
+
+    if (!GetProcessAffinityMask(GetCurrentProcess(), &process_mask, &system_mask))
+        return;
+
+    if ((p = strchr(places, '(')))
+    {
+        p++;
+        if (!parse_uint(&p, &count) || *p != ')') count = ~0u;
+    }
+
+    if (!strncmp(places, "cores", 5))
+    {
+        if (init_abstract_places(RelationProcessorCore, count, process_mask)) return;
+    }
+    else if (!strncmp(places, "sockets", 7))
+    {
+        if (init_abstract_places(RelationProcessorPackage, count, process_mask)) return;
+    }
+    else if (*places && strncmp(places, "threads", 7))
+    {
+        if (parse_place_list(places, process_mask) && vcomp_num_places) return;
+        WARN("unsupported OMP_PLACES %s\n", debugstr_a(places));
+    }
+
+    /* one place per logical processor */
+    vcomp_num_places = 0;
+    for (i = 0; i < sizeof(process_mask) * 8 && vcomp_num_places < count; i++)
+        if (process_mask & ((DWORD_PTR)1 << i)) add_place((DWORD_PTR)1 << i);
+}
+
+static void vcomp_init_env(DWORD num_procs)
+{
+    char buffer[256], places[256], *p, *q;
+    BOOL have_places;
+
+    vcomp_spin_count = num_procs > 1 ? VCOMP_SPIN_COUNT_DEFAULT : 0;
+    if (GetEnvironmentVariableA("OMP_WAIT_POLICY", buffer, sizeof(buffer)) - 1 < sizeof(buffer) - 1)
+    {
+        if (!lstrcmpiA(buffer, "ACTIVE")) vcomp_spin_count = VCOMP_SPIN_COUNT_ACTIVE;
+        else if (!lstrcmpiA(buffer, "PASSIVE")) vcomp_spin_count = 0;
+    }
+
+    /* whitespace and case don't matter in OMP_PLACES */
+    have_places = GetEnvironmentVariableA("OMP_PLACES", buffer, sizeof(buffer)) - 1 < sizeof(buffer) - 1;
+    for (p = buffer, q = places; have_places && *p; p++)
+        if (*p != ' ' && *p != '\t') *q++ = (*p >= 'A' && *p <= 'Z') ? *p + 'a' - 'A' : *p;
+    *q = 0;
+
+    if (GetEnvironmentVariableA("OMP_PROC_BIND", buffer, sizeof(buffer)) - 1 < sizeof(buffer) - 1)
+    {
+        /* only the outermost level of a list is used */
+        if ((p = strchr(buffer, ','))) *p = 0;
+        if (!lstrcmpiA(buffer, "master")) vcomp_proc_bind = VCOMP_PROC_BIND_MASTER;
+        else if (!lstrcmpiA(buffer, "close") || !lstrcmpiA(buffer, "true")) vcomp_proc_bind = VCOMP_PROC_BIND_CLOSE;
+        else if (!lstrcmpiA(buffer, "spread")) vcomp_proc_bind = VCOMP_PROC_BIND_SPREAD;
+        else if (lstrcmpiA(buffer, "false")) WARN("unsupported OMP_PROC_BIND %s\n", debugstr_a(buffer));
+    }
+    else if (have_places)
+        vcomp_proc_bind = VCOMP_PROC_BIND_CLOSE;
+
+    if (vcomp_proc_bind != VCOMP_PROC_BIND_FALSE)
+        init_places(places);
+}
+
 BOOL WINAPI DllMain(HINSTANCE instance, DWORD reason, LPVOID reserved)
 {
     TRACE("(%p, %d, %p)\n", instance, reason, reserved);
@@ -1680,6 +1959,7 @@ BOOL WINAPI DllMain(HINSTANCE instance, DWORD reason, LPVOID reserved)
             vcomp_module      = instance;
             vcomp_max_threads = sysinfo.dwNumberOfProcessors;
             vcomp_num_threads = sysinfo.dwNumberOfProcessors;
+            vcomp_init_env(sysinfo.dwNumberOfProcessors);
             break;
         }
 
@@ -1315,6 +1315,74 @@ static void test_vcomp_for_dynamic_init(void)
     pomp_set_num_threads(max_threads);
 }
 
+static void CDECL barrier_cb(LONG *count, LONG *errors)
+{
+    int num_threads = pomp_get_num_threads();
+    int i;
+
+    for (i = 0; i < 1000; i++)
+    {
+        InterlockedIncrement(count);
+        p_vcomp_barrier();
+        if (*count != num_threads * (i + 1))
+            InterlockedIncrement(errors);
+        p_vcomp_barrier();
+    }
+}
+
+static void CDECL empty_cb(void)
+{
+}
+
+static void CDECL barrier_loop_cb(int count)
+{
+    while (count--) p_vcomp_barrier();
+}
+
+static void test_vcomp_barrier(void)
+{
+    static const int count = 10000;
+    int max_threads = pomp_get_max_threads();
+    LARGE_INTEGER freq, start, end;
+    double fork_time, barrier_time;
+    LONG counter, errors;
+    int i, j;
+
+    for (i = 1; i <= 4; i++)
+    {
+        pomp_set_num_threads(i);
+        counter = errors = 0;
+        p_vcomp_fork(TRUE, 2, barrier_cb, &counter, &errors);
+        ok(counter == i * 1000, "expected counter == %d, got %d\n", i * 1000, counter);
+        ok(!errors, "got %d errors\n", errors);
+    }
+
+    if (winetest_interactive)
+    {
+        /* fork/join and barrier latency */
+        QueryPerformanceFrequency(&freq);
+        for (i = 1; i <= max_threads; i++)
+        {
+            pomp_set_num_threads(i);
+
+            QueryPerformanceCounter(&start);
+            for (j = 0; j < count; j++)
+                p_vcomp_fork(TRUE, 0, empty_cb);
+            QueryPerformanceCounter(&end);
+            fork_time = (end.QuadPart - start.QuadPart) * 1e6 / freq.QuadPart / count;
+
+            QueryPerformanceCounter(&start);
+            p_vcomp_fork(TRUE, 1, barrier_loop_cb, count);
+            QueryPerformanceCounter(&end);
+            barrier_time = (end.QuadPart - start.QuadPart) * 1e6 / freq.QuadPart / count;
+
+            trace("%d threads: fork/join %.2f us, barrier %.2f us\n", i, fork_time, barrier_time);
+        }
+    }
+
+    pomp_set_num_threads(max_threads);
+}
+
 static void CDECL master_cb(HANDLE semaphore)
 {
     int num_threads = pomp_get_num_threads();
@@ -2221,6 +2289,7 @@ START_TEST(vcomp)
     test_vcomp_for_static_simple_init();
     test_vcomp_for_static_init();
     test_vcomp_for_dynamic_init();
+    test_vcomp_barrier();
     test_vcomp_master_begin();
     test_vcomp_single_begin();
     test_vcomp_enter_critsect();
@@ -693,6 +693,10 @@ ULONG CDECL wined3d_buffer_decref(struct wined3d_buffer *buffer)
 
     if (!refcount)
     {
+        /* Let the upload chunk of a streamed map that was never unmapped be
+         * recycled. */
+        if (buffer->upload_map_count)
+            --buffer->upload_chunk->map_count;
         buffer->resource.parent_ops->wined3d_object_destroyed(buffer->resource.parent);
         buffer->resource.device->adapter->adapter_ops->adapter_destroy_buffer(buffer);
     }
@@ -1036,6 +1040,62 @@ void wined3d_buffer_upload_data(struct wined3d_buffer *buffer, struct wined3d_co
     buffer->buffer_ops->buffer_upload_ranges(buffer, context, data, range.offset, 1, &range);
 }
 
+/* Context activation is done by the caller. The flags are those of the map
+ * the data was written with; WINED3D_MAP_NOOVERWRITE lets the update proceed
+ * while the GPU is still using the buffer, and WINED3D_MAP_DISCARD allows the
+ * buffer storage to be renamed. */
+void wined3d_buffer_update_data(struct wined3d_buffer *buffer, struct wined3d_context *context,
+        unsigned int offset, unsigned int size, const void *data, uint32_t flags)
+{
+    struct wined3d_bo_address addr;
+    struct wined3d_range range;
+    DWORD location;
+    BYTE *map_ptr;
+
+    TRACE("buffer %p, context %p, offset %u, size %u, data %p, flags %#x.\n",
+            buffer, context, offset, size, data, flags);
+
+    /* Replacing the entire buffer doesn't require loading its contents. */
+    if (!offset && size == buffer->resource.size)
+        wined3d_buffer_validate_location(buffer, WINED3D_LOCATION_DISCARDED);
+    else
+        flags &= ~WINED3D_MAP_DISCARD;
+
+    /* Converted buffers are uploaded from system memory. */
+    if (buffer->flags & WINED3D_BUFFER_USE_BO && !buffer->conversion_map)
+        location = WINED3D_LOCATION_BUFFER;
+    else
+        location = WINED3D_LOCATION_SYSMEM;
+
+    if (!wined3d_buffer_load_location(buffer, context, location))
+    {
+        ERR("Failed to load buffer location %s.\n", wined3d_debug_location(location));
+        return;
+    }
+
+    if (location == WINED3D_LOCATION_SYSMEM)
+    {
+        memcpy((BYTE *)buffer->resource.heap_memory + offset, data, size);
+    }
+    else
+    {
+        addr.buffer_object = buffer->buffer_object;
+        addr.addr = NULL;
+        if (!(map_ptr = wined3d_context_map_bo_address(context, &addr, buffer->resource.size,
+                WINED3D_MAP_WRITE | (flags & (WINED3D_MAP_DISCARD | WINED3D_MAP_NOOVERWRITE)))))
+        {
+            ERR("Failed to map buffer.\n");
+            return;
+        }
+        memcpy(map_ptr + offset, data, size);
+        range.offset = offset;
+        range.size = size;
+        wined3d_context_unmap_bo_address(context, &addr, 1, &range);
+    }
+
+    wined3d_buffer_invalidate_range(buffer, ~location, offset, size);
+}
+
 static void wined3d_buffer_init_data(struct wined3d_buffer *buffer,
         struct wined3d_device *device, const struct wined3d_sub_resource_data *data)
 {
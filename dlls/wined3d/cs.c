@@ -21,8 +21,10 @@
 #include "wined3d_private.h"
 
 WINE_DEFAULT_DEBUG_CHANNEL(d3d);
+WINE_DECLARE_DEBUG_CHANNEL(d3d_profile);
 WINE_DECLARE_DEBUG_CHANNEL(d3d_sync);
 WINE_DECLARE_DEBUG_CHANNEL(fps);
+WINE_DECLARE_DEBUG_CHANNEL(winediag);
 
 #define WINED3D_INITIAL_CS_SIZE 4096
 
@@ -72,10 +74,12 @@ enum wined3d_cs_op
     WINED3D_CS_OP_UNMAP,
     WINED3D_CS_OP_BLT_SUB_RESOURCE,
     WINED3D_CS_OP_UPDATE_SUB_RESOURCE,
+    WINED3D_CS_OP_UPLOAD_BUFFER,
     WINED3D_CS_OP_ADD_DIRTY_TEXTURE_REGION,
     WINED3D_CS_OP_CLEAR_UNORDERED_ACCESS_VIEW,
     WINED3D_CS_OP_COPY_UAV_COUNTER,
     WINED3D_CS_OP_GENERATE_MIPMAPS,
+    WINED3D_CS_OP_EXECUTE_COMMAND_LIST,
     WINED3D_CS_OP_STOP,
 };
 
@@ -106,7 +110,7 @@ struct wined3d_cs_clear
     enum wined3d_cs_op opcode;
     DWORD flags;
     unsigned int rt_count;
-    struct wined3d_fb_state *fb;
+    struct wined3d_fb_state fb;
     RECT draw_rect;
     struct wined3d_color color;
     float depth;
@@ -421,6 +425,16 @@ struct wined3d_cs_update_sub_resource
     struct wined3d_sub_resource_data data;
 };
 
+struct wined3d_cs_upload_buffer
+{
+    enum wined3d_cs_op opcode;
+    struct wined3d_buffer *buffer;
+    unsigned int offset, size;
+    const BYTE *data;
+    uint32_t flags;
+    LONG fence;
+};
+
 struct wined3d_cs_add_dirty_texture_region
 {
     enum wined3d_cs_op opcode;
@@ -449,11 +463,63 @@ struct wined3d_cs_generate_mipmaps
     struct wined3d_shader_resource_view *view;
 };
 
+struct wined3d_cs_execute_command_list
+{
+    enum wined3d_cs_op opcode;
+    struct wined3d_command_list *list;
+};
+
 struct wined3d_cs_stop
 {
     enum wined3d_cs_op opcode;
 };
 
+struct wined3d_cs_object_reference
+{
+    enum wined3d_cs_object_type type;
+    void *object;
+};
+
+/* Data uploaded through a deferred context. Blocks are shared between the
+ * context and the command lists referencing them, since a buffer mapped with
+ * WINED3D_MAP_NOOVERWRITE keeps writing to the block of the previous map. */
+struct wined3d_deferred_upload
+{
+    LONG refcount;
+    size_t size;
+    BYTE data[1];
+};
+
+/* A query issued on a deferred context. The packets only issue it on the
+ * command stream, the application side part is done when the list is executed. */
+struct wined3d_deferred_query
+{
+    struct wined3d_query *query;
+    DWORD flags;
+};
+
+struct wined3d_command_list
+{
+    LONG refcount;
+    struct wined3d_device *device;
+
+    SIZE_T data_size;
+    void *data;
+
+    /* The state at the end of the list. Only the d3d10+ bindings compared by
+     * wined3d_cs_emit_state_transition() are valid. */
+    struct wined3d_state *state;
+
+    SIZE_T resource_count;
+    struct wined3d_resource **resources;
+    SIZE_T reference_count;
+    struct wined3d_cs_object_reference *references;
+    SIZE_T upload_count;
+    struct wined3d_deferred_upload **uploads;
+    SIZE_T query_count;
+    struct wined3d_deferred_query *queries;
+};
+
 static inline void *wined3d_cs_require_space(struct wined3d_cs *cs,
         size_t size, enum wined3d_cs_queue_id queue_id)
 {
@@ -465,6 +531,34 @@ static inline void wined3d_cs_submit(struct wined3d_cs *cs, enum wined3d_cs_queu
     cs->ops->submit(cs, queue_id);
 }
 
+static inline void wined3d_cs_acquire_resource(struct wined3d_cs *cs, struct wined3d_resource *resource)
+{
+    cs->ops->acquire_resource(cs, resource);
+}
+
+/* Writes that don't go through the upload ring make the contents of the
+ * current upload block stale. */
+static void wined3d_cs_invalidate_upload_buffer(struct wined3d_resource *resource)
+{
+    struct wined3d_buffer *buffer;
+
+    if (resource->type != WINED3D_RTYPE_BUFFER)
+        return;
+
+    buffer = buffer_from_resource(resource);
+    if (!buffer->upload_map_count)
+        buffer->upload_chunk = NULL;
+}
+
+/* Objects referenced by packets need to outlive any command list recording
+ * them; for the immediate context this is a no-op. */
+static inline void wined3d_cs_reference_object(struct wined3d_cs *cs,
+        enum wined3d_cs_object_type type, void *object)
+{
+    if (object)
+        cs->ops->reference_object(cs, type, object);
+}
+
 static const char *debug_cs_op(enum wined3d_cs_op op)
 {
     switch (op)
@@ -514,16 +608,293 @@ static const char *debug_cs_op(enum wined3d_cs_op op)
         WINED3D_TO_STR(WINED3D_CS_OP_UNMAP);
         WINED3D_TO_STR(WINED3D_CS_OP_BLT_SUB_RESOURCE);
         WINED3D_TO_STR(WINED3D_CS_OP_UPDATE_SUB_RESOURCE);
+        WINED3D_TO_STR(WINED3D_CS_OP_UPLOAD_BUFFER);
         WINED3D_TO_STR(WINED3D_CS_OP_ADD_DIRTY_TEXTURE_REGION);
         WINED3D_TO_STR(WINED3D_CS_OP_CLEAR_UNORDERED_ACCESS_VIEW);
         WINED3D_TO_STR(WINED3D_CS_OP_COPY_UAV_COUNTER);
         WINED3D_TO_STR(WINED3D_CS_OP_GENERATE_MIPMAPS);
+        WINED3D_TO_STR(WINED3D_CS_OP_EXECUTE_COMMAND_LIST);
         WINED3D_TO_STR(WINED3D_CS_OP_STOP);
 #undef WINED3D_TO_STR
     }
     return wine_dbg_sprintf("UNKNOWN_OP(%#x)", op);
 }
 
+/* Command stream profiling. This is enabled by the "d3d_profile" debug
+ * channel, which prints a summary every few seconds, or by the
+ * "CSProfileTrace" setting, which writes Chrome trace events to a file. Only
+ * the multithreaded command stream is profiled.
+ *
+ * All times are CPU times. They show whether the application thread is
+ * waiting for the CS thread or the CS thread for the application, but GPU
+ * execution time is not measured; time the driver spends waiting for the GPU
+ * is accounted to the op that waited, typically PRESENT. */
+
+#define WINED3D_CS_PROFILE_BUCKET_COUNT         16
+#define WINED3D_CS_PROFILE_SUMMARY_INTERVAL     2000
+#define WINED3D_CS_PROFILE_TRACE_BUFFER_SIZE    0x100000
+
+struct wined3d_cs_profile_op
+{
+    uint64_t count;
+    LONGLONG total, max;
+    /* Execution times in microseconds; bucket i counts [2^(i-1), 2^i). */
+    uint64_t histogram[WINED3D_CS_PROFILE_BUCKET_COUNT];
+};
+
+/* Counters updated by the application thread, under the wined3d lock. These
+ * only ever increase; the summary reports the difference with the values
+ * seen at the previous summary. */
+struct wined3d_cs_profile_producer
+{
+    LONGLONG submitted_packets;
+    LONGLONG submitted_bytes;
+    LONGLONG stall_count, stall_time;
+    LONGLONG finish_count, finish_time;
+};
+
+struct wined3d_cs_profile
+{
+    LONGLONG frequency;
+    LONGLONG start_time;
+    BOOL summary;
+
+    /* CS thread. */
+    struct wined3d_cs_profile_op ops[WINED3D_CS_OP_STOP];
+    LONGLONG interval_start;
+    LONGLONG busy_time, idle_time, wait_time;
+    size_t max_occupancy;
+    unsigned int frame_count;
+    struct wined3d_cs_profile_producer prev_producer;
+
+    /* Application thread. */
+    struct wined3d_cs_profile_producer producer;
+
+    CRITICAL_SECTION trace_cs;
+    HANDLE trace_file;
+    DWORD pid;
+    size_t trace_size;
+    /* One extra byte for terminating the event array. */
+    char trace_buffer[WINED3D_CS_PROFILE_TRACE_BUFFER_SIZE + 1];
+};
+
+static inline LONGLONG wined3d_cs_profile_time(void)
+{
+    LARGE_INTEGER counter;
+
+    QueryPerformanceCounter(&counter);
+    return counter.QuadPart;
+}
+
+static double wined3d_cs_profile_us(const struct wined3d_cs_profile *profile, LONGLONG ticks)
+{
+    return ticks * 1000000.0 / profile->frequency;
+}
+
+static void wined3d_cs_profile_flush_trace(struct wined3d_cs_profile *profile)
+{
+    DWORD written;
+
+    if (profile->trace_size && !WriteFile(profile->trace_file, profile->trace_buffer,
+            profile->trace_size, &written, NULL))
+        ERR("Failed to write trace events, error %u.\n", GetLastError());
+    profile->trace_size = 0;
+}
+
+static void wined3d_cs_profile_trace_event(struct wined3d_cs_profile *profile,
+        const char *name, char phase, LONGLONG start, LONGLONG end, size_t value)
+{
+    char event[256];
+    int len;
+
+    if (!profile->trace_file)
+        return;
+
+    if (phase == 'X')
+        len = snprintf(event, sizeof(event),
+                "{\"name\":\"%s\",\"ph\":\"X\",\"pid\":%u,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f},\n",
+                name, profile->pid, GetCurrentThreadId(), wined3d_cs_profile_us(profile, start - profile->start_time),
+                wined3d_cs_profile_us(profile, end - start));
+    else if (phase == 'C')
+        len = snprintf(event, sizeof(event),
+                "{\"name\":\"%s\",\"ph\":\"C\",\"pid\":%u,\"ts\":%.3f,\"args\":{\"bytes\":%lu}},\n",
+                name, profile->pid, wined3d_cs_profile_us(profile, start - profile->start_time),
+                (unsigned long)value);
+    else
+        len = snprintf(event, sizeof(event),
+                "{\"name\":\"%s\",\"ph\":\"i\",\"s\":\"p\",\"pid\":%u,\"tid\":%u,\"ts\":%.3f},\n",
+                name, profile->pid, GetCurrentThreadId(), wined3d_cs_profile_us(profile, start - profile->start_time));
+    if (len < 0 || len >= sizeof(event))
+        return;
+
+    EnterCriticalSection(&profile->trace_cs);
+    if (profile->trace_size + len > WINED3D_CS_PROFILE_TRACE_BUFFER_SIZE)
+        wined3d_cs_profile_flush_trace(profile);
+    memcpy(&profile->trace_buffer[profile->trace_size], event, len);
+    profile->trace_size += len;
+    LeaveCriticalSection(&profile->trace_cs);
+}
+
+static const char *wined3d_cs_profile_op_name(enum wined3d_cs_op op)
+{
+    return debug_cs_op(op) + strlen("WINED3D_CS_OP_");
+}
+
+static void wined3d_cs_profile_print_summary(struct wined3d_cs_profile *profile, LONGLONG now)
+{
+    struct wined3d_cs_profile_producer producer = profile->producer;
+    const struct wined3d_cs_profile_producer *prev = &profile->prev_producer;
+    unsigned int order[WINED3D_CS_OP_STOP], i, j, k, count;
+    double interval = wined3d_cs_profile_us(profile, now - profile->interval_start) / 1000.0;
+    char histogram[WINED3D_CS_PROFILE_BUCKET_COUNT * 21 + 1], *p;
+    const struct wined3d_cs_profile_op *op;
+
+    TRACE_(d3d_profile)("%u frames in %.0f ms (%.2f ms per frame).\n", profile->frame_count, interval,
+            profile->frame_count ? interval / profile->frame_count : 0.0);
+    TRACE_(d3d_profile)("CS thread: busy %.1f%%, idle %.1f%% (%.1f%% waiting on the event), "
+            "maximum queue occupancy %lu KiB.\n",
+            100.0 * wined3d_cs_profile_us(profile, profile->busy_time) / 1000.0 / interval,
+            100.0 * wined3d_cs_profile_us(profile, profile->idle_time) / 1000.0 / interval,
+            100.0 * wined3d_cs_profile_us(profile, profile->wait_time) / 1000.0 / interval,
+            (unsigned long)(profile->max_occupancy / 1024));
+    TRACE_(d3d_profile)("Application thread: %s packets, %s KiB submitted; %s stalls on a full queue (%.2f ms), "
+            "%s waits for the CS thread (%.2f ms).\n",
+            wine_dbgstr_longlong(producer.submitted_packets - prev->submitted_packets),
+            wine_dbgstr_longlong((producer.submitted_bytes - prev->submitted_bytes) / 1024),
+            wine_dbgstr_longlong(producer.stall_count - prev->stall_count),
+            wined3d_cs_profile_us(profile, producer.stall_time - prev->stall_time) / 1000.0,
+            wine_dbgstr_longlong(producer.finish_count - prev->finish_count),
+            wined3d_cs_profile_us(profile, producer.finish_time - prev->finish_time) / 1000.0);
+
+    /* Sort the ops by total execution time. */
+    for (i = 0, count = 0; i < ARRAY_SIZE(profile->ops); ++i)
+    {
+        if (!profile->ops[i].count)
+            continue;
+        for (j = count++; j && profile->ops[order[j - 1]].total < profile->ops[i].total; --j)
+            order[j] = order[j - 1];
+        order[j] = i;
+    }
+
+    for (i = 0; i < count; ++i)
+    {
+        op = &profile->ops[order[i]];
+
+        for (j = ARRAY_SIZE(op->histogram); j && !op->histogram[j - 1]; --j);
+        for (k = 0, p = histogram; k < j; ++k)
+            p += sprintf(p, " %lu", (unsigned long)op->histogram[k]);
+        *p = 0;
+
+        TRACE_(d3d_profile)("  %-28s %8lu calls, %9.3f ms total, %8.2f us avg, %8.2f us max, histogram:%s\n",
+                wined3d_cs_profile_op_name(order[i]), (unsigned long)op->count,
+                wined3d_cs_profile_us(profile, op->total) / 1000.0,
+                wined3d_cs_profile_us(profile, op->total) / op->count,
+                wined3d_cs_profile_us(profile, op->max), histogram);
+    }
+
+    memset(profile->ops, 0, sizeof(profile->ops));
+    profile->interval_start = now;
+    profile->busy_time = profile->idle_time = profile->wait_time = 0;
+    profile->max_occupancy = 0;
+    profile->frame_count = 0;
+    profile->prev_producer = producer;
+}
+
+static void wined3d_cs_profile_op(struct wined3d_cs_profile *profile,
+        enum wined3d_cs_op opcode, LONGLONG start, LONGLONG end)
+{
+    struct wined3d_cs_profile_op *op = &profile->ops[opcode];
+    LONGLONG duration = end - start;
+    unsigned int bucket, us;
+
+    ++op->count;
+    op->total += duration;
+    if (duration > op->max)
+        op->max = duration;
+    us = wined3d_cs_profile_us(profile, duration);
+    bucket = us ? wined3d_log2i(us) + 1 : 0;
+    ++op->histogram[min(bucket, WINED3D_CS_PROFILE_BUCKET_COUNT - 1)];
+    profile->busy_time += duration;
+
+    wined3d_cs_profile_trace_event(profile, wined3d_cs_profile_op_name(opcode), 'X', start, end, 0);
+
+    if (opcode != WINED3D_CS_OP_PRESENT)
+        return;
+
+    ++profile->frame_count;
+    wined3d_cs_profile_trace_event(profile, "queue", 'C', end, end, profile->max_occupancy);
+    if (profile->summary && wined3d_cs_profile_us(profile, end - profile->interval_start)
+            >= WINED3D_CS_PROFILE_SUMMARY_INTERVAL * 1000.0)
+        wined3d_cs_profile_print_summary(profile, end);
+}
+
+static struct wined3d_cs_profile *wined3d_cs_profile_create(void)
+{
+    struct wined3d_cs_profile *profile;
+    LARGE_INTEGER frequency;
+    char name[MAX_PATH];
+    BOOL summary;
+
+    if (!(summary = TRACE_ON(d3d_profile)) && !wined3d_settings.cs_profile_trace)
+        return NULL;
+
+    if (!(profile = heap_alloc_zero(sizeof(*profile))))
+        return NULL;
+
+    QueryPerformanceFrequency(&frequency);
+    profile->frequency = frequency.QuadPart;
+    profile->start_time = profile->interval_start = wined3d_cs_profile_time();
+    profile->summary = summary;
+    profile->pid = GetCurrentProcessId();
+
+    InitializeCriticalSection(&profile->trace_cs);
+    profile->trace_cs.DebugInfo->Spare[0] = (DWORD_PTR)(__FILE__ ": wined3d_cs_profile.trace_cs");
+
+    if (wined3d_settings.cs_profile_trace)
+    {
+        /* The setting is used as a prefix, so that each device of each
+         * process gets its own file. */
+        snprintf(name, sizeof(name), "%s-%u-%p.json", wined3d_settings.cs_profile_trace, profile->pid, profile);
+        if ((profile->trace_file = CreateFileA(name, GENERIC_WRITE, FILE_SHARE_READ,
+                NULL, CREATE_ALWAYS, 0, NULL)) == INVALID_HANDLE_VALUE)
+        {
+            ERR("Failed to create trace file %s, error %u.\n", debugstr_a(name), GetLastError());
+            profile->trace_file = NULL;
+        }
+        else
+        {
+            ERR_(winediag)("Writing command stream trace events to %s.\n", debugstr_a(name));
+            memcpy(profile->trace_buffer, "[\n", 2);
+            profile->trace_size = 2;
+        }
+    }
+
+    return profile;
+}
+
+static void wined3d_cs_profile_destroy(struct wined3d_cs_profile *profile)
+{
+    if (!profile)
+        return;
+
+    if (profile->summary && profile->frame_count)
+        wined3d_cs_profile_print_summary(profile, wined3d_cs_profile_time());
+
+    if (profile->trace_file)
+    {
+        /* Replace the separator after the last event to terminate the array. */
+        wined3d_cs_profile_trace_event(profile, "end", 'i', wined3d_cs_profile_time(), 0, 0);
+        memcpy(&profile->trace_buffer[profile->trace_size - 2], "\n]\n", 3);
+        ++profile->trace_size;
+        wined3d_cs_profile_flush_trace(profile);
+        CloseHandle(profile->trace_file);
+    }
+
+    profile->trace_cs.DebugInfo->Spare[0] = 0;
+    DeleteCriticalSection(&profile->trace_cs);
+    heap_free(profile);
+}
+
 static void wined3d_cs_exec_nop(struct wined3d_cs *cs, const void *data)
 {
 }
@@ -634,10 +1005,10 @@ void wined3d_cs_emit_present(struct wined3d_cs *cs, struct wined3d_swapchain *sw
 
     pending = InterlockedIncrement(&cs->pending_presents);
 
-    wined3d_resource_acquire(&swapchain->front_buffer->resource);
+    wined3d_cs_acquire_resource(cs, &swapchain->front_buffer->resource);
     for (i = 0; i < swapchain->state.desc.backbuffer_count; ++i)
     {
-        wined3d_resource_acquire(&swapchain->back_buffers[i]->resource);
+        wined3d_cs_acquire_resource(cs, &swapchain->back_buffers[i]->resource);
     }
 
     wined3d_cs_submit(cs, WINED3D_CS_QUEUE_DEFAULT);
@@ -654,29 +1025,37 @@ void wined3d_cs_emit_present(struct wined3d_cs *cs, struct wined3d_swapchain *sw
 static void wined3d_cs_exec_clear(struct wined3d_cs *cs, const void *data)
 {
     const struct wined3d_cs_clear *op = data;
+    const struct wined3d_fb_state *fb;
     struct wined3d_device *device;
     unsigned int i;
 
+    /* Clears of the bound framebuffer pass the current state, so that
+     * applying the clear doesn't invalidate it. */
+    if (memcmp(&op->fb, &cs->state.fb, sizeof(op->fb)))
+        fb = &op->fb;
+    else
+        fb = &cs->state.fb;
+
     device = cs->device;
-    device->blitter->ops->blitter_clear(device->blitter, device, op->rt_count, op->fb,
+    device->blitter->ops->blitter_clear(device->blitter, device, op->rt_count, fb,
             op->rect_count, op->rects, &op->draw_rect, op->flags, &op->color, op->depth, op->stencil);
 
     if (op->flags & WINED3DCLEAR_TARGET)
     {
         for (i = 0; i < op->rt_count; ++i)
         {
-            if (op->fb->render_targets[i])
-                wined3d_resource_release(op->fb->render_targets[i]->resource);
+            if (op->fb.render_targets[i])
+                wined3d_resource_release(op->fb.render_targets[i]->resource);
         }
     }
     if (op->flags & (WINED3DCLEAR_ZBUFFER | WINED3DCLEAR_STENCIL))
-        wined3d_resource_release(op->fb->depth_stencil->resource);
+        wined3d_resource_release(op->fb.depth_stencil->resource);
 }
 
 void wined3d_cs_emit_clear(struct wined3d_cs *cs, DWORD rect_count, const RECT *rects,
         DWORD flags, const struct wined3d_color *color, float depth, DWORD stencil)
 {
-    const struct wined3d_state *state = &cs->device->state;
+    const struct wined3d_state *state = cs->c.state;
     const struct wined3d_viewport *vp = &state->viewports[0];
     struct wined3d_rendertarget_view *view;
     struct wined3d_cs_clear *op;
@@ -689,7 +1068,7 @@ void wined3d_cs_emit_clear(struct wined3d_cs *cs, DWORD rect_count, const RECT *
     op->opcode = WINED3D_CS_OP_CLEAR;
     op->flags = flags & (WINED3DCLEAR_TARGET | WINED3DCLEAR_ZBUFFER | WINED3DCLEAR_STENCIL);
     op->rt_count = rt_count;
-    op->fb = &cs->state.fb;
+    op->fb = state->fb;
     SetRect(&op->draw_rect, vp->x, vp->y, vp->x + vp->width, vp->y + vp->height);
     if (state->rasterizer_state && state->rasterizer_state->desc.scissor)
         IntersectRect(&op->draw_rect, &op->draw_rect, &state->scissor_rects[0]);
@@ -702,12 +1081,12 @@ void wined3d_cs_emit_clear(struct wined3d_cs *cs, DWORD rect_count, const RECT *
     for (i = 0; i < rt_count; ++i)
     {
         if ((view = state->fb.render_targets[i]))
-            wined3d_resource_acquire(view->resource);
+            wined3d_cs_acquire_resource(cs, view->resource);
     }
     if (flags & (WINED3DCLEAR_ZBUFFER | WINED3DCLEAR_STENCIL))
     {
         view = state->fb.depth_stencil;
-        wined3d_resource_acquire(view->resource);
+        wined3d_cs_acquire_resource(cs, view->resource);
     }
 
     wined3d_cs_submit(cs, WINED3D_CS_QUEUE_DEFAULT);
@@ -717,26 +1096,21 @@ void wined3d_cs_emit_clear_rendertarget_view(struct wined3d_cs *cs, struct wined
         const RECT *rect, DWORD flags, const struct wined3d_color *color, float depth, DWORD stencil)
 {
     struct wined3d_cs_clear *op;
-    size_t size;
-
-    size = FIELD_OFFSET(struct wined3d_cs_clear, rects[1]) + sizeof(struct wined3d_fb_state);
-    op = wined3d_cs_require_space(cs, size, WINED3D_CS_QUEUE_DEFAULT);
-    op->fb = (void *)&op->rects[1];
 
+    op = wined3d_cs_require_space(cs, sizeof(*op), WINED3D_CS_QUEUE_DEFAULT);
     op->opcode = WINED3D_CS_OP_CLEAR;
     op->flags = flags & (WINED3DCLEAR_TARGET | WINED3DCLEAR_ZBUFFER | WINED3DCLEAR_STENCIL);
+    memset(&op->fb, 0, sizeof(op->fb));
     if (flags & WINED3DCLEAR_TARGET)
     {
         op->rt_count = 1;
-        op->fb->render_targets[0] = view;
-        op->fb->depth_stencil = NULL;
+        op->fb.render_targets[0] = view;
         op->color = *color;
     }
     else
     {
         op->rt_count = 0;
-        op->fb->render_targets[0] = NULL;
-        op->fb->depth_stencil = view;
+        op->fb.depth_stencil = view;
         op->depth = depth;
         op->stencil = stencil;
     }
@@ -744,14 +1118,16 @@ void wined3d_cs_emit_clear_rendertarget_view(struct wined3d_cs *cs, struct wined
     op->rect_count = 1;
     op->rects[0] = *rect;
 
-    wined3d_resource_acquire(view->resource);
+    wined3d_cs_reference_object(cs, WINED3D_CS_OBJECT_RENDERTARGET_VIEW, view);
+    wined3d_cs_acquire_resource(cs, view->resource);
 
     wined3d_cs_submit(cs, WINED3D_CS_QUEUE_DEFAULT);
     if (flags & WINED3DCLEAR_SYNCHRONOUS)
         wined3d_cs_finish(cs, WINED3D_CS_QUEUE_DEFAULT);
 }
 
-static void acquire_shader_resources(const struct wined3d_state *state, unsigned int shader_mask)
+static void acquire_shader_resources(struct wined3d_cs *cs,
+        const struct wined3d_state *state, unsigned int shader_mask)
 {
     struct wined3d_shader_sampler_map_entry *entry;
     struct wined3d_shader_resource_view *view;
@@ -769,7 +1145,7 @@ static void acquire_shader_resources(const struct wined3d_state *state, unsigned
         for (j = 0; j < WINED3D_MAX_CBS; ++j)
         {
             if (state->cb[i][j])
-                wined3d_resource_acquire(&state->cb[i][j]->resource);
+                wined3d_cs_acquire_resource(cs, &state->cb[i][j]->resource);
         }
 
         for (j = 0; j < shader->reg_maps.sampler_map.count; ++j)
@@ -779,7 +1155,7 @@ static void acquire_shader_resources(const struct wined3d_state *state, unsigned
             if (!(view = state->shader_resource_view[i][entry->resource_idx]))
                 continue;
 
-            wined3d_resource_acquire(view->resource);
+            wined3d_cs_acquire_resource(cs, view->resource);
         }
     }
 }
@@ -817,8 +1193,8 @@ static void release_shader_resources(const struct wined3d_state *state, unsigned
     }
 }
 
-static void acquire_unordered_access_resources(const struct wined3d_shader *shader,
-        struct wined3d_unordered_access_view * const *views)
+static void acquire_unordered_access_resources(struct wined3d_cs *cs,
+        const struct wined3d_shader *shader, struct wined3d_unordered_access_view * const *views)
 {
     unsigned int i;
 
@@ -833,7 +1209,7 @@ static void acquire_unordered_access_resources(const struct wined3d_shader *shad
         if (!views[i])
             continue;
 
-        wined3d_resource_acquire(views[i]->resource);
+        wined3d_cs_acquire_resource(cs, views[i]->resource);
     }
 }
 
@@ -875,17 +1251,17 @@ static void wined3d_cs_exec_dispatch(struct wined3d_cs *cs, const void *data)
             state->unordered_access_view[WINED3D_PIPELINE_COMPUTE]);
 }
 
-static void acquire_compute_pipeline_resources(const struct wined3d_state *state)
+static void acquire_compute_pipeline_resources(struct wined3d_cs *cs, const struct wined3d_state *state)
 {
-    acquire_shader_resources(state, 1u << WINED3D_SHADER_TYPE_COMPUTE);
-    acquire_unordered_access_resources(state->shader[WINED3D_SHADER_TYPE_COMPUTE],
+    acquire_shader_resources(cs, state, 1u << WINED3D_SHADER_TYPE_COMPUTE);
+    acquire_unordered_access_resources(cs, state->shader[WINED3D_SHADER_TYPE_COMPUTE],
             state->unordered_access_view[WINED3D_PIPELINE_COMPUTE]);
 }
 
 void wined3d_cs_emit_dispatch(struct wined3d_cs *cs,
         unsigned int group_count_x, unsigned int group_count_y, unsigned int group_count_z)
 {
-    const struct wined3d_state *state = &cs->device->state;
+    const struct wined3d_state *state = cs->c.state;
     struct wined3d_cs_dispatch *op;
 
     op = wined3d_cs_require_space(cs, sizeof(*op), WINED3D_CS_QUEUE_DEFAULT);
@@ -895,7 +1271,7 @@ void wined3d_cs_emit_dispatch(struct wined3d_cs *cs,
     op->parameters.u.direct.group_count_y = group_count_y;
     op->parameters.u.direct.group_count_z = group_count_z;
 
-    acquire_compute_pipeline_resources(state);
+    acquire_compute_pipeline_resources(cs, state);
 
     wined3d_cs_submit(cs, WINED3D_CS_QUEUE_DEFAULT);
 }
@@ -903,7 +1279,7 @@ void wined3d_cs_emit_dispatch(struct wined3d_cs *cs,
 void wined3d_cs_emit_dispatch_indirect(struct wined3d_cs *cs,
         struct wined3d_buffer *buffer, unsigned int offset)
 {
-    const struct wined3d_state *state = &cs->device->state;
+    const struct wined3d_state *state = cs->c.state;
     struct wined3d_cs_dispatch *op;
 
     op = wined3d_cs_require_space(cs, sizeof(*op), WINED3D_CS_QUEUE_DEFAULT);
@@ -912,8 +1288,8 @@ void wined3d_cs_emit_dispatch_indirect(struct wined3d_cs *cs,
     op->parameters.u.indirect.buffer = buffer;
     op->parameters.u.indirect.offset = offset;
 
-    acquire_compute_pipeline_resources(state);
-    wined3d_resource_acquire(&buffer->resource);
+    acquire_compute_pipeline_resources(cs, state);
+    wined3d_cs_acquire_resource(cs, &buffer->resource);
 
     wined3d_cs_submit(cs, WINED3D_CS_QUEUE_DEFAULT);
 }
@@ -1005,37 +1381,37 @@ static void wined3d_cs_exec_draw(struct wined3d_cs *cs, const void *data)
             state->unordered_access_view[WINED3D_PIPELINE_GRAPHICS]);
 }
 
-static void acquire_graphics_pipeline_resources(const struct wined3d_state *state,
-        BOOL indexed, const struct wined3d_d3d_info *d3d_info)
+static void acquire_graphics_pipeline_resources(struct wined3d_cs *cs,
+        const struct wined3d_state *state, BOOL indexed, const struct wined3d_d3d_info *d3d_info)
 {
     unsigned int i;
 
     if (indexed)
-        wined3d_resource_acquire(&state->index_buffer->resource);
+        wined3d_cs_acquire_resource(cs, &state->index_buffer->resource);
     for (i = 0; i < ARRAY_SIZE(state->streams); ++i)
     {
         if (state->streams[i].buffer)
-            wined3d_resource_acquire(&state->streams[i].buffer->resource);
+            wined3d_cs_acquire_resource(cs, &state->streams[i].buffer->resource);
     }
     for (i = 0; i < ARRAY_SIZE(state->stream_output); ++i)
     {
         if (state->stream_output[i].buffer)
-            wined3d_resource_acquire(&state->stream_output[i].buffer->resource);
+            wined3d_cs_acquire_resource(cs, &state->stream_output[i].buffer->resource);
     }
     for (i = 0; i < ARRAY_SIZE(state->textures); ++i)
     {
         if (state->textures[i])
-            wined3d_resource_acquire(&state->textures[i]->resource);
+            wined3d_cs_acquire_resource(cs, &state->textures[i]->resource);
     }
     for (i = 0; i < d3d_info->limits.max_rt_count; ++i)
     {
         if (state->fb.render_targets[i])
-            wined3d_resource_acquire(state->fb.render_targets[i]->resource);
+            wined3d_cs_acquire_resource(cs, state->fb.render_targets[i]->resource);
     }
     if (state->fb.depth_stencil)
-        wined3d_resource_acquire(state->fb.depth_stencil->resource);
-    acquire_shader_resources(state, ~(1u << WINED3D_SHADER_TYPE_COMPUTE));
-    acquire_unordered_access_resources(state->shader[WINED3D_SHADER_TYPE_PIXEL],
+        wined3d_cs_acquire_resource(cs, state->fb.depth_stencil->resource);
+    acquire_shader_resources(cs, state, ~(1u << WINED3D_SHADER_TYPE_COMPUTE));
+    acquire_unordered_access_resources(cs, state->shader[WINED3D_SHADER_TYPE_PIXEL],
             state->unordered_access_view[WINED3D_PIPELINE_GRAPHICS]);
 }
 
@@ -1044,7 +1420,7 @@ void wined3d_cs_emit_draw(struct wined3d_cs *cs, enum wined3d_primitive_type pri
         unsigned int index_count, unsigned int start_instance, unsigned int instance_count, bool indexed)
 {
     const struct wined3d_d3d_info *d3d_info = &cs->device->adapter->d3d_info;
-    const struct wined3d_state *state = &cs->device->state;
+    const struct wined3d_state *state = cs->c.state;
     struct wined3d_cs_draw *op;
 
     op = wined3d_cs_require_space(cs, sizeof(*op), WINED3D_CS_QUEUE_DEFAULT);
@@ -1059,7 +1435,7 @@ void wined3d_cs_emit_draw(struct wined3d_cs *cs, enum wined3d_primitive_type pri
     op->parameters.u.direct.instance_count = instance_count;
     op->parameters.indexed = indexed;
 
-    acquire_graphics_pipeline_resources(state, indexed, d3d_info);
+    acquire_graphics_pipeline_resources(cs, state, indexed, d3d_info);
 
     wined3d_cs_submit(cs, WINED3D_CS_QUEUE_DEFAULT);
 }
@@ -1068,7 +1444,7 @@ void wined3d_cs_emit_draw_indirect(struct wined3d_cs *cs, enum wined3d_primitive
         unsigned int patch_vertex_count, struct wined3d_buffer *buffer, unsigned int offset, bool indexed)
 {
     const struct wined3d_d3d_info *d3d_info = &cs->device->adapter->d3d_info;
-    const struct wined3d_state *state = &cs->device->state;
+    const struct wined3d_state *state = cs->c.state;
     struct wined3d_cs_draw *op;
 
     op = wined3d_cs_require_space(cs, sizeof(*op), WINED3D_CS_QUEUE_DEFAULT);
@@ -1080,8 +1456,8 @@ void wined3d_cs_emit_draw_indirect(struct wined3d_cs *cs, enum wined3d_primitive
     op->parameters.u.indirect.offset = offset;
     op->parameters.indexed = indexed;
 
-    acquire_graphics_pipeline_resources(state, indexed, d3d_info);
-    wined3d_resource_acquire(&buffer->resource);
+    acquire_graphics_pipeline_resources(cs, state, indexed, d3d_info);
+    wined3d_cs_acquire_resource(cs, &buffer->resource);
 
     wined3d_cs_submit(cs, WINED3D_CS_QUEUE_DEFAULT);
 }
@@ -1123,6 +1499,8 @@ void wined3d_cs_emit_set_predication(struct wined3d_cs *cs, struct wined3d_query
     op->predicate = predicate;
     op->value = value;
 
+    wined3d_cs_reference_object(cs, WINED3D_CS_OBJECT_QUERY, predicate);
+
     wined3d_cs_submit(cs, WINED3D_CS_QUEUE_DEFAULT);
 }
 
@@ -1203,6 +1581,8 @@ void wined3d_cs_emit_set_rendertarget_view(struct wined3d_cs *cs, unsigned int v
     op->view_idx = view_idx;
     op->view = view;
 
+    wined3d_cs_reference_object(cs, WINED3D_CS_OBJECT_RENDERTARGET_VIEW, view);
+
     wined3d_cs_submit(cs, WINED3D_CS_QUEUE_DEFAULT);
 }
 
@@ -1249,6 +1629,8 @@ void wined3d_cs_emit_set_depth_stencil_view(struct wined3d_cs *cs, struct wined3
     op->opcode = WINED3D_CS_OP_SET_DEPTH_STENCIL_VIEW;
     op->view = view;
 
+    wined3d_cs_reference_object(cs, WINED3D_CS_OBJECT_RENDERTARGET_VIEW, view);
+
     wined3d_cs_submit(cs, WINED3D_CS_QUEUE_DEFAULT);
 }
 
@@ -1268,6 +1650,8 @@ void wined3d_cs_emit_set_vertex_declaration(struct wined3d_cs *cs, struct wined3
     op->opcode = WINED3D_CS_OP_SET_VERTEX_DECLARATION;
     op->declaration = declaration;
 
+    wined3d_cs_reference_object(cs, WINED3D_CS_OBJECT_VERTEX_DECLARATION, declaration);
+
     wined3d_cs_submit(cs, WINED3D_CS_QUEUE_DEFAULT);
 }
 
@@ -1303,6 +1687,9 @@ void wined3d_cs_emit_set_stream_source(struct wined3d_cs *cs, UINT stream_idx,
     op->offset = offset;
     op->stride = stride;
 
+    if (buffer)
+        wined3d_cs_reference_object(cs, WINED3D_CS_OBJECT_RESOURCE, &buffer->resource);
+
     wined3d_cs_submit(cs, WINED3D_CS_QUEUE_DEFAULT);
 }
 
@@ -1361,6 +1748,9 @@ void wined3d_cs_emit_set_stream_output(struct wined3d_cs *cs, UINT stream_idx,
     op->buffer = buffer;
     op->offset = offset;
 
+    if (buffer)
+        wined3d_cs_reference_object(cs, WINED3D_CS_OBJECT_RESOURCE, &buffer->resource);
+
     wined3d_cs_submit(cs, WINED3D_CS_QUEUE_DEFAULT);
 }
 
@@ -1393,6 +1783,9 @@ void wined3d_cs_emit_set_index_buffer(struct wined3d_cs *cs, struct wined3d_buff
     op->format_id = format_id;
     op->offset = offset;
 
+    if (buffer)
+        wined3d_cs_reference_object(cs, WINED3D_CS_OBJECT_RESOURCE, &buffer->resource);
+
     wined3d_cs_submit(cs, WINED3D_CS_QUEUE_DEFAULT);
 }
 
@@ -1423,6 +1816,9 @@ void wined3d_cs_emit_set_constant_buffer(struct wined3d_cs *cs, enum wined3d_sha
     op->cb_idx = cb_idx;
     op->buffer = buffer;
 
+    if (buffer)
+        wined3d_cs_reference_object(cs, WINED3D_CS_OBJECT_RESOURCE, &buffer->resource);
+
     wined3d_cs_submit(cs, WINED3D_CS_QUEUE_DEFAULT);
 }
 
@@ -1513,6 +1909,9 @@ void wined3d_cs_emit_set_texture(struct wined3d_cs *cs, UINT stage, struct wined
     op->stage = stage;
     op->texture = texture;
 
+    if (texture)
+        wined3d_cs_reference_object(cs, WINED3D_CS_OBJECT_RESOURCE, &texture->resource);
+
     wined3d_cs_submit(cs, WINED3D_CS_QUEUE_DEFAULT);
 }
 
@@ -1546,6 +1945,8 @@ void wined3d_cs_emit_set_shader_resource_view(struct wined3d_cs *cs, enum wined3
     op->view_idx = view_idx;
     op->view = view;
 
+    wined3d_cs_reference_object(cs, WINED3D_CS_OBJECT_SHADER_RESOURCE_VIEW, view);
+
     wined3d_cs_submit(cs, WINED3D_CS_QUEUE_DEFAULT);
 }
 
@@ -1580,6 +1981,8 @@ void wined3d_cs_emit_set_unordered_access_view(struct wined3d_cs *cs, enum wined
     op->view = view;
     op->initial_count = initial_count;
 
+    wined3d_cs_reference_object(cs, WINED3D_CS_OBJECT_UNORDERED_ACCESS_VIEW, view);
+
     wined3d_cs_submit(cs, WINED3D_CS_QUEUE_DEFAULT);
 }
 
@@ -1605,6 +2008,8 @@ void wined3d_cs_emit_set_sampler(struct wined3d_cs *cs, enum wined3d_shader_type
     op->sampler_idx = sampler_idx;
     op->sampler = sampler;
 
+    wined3d_cs_reference_object(cs, WINED3D_CS_OBJECT_SAMPLER, sampler);
+
     wined3d_cs_submit(cs, WINED3D_CS_QUEUE_DEFAULT);
 }
 
@@ -1629,6 +2034,8 @@ void wined3d_cs_emit_set_shader(struct wined3d_cs *cs, enum wined3d_shader_type
     op->type = type;
     op->shader = shader;
 
+    wined3d_cs_reference_object(cs, WINED3D_CS_OBJECT_SHADER, shader);
+
     wined3d_cs_submit(cs, WINED3D_CS_QUEUE_DEFAULT);
 }
 
@@ -1659,6 +2066,8 @@ void wined3d_cs_emit_set_blend_state(struct wined3d_cs *cs, struct wined3d_blend
     op->factor = *blend_factor;
     op->sample_mask = sample_mask;
 
+    wined3d_cs_reference_object(cs, WINED3D_CS_OBJECT_BLEND_STATE, state);
+
     wined3d_cs_submit(cs, WINED3D_CS_QUEUE_DEFAULT);
 }
 
@@ -1679,6 +2088,8 @@ void wined3d_cs_emit_set_depth_stencil_state(struct wined3d_cs *cs,
     op->opcode = WINED3D_CS_OP_SET_DEPTH_STENCIL_STATE;
     op->state = state;
 
+    wined3d_cs_reference_object(cs, WINED3D_CS_OBJECT_DEPTH_STENCIL_STATE, state);
+
     wined3d_cs_submit(cs, WINED3D_CS_QUEUE_DEFAULT);
 }
 
@@ -1699,6 +2110,8 @@ void wined3d_cs_emit_set_rasterizer_state(struct wined3d_cs *cs,
     op->opcode = WINED3D_CS_OP_SET_RASTERIZER_STATE;
     op->state = rasterizer_state;
 
+    wined3d_cs_reference_object(cs, WINED3D_CS_OBJECT_RASTERIZER_STATE, rasterizer_state);
+
     wined3d_cs_submit(cs, WINED3D_CS_QUEUE_DEFAULT);
 }
 
@@ -2180,7 +2593,7 @@ void wined3d_cs_emit_preload_resource(struct wined3d_cs *cs, struct wined3d_reso
     op->opcode = WINED3D_CS_OP_PRELOAD_RESOURCE;
     op->resource = resource;
 
-    wined3d_resource_acquire(resource);
+    wined3d_cs_acquire_resource(cs, resource);
 
     wined3d_cs_submit(cs, WINED3D_CS_QUEUE_DEFAULT);
 }
@@ -2202,7 +2615,7 @@ void wined3d_cs_emit_unload_resource(struct wined3d_cs *cs, struct wined3d_resou
     op->opcode = WINED3D_CS_OP_UNLOAD_RESOURCE;
     op->resource = resource;
 
-    wined3d_resource_acquire(resource);
+    wined3d_cs_acquire_resource(cs, resource);
 
     wined3d_cs_submit(cs, WINED3D_CS_QUEUE_DEFAULT);
 }
@@ -2391,9 +2804,10 @@ void wined3d_cs_emit_blt_sub_resource(struct wined3d_cs *cs, struct wined3d_reso
         memset(&op->fx, 0, sizeof(op->fx));
     op->filter = filter;
 
-    wined3d_resource_acquire(dst_resource);
+    wined3d_cs_invalidate_upload_buffer(dst_resource);
+    wined3d_cs_acquire_resource(cs, dst_resource);
     if (src_resource)
-        wined3d_resource_acquire(src_resource);
+        wined3d_cs_acquire_resource(cs, src_resource);
 
     wined3d_cs_submit(cs, WINED3D_CS_QUEUE_DEFAULT);
     if (flags & WINED3D_BLT_SYNCHRONOUS)
@@ -2474,7 +2888,8 @@ void wined3d_cs_emit_update_sub_resource(struct wined3d_cs *cs, struct wined3d_r
     op->data.slice_pitch = slice_pitch;
     op->data.data = data;
 
-    wined3d_resource_acquire(resource);
+    wined3d_cs_invalidate_upload_buffer(resource);
+    wined3d_cs_acquire_resource(cs, resource);
 
     wined3d_cs_submit(cs, WINED3D_CS_QUEUE_MAP);
     /* The data pointer may go away, so we need to wait until it is read.
@@ -2482,6 +2897,286 @@ void wined3d_cs_emit_update_sub_resource(struct wined3d_cs *cs, struct wined3d_r
     wined3d_cs_finish(cs, WINED3D_CS_QUEUE_MAP);
 }
 
+static void wined3d_cs_exec_upload_buffer(struct wined3d_cs *cs, const void *data)
+{
+    const struct wined3d_cs_upload_buffer *op = data;
+    struct wined3d_buffer *buffer = op->buffer;
+    struct wined3d_context *context;
+
+    /* From here on, later writes to the upload block need a new upload. */
+    InterlockedExchange(&buffer->upload_pending, 0);
+
+    context = context_acquire(cs->device, NULL, 0);
+    wined3d_buffer_update_data(buffer, context, op->offset, op->size, op->data, op->flags);
+    context_release(context);
+
+    wined3d_resource_release(&buffer->resource);
+
+    /* The upload memory may be reused from here on. */
+    InterlockedExchange(&cs->upload_ring.completed_fence, op->fence);
+}
+
+static void wined3d_upload_chunk_destroy(struct wined3d_upload_ring *ring, struct wined3d_upload_chunk *chunk)
+{
+    ring->size -= chunk->size;
+    heap_free(chunk->memory);
+    heap_free(chunk);
+}
+
+static void wined3d_upload_ring_cleanup(struct wined3d_upload_ring *ring)
+{
+    struct wined3d_upload_chunk *chunk, *next;
+
+    if (ring->current)
+        list_add_tail(&ring->retired, &ring->current->entry);
+
+    LIST_FOR_EACH_ENTRY_SAFE(chunk, next, &ring->retired, struct wined3d_upload_chunk, entry)
+    {
+        wined3d_upload_chunk_destroy(ring, chunk);
+    }
+}
+
+static BOOL wined3d_upload_chunk_is_idle(const struct wined3d_upload_chunk *chunk, LONG completed_fence)
+{
+    return !chunk->map_count && (LONG)(chunk->fence - completed_fence) <= 0;
+}
+
+static struct wined3d_upload_chunk *wined3d_upload_ring_get_chunk(struct wined3d_upload_ring *ring, size_t size)
+{
+    struct wined3d_upload_chunk *chunk, *next;
+    LONG completed_fence;
+
+    completed_fence = *(volatile LONG *)&ring->completed_fence;
+    LIST_FOR_EACH_ENTRY(chunk, &ring->retired, struct wined3d_upload_chunk, entry)
+    {
+        if (chunk->size != size || !wined3d_upload_chunk_is_idle(chunk, completed_fence))
+            continue;
+
+        TRACE("Recycling upload chunk %p.\n", chunk);
+        list_remove(&chunk->entry);
+        chunk->offset = 0;
+        ++chunk->generation;
+        return chunk;
+    }
+
+    /* Make room by freeing idle chunks of other sizes. */
+    LIST_FOR_EACH_ENTRY_SAFE(chunk, next, &ring->retired, struct wined3d_upload_chunk, entry)
+    {
+        if (ring->size + size <= WINED3D_UPLOAD_RING_SIZE)
+            break;
+        if (!wined3d_upload_chunk_is_idle(chunk, completed_fence))
+            continue;
+
+        TRACE("Freeing upload chunk %p.\n", chunk);
+        list_remove(&chunk->entry);
+        wined3d_upload_chunk_destroy(ring, chunk);
+        ++ring->generation;
+    }
+
+    if (ring->size + size > WINED3D_UPLOAD_RING_SIZE)
+    {
+        TRACE("Upload ring is full.\n");
+        return NULL;
+    }
+
+    if (!(chunk = heap_alloc_zero(sizeof(*chunk))))
+        return NULL;
+    if (!(chunk->memory = heap_alloc(size + RESOURCE_ALIGNMENT - 1)))
+    {
+        heap_free(chunk);
+        return NULL;
+    }
+    chunk->data = (BYTE *)(((ULONG_PTR)chunk->memory + RESOURCE_ALIGNMENT - 1) & ~(ULONG_PTR)(RESOURCE_ALIGNMENT - 1));
+    chunk->size = size;
+    ring->size += size;
+
+    TRACE("Created upload chunk %p, size %lu, ring size %lu.\n",
+            chunk, (unsigned long)size, (unsigned long)ring->size);
+
+    return chunk;
+}
+
+static BYTE *wined3d_upload_ring_allocate(struct wined3d_upload_ring *ring,
+        size_t size, struct wined3d_upload_chunk **chunk)
+{
+    struct wined3d_upload_chunk *current;
+    BYTE *data;
+
+    size = (size + RESOURCE_ALIGNMENT - 1) & ~(RESOURCE_ALIGNMENT - 1);
+
+    /* Larger buffers get a chunk of their own. The size is rounded up to a
+     * power of two, so that chunks can be recycled for buffers of similar
+     * sizes. */
+    if (size > WINED3D_UPLOAD_MAX_SUBALLOC_SIZE)
+    {
+        if (!(current = wined3d_upload_ring_get_chunk(ring, 1u << (wined3d_log2i(size - 1) + 1))))
+            return NULL;
+        current->offset = size;
+        list_add_tail(&ring->retired, &current->entry);
+        *chunk = current;
+
+        return current->data;
+    }
+
+    if (!(current = ring->current) || current->offset + size > current->size)
+    {
+        if (current)
+            list_add_tail(&ring->retired, &current->entry);
+        if (!(current = ring->current = wined3d_upload_ring_get_chunk(ring, WINED3D_UPLOAD_CHUNK_SIZE)))
+            return NULL;
+    }
+
+    data = current->data + current->offset;
+    current->offset += size;
+    *chunk = current;
+
+    return data;
+}
+
+/* Dynamic buffers mapped with WINED3D_MAP_DISCARD get new storage from the
+ * upload ring, so that the application thread never has to wait for the
+ * command stream to stop using the previous contents. Subsequent
+ * WINED3D_MAP_NOOVERWRITE maps keep writing to the same block. The data is
+ * copied to the buffer by the command stream thread, in order with any
+ * other commands using the buffer. That is a second copy, since the ring
+ * is in system memory rather than in buffer objects.
+ *
+ * Without a box, a NOOVERWRITE map uploads the entire buffer again. While
+ * such an upload is still queued it also picks up later writes to the block,
+ * so no new upload is queued for those. */
+BOOL wined3d_cs_map_upload_buffer(struct wined3d_cs *cs, struct wined3d_buffer *buffer,
+        struct wined3d_map_desc *map_desc, const struct wined3d_box *box, DWORD flags)
+{
+    struct wined3d_upload_chunk *chunk;
+    unsigned int offset, size, end;
+    BYTE *data;
+
+    if (!cs->thread || cs->thread_id == GetCurrentThreadId())
+        return FALSE;
+
+    /* An empty box maps the rest of the buffer. */
+    if (box && box->right > box->left)
+    {
+        offset = box->left;
+        size = box->right - box->left;
+    }
+    else
+    {
+        offset = box ? box->left : 0;
+        size = buffer->resource.size - min(offset, buffer->resource.size);
+    }
+    if (offset >= buffer->resource.size || size > buffer->resource.size - offset)
+        goto fail;
+
+    /* Nested maps return the same block, and are uploaded together on the
+     * last unmap. */
+    if (buffer->upload_map_count)
+    {
+        end = max(buffer->upload_range.offset + buffer->upload_range.size, offset + size);
+        buffer->upload_range.offset = min(buffer->upload_range.offset, offset);
+        buffer->upload_range.size = end - buffer->upload_range.offset;
+        ++buffer->upload_map_count;
+        goto done;
+    }
+
+    if ((flags & WINED3D_MAP_READ) || !(flags & (WINED3D_MAP_DISCARD | WINED3D_MAP_NOOVERWRITE))
+            || buffer->resource.map_count || buffer->resource.size > WINED3D_UPLOAD_MAX_BUFFER_SIZE
+            || buffer->resource.bind_flags & (WINED3D_BIND_STREAM_OUTPUT | WINED3D_BIND_UNORDERED_ACCESS))
+        goto fail;
+
+    if (flags & WINED3D_MAP_DISCARD)
+    {
+        if (!(data = wined3d_upload_ring_allocate(&cs->upload_ring, buffer->resource.size, &chunk)))
+            goto fail;
+
+        buffer->upload_chunk = chunk;
+        buffer->upload_generation = chunk->generation;
+        buffer->upload_ring_generation = cs->upload_ring.generation;
+        buffer->upload_data = data;
+
+        /* DISCARD uploads the entire buffer, as in
+         * buffer_resource_sub_resource_map(). */
+        buffer->upload_range.offset = 0;
+        buffer->upload_range.size = buffer->resource.size;
+        buffer->upload_flags = WINED3D_MAP_DISCARD;
+    }
+    else
+    {
+        /* The block only contains the entire buffer contents if nothing else
+         * wrote to the buffer since the last streamed DISCARD map, and the
+         * chunk hasn't been recycled since. Buffers don't keep their chunk
+         * alive, so if any chunk was freed in the meantime, the chunk may be
+         * gone, and the regular path is used until the next DISCARD map. */
+        if (!(chunk = buffer->upload_chunk) || buffer->upload_ring_generation != cs->upload_ring.generation
+                || buffer->upload_generation != chunk->generation)
+            goto fail;
+
+        buffer->upload_range.offset = offset;
+        buffer->upload_range.size = size;
+        buffer->upload_flags = WINED3D_MAP_NOOVERWRITE;
+    }
+
+    ++buffer->upload_chunk->map_count;
+    buffer->upload_map_count = 1;
+
+done:
+    map_desc->row_pitch = map_desc->slice_pitch = buffer->resource.size;
+    map_desc->data = buffer->upload_data + offset;
+
+    TRACE("Returning upload memory at %p for buffer %p.\n", map_desc->data, buffer);
+
+    return TRUE;
+
+fail:
+    if (flags & WINED3D_MAP_WRITE)
+        wined3d_cs_invalidate_upload_buffer(&buffer->resource);
+    return FALSE;
+}
+
+BOOL wined3d_cs_unmap_upload_buffer(struct wined3d_cs *cs, struct wined3d_buffer *buffer)
+{
+    struct wined3d_upload_chunk *chunk = buffer->upload_chunk;
+    struct wined3d_cs_upload_buffer *op;
+    BOOL full;
+
+    if (!buffer->upload_map_count)
+        return FALSE;
+
+    if (--buffer->upload_map_count)
+        return TRUE;
+    --chunk->map_count;
+
+    full = !buffer->upload_range.offset && buffer->upload_range.size == buffer->resource.size;
+    if (full && buffer->upload_pending_data == buffer->upload_data
+            && InterlockedCompareExchange(&buffer->upload_pending, 1, 1))
+    {
+        TRACE("Upload of buffer %p is still queued.\n", buffer);
+        return TRUE;
+    }
+
+    op = wined3d_cs_require_space(cs, sizeof(*op), WINED3D_CS_QUEUE_DEFAULT);
+    op->opcode = WINED3D_CS_OP_UPLOAD_BUFFER;
+    op->buffer = buffer;
+    op->offset = buffer->upload_range.offset;
+    op->size = buffer->upload_range.size;
+    op->data = buffer->upload_data + op->offset;
+    op->flags = buffer->upload_flags;
+    op->fence = chunk->fence = ++cs->upload_ring.fence;
+
+    /* This has to be set before the command stream thread can clear it. */
+    if (full)
+    {
+        buffer->upload_pending_data = buffer->upload_data;
+        InterlockedExchange(&buffer->upload_pending, 1);
+    }
+
+    wined3d_cs_acquire_resource(cs, &buffer->resource);
+
+    wined3d_cs_submit(cs, WINED3D_CS_QUEUE_DEFAULT);
+
+    return TRUE;
+}
+
 static void wined3d_cs_exec_add_dirty_texture_region(struct wined3d_cs *cs, const void *data)
 {
     const struct wined3d_cs_add_dirty_texture_region *op = data;
@@ -2513,7 +3208,7 @@ void wined3d_cs_emit_add_dirty_texture_region(struct wined3d_cs *cs,
     op->texture = texture;
     op->layer = layer;
 
-    wined3d_resource_acquire(&texture->resource);
+    wined3d_cs_acquire_resource(cs, &texture->resource);
 
     wined3d_cs_submit(cs, WINED3D_CS_QUEUE_DEFAULT);
 }
@@ -2541,7 +3236,8 @@ void wined3d_cs_emit_clear_unordered_access_view_uint(struct wined3d_cs *cs,
     op->view = view;
     op->clear_value = *clear_value;
 
-    wined3d_resource_acquire(view->resource);
+    wined3d_cs_reference_object(cs, WINED3D_CS_OBJECT_UNORDERED_ACCESS_VIEW, view);
+    wined3d_cs_acquire_resource(cs, view->resource);
 
     wined3d_cs_submit(cs, WINED3D_CS_QUEUE_DEFAULT);
 }
@@ -2570,7 +3266,8 @@ void wined3d_cs_emit_copy_uav_counter(struct wined3d_cs *cs, struct wined3d_buff
     op->offset = offset;
     op->view = uav;
 
-    wined3d_resource_acquire(&dst_buffer->resource);
+    wined3d_cs_reference_object(cs, WINED3D_CS_OBJECT_UNORDERED_ACCESS_VIEW, uav);
+    wined3d_cs_acquire_resource(cs, &dst_buffer->resource);
 
     wined3d_cs_submit(cs, WINED3D_CS_QUEUE_DEFAULT);
 }
@@ -2592,7 +3289,8 @@ void wined3d_cs_emit_generate_mipmaps(struct wined3d_cs *cs, struct wined3d_shad
     op->opcode = WINED3D_CS_OP_GENERATE_MIPMAPS;
     op->view = view;
 
-    wined3d_resource_acquire(view->resource);
+    wined3d_cs_reference_object(cs, WINED3D_CS_OBJECT_SHADER_RESOURCE_VIEW, view);
+    wined3d_cs_acquire_resource(cs, view->resource);
 
     wined3d_cs_submit(cs, WINED3D_CS_QUEUE_DEFAULT);
 }
@@ -2608,6 +3306,8 @@ static void wined3d_cs_emit_stop(struct wined3d_cs *cs)
     wined3d_cs_finish(cs, WINED3D_CS_QUEUE_DEFAULT);
 }
 
+static void wined3d_cs_exec_execute_command_list(struct wined3d_cs *cs, const void *data);
+
 static void (* const wined3d_cs_op_handlers[])(struct wined3d_cs *cs, const void *data) =
 {
     /* WINED3D_CS_OP_NOP                         */ wined3d_cs_exec_nop,
@@ -2654,12 +3354,52 @@ static void (* const wined3d_cs_op_handlers[])(struct wined3d_cs *cs, const void
     /* WINED3D_CS_OP_UNMAP                       */ wined3d_cs_exec_unmap,
     /* WINED3D_CS_OP_BLT_SUB_RESOURCE            */ wined3d_cs_exec_blt_sub_resource,
     /* WINED3D_CS_OP_UPDATE_SUB_RESOURCE         */ wined3d_cs_exec_update_sub_resource,
+    /* WINED3D_CS_OP_UPLOAD_BUFFER               */ wined3d_cs_exec_upload_buffer,
     /* WINED3D_CS_OP_ADD_DIRTY_TEXTURE_REGION    */ wined3d_cs_exec_add_dirty_texture_region,
     /* WINED3D_CS_OP_CLEAR_UNORDERED_ACCESS_VIEW */ wined3d_cs_exec_clear_unordered_access_view,
     /* WINED3D_CS_OP_COPY_UAV_COUNTER            */ wined3d_cs_exec_copy_uav_counter,
     /* WINED3D_CS_OP_GENERATE_MIPMAPS            */ wined3d_cs_exec_generate_mipmaps,
+    /* WINED3D_CS_OP_EXECUTE_COMMAND_LIST        */ wined3d_cs_exec_execute_command_list,
 };
 
+static void wined3d_cs_exec_execute_command_list(struct wined3d_cs *cs, const void *data)
+{
+    const struct wined3d_cs_execute_command_list *op = data;
+    const struct wined3d_command_list *list = op->list;
+    const struct wined3d_cs_packet *packet;
+    enum wined3d_cs_op opcode;
+    SIZE_T start;
+
+    TRACE("Executing command list %p.\n", list);
+
+    for (start = 0; start < list->data_size; start += FIELD_OFFSET(struct wined3d_cs_packet, data[packet->size]))
+    {
+        packet = (const struct wined3d_cs_packet *)((const BYTE *)list->data + start);
+        opcode = *(const enum wined3d_cs_op *)packet->data;
+
+        if (opcode >= WINED3D_CS_OP_STOP)
+            ERR("Invalid opcode %#x.\n", opcode);
+        else
+            wined3d_cs_op_handlers[opcode](cs, packet->data);
+    }
+}
+
+static void wined3d_cs_emit_execute_command_list(struct wined3d_cs *cs, struct wined3d_command_list *list)
+{
+    struct wined3d_cs_execute_command_list *op;
+    SIZE_T i;
+
+    op = wined3d_cs_require_space(cs, sizeof(*op), WINED3D_CS_QUEUE_DEFAULT);
+    op->opcode = WINED3D_CS_OP_EXECUTE_COMMAND_LIST;
+    op->list = list;
+
+    wined3d_cs_reference_object(cs, WINED3D_CS_OBJECT_COMMAND_LIST, list);
+    for (i = 0; i < list->resource_count; ++i)
+        wined3d_cs_acquire_resource(cs, list->resources[i]);
+
+    wined3d_cs_submit(cs, WINED3D_CS_QUEUE_DEFAULT);
+}
+
 static void *wined3d_cs_st_require_space(struct wined3d_cs *cs, size_t size, enum wined3d_cs_queue_id queue_id)
 {
     if (size > (cs->data_size - cs->end))
@@ -2711,12 +3451,48 @@ static void wined3d_cs_st_finish(struct wined3d_cs *cs, enum wined3d_cs_queue_id
 {
 }
 
+static void wined3d_cs_immediate_acquire_resource(struct wined3d_cs *cs, struct wined3d_resource *resource)
+{
+    wined3d_resource_acquire(resource);
+}
+
+static void wined3d_cs_immediate_reference_object(struct wined3d_cs *cs,
+        enum wined3d_cs_object_type type, void *object)
+{
+}
+
+static void wined3d_cs_immediate_update_sub_resource(struct wined3d_cs *cs, struct wined3d_resource *resource,
+        unsigned int sub_resource_idx, const struct wined3d_box *box, const void *data,
+        unsigned int row_pitch, unsigned int slice_pitch)
+{
+    wined3d_resource_wait_idle(resource);
+    wined3d_cs_emit_update_sub_resource(cs, resource, sub_resource_idx, box, data, row_pitch, slice_pitch);
+}
+
+static HRESULT wined3d_cs_immediate_map(struct wined3d_cs *cs, struct wined3d_resource *resource,
+        unsigned int sub_resource_idx, struct wined3d_map_desc *map_desc, const struct wined3d_box *box,
+        unsigned int flags)
+{
+    return wined3d_resource_map(resource, sub_resource_idx, map_desc, box, flags);
+}
+
+static HRESULT wined3d_cs_immediate_unmap(struct wined3d_cs *cs,
+        struct wined3d_resource *resource, unsigned int sub_resource_idx)
+{
+    return wined3d_resource_unmap(resource, sub_resource_idx);
+}
+
 static const struct wined3d_cs_ops wined3d_cs_st_ops =
 {
     wined3d_cs_st_require_space,
     wined3d_cs_st_submit,
     wined3d_cs_st_finish,
     wined3d_cs_st_push_constants,
+    wined3d_cs_immediate_acquire_resource,
+    wined3d_cs_immediate_reference_object,
+    wined3d_cs_immediate_update_sub_resource,
+    wined3d_cs_immediate_map,
+    wined3d_cs_immediate_unmap,
 };
 
 static BOOL wined3d_cs_queue_is_empty(const struct wined3d_cs *cs, const struct wined3d_cs_queue *queue)
@@ -2734,6 +3510,12 @@ static void wined3d_cs_queue_submit(struct wined3d_cs_queue *queue, struct wined
     packet_size = FIELD_OFFSET(struct wined3d_cs_packet, data[packet->size]);
     InterlockedExchange(&queue->head, (queue->head + packet_size) & (WINED3D_CS_QUEUE_SIZE - 1));
 
+    if (cs->profile)
+    {
+        ++cs->profile->producer.submitted_packets;
+        cs->profile->producer.submitted_bytes += packet_size;
+    }
+
     if (InterlockedCompareExchange(&cs->waiting_for_event, FALSE, TRUE))
         SetEvent(cs->event);
 }
@@ -2751,6 +3533,7 @@ static void *wined3d_cs_queue_require_space(struct wined3d_cs_queue *queue, size
     size_t queue_size = ARRAY_SIZE(queue->data);
     size_t header_size, packet_size, remaining;
     struct wined3d_cs_packet *packet;
+    LONGLONG stall_start = 0;
 
     header_size = FIELD_OFFSET(struct wined3d_cs_packet, data[0]);
     packet_size = FIELD_OFFSET(struct wined3d_cs_packet, data[size]);
@@ -2799,10 +3582,22 @@ static void *wined3d_cs_queue_require_space(struct wined3d_cs_queue *queue, size
         if (new_pos < tail && new_pos)
             break;
 
+        if (cs->profile && !stall_start)
+            stall_start = wined3d_cs_profile_time();
+
         TRACE("Waiting for free space. Head %u, tail %u, packet size %lu.\n",
                 head, tail, (unsigned long)packet_size);
     }
 
+    if (stall_start)
+    {
+        LONGLONG stall_end = wined3d_cs_profile_time();
+
+        ++cs->profile->producer.stall_count;
+        cs->profile->producer.stall_time += stall_end - stall_start;
+        wined3d_cs_profile_trace_event(cs->profile, "queue full", 'X', stall_start, stall_end, 0);
+    }
+
     packet = (struct wined3d_cs_packet *)&queue->data[queue->head];
     packet->size = size;
     return packet->data;
@@ -2818,11 +3613,26 @@ static void *wined3d_cs_mt_require_space(struct wined3d_cs *cs, size_t size, enu
 
 static void wined3d_cs_mt_finish(struct wined3d_cs *cs, enum wined3d_cs_queue_id queue_id)
 {
+    LONGLONG start, end;
+
     if (cs->thread_id == GetCurrentThreadId())
         return wined3d_cs_st_finish(cs, queue_id);
 
+    if (!cs->profile)
+    {
+        while (cs->queue[queue_id].head != *(volatile LONG *)&cs->queue[queue_id].tail)
+            wined3d_pause();
+        return;
+    }
+
+    start = wined3d_cs_profile_time();
     while (cs->queue[queue_id].head != *(volatile LONG *)&cs->queue[queue_id].tail)
         wined3d_pause();
+    end = wined3d_cs_profile_time();
+
+    ++cs->profile->producer.finish_count;
+    cs->profile->producer.finish_time += end - start;
+    wined3d_cs_profile_trace_event(cs->profile, "finish", 'X', start, end, 0);
 }
 
 static const struct wined3d_cs_ops wined3d_cs_mt_ops =
@@ -2831,6 +3641,11 @@ static const struct wined3d_cs_ops wined3d_cs_mt_ops =
     wined3d_cs_mt_submit,
     wined3d_cs_mt_finish,
     wined3d_cs_mt_push_constants,
+    wined3d_cs_immediate_acquire_resource,
+    wined3d_cs_immediate_reference_object,
+    wined3d_cs_immediate_update_sub_resource,
+    wined3d_cs_immediate_map,
+    wined3d_cs_immediate_unmap,
 };
 
 static void poll_queries(struct wined3d_cs *cs)
@@ -2864,6 +3679,15 @@ static void wined3d_cs_wait_event(struct wined3d_cs *cs)
             && InterlockedCompareExchange(&cs->waiting_for_event, FALSE, TRUE))
         return;
 
+    if (cs->profile)
+    {
+        LONGLONG start = wined3d_cs_profile_time();
+
+        WaitForSingleObject(cs->event, INFINITE);
+        cs->profile->wait_time += wined3d_cs_profile_time() - start;
+        return;
+    }
+
     WaitForSingleObject(cs->event, INFINITE);
 }
 
@@ -2885,9 +3709,11 @@ static DWORD WINAPI wined3d_cs_run(void *ctx)
     struct wined3d_cs_queue *queue;
     unsigned int spin_count = 0;
     struct wined3d_cs *cs = ctx;
+    LONGLONG idle_start = 0, start;
     enum wined3d_cs_op opcode;
     HMODULE wined3d_module;
     unsigned int poll = 0;
+    size_t occupancy;
     LONG tail;
 
     TRACE("Started.\n");
@@ -2914,6 +3740,8 @@ static DWORD WINAPI wined3d_cs_run(void *ctx)
             queue = &cs->queue[WINED3D_CS_QUEUE_DEFAULT];
             if (wined3d_cs_queue_is_empty(cs, queue))
             {
+                if (cs->profile && !idle_start)
+                    idle_start = wined3d_cs_profile_time();
                 if (++spin_count >= WINED3D_CS_SPIN_COUNT && list_empty(&cs->query_poll_list))
                     wined3d_cs_wait_event(cs);
                 continue;
@@ -2921,6 +3749,17 @@ static DWORD WINAPI wined3d_cs_run(void *ctx)
         }
         spin_count = 0;
 
+        if (cs->profile)
+        {
+            if (idle_start)
+            {
+                cs->profile->idle_time += wined3d_cs_profile_time() - idle_start;
+                idle_start = 0;
+            }
+            occupancy = (*(volatile LONG *)&queue->head - queue->tail) & (WINED3D_CS_QUEUE_SIZE - 1);
+            cs->profile->max_occupancy = max(cs->profile->max_occupancy, occupancy);
+        }
+
         tail = queue->tail;
         packet = (struct wined3d_cs_packet *)&queue->data[tail];
         if (packet->size)
@@ -2936,7 +3775,16 @@ static DWORD WINAPI wined3d_cs_run(void *ctx)
             }
 
             wined3d_cs_command_lock(cs);
-            wined3d_cs_op_handlers[opcode](cs, packet->data);
+            if (cs->profile)
+            {
+                start = wined3d_cs_profile_time();
+                wined3d_cs_op_handlers[opcode](cs, packet->data);
+                wined3d_cs_profile_op(cs->profile, opcode, start, wined3d_cs_profile_time());
+            }
+            else
+            {
+                wined3d_cs_op_handlers[opcode](cs, packet->data);
+            }
             wined3d_cs_command_unlock(cs);
             TRACE("%s executed.\n", debug_cs_op(opcode));
         }
@@ -2962,7 +3810,10 @@ struct wined3d_cs *wined3d_cs_create(struct wined3d_device *device)
 
     cs->ops = &wined3d_cs_st_ops;
     cs->device = device;
+    cs->c.device = device;
+    cs->c.state = &device->state;
     cs->serialize_commands = TRACE_ON(d3d_sync) || wined3d_settings.cs_multithreaded & WINED3D_CSMT_SERIALIZE;
+    list_init(&cs->upload_ring.retired);
 
     state_init(&cs->state, d3d_info, WINED3D_STATE_NO_REF | WINED3D_STATE_INIT_DEFAULT);
 
@@ -2975,9 +3826,17 @@ struct wined3d_cs *wined3d_cs_create(struct wined3d_device *device)
     {
         cs->ops = &wined3d_cs_mt_ops;
 
+        if (!(cs->queue = heap_alloc_zero(WINED3D_CS_QUEUE_COUNT * sizeof(*cs->queue))))
+        {
+            ERR("Failed to allocate command stream queues.\n");
+            heap_free(cs->data);
+            goto fail;
+        }
+
         if (!(cs->event = CreateEventW(NULL, FALSE, FALSE, NULL)))
         {
             ERR("Failed to create command stream event.\n");
+            heap_free(cs->queue);
             heap_free(cs->data);
             goto fail;
         }
@@ -2987,15 +3846,20 @@ struct wined3d_cs *wined3d_cs_create(struct wined3d_device *device)
         {
             ERR("Failed to get wined3d module handle.\n");
             CloseHandle(cs->event);
+            heap_free(cs->queue);
             heap_free(cs->data);
             goto fail;
         }
 
+        cs->profile = wined3d_cs_profile_create();
+
         if (!(cs->thread = CreateThread(NULL, 0, wined3d_cs_run, cs, 0, NULL)))
         {
             ERR("Failed to create wined3d command stream thread.\n");
+            wined3d_cs_profile_destroy(cs->profile);
             FreeLibrary(cs->wined3d_module);
             CloseHandle(cs->event);
+            heap_free(cs->queue);
             heap_free(cs->data);
             goto fail;
         }
@@ -3017,9 +3881,916 @@ void wined3d_cs_destroy(struct wined3d_cs *cs)
         CloseHandle(cs->thread);
         if (!CloseHandle(cs->event))
             ERR("Closing event failed.\n");
+        wined3d_cs_profile_destroy(cs->profile);
     }
 
+    wined3d_upload_ring_cleanup(&cs->upload_ring);
+
     state_cleanup(&cs->state);
+    heap_free(cs->queue);
     heap_free(cs->data);
     heap_free(cs);
 }
+
+static void wined3d_cs_object_incref(const struct wined3d_cs_object_reference *reference)
+{
+    void *object = reference->object;
+
+    switch (reference->type)
+    {
+        case WINED3D_CS_OBJECT_RESOURCE:
+            ((struct wined3d_resource *)object)->resource_ops->resource_incref(object);
+            break;
+        case WINED3D_CS_OBJECT_RENDERTARGET_VIEW:
+            wined3d_rendertarget_view_incref(object);
+            break;
+        case WINED3D_CS_OBJECT_SHADER_RESOURCE_VIEW:
+            wined3d_shader_resource_view_incref(object);
+            break;
+        case WINED3D_CS_OBJECT_UNORDERED_ACCESS_VIEW:
+            wined3d_unordered_access_view_incref(object);
+            break;
+        case WINED3D_CS_OBJECT_SAMPLER:
+            wined3d_sampler_incref(object);
+            break;
+        case WINED3D_CS_OBJECT_SHADER:
+            wined3d_shader_incref(object);
+            break;
+        case WINED3D_CS_OBJECT_BLEND_STATE:
+            wined3d_blend_state_incref(object);
+            break;
+        case WINED3D_CS_OBJECT_DEPTH_STENCIL_STATE:
+            wined3d_depth_stencil_state_incref(object);
+            break;
+        case WINED3D_CS_OBJECT_RASTERIZER_STATE:
+            wined3d_rasterizer_state_incref(object);
+            break;
+        case WINED3D_CS_OBJECT_VERTEX_DECLARATION:
+            wined3d_vertex_declaration_incref(object);
+            break;
+        case WINED3D_CS_OBJECT_QUERY:
+            wined3d_query_incref(object);
+            break;
+        case WINED3D_CS_OBJECT_COMMAND_LIST:
+            wined3d_command_list_incref(object);
+            break;
+    }
+}
+
+static void wined3d_cs_object_decref(const struct wined3d_cs_object_reference *reference)
+{
+    void *object = reference->object;
+
+    switch (reference->type)
+    {
+        case WINED3D_CS_OBJECT_RESOURCE:
+            ((struct wined3d_resource *)object)->resource_ops->resource_decref(object);
+            break;
+        case WINED3D_CS_OBJECT_RENDERTARGET_VIEW:
+            wined3d_rendertarget_view_decref(object);
+            break;
+        case WINED3D_CS_OBJECT_SHADER_RESOURCE_VIEW:
+            wined3d_shader_resource_view_decref(object);
+            break;
+        case WINED3D_CS_OBJECT_UNORDERED_ACCESS_VIEW:
+            wined3d_unordered_access_view_decref(object);
+            break;
+        case WINED3D_CS_OBJECT_SAMPLER:
+            wined3d_sampler_decref(object);
+            break;
+        case WINED3D_CS_OBJECT_SHADER:
+            wined3d_shader_decref(object);
+            break;
+        case WINED3D_CS_OBJECT_BLEND_STATE:
+            wined3d_blend_state_decref(object);
+            break;
+        case WINED3D_CS_OBJECT_DEPTH_STENCIL_STATE:
+            wined3d_depth_stencil_state_decref(object);
+            break;
+        case WINED3D_CS_OBJECT_RASTERIZER_STATE:
+            wined3d_rasterizer_state_decref(object);
+            break;
+        case WINED3D_CS_OBJECT_VERTEX_DECLARATION:
+            wined3d_vertex_declaration_decref(object);
+            break;
+        case WINED3D_CS_OBJECT_QUERY:
+            wined3d_query_decref(object);
+            break;
+        case WINED3D_CS_OBJECT_COMMAND_LIST:
+            wined3d_command_list_decref(object);
+            break;
+    }
+}
+
+/* Emit the state changes needed to get the command stream from "from" to
+ * "to". Only the d3d10+ bindings are considered; command lists can't change
+ * anything else. */
+static void wined3d_cs_emit_state_transition(struct wined3d_cs *cs,
+        const struct wined3d_state *from, const struct wined3d_state *to)
+{
+    const struct wined3d_d3d_info *d3d_info = &cs->device->adapter->d3d_info;
+    const struct wined3d_stream_state *from_stream, *to_stream;
+    unsigned int i, j;
+
+    for (i = 0; i < WINED3D_SHADER_TYPE_COUNT; ++i)
+    {
+        if (from->shader[i] != to->shader[i])
+            wined3d_cs_emit_set_shader(cs, i, to->shader[i]);
+
+        for (j = 0; j < MAX_CONSTANT_BUFFERS; ++j)
+        {
+            if (from->cb[i][j] != to->cb[i][j])
+                wined3d_cs_emit_set_constant_buffer(cs, i, j, to->cb[i][j]);
+        }
+
+        for (j = 0; j < MAX_SAMPLER_OBJECTS; ++j)
+        {
+            if (from->sampler[i][j] != to->sampler[i][j])
+                wined3d_cs_emit_set_sampler(cs, i, j, to->sampler[i][j]);
+        }
+
+        for (j = 0; j < MAX_SHADER_RESOURCE_VIEWS; ++j)
+        {
+            if (from->shader_resource_view[i][j] != to->shader_resource_view[i][j])
+                wined3d_cs_emit_set_shader_resource_view(cs, i, j, to->shader_resource_view[i][j]);
+        }
+    }
+
+    for (i = 0; i < WINED3D_PIPELINE_COUNT; ++i)
+    {
+        for (j = 0; j < MAX_UNORDERED_ACCESS_VIEWS; ++j)
+        {
+            if (from->unordered_access_view[i][j] != to->unordered_access_view[i][j])
+                wined3d_cs_emit_set_unordered_access_view(cs, i, j, to->unordered_access_view[i][j], ~0u);
+        }
+    }
+
+    for (i = 0; i < d3d_info->limits.max_rt_count; ++i)
+    {
+        if (from->fb.render_targets[i] != to->fb.render_targets[i])
+            wined3d_cs_emit_set_rendertarget_view(cs, i, to->fb.render_targets[i]);
+    }
+    if (from->fb.depth_stencil != to->fb.depth_stencil)
+        wined3d_cs_emit_set_depth_stencil_view(cs, to->fb.depth_stencil);
+
+    if (from->vertex_declaration != to->vertex_declaration)
+        wined3d_cs_emit_set_vertex_declaration(cs, to->vertex_declaration);
+
+    for (i = 0; i < WINED3D_MAX_STREAMS; ++i)
+    {
+        from_stream = &from->streams[i];
+        to_stream = &to->streams[i];
+        if (from_stream->buffer != to_stream->buffer || from_stream->offset != to_stream->offset
+                || from_stream->stride != to_stream->stride)
+            wined3d_cs_emit_set_stream_source(cs, i, to_stream->buffer, to_stream->offset, to_stream->stride);
+    }
+
+    for (i = 0; i < WINED3D_MAX_STREAM_OUTPUT_BUFFERS; ++i)
+    {
+        if (from->stream_output[i].buffer != to->stream_output[i].buffer
+                || from->stream_output[i].offset != to->stream_output[i].offset)
+            wined3d_cs_emit_set_stream_output(cs, i, to->stream_output[i].buffer, to->stream_output[i].offset);
+    }
+
+    if (from->index_buffer != to->index_buffer || from->index_format != to->index_format
+            || from->index_offset != to->index_offset)
+        wined3d_cs_emit_set_index_buffer(cs, to->index_buffer, to->index_format, to->index_offset);
+
+    if (from->viewport_count != to->viewport_count
+            || memcmp(from->viewports, to->viewports, to->viewport_count * sizeof(*to->viewports)))
+        wined3d_cs_emit_set_viewports(cs, to->viewport_count, to->viewports);
+
+    if (from->scissor_rect_count != to->scissor_rect_count
+            || memcmp(from->scissor_rects, to->scissor_rects, to->scissor_rect_count * sizeof(*to->scissor_rects)))
+        wined3d_cs_emit_set_scissor_rects(cs, to->scissor_rect_count, to->scissor_rects);
+
+    if (from->blend_state != to->blend_state || from->sample_mask != to->sample_mask
+            || memcmp(&from->blend_factor, &to->blend_factor, sizeof(to->blend_factor)))
+        wined3d_cs_emit_set_blend_state(cs, to->blend_state, &to->blend_factor, to->sample_mask);
+
+    if (from->depth_stencil_state != to->depth_stencil_state)
+        wined3d_cs_emit_set_depth_stencil_state(cs, to->depth_stencil_state);
+
+    if (from->rasterizer_state != to->rasterizer_state)
+        wined3d_cs_emit_set_rasterizer_state(cs, to->rasterizer_state);
+
+    for (i = 0; i < ARRAY_SIZE(to->render_states); ++i)
+    {
+        if (from->render_states[i] != to->render_states[i])
+            wined3d_cs_emit_set_render_state(cs, i, to->render_states[i]);
+    }
+
+    if (from->predicate != to->predicate || from->predicate_value != to->predicate_value)
+        wined3d_cs_emit_set_predication(cs, to->predicate, to->predicate_value);
+}
+
+/* The state command lists start executing from, and that execution resets
+ * to unless the context state is restored. */
+static const struct wined3d_state *wined3d_device_get_default_state(struct wined3d_device *device)
+{
+    struct wined3d_state *state;
+
+    if ((state = device->default_state))
+        return state;
+
+    if (!(state = heap_alloc_zero(sizeof(*state))))
+        return NULL;
+    state_init(state, &device->adapter->d3d_info, WINED3D_STATE_NO_REF | WINED3D_STATE_INIT_DEFAULT);
+
+    if (InterlockedCompareExchangePointer((void **)&device->default_state, state, NULL))
+    {
+        state_cleanup(state);
+        heap_free(state);
+        state = device->default_state;
+    }
+
+    return state;
+}
+
+static void wined3d_device_context_cleanup_state(struct wined3d_device_context *context)
+{
+    struct wined3d_depth_stencil_state *depth_stencil_state;
+    struct wined3d_rasterizer_state *rasterizer_state;
+    struct wined3d_state *state = context->state;
+    struct wined3d_rendertarget_view *view;
+    struct wined3d_query *predicate;
+    unsigned int i;
+
+    /* state_unbind_resources() leaves the framebuffer, predicate, rasterizer
+     * and depth/stencil states alone. */
+    for (i = 0; i < ARRAY_SIZE(state->fb.render_targets); ++i)
+    {
+        if (!(view = state->fb.render_targets[i]))
+            continue;
+        state->fb.render_targets[i] = NULL;
+        if (!(state->flags & WINED3D_STATE_DEFERRED))
+            wined3d_rtv_bind_count_dec(view);
+        wined3d_rendertarget_view_decref(view);
+    }
+    if ((view = state->fb.depth_stencil))
+    {
+        state->fb.depth_stencil = NULL;
+        wined3d_rendertarget_view_decref(view);
+    }
+    if ((predicate = state->predicate))
+    {
+        state->predicate = NULL;
+        wined3d_query_decref(predicate);
+    }
+    if ((rasterizer_state = state->rasterizer_state))
+    {
+        state->rasterizer_state = NULL;
+        wined3d_rasterizer_state_decref(rasterizer_state);
+    }
+    if ((depth_stencil_state = state->depth_stencil_state))
+    {
+        state->depth_stencil_state = NULL;
+        wined3d_depth_stencil_state_decref(depth_stencil_state);
+    }
+
+    state_cleanup(state);
+}
+
+/* Reset the application side state of a context to the defaults, without
+ * emitting anything. The caller is responsible for getting the command
+ * stream into the same state. */
+static void wined3d_device_context_reset_state(struct wined3d_device_context *context)
+{
+    struct wined3d_state *state = context->state;
+    DWORD flags = state->flags;
+
+    wined3d_device_context_cleanup_state(context);
+    memset(state, 0, sizeof(*state));
+    state_init(state, &context->device->adapter->d3d_info, flags);
+}
+
+void CDECL wined3d_device_context_execute_command_list(struct wined3d_device_context *context,
+        struct wined3d_command_list *list, BOOL restore_state)
+{
+    struct wined3d_cs *cs = wined3d_cs_from_context(context);
+    const struct wined3d_state *default_state;
+    struct wined3d_query *query;
+    SIZE_T i;
+
+    TRACE("context %p, list %p, restore_state %#x.\n", context, list, restore_state);
+
+    if (!(default_state = wined3d_device_get_default_state(context->device)))
+    {
+        ERR("Failed to allocate the default state.\n");
+        return;
+    }
+
+    for (i = 0; i < list->query_count; ++i)
+    {
+        query = list->queries[i].query;
+        if (list->queries[i].flags & WINED3DISSUE_END)
+            ++query->counter_main;
+        query->state = (list->queries[i].flags & WINED3DISSUE_BEGIN) ? QUERY_BUILDING : QUERY_SIGNALLED;
+    }
+
+    /* Command lists are recorded against the default state, and their
+     * packets only reference the objects they bind themselves. */
+    wined3d_cs_emit_state_transition(cs, context->state, default_state);
+    wined3d_cs_emit_execute_command_list(cs, list);
+
+    if (restore_state)
+    {
+        wined3d_cs_emit_state_transition(cs, list->state, context->state);
+    }
+    else
+    {
+        wined3d_cs_emit_state_transition(cs, list->state, default_state);
+        wined3d_device_context_reset_state(context);
+    }
+}
+
+ULONG CDECL wined3d_command_list_incref(struct wined3d_command_list *list)
+{
+    ULONG refcount = InterlockedIncrement(&list->refcount);
+
+    TRACE("%p increasing refcount to %u.\n", list, refcount);
+
+    return refcount;
+}
+
+static void wined3d_deferred_upload_decref(struct wined3d_deferred_upload *upload)
+{
+    if (!InterlockedDecrement(&upload->refcount))
+        heap_free(upload);
+}
+
+static void wined3d_command_list_destroy_object(void *object)
+{
+    struct wined3d_command_list *list = object;
+    SIZE_T i;
+
+    for (i = 0; i < list->upload_count; ++i)
+        wined3d_deferred_upload_decref(list->uploads[i]);
+
+    heap_free(list->queries);
+    heap_free(list->uploads);
+    heap_free(list->references);
+    heap_free(list->resources);
+    heap_free(list->state);
+    heap_free(list->data);
+    heap_free(list);
+}
+
+ULONG CDECL wined3d_command_list_decref(struct wined3d_command_list *list)
+{
+    ULONG refcount = InterlockedDecrement(&list->refcount);
+    struct wined3d_resource *resource;
+    SIZE_T i;
+
+    TRACE("%p decreasing refcount to %u.\n", list, refcount);
+
+    if (!refcount)
+    {
+        /* Objects are destroyed through the command stream, so anything
+         * still used by a pending execution of the list stays valid. */
+        for (i = 0; i < list->resource_count; ++i)
+        {
+            resource = list->resources[i];
+            resource->resource_ops->resource_decref(resource);
+        }
+        for (i = 0; i < list->reference_count; ++i)
+            wined3d_cs_object_decref(&list->references[i]);
+
+        wined3d_cs_destroy_object(list->device->cs, wined3d_command_list_destroy_object, list);
+    }
+
+    return refcount;
+}
+
+struct wined3d_deferred_map
+{
+    struct wined3d_resource *resource;
+    unsigned int sub_resource_idx;
+    struct wined3d_deferred_upload *upload;
+    unsigned int row_pitch, slice_pitch;
+    BOOL mapped;
+};
+
+struct wined3d_deferred_context
+{
+    struct wined3d_cs cs;
+    struct wined3d_state state;
+
+    SIZE_T data_size, data_capacity;
+    void *data;
+
+    SIZE_T resource_count, resources_capacity;
+    struct wined3d_resource **resources;
+    SIZE_T reference_count, references_capacity;
+    struct wined3d_cs_object_reference *references;
+    SIZE_T upload_count, uploads_capacity;
+    struct wined3d_deferred_upload **uploads;
+    SIZE_T map_count, maps_capacity;
+    struct wined3d_deferred_map *maps;
+    SIZE_T query_count, queries_capacity;
+    struct wined3d_deferred_query *queries;
+
+    /* Set when a packet couldn't be recorded; the list is incomplete. */
+    BOOL out_of_memory;
+};
+
+static struct wined3d_deferred_context *wined3d_deferred_context_from_cs(struct wined3d_cs *cs)
+{
+    return CONTAINING_RECORD(cs, struct wined3d_deferred_context, cs);
+}
+
+static void *wined3d_deferred_context_require_space(struct wined3d_cs *cs,
+        size_t size, enum wined3d_cs_queue_id queue_id)
+{
+    struct wined3d_deferred_context *deferred = wined3d_deferred_context_from_cs(cs);
+    size_t header_size, packet_size;
+    struct wined3d_cs_packet *packet;
+
+    header_size = FIELD_OFFSET(struct wined3d_cs_packet, data[0]);
+    packet_size = FIELD_OFFSET(struct wined3d_cs_packet, data[size]);
+    packet_size = (packet_size + header_size - 1) & ~(header_size - 1);
+
+    if (!wined3d_array_reserve(&deferred->data, &deferred->data_capacity, deferred->data_size + packet_size, 1))
+    {
+        void *data;
+
+        /* The command list is discarded anyway. Record over the previous
+         * packets so that the packet emitters don't need to handle failure. */
+        ERR("Failed to allocate %lu bytes of command data.\n", (unsigned long)packet_size);
+        deferred->out_of_memory = TRUE;
+        deferred->data_size = 0;
+        if (packet_size > deferred->data_capacity)
+        {
+            if (!(data = heap_realloc(deferred->data, packet_size)))
+                return NULL;
+            deferred->data = data;
+            deferred->data_capacity = packet_size;
+        }
+    }
+
+    packet = (struct wined3d_cs_packet *)((BYTE *)deferred->data + deferred->data_size);
+    packet->size = packet_size - header_size;
+    deferred->data_size += packet_size;
+
+    return packet->data;
+}
+
+static void wined3d_deferred_context_submit(struct wined3d_cs *cs, enum wined3d_cs_queue_id queue_id)
+{
+}
+
+static void wined3d_deferred_context_finish(struct wined3d_cs *cs, enum wined3d_cs_queue_id queue_id)
+{
+    /* Data recorded by a deferred context never points to application
+     * memory, so there's nothing to wait for. */
+}
+
+static void wined3d_deferred_context_acquire_resource(struct wined3d_cs *cs, struct wined3d_resource *resource)
+{
+    struct wined3d_deferred_context *deferred = wined3d_deferred_context_from_cs(cs);
+
+    if (!wined3d_array_reserve((void **)&deferred->resources, &deferred->resources_capacity,
+            deferred->resource_count + 1, sizeof(*deferred->resources)))
+    {
+        ERR("Failed to record resource %p.\n", resource);
+        deferred->out_of_memory = TRUE;
+        return;
+    }
+
+    deferred->resources[deferred->resource_count++] = resource;
+    resource->resource_ops->resource_incref(resource);
+}
+
+static void wined3d_deferred_context_reference_object(struct wined3d_cs *cs,
+        enum wined3d_cs_object_type type, void *object)
+{
+    struct wined3d_deferred_context *deferred = wined3d_deferred_context_from_cs(cs);
+    struct wined3d_cs_object_reference *reference;
+
+    if (!wined3d_array_reserve((void **)&deferred->references, &deferred->references_capacity,
+            deferred->reference_count + 1, sizeof(*deferred->references)))
+    {
+        ERR("Failed to record reference to object %p.\n", object);
+        deferred->out_of_memory = TRUE;
+        return;
+    }
+
+    reference = &deferred->references[deferred->reference_count++];
+    reference->type = type;
+    reference->object = object;
+    wined3d_cs_object_incref(reference);
+}
+
+static struct wined3d_deferred_upload *wined3d_deferred_upload_create(size_t size)
+{
+    struct wined3d_deferred_upload *upload;
+
+    if (!(upload = heap_alloc(FIELD_OFFSET(struct wined3d_deferred_upload, data[size]))))
+        return NULL;
+    upload->refcount = 1;
+    upload->size = size;
+
+    return upload;
+}
+
+/* Keep "upload" alive for as long as the recorded packets referencing it. */
+static BOOL wined3d_deferred_context_record_upload(struct wined3d_deferred_context *deferred,
+        struct wined3d_deferred_upload *upload)
+{
+    if (!wined3d_array_reserve((void **)&deferred->uploads, &deferred->uploads_capacity,
+            deferred->upload_count + 1, sizeof(*deferred->uploads)))
+        return FALSE;
+
+    InterlockedIncrement(&upload->refcount);
+    deferred->uploads[deferred->upload_count++] = upload;
+
+    return TRUE;
+}
+
+static void wined3d_deferred_context_update_sub_resource(struct wined3d_cs *cs, struct wined3d_resource *resource,
+        unsigned int sub_resource_idx, const struct wined3d_box *box, const void *data,
+        unsigned int row_pitch, unsigned int slice_pitch)
+{
+    struct wined3d_deferred_context *deferred = wined3d_deferred_context_from_cs(cs);
+    unsigned int row_size, slice_size, row_count;
+    struct wined3d_deferred_upload *upload;
+    size_t size;
+
+    if (resource->type == WINED3D_RTYPE_BUFFER)
+    {
+        size = box->right - box->left;
+    }
+    else
+    {
+        wined3d_format_calculate_pitch(resource->format, 1, box->right - box->left,
+                box->bottom - box->top, &row_size, &slice_size);
+        row_count = slice_size / row_size;
+        size = (box->back - box->front - 1) * (size_t)slice_pitch + (row_count - 1) * (size_t)row_pitch + row_size;
+    }
+
+    if (!(upload = wined3d_deferred_upload_create(size)))
+    {
+        ERR("Failed to allocate %lu bytes of upload data.\n", (unsigned long)size);
+        deferred->out_of_memory = TRUE;
+        return;
+    }
+    memcpy(upload->data, data, size);
+
+    if (!wined3d_deferred_context_record_upload(deferred, upload))
+    {
+        ERR("Failed to record upload data.\n");
+        deferred->out_of_memory = TRUE;
+        wined3d_deferred_upload_decref(upload);
+        return;
+    }
+    wined3d_deferred_upload_decref(upload);
+
+    wined3d_cs_emit_update_sub_resource(cs, resource, sub_resource_idx, box, upload->data, row_pitch, slice_pitch);
+}
+
+static struct wined3d_deferred_map *wined3d_deferred_context_find_map(struct wined3d_deferred_context *deferred,
+        struct wined3d_resource *resource, unsigned int sub_resource_idx)
+{
+    SIZE_T i;
+
+    for (i = 0; i < deferred->map_count; ++i)
+    {
+        if (deferred->maps[i].resource == resource && deferred->maps[i].sub_resource_idx == sub_resource_idx)
+            return &deferred->maps[i];
+    }
+
+    return NULL;
+}
+
+static HRESULT wined3d_deferred_context_map(struct wined3d_cs *cs, struct wined3d_resource *resource,
+        unsigned int sub_resource_idx, struct wined3d_map_desc *map_desc, const struct wined3d_box *box,
+        unsigned int flags)
+{
+    struct wined3d_deferred_context *deferred = wined3d_deferred_context_from_cs(cs);
+    struct wined3d_deferred_upload *upload;
+    unsigned int row_pitch, slice_pitch;
+    struct wined3d_deferred_map *map;
+    struct wined3d_texture *texture;
+    unsigned int level;
+    size_t size;
+
+    if (box)
+    {
+        FIXME("Partial maps are not implemented for deferred contexts.\n");
+        return E_NOTIMPL;
+    }
+
+    if (!(flags & (WINED3D_MAP_DISCARD | WINED3D_MAP_NOOVERWRITE)))
+    {
+        WARN("Deferred contexts can only map with WINED3D_MAP_DISCARD or WINED3D_MAP_NOOVERWRITE.\n");
+        return WINED3DERR_INVALIDCALL;
+    }
+
+    if (resource->type == WINED3D_RTYPE_BUFFER)
+    {
+        if (sub_resource_idx)
+        {
+            WARN("Invalid sub_resource_idx %u.\n", sub_resource_idx);
+            return E_INVALIDARG;
+        }
+        row_pitch = slice_pitch = resource->size;
+        size = resource->size;
+    }
+    else
+    {
+        texture = texture_from_resource(resource);
+        if (sub_resource_idx >= texture->level_count * texture->layer_count)
+        {
+            WARN("Invalid sub_resource_idx %u.\n", sub_resource_idx);
+            return E_INVALIDARG;
+        }
+        level = sub_resource_idx % texture->level_count;
+        wined3d_texture_get_pitch(texture, level, &row_pitch, &slice_pitch);
+        size = slice_pitch * (size_t)wined3d_texture_get_level_depth(texture, level);
+    }
+
+    /* The previous contents of the resource aren't known while recording, so
+     * the first map in a command list has to discard them. */
+    map = wined3d_deferred_context_find_map(deferred, resource, sub_resource_idx);
+    if ((!map || !map->upload) && !(flags & WINED3D_MAP_DISCARD))
+    {
+        WARN("Mapping with WINED3D_MAP_NOOVERWRITE without a previous discard.\n");
+        return WINED3DERR_NOTAVAILABLE;
+    }
+
+    if (!map)
+    {
+        if (!wined3d_array_reserve((void **)&deferred->maps, &deferred->maps_capacity,
+                deferred->map_count + 1, sizeof(*deferred->maps)))
+            return E_OUTOFMEMORY;
+
+        map = &deferred->maps[deferred->map_count++];
+        memset(map, 0, sizeof(*map));
+        map->resource = resource;
+        map->sub_resource_idx = sub_resource_idx;
+        resource->resource_ops->resource_incref(resource);
+    }
+
+    if (map->mapped)
+    {
+        WARN("Sub-resource %u of resource %p is already mapped.\n", sub_resource_idx, resource);
+        return WINED3DERR_INVALIDCALL;
+    }
+
+    /* WINED3D_MAP_NOOVERWRITE promises not to touch data used by previously
+     * recorded commands, so writing to the previous block is fine. */
+    if (flags & WINED3D_MAP_DISCARD)
+    {
+        if (!(upload = wined3d_deferred_upload_create(size)))
+            return E_OUTOFMEMORY;
+        if (map->upload)
+            wined3d_deferred_upload_decref(map->upload);
+        map->upload = upload;
+    }
+
+    map->row_pitch = row_pitch;
+    map->slice_pitch = slice_pitch;
+    map->mapped = TRUE;
+
+    map_desc->row_pitch = row_pitch;
+    map_desc->slice_pitch = slice_pitch;
+    map_desc->data = map->upload->data;
+
+    return WINED3D_OK;
+}
+
+static HRESULT wined3d_deferred_context_unmap(struct wined3d_cs *cs,
+        struct wined3d_resource *resource, unsigned int sub_resource_idx)
+{
+    struct wined3d_deferred_context *deferred = wined3d_deferred_context_from_cs(cs);
+    struct wined3d_deferred_map *map;
+    struct wined3d_box box;
+
+    if (!(map = wined3d_deferred_context_find_map(deferred, resource, sub_resource_idx)) || !map->mapped)
+    {
+        WARN("Sub-resource %u of resource %p is not mapped.\n", sub_resource_idx, resource);
+        return WINED3DERR_INVALIDCALL;
+    }
+    map->mapped = FALSE;
+
+    if (resource->type == WINED3D_RTYPE_BUFFER)
+        wined3d_box_set(&box, 0, 0, resource->size, 1, 0, 1);
+    else
+        wined3d_texture_get_level_box(texture_from_resource(resource),
+                sub_resource_idx % texture_from_resource(resource)->level_count, &box);
+
+    if (!wined3d_deferred_context_record_upload(deferred, map->upload))
+    {
+        deferred->out_of_memory = TRUE;
+        return E_OUTOFMEMORY;
+    }
+
+    wined3d_cs_emit_update_sub_resource(cs, resource, sub_resource_idx, &box,
+            map->upload->data, map->row_pitch, map->slice_pitch);
+
+    return WINED3D_OK;
+}
+
+static const struct wined3d_cs_ops wined3d_deferred_context_cs_ops =
+{
+    wined3d_deferred_context_require_space,
+    wined3d_deferred_context_submit,
+    wined3d_deferred_context_finish,
+    wined3d_cs_mt_push_constants,
+    wined3d_deferred_context_acquire_resource,
+    wined3d_deferred_context_reference_object,
+    wined3d_deferred_context_update_sub_resource,
+    wined3d_deferred_context_map,
+    wined3d_deferred_context_unmap,
+};
+
+static void wined3d_deferred_context_release_maps(struct wined3d_deferred_context *deferred)
+{
+    struct wined3d_deferred_map *map;
+    SIZE_T i;
+
+    for (i = 0; i < deferred->map_count; ++i)
+    {
+        map = &deferred->maps[i];
+        if (map->mapped)
+            WARN("Sub-resource %u of resource %p is still mapped.\n", map->sub_resource_idx, map->resource);
+        if (map->upload)
+            wined3d_deferred_upload_decref(map->upload);
+        map->resource->resource_ops->resource_decref(map->resource);
+    }
+    deferred->map_count = 0;
+}
+
+HRESULT CDECL wined3d_device_context_issue_query(struct wined3d_device_context *context,
+        struct wined3d_query *query, DWORD flags)
+{
+    struct wined3d_cs *cs = wined3d_cs_from_context(context);
+    struct wined3d_deferred_context *deferred;
+    struct wined3d_deferred_query *deferred_query;
+
+    TRACE("context %p, query %p, flags %#x.\n", context, query, flags);
+
+    if (!(context->state->flags & WINED3D_STATE_DEFERRED))
+        return wined3d_query_issue(query, flags);
+
+    deferred = wined3d_deferred_context_from_cs(cs);
+    if (!wined3d_array_reserve((void **)&deferred->queries, &deferred->queries_capacity,
+            deferred->query_count + 1, sizeof(*deferred->queries)))
+        return E_OUTOFMEMORY;
+
+    deferred_query = &deferred->queries[deferred->query_count++];
+    deferred_query->query = query;
+    deferred_query->flags = flags;
+
+    wined3d_cs_reference_object(cs, WINED3D_CS_OBJECT_QUERY, query);
+    wined3d_cs_emit_query_issue(cs, query, flags);
+
+    return WINED3D_OK;
+}
+
+HRESULT CDECL wined3d_deferred_context_create(struct wined3d_device *device, struct wined3d_device_context **context)
+{
+    struct wined3d_deferred_context *object;
+
+    TRACE("device %p, context %p.\n", device, context);
+
+    if (!(object = heap_alloc_zero(sizeof(*object))))
+        return E_OUTOFMEMORY;
+
+    object->cs.ops = &wined3d_deferred_context_cs_ops;
+    object->cs.device = device;
+    object->cs.c.device = device;
+    object->cs.c.state = &object->state;
+    state_init(&object->state, &device->adapter->d3d_info, WINED3D_STATE_INIT_DEFAULT | WINED3D_STATE_DEFERRED);
+
+    wined3d_device_incref(device);
+
+    TRACE("Created deferred context %p.\n", object);
+    *context = &object->cs.c;
+
+    return WINED3D_OK;
+}
+
+/* Drop everything recorded since the last command list. */
+static void wined3d_deferred_context_discard_recording(struct wined3d_deferred_context *deferred)
+{
+    struct wined3d_resource *resource;
+    SIZE_T i;
+
+    for (i = 0; i < deferred->resource_count; ++i)
+    {
+        resource = deferred->resources[i];
+        resource->resource_ops->resource_decref(resource);
+    }
+    for (i = 0; i < deferred->reference_count; ++i)
+        wined3d_cs_object_decref(&deferred->references[i]);
+    for (i = 0; i < deferred->upload_count; ++i)
+        wined3d_deferred_upload_decref(deferred->uploads[i]);
+
+    deferred->data_size = 0;
+    deferred->resource_count = 0;
+    deferred->reference_count = 0;
+    deferred->upload_count = 0;
+    deferred->query_count = 0;
+    deferred->out_of_memory = FALSE;
+}
+
+void CDECL wined3d_deferred_context_destroy(struct wined3d_device_context *context)
+{
+    struct wined3d_deferred_context *deferred = wined3d_deferred_context_from_cs(wined3d_cs_from_context(context));
+    struct wined3d_device *device = context->device;
+
+    TRACE("context %p.\n", context);
+
+    wined3d_device_context_cleanup_state(context);
+    wined3d_deferred_context_release_maps(deferred);
+    wined3d_deferred_context_discard_recording(deferred);
+
+    heap_free(deferred->queries);
+    heap_free(deferred->maps);
+    heap_free(deferred->uploads);
+    heap_free(deferred->references);
+    heap_free(deferred->resources);
+    heap_free(deferred->data);
+    heap_free(deferred);
+
+    wined3d_device_decref(device);
+}
+
+HRESULT CDECL wined3d_deferred_context_record_command_list(struct wined3d_device_context *context,
+        BOOL restore_state, struct wined3d_command_list **list)
+{
+    struct wined3d_deferred_context *deferred = wined3d_deferred_context_from_cs(wined3d_cs_from_context(context));
+    const struct wined3d_state *default_state;
+    struct wined3d_command_list *object;
+
+    TRACE("context %p, restore_state %#x, list %p.\n", context, restore_state, list);
+
+    if (!(default_state = wined3d_device_get_default_state(context->device)))
+        return E_OUTOFMEMORY;
+
+    if (deferred->out_of_memory)
+    {
+        /* Packets are missing, executing the list would render garbage. */
+        ERR("Failed to record some commands, discarding the command list.\n");
+        wined3d_deferred_context_discard_recording(deferred);
+        wined3d_deferred_context_release_maps(deferred);
+        if (restore_state)
+            wined3d_cs_emit_state_transition(&deferred->cs, default_state, &deferred->state);
+        else
+            wined3d_device_context_reset_state(context);
+        return E_OUTOFMEMORY;
+    }
+
+    if (!(object = heap_alloc_zero(sizeof(*object))))
+        return E_OUTOFMEMORY;
+
+    if (!(object->state = heap_alloc(sizeof(*object->state))))
+    {
+        heap_free(object);
+        return E_OUTOFMEMORY;
+    }
+    /* The list owns references to everything bound in the copy through the
+     * packets that bound it. */
+    memcpy(object->state, &deferred->state, sizeof(*object->state));
+
+    object->refcount = 1;
+    object->device = context->device;
+
+    object->data_size = deferred->data_size;
+    object->data = deferred->data;
+    object->resource_count = deferred->resource_count;
+    object->resources = deferred->resources;
+    object->reference_count = deferred->reference_count;
+    object->references = deferred->references;
+    object->upload_count = deferred->upload_count;
+    object->uploads = deferred->uploads;
+    object->query_count = deferred->query_count;
+    object->queries = deferred->queries;
+
+    deferred->data_size = deferred->data_capacity = 0;
+    deferred->data = NULL;
+    deferred->resource_count = deferred->resources_capacity = 0;
+    deferred->resources = NULL;
+    deferred->reference_count = deferred->references_capacity = 0;
+    deferred->references = NULL;
+    deferred->upload_count = deferred->uploads_capacity = 0;
+    deferred->uploads = NULL;
+    deferred->query_count = deferred->queries_capacity = 0;
+    deferred->queries = NULL;
+
+    /* Maps don't carry over between command lists. */
+    wined3d_deferred_context_release_maps(deferred);
+
+    /* The next list starts from the default state as well; when restoring,
+     * record the changes needed to get back to the current state. */
+    if (restore_state)
+        wined3d_cs_emit_state_transition(&deferred->cs, default_state, &deferred->state);
+    else
+        wined3d_device_context_reset_state(context);
+
+    TRACE("Created command list %p.\n", object);
+    *list = object;
+
+    return WINED3D_OK;
+}
@@ -141,6 +141,19 @@ struct shader_glsl_priv
     struct wine_rb_tree ffp_fragment_shaders;
     BOOL ffp_proj_control;
     BOOL legacy_lighting;
+
+    struct wined3d_shader_cache *shader_cache;
+    struct wined3d_shader_cache_hash cache_seed;
+    BOOL cache_initialised;
+};
+
+struct glsl_program_link_args
+{
+    WORD attribs_map;
+    BOOL dual_source;
+    BOOL explicit_attrib_location;
+    BOOL legacy_fragment_output;
+    const struct wined3d_stream_output_desc *so_desc;
 };
 
 struct glsl_vs_program
@@ -639,6 +652,295 @@ void shader_glsl_validate_link(const struct wined3d_gl_info *gl_info, GLuint pro
     print_glsl_info_log(gl_info, program, TRUE);
 }
 
+/* Context activation is done by the caller. */
+static void shader_glsl_init_program_cache(const struct wined3d_gl_info *gl_info, struct shader_glsl_priv *priv)
+{
+    GLint format_count = 0;
+
+    if (priv->cache_initialised)
+        return;
+    priv->cache_initialised = TRUE;
+
+    if (!priv->shader_cache)
+        return;
+
+    gl_info->gl_ops.gl.p_glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &format_count);
+    checkGLcall("glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS)");
+    if (!format_count)
+    {
+        TRACE("No program binary formats supported, disabling the shader cache.\n");
+        wined3d_shader_cache_release(priv->shader_cache);
+        priv->shader_cache = NULL;
+        return;
+    }
+
+    /* Program binaries are only valid for the driver that created them. */
+    wined3d_shader_cache_hash_init(&priv->cache_seed);
+    wined3d_shader_cache_hash_update_string(&priv->cache_seed,
+            (const char *)gl_info->gl_ops.gl.p_glGetString(GL_VENDOR));
+    wined3d_shader_cache_hash_update_string(&priv->cache_seed,
+            (const char *)gl_info->gl_ops.gl.p_glGetString(GL_RENDERER));
+    wined3d_shader_cache_hash_update_string(&priv->cache_seed,
+            (const char *)gl_info->gl_ops.gl.p_glGetString(GL_VERSION));
+}
+
+/* The key is derived from the GLSL source of the attached shaders, rather
+ * than from the D3D byte code and compile arguments, so that anything that
+ * influences code generation is implicitly part of it. */
+/* Context activation is done by the caller. */
+static BOOL shader_glsl_get_program_cache_key(const struct wined3d_gl_info *gl_info,
+        const struct shader_glsl_priv *priv, GLuint program_id, const struct glsl_program_link_args *args,
+        struct wined3d_shader_cache_key *key)
+{
+    const struct wined3d_stream_output_desc *so_desc = args->so_desc;
+    struct wined3d_shader_cache_hash hash = priv->cache_seed;
+    GLint shader_count, length, type;
+    GLuint shaders[8];
+    unsigned int i;
+    char *source;
+
+    GL_EXTCALL(glGetProgramiv(program_id, GL_ATTACHED_SHADERS, &shader_count));
+    if (shader_count > ARRAY_SIZE(shaders))
+        return FALSE;
+    GL_EXTCALL(glGetAttachedShaders(program_id, ARRAY_SIZE(shaders), &shader_count, shaders));
+
+    for (i = 0; i < shader_count; ++i)
+    {
+        GL_EXTCALL(glGetShaderiv(shaders[i], GL_SHADER_TYPE, &type));
+        GL_EXTCALL(glGetShaderiv(shaders[i], GL_SHADER_SOURCE_LENGTH, &length));
+        if (length <= 0 || !(source = heap_alloc(length)))
+            return FALSE;
+        GL_EXTCALL(glGetShaderSource(shaders[i], length, NULL, source));
+        wined3d_shader_cache_hash_update(&hash, &type, sizeof(type));
+        wined3d_shader_cache_hash_update_string(&hash, source);
+        heap_free(source);
+    }
+    checkGLcall("get shader sources");
+
+    wined3d_shader_cache_hash_update(&hash, &args->attribs_map, sizeof(args->attribs_map));
+    wined3d_shader_cache_hash_update(&hash, &args->dual_source, sizeof(args->dual_source));
+    wined3d_shader_cache_hash_update(&hash, &args->explicit_attrib_location, sizeof(args->explicit_attrib_location));
+    wined3d_shader_cache_hash_update(&hash, &args->legacy_fragment_output, sizeof(args->legacy_fragment_output));
+    if (so_desc)
+    {
+        for (i = 0; i < so_desc->element_count; ++i)
+        {
+            const struct wined3d_stream_output_element *e = &so_desc->elements[i];
+
+            wined3d_shader_cache_hash_update(&hash, &e->stream_idx, sizeof(e->stream_idx));
+            wined3d_shader_cache_hash_update_string(&hash, e->semantic_name);
+            wined3d_shader_cache_hash_update(&hash, &e->semantic_idx, sizeof(e->semantic_idx));
+            wined3d_shader_cache_hash_update(&hash, &e->component_idx, sizeof(e->component_idx));
+            wined3d_shader_cache_hash_update(&hash, &e->component_count, sizeof(e->component_count));
+            wined3d_shader_cache_hash_update(&hash, &e->output_slot, sizeof(e->output_slot));
+        }
+        wined3d_shader_cache_hash_update(&hash, so_desc->buffer_strides,
+                so_desc->buffer_stride_count * sizeof(*so_desc->buffer_strides));
+        wined3d_shader_cache_hash_update(&hash, &so_desc->rasterizer_stream_idx,
+                sizeof(so_desc->rasterizer_stream_idx));
+    }
+
+    wined3d_shader_cache_hash_final(&hash, key);
+    return TRUE;
+}
+
+/* Context activation is done by the caller. */
+static BOOL shader_glsl_load_program_binary(const struct wined3d_gl_info *gl_info,
+        struct shader_glsl_priv *priv, GLuint program_id, const struct wined3d_shader_cache_key *key)
+{
+    GLint status;
+    GLenum format;
+    size_t size;
+    BYTE *data;
+
+    if (!(data = wined3d_shader_cache_get(priv->shader_cache, key, &size)))
+        return FALSE;
+
+    if (size <= sizeof(format))
+    {
+        heap_free(data);
+        return FALSE;
+    }
+
+    memcpy(&format, data, sizeof(format));
+    GL_EXTCALL(glProgramBinary(program_id, format, data + sizeof(format), size - sizeof(format)));
+    heap_free(data);
+    GL_EXTCALL(glGetProgramiv(program_id, GL_LINK_STATUS, &status));
+    checkGLcall("glProgramBinary");
+    if (!status)
+    {
+        WARN("Failed to load cached binary for program %u.\n", program_id);
+        return FALSE;
+    }
+
+    TRACE("Loaded GLSL shader program %u from the shader cache.\n", program_id);
+    return TRUE;
+}
+
+/* Context activation is done by the caller. */
+static void shader_glsl_store_program_binary(const struct wined3d_gl_info *gl_info,
+        struct shader_glsl_priv *priv, GLuint program_id, const struct wined3d_shader_cache_key *key)
+{
+    GLint status, length;
+    GLenum format;
+    BYTE *data;
+
+    GL_EXTCALL(glGetProgramiv(program_id, GL_LINK_STATUS, &status));
+    if (!status)
+        return;
+    GL_EXTCALL(glGetProgramiv(program_id, GL_PROGRAM_BINARY_LENGTH, &length));
+    if (length <= 0 || !(data = heap_alloc(sizeof(format) + length)))
+        return;
+
+    GL_EXTCALL(glGetProgramBinary(program_id, length, &length, &format, data + sizeof(format)));
+    checkGLcall("glGetProgramBinary");
+    if (length > 0)
+    {
+        memcpy(data, &format, sizeof(format));
+        wined3d_shader_cache_put(priv->shader_cache, key, data, sizeof(format) + length);
+    }
+    heap_free(data);
+}
+
+/* Shader objects created from cached GLSL source are only compiled when the
+ * program they're attached to isn't in the shader cache either. */
+/* Context activation is done by the caller. */
+static void shader_glsl_compile_attached_shaders(const struct wined3d_gl_info *gl_info, GLuint program_id)
+{
+    GLint shader_count, status;
+    GLuint shaders[8];
+    unsigned int i;
+
+    GL_EXTCALL(glGetAttachedShaders(program_id, ARRAY_SIZE(shaders), &shader_count, shaders));
+    for (i = 0; i < shader_count; ++i)
+    {
+        GL_EXTCALL(glGetShaderiv(shaders[i], GL_COMPILE_STATUS, &status));
+        if (status)
+            continue;
+
+        TRACE("Compiling shader object %u.\n", shaders[i]);
+        GL_EXTCALL(glCompileShader(shaders[i]));
+        checkGLcall("glCompileShader");
+        print_glsl_info_log(gl_info, shaders[i], FALSE);
+    }
+}
+
+/* The key covers everything GLSL generation for a vertex or pixel shader
+ * depends on: the driver, the wined3d build and settings, the D3D byte code
+ * and the compile arguments. */
+/* Context activation is done by the caller. */
+static void shader_glsl_get_shader_cache_key(const struct wined3d_context_gl *context_gl,
+        const struct shader_glsl_priv *priv, const struct wined3d_shader *shader,
+        const void *args, size_t args_size, struct wined3d_shader_cache_key *key)
+{
+    const struct wined3d_gl_info *gl_info = context_gl->gl_info;
+    struct wined3d_shader_cache_hash hash = priv->cache_seed;
+    enum wined3d_shader_type type = shader->reg_maps.shader_version.type;
+    struct wined3d_d3d_info d3d_info;
+
+    wined3d_shader_cache_hash_update_string(&hash, PACKAGE_VERSION);
+    wined3d_shader_cache_hash_update(&hash, &gl_info->glsl_version, sizeof(gl_info->glsl_version));
+    wined3d_shader_cache_hash_update(&hash, &gl_info->limits, sizeof(gl_info->limits));
+    wined3d_shader_cache_hash_update(&hash, &gl_info->quirks, sizeof(gl_info->quirks));
+    wined3d_shader_cache_hash_update(&hash, gl_info->supported, sizeof(gl_info->supported));
+
+    /* The attribute callbacks don't influence code generation, and their
+     * addresses aren't stable across runs. */
+    memcpy(&d3d_info, context_gl->c.d3d_info, sizeof(d3d_info));
+    memset(&d3d_info.ffp_attrib_ops, 0, sizeof(d3d_info.ffp_attrib_ops));
+    wined3d_shader_cache_hash_update(&hash, &d3d_info, sizeof(d3d_info));
+
+    wined3d_shader_cache_hash_update(&hash, &wined3d_settings.check_float_constants,
+            sizeof(wined3d_settings.check_float_constants));
+    wined3d_shader_cache_hash_update(&hash, &wined3d_settings.strict_shader_math,
+            sizeof(wined3d_settings.strict_shader_math));
+    wined3d_shader_cache_hash_update(&hash, &wined3d_settings.offscreen_rendering_mode,
+            sizeof(wined3d_settings.offscreen_rendering_mode));
+
+    wined3d_shader_cache_hash_update(&hash, &type, sizeof(type));
+    wined3d_shader_cache_hash_update(&hash, shader->byte_code, shader->byte_code_size);
+    wined3d_shader_cache_hash_update(&hash, shader->limits, sizeof(*shader->limits));
+    wined3d_shader_cache_hash_update(&hash, &shader->load_local_constsF, sizeof(shader->load_local_constsF));
+    wined3d_shader_cache_hash_update(&hash, &shader->lconst_inf_or_nan, sizeof(shader->lconst_inf_or_nan));
+    wined3d_shader_cache_hash_update(&hash, args, args_size);
+
+    wined3d_shader_cache_hash_final(&hash, key);
+}
+
+/* Context activation is done by the caller. */
+static GLuint shader_glsl_load_shader_source(const struct wined3d_gl_info *gl_info,
+        struct shader_glsl_priv *priv, GLenum type, const struct wined3d_shader_cache_key *key,
+        void *header, size_t header_size)
+{
+    const char *src;
+    GLuint shader_id;
+    size_t size;
+    BYTE *data;
+
+    if (!(data = wined3d_shader_cache_get(priv->shader_cache, key, &size)))
+        return 0;
+
+    if (size <= header_size || data[size - 1])
+    {
+        heap_free(data);
+        return 0;
+    }
+
+    if (header_size)
+        memcpy(header, data, header_size);
+    src = (const char *)data + header_size;
+    shader_id = GL_EXTCALL(glCreateShader(type));
+    GL_EXTCALL(glShaderSource(shader_id, 1, &src, NULL));
+    checkGLcall("glShaderSource");
+    heap_free(data);
+
+    TRACE("Loaded GLSL source for shader object %u from the shader cache.\n", shader_id);
+    return shader_id;
+}
+
+static void shader_glsl_store_shader_source(struct shader_glsl_priv *priv, const struct wined3d_shader_cache_key *key,
+        const void *header, size_t header_size, const struct wined3d_string_buffer *buffer)
+{
+    size_t length = buffer->content_size + 1;
+    BYTE *data;
+
+    if (!(data = heap_alloc(header_size + length)))
+        return;
+
+    if (header_size)
+        memcpy(data, header, header_size);
+    memcpy(data + header_size, buffer->buffer, length);
+    wined3d_shader_cache_put(priv->shader_cache, key, data, header_size + length);
+    heap_free(data);
+}
+
+/* Context activation is done by the caller. */
+static void shader_glsl_link_program(const struct wined3d_gl_info *gl_info, struct shader_glsl_priv *priv,
+        GLuint program_id, const struct glsl_program_link_args *args)
+{
+    struct wined3d_shader_cache_key key;
+    BOOL cacheable;
+
+    shader_glsl_init_program_cache(gl_info, priv);
+
+    if ((cacheable = priv->shader_cache && shader_glsl_get_program_cache_key(gl_info, priv, program_id, args, &key)))
+    {
+        if (shader_glsl_load_program_binary(gl_info, priv, program_id, &key))
+            return;
+        GL_EXTCALL(glProgramParameteri(program_id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE));
+    }
+
+    if (priv->shader_cache)
+        shader_glsl_compile_attached_shaders(gl_info, program_id);
+
+    TRACE("Linking GLSL shader program %u.\n", program_id);
+    GL_EXTCALL(glLinkProgram(program_id));
+    shader_glsl_validate_link(gl_info, program_id);
+
+    if (cacheable)
+        shader_glsl_store_program_binary(gl_info, priv, program_id, &key);
+}
+
 static BOOL shader_glsl_use_layout_qualifier(const struct wined3d_gl_info *gl_info)
 {
     /* Layout qualifiers were introduced in GLSL 1.40. The Nvidia Legacy GPU
@@ -8461,12 +8763,13 @@ static GLuint shader_glsl_generate_compute_shader(const struct wined3d_context_g
 }
 
 static GLuint find_glsl_fragment_shader(const struct wined3d_context_gl *context_gl,
-        struct wined3d_string_buffer *buffer, struct wined3d_string_buffer_list *string_buffers,
-        struct wined3d_shader *shader,
+        struct shader_glsl_priv *priv, struct wined3d_shader *shader,
         const struct ps_compile_args *args, const struct ps_np2fixup_info **np2fixup_info)
 {
     struct glsl_ps_compiled_shader *gl_shaders, *new_array;
+    struct wined3d_string_buffer *buffer = &priv->shader_buffer;
     struct glsl_shader_private *shader_data;
+    struct wined3d_shader_cache_key key;
     struct ps_np2fixup_info *np2fixup;
     UINT i;
     DWORD new_size;
@@ -8526,10 +8829,25 @@ static GLuint find_glsl_fragment_shader(const struct wined3d_context_gl *context
     memset(np2fixup, 0, sizeof(*np2fixup));
     *np2fixup_info = args->np2_fixup ? np2fixup : NULL;
 
+    shader_glsl_init_program_cache(context_gl->gl_info, priv);
+    if (priv->shader_cache)
+    {
+        shader_glsl_get_shader_cache_key(context_gl, priv, shader, args, sizeof(*args), &key);
+        if ((ret = shader_glsl_load_shader_source(context_gl->gl_info, priv,
+                GL_FRAGMENT_SHADER, &key, np2fixup, sizeof(*np2fixup))))
+        {
+            gl_shaders[shader_data->num_gl_shaders++].id = ret;
+            return ret;
+        }
+    }
+
     string_buffer_clear(buffer);
-    ret = shader_glsl_generate_fragment_shader(context_gl, buffer, string_buffers, shader, args, np2fixup);
+    ret = shader_glsl_generate_fragment_shader(context_gl, buffer, &priv->string_buffers, shader, args, np2fixup);
     gl_shaders[shader_data->num_gl_shaders++].id = ret;
 
+    if (priv->shader_cache)
+        shader_glsl_store_shader_source(priv, &key, np2fixup, sizeof(*np2fixup), buffer);
+
     return ret;
 }
 
@@ -8561,6 +8879,8 @@ static GLuint find_glsl_vertex_shader(const struct wined3d_context_gl *context_g
     struct glsl_vs_compiled_shader *gl_shaders, *new_array;
     uint32_t use_map = context_gl->c.stream_info.use_map;
     struct glsl_shader_private *shader_data;
+    struct wined3d_shader_cache_key key;
+    struct vs_compile_args key_args;
     unsigned int i, new_size;
     GLuint ret;
 
@@ -8611,10 +8931,36 @@ static GLuint find_glsl_vertex_shader(const struct wined3d_context_gl *context_g
 
     gl_shaders[shader_data->num_gl_shaders].args = *args;
 
+    shader_glsl_init_program_cache(context_gl->gl_info, priv);
+    if (priv->shader_cache)
+    {
+        /* Only hash the fields vs_args_equal() compares, so that padding
+         * doesn't end up in the key. */
+        memset(&key_args, 0, sizeof(key_args));
+        key_args.fog_src = args->fog_src;
+        key_args.clip_enabled = args->clip_enabled;
+        key_args.point_size = args->point_size;
+        key_args.per_vertex_point_size = args->per_vertex_point_size;
+        key_args.flatshading = args->flatshading;
+        key_args.next_shader_type = args->next_shader_type;
+        key_args.swizzle_map = args->swizzle_map;
+        key_args.next_shader_input_count = args->next_shader_input_count;
+        memcpy(key_args.interpolation_mode, args->interpolation_mode, sizeof(key_args.interpolation_mode));
+        shader_glsl_get_shader_cache_key(context_gl, priv, shader, &key_args, sizeof(key_args), &key);
+        if ((ret = shader_glsl_load_shader_source(context_gl->gl_info, priv, GL_VERTEX_SHADER, &key, NULL, 0)))
+        {
+            gl_shaders[shader_data->num_gl_shaders++].id = ret;
+            return ret;
+        }
+    }
+
     string_buffer_clear(&priv->shader_buffer);
     ret = shader_glsl_generate_vertex_shader(context_gl, priv, shader, args);
     gl_shaders[shader_data->num_gl_shaders++].id = ret;
 
+    if (priv->shader_cache)
+        shader_glsl_store_shader_source(priv, &key, NULL, 0, &priv->shader_buffer);
+
     return ret;
 }
 
@@ -10054,6 +10400,7 @@ static HRESULT shader_glsl_compile_compute_shader(struct shader_glsl_priv *priv,
     struct glsl_context_data *ctx_data = context_gl->c.shader_backend_data;
     const struct wined3d_gl_info *gl_info = context_gl->gl_info;
     struct wined3d_string_buffer *buffer = &priv->shader_buffer;
+    struct glsl_program_link_args link_args;
     struct glsl_cs_compiled_shader *gl_shaders;
     struct glsl_shader_private *shader_data;
     struct glsl_shader_prog_link *entry;
@@ -10111,9 +10458,8 @@ static HRESULT shader_glsl_compile_compute_shader(struct shader_glsl_priv *priv,
 
     list_add_head(&shader->linked_programs, &entry->cs.shader_entry);
 
-    TRACE("Linking GLSL shader program %u.\n", program_id);
-    GL_EXTCALL(glLinkProgram(program_id));
-    shader_glsl_validate_link(gl_info, program_id);
+    memset(&link_args, 0, sizeof(link_args));
+    shader_glsl_link_program(gl_info, priv, program_id, &link_args);
 
     GL_EXTCALL(glUseProgram(program_id));
     checkGLcall("glUseProgram");
@@ -10193,6 +10539,7 @@ static void set_glsl_shader_program(const struct wined3d_context_gl *context_gl,
     GLuint ds_id = 0;
     GLuint gs_id = 0;
     GLuint ps_id = 0;
+    struct glsl_program_link_args link_args;
     struct list *ps_list, *vs_list;
     WORD attribs_map;
     struct wined3d_string_buffer *tmp_name;
@@ -10278,8 +10625,7 @@ static void set_glsl_shader_program(const struct wined3d_context_gl *context_gl,
         pshader = state->shader[WINED3D_SHADER_TYPE_PIXEL];
         find_ps_compile_args(state, pshader, context_gl->c.stream_info.position_transformed,
                 &ps_compile_args, &context_gl->c);
-        ps_id = find_glsl_fragment_shader(context_gl, &priv->shader_buffer, &priv->string_buffers,
-                pshader, &ps_compile_args, &np2fixup_info);
+        ps_id = find_glsl_fragment_shader(context_gl, priv, pshader, &ps_compile_args, &np2fixup_info);
         ps_list = &pshader->linked_programs;
     }
     else if (priv->fragment_pipe == &glsl_fragment_pipe
@@ -10338,6 +10684,13 @@ static void set_glsl_shader_program(const struct wined3d_context_gl *context_gl,
         list_add_head(vs_list, &entry->vs.shader_entry);
     }
 
+    memset(&link_args, 0, sizeof(link_args));
+    link_args.explicit_attrib_location = shader_glsl_use_explicit_attrib_location(gl_info);
+    link_args.legacy_fragment_output = use_legacy_fragment_output(gl_info);
+    link_args.dual_source = state->blend_state && state->blend_state->dual_source;
+    if (gshader)
+        link_args.so_desc = gshader->u.gs.so_desc;
+
     if (vshader)
     {
         attribs_map = vshader->reg_maps.input_registers;
@@ -10359,6 +10712,7 @@ static void set_glsl_shader_program(const struct wined3d_context_gl *context_gl,
     {
         attribs_map = (1u << WINED3D_FFP_ATTRIBS_COUNT) - 1;
     }
+    link_args.attribs_map = attribs_map;
 
     if (!shader_glsl_use_explicit_attrib_location(gl_info))
     {
@@ -10444,9 +10798,7 @@ static void set_glsl_shader_program(const struct wined3d_context_gl *context_gl,
     }
 
     /* Link the program */
-    TRACE("Linking GLSL shader program %u.\n", program_id);
-    GL_EXTCALL(glLinkProgram(program_id));
-    shader_glsl_validate_link(gl_info, program_id);
+    shader_glsl_link_program(gl_info, priv, program_id, &link_args);
 
     shader_glsl_init_vs_uniform_locations(gl_info, priv, program_id, &entry->vs,
             vshader ? vshader->limits->constant_float : 0);
@@ -10987,6 +11339,7 @@ static HRESULT shader_glsl_alloc(struct wined3d_device *device, const struct win
         const struct wined3d_fragment_pipe_ops *fragment_pipe)
 {
     SIZE_T stack_size = wined3d_log2i(max(WINED3D_MAX_VS_CONSTS_F, WINED3D_MAX_PS_CONSTS_F)) + 1;
+    static const WCHAR glslW[] = {'g','l','s','l',0};
     struct fragment_caps fragment_caps;
     void *vertex_priv, *fragment_priv;
     struct shader_glsl_priv *priv;
@@ -11043,6 +11396,8 @@ static HRESULT shader_glsl_alloc(struct wined3d_device *device, const struct win
     fragment_pipe->get_caps(device->adapter, &fragment_caps);
     priv->ffp_proj_control = fragment_caps.wined3d_caps & WINED3D_FRAGMENT_CAP_PROJ_CONTROL;
     priv->legacy_lighting = device->wined3d->flags & WINED3D_LEGACY_FFP_LIGHTING;
+    if (device->adapter->gl_info.supported[ARB_GET_PROGRAM_BINARY])
+        priv->shader_cache = wined3d_shader_cache_acquire(glslW);
 
     device->vertex_priv = vertex_priv;
     device->fragment_priv = fragment_priv;
@@ -11066,6 +11421,7 @@ static void shader_glsl_free(struct wined3d_device *device, struct wined3d_conte
 {
     struct shader_glsl_priv *priv = device->shader_priv;
 
+    wined3d_shader_cache_release(priv->shader_cache);
     wine_rb_destroy(&priv->program_lookup, NULL, NULL);
     constant_heap_free(&priv->pconst_heap);
     constant_heap_free(&priv->vconst_heap);
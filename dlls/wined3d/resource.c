@@ -372,6 +372,11 @@ HRESULT CDECL wined3d_resource_map(struct wined3d_resource *resource, unsigned i
     }
 
     flags = wined3d_resource_sanitise_map_flags(resource, flags);
+
+    if (resource->type == WINED3D_RTYPE_BUFFER && !sub_resource_idx && wined3d_cs_map_upload_buffer(
+            resource->device->cs, buffer_from_resource(resource), map_desc, box, flags))
+        return WINED3D_OK;
+
     wined3d_resource_wait_idle(resource);
 
     return wined3d_cs_map(resource->device->cs, resource, sub_resource_idx, map_desc, box, flags);
@@ -381,6 +386,10 @@ HRESULT CDECL wined3d_resource_unmap(struct wined3d_resource *resource, unsigned
 {
     TRACE("resource %p, sub_resource_idx %u.\n", resource, sub_resource_idx);
 
+    if (resource->type == WINED3D_RTYPE_BUFFER && !sub_resource_idx
+            && wined3d_cs_unmap_upload_buffer(resource->device->cs, buffer_from_resource(resource)))
+        return WINED3D_OK;
+
     return wined3d_cs_unmap(resource->device->cs, resource, sub_resource_idx);
 }
 
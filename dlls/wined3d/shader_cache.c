@@ -0,0 +1,907 @@
+/*
+ * Persistent shader cache
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include "config.h"
+#include "wine/port.h"
+#include "wined3d_private.h"
+
+WINE_DEFAULT_DEBUG_CHANNEL(d3d_shader);
+
+/* Each cache entry is stored in its own file, named after its key, inside a
+ * per-application, per-backend directory. Entries are evicted in least
+ * recently used order once the total size exceeds the configured limit. All
+ * devices using the same directory share one cache.
+ *
+ * Only an index of the entries is kept in memory; the data is read from disk
+ * when an entry is requested. Writing, touching and deleting files is done by
+ * a cache thread, which also builds the index when the cache is created, and
+ * then reads the most recently used entries ahead of their first use. Until
+ * an entry has been written, its data is kept with the pending write, so that
+ * it can still be returned from memory. */
+
+#define WINED3D_SHADER_CACHE_MAGIC        0x43533357u /* "W3SC" */
+#define WINED3D_SHADER_CACHE_VERSION      1u
+#define WINED3D_SHADER_CACHE_MAX_ENTRY    (64u * 1024 * 1024)
+#define WINED3D_SHADER_CACHE_PRELOAD_SIZE (32u * 1024 * 1024)
+
+struct wined3d_shader_cache_file_header
+{
+    uint32_t magic;
+    uint32_t version;
+    struct wined3d_shader_cache_key key;
+    uint32_t size;
+    uint32_t checksum;
+};
+
+struct wined3d_shader_cache_entry
+{
+    struct wine_rb_entry entry;
+    struct list lru_entry;
+    struct wined3d_shader_cache_key key;
+    uint32_t size;
+    BOOL touched;
+    /* Owned by the pending write operation, if any. */
+    const void *data;
+    /* Read ahead by the cache thread, handed over to the first lookup. */
+    void *preloaded;
+};
+
+enum wined3d_shader_cache_op_type
+{
+    WINED3D_SHADER_CACHE_OP_WRITE,
+    WINED3D_SHADER_CACHE_OP_TOUCH,
+    WINED3D_SHADER_CACHE_OP_DELETE,
+};
+
+struct wined3d_shader_cache_op
+{
+    struct list entry;
+    enum wined3d_shader_cache_op_type type;
+    struct wined3d_shader_cache_key key;
+    uint32_t size;
+    void *data;
+};
+
+struct wined3d_shader_cache
+{
+    struct list entry;
+    LONG refcount;
+
+    CRITICAL_SECTION cs;
+    WCHAR path[MAX_PATH];
+    struct wine_rb_tree entries;
+    struct list lru;
+    uint64_t total_size;
+    uint64_t max_size;
+
+    struct list ops;
+    HANDLE event;
+    HANDLE thread;
+    LONG indexed;
+    LONG stop;
+
+    /* Only accessed by the cache thread. */
+    struct wined3d_shader_cache_key *preload_keys;
+    SIZE_T preload_count, preload_idx;
+};
+
+static struct list shader_caches = LIST_INIT(shader_caches);
+
+static CRITICAL_SECTION shader_caches_cs;
+static CRITICAL_SECTION_DEBUG shader_caches_cs_debug =
+{
+    0, 0, &shader_caches_cs,
+    {&shader_caches_cs_debug.ProcessLocksList,
+    &shader_caches_cs_debug.ProcessLocksList},
+    0, 0, {(DWORD_PTR)(__FILE__ ": shader_caches_cs")}
+};
+static CRITICAL_SECTION shader_caches_cs = {&shader_caches_cs_debug, -1, 0, 0, 0, 0};
+
+static const WCHAR bin_extW[] = {'.','b','i','n',0};
+
+#define FNV1A_64_PRIME 0x100000001b3ull
+
+void wined3d_shader_cache_hash_init(struct wined3d_shader_cache_hash *hash)
+{
+    hash->h[0] = 0xcbf29ce484222325ull;
+    hash->h[1] = 0x84222325cbf29ce4ull;
+}
+
+void wined3d_shader_cache_hash_update(struct wined3d_shader_cache_hash *hash, const void *data, size_t size)
+{
+    const uint8_t *p = data;
+    uint64_t h0 = hash->h[0], h1 = hash->h[1];
+    size_t i;
+
+    for (i = 0; i < size; ++i)
+    {
+        h0 = (h0 ^ p[i]) * FNV1A_64_PRIME;
+        h1 = (h1 ^ p[i] ^ (h0 >> 32)) * FNV1A_64_PRIME;
+    }
+
+    hash->h[0] = h0;
+    hash->h[1] = h1;
+}
+
+void wined3d_shader_cache_hash_update_string(struct wined3d_shader_cache_hash *hash, const char *s)
+{
+    static const char null_marker = 0x7f;
+
+    if (!s)
+        wined3d_shader_cache_hash_update(hash, &null_marker, sizeof(null_marker));
+    else
+        wined3d_shader_cache_hash_update(hash, s, strlen(s) + 1);
+}
+
+void wined3d_shader_cache_hash_final(const struct wined3d_shader_cache_hash *hash,
+        struct wined3d_shader_cache_key *key)
+{
+    key->hash[0] = hash->h[0];
+    key->hash[1] = hash->h[1] ^ (hash->h[0] >> 29);
+}
+
+static uint32_t wined3d_shader_cache_checksum(const void *data, size_t size)
+{
+    struct wined3d_shader_cache_hash hash;
+
+    wined3d_shader_cache_hash_init(&hash);
+    wined3d_shader_cache_hash_update(&hash, data, size);
+    return hash.h[0] ^ (hash.h[0] >> 32);
+}
+
+static int wined3d_shader_cache_entry_compare(const void *key, const struct wine_rb_entry *entry)
+{
+    const struct wined3d_shader_cache_entry *e = WINE_RB_ENTRY_VALUE(entry, struct wined3d_shader_cache_entry, entry);
+    const struct wined3d_shader_cache_key *k = key;
+
+    if (k->hash[0] != e->key.hash[0])
+        return k->hash[0] < e->key.hash[0] ? -1 : 1;
+    if (k->hash[1] != e->key.hash[1])
+        return k->hash[1] < e->key.hash[1] ? -1 : 1;
+    return 0;
+}
+
+static WCHAR *wined3d_shader_cache_format_hex(WCHAR *p, uint64_t value, unsigned int digits)
+{
+    static const char hex[] = "0123456789abcdef";
+
+    while (digits--)
+        *p++ = hex[(value >> (digits * 4)) & 0xf];
+    *p = 0;
+
+    return p;
+}
+
+/* The cache directory leaves room for the longest name built here. */
+static void wined3d_shader_cache_get_file_name(const struct wined3d_shader_cache *cache,
+        const struct wined3d_shader_cache_key *key, WCHAR *name)
+{
+    WCHAR *p;
+
+    lstrcpyW(name, cache->path);
+    p = name + lstrlenW(name);
+    *p++ = '\\';
+    p = wined3d_shader_cache_format_hex(p, key->hash[0], 16);
+    p = wined3d_shader_cache_format_hex(p, key->hash[1], 16);
+    lstrcpyW(p, bin_extW);
+}
+
+static BOOL wined3d_shader_cache_parse_file_name(const WCHAR *name, struct wined3d_shader_cache_key *key)
+{
+    unsigned int i, v;
+    WCHAR c;
+
+    for (i = 0; i < 32; ++i)
+    {
+        c = name[i];
+        if (c >= '0' && c <= '9')
+            v = c - '0';
+        else if (c >= 'a' && c <= 'f')
+            v = c - 'a' + 10;
+        else
+            return FALSE;
+        key->hash[i / 16] = (key->hash[i / 16] << 4) | v;
+    }
+
+    return !lstrcmpiW(name + 32, bin_extW);
+}
+
+static void *wined3d_shader_cache_read_file(const struct wined3d_shader_cache *cache,
+        const struct wined3d_shader_cache_key *key, uint32_t *size, BOOL *invalid)
+{
+    struct wined3d_shader_cache_file_header header;
+    WCHAR name[MAX_PATH];
+    void *data = NULL;
+    HANDLE file;
+    DWORD count;
+
+    *invalid = FALSE;
+    wined3d_shader_cache_get_file_name(cache, key, name);
+    if ((file = CreateFileW(name, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE,
+            NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL)) == INVALID_HANDLE_VALUE)
+        return NULL;
+
+    if (!ReadFile(file, &header, sizeof(header), &count, NULL) || count != sizeof(header)
+            || header.magic != WINED3D_SHADER_CACHE_MAGIC || header.version != WINED3D_SHADER_CACHE_VERSION
+            || memcmp(&header.key, key, sizeof(*key)) || !header.size
+            || header.size > WINED3D_SHADER_CACHE_MAX_ENTRY)
+    {
+        WARN("Invalid cache file %s.\n", debugstr_w(name));
+        *invalid = TRUE;
+        goto done;
+    }
+
+    if (!(data = heap_alloc(header.size)))
+        goto done;
+
+    if (!ReadFile(file, data, header.size, &count, NULL) || count != header.size
+            || wined3d_shader_cache_checksum(data, header.size) != header.checksum)
+    {
+        WARN("Corrupted cache file %s.\n", debugstr_w(name));
+        *invalid = TRUE;
+        heap_free(data);
+        data = NULL;
+        goto done;
+    }
+    *size = header.size;
+
+done:
+    CloseHandle(file);
+    return data;
+}
+
+static void wined3d_shader_cache_write_file(const struct wined3d_shader_cache *cache,
+        const struct wined3d_shader_cache_key *key, const void *data, uint32_t size)
+{
+    struct wined3d_shader_cache_file_header header;
+    static const WCHAR tmp_extW[] = {'.','t','m','p',0};
+    WCHAR name[MAX_PATH], tmp_name[MAX_PATH], *p;
+    DWORD count;
+    HANDLE file;
+    BOOL ret;
+
+    wined3d_shader_cache_get_file_name(cache, key, name);
+    /* Write to a temporary file first, so that other processes sharing the
+     * cache never see partially written entries. */
+    lstrcpyW(tmp_name, name);
+    p = tmp_name + lstrlenW(tmp_name);
+    *p++ = '.';
+    p = wined3d_shader_cache_format_hex(p, GetCurrentProcessId(), 8);
+    lstrcpyW(p, tmp_extW);
+    if ((file = CreateFileW(tmp_name, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, 0, NULL)) == INVALID_HANDLE_VALUE)
+    {
+        WARN("Failed to create %s, error %u.\n", debugstr_w(tmp_name), GetLastError());
+        return;
+    }
+
+    header.magic = WINED3D_SHADER_CACHE_MAGIC;
+    header.version = WINED3D_SHADER_CACHE_VERSION;
+    header.key = *key;
+    header.size = size;
+    header.checksum = wined3d_shader_cache_checksum(data, size);
+
+    ret = WriteFile(file, &header, sizeof(header), &count, NULL) && count == sizeof(header)
+            && WriteFile(file, data, size, &count, NULL) && count == size;
+    CloseHandle(file);
+
+    if (!ret || !MoveFileExW(tmp_name, name, MOVEFILE_REPLACE_EXISTING))
+    {
+        WARN("Failed to write %s, error %u.\n", debugstr_w(name), GetLastError());
+        DeleteFileW(tmp_name);
+    }
+}
+
+/* Make sure entries used in this session are not the first ones to be
+ * evicted by the next one. */
+static void wined3d_shader_cache_touch_file(const struct wined3d_shader_cache *cache,
+        const struct wined3d_shader_cache_key *key)
+{
+    WCHAR name[MAX_PATH];
+    FILETIME now;
+    HANDLE file;
+
+    wined3d_shader_cache_get_file_name(cache, key, name);
+    if ((file = CreateFileW(name, FILE_WRITE_ATTRIBUTES, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+            NULL, OPEN_EXISTING, 0, NULL)) == INVALID_HANDLE_VALUE)
+        return;
+    GetSystemTimeAsFileTime(&now);
+    SetFileTime(file, NULL, NULL, &now);
+    CloseHandle(file);
+}
+
+static void wined3d_shader_cache_delete_file(const struct wined3d_shader_cache *cache,
+        const struct wined3d_shader_cache_key *key)
+{
+    WCHAR name[MAX_PATH];
+
+    wined3d_shader_cache_get_file_name(cache, key, name);
+    DeleteFileW(name);
+}
+
+/* Called with the cache lock held. */
+static BOOL wined3d_shader_cache_queue_op(struct wined3d_shader_cache *cache,
+        enum wined3d_shader_cache_op_type type, const struct wined3d_shader_cache_key *key,
+        void *data, uint32_t size)
+{
+    struct wined3d_shader_cache_op *op;
+
+    if (!(op = heap_alloc(sizeof(*op))))
+        return FALSE;
+    op->type = type;
+    op->key = *key;
+    op->size = size;
+    op->data = data;
+    list_add_tail(&cache->ops, &op->entry);
+    SetEvent(cache->event);
+
+    return TRUE;
+}
+
+static void wined3d_shader_cache_entry_destroy(struct wined3d_shader_cache *cache,
+        struct wined3d_shader_cache_entry *entry)
+{
+    wine_rb_remove(&cache->entries, &entry->entry);
+    list_remove(&entry->lru_entry);
+    cache->total_size -= entry->size;
+    heap_free(entry->preloaded);
+    heap_free(entry);
+}
+
+/* Called with the cache lock held. */
+static void wined3d_shader_cache_evict(struct wined3d_shader_cache *cache)
+{
+    struct wined3d_shader_cache_entry *entry;
+    struct list *tail;
+
+    while (cache->total_size > cache->max_size && (tail = list_tail(&cache->lru)))
+    {
+        entry = LIST_ENTRY(tail, struct wined3d_shader_cache_entry, lru_entry);
+        TRACE("Evicting entry %08x%08x, size %u.\n", (unsigned int)(entry->key.hash[0] >> 32),
+                (unsigned int)entry->key.hash[0], entry->size);
+        /* Queued after any pending write of the same entry. */
+        wined3d_shader_cache_queue_op(cache, WINED3D_SHADER_CACHE_OP_DELETE, &entry->key, NULL, 0);
+        wined3d_shader_cache_entry_destroy(cache, entry);
+    }
+}
+
+static struct wined3d_shader_cache_entry *wined3d_shader_cache_add_entry(struct wined3d_shader_cache *cache,
+        const struct wined3d_shader_cache_key *key, uint32_t size)
+{
+    struct wined3d_shader_cache_entry *entry;
+
+    if (!(entry = heap_alloc_zero(sizeof(*entry))))
+        return NULL;
+    entry->key = *key;
+    entry->size = size;
+    wine_rb_put(&cache->entries, &entry->key, &entry->entry);
+    list_add_head(&cache->lru, &entry->lru_entry);
+    cache->total_size += size;
+
+    return entry;
+}
+
+struct wined3d_shader_cache_file
+{
+    struct wined3d_shader_cache_key key;
+    uint32_t size;
+    FILETIME time;
+};
+
+static int wined3d_shader_cache_file_compare(const void *a, const void *b)
+{
+    const struct wined3d_shader_cache_file *f1 = a, *f2 = b;
+
+    return CompareFileTime(&f1->time, &f2->time);
+}
+
+/* Add the entries found on disk to the index. Only the directory is read;
+ * entry data is read when the entry is requested. */
+static void wined3d_shader_cache_build_index(struct wined3d_shader_cache *cache)
+{
+    struct wined3d_shader_cache_file *files = NULL;
+    struct wined3d_shader_cache_entry *entry;
+    struct wined3d_shader_cache_key key;
+    SIZE_T files_size = 0, file_count = 0, preload_size = 0, preload_capacity = 0;
+    WCHAR pattern[MAX_PATH], *p;
+    WIN32_FIND_DATAW data;
+    HANDLE find;
+    SIZE_T i;
+
+    lstrcpyW(pattern, cache->path);
+    p = pattern + lstrlenW(pattern);
+    *p++ = '\\';
+    *p++ = '*';
+    lstrcpyW(p, bin_extW);
+    if ((find = FindFirstFileW(pattern, &data)) != INVALID_HANDLE_VALUE)
+    {
+        do
+        {
+            if (cache->stop)
+                break;
+            if (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+                continue;
+            if (!wined3d_shader_cache_parse_file_name(data.cFileName, &key))
+                continue;
+            if (data.nFileSizeHigh || data.nFileSizeLow <= sizeof(struct wined3d_shader_cache_file_header))
+                continue;
+            if (!wined3d_array_reserve((void **)&files, &files_size, file_count + 1, sizeof(*files)))
+                break;
+            files[file_count].key = key;
+            files[file_count].size = data.nFileSizeLow - sizeof(struct wined3d_shader_cache_file_header);
+            files[file_count].time = data.ftLastWriteTime;
+            ++file_count;
+        } while (FindNextFileW(find, &data));
+        FindClose(find);
+    }
+
+    qsort(files, file_count, sizeof(*files), wined3d_shader_cache_file_compare);
+
+    /* Entries used in this session so far stay at the head of the LRU list,
+     * followed by the ones on disk from the most recently written one. */
+    EnterCriticalSection(&cache->cs);
+    for (i = file_count; i--;)
+    {
+        if (wine_rb_get(&cache->entries, &files[i].key))
+            continue;
+        if ((entry = wined3d_shader_cache_add_entry(cache, &files[i].key, files[i].size)))
+        {
+            list_remove(&entry->lru_entry);
+            list_add_tail(&cache->lru, &entry->lru_entry);
+        }
+    }
+    wined3d_shader_cache_evict(cache);
+    InterlockedExchange(&cache->indexed, 1);
+
+    /* Read ahead the most recently used entries, which are likely to be
+     * needed first. */
+    LIST_FOR_EACH_ENTRY(entry, &cache->lru, struct wined3d_shader_cache_entry, lru_entry)
+    {
+        if ((preload_size += entry->size) > min(cache->max_size, WINED3D_SHADER_CACHE_PRELOAD_SIZE))
+            break;
+        if (!wined3d_array_reserve((void **)&cache->preload_keys, &preload_capacity,
+                cache->preload_count + 1, sizeof(*cache->preload_keys)))
+            break;
+        cache->preload_keys[cache->preload_count++] = entry->key;
+    }
+    LeaveCriticalSection(&cache->cs);
+
+    heap_free(files);
+
+    TRACE("Indexed %u cache entries in %s.\n", (unsigned int)file_count, debugstr_w(cache->path));
+}
+
+static void wined3d_shader_cache_execute_op(struct wined3d_shader_cache *cache, struct wined3d_shader_cache_op *op)
+{
+    struct wined3d_shader_cache_entry *entry;
+    struct wine_rb_entry *rb_entry;
+
+    switch (op->type)
+    {
+        case WINED3D_SHADER_CACHE_OP_WRITE:
+            wined3d_shader_cache_write_file(cache, &op->key, op->data, op->size);
+            /* From now on, the entry is read from disk. */
+            EnterCriticalSection(&cache->cs);
+            if ((rb_entry = wine_rb_get(&cache->entries, &op->key)))
+            {
+                entry = WINE_RB_ENTRY_VALUE(rb_entry, struct wined3d_shader_cache_entry, entry);
+                if (entry->data == op->data)
+                    entry->data = NULL;
+            }
+            LeaveCriticalSection(&cache->cs);
+            heap_free(op->data);
+            break;
+
+        case WINED3D_SHADER_CACHE_OP_TOUCH:
+            wined3d_shader_cache_touch_file(cache, &op->key);
+            break;
+
+        case WINED3D_SHADER_CACHE_OP_DELETE:
+            wined3d_shader_cache_delete_file(cache, &op->key);
+            break;
+    }
+}
+
+static void wined3d_shader_cache_preload_entry(struct wined3d_shader_cache *cache,
+        const struct wined3d_shader_cache_key *key)
+{
+    struct wined3d_shader_cache_entry *entry;
+    struct wine_rb_entry *rb_entry;
+    uint32_t size;
+    BOOL invalid;
+    void *data;
+
+    /* Invalid files are deleted when they are looked up. */
+    if (!(data = wined3d_shader_cache_read_file(cache, key, &size, &invalid)))
+        return;
+
+    EnterCriticalSection(&cache->cs);
+    if ((rb_entry = wine_rb_get(&cache->entries, key)))
+    {
+        entry = WINE_RB_ENTRY_VALUE(rb_entry, struct wined3d_shader_cache_entry, entry);
+        if (!entry->data && !entry->preloaded && entry->size == size)
+        {
+            entry->preloaded = data;
+            data = NULL;
+        }
+    }
+    LeaveCriticalSection(&cache->cs);
+
+    heap_free(data);
+}
+
+static DWORD WINAPI wined3d_shader_cache_thread_proc(void *ctx)
+{
+    struct wined3d_shader_cache *cache = ctx;
+    struct wined3d_shader_cache_op *op;
+    struct list *head;
+
+    wined3d_shader_cache_build_index(cache);
+
+    /* Pending operations are always completed, also when stopping, so that
+     * entries created in this session are written out. Reading ahead is only
+     * done while there is nothing else to do. */
+    for (;;)
+    {
+        EnterCriticalSection(&cache->cs);
+        if ((head = list_head(&cache->ops)))
+            list_remove(head);
+        LeaveCriticalSection(&cache->cs);
+
+        if (!head)
+        {
+            if (cache->stop)
+                break;
+            if (cache->preload_idx < cache->preload_count)
+                wined3d_shader_cache_preload_entry(cache, &cache->preload_keys[cache->preload_idx++]);
+            else
+                WaitForSingleObject(cache->event, INFINITE);
+            continue;
+        }
+
+        op = LIST_ENTRY(head, struct wined3d_shader_cache_op, entry);
+        wined3d_shader_cache_execute_op(cache, op);
+        heap_free(op);
+    }
+
+    return 0;
+}
+
+static BOOL wined3d_shader_cache_create_directory(WCHAR *path)
+{
+    WCHAR *p;
+
+    for (p = path; *p; ++p)
+    {
+        if (*p != '\\' || p == path || p[-1] == ':')
+            continue;
+        *p = 0;
+        CreateDirectoryW(path, NULL);
+        *p = '\\';
+    }
+
+    return CreateDirectoryW(path, NULL) || GetLastError() == ERROR_ALREADY_EXISTS;
+}
+
+static void wined3d_shader_cache_entry_free(struct wine_rb_entry *entry, void *ctx)
+{
+    struct wined3d_shader_cache_entry *e = WINE_RB_ENTRY_VALUE(entry, struct wined3d_shader_cache_entry, entry);
+
+    heap_free(e->preloaded);
+    heap_free(e);
+}
+
+/* The file name of the executable, so that each application gets its own
+ * cache directory. */
+static BOOL wined3d_shader_cache_get_app_name(WCHAR *name, unsigned int size)
+{
+    WCHAR buffer[MAX_PATH], *p;
+    unsigned int len;
+
+    len = GetModuleFileNameW(0, buffer, ARRAY_SIZE(buffer));
+    if (!(len && len < ARRAY_SIZE(buffer)))
+        return FALSE;
+
+    for (p = buffer + len; p > buffer && p[-1] != '\\' && p[-1] != '/'; --p)
+        ;
+    if (lstrlenW(p) >= size)
+        return FALSE;
+    lstrcpyW(name, p);
+    return TRUE;
+}
+
+static void wined3d_shader_cache_append_path(WCHAR *path, const WCHAR *name)
+{
+    WCHAR *p = path + lstrlenW(path);
+
+    *p++ = '\\';
+    lstrcpyW(p, name);
+}
+
+static BOOL wined3d_shader_cache_get_path(const WCHAR *backend, WCHAR *path)
+{
+    static const WCHAR local_app_dataW[] = {'L','O','C','A','L','A','P','P','D','A','T','A',0};
+    static const WCHAR wined3dW[] = {'w','i','n','e','\\','w','i','n','e','d','3','d',0};
+    static const WCHAR unknownW[] = {'u','n','k','n','o','w','n',0};
+    WCHAR base[MAX_PATH], app_name[MAX_PATH];
+    DWORD len;
+
+    if (wined3d_settings.shader_cache_path)
+    {
+        lstrcpynW(base, wined3d_settings.shader_cache_path, ARRAY_SIZE(base));
+    }
+    else
+    {
+        len = GetEnvironmentVariableW(local_app_dataW, base, ARRAY_SIZE(base));
+        if (!len || len >= ARRAY_SIZE(base) - 32)
+        {
+            WARN("Failed to get the local application data directory.\n");
+            return FALSE;
+        }
+        wined3d_shader_cache_append_path(base, wined3dW);
+    }
+
+    if (!wined3d_shader_cache_get_app_name(app_name, ARRAY_SIZE(app_name)))
+        lstrcpyW(app_name, unknownW);
+
+    /* Leave room for the entry file names. */
+    if (lstrlenW(base) + lstrlenW(app_name) + lstrlenW(backend) + 2 + 64 >= MAX_PATH)
+    {
+        WARN("Shader cache path %s is too long.\n", debugstr_w(base));
+        return FALSE;
+    }
+    lstrcpyW(path, base);
+    wined3d_shader_cache_append_path(path, app_name);
+    wined3d_shader_cache_append_path(path, backend);
+
+    return TRUE;
+}
+
+static struct wined3d_shader_cache *wined3d_shader_cache_create(const WCHAR *path)
+{
+    struct wined3d_shader_cache *cache;
+
+    if (!(cache = heap_alloc_zero(sizeof(*cache))))
+        return NULL;
+
+    lstrcpyW(cache->path, path);
+    if (!wined3d_shader_cache_create_directory(cache->path))
+    {
+        WARN("Failed to create shader cache directory %s.\n", debugstr_w(cache->path));
+        heap_free(cache);
+        return NULL;
+    }
+
+    cache->refcount = 1;
+    InitializeCriticalSection(&cache->cs);
+    cache->cs.DebugInfo->Spare[0] = (DWORD_PTR)(__FILE__ ": wined3d_shader_cache.cs");
+    wine_rb_init(&cache->entries, wined3d_shader_cache_entry_compare);
+    list_init(&cache->lru);
+    list_init(&cache->ops);
+    cache->max_size = (uint64_t)wined3d_settings.shader_cache_size * 1024 * 1024;
+
+    /* Without the cache thread, all file operations would have to be done by
+     * the rendering threads; disable the cache instead. */
+    if (!(cache->event = CreateEventW(NULL, FALSE, FALSE, NULL))
+            || !(cache->thread = CreateThread(NULL, 0, wined3d_shader_cache_thread_proc, cache, 0, NULL)))
+    {
+        WARN("Failed to create shader cache thread, error %u.\n", GetLastError());
+        if (cache->event)
+            CloseHandle(cache->event);
+        cache->cs.DebugInfo->Spare[0] = 0;
+        DeleteCriticalSection(&cache->cs);
+        heap_free(cache);
+        return NULL;
+    }
+    SetThreadPriority(cache->thread, THREAD_PRIORITY_BELOW_NORMAL);
+
+    TRACE("Created shader cache %p in %s, maximum size %s.\n",
+            cache, debugstr_w(cache->path), wine_dbgstr_longlong(cache->max_size));
+
+    return cache;
+}
+
+/* Return the cache for the given backend, shared by all the devices of the
+ * process, or NULL if shader caching is disabled. */
+struct wined3d_shader_cache *wined3d_shader_cache_acquire(const WCHAR *backend)
+{
+    struct wined3d_shader_cache *cache;
+    WCHAR path[MAX_PATH];
+
+    if (!wined3d_settings.shader_cache_size)
+    {
+        TRACE("Shader cache disabled.\n");
+        return NULL;
+    }
+
+    if (!wined3d_shader_cache_get_path(backend, path))
+        return NULL;
+
+    EnterCriticalSection(&shader_caches_cs);
+    LIST_FOR_EACH_ENTRY(cache, &shader_caches, struct wined3d_shader_cache, entry)
+    {
+        if (!lstrcmpiW(cache->path, path))
+        {
+            ++cache->refcount;
+            TRACE("Using shader cache %p, refcount %u.\n", cache, cache->refcount);
+            LeaveCriticalSection(&shader_caches_cs);
+            return cache;
+        }
+    }
+    if ((cache = wined3d_shader_cache_create(path)))
+        list_add_tail(&shader_caches, &cache->entry);
+    LeaveCriticalSection(&shader_caches_cs);
+
+    return cache;
+}
+
+void wined3d_shader_cache_release(struct wined3d_shader_cache *cache)
+{
+    if (!cache)
+        return;
+
+    EnterCriticalSection(&shader_caches_cs);
+    if (--cache->refcount)
+    {
+        LeaveCriticalSection(&shader_caches_cs);
+        return;
+    }
+    list_remove(&cache->entry);
+    LeaveCriticalSection(&shader_caches_cs);
+
+    InterlockedExchange(&cache->stop, 1);
+    SetEvent(cache->event);
+    WaitForSingleObject(cache->thread, INFINITE);
+    CloseHandle(cache->thread);
+    CloseHandle(cache->event);
+
+    wine_rb_destroy(&cache->entries, wined3d_shader_cache_entry_free, NULL);
+    heap_free(cache->preload_keys);
+    cache->cs.DebugInfo->Spare[0] = 0;
+    DeleteCriticalSection(&cache->cs);
+    heap_free(cache);
+}
+
+/* Reading an entry is the only file operation done by the calling thread. It
+ * is done without holding the cache lock, and replaces compiling or linking
+ * the shader. */
+void *wined3d_shader_cache_get(struct wined3d_shader_cache *cache,
+        const struct wined3d_shader_cache_key *key, size_t *size)
+{
+    struct wined3d_shader_cache_entry *entry;
+    struct wine_rb_entry *rb_entry;
+    uint32_t file_size;
+    void *data = NULL;
+    BOOL invalid;
+
+    if (!cache)
+        return NULL;
+
+    EnterCriticalSection(&cache->cs);
+    if ((rb_entry = wine_rb_get(&cache->entries, key)))
+    {
+        entry = WINE_RB_ENTRY_VALUE(rb_entry, struct wined3d_shader_cache_entry, entry);
+        if (entry->preloaded)
+        {
+            data = entry->preloaded;
+            entry->preloaded = NULL;
+            if (!entry->touched && wined3d_shader_cache_queue_op(cache, WINED3D_SHADER_CACHE_OP_TOUCH, key, NULL, 0))
+                entry->touched = TRUE;
+        }
+        else if (entry->data && (data = heap_alloc(entry->size)))
+        {
+            memcpy(data, entry->data, entry->size);
+        }
+        if (data)
+        {
+            *size = entry->size;
+            list_remove(&entry->lru_entry);
+            list_add_head(&cache->lru, &entry->lru_entry);
+        }
+    }
+    /* The entry may exist on disk but not have been indexed yet. */
+    else if (cache->indexed)
+    {
+        LeaveCriticalSection(&cache->cs);
+        goto done;
+    }
+    LeaveCriticalSection(&cache->cs);
+
+    if (data)
+        goto done;
+
+    data = wined3d_shader_cache_read_file(cache, key, &file_size, &invalid);
+
+    EnterCriticalSection(&cache->cs);
+    rb_entry = wine_rb_get(&cache->entries, key);
+    entry = rb_entry ? WINE_RB_ENTRY_VALUE(rb_entry, struct wined3d_shader_cache_entry, entry) : NULL;
+    if (!data)
+    {
+        /* Only remove the entry if nothing replaced it in the meantime. */
+        if (invalid && (!entry || !entry->data))
+        {
+            if (entry)
+                wined3d_shader_cache_entry_destroy(cache, entry);
+            wined3d_shader_cache_queue_op(cache, WINED3D_SHADER_CACHE_OP_DELETE, key, NULL, 0);
+        }
+    }
+    else
+    {
+        if (!entry)
+        {
+            entry = wined3d_shader_cache_add_entry(cache, key, file_size);
+        }
+        else
+        {
+            list_remove(&entry->lru_entry);
+            list_add_head(&cache->lru, &entry->lru_entry);
+            if (!entry->data)
+            {
+                cache->total_size += file_size;
+                cache->total_size -= entry->size;
+                entry->size = file_size;
+            }
+        }
+        if (entry && !entry->touched
+                && wined3d_shader_cache_queue_op(cache, WINED3D_SHADER_CACHE_OP_TOUCH, key, NULL, 0))
+            entry->touched = TRUE;
+        *size = file_size;
+    }
+    LeaveCriticalSection(&cache->cs);
+
+done:
+    TRACE("Cache %s for key %08x%08x.\n", data ? "hit" : "miss",
+            (unsigned int)(key->hash[0] >> 32), (unsigned int)key->hash[0]);
+
+    return data;
+}
+
+void wined3d_shader_cache_put(struct wined3d_shader_cache *cache,
+        const struct wined3d_shader_cache_key *key, const void *data, size_t size)
+{
+    struct wined3d_shader_cache_entry *entry;
+    void *p;
+
+    if (!cache || !size || size > WINED3D_SHADER_CACHE_MAX_ENTRY || size > cache->max_size)
+        return;
+
+    if (!(p = heap_alloc(size)))
+        return;
+    memcpy(p, data, size);
+
+    EnterCriticalSection(&cache->cs);
+
+    if (wine_rb_get(&cache->entries, key) || !(entry = wined3d_shader_cache_add_entry(cache, key, size)))
+    {
+        LeaveCriticalSection(&cache->cs);
+        heap_free(p);
+        return;
+    }
+
+    if (!wined3d_shader_cache_queue_op(cache, WINED3D_SHADER_CACHE_OP_WRITE, key, p, size))
+    {
+        wined3d_shader_cache_entry_destroy(cache, entry);
+        LeaveCriticalSection(&cache->cs);
+        heap_free(p);
+        return;
+    }
+    entry->data = p;
+    entry->touched = TRUE;
+    wined3d_shader_cache_evict(cache);
+
+    LeaveCriticalSection(&cache->cs);
+}
@@ -64,6 +64,9 @@ struct shader_spirv_priv
     bool ffp_proj_control;
 
     struct shader_spirv_resource_bindings bindings;
+
+    struct wined3d_shader_cache *shader_cache;
+    struct wined3d_shader_cache_hash cache_seed;
 };
 
 struct shader_spirv_compile_arguments
@@ -304,10 +307,55 @@ static void shader_spirv_init_shader_interface_vk(struct wined3d_shader_spirv_sh
     iface->vkd3d_interface.uav_counter_count = b->uav_counter_count;
 }
 
+static void shader_spirv_get_cache_key(const struct shader_spirv_priv *priv,
+        const struct vkd3d_shader_compile_info *info, const struct wined3d_shader_spirv_compile_args *compile_args,
+        const struct vkd3d_shader_interface_info *iface, const struct wined3d_stream_output_desc *so_desc,
+        struct wined3d_shader_cache_key *key)
+{
+    const struct vkd3d_shader_spirv_target_info *target = &compile_args->spirv_target;
+    struct wined3d_shader_cache_hash hash = priv->cache_seed;
+    unsigned int i;
+
+    wined3d_shader_cache_hash_update(&hash, info->source.code, info->source.size);
+    wined3d_shader_cache_hash_update(&hash, &info->source_type, sizeof(info->source_type));
+    wined3d_shader_cache_hash_update(&hash, &info->target_type, sizeof(info->target_type));
+    wined3d_shader_cache_hash_update(&hash, &target->environment, sizeof(target->environment));
+    wined3d_shader_cache_hash_update(&hash, target->parameters,
+            target->parameter_count * sizeof(*target->parameters));
+    wined3d_shader_cache_hash_update(&hash, target->output_swizzles,
+            target->output_swizzle_count * sizeof(*target->output_swizzles));
+
+    /* These structures only contain 32-bit integer fields, so they don't
+     * have any padding. */
+    wined3d_shader_cache_hash_update(&hash, iface->bindings, iface->binding_count * sizeof(*iface->bindings));
+    wined3d_shader_cache_hash_update(&hash, iface->uav_counters,
+            iface->uav_counter_count * sizeof(*iface->uav_counters));
+
+    if (so_desc)
+    {
+        for (i = 0; i < so_desc->element_count; ++i)
+        {
+            const struct wined3d_stream_output_element *e = &so_desc->elements[i];
+
+            wined3d_shader_cache_hash_update(&hash, &e->stream_idx, sizeof(e->stream_idx));
+            wined3d_shader_cache_hash_update_string(&hash, e->semantic_name);
+            wined3d_shader_cache_hash_update(&hash, &e->semantic_idx, sizeof(e->semantic_idx));
+            wined3d_shader_cache_hash_update(&hash, &e->component_idx, sizeof(e->component_idx));
+            wined3d_shader_cache_hash_update(&hash, &e->component_count, sizeof(e->component_count));
+            wined3d_shader_cache_hash_update(&hash, &e->output_slot, sizeof(e->output_slot));
+        }
+        wined3d_shader_cache_hash_update(&hash, so_desc->buffer_strides,
+                so_desc->buffer_stride_count * sizeof(*so_desc->buffer_strides));
+    }
+
+    wined3d_shader_cache_hash_final(&hash, key);
+}
+
 static VkShaderModule shader_spirv_compile(struct wined3d_context_vk *context_vk,
         struct wined3d_shader *shader, const struct shader_spirv_compile_arguments *args,
         const struct shader_spirv_resource_bindings *bindings, const struct wined3d_stream_output_desc *so_desc)
 {
+    struct shader_spirv_priv *priv = context_vk->c.device->shader_priv;
     struct wined3d_shader_spirv_compile_args compile_args;
     struct wined3d_shader_spirv_shader_interface iface;
     struct vkd3d_shader_compile_info info;
@@ -315,7 +363,9 @@ static VkShaderModule shader_spirv_compile(struct wined3d_context_vk *context_vk
     enum wined3d_shader_type shader_type;
     VkShaderModuleCreateInfo shader_desc;
     struct wined3d_device_vk *device_vk;
+    struct wined3d_shader_cache_key key;
     struct vkd3d_shader_code spirv;
+    void *cached_code = NULL;
     VkShaderModule module;
     char *messages;
     VkResult vr;
@@ -337,25 +387,44 @@ static VkShaderModule shader_spirv_compile(struct wined3d_context_vk *context_vk
     info.log_level = VKD3D_SHADER_LOG_WARNING;
     info.source_name = NULL;
 
-    ret = vkd3d_shader_compile(&info, &spirv, &messages);
-    if (messages && *messages && FIXME_ON(d3d_shader))
+    if (priv->shader_cache)
     {
-        const char *ptr = messages;
-        const char *line;
-
-        FIXME("Shader log:\n");
-        while ((line = get_line(&ptr)))
+        shader_spirv_get_cache_key(priv, &info, &compile_args, &iface.vkd3d_interface, so_desc, &key);
+        if ((cached_code = wined3d_shader_cache_get(priv->shader_cache, &key, &spirv.size))
+                && spirv.size % sizeof(uint32_t))
         {
-            FIXME("    %.*s", (int)(ptr - line), line);
+            WARN("Ignoring cached SPIR-V code with invalid size %lu.\n", (unsigned long)spirv.size);
+            heap_free(cached_code);
+            cached_code = NULL;
         }
-        FIXME("\n");
+        spirv.code = cached_code;
     }
-    vkd3d_shader_free_messages(messages);
 
-    if (ret < 0)
+    if (!cached_code)
     {
-        ERR("Failed to compile DXBC, ret %d.\n", ret);
-        return VK_NULL_HANDLE;
+        ret = vkd3d_shader_compile(&info, &spirv, &messages);
+        if (messages && *messages && FIXME_ON(d3d_shader))
+        {
+            const char *ptr = messages;
+            const char *line;
+
+            FIXME("Shader log:\n");
+            while ((line = get_line(&ptr)))
+            {
+                FIXME("    %.*s", (int)(ptr - line), line);
+            }
+            FIXME("\n");
+        }
+        vkd3d_shader_free_messages(messages);
+
+        if (ret < 0)
+        {
+            ERR("Failed to compile DXBC, ret %d.\n", ret);
+            return VK_NULL_HANDLE;
+        }
+
+        if (priv->shader_cache)
+            wined3d_shader_cache_put(priv->shader_cache, &key, spirv.code, spirv.size);
     }
 
     device_vk = wined3d_device_vk(context_vk->c.device);
@@ -366,15 +435,17 @@ static VkShaderModule shader_spirv_compile(struct wined3d_context_vk *context_vk
     shader_desc.flags = 0;
     shader_desc.codeSize = spirv.size;
     shader_desc.pCode = spirv.code;
-    if ((vr = VK_CALL(vkCreateShaderModule(device_vk->vk_device, &shader_desc, NULL, &module))) < 0)
-    {
+    vr = VK_CALL(vkCreateShaderModule(device_vk->vk_device, &shader_desc, NULL, &module));
+    if (cached_code)
+        heap_free(cached_code);
+    else
         vkd3d_shader_free_shader_code(&spirv);
+    if (vr < 0)
+    {
         WARN("Failed to create Vulkan shader module, vr %s.\n", wined3d_debug_vkresult(vr));
         return VK_NULL_HANDLE;
     }
 
-    vkd3d_shader_free_shader_code(&spirv);
-
     return module;
 }
 
@@ -1028,6 +1099,7 @@ static void shader_spirv_destroy(struct wined3d_shader *shader)
 static HRESULT shader_spirv_alloc(struct wined3d_device *device,
         const struct wined3d_vertex_pipe_ops *vertex_pipe, const struct wined3d_fragment_pipe_ops *fragment_pipe)
 {
+    static const WCHAR spirvW[] = {'s','p','i','r','v',0};
     struct fragment_caps fragment_caps;
     void *vertex_priv, *fragment_priv;
     struct shader_spirv_priv *priv;
@@ -1056,6 +1128,13 @@ static HRESULT shader_spirv_alloc(struct wined3d_device *device,
     priv->ffp_proj_control = fragment_caps.wined3d_caps & WINED3D_FRAGMENT_CAP_PROJ_CONTROL;
     memset(&priv->bindings, 0, sizeof(priv->bindings));
 
+    /* SPIR-V generated by a different vkd3d-shader version may differ. */
+    if ((priv->shader_cache = wined3d_shader_cache_acquire(spirvW)))
+    {
+        wined3d_shader_cache_hash_init(&priv->cache_seed);
+        wined3d_shader_cache_hash_update_string(&priv->cache_seed, vkd3d_shader_get_version(NULL, NULL));
+    }
+
     device->vertex_priv = vertex_priv;
     device->fragment_priv = fragment_priv;
     device->shader_priv = priv;
@@ -1067,6 +1146,7 @@ static void shader_spirv_free(struct wined3d_device *device, struct wined3d_cont
 {
     struct shader_spirv_priv *priv = device->shader_priv;
 
+    wined3d_shader_cache_release(priv->shader_cache);
     shader_spirv_resource_bindings_cleanup(&priv->bindings);
     priv->fragment_pipe->free_private(device, context);
     priv->vertex_pipe->vp_free(device, context);
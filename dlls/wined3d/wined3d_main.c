@@ -129,6 +129,9 @@ struct wined3d_settings wined3d_settings =
     ~0u,            /* No CS shader model limit by default. */
     WINED3D_RENDERER_AUTO,
     WINED3D_SHADER_BACKEND_AUTO,
+    0,              /* No shader cache by default. */
+    NULL,           /* Shader cache in the local application data directory. */
+    NULL,           /* No command stream trace events by default. */
 };
 
 struct wined3d * CDECL wined3d_create(DWORD flags)
@@ -164,6 +167,13 @@ static DWORD get_config_key(HKEY defkey, HKEY appkey, const char *name, char *bu
     return ERROR_FILE_NOT_FOUND;
 }
 
+static DWORD get_config_key_w(HKEY defkey, HKEY appkey, const WCHAR *name, WCHAR *buffer, DWORD size)
+{
+    if (appkey && !RegQueryValueExW(appkey, name, 0, NULL, (BYTE *)buffer, &size)) return 0;
+    if (defkey && !RegQueryValueExW(defkey, name, 0, NULL, (BYTE *)buffer, &size)) return 0;
+    return ERROR_FILE_NOT_FOUND;
+}
+
 static DWORD get_config_key_dword(HKEY defkey, HKEY appkey, const char *name, DWORD *value)
 {
     DWORD type, data, size;
@@ -206,8 +216,10 @@ BOOL wined3d_get_app_name(char *app_name, unsigned int app_name_size)
 
 static BOOL wined3d_dll_init(HINSTANCE hInstDLL)
 {
+    static const WCHAR shader_cache_pathW[] = {'S','h','a','d','e','r','C','a','c','h','e','P','a','t','h',0};
     DWORD wined3d_context_tls_idx;
     char buffer[MAX_PATH+10];
+    WCHAR path[MAX_PATH];
     DWORD size = sizeof(buffer);
     HKEY hkey = 0;
     HKEY appkey = 0;
@@ -384,6 +396,26 @@ static BOOL wined3d_dll_init(HINSTANCE hInstDLL)
             TRACE("Limiting PS shader model to %u.\n", wined3d_settings.max_sm_ps);
         if (!get_config_key_dword(hkey, appkey, "MaxShaderModelCS", &wined3d_settings.max_sm_cs))
             TRACE("Limiting CS shader model to %u.\n", wined3d_settings.max_sm_cs);
+        if (!get_config_key_dword(hkey, appkey, "ShaderCacheSize", &wined3d_settings.shader_cache_size))
+            TRACE("Limiting the shader cache size to %u MiB.\n", wined3d_settings.shader_cache_size);
+        if (!get_config_key_w(hkey, appkey, shader_cache_pathW, path, sizeof(path)))
+        {
+            size_t len = (lstrlenW(path) + 1) * sizeof(WCHAR);
+
+            if (!(wined3d_settings.shader_cache_path = heap_alloc(len)))
+                ERR("Failed to allocate shader cache path memory.\n");
+            else
+                memcpy(wined3d_settings.shader_cache_path, path, len);
+        }
+        if (!get_config_key(hkey, appkey, "CSProfileTrace", buffer, size))
+        {
+            size_t len = strlen(buffer) + 1;
+
+            if (!(wined3d_settings.cs_profile_trace = heap_alloc(len)))
+                ERR("Failed to allocate command stream trace path memory.\n");
+            else
+                memcpy(wined3d_settings.cs_profile_trace, buffer, len);
+        }
         if (!get_config_key(hkey, appkey, "renderer", buffer, size))
         {
             if (!strcmp(buffer, "vulkan"))
@@ -444,6 +476,8 @@ static BOOL wined3d_dll_destroy(HINSTANCE hInstDLL)
     heap_free(swapchain_state_table.hooks);
 
     heap_free(wined3d_settings.logo);
+    heap_free(wined3d_settings.shader_cache_path);
+    heap_free(wined3d_settings.cs_profile_trace);
     UnregisterClassA(WINED3D_OPENGL_WINDOW_CLASS_NAME, hInstDLL);
 
     DeleteCriticalSection(&wined3d_command_cs);
@@ -479,10 +479,39 @@ struct wined3d_settings
     unsigned int max_sm_cs;
     enum wined3d_renderer renderer;
     enum wined3d_shader_backend shader_backend;
+    unsigned int shader_cache_size;
+    WCHAR *shader_cache_path;
+    char *cs_profile_trace;
 };
 
 extern struct wined3d_settings wined3d_settings DECLSPEC_HIDDEN;
 
+struct wined3d_shader_cache;
+
+struct wined3d_shader_cache_key
+{
+    uint64_t hash[2];
+};
+
+struct wined3d_shader_cache_hash
+{
+    uint64_t h[2];
+};
+
+void wined3d_shader_cache_hash_init(struct wined3d_shader_cache_hash *hash) DECLSPEC_HIDDEN;
+void wined3d_shader_cache_hash_update(struct wined3d_shader_cache_hash *hash,
+        const void *data, size_t size) DECLSPEC_HIDDEN;
+void wined3d_shader_cache_hash_update_string(struct wined3d_shader_cache_hash *hash, const char *s) DECLSPEC_HIDDEN;
+void wined3d_shader_cache_hash_final(const struct wined3d_shader_cache_hash *hash,
+        struct wined3d_shader_cache_key *key) DECLSPEC_HIDDEN;
+
+struct wined3d_shader_cache *wined3d_shader_cache_acquire(const WCHAR *backend) DECLSPEC_HIDDEN;
+void wined3d_shader_cache_release(struct wined3d_shader_cache *cache) DECLSPEC_HIDDEN;
+void *wined3d_shader_cache_get(struct wined3d_shader_cache *cache,
+        const struct wined3d_shader_cache_key *key, size_t *size) DECLSPEC_HIDDEN;
+void wined3d_shader_cache_put(struct wined3d_shader_cache *cache,
+        const struct wined3d_shader_cache_key *key, const void *data, size_t size) DECLSPEC_HIDDEN;
+
 enum wined3d_shader_byte_code_format
 {
     WINED3D_SHADER_BYTE_CODE_FORMAT_SM1,
@@ -1729,13 +1758,6 @@ void dispatch_compute(struct wined3d_device *device, const struct wined3d_state
 #define GET_TEXCOORD_SIZE_FROM_FVF(d3dvtVertexType, tex_num) \
     (((((d3dvtVertexType) >> (16 + (2 * (tex_num)))) + 1) & 0x03) + 1)
 
-enum wined3d_pipeline
-{
-    WINED3D_PIPELINE_GRAPHICS,
-    WINED3D_PIPELINE_COMPUTE,
-    WINED3D_PIPELINE_COUNT,
-};
-
 /* Routines and structures related to state management */
 
 #define STATE_RENDER(a) (a)
@@ -3650,6 +3672,7 @@ struct wined3d_light_state
 
 #define WINED3D_STATE_NO_REF        0x00000001
 #define WINED3D_STATE_INIT_DEFAULT  0x00000002
+#define WINED3D_STATE_DEFERRED      0x00000004
 
 struct wined3d_state
 {
@@ -3808,6 +3831,8 @@ struct wined3d_device
 
     /* Command stream */
     struct wined3d_cs *cs;
+    /* Default d3d10+ state, used for command list state transitions. */
+    struct wined3d_state *default_state;
 
     /* Context management */
     struct wined3d_context **contexts;
@@ -4661,6 +4686,55 @@ struct wined3d_cs_queue
     BYTE data[WINED3D_CS_QUEUE_SIZE];
 };
 
+#define WINED3D_UPLOAD_CHUNK_SIZE       0x400000u
+#define WINED3D_UPLOAD_RING_SIZE        0x4000000u
+#define WINED3D_UPLOAD_MAX_SUBALLOC_SIZE (WINED3D_UPLOAD_CHUNK_SIZE / 4)
+#define WINED3D_UPLOAD_MAX_BUFFER_SIZE  (WINED3D_UPLOAD_RING_SIZE / 4)
+
+/* Chunks of system memory that dynamic buffer maps are sub-allocated from.
+ * Buffers larger than WINED3D_UPLOAD_MAX_SUBALLOC_SIZE get a chunk of their
+ * own. A chunk is recycled once the command stream has consumed every upload
+ * referencing it, as tracked by the fence. The data is copied into the
+ * buffer's storage by the command stream thread. */
+struct wined3d_upload_chunk
+{
+    struct list entry;
+    void *memory;
+    BYTE *data;
+    size_t size;
+    size_t offset;
+    unsigned int generation;
+    unsigned int map_count;
+    LONG fence;
+};
+
+struct wined3d_upload_ring
+{
+    struct wined3d_upload_chunk *current;
+    struct list retired;
+    size_t size;
+    LONG fence;
+    LONG completed_fence;
+    /* Incremented whenever a chunk is freed. */
+    unsigned int generation;
+};
+
+enum wined3d_cs_object_type
+{
+    WINED3D_CS_OBJECT_RESOURCE,
+    WINED3D_CS_OBJECT_RENDERTARGET_VIEW,
+    WINED3D_CS_OBJECT_SHADER_RESOURCE_VIEW,
+    WINED3D_CS_OBJECT_UNORDERED_ACCESS_VIEW,
+    WINED3D_CS_OBJECT_SAMPLER,
+    WINED3D_CS_OBJECT_SHADER,
+    WINED3D_CS_OBJECT_BLEND_STATE,
+    WINED3D_CS_OBJECT_DEPTH_STENCIL_STATE,
+    WINED3D_CS_OBJECT_RASTERIZER_STATE,
+    WINED3D_CS_OBJECT_VERTEX_DECLARATION,
+    WINED3D_CS_OBJECT_QUERY,
+    WINED3D_CS_OBJECT_COMMAND_LIST,
+};
+
 struct wined3d_cs_ops
 {
     void *(*require_space)(struct wined3d_cs *cs, size_t size, enum wined3d_cs_queue_id queue_id);
@@ -4668,19 +4742,36 @@ struct wined3d_cs_ops
     void (*finish)(struct wined3d_cs *cs, enum wined3d_cs_queue_id queue_id);
     void (*push_constants)(struct wined3d_cs *cs, enum wined3d_push_constants p,
             unsigned int start_idx, unsigned int count, const void *constants);
+    void (*acquire_resource)(struct wined3d_cs *cs, struct wined3d_resource *resource);
+    void (*reference_object)(struct wined3d_cs *cs, enum wined3d_cs_object_type type, void *object);
+    void (*update_sub_resource)(struct wined3d_cs *cs, struct wined3d_resource *resource,
+            unsigned int sub_resource_idx, const struct wined3d_box *box, const void *data,
+            unsigned int row_pitch, unsigned int slice_pitch);
+    HRESULT (*map)(struct wined3d_cs *cs, struct wined3d_resource *resource, unsigned int sub_resource_idx,
+            struct wined3d_map_desc *map_desc, const struct wined3d_box *box, unsigned int flags);
+    HRESULT (*unmap)(struct wined3d_cs *cs, struct wined3d_resource *resource, unsigned int sub_resource_idx);
+};
+
+/* The application-side view of a command stream. The immediate context's
+ * state is the device state; deferred contexts track their own. */
+struct wined3d_device_context
+{
+    struct wined3d_device *device;
+    struct wined3d_state *state;
 };
 
 struct wined3d_cs
 {
     const struct wined3d_cs_ops *ops;
     struct wined3d_device *device;
+    struct wined3d_device_context c;
     struct wined3d_state state;
     HMODULE wined3d_module;
     HANDLE thread;
     DWORD thread_id;
     BOOL serialize_commands;
 
-    struct wined3d_cs_queue queue[WINED3D_CS_QUEUE_COUNT];
+    struct wined3d_cs_queue *queue;
     size_t data_size, start, end;
     void *data;
     struct list query_poll_list;
@@ -4689,6 +4780,10 @@ struct wined3d_cs
     HANDLE event;
     BOOL waiting_for_event;
     LONG pending_presents;
+
+    struct wined3d_cs_profile *profile;
+
+    struct wined3d_upload_ring upload_ring;
 };
 
 struct wined3d_cs *wined3d_cs_create(struct wined3d_device *device) DECLSPEC_HIDDEN;
@@ -4781,6 +4876,9 @@ void wined3d_cs_emit_unload_resource(struct wined3d_cs *cs, struct wined3d_resou
 void wined3d_cs_emit_update_sub_resource(struct wined3d_cs *cs, struct wined3d_resource *resource,
         unsigned int sub_resource_idx, const struct wined3d_box *box, const void *data, unsigned int row_pitch,
         unsigned int slice_pitch) DECLSPEC_HIDDEN;
+BOOL wined3d_cs_map_upload_buffer(struct wined3d_cs *cs, struct wined3d_buffer *buffer,
+        struct wined3d_map_desc *map_desc, const struct wined3d_box *box, DWORD flags) DECLSPEC_HIDDEN;
+BOOL wined3d_cs_unmap_upload_buffer(struct wined3d_cs *cs, struct wined3d_buffer *buffer) DECLSPEC_HIDDEN;
 void wined3d_cs_init_object(struct wined3d_cs *cs,
         void (*callback)(void *object), void *object) DECLSPEC_HIDDEN;
 HRESULT wined3d_cs_map(struct wined3d_cs *cs, struct wined3d_resource *resource, unsigned int sub_resource_idx,
@@ -4788,6 +4886,11 @@ HRESULT wined3d_cs_map(struct wined3d_cs *cs, struct wined3d_resource *resource,
 HRESULT wined3d_cs_unmap(struct wined3d_cs *cs, struct wined3d_resource *resource,
         unsigned int sub_resource_idx) DECLSPEC_HIDDEN;
 
+static inline struct wined3d_cs *wined3d_cs_from_context(struct wined3d_device_context *context)
+{
+    return CONTAINING_RECORD(context, struct wined3d_cs, c);
+}
+
 static inline void wined3d_cs_finish(struct wined3d_cs *cs, enum wined3d_cs_queue_id queue_id)
 {
     cs->ops->finish(cs, queue_id);
@@ -4851,6 +4954,19 @@ struct wined3d_buffer
     UINT stride;                                            /* 0 if no conversion */
     enum wined3d_buffer_conversion_type *conversion_map;    /* NULL if no conversion */
     UINT conversion_stride;                                 /* 0 if no shifted conversion */
+
+    /* Streamed DISCARD and NOOVERWRITE maps. Except for upload_pending,
+     * which is cleared by the command stream thread, only accessed by the
+     * application thread. */
+    struct wined3d_upload_chunk *upload_chunk;
+    unsigned int upload_generation;
+    unsigned int upload_ring_generation;
+    BYTE *upload_data;
+    struct wined3d_range upload_range;
+    uint32_t upload_flags;
+    unsigned int upload_map_count;
+    const BYTE *upload_pending_data;
+    LONG upload_pending;
 };
 
 static inline struct wined3d_buffer *buffer_from_resource(struct wined3d_resource *resource)
@@ -4871,6 +4987,8 @@ BOOL wined3d_buffer_load_location(struct wined3d_buffer *buffer,
 BYTE *wined3d_buffer_load_sysmem(struct wined3d_buffer *buffer, struct wined3d_context *context) DECLSPEC_HIDDEN;
 BOOL wined3d_buffer_prepare_location(struct wined3d_buffer *buffer,
         struct wined3d_context *context, unsigned int location) DECLSPEC_HIDDEN;
+void wined3d_buffer_update_data(struct wined3d_buffer *buffer, struct wined3d_context *context,
+        unsigned int offset, unsigned int size, const void *data, uint32_t flags) DECLSPEC_HIDDEN;
 void wined3d_buffer_upload_data(struct wined3d_buffer *buffer, struct wined3d_context *context,
         const struct wined3d_box *box, const void *data) DECLSPEC_HIDDEN;
 
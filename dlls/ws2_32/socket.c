@@ -131,6 +131,16 @@
 #ifdef HAVE_SYS_TIME_H
 # include <sys/time.h>
 #endif
+#ifdef HAVE_SYS_STAT_H
+# include <sys/stat.h>
+#endif
+#ifdef HAVE_SYS_EPOLL_H
+# include <sys/epoll.h>
+# include <sys/eventfd.h>
+#endif
+#ifdef HAVE_SYS_SENDFILE_H
+# include <sys/sendfile.h>
+#endif
 
 #define NONAMELESSUNION
 #define NONAMELESSSTRUCT
@@ -161,6 +171,7 @@
 #include "wine/exception.h"
 #include "wine/unicode.h"
 #include "wine/heap.h"
+#include "wine/list.h"
 
 #if defined(linux) && !defined(IP_UNICAST_IF)
 #define IP_UNICAST_IF 50
@@ -649,6 +660,11 @@ struct ws2_async
     DWORD                               flags;
     DWORD                              *lpFlags;
     WSABUF                             *control;
+    struct list                         reactor_entry;  /* entry in the socket reactor queue */
+    struct user_async_entry            *reactor_shm;    /* entry in the memory shared with the server */
+    IO_STATUS_BLOCK                    *iosb;
+    HANDLE                              event;
+    ULONG_PTR                           cvalue;
     unsigned int                        n_iovecs;
     unsigned int                        first_iovec;
     struct iovec                        iovec[1];
@@ -678,6 +694,8 @@ struct ws2_transmitfile_async
     DWORD                 bytes_per_send;
     TRANSMIT_FILE_BUFFERS buffers;
     DWORD                 flags;
+    BOOL                  zerocopy;
+    BOOL                  source_empty; /* last splice failed because the pipe had no data */
     LARGE_INTEGER         offset;
     struct ws2_async      write;
 };
@@ -2642,6 +2660,544 @@ static NTSTATUS WS2_async_shutdown( void *user, IO_STATUS_BLOCK *iosb, NTSTATUS
     return status;
 }
 
+/***********************************************************************
+ * Socket reactor
+ *
+ * Overlapped recv and send operations that can't complete immediately, and
+ * that are completed through an event or a completion port, are queued here
+ * instead of in the server. A thread of the process waits for the sockets to
+ * become ready with epoll and completes the operations directly, avoiding the
+ * server round trips needed to register and complete an async.
+ *
+ * The queued operations are also listed in memory shared with the server, so
+ * that NtCancelIoFile(Ex) can find and cancel them, and so that the server can
+ * tell the reactor when a socket handle is closed. The server signals an
+ * eventfd watched by the reactor when either happens.
+ */
+
+#ifdef HAVE_SYS_EPOLL_H
+
+#define REACTOR_HASH_SIZE    256
+#define REACTOR_IDLE_TIMEOUT 1000  /* time after which the reactor thread exits when idle, in ms */
+#define REACTOR_NOTIFY_KEY   (~(ULONGLONG)0)
+
+struct reactor_socket
+{
+    struct list   entry;          /* entry in the hash bucket */
+    SOCKET        s;
+    int           fd;             /* our own copy of the unix fd, registered with epoll */
+    dev_t         dev;            /* device and inode of the fd, to detect handle reuse */
+    ino_t         ino;
+    unsigned int  events;         /* epoll events currently registered */
+    BOOL          has_completion; /* socket is associated with a completion port */
+    struct list   queue[2];       /* pending reads and writes */
+};
+
+static struct list reactor_sockets[REACTOR_HASH_SIZE];
+static int reactor_epoll = -1;
+static int reactor_notify = -1;      /* eventfd signaled by the server */
+static struct user_async_shm *reactor_shm;
+static BOOL reactor_thread_running;
+static LONG reactor_pending;         /* number of queued operations */
+static BOOL reactor_event_select;    /* WSAEventSelect or WSAAsyncSelect has been used */
+
+DECLARE_CRITICAL_SECTION(cs_reactor);
+
+static inline struct list *reactor_bucket( SOCKET s )
+{
+    return &reactor_sockets[(s >> 2) % REACTOR_HASH_SIZE];
+}
+
+static inline struct list *reactor_queue( struct reactor_socket *sock, int type )
+{
+    return &sock->queue[type == ASYNC_TYPE_WRITE];
+}
+
+/* must be called with cs_reactor held */
+static struct reactor_socket *reactor_find_socket( SOCKET s )
+{
+    struct reactor_socket *sock;
+
+    if (reactor_epoll == -1) return NULL;
+    LIST_FOR_EACH_ENTRY( sock, reactor_bucket( s ), struct reactor_socket, entry )
+        if (sock->s == s) return sock;
+    return NULL;
+}
+
+static BOOL socket_has_completion( SOCKET s )
+{
+    BOOL ret = FALSE;
+
+    SERVER_START_REQ( get_fd_completion )
+    {
+        req->handle = wine_server_obj_handle( SOCKET2HANDLE(s) );
+        if (!wine_server_call( req )) ret = reply->associated;
+    }
+    SERVER_END_REQ;
+    return ret;
+}
+
+/* create the epoll instance and register the shared memory with the server; must be called with cs_reactor held */
+static BOOL reactor_init(void)
+{
+    static BOOL failed;
+    struct epoll_event event;
+    HANDLE mapping;
+    NTSTATUS status;
+    unsigned int i;
+    void *ptr;
+
+    if (reactor_shm) return TRUE;
+    if (failed) return FALSE;
+
+    if (reactor_epoll == -1)
+    {
+        if ((reactor_epoll = epoll_create1( EPOLL_CLOEXEC )) == -1)
+        {
+            WARN( "epoll_create1 failed: %s\n", strerror(errno) );
+            return FALSE;
+        }
+        for (i = 0; i < REACTOR_HASH_SIZE; i++) list_init( &reactor_sockets[i] );
+    }
+    if (reactor_notify == -1)
+    {
+        if ((reactor_notify = eventfd( 0, EFD_CLOEXEC | EFD_NONBLOCK )) == -1)
+        {
+            WARN( "eventfd failed: %s\n", strerror(errno) );
+            return FALSE;
+        }
+        event.events   = EPOLLIN;
+        event.data.u64 = REACTOR_NOTIFY_KEY;
+        if (epoll_ctl( reactor_epoll, EPOLL_CTL_ADD, reactor_notify, &event ) == -1)
+        {
+            close( reactor_notify );
+            reactor_notify = -1;
+            return FALSE;
+        }
+    }
+
+    if (!(mapping = CreateFileMappingW( INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, 0, sizeof(*reactor_shm), NULL )))
+        return FALSE;
+    if (!(ptr = MapViewOfFile( mapping, FILE_MAP_WRITE, 0, 0, sizeof(*reactor_shm) )))
+    {
+        CloseHandle( mapping );
+        return FALSE;
+    }
+    wine_server_send_fd( reactor_notify );
+    SERVER_START_REQ( set_user_async_shm )
+    {
+        req->mapping   = wine_server_obj_handle( mapping );
+        req->notify_fd = reactor_notify;
+        status = wine_server_call( req );
+    }
+    SERVER_END_REQ;
+    CloseHandle( mapping );
+    if (status)
+    {
+        WARN( "failed to register shared memory: %08x\n", status );
+        UnmapViewOfFile( ptr );
+        failed = TRUE;
+        return FALSE;
+    }
+    reactor_shm = ptr;
+    return TRUE;
+}
+
+/* list a queued operation in the shared memory; must be called with cs_reactor held */
+static BOOL reactor_alloc_shm_entry( struct ws2_async *wsa, IO_STATUS_BLOCK *iosb )
+{
+    struct user_async_entry *entry;
+    unsigned int i;
+
+    for (i = 0; i < USER_ASYNC_ENTRIES; i++)
+    {
+        entry = &reactor_shm->entries[i];
+        if ((entry->state & USER_ASYNC_STATE_MASK) != USER_ASYNC_FREE) continue;
+
+        entry->iosb   = wine_server_client_ptr( iosb );
+        entry->handle = wine_server_obj_handle( wsa->hSocket );
+        entry->tid    = GetCurrentThreadId();
+        if (i >= reactor_shm->used) InterlockedExchange( (LONG *)&reactor_shm->used, i + 1 );
+        /* bump the generation so that the server can't change the state of a reused entry */
+        InterlockedExchange( (LONG *)&entry->state, (entry->state + USER_ASYNC_STATE_MASK + 1) | USER_ASYNC_QUEUED );
+        wsa->reactor_shm = entry;
+        return TRUE;
+    }
+    return FALSE;
+}
+
+static void reactor_free_shm_entry( struct ws2_async *wsa )
+{
+    LONG state = wsa->reactor_shm->state;
+
+    InterlockedExchange( (LONG *)&wsa->reactor_shm->state, state & ~USER_ASYNC_STATE_MASK );
+}
+
+static inline int reactor_shm_state( struct ws2_async *wsa )
+{
+    return wsa->reactor_shm->state & USER_ASYNC_STATE_MASK;
+}
+
+/* must be called with cs_reactor held */
+static struct reactor_socket *reactor_create_socket( SOCKET s, int fd )
+{
+    struct reactor_socket *sock;
+    struct epoll_event event;
+    struct stat st;
+
+    if (!reactor_init()) return NULL;
+    if (fstat( fd, &st ) == -1) return NULL;
+    if (!(sock = heap_alloc( sizeof(*sock) ))) return NULL;
+    if ((sock->fd = fcntl( fd, F_DUPFD_CLOEXEC, 0 )) == -1)
+    {
+        heap_free( sock );
+        return NULL;
+    }
+    event.events   = 0;
+    event.data.u64 = s;
+    if (epoll_ctl( reactor_epoll, EPOLL_CTL_ADD, sock->fd, &event ) == -1)
+    {
+        close( sock->fd );
+        heap_free( sock );
+        return NULL;
+    }
+    sock->s      = s;
+    sock->dev    = st.st_dev;
+    sock->ino    = st.st_ino;
+    sock->events = 0;
+    sock->has_completion = FALSE;
+    list_init( &sock->queue[0] );
+    list_init( &sock->queue[1] );
+    list_add_head( reactor_bucket( s ), &sock->entry );
+    return sock;
+}
+
+/* remove a socket and move its pending operations to the completed list; must be called with cs_reactor held */
+static void reactor_remove_socket( struct reactor_socket *sock, struct list *completed )
+{
+    struct ws2_async *wsa, *next;
+    unsigned int i;
+
+    for (i = 0; i < ARRAY_SIZE(sock->queue); i++)
+    {
+        LIST_FOR_EACH_ENTRY_SAFE( wsa, next, &sock->queue[i], struct ws2_async, reactor_entry )
+        {
+            list_remove( &wsa->reactor_entry );
+            wsa->local_iosb.u.Status = STATUS_CANCELLED;
+            wsa->local_iosb.Information = 0;
+            list_add_tail( completed, &wsa->reactor_entry );
+            reactor_pending--;
+        }
+    }
+    epoll_ctl( reactor_epoll, EPOLL_CTL_DEL, sock->fd, NULL );
+    close( sock->fd );
+    list_remove( &sock->entry );
+    heap_free( sock );
+}
+
+/* update the events we are waiting for; must be called with cs_reactor held */
+static void reactor_update_events( struct reactor_socket *sock )
+{
+    struct epoll_event event;
+
+    event.events = 0;
+    if (!list_empty( &sock->queue[0] )) event.events |= EPOLLIN;
+    if (!list_empty( &sock->queue[1] )) event.events |= EPOLLOUT;
+    if (event.events == sock->events) return;
+
+    event.data.u64 = sock->s;
+    if (!epoll_ctl( reactor_epoll, EPOLL_CTL_MOD, sock->fd, &event ))
+        sock->events = event.events;
+    else
+        ERR( "epoll_ctl failed: %s\n", strerror(errno) );
+}
+
+/* perform the queued operations until one would block; must be called with cs_reactor held */
+static void reactor_process_queue( struct reactor_socket *sock, int type, struct list *completed )
+{
+    struct list *queue = reactor_queue( sock, type );
+    struct list *ptr;
+    struct ws2_async *wsa;
+    int result;
+
+    while ((ptr = list_head( queue )))
+    {
+        wsa = LIST_ENTRY( ptr, struct ws2_async, reactor_entry );
+
+        if (type == ASYNC_TYPE_READ)
+        {
+            if ((result = WS2_recv( sock->fd, wsa, convert_flags(wsa->flags) )) == -1 && errno == EAGAIN)
+                break;
+            wsa->local_iosb.u.Status = result >= 0 ? STATUS_SUCCESS : wsaErrStatus();
+            wsa->local_iosb.Information = max( result, 0 );
+        }
+        else
+        {
+            if (wsa->first_iovec < wsa->n_iovecs)
+            {
+                if ((result = WS2_send( sock->fd, wsa, convert_flags(wsa->flags) )) == -1)
+                {
+                    if (errno == EAGAIN) break;
+                    wsa->local_iosb.u.Status = wsaErrStatus();
+                }
+                else
+                {
+                    wsa->iosb->Information += result;
+                    if (wsa->first_iovec < wsa->n_iovecs) break;
+                    wsa->local_iosb.u.Status = STATUS_SUCCESS;
+                }
+            }
+            else wsa->local_iosb.u.Status = STATUS_SUCCESS;
+            wsa->local_iosb.Information = wsa->iosb->Information;
+        }
+
+        list_remove( &wsa->reactor_entry );
+        list_add_tail( completed, &wsa->reactor_entry );
+        reactor_pending--;
+    }
+}
+
+/* check whether the handle of a socket still refers to the same socket */
+static BOOL reactor_socket_is_valid( struct reactor_socket *sock )
+{
+    struct stat st;
+    BOOL valid = FALSE;
+    int fd;
+
+    if (!wine_server_handle_to_fd( SOCKET2HANDLE(sock->s), 0, &fd, NULL ))
+    {
+        valid = !fstat( fd, &st ) && st.st_dev == sock->dev && st.st_ino == sock->ino;
+        wine_server_release_fd( SOCKET2HANDLE(sock->s), fd );
+    }
+    return valid;
+}
+
+/* handle the operations cancelled by the server, and the sockets whose handle has been
+ * closed without closesocket(); must be called with cs_reactor held */
+static void reactor_process_notifications( struct list *completed )
+{
+    struct reactor_socket *sock, *next;
+    struct ws2_async *wsa, *next_wsa;
+    unsigned int i, j;
+    ULONGLONG count;
+    BOOL closed;
+
+    if (read( reactor_notify, &count, sizeof(count) ) == -1) return;
+
+    for (i = 0; i < REACTOR_HASH_SIZE; i++)
+    {
+        LIST_FOR_EACH_ENTRY_SAFE( sock, next, &reactor_sockets[i], struct reactor_socket, entry )
+        {
+            closed = FALSE;
+            for (j = 0; j < ARRAY_SIZE(sock->queue); j++)
+            {
+                LIST_FOR_EACH_ENTRY_SAFE( wsa, next_wsa, &sock->queue[j], struct ws2_async, reactor_entry )
+                {
+                    switch (reactor_shm_state( wsa ))
+                    {
+                    case USER_ASYNC_CANCELLED:
+                        list_remove( &wsa->reactor_entry );
+                        wsa->local_iosb.u.Status = STATUS_CANCELLED;
+                        wsa->local_iosb.Information = j ? wsa->iosb->Information : 0;
+                        list_add_tail( completed, &wsa->reactor_entry );
+                        reactor_pending--;
+                        break;
+                    case USER_ASYNC_CLOSED:
+                        closed = TRUE;
+                        break;
+                    }
+                }
+            }
+            if (closed && !reactor_socket_is_valid( sock )) reactor_remove_socket( sock, completed );
+            else reactor_update_events( sock );
+        }
+    }
+}
+
+/* report the result of completed operations */
+static void reactor_complete( struct list *completed )
+{
+    struct ws2_async *wsa, *next;
+    IO_STATUS_BLOCK *iosb;
+    NTSTATUS status;
+    ULONG_PTR information;
+    int type;
+
+    LIST_FOR_EACH_ENTRY_SAFE( wsa, next, completed, struct ws2_async, reactor_entry )
+    {
+        status      = wsa->local_iosb.u.Status;
+        information = wsa->local_iosb.Information;
+        type        = wsa->io.callback == WS2_async_recv ? ASYNC_TYPE_READ : ASYNC_TYPE_WRITE;
+        iosb        = wsa->iosb;
+
+        reactor_free_shm_entry( wsa );
+        iosb->Information = information;
+        iosb->u.Status    = status;
+        if (wsa->cvalue) WS_AddCompletion( HANDLE2SOCKET(wsa->hSocket), wsa->cvalue, status, information, TRUE );
+        if (wsa->event) NtSetEvent( wsa->event, NULL );
+        /* the server doesn't know about the operation, re-enable the events that it would have
+         * re-enabled itself; FD_READ also lets it detect FD_CLOSE after the data was consumed */
+        if (status != STATUS_CANCELLED && reactor_event_select)
+            _enable_event( wsa->hSocket, type == ASYNC_TYPE_READ ? FD_READ | FD_OOB : FD_WRITE, 0, 0 );
+        release_async_io( &wsa->io );
+    }
+}
+
+static DWORD CALLBACK reactor_thread( void *arg )
+{
+    struct epoll_event events[64];
+    struct reactor_socket *sock, *next;
+    struct list completed;
+    unsigned int i;
+    int count;
+
+    for (;;)
+    {
+        list_init( &completed );
+        if ((count = epoll_wait( reactor_epoll, events, ARRAY_SIZE(events), REACTOR_IDLE_TIMEOUT )) == -1)
+        {
+            if (errno != EINTR) ERR( "epoll_wait failed: %s\n", strerror(errno) );
+            count = 0;
+        }
+
+        EnterCriticalSection( &cs_reactor );
+        for (i = 0; i < count; i++)
+        {
+            if (events[i].data.u64 == REACTOR_NOTIFY_KEY)
+            {
+                reactor_process_notifications( &completed );
+                continue;
+            }
+            if (!(sock = reactor_find_socket( events[i].data.u64 ))) continue;
+            if (events[i].events & (EPOLLIN | EPOLLERR | EPOLLHUP))
+                reactor_process_queue( sock, ASYNC_TYPE_READ, &completed );
+            if (events[i].events & (EPOLLOUT | EPOLLERR | EPOLLHUP))
+                reactor_process_queue( sock, ASYNC_TYPE_WRITE, &completed );
+            reactor_update_events( sock );
+        }
+        if (!count && !reactor_pending)
+        {
+            /* nothing left to do, drop our references to the sockets and exit */
+            for (i = 0; i < REACTOR_HASH_SIZE; i++)
+                LIST_FOR_EACH_ENTRY_SAFE( sock, next, &reactor_sockets[i], struct reactor_socket, entry )
+                    reactor_remove_socket( sock, &completed );
+            reactor_thread_running = FALSE;
+            LeaveCriticalSection( &cs_reactor );
+            reactor_complete( &completed );
+            return 0;
+        }
+        LeaveCriticalSection( &cs_reactor );
+
+        reactor_complete( &completed );
+    }
+}
+
+/***********************************************************************
+ *              reactor_queue_async     (INTERNAL)
+ *
+ * Queue an overlapped operation that would block. Returns STATUS_NOT_SUPPORTED
+ * if it has to be registered with the server instead.
+ */
+static NTSTATUS reactor_queue_async( SOCKET s, int fd, int type, struct ws2_async *wsa,
+                                     IO_STATUS_BLOCK *iosb, HANDLE event, ULONG_PTR cvalue )
+{
+    struct reactor_socket *sock;
+    struct list completed = LIST_INIT( completed );
+    NTSTATUS status = STATUS_NOT_SUPPORTED;
+    HANDLE thread;
+    struct stat st;
+
+    /* completion routines have to run in the thread that started the operation */
+    if (wsa->completion_func || (wsa->flags & WS_MSG_OOB)) return STATUS_NOT_SUPPORTED;
+    /* without an event or a completion port, the socket handle itself is waited on */
+    if (!event && !cvalue) return STATUS_NOT_SUPPORTED;
+
+    EnterCriticalSection( &cs_reactor );
+    if ((sock = reactor_find_socket( s )) && (fstat( fd, &st ) || st.st_dev != sock->dev || st.st_ino != sock->ino))
+    {
+        /* the handle has been closed and reused before we were notified */
+        reactor_remove_socket( sock, &completed );
+        sock = NULL;
+    }
+    if (!sock) sock = reactor_create_socket( s, fd );
+    if (sock && !event && !sock->has_completion) sock->has_completion = socket_has_completion( s );
+    if (sock && (event || sock->has_completion))
+    {
+        if (!reactor_thread_running)
+        {
+            if ((thread = CreateThread( NULL, 0, reactor_thread, NULL, 0, NULL )))
+            {
+                CloseHandle( thread );
+                reactor_thread_running = TRUE;
+            }
+        }
+        if (reactor_thread_running && reactor_alloc_shm_entry( wsa, iosb ))
+        {
+            wsa->iosb   = iosb;
+            wsa->event  = event;
+            wsa->cvalue = cvalue;
+            list_add_tail( reactor_queue( sock, type ), &wsa->reactor_entry );
+            reactor_pending++;
+            reactor_update_events( sock );
+            status = STATUS_PENDING;
+        }
+    }
+    /* don't keep a reference to the socket if nobody is going to release it */
+    if (sock && !reactor_thread_running) reactor_remove_socket( sock, NULL );
+    LeaveCriticalSection( &cs_reactor );
+    reactor_complete( &completed );
+    return status;
+}
+
+/* check whether operations are already queued, in which case a new one must not be attempted immediately */
+static BOOL reactor_has_pending( SOCKET s, int type )
+{
+    struct reactor_socket *sock;
+    BOOL ret = FALSE;
+
+    if (!reactor_pending) return FALSE;
+
+    EnterCriticalSection( &cs_reactor );
+    if ((sock = reactor_find_socket( s ))) ret = !list_empty( reactor_queue( sock, type ) );
+    LeaveCriticalSection( &cs_reactor );
+    return ret;
+}
+
+/* cancel the queued operations of a socket that is being closed */
+static void reactor_close_socket( SOCKET s )
+{
+    struct reactor_socket *sock;
+    struct list completed = LIST_INIT( completed );
+
+    if (reactor_epoll == -1) return;
+
+    EnterCriticalSection( &cs_reactor );
+    if ((sock = reactor_find_socket( s ))) reactor_remove_socket( sock, &completed );
+    LeaveCriticalSection( &cs_reactor );
+    reactor_complete( &completed );
+}
+
+#else  /* HAVE_SYS_EPOLL_H */
+
+static BOOL reactor_event_select;
+
+static NTSTATUS reactor_queue_async( SOCKET s, int fd, int type, struct ws2_async *wsa,
+                                     IO_STATUS_BLOCK *iosb, HANDLE event, ULONG_PTR cvalue )
+{
+    return STATUS_NOT_SUPPORTED;
+}
+
+static BOOL reactor_has_pending( SOCKET s, int type )
+{
+    return FALSE;
+}
+
+static void reactor_close_socket( SOCKET s )
+{
+}
+
+#endif  /* HAVE_SYS_EPOLL_H */
+
 /***********************************************************************
  *  WS2_register_async_shutdown         (INTERNAL)
  *
@@ -2887,6 +3443,95 @@ static NTSTATUS WS2_transmitfile_getbuffer( int fd, struct ws2_transmitfile_asyn
     return STATUS_SUCCESS;
 }
 
+#define TRANSMITFILE_ZEROCOPY_CHUNK (1 << 20)
+
+/***********************************************************************
+ *     WS2_transmitfile_zerocopy        (INTERNAL)
+ *
+ * Send the next chunk of the main file straight from the kernel, without
+ * copying it through a user space buffer. Returns STATUS_NOT_SUPPORTED if
+ * the file has to be read into the buffer instead.
+ */
+static NTSTATUS WS2_transmitfile_zerocopy( int fd, struct ws2_transmitfile_async *wsa, ssize_t *sent )
+{
+    NTSTATUS status = STATUS_NOT_SUPPORTED;
+    size_t count = TRANSMITFILE_ZEROCOPY_CHUNK;
+    struct stat st;
+    int file_fd;
+
+    *sent = 0;
+    wsa->source_empty = FALSE;
+    if (wsa->file_bytes != 0) count = min( count, wsa->file_bytes - wsa->file_read );
+    if (wine_server_handle_to_fd( wsa->file, FILE_READ_DATA, &file_fd, NULL )) return STATUS_NOT_SUPPORTED;
+    if (fstat( file_fd, &st ) == -1) goto done;
+
+#ifdef HAVE_SYS_SENDFILE_H
+    if (S_ISREG( st.st_mode ))
+    {
+        off_t offset = wsa->offset.QuadPart;
+
+        if (wsa->offset.QuadPart == FILE_USE_FILE_POINTER_POSITION)
+            while ((*sent = sendfile( fd, file_fd, NULL, count )) == -1 && errno == EINTR);
+        else
+            while ((*sent = sendfile( fd, file_fd, &offset, count )) == -1 && errno == EINTR);
+    }
+#endif
+#ifdef SPLICE_F_MOVE
+    if (S_ISFIFO( st.st_mode ))
+        while ((*sent = splice( file_fd, NULL, fd, NULL, count, SPLICE_F_MOVE )) == -1 && errno == EINTR);
+#endif
+    if (!S_ISREG( st.st_mode ) && !S_ISFIFO( st.st_mode )) goto done;
+
+    if (*sent > 0)
+    {
+        if (wsa->offset.QuadPart != FILE_USE_FILE_POINTER_POSITION)
+            wsa->offset.QuadPart += *sent;
+        wsa->file_read += *sent;
+        if (wsa->file_bytes != 0 && wsa->file_read >= wsa->file_bytes)
+            wsa->file = NULL;
+        status = STATUS_PENDING;
+    }
+    else if (!*sent)
+    {
+        /* end of file, continue on to the footer */
+        wsa->file = NULL;
+        status = STATUS_PENDING;
+    }
+    else if (errno == EAGAIN)
+    {
+        /* either side may be the one that would block; a writable socket
+         * will not help if the pipe is empty, so remember which one it was */
+        if (S_ISFIFO( st.st_mode ))
+            wsa->source_empty = !(do_block( file_fd, POLLIN, 0 ) & POLLIN);
+        *sent = 0;
+        status = STATUS_PENDING;
+    }
+    else if (errno != EINVAL && errno != ENOSYS && errno != ESPIPE)
+    {
+        *sent = 0;
+        status = wsaErrStatus();
+    }
+    else *sent = 0;
+
+done:
+    wine_server_release_fd( wsa->file, file_fd );
+    return status;
+}
+
+/***********************************************************************
+ *     WS2_transmitfile_disconnect      (INTERNAL)
+ *
+ * Disconnect the socket once the transfer is complete, if requested.
+ */
+static NTSTATUS WS2_transmitfile_disconnect( int fd, struct ws2_transmitfile_async *wsa )
+{
+    if (!(wsa->flags & TF_DISCONNECT)) return STATUS_SUCCESS;
+
+    if (shutdown( fd, SHUT_RDWR ) && errno != ENOTCONN) return wsaErrStatus();
+    _enable_event( wsa->write.hSocket, 0, 0, FD_READ | FD_WRITE | FD_WINE_LISTENING );
+    return STATUS_SUCCESS;
+}
+
 /***********************************************************************
  *     WS2_transmitfile_base            (INTERNAL)
  *
@@ -2894,12 +3539,26 @@ static NTSTATUS WS2_transmitfile_getbuffer( int fd, struct ws2_transmitfile_asyn
  */
 static NTSTATUS WS2_transmitfile_base( int fd, struct ws2_transmitfile_async *wsa )
 {
+    IO_STATUS_BLOCK *iosb = (IO_STATUS_BLOCK *)wsa->write.user_overlapped;
     NTSTATUS status;
 
+    /* once the header has been sent, the file can go directly to the socket */
+    if (wsa->zerocopy && wsa->file && !wsa->buffers.Head && wsa->write.first_iovec >= wsa->write.n_iovecs)
+    {
+        ssize_t sent;
+
+        status = WS2_transmitfile_zerocopy( fd, wsa, &sent );
+        if (status != STATUS_NOT_SUPPORTED)
+        {
+            if (iosb) iosb->Information += sent;
+            return status;
+        }
+        wsa->zerocopy = FALSE;
+    }
+
     status = WS2_transmitfile_getbuffer( fd, wsa );
     if (status == STATUS_PENDING)
     {
-        IO_STATUS_BLOCK *iosb = (IO_STATUS_BLOCK *)wsa->write.user_overlapped;
         int n;
 
         n = WS2_send( fd, &wsa->write, convert_flags(wsa->write.flags) );
@@ -2910,6 +3569,8 @@ static NTSTATUS WS2_transmitfile_base( int fd, struct ws2_transmitfile_async *ws
         else if (errno != EAGAIN)
             return wsaErrStatus();
     }
+    else if (status == STATUS_SUCCESS)
+        status = WS2_transmitfile_disconnect( fd, wsa );
 
     return status;
 }
@@ -2940,6 +3601,20 @@ static NTSTATUS WS2_async_transmitfile( void *user, IO_STATUS_BLOCK *iosb, NTSTA
     return status;
 }
 
+#ifdef SPLICE_F_MOVE
+static BOOL is_unix_fifo( HANDLE handle )
+{
+    struct stat st;
+    BOOL ret;
+    int fd;
+
+    if (wine_server_handle_to_fd( handle, FILE_READ_DATA, &fd, NULL )) return FALSE;
+    ret = !fstat( fd, &st ) && S_ISFIFO( st.st_mode );
+    wine_server_release_fd( handle, fd );
+    return ret;
+}
+#endif
+
 /***********************************************************************
  *     TransmitFile
  */
@@ -2950,6 +3625,7 @@ static BOOL WINAPI WS2_TransmitFile( SOCKET s, HANDLE h, DWORD file_bytes, DWORD
     union generic_unix_sockaddr uaddr;
     socklen_t uaddrlen = sizeof(uaddr);
     struct ws2_transmitfile_async *wsa;
+    DWORD file_type;
     NTSTATUS status;
     int fd;
 
@@ -2965,15 +3641,21 @@ static BOOL WINAPI WS2_TransmitFile( SOCKET s, HANDLE h, DWORD file_bytes, DWORD
         WSASetLastError( WSAENOTCONN );
         return FALSE;
     }
-    if (flags)
+    if (flags & ~TF_DISCONNECT)
         FIXME("Flags are not currently supported (0x%x).\n", flags);
 
-    if (h && GetFileType( h ) != FILE_TYPE_DISK)
+    if (h && (file_type = GetFileType( h )) != FILE_TYPE_DISK)
     {
-        FIXME("Non-disk file handles are not currently supported.\n");
-        release_sock_fd( s, fd );
-        WSASetLastError( WSAEOPNOTSUPP );
-        return FALSE;
+#ifdef SPLICE_F_MOVE
+        /* unix pipes are spliced synchronously, an async would block waiting for the writer */
+        if (file_type != FILE_TYPE_PIPE || overlapped || !is_unix_fifo( h ))
+#endif
+        {
+            FIXME("Non-disk file handles are not currently supported.\n");
+            release_sock_fd( s, fd );
+            WSASetLastError( WSAEOPNOTSUPP );
+            return FALSE;
+        }
     }
 
     /* set reasonable defaults when requested */
@@ -2997,6 +3679,8 @@ static BOOL WINAPI WS2_TransmitFile( SOCKET s, HANDLE h, DWORD file_bytes, DWORD
     wsa->file_bytes            = file_bytes;
     wsa->bytes_per_send        = bytes_per_send;
     wsa->flags                 = flags;
+    wsa->zerocopy              = TRUE;
+    wsa->source_empty          = FALSE;
     wsa->offset.QuadPart       = FILE_USE_FILE_POINTER_POSITION;
     wsa->write.hSocket         = SOCKET2HANDLE(s);
     wsa->write.addr            = NULL;
@@ -3010,6 +3694,7 @@ static BOOL WINAPI WS2_TransmitFile( SOCKET s, HANDLE h, DWORD file_bytes, DWORD
     if (overlapped)
     {
         IO_STATUS_BLOCK *iosb = (IO_STATUS_BLOCK *)overlapped;
+        ULONG_PTR cvalue = ((ULONG_PTR)overlapped->hEvent & 1) == 0 ? (ULONG_PTR)overlapped : 0;
         int status;
 
         wsa->offset.u.LowPart  = overlapped->u.s.Offset;
@@ -3017,7 +3702,7 @@ static BOOL WINAPI WS2_TransmitFile( SOCKET s, HANDLE h, DWORD file_bytes, DWORD
         iosb->u.Status = STATUS_PENDING;
         iosb->Information = 0;
         status = register_async( ASYNC_TYPE_WRITE, SOCKET2HANDLE(s), &wsa->io,
-                                 overlapped->hEvent, NULL, NULL, iosb );
+                                 overlapped->hEvent, NULL, (void *)cvalue, iosb );
         if(status != STATUS_PENDING) HeapFree( GetProcessHeap(), 0, wsa );
         release_sock_fd( s, fd );
         WSASetLastError( NtStatusToWSAError(status) );
@@ -3027,7 +3712,18 @@ static BOOL WINAPI WS2_TransmitFile( SOCKET s, HANDLE h, DWORD file_bytes, DWORD
     do
     {
         status = WS2_transmitfile_base( fd, wsa );
-        if (status == STATUS_PENDING)
+        if (status == STATUS_PENDING && wsa->source_empty)
+        {
+            int file_fd;
+
+            /* the socket is not what we are waiting for, block on the pipe */
+            if (!wine_server_handle_to_fd( wsa->file, FILE_READ_DATA, &file_fd, NULL ))
+            {
+                do_block( file_fd, POLLIN, -1 );
+                wine_server_release_fd( wsa->file, file_fd );
+            }
+        }
+        else if (status == STATUS_PENDING)
         {
             /* block here */
             do_block(fd, POLLOUT, -1);
@@ -3302,6 +3998,7 @@ int WINAPI WS_closesocket(SOCKET s)
         {
             release_sock_fd(s, fd);
             socket_list_remove(s);
+            reactor_close_socket(s);
             if (CloseHandle(SOCKET2HANDLE(s)))
                 res = 0;
         }
@@ -5469,7 +6166,13 @@ static int WS2_sendto( SOCKET s, LPWSABUF lpBuffers, DWORD dwBufferCount,
     }
 
     flags = convert_flags(dwFlags);
-    n = WS2_send( fd, wsa, flags );
+    if (overlapped && reactor_has_pending( s, ASYNC_TYPE_WRITE ))
+    {
+        /* don't send ahead of the queued data */
+        n = -1;
+        errno = EAGAIN;
+    }
+    else n = WS2_send( fd, wsa, flags );
     if (n == -1 && errno != EAGAIN)
     {
         err = wsaErrno();
@@ -5483,13 +6186,20 @@ static int WS2_sendto( SOCKET s, LPWSABUF lpBuffers, DWORD dwBufferCount,
 
         wsa->user_overlapped = lpOverlapped;
         wsa->completion_func = lpCompletionRoutine;
-        release_sock_fd( s, fd );
 
         if (n == -1 || n < totalLength)
         {
             iosb->u.Status = STATUS_PENDING;
             iosb->Information = n == -1 ? 0 : n;
 
+            err = reactor_queue_async( s, fd, ASYNC_TYPE_WRITE, wsa, iosb, lpOverlapped->hEvent, cvalue );
+            release_sock_fd( s, fd );
+            if (err == STATUS_PENDING)
+            {
+                SetLastError( WSA_IO_PENDING );
+                return SOCKET_ERROR;
+            }
+
             if (wsa->completion_func)
                 err = register_async( ASYNC_TYPE_WRITE, wsa->hSocket, &wsa->io, NULL,
                                       ws2_async_apc, wsa, iosb );
@@ -5506,6 +6216,7 @@ static int WS2_sendto( SOCKET s, LPWSABUF lpBuffers, DWORD dwBufferCount,
             return SOCKET_ERROR;
         }
 
+        release_sock_fd( s, fd );
         iosb->u.Status = STATUS_SUCCESS;
         iosb->Information = n;
         if (lpNumberOfBytesSent) *lpNumberOfBytesSent = n;
@@ -7217,6 +7928,8 @@ int WINAPI WSAEventSelect(SOCKET s, WSAEVENT hEvent, LONG lEvent)
 
     TRACE("%04lx, hEvent %p, event %08x\n", s, hEvent, lEvent);
 
+    if (lEvent) reactor_event_select = TRUE;
+
     SERVER_START_REQ( set_socket_event )
     {
         req->handle = wine_server_obj_handle( SOCKET2HANDLE(s) );
@@ -7286,6 +7999,8 @@ INT WINAPI WSAAsyncSelect(SOCKET s, HWND hWnd, UINT uMsg, LONG lEvent)
 
     TRACE("%04lx, hWnd %p, uMsg %08x, event %08x\n", s, hWnd, uMsg, lEvent);
 
+    if (lEvent) reactor_event_select = TRUE;
+
     SERVER_START_REQ( set_socket_event )
     {
         req->handle = wine_server_obj_handle( SOCKET2HANDLE(s) );
@@ -7833,7 +8548,13 @@ static int WS2_recv_base( SOCKET s, LPWSABUF lpBuffers, DWORD dwBufferCount,
     flags = convert_flags(wsa->flags);
     for (;;)
     {
-        n = WS2_recv( fd, wsa, flags );
+        if (overlapped && reactor_has_pending( s, ASYNC_TYPE_READ ))
+        {
+            /* don't receive ahead of the queued requests */
+            n = -1;
+            errno = EAGAIN;
+        }
+        else n = WS2_recv( fd, wsa, flags );
         if (n == -1)
         {
             /* Unix-like systems return EINVAL when attempting to read OOB data from
@@ -7855,13 +8576,20 @@ static int WS2_recv_base( SOCKET s, LPWSABUF lpBuffers, DWORD dwBufferCount,
 
             wsa->user_overlapped = lpOverlapped;
             wsa->completion_func = lpCompletionRoutine;
-            release_sock_fd( s, fd );
 
             if (n == -1)
             {
                 iosb->u.Status = STATUS_PENDING;
                 iosb->Information = 0;
 
+                err = reactor_queue_async( s, fd, ASYNC_TYPE_READ, wsa, iosb, lpOverlapped->hEvent, cvalue );
+                release_sock_fd( s, fd );
+                if (err == STATUS_PENDING)
+                {
+                    SetLastError( WSA_IO_PENDING );
+                    return SOCKET_ERROR;
+                }
+
                 if (wsa->completion_func)
                     err = register_async( ASYNC_TYPE_READ, wsa->hSocket, &wsa->io, NULL,
                                           ws2_async_apc, wsa, iosb );
@@ -7874,6 +8602,7 @@ static int WS2_recv_base( SOCKET s, LPWSABUF lpBuffers, DWORD dwBufferCount,
                 return SOCKET_ERROR;
             }
 
+            release_sock_fd( s, fd );
             iosb->u.Status = STATUS_SUCCESS;
             iosb->Information = n;
             if (!wsa->completion_func)
@@ -8147,6 +8147,85 @@ static void test_TransmitFile(void)
     closesocket(server);
 }
 
+#define TRANSMIT_FILE_SIZE (4 * 1024 * 1024)
+
+static void test_TransmitFile_large(void)
+{
+    GUID transmitFileGuid = WSAID_TRANSMITFILE;
+    LPFN_TRANSMITFILE pTransmitFile = NULL;
+    static const char header_msg[] = "header", footer_msg[] = "footer";
+    char temp_path[MAX_PATH], file_name[MAX_PATH];
+    DWORD i, size, file_bytes, expected, received = 0, start, elapsed;
+    TRANSMIT_FILE_BUFFERS buffers;
+    unsigned char *data, *buf;
+    SOCKET client, dest;
+    OVERLAPPED ov;
+    HANDLE file;
+    BOOL bret;
+    int ret;
+
+    tcp_socketpair_ovl(&client, &dest);
+    ret = WSAIoctl(client, SIO_GET_EXTENSION_FUNCTION_POINTER, &transmitFileGuid, sizeof(transmitFileGuid),
+                   &pTransmitFile, sizeof(pTransmitFile), &size, NULL, NULL);
+    ok(!ret, "failed to get TransmitFile, error %u\n", WSAGetLastError());
+
+    data = HeapAlloc(GetProcessHeap(), 0, TRANSMIT_FILE_SIZE);
+    buf = HeapAlloc(GetProcessHeap(), 0, TRANSMIT_FILE_SIZE);
+    for (i = 0; i < TRANSMIT_FILE_SIZE; i++) data[i] = i * 7 + (i >> 12);
+
+    GetTempPathA(MAX_PATH, temp_path);
+    GetTempFileNameA(temp_path, "tf", 0, file_name);
+    file = CreateFileA(file_name, GENERIC_READ | GENERIC_WRITE, 0, NULL, CREATE_ALWAYS,
+                       FILE_FLAG_DELETE_ON_CLOSE, NULL);
+    ok(file != INVALID_HANDLE_VALUE, "failed to create file, error %u\n", GetLastError());
+    bret = WriteFile(file, data, TRANSMIT_FILE_SIZE, &size, NULL);
+    ok(bret && size == TRANSMIT_FILE_SIZE, "WriteFile failed, error %u\n", GetLastError());
+
+    /* send a range of the file surrounded by head and tail buffers, then disconnect */
+    buffers.Head = (void *)header_msg;
+    buffers.HeadLength = sizeof(header_msg);
+    buffers.Tail = (void *)footer_msg;
+    buffers.TailLength = sizeof(footer_msg);
+    file_bytes = TRANSMIT_FILE_SIZE - 8192;
+    expected = sizeof(header_msg) + file_bytes + sizeof(footer_msg);
+
+    memset(&ov, 0, sizeof(ov));
+    ov.hEvent = CreateEventW(NULL, TRUE, FALSE, NULL);
+    ov.Offset = 4096;
+    start = GetTickCount();
+    bret = pTransmitFile(client, file, file_bytes, 0, &ov, &buffers, TF_DISCONNECT);
+    ok(bret || WSAGetLastError() == ERROR_IO_PENDING, "TransmitFile failed, error %u\n", WSAGetLastError());
+
+    while (received < TRANSMIT_FILE_SIZE)
+    {
+        ret = recv(dest, (char *)buf + received, TRANSMIT_FILE_SIZE - received, 0);
+        ok(ret >= 0, "recv failed, error %u\n", WSAGetLastError());
+        if (ret <= 0) break;
+        received += ret;
+    }
+    elapsed = GetTickCount() - start;
+    ok(received == expected, "received %u bytes, expected %u\n", received, expected);
+    ok(!memcmp(buf, header_msg, sizeof(header_msg)), "header didn't match\n");
+    ok(!memcmp(buf + sizeof(header_msg), data + 4096, file_bytes), "file data didn't match\n");
+    ok(!memcmp(buf + sizeof(header_msg) + file_bytes, footer_msg, sizeof(footer_msg)), "footer didn't match\n");
+
+    ret = WaitForSingleObject(ov.hEvent, 5000);
+    ok(!ret, "wait failed, ret %d\n", ret);
+    bret = WSAGetOverlappedResult(client, &ov, &size, FALSE, NULL);
+    ok(bret, "TransmitFile failed, error %u\n", WSAGetLastError());
+    ok(size == expected, "sent %u bytes, expected %u\n", size, expected);
+
+    if (winetest_interactive)
+        trace("TransmitFile: %u bytes in %u ms\n", received, elapsed);
+
+    CloseHandle(ov.hEvent);
+    CloseHandle(file);
+    HeapFree(GetProcessHeap(), 0, buf);
+    HeapFree(GetProcessHeap(), 0, data);
+    closesocket(client);
+    closesocket(dest);
+}
+
 static void test_getpeername(void)
 {
     SOCKET sock;
@@ -9411,6 +9490,201 @@ static void test_completion_port(void)
     CloseHandle(previous_port);
 }
 
+#define ECHO_MESSAGES     2000
+#define ECHO_MESSAGE_SIZE 64
+
+static int __cdecl compare_latency(const void *a, const void *b)
+{
+    const LONGLONG *x = a, *y = b;
+    return *x < *y ? -1 : *x > *y;
+}
+
+static void post_echo_recv(SOCKET s, char *buf, DWORD len, OVERLAPPED *ov)
+{
+    DWORD flags = 0;
+    WSABUF wsabuf;
+    int ret;
+
+    memset(ov, 0, sizeof(*ov));
+    wsabuf.buf = buf;
+    wsabuf.len = len;
+    ret = WSARecv(s, &wsabuf, 1, NULL, &flags, ov, NULL);
+    ok(!ret || WSAGetLastError() == ERROR_IO_PENDING, "WSARecv failed, error %u\n", WSAGetLastError());
+}
+
+static void post_echo_send(SOCKET s, char *buf, DWORD len, OVERLAPPED *ov)
+{
+    WSABUF wsabuf;
+    int ret;
+
+    memset(ov, 0, sizeof(*ov));
+    wsabuf.buf = buf;
+    wsabuf.len = len;
+    ret = WSASend(s, &wsabuf, 1, NULL, 0, ov, NULL);
+    ok(!ret || WSAGetLastError() == ERROR_IO_PENDING, "WSASend failed, error %u\n", WSAGetLastError());
+}
+
+static void test_iocp_echo(void)
+{
+    char client_buf[ECHO_MESSAGE_SIZE], server_buf[ECHO_MESSAGE_SIZE], echo_buf[ECHO_MESSAGE_SIZE];
+    char message[ECHO_MESSAGE_SIZE];
+    OVERLAPPED client_recv, client_send, server_recv, server_send, *ovl;
+    DWORD client_got = 0, server_got = 0, size, start_ticks;
+    LARGE_INTEGER freq, sent, now;
+    LONGLONG *latency;
+    unsigned int count = 0;
+    SOCKET client, server;
+    ULONG_PTR key;
+    HANDLE port;
+    BOOL ret;
+
+    latency = HeapAlloc(GetProcessHeap(), 0, ECHO_MESSAGES * sizeof(*latency));
+    QueryPerformanceFrequency(&freq);
+
+    tcp_socketpair_ovl(&client, &server);
+    port = CreateIoCompletionPort((HANDLE)client, NULL, 1, 0);
+    ok(port != NULL, "failed to create completion port, error %u\n", GetLastError());
+    port = CreateIoCompletionPort((HANDLE)server, port, 2, 0);
+    ok(port != NULL, "failed to associate completion port, error %u\n", GetLastError());
+
+    post_echo_recv(server, server_buf, sizeof(server_buf), &server_recv);
+    post_echo_recv(client, client_buf, sizeof(client_buf), &client_recv);
+
+    start_ticks = GetTickCount();
+    memset(message, 0, sizeof(message));
+    QueryPerformanceCounter(&sent);
+    post_echo_send(client, message, sizeof(message), &client_send);
+
+    while (count < ECHO_MESSAGES)
+    {
+        ret = GetQueuedCompletionStatus(port, &size, &key, &ovl, 5000);
+        ok(ret, "GetQueuedCompletionStatus failed, error %u\n", GetLastError());
+        if (!ret) break;
+
+        if (ovl == &client_send || ovl == &server_send)
+        {
+            ok(size == ECHO_MESSAGE_SIZE, "got size %u\n", size);
+            ok(key == (ovl == &client_send ? 1 : 2), "got key %lu\n", key);
+        }
+        else if (ovl == &server_recv)
+        {
+            ok(key == 2, "got key %lu\n", key);
+            ok(size, "connection closed\n");
+            if (!size) break;
+            if ((server_got += size) == sizeof(server_buf))
+            {
+                memcpy(echo_buf, server_buf, sizeof(echo_buf));
+                post_echo_send(server, echo_buf, sizeof(echo_buf), &server_send);
+                server_got = 0;
+            }
+            post_echo_recv(server, server_buf + server_got, sizeof(server_buf) - server_got, &server_recv);
+        }
+        else if (ovl == &client_recv)
+        {
+            ok(key == 1, "got key %lu\n", key);
+            ok(size, "connection closed\n");
+            if (!size) break;
+            if ((client_got += size) == sizeof(client_buf))
+            {
+                QueryPerformanceCounter(&now);
+                ok(!memcmp(client_buf, message, sizeof(message)), "message %u corrupted\n", count);
+                latency[count++] = now.QuadPart - sent.QuadPart;
+                client_got = 0;
+                if (count == ECHO_MESSAGES) break;
+
+                memset(message, count & 0xff, sizeof(message));
+                *(unsigned int *)message = count;
+                QueryPerformanceCounter(&sent);
+                post_echo_send(client, message, sizeof(message), &client_send);
+            }
+            post_echo_recv(client, client_buf + client_got, sizeof(client_buf) - client_got, &client_recv);
+        }
+        else ok(0, "unexpected overlapped %p\n", ovl);
+    }
+    ok(count == ECHO_MESSAGES, "got %u messages\n", count);
+
+    if (winetest_interactive && count)
+    {
+        DWORD elapsed = max(GetTickCount() - start_ticks, 1);
+
+        qsort(latency, count, sizeof(*latency), compare_latency);
+        trace("%u messages in %u ms, %u messages/s, median %u us, p99 %u us\n", count, elapsed,
+              count * 1000 / elapsed, (unsigned int)(latency[count / 2] * 1000000 / freq.QuadPart),
+              (unsigned int)(latency[count * 99 / 100] * 1000000 / freq.QuadPart));
+    }
+
+    /* the pending receive on the server side is aborted when the socket is closed */
+    closesocket(server);
+    ret = GetQueuedCompletionStatus(port, &size, &key, &ovl, 1000);
+    while (ret && (ovl == &server_send || ovl == &client_send))
+        ret = GetQueuedCompletionStatus(port, &size, &key, &ovl, 1000);
+    ok(!ret, "GetQueuedCompletionStatus succeeded\n");
+    ok(GetLastError() == ERROR_OPERATION_ABORTED, "got error %u\n", GetLastError());
+    ok(ovl == &server_recv, "got overlapped %p\n", ovl);
+    ok(server_recv.Internal == (ULONG)STATUS_CANCELLED, "got status %#lx\n", server_recv.Internal);
+
+    closesocket(client);
+    CloseHandle(port);
+    HeapFree(GetProcessHeap(), 0, latency);
+}
+
+static void test_overlapped_recv_cancel(void)
+{
+    SOCKET client, server;
+    OVERLAPPED ovl;
+    DWORD size, flags;
+    WSABUF wsabuf;
+    char buffer[16];
+    int ret;
+
+    tcp_socketpair_ovl(&client, &server);
+    memset(&ovl, 0, sizeof(ovl));
+    ovl.hEvent = CreateEventW(NULL, TRUE, FALSE, NULL);
+    wsabuf.buf = buffer;
+    wsabuf.len = sizeof(buffer);
+
+    flags = 0;
+    ret = WSARecv(server, &wsabuf, 1, NULL, &flags, &ovl, NULL);
+    ok(ret == -1 && WSAGetLastError() == ERROR_IO_PENDING, "got %d, error %u\n", ret, WSAGetLastError());
+    ret = CancelIoEx((HANDLE)server, &ovl);
+    ok(ret, "CancelIoEx failed, error %u\n", GetLastError());
+    ok(!WaitForSingleObject(ovl.hEvent, 1000), "wait timed out\n");
+    ret = GetOverlappedResult((HANDLE)server, &ovl, &size, FALSE);
+    ok(!ret && GetLastError() == ERROR_OPERATION_ABORTED, "got %d, error %u\n", ret, GetLastError());
+    ret = CancelIoEx((HANDLE)server, &ovl);
+    ok(!ret && GetLastError() == ERROR_NOT_FOUND, "got %d, error %u\n", ret, GetLastError());
+
+    ResetEvent(ovl.hEvent);
+    ret = WSARecv(server, &wsabuf, 1, NULL, &flags, &ovl, NULL);
+    ok(ret == -1 && WSAGetLastError() == ERROR_IO_PENDING, "got %d, error %u\n", ret, WSAGetLastError());
+    ret = CancelIo((HANDLE)server);
+    ok(ret, "CancelIo failed, error %u\n", GetLastError());
+    ok(!WaitForSingleObject(ovl.hEvent, 1000), "wait timed out\n");
+    ret = GetOverlappedResult((HANDLE)server, &ovl, &size, FALSE);
+    ok(!ret && GetLastError() == ERROR_OPERATION_ABORTED, "got %d, error %u\n", ret, GetLastError());
+
+    /* data sent after the cancellation is still received */
+    ResetEvent(ovl.hEvent);
+    ret = WSARecv(server, &wsabuf, 1, NULL, &flags, &ovl, NULL);
+    ok(ret == -1 && WSAGetLastError() == ERROR_IO_PENDING, "got %d, error %u\n", ret, WSAGetLastError());
+    ret = send(client, "data", 4, 0);
+    ok(ret == 4, "send returned %d\n", ret);
+    ok(!WaitForSingleObject(ovl.hEvent, 1000), "wait timed out\n");
+    ret = GetOverlappedResult((HANDLE)server, &ovl, &size, FALSE);
+    ok(ret && size == 4, "got %d, size %u, error %u\n", ret, size, GetLastError());
+
+    /* closing the handle aborts the pending receive without waiting for a periodic check */
+    ResetEvent(ovl.hEvent);
+    ret = WSARecv(server, &wsabuf, 1, NULL, &flags, &ovl, NULL);
+    ok(ret == -1 && WSAGetLastError() == ERROR_IO_PENDING, "got %d, error %u\n", ret, WSAGetLastError());
+    CloseHandle((HANDLE)server);
+    ok(!WaitForSingleObject(ovl.hEvent, 500), "wait timed out\n");
+    ok(ovl.Internal != STATUS_PENDING && ovl.Internal != STATUS_SUCCESS, "got status %#lx\n", ovl.Internal);
+
+    CloseHandle(ovl.hEvent);
+    closesocket(client);
+}
+
 static void test_address_list_query(void)
 {
     SOCKET_ADDRESS_LIST *address_list;
@@ -10564,6 +10838,7 @@ START_TEST( sock )
 
     test_ipv6only();
     test_TransmitFile();
+    test_TransmitFile_large();
     test_GetAddrInfoW();
     test_GetAddrInfoExW();
     test_getaddrinfo();
@@ -10581,6 +10856,8 @@ START_TEST( sock )
     test_WSAAsyncGetServByPort();
     test_WSAAsyncGetServByName();
     test_completion_port();
+    test_iocp_echo();
+    test_overlapped_recv_cancel();
     test_address_list_query();
 
     test_WSCGetProviderInfo();
@@ -781,6 +781,58 @@ typedef struct
 } cursor_pos_t;
 
 
+struct completion_shm_packet
+{
+    apc_param_t   ckey;
+    apc_param_t   cvalue;
+    apc_param_t   information;
+    unsigned int  status;
+    int           __pad;
+};
+
+#define COMPLETION_SHM_PACKETS 1024
+#define COMPLETION_SHM_LOCK_WAITERS 0x40000000
+
+
+struct completion_shm
+{
+    int           seq;
+    int           waiters;
+    int           server_waiters;
+    unsigned int  server_depth;
+    int           lock;
+    unsigned int  head;
+    unsigned int  tail;
+    int           object_waiters;
+    struct completion_shm_packet packets[COMPLETION_SHM_PACKETS];
+};
+
+
+struct user_async_entry
+{
+    client_ptr_t  iosb;
+    obj_handle_t  handle;
+    thread_id_t   tid;
+    int           state;
+    int           __pad;
+};
+
+#define USER_ASYNC_FREE       0
+#define USER_ASYNC_QUEUED     1
+#define USER_ASYNC_CANCELLED  2
+#define USER_ASYNC_CLOSED     3
+#define USER_ASYNC_STATE_MASK 3
+#define USER_ASYNC_ENTRIES    1024
+
+
+struct user_async_shm
+{
+    unsigned int  used;
+    int           __pad;
+    struct user_async_entry entries[USER_ASYNC_ENTRIES];
+};
+
+
 
 
 
@@ -1892,6 +1944,21 @@ struct get_mapping_info_reply
 
 
 
+struct get_relocated_image_request
+{
+    struct request_header __header;
+    obj_handle_t mapping;
+    client_ptr_t base;
+};
+struct get_relocated_image_reply
+{
+    struct reply_header __header;
+    obj_handle_t file;
+    char __pad_12[4];
+};
+
+
+
 struct map_view_request
 {
     struct request_header __header;
@@ -4973,6 +5040,32 @@ struct remove_completion_reply
 
 
 
+struct get_completion_shm_request
+{
+    struct request_header __header;
+    obj_handle_t  handle;
+};
+struct get_completion_shm_reply
+{
+    struct reply_header __header;
+    data_size_t   size;
+    char __pad_12[4];
+};
+
+
+
+struct flush_completion_shm_request
+{
+    struct request_header __header;
+    obj_handle_t  handle;
+};
+struct flush_completion_shm_reply
+{
+    struct reply_header __header;
+};
+
+
+
 struct query_completion_request
 {
     struct request_header __header;
@@ -5018,6 +5111,34 @@ struct add_fd_completion_reply
 
 
 
+struct set_user_async_shm_request
+{
+    struct request_header __header;
+    obj_handle_t   mapping;
+    int            notify_fd;
+    char __pad_20[4];
+};
+struct set_user_async_shm_reply
+{
+    struct reply_header __header;
+};
+
+
+
+struct get_fd_completion_request
+{
+    struct request_header __header;
+    obj_handle_t   handle;
+};
+struct get_fd_completion_reply
+{
+    struct reply_header __header;
+    int            associated;
+    char __pad_12[4];
+};
+
+
+
 struct set_fd_completion_mode_request
 {
     struct request_header __header;
@@ -5415,6 +5536,7 @@ enum request
     REQ_create_mapping,
     REQ_open_mapping,
     REQ_get_mapping_info,
+    REQ_get_relocated_image,
     REQ_map_view,
     REQ_unmap_view,
     REQ_get_mapping_committed_range,
@@ -5599,9 +5721,13 @@ enum request
     REQ_open_completion,
     REQ_add_completion,
     REQ_remove_completion,
+    REQ_get_completion_shm,
+    REQ_flush_completion_shm,
     REQ_query_completion,
     REQ_set_completion_info,
     REQ_add_fd_completion,
+    REQ_set_user_async_shm,
+    REQ_get_fd_completion,
     REQ_set_fd_completion_mode,
     REQ_set_fd_disp_info,
     REQ_set_fd_name_info,
@@ -5696,6 +5822,7 @@ union generic_request
     struct create_mapping_request create_mapping_request;
     struct open_mapping_request open_mapping_request;
     struct get_mapping_info_request get_mapping_info_request;
+    struct get_relocated_image_request get_relocated_image_request;
     struct map_view_request map_view_request;
     struct unmap_view_request unmap_view_request;
     struct get_mapping_committed_range_request get_mapping_committed_range_request;
@@ -5880,9 +6007,13 @@ union generic_request
     struct open_completion_request open_completion_request;
     struct add_completion_request add_completion_request;
     struct remove_completion_request remove_completion_request;
+    struct get_completion_shm_request get_completion_shm_request;
+    struct flush_completion_shm_request flush_completion_shm_request;
     struct query_completion_request query_completion_request;
     struct set_completion_info_request set_completion_info_request;
     struct add_fd_completion_request add_fd_completion_request;
+    struct set_user_async_shm_request set_user_async_shm_request;
+    struct get_fd_completion_request get_fd_completion_request;
     struct set_fd_completion_mode_request set_fd_completion_mode_request;
     struct set_fd_disp_info_request set_fd_disp_info_request;
     struct set_fd_name_info_request set_fd_name_info_request;
@@ -5975,6 +6106,7 @@ union generic_reply
     struct create_mapping_reply create_mapping_reply;
     struct open_mapping_reply open_mapping_reply;
     struct get_mapping_info_reply get_mapping_info_reply;
+    struct get_relocated_image_reply get_relocated_image_reply;
     struct map_view_reply map_view_reply;
     struct unmap_view_reply unmap_view_reply;
     struct get_mapping_committed_range_reply get_mapping_committed_range_reply;
@@ -6159,9 +6291,13 @@ union generic_reply
     struct open_completion_reply open_completion_reply;
     struct add_completion_reply add_completion_reply;
     struct remove_completion_reply remove_completion_reply;
+    struct get_completion_shm_reply get_completion_shm_reply;
+    struct flush_completion_shm_reply flush_completion_shm_reply;
     struct query_completion_reply query_completion_reply;
     struct set_completion_info_reply set_completion_info_reply;
     struct add_fd_completion_reply add_fd_completion_reply;
+    struct set_user_async_shm_reply set_user_async_shm_reply;
+    struct get_fd_completion_reply get_fd_completion_reply;
     struct set_fd_completion_mode_reply set_fd_completion_mode_reply;
     struct set_fd_disp_info_reply set_fd_disp_info_reply;
     struct set_fd_name_info_reply set_fd_name_info_reply;
@@ -6188,7 +6324,7 @@ union generic_reply
 
 /* ### protocol_version begin ### */
 
-#define SERVER_PROTOCOL_VERSION 652
+#define SERVER_PROTOCOL_VERSION 659
 
 /* ### protocol_version end ### */
 
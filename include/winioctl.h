@@ -593,6 +593,19 @@ typedef struct RETRIEVAL_POINTERS_BUFFER {
 
 /* End: _WIN32_WINNT >= 0x0400 */
 
+typedef struct _DUPLICATE_EXTENTS_DATA {
+    HANDLE        FileHandle;
+    LARGE_INTEGER SourceFileOffset;
+    LARGE_INTEGER TargetFileOffset;
+    LARGE_INTEGER ByteCount;
+} DUPLICATE_EXTENTS_DATA, *PDUPLICATE_EXTENTS_DATA;
+
+#ifdef WINE_FSCTL_EXTENSIONS
+/* same input as FSCTL_DUPLICATE_EXTENTS_TO_FILE, but copies the range in the kernel
+ * when the file system can't share the extents */
+#define FSCTL_WINE_COPY_FILE_RANGE CTL_CODE(FILE_DEVICE_FILE_SYSTEM, 2048, METHOD_BUFFERED, FILE_WRITE_DATA)
+#endif
+
 /*
  *	NT I/O-Manager
  */
@@ -22,6 +22,9 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdarg.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 #include "ntstatus.h"
 #define WIN32_NO_STATUS
@@ -455,9 +458,63 @@ restart:
     return woken;
 }
 
+/* mark the operations queued by the client itself, and notify the client */
+static int set_user_asyncs_state( struct process *process, struct object *obj, obj_handle_t handle,
+                                  struct thread *thread, client_ptr_t iosb, int new_state )
+{
+    static const unsigned long long one = 1;
+    struct user_async_entry *entry;
+    struct object *entry_obj;
+    unsigned int i, used = min( __atomic_load_n( &process->user_asyncs->used, __ATOMIC_ACQUIRE ),
+                                USER_ASYNC_ENTRIES );
+    int state, count = 0;
+
+    for (i = 0; i < used; i++)
+    {
+        entry = &process->user_asyncs->entries[i];
+        state = __atomic_load_n( &entry->state, __ATOMIC_ACQUIRE );
+        if ((state & USER_ASYNC_STATE_MASK) != USER_ASYNC_QUEUED) continue;
+        if (handle && entry->handle != handle) continue;
+        if (thread && entry->tid != thread->id) continue;
+        if (iosb && entry->iosb != iosb) continue;
+        if (obj)
+        {
+            /* match the object rather than the handle, the operation may have been queued on another handle */
+            if (!(entry_obj = get_handle_obj( process, entry->handle, 0, NULL )))
+            {
+                clear_error();
+                continue;
+            }
+            release_object( entry_obj );
+            if (entry_obj != obj) continue;
+        }
+        /* the generation in the upper bits makes this fail if the entry has been reused */
+        if (__atomic_compare_exchange_n( &entry->state, &state, (state & ~USER_ASYNC_STATE_MASK) | new_state,
+                                         0, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED ))
+            count++;
+    }
+    if (count && write( process->user_async_notify, &one, sizeof(one) ) == -1 && debug_level)
+        fprintf( stderr, "failed to notify process %04x of cancelled asyncs\n", process->id );
+    return count;
+}
+
+/* the client checks whether the socket is still valid when one of its handles is closed */
+void close_user_asyncs( struct process *process, obj_handle_t handle )
+{
+    set_user_asyncs_state( process, NULL, handle, NULL, 0, USER_ASYNC_CLOSED );
+}
+
 void cancel_process_asyncs( struct process *process )
 {
     cancel_async( process, NULL, NULL, 0 );
+
+    if (process->user_asyncs)
+    {
+        munmap( process->user_asyncs, sizeof(*process->user_asyncs) );
+        close( process->user_async_notify );
+        process->user_asyncs = NULL;
+        process->user_async_notify = -1;
+    }
 }
 
 /* wake up async operations on the queue */
@@ -570,11 +627,58 @@ DECL_HANDLER(cancel_async)
     if (obj)
     {
         int count = cancel_async( current->process, obj, thread, req->iosb );
+        if (current->process->user_asyncs)
+            count += set_user_asyncs_state( current->process, obj, 0, thread, req->iosb, USER_ASYNC_CANCELLED );
         if (!count && req->iosb) set_error( STATUS_NOT_FOUND );
         release_object( obj );
     }
 }
 
+/* register the memory where the client tracks the operations it queues itself */
+DECL_HANDLER(set_user_async_shm)
+{
+    struct process *process = current->process;
+    int notify_fd = thread_get_inflight_fd( current, req->notify_fd );
+    struct object *obj;
+    struct fd *fd = NULL;
+    struct stat st;
+    void *ptr;
+
+    if (notify_fd == -1)
+    {
+        set_error( STATUS_INVALID_PARAMETER );
+        return;
+    }
+    if (process->user_asyncs)
+    {
+        set_error( STATUS_INVALID_PARAMETER );
+        goto done;
+    }
+    if (!(obj = get_handle_obj( process, req->mapping, 0, NULL ))) goto done;
+    fd = get_obj_fd( obj );
+    release_object( obj );
+    if (!fd) goto done;
+
+    if (fstat( get_unix_fd( fd ), &st ) == -1 || st.st_size < sizeof(*process->user_asyncs))
+    {
+        set_error( STATUS_INVALID_PARAMETER );
+        goto done;
+    }
+    ptr = mmap( NULL, sizeof(*process->user_asyncs), PROT_READ | PROT_WRITE, MAP_SHARED, get_unix_fd( fd ), 0 );
+    if (ptr == MAP_FAILED)
+    {
+        file_set_error();
+        goto done;
+    }
+    process->user_asyncs = ptr;
+    process->user_async_notify = notify_fd;
+    notify_fd = -1;
+
+done:
+    if (fd) release_object( fd );
+    if (notify_fd != -1) close( notify_fd );
+}
+
 /* get async result from associated iosb */
 DECL_HANDLER(get_async_result)
 {
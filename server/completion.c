@@ -29,8 +29,14 @@
 #include "config.h"
 #include "wine/port.h"
 
+#include <limits.h>
 #include <stdarg.h>
 #include <stdio.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#ifdef HAVE_SYS_SYSCALL_H
+# include <sys/syscall.h>
+#endif
 
 #include "ntstatus.h"
 #define WIN32_NO_STATUS
@@ -40,6 +46,7 @@
 #include "object.h"
 #include "file.h"
 #include "handle.h"
+#include "process.h"
 #include "request.h"
 
 
@@ -48,10 +55,17 @@ struct completion
     struct object  obj;
     struct list    queue;
     unsigned int   depth;
+    int            shm_fd;    /* fd of the memory shared with the clients */
+    struct completion_shm *shm;
+    struct list    shm_entry; /* entry in the list of completions with shared memory */
 };
 
+static struct list completion_shm_list = LIST_INIT( completion_shm_list );
+
 static void completion_dump( struct object*, int );
 static struct object_type *completion_get_type( struct object *obj );
+static int completion_add_queue( struct object *obj, struct wait_queue_entry *entry );
+static void completion_remove_queue( struct object *obj, struct wait_queue_entry *entry );
 static int completion_signaled( struct object *obj, struct wait_queue_entry *entry );
 static unsigned int completion_map_access( struct object *obj, unsigned int access );
 static void completion_destroy( struct object * );
@@ -61,8 +75,8 @@ static const struct object_ops completion_ops =
     sizeof(struct completion), /* size */
     completion_dump,           /* dump */
     completion_get_type,       /* get_type */
-    add_queue,                 /* add_queue */
-    remove_queue,              /* remove_queue */
+    completion_add_queue,      /* add_queue */
+    completion_remove_queue,   /* remove_queue */
     completion_signaled,       /* signaled */
     no_satisfied,              /* satisfied */
     no_signal,                 /* signal */
@@ -98,6 +112,12 @@ static void completion_destroy( struct object *obj)
     {
         free( tmp );
     }
+    if (completion->shm)
+    {
+        list_remove( &completion->shm_entry );
+        munmap( completion->shm, sizeof(*completion->shm) );
+    }
+    if (completion->shm_fd != -1) close( completion->shm_fd );
 }
 
 static void completion_dump( struct object *obj, int verbose )
@@ -115,11 +135,36 @@ static struct object_type *completion_get_type( struct object *obj )
     return get_object_type( &str );
 }
 
+/* clients queue packets in the shared ring only while nobody waits on the server object, but
+ * a wait may start after a packet has been queued, so the ring has to be checked as well */
+static int completion_shm_pending( struct completion *completion )
+{
+    struct completion_shm *shm = completion->shm;
+
+    return shm && __atomic_load_n( &shm->head, __ATOMIC_SEQ_CST ) != __atomic_load_n( &shm->tail, __ATOMIC_SEQ_CST );
+}
+
+static int completion_add_queue( struct object *obj, struct wait_queue_entry *entry )
+{
+    struct completion *completion = (struct completion *)obj;
+
+    if (completion->shm) __atomic_add_fetch( &completion->shm->object_waiters, 1, __ATOMIC_SEQ_CST );
+    return add_queue( obj, entry );
+}
+
+static void completion_remove_queue( struct object *obj, struct wait_queue_entry *entry )
+{
+    struct completion *completion = (struct completion *)obj;
+
+    if (completion->shm) __atomic_sub_fetch( &completion->shm->object_waiters, 1, __ATOMIC_SEQ_CST );
+    remove_queue( obj, entry );
+}
+
 static int completion_signaled( struct object *obj, struct wait_queue_entry *entry )
 {
     struct completion *completion = (struct completion *)obj;
 
-    return !list_empty( &completion->queue );
+    return !list_empty( &completion->queue ) || completion_shm_pending( completion );
 }
 
 static unsigned int completion_map_access( struct object *obj, unsigned int access )
@@ -143,6 +188,8 @@ static struct completion *create_completion( struct object *root, const struct u
         {
             list_init( &completion->queue );
             completion->depth = 0;
+            completion->shm_fd = -1;
+            completion->shm = NULL;
         }
     }
 
@@ -154,13 +201,13 @@ struct completion *get_completion_obj( struct process *process, obj_handle_t han
     return (struct completion *) get_handle_obj( process, handle, access, &completion_ops );
 }
 
-void add_completion( struct completion *completion, apc_param_t ckey, apc_param_t cvalue,
-                     unsigned int status, apc_param_t information )
+static int queue_completion_msg( struct completion *completion, apc_param_t ckey, apc_param_t cvalue,
+                                 unsigned int status, apc_param_t information )
 {
     struct comp_msg *msg = mem_alloc( sizeof( *msg ) );
 
     if (!msg)
-        return;
+        return 0;
 
     msg->ckey = ckey;
     msg->cvalue = cvalue;
@@ -169,7 +216,166 @@ void add_completion( struct completion *completion, apc_param_t ckey, apc_param_
 
     list_add_tail( &completion->queue, &msg->queue_entry );
     completion->depth++;
-    wake_up( &completion->obj, 1 );
+    return 1;
+}
+
+/* move the packets queued by the clients to the server queue, so that the packets queued
+ * by the server afterwards are delivered after them; the ring lock must be held */
+static unsigned int flush_completion_shm( struct completion *completion )
+{
+    struct completion_shm *shm = completion->shm;
+    struct completion_shm_packet *packet;
+    unsigned int count = 0;
+
+    while (shm->head != shm->tail)
+    {
+        packet = &shm->packets[shm->head % COMPLETION_SHM_PACKETS];
+        if (!queue_completion_msg( completion, packet->ckey, packet->cvalue, packet->status, packet->information ))
+            break;
+        __atomic_add_fetch( &shm->head, 1, __ATOMIC_SEQ_CST );
+        count++;
+    }
+    return count;
+}
+
+#if defined(__linux__) && defined(__NR_futex)
+
+#define FUTEX_WAKE 1
+
+/* create the memory shared with the clients, which contains the ring of packets queued
+ * by the clients and lets them wait on a futex instead of the server object */
+static int create_completion_shm( struct completion *completion )
+{
+    void *ptr;
+    int fd;
+
+    if (completion->shm) return 1;
+    if ((fd = create_temp_file( sizeof(*completion->shm) )) == -1) return 0;
+    ptr = mmap( NULL, sizeof(*completion->shm), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+    if (ptr == MAP_FAILED)
+    {
+        file_set_error();
+        close( fd );
+        return 0;
+    }
+    completion->shm_fd = fd;
+    completion->shm = ptr;
+    completion->shm->server_depth = completion->depth;
+    list_add_tail( &completion_shm_list, &completion->shm_entry );
+    return 1;
+}
+
+/* lock the shared ring; the lock is only held by clients for a few instructions,
+ * but the server must not block, so give up if it stays contended */
+static int lock_completion_shm( struct completion_shm *shm )
+{
+    int i, expected, pid = getpid();
+
+    for (i = 0; i < 1000; i++)
+    {
+        expected = 0;
+        if (__atomic_compare_exchange_n( &shm->lock, &expected, pid, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED ))
+            return 1;
+    }
+    return 0;
+}
+
+static void unlock_completion_shm( struct completion_shm *shm )
+{
+    if (__atomic_exchange_n( &shm->lock, 0, __ATOMIC_RELEASE ) & COMPLETION_SHM_LOCK_WAITERS)
+        syscall( __NR_futex, &shm->lock, FUTEX_WAKE, 1, NULL, 0, 0 );
+}
+
+/* dequeue a packet from the shared ring */
+static int pop_completion_shm( struct completion *completion, struct completion_shm_packet *packet )
+{
+    struct completion_shm *shm = completion->shm;
+    int ret = 0;
+
+    if (!lock_completion_shm( shm )) return 0;
+    if (shm->head != shm->tail)
+    {
+        *packet = shm->packets[shm->head % COMPLETION_SHM_PACKETS];
+        __atomic_add_fetch( &shm->head, 1, __ATOMIC_SEQ_CST );
+        ret = 1;
+    }
+    unlock_completion_shm( shm );
+    return ret;
+}
+
+/* wake up a client waiting on the shared memory futex */
+static void wake_up_completion_shm( struct completion *completion )
+{
+    struct completion_shm *shm = completion->shm;
+
+    shm->server_depth = completion->depth;
+    __atomic_add_fetch( &shm->seq, 1, __ATOMIC_SEQ_CST );
+    if (__atomic_load_n( &shm->waiters, __ATOMIC_SEQ_CST ))
+        syscall( __NR_futex, &shm->seq, FUTEX_WAKE, 1, NULL, 0, 0 );
+}
+
+/* release the ring locks that a dead process was holding, so that the other
+ * processes using the ports don't wait for them forever */
+void release_completion_shm_locks( struct process *process )
+{
+    struct completion *completion;
+    int owner;
+
+    if (process->unix_pid == -1) return;
+
+    LIST_FOR_EACH_ENTRY( completion, &completion_shm_list, struct completion, shm_entry )
+    {
+        owner = __atomic_load_n( &completion->shm->lock, __ATOMIC_ACQUIRE ) & ~COMPLETION_SHM_LOCK_WAITERS;
+        if (owner == process->unix_pid) unlock_completion_shm( completion->shm );
+    }
+}
+
+#else  /* __linux__ */
+
+static int create_completion_shm( struct completion *completion )
+{
+    set_error( STATUS_NOT_SUPPORTED );
+    return 0;
+}
+
+static int lock_completion_shm( struct completion_shm *shm )
+{
+    return 0;
+}
+
+static void unlock_completion_shm( struct completion_shm *shm )
+{
+}
+
+static void wake_up_completion_shm( struct completion *completion )
+{
+}
+
+static int pop_completion_shm( struct completion *completion, struct completion_shm_packet *packet )
+{
+    return 0;
+}
+
+void release_completion_shm_locks( struct process *process )
+{
+}
+
+#endif  /* __linux__ */
+
+void add_completion( struct completion *completion, apc_param_t ckey, apc_param_t cvalue,
+                     unsigned int status, apc_param_t information )
+{
+    unsigned int count = 0;
+    int locked;
+
+    /* keep the packets in order with the ones already queued in the shared ring, and stop the
+     * clients from queuing more there while the server queue isn't empty */
+    locked = completion->shm && lock_completion_shm( completion->shm );
+    if (locked) count = flush_completion_shm( completion );
+    if (queue_completion_msg( completion, ckey, cvalue, status, information )) count++;
+    if (completion->shm) wake_up_completion_shm( completion );
+    if (locked) unlock_completion_shm( completion->shm );
+    if (count) wake_up( &completion->obj, count );
 }
 
 /* create a completion */
@@ -218,18 +424,27 @@ DECL_HANDLER(add_completion)
 DECL_HANDLER(remove_completion)
 {
     struct completion* completion = get_completion_obj( current->process, req->handle, IO_COMPLETION_MODIFY_STATE );
+    struct completion_shm_packet packet;
     struct list *entry;
     struct comp_msg *msg;
 
     if (!completion) return;
 
     entry = list_head( &completion->queue );
-    if (!entry)
+    if (!entry && completion->shm && pop_completion_shm( completion, &packet ))
+    {
+        reply->ckey = packet.ckey;
+        reply->cvalue = packet.cvalue;
+        reply->status = packet.status;
+        reply->information = packet.information;
+    }
+    else if (!entry)
         set_error( STATUS_PENDING );
     else
     {
         list_remove( entry );
         completion->depth--;
+        if (completion->shm) completion->shm->server_depth = completion->depth;
         msg = LIST_ENTRY( entry, struct comp_msg, queue_entry );
         reply->ckey = msg->ckey;
         reply->cvalue = msg->cvalue;
@@ -241,6 +456,40 @@ DECL_HANDLER(remove_completion)
     release_object( completion );
 }
 
+/* get the memory shared with the clients */
+DECL_HANDLER(get_completion_shm)
+{
+    struct completion* completion = get_completion_obj( current->process, req->handle, IO_COMPLETION_MODIFY_STATE );
+
+    if (!completion) return;
+
+    if (create_completion_shm( completion ))
+    {
+        reply->size = sizeof(*completion->shm);
+        send_client_fd( current->process, completion->shm_fd, req->handle );
+    }
+
+    release_object( completion );
+}
+
+/* move the packets queued in the shared memory ring to the server queue */
+DECL_HANDLER(flush_completion_shm)
+{
+    struct completion* completion = get_completion_obj( current->process, req->handle, IO_COMPLETION_MODIFY_STATE );
+    unsigned int count;
+
+    if (!completion) return;
+
+    if (completion->shm && lock_completion_shm( completion->shm ))
+    {
+        if ((count = flush_completion_shm( completion ))) wake_up_completion_shm( completion );
+        unlock_completion_shm( completion->shm );
+        if (count) wake_up( &completion->obj, count );
+    }
+
+    release_object( completion );
+}
+
 /* get queue depth for completion port */
 DECL_HANDLER(query_completion)
 {
@@ -2798,6 +2798,17 @@ DECL_HANDLER(add_fd_completion)
     }
 }
 
+/* check whether an fd is associated with a completion port */
+DECL_HANDLER(get_fd_completion)
+{
+    struct fd *fd = get_handle_fd_obj( current->process, req->handle, 0 );
+    if (fd)
+    {
+        reply->associated = fd->completion != NULL;
+        release_object( fd );
+    }
+}
+
 /* set fd completion information */
 DECL_HANDLER(set_fd_completion_mode)
 {
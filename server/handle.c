@@ -435,6 +435,7 @@ unsigned int close_handle( struct process *process, obj_handle_t handle )
     if (entry < table->entries + table->free) table->free = entry - table->entries;
     if (entry == table->entries + table->last) shrink_handle_table( table );
     release_object_from_handle( obj );
+    if (process->user_asyncs) close_user_asyncs( process, handle );
     return STATUS_SUCCESS;
 }
 
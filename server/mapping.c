@@ -122,6 +122,47 @@ static const struct object_ops shared_map_ops =
 
 static struct list shared_map_list = LIST_INIT( shared_map_list );
 
+/* PE image relocated to a non-default base, shared by all the processes mapping it there;
+ * it is referenced by the mapping objects that requested it and by the views using it, so
+ * it goes away when the last section or view of the file at that address is gone */
+struct relocated_image
+{
+    struct object   obj;             /* object header */
+    struct fd      *fd;              /* file descriptor of the mapped PE file */
+    client_ptr_t    base;            /* address the image is relocated to */
+    struct file    *file;            /* temp file holding the relocated image */
+    struct list     entry;           /* entry in global relocated images list */
+};
+
+static void relocated_image_dump( struct object *obj, int verbose );
+static void relocated_image_destroy( struct object *obj );
+
+static const struct object_ops relocated_image_ops =
+{
+    sizeof(struct relocated_image), /* size */
+    relocated_image_dump,      /* dump */
+    no_get_type,               /* get_type */
+    no_add_queue,              /* add_queue */
+    NULL,                      /* remove_queue */
+    NULL,                      /* signaled */
+    NULL,                      /* satisfied */
+    no_signal,                 /* signal */
+    no_get_fd,                 /* get_fd */
+    no_map_access,             /* map_access */
+    default_get_sd,            /* get_sd */
+    default_set_sd,            /* set_sd */
+    no_get_full_name,          /* get_full_name */
+    no_lookup_name,            /* lookup_name */
+    no_link_name,              /* link_name */
+    NULL,                      /* unlink_name */
+    no_open_file,              /* open_file */
+    no_kernel_obj_list,        /* get_kernel_obj_list */
+    no_close_handle,           /* close_handle */
+    relocated_image_destroy    /* destroy */
+};
+
+static struct list relocated_image_list = LIST_INIT( relocated_image_list );
+
 /* memory view mapped in client address space */
 struct memory_view
 {
@@ -129,6 +170,7 @@ struct memory_view
     struct fd      *fd;              /* fd for mapped file */
     struct ranges  *committed;       /* list of committed ranges in this mapping */
     struct shared_map *shared;       /* temp file for shared PE mapping */
+    struct relocated_image *relocated; /* relocated image backing the view */
     pe_image_info_t image;           /* image info (for PE image mapping) */
     unsigned int    flags;           /* SEC_* flags */
     client_ptr_t    base;            /* view base address (in process addr space) */
@@ -145,6 +187,7 @@ struct mapping
     pe_image_info_t image;           /* image info (for PE image mapping) */
     struct ranges  *committed;       /* list of committed ranges in this mapping */
     struct shared_map *shared;       /* temp file for shared PE mapping */
+    struct relocated_image *relocated; /* last relocated copy requested for this mapping */
 };
 
 static void mapping_dump( struct object *obj, int verbose );
@@ -225,6 +268,22 @@ static void shared_map_destroy( struct object *obj )
     list_remove( &shared->entry );
 }
 
+static void relocated_image_dump( struct object *obj, int verbose )
+{
+    struct relocated_image *image = (struct relocated_image *)obj;
+    fprintf( stderr, "Relocated image fd=%p base=%x%08x file=%p\n", image->fd,
+             (unsigned int)(image->base >> 32), (unsigned int)image->base, image->file );
+}
+
+static void relocated_image_destroy( struct object *obj )
+{
+    struct relocated_image *image = (struct relocated_image *)obj;
+
+    release_object( image->fd );
+    release_object( image->file );
+    list_remove( &image->entry );
+}
+
 /* extend a file beyond the current end of file */
 static int grow_file( int unix_fd, file_pos_t new_size )
 {
@@ -267,7 +326,7 @@ static int check_current_dir_for_exec(void)
 }
 
 /* create a temp file for anonymous mappings */
-static int create_temp_file( file_pos_t size )
+int create_temp_file( file_pos_t size )
 {
     static int temp_dir_fd = -1;
     char tmpfn[] = "anonmap.XXXXXX";
@@ -321,6 +380,7 @@ static void free_memory_view( struct memory_view *view )
     if (view->fd) release_object( view->fd );
     if (view->committed) release_object( view->committed );
     if (view->shared) release_object( view->shared );
+    if (view->relocated) release_object( view->relocated );
     list_remove( &view->entry );
     free( view );
 }
@@ -531,6 +591,222 @@ static int build_shared_mapping( struct mapping *mapping, int fd,
 }
 
 /* load the CLR header from its section */
+/* find the relocated copy of a PE image for a given base address */
+static struct relocated_image *find_relocated_image( struct fd *fd, client_ptr_t base )
+{
+    struct relocated_image *ptr;
+
+    LIST_FOR_EACH_ENTRY( ptr, &relocated_image_list, struct relocated_image, entry )
+        if (ptr->base == base && is_same_file_fd( ptr->fd, fd ))
+            return (struct relocated_image *)grab_object( ptr );
+    return NULL;
+}
+
+/* apply the base relocations to an image laid out in memory, the same way the loader does */
+static int apply_relocations( char *ptr, mem_size_t size, unsigned int reloc_va, unsigned int reloc_size,
+                              client_ptr_t delta, int is_64bit )
+{
+    IMAGE_BASE_RELOCATION rel;
+    mem_size_t pos, end, offset;
+    unsigned short entry;
+    unsigned int i, count;
+    unsigned short val16;
+    unsigned int val32;
+    client_ptr_t val64;
+
+    if (reloc_va >= size || reloc_size > size - reloc_va) return 0;
+    pos = reloc_va;
+    end = reloc_va + reloc_size;
+
+    while (pos + sizeof(rel) < end)
+    {
+        memcpy( &rel, ptr + pos, sizeof(rel) );
+        if (!rel.SizeOfBlock) break;
+        if (rel.VirtualAddress >= size || rel.SizeOfBlock < sizeof(rel)) return 0;
+        count = (rel.SizeOfBlock - sizeof(rel)) / sizeof(entry);
+        if (pos + sizeof(rel) + count * sizeof(entry) > size) return 0;
+
+        for (i = 0; i < count; i++)
+        {
+            memcpy( &entry, ptr + pos + sizeof(rel) + i * sizeof(entry), sizeof(entry) );
+            offset = rel.VirtualAddress + (entry & 0xfff);
+            switch (entry >> 12)
+            {
+            case IMAGE_REL_BASED_ABSOLUTE:
+                break;
+            case IMAGE_REL_BASED_HIGH:
+            case IMAGE_REL_BASED_LOW:
+                if (offset + sizeof(val16) > size) return 0;
+                memcpy( &val16, ptr + offset, sizeof(val16) );
+                val16 += (entry >> 12) == IMAGE_REL_BASED_HIGH ? delta >> 16 : delta;
+                memcpy( ptr + offset, &val16, sizeof(val16) );
+                break;
+            case IMAGE_REL_BASED_HIGHLOW:
+                if (offset + sizeof(val32) > size) return 0;
+                memcpy( &val32, ptr + offset, sizeof(val32) );
+                val32 += delta;
+                memcpy( ptr + offset, &val32, sizeof(val32) );
+                break;
+            case IMAGE_REL_BASED_DIR64:
+                if (!is_64bit || offset + sizeof(val64) > size) return 0;
+                memcpy( &val64, ptr + offset, sizeof(val64) );
+                val64 += delta;
+                memcpy( ptr + offset, &val64, sizeof(val64) );
+                break;
+            default:  /* leave the unusual ones to the loader */
+                return 0;
+            }
+        }
+        pos += sizeof(rel) + count * sizeof(entry);
+    }
+    return 1;
+}
+
+/* lay out a PE image in memory like the client does in map_image_into_view(), and relocate it */
+static int load_relocated_image( struct mapping *mapping, char *ptr, int unix_fd, client_ptr_t base )
+{
+    static const off_t sector_align = 0x1ff;
+    IMAGE_SECTION_HEADER sec[96];
+    IMAGE_DOS_HEADER dos;
+    struct
+    {
+        DWORD Signature;
+        IMAGE_FILE_HEADER FileHeader;
+        union
+        {
+            IMAGE_OPTIONAL_HEADER32 hdr32;
+            IMAGE_OPTIONAL_HEADER64 hdr64;
+        } opt;
+    } nt;
+    mem_size_t total_size = mapping->image.map_size;
+    file_pos_t file_len = mapping->image.file_size;
+    size_t header_size, map_size, file_size, end;
+    unsigned int i, reloc_va, reloc_size, opt_pos;
+    off_t file_start;
+    ssize_t res;
+    int is_64bit;
+
+    header_size = min( mapping->image.header_size, file_len );
+    if (header_size > total_size) return 0;
+    if (pread( unix_fd, ptr, header_size, 0 ) != header_size) return 0;
+
+    memcpy( &dos, ptr, sizeof(dos) );
+    opt_pos = dos.e_lfanew + sizeof(nt.Signature) + sizeof(nt.FileHeader);
+    if (dos.e_lfanew >= header_size || opt_pos + sizeof(nt.opt) > header_size) return 0;
+    memcpy( &nt, ptr + dos.e_lfanew, sizeof(nt) );
+    if (nt.FileHeader.NumberOfSections > ARRAY_SIZE( sec )) return 0;
+    if (opt_pos + nt.FileHeader.SizeOfOptionalHeader + nt.FileHeader.NumberOfSections * sizeof(*sec) > header_size)
+        return 0;
+    memcpy( sec, ptr + opt_pos + nt.FileHeader.SizeOfOptionalHeader, nt.FileHeader.NumberOfSections * sizeof(*sec) );
+
+    switch (nt.opt.hdr32.Magic)
+    {
+    case IMAGE_NT_OPTIONAL_HDR32_MAGIC:
+        if (nt.opt.hdr32.NumberOfRvaAndSizes <= IMAGE_DIRECTORY_ENTRY_BASERELOC) return 0;
+        reloc_va = nt.opt.hdr32.DataDirectory[IMAGE_DIRECTORY_ENTRY_BASERELOC].VirtualAddress;
+        reloc_size = nt.opt.hdr32.DataDirectory[IMAGE_DIRECTORY_ENTRY_BASERELOC].Size;
+        is_64bit = 0;
+        break;
+    case IMAGE_NT_OPTIONAL_HDR64_MAGIC:
+        if (nt.opt.hdr64.NumberOfRvaAndSizes <= IMAGE_DIRECTORY_ENTRY_BASERELOC) return 0;
+        reloc_va = nt.opt.hdr64.DataDirectory[IMAGE_DIRECTORY_ENTRY_BASERELOC].VirtualAddress;
+        reloc_size = nt.opt.hdr64.DataDirectory[IMAGE_DIRECTORY_ENTRY_BASERELOC].Size;
+        is_64bit = 1;
+        break;
+    default:
+        return 0;
+    }
+    if (!reloc_va || !reloc_size) return 0;
+
+    for (i = 0; i < nt.FileHeader.NumberOfSections; i++)
+    {
+        get_section_sizes( &sec[i], &map_size, &file_start, &file_size );
+        end = sec[i].VirtualAddress + ROUND_SIZE( map_size );
+        if (sec[i].VirtualAddress > total_size || end > total_size || end < sec[i].VirtualAddress) return 0;
+        if (!sec[i].PointerToRawData || !file_size) continue;
+
+        end = file_start + file_size;
+        if (sec[i].PointerToRawData >= file_len || end > ((file_len + sector_align) & ~sector_align) ||
+            end < file_start)
+            return 0;
+        if ((res = pread( unix_fd, ptr + sec[i].VirtualAddress, file_size, file_start )) < 0) return 0;
+        memset( ptr + sec[i].VirtualAddress + res, 0, ROUND_SIZE( file_size ) - res );
+    }
+
+    /* store the new base in the header, so that the loader doesn't relocate the image again */
+    if (is_64bit)
+    {
+        ULONGLONG image_base = base;
+        memcpy( ptr + opt_pos + offsetof( IMAGE_OPTIONAL_HEADER64, ImageBase ), &image_base, sizeof(image_base) );
+    }
+    else
+    {
+        DWORD image_base = base;
+        memcpy( ptr + opt_pos + offsetof( IMAGE_OPTIONAL_HEADER32, ImageBase ), &image_base, sizeof(image_base) );
+    }
+
+    return apply_relocations( ptr, total_size, reloc_va, reloc_size, base - mapping->image.base, is_64bit );
+}
+
+/* get the shared relocated copy of an image mapping, creating it if needed */
+static struct relocated_image *get_relocated_image( struct mapping *mapping, client_ptr_t base )
+{
+    struct relocated_image *image;
+    struct file *file;
+    int unix_fd, image_fd;
+    void *ptr;
+
+    if (!(mapping->flags & SEC_IMAGE) || (base & page_mask))
+    {
+        set_error( STATUS_INVALID_PARAMETER );
+        return NULL;
+    }
+    /* only dynamic base dlls, like Windows does; everything else is left to the loader */
+    if (base == mapping->image.base || mapping->shared ||
+        !(mapping->image.image_flags & IMAGE_FLAGS_ImageDynamicallyRelocated) ||
+        (mapping->image.image_flags & IMAGE_FLAGS_ImageMappedFlat) ||
+        !(mapping->image.image_charact & IMAGE_FILE_DLL) ||
+        (mapping->image.image_charact & IMAGE_FILE_RELOCS_STRIPPED) ||
+        is_fd_removable( mapping->fd ))
+    {
+        set_error( STATUS_NOT_SUPPORTED );
+        return NULL;
+    }
+
+    if ((image = find_relocated_image( mapping->fd, base ))) return image;
+
+    if ((unix_fd = get_unix_fd( mapping->fd )) == -1) return NULL;
+    if ((image_fd = create_temp_file( mapping->image.map_size )) == -1) return NULL;
+    if (!(file = create_file_for_fd( image_fd, FILE_GENERIC_READ|FILE_GENERIC_WRITE, 0 ))) return NULL;
+
+    if ((ptr = mmap( NULL, mapping->image.map_size, PROT_READ | PROT_WRITE, MAP_SHARED,
+                     image_fd, 0 )) == MAP_FAILED)
+    {
+        file_set_error();
+        release_object( file );
+        return NULL;
+    }
+    if (!load_relocated_image( mapping, ptr, unix_fd, base ))
+    {
+        munmap( ptr, mapping->image.map_size );
+        release_object( file );
+        set_error( STATUS_NOT_SUPPORTED );
+        return NULL;
+    }
+    munmap( ptr, mapping->image.map_size );
+
+    if (!(image = alloc_object( &relocated_image_ops )))
+    {
+        release_object( file );
+        return NULL;
+    }
+    image->fd   = (struct fd *)grab_object( mapping->fd );
+    image->base = base;
+    image->file = file;
+    list_add_head( &relocated_image_list, &image->entry );
+    return image;
+}
+
 static int load_clr_header( IMAGE_COR20_HEADER *hdr, size_t va, size_t size, int unix_fd,
                             IMAGE_SECTION_HEADER *sec, unsigned int nb_sec )
 {
@@ -806,6 +1082,7 @@ static struct mapping *create_mapping( struct object *root, const struct unicode
     mapping->size        = size;
     mapping->fd          = NULL;
     mapping->shared      = NULL;
+    mapping->relocated   = NULL;
     mapping->committed   = NULL;
 
     if (!(mapping->flags = get_mapping_flags( handle, flags ))) goto error;
@@ -895,6 +1172,7 @@ struct mapping *create_fd_mapping( struct object *root, const struct unicode_str
     if (get_error() == STATUS_OBJECT_NAME_EXISTS) return mapping;  /* Nothing else to do */
 
     mapping->shared    = NULL;
+    mapping->relocated = NULL;
     mapping->committed = NULL;
     mapping->flags     = SEC_FILE;
     mapping->fd        = (struct fd *)grab_object( fd );
@@ -980,6 +1258,7 @@ static void mapping_destroy( struct object *obj )
     if (mapping->fd) release_object( mapping->fd );
     if (mapping->committed) release_object( mapping->committed );
     if (mapping->shared) release_object( mapping->shared );
+    if (mapping->relocated) release_object( mapping->relocated );
 }
 
 static enum server_fd_type mapping_get_fd_type( struct fd *fd )
@@ -1117,10 +1396,16 @@ DECL_HANDLER(map_view)
         view->fd        = !is_fd_removable( mapping->fd ) ? (struct fd *)grab_object( mapping->fd ) : NULL;
         view->committed = mapping->committed ? (struct ranges *)grab_object( mapping->committed ) : NULL;
         view->shared    = mapping->shared ? (struct shared_map *)grab_object( mapping->shared ) : NULL;
+        view->relocated = NULL;
         if (mapping->flags & SEC_IMAGE)
         {
             view->image = mapping->image;
-            if (view->base != mapping->image.base) set_error( STATUS_IMAGE_NOT_AT_BASE );
+            if (view->base != mapping->image.base)
+            {
+                /* keep the relocated copy alive for other processes while it's mapped */
+                view->relocated = find_relocated_image( mapping->fd, view->base );
+                set_error( STATUS_IMAGE_NOT_AT_BASE );
+            }
         }
         list_add_tail( &current->process->views, &view->entry );
     }
@@ -1137,6 +1422,24 @@ DECL_HANDLER(unmap_view)
     if (view) free_memory_view( view );
 }
 
+/* get a file holding an image mapping relocated to a given base */
+DECL_HANDLER(get_relocated_image)
+{
+    struct mapping *mapping;
+    struct relocated_image *image;
+
+    if (!(mapping = get_mapping_obj( current->process, req->mapping, SECTION_MAP_READ ))) return;
+
+    if ((image = get_relocated_image( mapping, req->base )))
+    {
+        reply->file = alloc_handle( current->process, image->file, GENERIC_READ, 0 );
+        /* keep it alive until the view is mapped */
+        if (mapping->relocated) release_object( mapping->relocated );
+        mapping->relocated = image;
+    }
+    release_object( mapping );
+}
+
 /* get a range of committed pages in a file mapping */
 DECL_HANDLER(get_mapping_committed_range)
 {
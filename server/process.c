@@ -540,6 +540,8 @@ struct process *create_process( int fd, struct process *parent, int inherit_all,
     process->desktop         = 0;
     process->token           = NULL;
     process->trace_data      = 0;
+    process->user_asyncs     = NULL;
+    process->user_async_notify = -1;
     process->rawinput_mouse  = NULL;
     process->rawinput_kbd    = NULL;
     list_init( &process->kernel_object );
@@ -911,6 +913,7 @@ static void process_killed( struct process *process )
     process->desktop = 0;
     close_process_handles( process );
     cancel_process_asyncs( process );
+    release_completion_shm_locks( process );
     if (process->idle_event) release_object( process->idle_event );
     if (process->exe_file) release_object( process->exe_file );
     process->idle_event = NULL;
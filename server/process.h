@@ -78,6 +78,8 @@ struct process
     struct job          *job;             /* job object ascoicated with this process */
     struct list          job_entry;       /* list entry for job object */
     struct list          asyncs;          /* list of async object owned by the process */
+    struct user_async_shm *user_asyncs;   /* operations queued by the process itself */
+    int                  user_async_notify; /* eventfd to notify the process of cancelled operations */
     struct list          locks;           /* list of file locks owned by the process */
     struct list          classes;         /* window classes owned by the process */
     struct console      *console;         /* console input */
@@ -131,6 +133,9 @@ extern void kill_debugged_processes( struct thread *debugger, int exit_code );
 extern void detach_debugged_processes( struct thread *debugger );
 extern void enum_processes( int (*cb)(struct process*, void*), void *user);
 
+/* async functions */
+extern void close_user_asyncs( struct process *process, obj_handle_t handle );
+
 /* console functions */
 extern struct thread *console_get_renderer( struct console *console );
 
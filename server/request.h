@@ -184,6 +184,7 @@ DECL_HANDLER(read_change);
 DECL_HANDLER(create_mapping);
 DECL_HANDLER(open_mapping);
 DECL_HANDLER(get_mapping_info);
+DECL_HANDLER(get_relocated_image);
 DECL_HANDLER(map_view);
 DECL_HANDLER(unmap_view);
 DECL_HANDLER(get_mapping_committed_range);
@@ -368,9 +369,13 @@ DECL_HANDLER(create_completion);
 DECL_HANDLER(open_completion);
 DECL_HANDLER(add_completion);
 DECL_HANDLER(remove_completion);
+DECL_HANDLER(get_completion_shm);
+DECL_HANDLER(flush_completion_shm);
 DECL_HANDLER(query_completion);
 DECL_HANDLER(set_completion_info);
 DECL_HANDLER(add_fd_completion);
+DECL_HANDLER(set_user_async_shm);
+DECL_HANDLER(get_fd_completion);
 DECL_HANDLER(set_fd_completion_mode);
 DECL_HANDLER(set_fd_disp_info);
 DECL_HANDLER(set_fd_name_info);
@@ -464,6 +469,7 @@ static const req_handler req_handlers[REQ_NB_REQUESTS] =
     (req_handler)req_create_mapping,
     (req_handler)req_open_mapping,
     (req_handler)req_get_mapping_info,
+    (req_handler)req_get_relocated_image,
     (req_handler)req_map_view,
     (req_handler)req_unmap_view,
     (req_handler)req_get_mapping_committed_range,
@@ -648,9 +654,13 @@ static const req_handler req_handlers[REQ_NB_REQUESTS] =
     (req_handler)req_open_completion,
     (req_handler)req_add_completion,
     (req_handler)req_remove_completion,
+    (req_handler)req_get_completion_shm,
+    (req_handler)req_flush_completion_shm,
     (req_handler)req_query_completion,
     (req_handler)req_set_completion_info,
     (req_handler)req_add_fd_completion,
+    (req_handler)req_set_user_async_shm,
+    (req_handler)req_get_fd_completion,
     (req_handler)req_set_fd_completion_mode,
     (req_handler)req_set_fd_disp_info,
     (req_handler)req_set_fd_name_info,
@@ -1106,6 +1116,11 @@ C_ASSERT( FIELD_OFFSET(struct get_mapping_info_reply, size) == 8 );
 C_ASSERT( FIELD_OFFSET(struct get_mapping_info_reply, flags) == 16 );
 C_ASSERT( FIELD_OFFSET(struct get_mapping_info_reply, shared_file) == 20 );
 C_ASSERT( sizeof(struct get_mapping_info_reply) == 24 );
+C_ASSERT( FIELD_OFFSET(struct get_relocated_image_request, mapping) == 12 );
+C_ASSERT( FIELD_OFFSET(struct get_relocated_image_request, base) == 16 );
+C_ASSERT( sizeof(struct get_relocated_image_request) == 24 );
+C_ASSERT( FIELD_OFFSET(struct get_relocated_image_reply, file) == 8 );
+C_ASSERT( sizeof(struct get_relocated_image_reply) == 16 );
 C_ASSERT( FIELD_OFFSET(struct map_view_request, mapping) == 12 );
 C_ASSERT( FIELD_OFFSET(struct map_view_request, access) == 16 );
 C_ASSERT( FIELD_OFFSET(struct map_view_request, base) == 24 );
@@ -2129,6 +2144,12 @@ C_ASSERT( FIELD_OFFSET(struct remove_completion_reply, cvalue) == 16 );
 C_ASSERT( FIELD_OFFSET(struct remove_completion_reply, information) == 24 );
 C_ASSERT( FIELD_OFFSET(struct remove_completion_reply, status) == 32 );
 C_ASSERT( sizeof(struct remove_completion_reply) == 40 );
+C_ASSERT( FIELD_OFFSET(struct get_completion_shm_request, handle) == 12 );
+C_ASSERT( sizeof(struct get_completion_shm_request) == 16 );
+C_ASSERT( FIELD_OFFSET(struct get_completion_shm_reply, size) == 8 );
+C_ASSERT( sizeof(struct get_completion_shm_reply) == 16 );
+C_ASSERT( FIELD_OFFSET(struct flush_completion_shm_request, handle) == 12 );
+C_ASSERT( sizeof(struct flush_completion_shm_request) == 16 );
 C_ASSERT( FIELD_OFFSET(struct query_completion_request, handle) == 12 );
 C_ASSERT( sizeof(struct query_completion_request) == 16 );
 C_ASSERT( FIELD_OFFSET(struct query_completion_reply, depth) == 8 );
@@ -2143,6 +2164,13 @@ C_ASSERT( FIELD_OFFSET(struct add_fd_completion_request, information) == 24 );
 C_ASSERT( FIELD_OFFSET(struct add_fd_completion_request, status) == 32 );
 C_ASSERT( FIELD_OFFSET(struct add_fd_completion_request, async) == 36 );
 C_ASSERT( sizeof(struct add_fd_completion_request) == 40 );
+C_ASSERT( FIELD_OFFSET(struct set_user_async_shm_request, mapping) == 12 );
+C_ASSERT( FIELD_OFFSET(struct set_user_async_shm_request, notify_fd) == 16 );
+C_ASSERT( sizeof(struct set_user_async_shm_request) == 24 );
+C_ASSERT( FIELD_OFFSET(struct get_fd_completion_request, handle) == 12 );
+C_ASSERT( sizeof(struct get_fd_completion_request) == 16 );
+C_ASSERT( FIELD_OFFSET(struct get_fd_completion_reply, associated) == 8 );
+C_ASSERT( sizeof(struct get_fd_completion_reply) == 16 );
 C_ASSERT( FIELD_OFFSET(struct set_fd_completion_mode_request, handle) == 12 );
 C_ASSERT( FIELD_OFFSET(struct set_fd_completion_mode_request, flags) == 16 );
 C_ASSERT( sizeof(struct set_fd_completion_mode_request) == 24 );
@@ -2098,6 +2098,17 @@ static void dump_get_mapping_info_reply( const struct get_mapping_info_reply *re
     dump_varargs_pe_image_info( ", image=", cur_size );
 }
 
+static void dump_get_relocated_image_request( const struct get_relocated_image_request *req )
+{
+    fprintf( stderr, " mapping=%04x", req->mapping );
+    dump_uint64( ", base=", &req->base );
+}
+
+static void dump_get_relocated_image_reply( const struct get_relocated_image_reply *req )
+{
+    fprintf( stderr, " file=%04x", req->file );
+}
+
 static void dump_map_view_request( const struct map_view_request *req )
 {
     fprintf( stderr, " mapping=%04x", req->mapping );
@@ -4164,6 +4175,21 @@ static void dump_remove_completion_reply( const struct remove_completion_reply *
     fprintf( stderr, ", status=%08x", req->status );
 }
 
+static void dump_get_completion_shm_request( const struct get_completion_shm_request *req )
+{
+    fprintf( stderr, " handle=%04x", req->handle );
+}
+
+static void dump_get_completion_shm_reply( const struct get_completion_shm_reply *req )
+{
+    fprintf( stderr, " size=%u", req->size );
+}
+
+static void dump_flush_completion_shm_request( const struct flush_completion_shm_request *req )
+{
+    fprintf( stderr, " handle=%04x", req->handle );
+}
+
 static void dump_query_completion_request( const struct query_completion_request *req )
 {
     fprintf( stderr, " handle=%04x", req->handle );
@@ -4190,6 +4216,22 @@ static void dump_add_fd_completion_request( const struct add_fd_completion_reque
     fprintf( stderr, ", async=%d", req->async );
 }
 
+static void dump_set_user_async_shm_request( const struct set_user_async_shm_request *req )
+{
+    fprintf( stderr, " mapping=%04x", req->mapping );
+    fprintf( stderr, ", notify_fd=%d", req->notify_fd );
+}
+
+static void dump_get_fd_completion_request( const struct get_fd_completion_request *req )
+{
+    fprintf( stderr, " handle=%04x", req->handle );
+}
+
+static void dump_get_fd_completion_reply( const struct get_fd_completion_reply *req )
+{
+    fprintf( stderr, " associated=%d", req->associated );
+}
+
 static void dump_set_fd_completion_mode_request( const struct set_fd_completion_mode_request *req )
 {
     fprintf( stderr, " handle=%04x", req->handle );
@@ -4447,6 +4489,7 @@ static const dump_func req_dumpers[REQ_NB_REQUESTS] = {
     (dump_func)dump_create_mapping_request,
     (dump_func)dump_open_mapping_request,
     (dump_func)dump_get_mapping_info_request,
+    (dump_func)dump_get_relocated_image_request,
     (dump_func)dump_map_view_request,
     (dump_func)dump_unmap_view_request,
     (dump_func)dump_get_mapping_committed_range_request,
@@ -4631,9 +4674,13 @@ static const dump_func req_dumpers[REQ_NB_REQUESTS] = {
     (dump_func)dump_open_completion_request,
     (dump_func)dump_add_completion_request,
     (dump_func)dump_remove_completion_request,
+    (dump_func)dump_get_completion_shm_request,
+    (dump_func)dump_flush_completion_shm_request,
     (dump_func)dump_query_completion_request,
     (dump_func)dump_set_completion_info_request,
     (dump_func)dump_add_fd_completion_request,
+    (dump_func)dump_set_user_async_shm_request,
+    (dump_func)dump_get_fd_completion_request,
     (dump_func)dump_set_fd_completion_mode_request,
     (dump_func)dump_set_fd_disp_info_request,
     (dump_func)dump_set_fd_name_info_request,
@@ -4724,6 +4771,7 @@ static const dump_func reply_dumpers[REQ_NB_REQUESTS] = {
     (dump_func)dump_create_mapping_reply,
     (dump_func)dump_open_mapping_reply,
     (dump_func)dump_get_mapping_info_reply,
+    (dump_func)dump_get_relocated_image_reply,
     NULL,
     NULL,
     (dump_func)dump_get_mapping_committed_range_reply,
@@ -4908,10 +4956,14 @@ static const dump_func reply_dumpers[REQ_NB_REQUESTS] = {
     (dump_func)dump_open_completion_reply,
     NULL,
     (dump_func)dump_remove_completion_reply,
+    (dump_func)dump_get_completion_shm_reply,
+    NULL,
     (dump_func)dump_query_completion_reply,
     NULL,
     NULL,
     NULL,
+    (dump_func)dump_get_fd_completion_reply,
+    NULL,
     NULL,
     NULL,
     (dump_func)dump_get_window_layered_info_reply,
@@ -5001,6 +5053,7 @@ static const char * const req_names[REQ_NB_REQUESTS] = {
     "create_mapping",
     "open_mapping",
     "get_mapping_info",
+    "get_relocated_image",
     "map_view",
     "unmap_view",
     "get_mapping_committed_range",
@@ -5185,9 +5238,13 @@ static const char * const req_names[REQ_NB_REQUESTS] = {
     "open_completion",
     "add_completion",
     "remove_completion",
+    "get_completion_shm",
+    "flush_completion_shm",
     "query_completion",
     "set_completion_info",
     "add_fd_completion",
+    "set_user_async_shm",
+    "get_fd_completion",
     "set_fd_completion_mode",
     "set_fd_disp_info",
     "set_fd_name_info",